@@ -0,0 +1,236 @@
+/*
+ ============================================================================
+ * Name        : CDmdY4mReader.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : yuv4mpeg2 clip reader for the encode benchmark.
+ ============================================================================
+ */
+
+#include "CDmdY4mReader.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+#define DMD_Y4M_SIGNATURE       "YUV4MPEG2"
+#define DMD_Y4M_FRAME_SIGNATURE "FRAME"
+#define DMD_Y4M_MAX_HEADER      1024
+
+// reads one header line without the trailing newline;
+static bool readHeaderLine(FILE *pFile, std::string *pLine) {
+    pLine->clear();
+    int c;
+    while (EOF != (c = fgetc(pFile))) {
+        if ('\n' == c) {
+            return true;
+        }
+        if (pLine->size() >= DMD_Y4M_MAX_HEADER) {
+            return false;
+        }
+        pLine->push_back(static_cast<char>(c));
+    }
+    return false;
+}
+
+CDmdY4mReader::CDmdY4mReader() : m_iWidth(0), m_iHeight(0),
+        m_fFrameRate(0.0f), m_iFrameCount(0), m_ulFrameSize(0) {
+}
+
+CDmdY4mReader::~CDmdY4mReader() {
+    Close();
+}
+
+DMD_RESULT CDmdY4mReader::parseStreamHeader(const std::string &sHeader) {
+    if (0 != sHeader.compare(0, strlen(DMD_Y4M_SIGNATURE),
+                DMD_Y4M_SIGNATURE)) {
+        DMD_LOG_ERROR("CDmdY4mReader::parseStreamHeader(), "
+                << "not a yuv4mpeg2 stream");
+        return DMD_S_FAIL;
+    }
+
+    // space separated tags, the first letter names the tag;
+    size_t ulPos = strlen(DMD_Y4M_SIGNATURE);
+    while (ulPos < sHeader.size()) {
+        size_t ulEnd = sHeader.find(' ', ulPos + 1);
+        if (std::string::npos == ulEnd) {
+            ulEnd = sHeader.size();
+        }
+        std::string sTag = sHeader.substr(ulPos + 1, ulEnd - ulPos - 1);
+        ulPos = ulEnd;
+        if (sTag.empty()) {
+            continue;
+        }
+        const char *pValue = sTag.c_str() + 1;
+        switch (sTag[0]) {
+        case 'W':
+            m_iWidth = static_cast<unsigned int>(atoi(pValue));
+            break;
+        case 'H':
+            m_iHeight = static_cast<unsigned int>(atoi(pValue));
+            break;
+        case 'F': {
+            unsigned int iNum = 0, iDen = 0;
+            if (2 == sscanf(pValue, "%u:%u", &iNum, &iDen) && iDen) {
+                m_fFrameRate = static_cast<float>(iNum) / iDen;
+            }
+            break;
+        }
+        case 'C':
+            // 420, 420jpeg, 420paldv and 420mpeg2 only differ in siting;
+            if (0 != strncmp(pValue, "420", 3)) {
+                DMD_LOG_ERROR("CDmdY4mReader::parseStreamHeader(), "
+                        << "unsupported colorspace " << pValue);
+                return DMD_S_FAIL;
+            }
+            break;
+        default:
+            // interlacing, aspect and comments don't matter here;
+            break;
+        }
+    }
+
+    if (0 == m_iWidth || 0 == m_iHeight || (m_iWidth & 1)
+            || (m_iHeight & 1)) {
+        DMD_LOG_ERROR("CDmdY4mReader::parseStreamHeader(), "
+                << "invalid resolution " << m_iWidth << "x" << m_iHeight);
+        return DMD_S_FAIL;
+    }
+    if (m_fFrameRate <= 0.0f) {
+        m_fFrameRate = 25.0f;  // the yuv4mpeg2 default;
+    }
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdY4mReader::Open(const char *pFileName,
+        unsigned int iMaxFrames) {
+    Close();
+    if (NULL == pFileName) {
+        DMD_LOG_ERROR("CDmdY4mReader::Open(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    FILE *pFile = fopen(pFileName, "rb");
+    if (NULL == pFile) {
+        DMD_LOG_ERROR("CDmdY4mReader::Open(), open " << pFileName
+                << " failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+
+    std::string sLine;
+    if (!readHeaderLine(pFile, &sLine)
+            || DMD_S_OK != parseStreamHeader(sLine)) {
+        fclose(pFile);
+        Close();
+        return DMD_S_FAIL;
+    }
+    m_ulFrameSize = static_cast<size_t>(m_iWidth) * m_iHeight * 3 / 2;
+
+    while (0 == iMaxFrames || m_iFrameCount < iMaxFrames) {
+        if (!readHeaderLine(pFile, &sLine)) {
+            break;  // end of clip;
+        }
+        if (0 != sLine.compare(0, strlen(DMD_Y4M_FRAME_SIGNATURE),
+                    DMD_Y4M_FRAME_SIGNATURE)) {
+            DMD_LOG_ERROR("CDmdY4mReader::Open(), bad frame header at frame "
+                    << m_iFrameCount);
+            break;
+        }
+        size_t ulOffset = m_vecFrames.size();
+        m_vecFrames.resize(ulOffset + m_ulFrameSize);
+        if (m_ulFrameSize != fread(&m_vecFrames[ulOffset], 1, m_ulFrameSize,
+                    pFile)) {
+            DMD_LOG_WARNING("CDmdY4mReader::Open(), truncated frame "
+                    << m_iFrameCount << " dropped");
+            m_vecFrames.resize(ulOffset);
+            break;
+        }
+        m_iFrameCount++;
+    }
+    fclose(pFile);
+
+    if (0 == m_iFrameCount) {
+        DMD_LOG_ERROR("CDmdY4mReader::Open(), no frame in " << pFileName);
+        Close();
+        return DMD_S_FAIL;
+    }
+    return DMD_S_OK;
+}
+
+void CDmdY4mReader::Close() {
+    m_iWidth = 0;
+    m_iHeight = 0;
+    m_fFrameRate = 0.0f;
+    m_iFrameCount = 0;
+    m_ulFrameSize = 0;
+    std::vector<uint8_t>().swap(m_vecFrames);
+}
+
+DMD_RESULT CDmdY4mReader::GetFrame(unsigned int iIndex,
+        DmdVideoRawData *pFrame) const {
+    if (NULL == pFrame || iIndex >= m_iFrameCount) {
+        DMD_LOG_ERROR("CDmdY4mReader::GetFrame(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    size_t ulLumaSize = static_cast<size_t>(m_iWidth) * m_iHeight;
+    uint8_t *pData = const_cast<uint8_t *>(&m_vecFrames[0])
+        + iIndex * m_ulFrameSize;
+    memset(pFrame, 0, sizeof(*pFrame));
+    pFrame->pSrcData = pData;
+    pFrame->pSrcDataPanel[0] = pData;
+    pFrame->pSrcDataPanel[1] = pData + ulLumaSize;
+    pFrame->pSrcDataPanel[2] = pData + ulLumaSize + ulLumaSize / 4;
+    pFrame->ulSrcDataStride[0] = m_iWidth;
+    pFrame->ulSrcDataStride[1] = m_iWidth / 2;
+    pFrame->ulSrcDataStride[2] = m_iWidth / 2;
+    pFrame->ulSrcDataLength[0] = ulLumaSize;
+    pFrame->ulSrcDataLength[1] = ulLumaSize / 4;
+    pFrame->ulSrcDataLength[2] = ulLumaSize / 4;
+    pFrame->ulPlaneCount = 3;
+    pFrame->ulDataLen = m_ulFrameSize;
+    pFrame->fmtVideoFormat.eVideoType = DmdI420;
+    pFrame->fmtVideoFormat.iWidth = m_iWidth;
+    pFrame->fmtVideoFormat.iHeight = m_iHeight;
+    pFrame->fmtVideoFormat.fFrameRate = m_fFrameRate;
+    pFrame->fmtVideoFormat.ulTimestamp =
+        static_cast<uint64_t>(iIndex * 1000000.0 / m_fFrameRate);
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
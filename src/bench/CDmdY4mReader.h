@@ -0,0 +1,86 @@
+/*
+ ============================================================================
+ * Name        : CDmdY4mReader.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdY4mReader.h
+ ============================================================================
+ */
+
+#ifndef SRC_BENCH_CDMDY4MREADER_H
+#define SRC_BENCH_CDMDY4MREADER_H
+
+#include <string>
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+/*
+ * Reads a YUV4MPEG2 clip, 4:2:0 only, into memory up front, so that the
+ * benchmark never waits on the disk while the encoder is timed. Frames
+ * are handed out as I420 views into the loaded clip.
+ */
+class CDmdY4mReader {
+public:
+    CDmdY4mReader();
+    ~CDmdY4mReader();
+
+    // iMaxFrames bounds the frames loaded, 0 for the whole clip;
+    DMD_RESULT Open(const char *pFileName, unsigned int iMaxFrames);
+    void Close();
+
+    unsigned int GetWidth() const {return m_iWidth;}
+    unsigned int GetHeight() const {return m_iHeight;}
+    float GetFrameRate() const {return m_fFrameRate;}
+    unsigned int GetFrameCount() const {return m_iFrameCount;}
+
+    // timestamps follow the clip frame rate, starting at 0;
+    DMD_RESULT GetFrame(unsigned int iIndex, DmdVideoRawData *pFrame) const;
+
+private:
+    DMD_RESULT parseStreamHeader(const std::string &sHeader);
+
+private:
+    unsigned int         m_iWidth;
+    unsigned int         m_iHeight;
+    float                m_fFrameRate;
+    unsigned int         m_iFrameCount;
+    size_t               m_ulFrameSize;
+    std::vector<uint8_t> m_vecFrames;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_BENCH_CDMDY4MREADER_H
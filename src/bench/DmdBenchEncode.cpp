@@ -0,0 +1,862 @@
+/*
+ ============================================================================
+ * Name        : DmdBenchEncode.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : encoder benchmark over y4m clips, see usage().
+ ============================================================================
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "wels/codec_api.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "CDmdEncodeEngine.h"
+#include "CDmdColorConvert.h"
+#include "CDmdRtpPacketizer.h"
+#include "CDmdShmFrameSender.h"
+#include "CDmdShmRing.h"
+#include "CDmdUdpSender.h"
+#include "DmdSocketUtils.h"
+#include "DmdTimeUtils.h"
+#include "DmdLog.h"
+
+#include "CDmdY4mReader.h"
+
+using namespace opendmd;
+
+#define DMD_BENCH_MAX_PSNR  99.0
+// s_arrSendMode index of the shared memory ring;
+#define DMD_BENCH_SEND_SHM  5
+
+typedef struct {
+    bool                      bJson;
+    unsigned int              iMaxFrames;   // 0 for the whole clip;
+    unsigned int              iRepeat;      // timings are the median run;
+    unsigned int              iBitrate;     // in bps;
+    std::vector<unsigned int> vecComplexity;
+    std::vector<unsigned int> vecThreads;
+    std::vector<unsigned int> vecSlices;
+    std::vector<unsigned int> vecRcMode;
+    std::vector<unsigned int> vecScale;
+    std::vector<unsigned int> vecLtr;
+    std::vector<unsigned int> vecSend;      // s_arrSendMode;
+    std::vector<std::string>  vecClips;
+} DmdBenchOption;
+
+typedef struct {
+    unsigned int iFrameCount;
+    double       fFps;             // encoded frames per wall second;
+    double       fCpuUsPerFrame;   // all encoder threads;
+    uint64_t     ulP50Us;
+    uint64_t     ulP99Us;
+    double       fBitrateKbps;     // over the clip duration;
+    double       fPsnrY;
+    double       fPsnrYuv;
+    uint64_t     ulRtpPackets;     // at DMD_RTP_DEFAULT_MTU;
+    double       fRtpKpps;         // packetizer throughput;
+    double       fSendSyscallsPerFrame;
+    double       fSendCpuUsPerMbit;    // sender thread, in the syscalls;
+} DmdBenchResult;
+
+static const char *s_arrComplexity[] = {"low", "medium", "high"};
+static const char *s_arrRcMode[] = {"quality", "bitrate", "buffer",
+    "timestamp", "off"};
+// none, then DmdUdpSendMode + 1, then the shared memory ring;
+static const char *s_arrSendMode[] = {"none", "each", "batch", "gso",
+    "uring", "shm"};
+
+static void usage(const char *pProgram) {
+    fprintf(stderr, "Usage: %s [OPTION...] CLIP.y4m...\n", pProgram);
+    fprintf(stderr, "  --json                  Print json instead of csv\n");
+    fprintf(stderr, "  --frames=N              Encode the first N frames\n");
+    fprintf(stderr, "  --repeat=N              Report the median of N runs\n");
+    fprintf(stderr, "  --bitrate=KBPS          Target bitrate, default %u\n",
+            DMD_ENCODE_DEFAULT_BITRATE / 1024);
+    fprintf(stderr, "  --complexity=LIST       low,medium,high\n");
+    fprintf(stderr, "  --threads=LIST          Encoder threads, 0 for auto\n");
+    fprintf(stderr, "  --slices=LIST           Slices per frame\n");
+    fprintf(stderr, "  --rc=LIST               quality,bitrate,buffer,"
+            "timestamp,off\n");
+    fprintf(stderr, "  --scale=LIST            Resolution divisors, 1 native\n");
+    fprintf(stderr, "  --ltr=LIST              0,1 long term reference\n");
+    fprintf(stderr, "  --send=LIST             none,each,batch,gso,uring udp "
+            "send to loopback,\n");
+    fprintf(stderr, "                          shm shared memory ring\n");
+    fprintf(stderr, "  -h, --help              Display this help message\n");
+    fprintf(stderr, "Each LIST is a comma separated axis, every combination "
+            "is run on every clip.\n");
+}
+
+// a list of numbers, or of names looked up in pNames;
+static bool parseList(const char *pArg, const char **pNames,
+        unsigned int iNameCount, std::vector<unsigned int> *pList) {
+    pList->clear();
+    std::string sArg(pArg);
+    size_t ulPos = 0;
+    while (ulPos <= sArg.size()) {
+        size_t ulEnd = sArg.find(',', ulPos);
+        if (std::string::npos == ulEnd) {
+            ulEnd = sArg.size();
+        }
+        std::string sItem = sArg.substr(ulPos, ulEnd - ulPos);
+        ulPos = ulEnd + 1;
+        if (sItem.empty()) {
+            return false;
+        }
+        if (pNames) {
+            unsigned int i = 0;
+            for (; i < iNameCount; i++) {
+                if (sItem == pNames[i]) {
+                    break;
+                }
+            }
+            if (i == iNameCount) {
+                return false;
+            }
+            pList->push_back(i);
+        } else {
+            char *pEnd = NULL;
+            unsigned long ulValue = strtoul(sItem.c_str(), &pEnd, 10);
+            if (*pEnd) {
+                return false;
+            }
+            pList->push_back(static_cast<unsigned int>(ulValue));
+        }
+    }
+    return !pList->empty();
+}
+
+static bool parseOption(int argc, char *argv[], DmdBenchOption *pOption) {
+    pOption->bJson = false;
+    pOption->iMaxFrames = 0;
+    pOption->iRepeat = 1;
+    pOption->iBitrate = DMD_ENCODE_DEFAULT_BITRATE;
+    pOption->vecComplexity.assign(1, DmdComplexityMedium);
+    pOption->vecThreads.assign(1, 1);
+    pOption->vecSlices.assign(1, 1);
+    pOption->vecRcMode.assign(1, DmdRcBitrate);
+    pOption->vecScale.assign(1, 1);
+    pOption->vecLtr.assign(1, 0);
+    pOption->vecSend.assign(1, 0);
+
+    static const struct option longOptions[] = {
+        {"json", no_argument, NULL, 'j'},
+        {"frames", required_argument, NULL, 'n'},
+        {"repeat", required_argument, NULL, 'r'},
+        {"bitrate", required_argument, NULL, 'b'},
+        {"complexity", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"slices", required_argument, NULL, 's'},
+        {"rc", required_argument, NULL, 'm'},
+        {"scale", required_argument, NULL, 'x'},
+        {"ltr", required_argument, NULL, 'l'},
+        {"send", required_argument, NULL, 'u'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    bool bValid = true;
+    while (-1 != (opt = getopt_long(argc, argv, "h", longOptions, NULL))) {
+        switch (opt) {
+        case 'j':
+            pOption->bJson = true;
+            break;
+        case 'n':
+            pOption->iMaxFrames = static_cast<unsigned int>(atoi(optarg));
+            break;
+        case 'r':
+            pOption->iRepeat = static_cast<unsigned int>(atoi(optarg));
+            bValid = bValid && pOption->iRepeat > 0;
+            break;
+        case 'b':
+            pOption->iBitrate = static_cast<unsigned int>(atoi(optarg)) * 1024;
+            bValid = bValid && pOption->iBitrate > 0;
+            break;
+        case 'c':
+            bValid = bValid && parseList(optarg, s_arrComplexity,
+                    sizeof(s_arrComplexity) / sizeof(s_arrComplexity[0]),
+                    &pOption->vecComplexity);
+            break;
+        case 't':
+            bValid = bValid && parseList(optarg, NULL, 0,
+                    &pOption->vecThreads);
+            break;
+        case 's':
+            bValid = bValid && parseList(optarg, NULL, 0, &pOption->vecSlices);
+            break;
+        case 'm':
+            bValid = bValid && parseList(optarg, s_arrRcMode,
+                    sizeof(s_arrRcMode) / sizeof(s_arrRcMode[0]),
+                    &pOption->vecRcMode);
+            break;
+        case 'x':
+            bValid = bValid && parseList(optarg, NULL, 0, &pOption->vecScale)
+                && pOption->vecScale.end() == std::find(
+                        pOption->vecScale.begin(), pOption->vecScale.end(), 0);
+            break;
+        case 'l':
+            bValid = bValid && parseList(optarg, NULL, 0, &pOption->vecLtr);
+            break;
+        case 'u':
+            bValid = bValid && parseList(optarg, s_arrSendMode,
+                    sizeof(s_arrSendMode) / sizeof(s_arrSendMode[0]),
+                    &pOption->vecSend);
+            break;
+        case 'h':
+        default:
+            return false;
+        }
+    }
+    for (int i = optind; i < argc; i++) {
+        pOption->vecClips.push_back(argv[i]);
+    }
+    return bValid && !pOption->vecClips.empty();
+}
+
+/*
+ * Keeps the last access unit by reference, so that decoding for psnr
+ * happens after EncodeFrame() returns, outside the timed section.
+ */
+class CDmdBenchSink : public IDmdEncodeEngineSink {
+public:
+    CDmdBenchSink() : m_ulTotalBytes(0), m_pLastFrame(NULL) {
+        memset(&m_lastFrame, 0, sizeof(m_lastFrame));
+    }
+    ~CDmdBenchSink() {
+        Reset();
+    }
+
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) {
+        m_ulTotalBytes += pEncodedFrame->ulDataLen;
+        if (NULL == pEncodedFrame->pFrameBuffer) {
+            return DMD_S_OK;  // skipped frame;
+        }
+        pEncodedFrame->pFrameBuffer->AddRef();
+        m_lastFrame = *pEncodedFrame;
+        m_pLastFrame = &m_lastFrame;
+        return DMD_S_OK;
+    }
+
+    // the access unit of the last EncodeFrame(), NULL if it was skipped;
+    const DmdEncodedFrame *TakeFrame() {
+        const DmdEncodedFrame *pFrame = m_pLastFrame;
+        m_pLastFrame = NULL;
+        return pFrame;
+    }
+    void ReleaseFrame() {
+        if (m_lastFrame.pFrameBuffer) {
+            m_lastFrame.pFrameBuffer->Release();
+        }
+        memset(&m_lastFrame, 0, sizeof(m_lastFrame));
+    }
+    void Reset() {
+        ReleaseFrame();
+        m_pLastFrame = NULL;
+        m_ulTotalBytes = 0;
+    }
+    uint64_t GetTotalBytes() const {return m_ulTotalBytes;}
+
+private:
+    uint64_t        m_ulTotalBytes;
+    DmdEncodedFrame m_lastFrame;
+    DmdEncodedFrame *m_pLastFrame;
+};
+
+// decodes the encoded stream back and compares with the source frames;
+class CDmdBenchQuality {
+public:
+    CDmdBenchQuality() : m_pDecoder(NULL), m_iWidth(0), m_iHeight(0),
+            m_fSumPsnrY(0.0), m_fSumPsnrYuv(0.0), m_iFrameCount(0) {
+    }
+    ~CDmdBenchQuality() {
+        if (m_pDecoder) {
+            m_pDecoder->Uninitialize();
+            WelsDestroyDecoder(m_pDecoder);
+            m_pDecoder = NULL;
+        }
+    }
+
+    DMD_RESULT Init(unsigned int iWidth, unsigned int iHeight) {
+        if (0 != WelsCreateDecoder(&m_pDecoder) || NULL == m_pDecoder) {
+            DMD_LOG_ERROR("CDmdBenchQuality::Init(), create decoder failed");
+            m_pDecoder = NULL;
+            return DMD_S_FAIL;
+        }
+        SDecodingParam decodingParam;
+        memset(&decodingParam, 0, sizeof(decodingParam));
+        decodingParam.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_AVC;
+        if (0 != m_pDecoder->Initialize(&decodingParam)) {
+            DMD_LOG_ERROR("CDmdBenchQuality::Init(), init decoder failed");
+            return DMD_S_FAIL;
+        }
+        m_iWidth = iWidth;
+        m_iHeight = iHeight;
+        // mid gray until the first picture is decoded;
+        m_vecPicture.assign(static_cast<size_t>(iWidth) * iHeight * 3 / 2,
+                128);
+        return DMD_S_OK;
+    }
+
+    // pEncoded is NULL for a skipped frame, the last picture is shown;
+    DMD_RESULT AddFrame(const DmdVideoRawData *pSource,
+            const DmdEncodedFrame *pEncoded) {
+        if (pEncoded && DMD_S_OK != decode(pEncoded)) {
+            return DMD_S_FAIL;
+        }
+
+        unsigned int arrWidth[3] = {m_iWidth, m_iWidth / 2, m_iWidth / 2};
+        unsigned int arrHeight[3] = {m_iHeight, m_iHeight / 2,
+            m_iHeight / 2};
+        uint64_t arrSse[3] = {0, 0, 0};
+        const uint8_t *pPicture = &m_vecPicture[0];
+        for (int i = 0; i < 3; i++) {
+            for (unsigned int y = 0; y < arrHeight[i]; y++) {
+                const uint8_t *pSrc = pSource->pSrcDataPanel[i]
+                    + y * pSource->ulSrcDataStride[i];
+                for (unsigned int x = 0; x < arrWidth[i]; x++) {
+                    int iDiff = static_cast<int>(pSrc[x]) - pPicture[x];
+                    arrSse[i] += iDiff * iDiff;
+                }
+                pPicture += arrWidth[i];
+            }
+        }
+        size_t ulLuma = static_cast<size_t>(m_iWidth) * m_iHeight;
+        m_fSumPsnrY += psnr(arrSse[0], ulLuma);
+        m_fSumPsnrYuv += psnr(arrSse[0] + arrSse[1] + arrSse[2],
+                ulLuma * 3 / 2);
+        m_iFrameCount++;
+        return DMD_S_OK;
+    }
+
+    double GetPsnrY() const {
+        return m_iFrameCount ? m_fSumPsnrY / m_iFrameCount : 0.0;
+    }
+    double GetPsnrYuv() const {
+        return m_iFrameCount ? m_fSumPsnrYuv / m_iFrameCount : 0.0;
+    }
+
+private:
+    static double psnr(uint64_t ulSse, size_t ulSamples) {
+        if (0 == ulSse) {
+            return DMD_BENCH_MAX_PSNR;
+        }
+        double fMse = static_cast<double>(ulSse) / ulSamples;
+        return std::min(DMD_BENCH_MAX_PSNR,
+                10.0 * log10(255.0 * 255.0 / fMse));
+    }
+
+    DMD_RESULT decode(const DmdEncodedFrame *pEncoded) {
+        uint8_t *pData[3] = {NULL, NULL, NULL};
+        SBufferInfo bufferInfo;
+        memset(&bufferInfo, 0, sizeof(bufferInfo));
+        int ret = m_pDecoder->DecodeFrameNoDelay(pEncoded->pData,
+                static_cast<int>(pEncoded->ulDataLen), pData, &bufferInfo);
+        if (0 != ret) {
+            DMD_LOG_ERROR("CDmdBenchQuality::decode(), decode failed, ret = "
+                    << ret);
+            return DMD_S_FAIL;
+        }
+        if (1 != bufferInfo.iBufferStatus) {
+            return DMD_S_OK;  // nothing to show, keep the last picture;
+        }
+
+        const SSysMEMBuffer &sysBuffer = bufferInfo.UsrData.sSystemBuffer;
+        unsigned int arrWidth[3] = {m_iWidth, m_iWidth / 2, m_iWidth / 2};
+        unsigned int arrHeight[3] = {m_iHeight, m_iHeight / 2,
+            m_iHeight / 2};
+        uint8_t *pPicture = &m_vecPicture[0];
+        for (int i = 0; i < 3; i++) {
+            int iStride = sysBuffer.iStride[i ? 1 : 0];
+            for (unsigned int y = 0; y < arrHeight[i]; y++) {
+                memcpy(pPicture, pData[i] + y * iStride, arrWidth[i]);
+                pPicture += arrWidth[i];
+            }
+        }
+        return DMD_S_OK;
+    }
+
+private:
+    ISVCDecoder          *m_pDecoder;
+    unsigned int         m_iWidth;
+    unsigned int         m_iHeight;
+    std::vector<uint8_t> m_vecPicture;
+    double               m_fSumPsnrY;
+    double               m_fSumPsnrYuv;
+    unsigned int         m_iFrameCount;
+};
+
+// the clip at one scale, frames view either the reader or vecScaled;
+typedef struct {
+    unsigned int                 iWidth;
+    unsigned int                 iHeight;
+    float                        fFrameRate;
+    std::vector<DmdVideoRawData> vecFrames;
+    std::vector<uint8_t>         vecScaled;
+} DmdBenchClip;
+
+static DMD_RESULT prepareClip(const CDmdY4mReader &reader,
+        unsigned int iScale, DmdBenchClip *pClip) {
+    unsigned int iFrameCount = reader.GetFrameCount();
+    pClip->iWidth = DmdDownscaledSize(reader.GetWidth(), iScale);
+    pClip->iHeight = DmdDownscaledSize(reader.GetHeight(), iScale);
+    pClip->fFrameRate = reader.GetFrameRate();
+    pClip->vecFrames.resize(iFrameCount);
+    std::vector<uint8_t>().swap(pClip->vecScaled);
+    if (1 == iScale) {
+        pClip->iWidth = reader.GetWidth();
+        pClip->iHeight = reader.GetHeight();
+        for (unsigned int i = 0; i < iFrameCount; i++) {
+            reader.GetFrame(i, &pClip->vecFrames[i]);
+        }
+        return DMD_S_OK;
+    }
+    if (pClip->iWidth < 16 || pClip->iHeight < 16) {
+        DMD_LOG_ERROR("prepareClip(), scale " << iScale << " is too small");
+        return DMD_S_FAIL;
+    }
+
+    size_t ulLuma = static_cast<size_t>(pClip->iWidth) * pClip->iHeight;
+    size_t ulFrameSize = ulLuma * 3 / 2;
+    pClip->vecScaled.resize(ulFrameSize * iFrameCount);
+    for (unsigned int i = 0; i < iFrameCount; i++) {
+        DmdVideoRawData source;
+        reader.GetFrame(i, &source);
+        DmdVideoRawData *pFrame = &pClip->vecFrames[i];
+        *pFrame = source;
+        uint8_t *pData = &pClip->vecScaled[0] + i * ulFrameSize;
+        pFrame->pSrcData = pData;
+        pFrame->pSrcDataPanel[0] = pData;
+        pFrame->pSrcDataPanel[1] = pData + ulLuma;
+        pFrame->pSrcDataPanel[2] = pData + ulLuma + ulLuma / 4;
+        pFrame->ulSrcDataStride[0] = pClip->iWidth;
+        pFrame->ulSrcDataStride[1] = pClip->iWidth / 2;
+        pFrame->ulSrcDataStride[2] = pClip->iWidth / 2;
+        pFrame->ulSrcDataLength[0] = ulLuma;
+        pFrame->ulSrcDataLength[1] = ulLuma / 4;
+        pFrame->ulSrcDataLength[2] = ulLuma / 4;
+        pFrame->ulDataLen = ulFrameSize;
+        pFrame->fmtVideoFormat.iWidth = pClip->iWidth;
+        pFrame->fmtVideoFormat.iHeight = pClip->iHeight;
+        if (DMD_S_OK != DmdDownscaleI420(&source, pFrame, iScale)) {
+            return DMD_S_FAIL;
+        }
+    }
+    return DMD_S_OK;
+}
+
+// nearest rank percentile, vecSorted in ascending order;
+static uint64_t percentile(const std::vector<uint64_t> &vecSorted,
+        unsigned int iPercent) {
+    size_t ulRank = (vecSorted.size() * iPercent + 99) / 100;
+    return vecSorted[ulRank ? ulRank - 1 : 0];
+}
+
+/*
+ * The server end of the shared memory ring, on a thread of its own and
+ * asleep between frames, as a co-located server would be; it reads each
+ * access unit in place and lets it go.
+ */
+class CDmdBenchShmReader {
+public:
+    CDmdBenchShmReader() : m_bRunning(false), m_ulReadBytes(0) {}
+    ~CDmdBenchShmReader() {
+        Stop();
+    }
+
+    DMD_RESULT Start(CDmdShmRing *pProducer) {
+        int arrSockets[2];
+        if (0 != socketpair(AF_UNIX, SOCK_SEQPACKET, 0, arrSockets)) {
+            return DMD_S_FAIL;
+        }
+        DMD_RESULT ret = pProducer->Offer(arrSockets[0]);
+        if (DMD_S_OK == ret) {
+            ret = m_ring.Accept(arrSockets[1]);
+        }
+        close(arrSockets[0]);
+        close(arrSockets[1]);
+        if (DMD_S_OK != ret) {
+            return ret;
+        }
+        m_bRunning = true;
+        m_thread = std::thread(&CDmdBenchShmReader::run, this);
+        return DMD_S_OK;
+    }
+
+    void Stop() {
+        if (m_thread.joinable()) {
+            m_bRunning = false;
+            m_thread.join();
+        }
+    }
+
+    uint64_t GetReadBytes() const {return m_ulReadBytes;}
+
+private:
+    void run() {
+        while (m_bRunning || !m_ring.IsEmpty()) {
+            m_ring.Wait(10);
+            const DmdShmRecord *pRecord = NULL;
+            const uint8_t *pData = NULL;
+            while (DMD_S_OK == m_ring.Peek(&pRecord, &pData)) {
+                m_ulReadBytes += pRecord->iSize;
+                m_ring.Release();
+            }
+        }
+    }
+
+    CDmdShmRing             m_ring;
+    std::thread             m_thread;
+    std::atomic<bool>       m_bRunning;
+    std::atomic<uint64_t>   m_ulReadBytes;
+};
+
+/*
+ * One encode of the clip. Only EncodeFrame() counts for the encode
+ * figures; each access unit is then packetized to rtp, timed on its own,
+ * optionally sent over udp to a loopback socket that discards it, or
+ * written whole to a shared memory ring instead, and decoded for psnr,
+ * untimed. Timestamps come from the clip frame rate
+ * instead of the wall clock, so rate control and frame skipping, and
+ * hence bytes and psnr, are the same on every run.
+ */
+static DMD_RESULT runOnce(const DmdBenchClip &clip,
+        const DmdEncodeParam &encodeParam, unsigned int iSendMode,
+        bool bMeasureQuality, DmdBenchResult *pResult) {
+    IDmdEncodeEngine *pEngine = NULL;
+    if (DMD_S_OK != CreateVideoEncodeEngine(&pEngine)) {
+        return DMD_S_FAIL;
+    }
+    CDmdBenchSink sink;
+    CDmdBenchQuality quality;
+    CDmdRtpPacketizer packetizer;
+    DmdRtpPacketizerParam packetizerParam;
+    memset(&packetizerParam, 0, sizeof(packetizerParam));
+    packetizerParam.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+    packetizerParam.ulMtu = DMD_RTP_DEFAULT_MTU;
+    packetizerParam.bAggregate = true;
+    DMD_RESULT ret = packetizer.Init(packetizerParam);
+    if (DMD_S_OK == ret) {
+        ret = pEngine->Init(encodeParam);
+    }
+    if (DMD_S_OK == ret) {
+        ret = pEngine->SetDataSink(&sink);
+    }
+    if (DMD_S_OK == ret && bMeasureQuality) {
+        ret = quality.Init(clip.iWidth, clip.iHeight);
+    }
+    CDmdUdpSender sender;
+    int iDiscard = -1;
+    CDmdShmRing shmRing;
+    CDmdShmFrameSender shmSender;
+    CDmdBenchShmReader shmReader;
+    bool bShm = DMD_BENCH_SEND_SHM == iSendMode;
+    if (DMD_S_OK == ret && bShm) {
+        ret = shmRing.Create(DMD_SHM_RING_DEFAULT_CAPACITY);
+        if (DMD_S_OK == ret) {
+            ret = shmSender.Init(&shmRing);
+        }
+        if (DMD_S_OK == ret) {
+            ret = shmReader.Start(&shmRing);
+        }
+    } else if (DMD_S_OK == ret && iSendMode) {
+        DmdUdpSenderParam senderParam;
+        memset(&senderParam, 0, sizeof(senderParam));
+        iDiscard = DmdOpenUdpSocket("127.0.0.1", 0, &senderParam.remoteAddr);
+        senderParam.iRemoteAddrLen = sizeof(struct sockaddr_in);
+        senderParam.eMode = static_cast<DmdUdpSendMode>(iSendMode - 1);
+        ret = iDiscard >= 0 ? DmdSetNonBlocking(iDiscard, true) : DMD_S_FAIL;
+        if (DMD_S_OK == ret) {
+            ret = sender.Init(senderParam);
+        }
+    }
+
+    unsigned int iFrameCount = static_cast<unsigned int>(
+            clip.vecFrames.size());
+    std::vector<uint64_t> vecLatency;
+    vecLatency.reserve(iFrameCount);
+    uint64_t ulWallUs = 0;
+    uint64_t ulCpuUs = 0;
+    uint64_t ulPacketizeNs = 0;
+    uint64_t ulPackets = 0;
+    for (unsigned int i = 0; DMD_S_OK == ret && i < iFrameCount; i++) {
+        uint64_t ulCpuStart = DmdGetProcessCpuTimeUs();
+        uint64_t ulStart = DmdGetTickCountUs();
+        ret = pEngine->EncodeFrame(&clip.vecFrames[i]);
+        uint64_t ulElapsed = DmdGetTickCountUs() - ulStart;
+        ulCpuUs += DmdGetProcessCpuTimeUs() - ulCpuStart;
+        ulWallUs += ulElapsed;
+        vecLatency.push_back(ulElapsed);
+
+        const DmdEncodedFrame *pEncoded = sink.TakeFrame();
+        if (DMD_S_OK == ret && pEncoded) {
+            const DmdRtpPacket *pPackets = NULL;
+            unsigned int iPacketCount = 0;
+            uint64_t ulPacketizeStart = DmdGetTickCountNs();
+            ret = packetizer.Packetize(pEncoded, &pPackets, &iPacketCount);
+            ulPacketizeNs += DmdGetTickCountNs() - ulPacketizeStart;
+            ulPackets += iPacketCount;
+            if (DMD_S_OK == ret && bShm) {
+                // the access unit as it is, the packets go unused;
+                ret = shmSender.DeliverEncodedData(
+                        const_cast<DmdEncodedFrame *>(pEncoded));
+            } else if (DMD_S_OK == ret && iDiscard >= 0) {
+                ret = sender.SendPackets(pPackets, iPacketCount);
+                uint8_t arrDatagram[2048];
+                while (recv(iDiscard, arrDatagram, sizeof(arrDatagram), 0)
+                        >= 0) {
+                }
+            }
+        }
+        if (DMD_S_OK == ret && bMeasureQuality) {
+            ret = quality.AddFrame(&clip.vecFrames[i], pEncoded);
+        }
+        sink.ReleaseFrame();
+    }
+    pEngine->Uninit();
+    ReleaseVideoEncodeEngine(&pEngine);
+    DmdUdpSenderStats sendStats;
+    sender.GetStats(&sendStats);
+    sender.Uninit();
+    shmReader.Stop();
+    if (bShm) {
+        // one eventfd write per frame the reader slept on, no more;
+        DmdShmFrameSenderStats shmStats;
+        DmdShmRingStats ringStats;
+        shmSender.GetStats(&shmStats);
+        shmRing.GetStats(&ringStats);
+        sendStats.ulCallCount = shmStats.ulFrameCount;
+        sendStats.ulSyscallCount = ringStats.ulSignalCount;
+        sendStats.ulByteCount = shmReader.GetReadBytes();
+        sendStats.ulSendCpuUs = shmStats.ulSendCpuUs;
+    }
+    if (iDiscard >= 0) {
+        close(iDiscard);
+    }
+    if (DMD_S_OK != ret) {
+        return ret;
+    }
+
+    std::sort(vecLatency.begin(), vecLatency.end());
+    pResult->iFrameCount = iFrameCount;
+    pResult->fFps = ulWallUs ? iFrameCount * 1000000.0 / ulWallUs : 0.0;
+    pResult->fCpuUsPerFrame = static_cast<double>(ulCpuUs) / iFrameCount;
+    pResult->ulP50Us = percentile(vecLatency, 50);
+    pResult->ulP99Us = percentile(vecLatency, 99);
+    pResult->fBitrateKbps = sink.GetTotalBytes() * 8.0 * clip.fFrameRate
+        / iFrameCount / 1024.0;
+    pResult->ulRtpPackets = ulPackets;
+    pResult->fRtpKpps = ulPacketizeNs ? ulPackets * 1000000.0 / ulPacketizeNs
+        : 0.0;
+    if (sendStats.ulCallCount) {
+        pResult->fSendSyscallsPerFrame = static_cast<double>(
+                sendStats.ulSyscallCount) / sendStats.ulCallCount;
+    }
+    if (sendStats.ulByteCount) {
+        pResult->fSendCpuUsPerMbit = sendStats.ulSendCpuUs * 1000000.0
+            / (sendStats.ulByteCount * 8.0);
+    }
+    if (bMeasureQuality) {
+        pResult->fPsnrY = quality.GetPsnrY();
+        pResult->fPsnrYuv = quality.GetPsnrYuv();
+    }
+    return DMD_S_OK;
+}
+
+// quality metrics from the first run, timings from the median fps run;
+static DMD_RESULT runCase(const DmdBenchClip &clip,
+        const DmdEncodeParam &encodeParam, unsigned int iSendMode,
+        unsigned int iRepeat, DmdBenchResult *pResult) {
+    std::vector<DmdBenchResult> vecRuns(iRepeat);
+    for (unsigned int i = 0; i < iRepeat; i++) {
+        memset(&vecRuns[i], 0, sizeof(vecRuns[i]));
+        if (DMD_S_OK != runOnce(clip, encodeParam, iSendMode, 0 == i,
+                    &vecRuns[i])) {
+            return DMD_S_FAIL;
+        }
+    }
+    double fPsnrY = vecRuns[0].fPsnrY;
+    double fPsnrYuv = vecRuns[0].fPsnrYuv;
+    std::sort(vecRuns.begin(), vecRuns.end(),
+            [](const DmdBenchResult &a, const DmdBenchResult &b) {
+                return a.fFps < b.fFps;
+            });
+    *pResult = vecRuns[iRepeat / 2];
+    pResult->fPsnrY = fPsnrY;
+    pResult->fPsnrYuv = fPsnrYuv;
+    return DMD_S_OK;
+}
+
+static void printResult(const DmdBenchOption &option, bool bFirst,
+        const std::string &sClip, const DmdBenchClip &clip,
+        const DmdEncodeParam &encodeParam, unsigned int iScale,
+        unsigned int iSendMode, const DmdBenchResult &result) {
+    if (option.bJson) {
+        fprintf(stdout, "%s  {\"clip\": \"%s\", \"width\": %u, "
+                "\"height\": %u, \"scale\": %u, \"frames\": %u, "
+                "\"complexity\": \"%s\", \"threads\": %u, \"slices\": %u, "
+                "\"rc\": \"%s\", \"ltr\": %u, \"target_kbps\": %u, "
+                "\"fps\": %.2f, \"cpu_us_per_frame\": %.1f, "
+                "\"p50_us\": %llu, \"p99_us\": %llu, "
+                "\"bitrate_kbps\": %.2f, \"psnr_y\": %.3f, "
+                "\"psnr_yuv\": %.3f, \"rtp_packets\": %llu, "
+                "\"rtp_kpps\": %.1f, \"send\": \"%s\", "
+                "\"send_syscalls_per_frame\": %.2f, "
+                "\"send_cpu_us_per_mbit\": %.1f}",
+                bFirst ? "" : ",\n", sClip.c_str(), clip.iWidth,
+                clip.iHeight, iScale, result.iFrameCount,
+                s_arrComplexity[encodeParam.eComplexity],
+                encodeParam.iThreadCount, encodeParam.iSliceCount,
+                s_arrRcMode[encodeParam.eRcMode],
+                encodeParam.bEnableLtr ? 1 : 0,
+                encodeParam.iTargetBitrate / 1024, result.fFps,
+                result.fCpuUsPerFrame,
+                static_cast<unsigned long long>(result.ulP50Us),
+                static_cast<unsigned long long>(result.ulP99Us),
+                result.fBitrateKbps, result.fPsnrY, result.fPsnrYuv,
+                static_cast<unsigned long long>(result.ulRtpPackets),
+                result.fRtpKpps, s_arrSendMode[iSendMode],
+                result.fSendSyscallsPerFrame, result.fSendCpuUsPerMbit);
+        return;
+    }
+
+    if (bFirst) {
+        fprintf(stdout, "clip,width,height,scale,frames,complexity,threads,"
+                "slices,rc,ltr,target_kbps,fps,cpu_us_per_frame,p50_us,"
+                "p99_us,bitrate_kbps,psnr_y,psnr_yuv,rtp_packets,rtp_kpps,send,"
+                "send_syscalls_per_frame,send_cpu_us_per_mbit\n");
+    }
+    fprintf(stdout, "%s,%u,%u,%u,%u,%s,%u,%u,%s,%u,%u,%.2f,%.1f,%llu,%llu,"
+            "%.2f,%.3f,%.3f,%llu,%.1f,%s,%.2f,%.1f\n", sClip.c_str(),
+            clip.iWidth, clip.iHeight, iScale, result.iFrameCount,
+            s_arrComplexity[encodeParam.eComplexity],
+            encodeParam.iThreadCount, encodeParam.iSliceCount,
+            s_arrRcMode[encodeParam.eRcMode],
+            encodeParam.bEnableLtr ? 1 : 0,
+            encodeParam.iTargetBitrate / 1024, result.fFps,
+            result.fCpuUsPerFrame,
+            static_cast<unsigned long long>(result.ulP50Us),
+            static_cast<unsigned long long>(result.ulP99Us),
+            result.fBitrateKbps, result.fPsnrY, result.fPsnrYuv,
+            static_cast<unsigned long long>(result.ulRtpPackets),
+            result.fRtpKpps, s_arrSendMode[iSendMode],
+            result.fSendSyscallsPerFrame, result.fSendCpuUsPerMbit);
+}
+
+int main(int argc, char *argv[]) {
+    DmdBenchOption option;
+    if (!parseOption(argc, argv, &option)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool bFirst = true;
+    bool bFailed = false;
+    if (option.bJson) {
+        fprintf(stdout, "[\n");
+    }
+    for (size_t c = 0; c < option.vecClips.size(); c++) {
+        CDmdY4mReader reader;
+        if (DMD_S_OK != reader.Open(option.vecClips[c].c_str(),
+                    option.iMaxFrames)) {
+            fprintf(stderr, "failed to load %s\n", option.vecClips[c].c_str());
+            bFailed = true;
+            continue;
+        }
+
+        for (size_t x = 0; x < option.vecScale.size(); x++) {
+            DmdBenchClip clip;
+            if (DMD_S_OK != prepareClip(reader, option.vecScale[x], &clip)) {
+                bFailed = true;
+                continue;
+            }
+            // the axes, outermost first;
+            for (size_t m = 0; m < option.vecRcMode.size(); m++)
+            for (size_t p = 0; p < option.vecComplexity.size(); p++)
+            for (size_t t = 0; t < option.vecThreads.size(); t++)
+            for (size_t s = 0; s < option.vecSlices.size(); s++)
+            for (size_t l = 0; l < option.vecLtr.size(); l++)
+            for (size_t u = 0; u < option.vecSend.size(); u++) {
+                DmdEncodeParam encodeParam;
+                memset(&encodeParam, 0, sizeof(encodeParam));
+                encodeParam.fFrameRate = clip.fFrameRate;
+                encodeParam.iTargetBitrate = option.iBitrate;
+                encodeParam.iGopSize = DMD_ENCODE_DEFAULT_GOPSIZE;
+                encodeParam.eRcMode =
+                    static_cast<DmdRateControlMode>(option.vecRcMode[m]);
+                encodeParam.eComplexity =
+                    static_cast<DmdComplexityMode>(option.vecComplexity[p]);
+                encodeParam.iThreadCount = option.vecThreads[t];
+                encodeParam.iSliceCount = option.vecSlices[s];
+                encodeParam.bEnableFrameSkip = true;
+                encodeParam.bEnableLtr = 0 != option.vecLtr[l];
+                encodeParam.iLtrMarkPeriod = DMD_ENCODE_DEFAULT_LTR_PERIOD;
+
+                DmdBenchResult result;
+                memset(&result, 0, sizeof(result));
+                if (DMD_S_OK != runCase(clip, encodeParam, option.vecSend[u],
+                            option.iRepeat, &result)) {
+                    fprintf(stderr, "failed to encode %s\n",
+                            option.vecClips[c].c_str());
+                    bFailed = true;
+                    continue;
+                }
+                printResult(option, bFirst, option.vecClips[c], clip,
+                        encodeParam, option.vecScale[x], option.vecSend[u],
+                        result);
+                bFirst = false;
+                fflush(stdout);
+            }
+        }
+    }
+    if (option.bJson) {
+        fprintf(stdout, "%s]\n", bFirst ? "" : "\n");
+    }
+
+    return bFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
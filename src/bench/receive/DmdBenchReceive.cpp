@@ -0,0 +1,357 @@
+/*
+ ============================================================================
+ * Name        : DmdBenchReceive.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : udp receive benchmark, epoll against io_uring, see usage().
+ ============================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "CDmdUdpReceiver.h"
+#include "DmdSocketUtils.h"
+#include "DmdTimeUtils.h"
+
+using namespace opendmd;
+
+#define DMD_BENCH_MAX_DATAGRAM  (DMD_UDP_RECV_BUFFER_SIZE - 64)
+
+typedef struct {
+    bool                      bJson;
+    unsigned int              iStreams;
+    unsigned int              iSenders;
+    unsigned int              iDurationMs;
+    unsigned int              iSize;
+    std::vector<unsigned int> vecBackend;   // DmdUdpRecvBackend;
+} DmdBenchOption;
+
+typedef struct {
+    DmdUdpRecvBackend   eBackend;           // the one Init() took;
+    uint64_t            ulSentCount;
+    uint64_t            ulDatagramCount;
+    double              fKpps;              // received per wall second;
+    double              fKppsPerCore;       // per receiving cpu second;
+    double              fSyscallsPerKpkt;
+    double              fCpuPercent;        // receiving thread;
+} DmdBenchResult;
+
+static const char *s_arrBackend[] = {"auto", "epoll", "uring"};
+
+static void usage(const char *pProgram) {
+    fprintf(stderr, "Usage: %s [OPTION...]\n", pProgram);
+    fprintf(stderr, "  --json                  Print json instead of csv\n");
+    fprintf(stderr, "  --recv=LIST             auto,epoll,uring\n");
+    fprintf(stderr, "  --streams=N             Receiving sockets, default "
+            "256\n");
+    fprintf(stderr, "  --senders=N             Sending threads, default 2\n");
+    fprintf(stderr, "  --duration=MS           Per backend, default 2000\n");
+    fprintf(stderr, "  --size=BYTES            Datagram size, default 1200\n");
+    fprintf(stderr, "  -h, --help              Display this help message\n");
+    fprintf(stderr, "Datagrams go to the streams round robin over loopback, "
+            "as fast as the senders can.\n");
+}
+
+static bool parseBackends(const char *pArg, std::vector<unsigned int> *pList) {
+    pList->clear();
+    std::string sArg(pArg);
+    size_t ulPos = 0;
+    while (ulPos <= sArg.size()) {
+        size_t ulEnd = sArg.find(',', ulPos);
+        if (std::string::npos == ulEnd) {
+            ulEnd = sArg.size();
+        }
+        std::string sItem = sArg.substr(ulPos, ulEnd - ulPos);
+        ulPos = ulEnd + 1;
+        unsigned int i = 0;
+        for (; i < sizeof(s_arrBackend) / sizeof(s_arrBackend[0]); i++) {
+            if (sItem == s_arrBackend[i]) {
+                break;
+            }
+        }
+        if (sizeof(s_arrBackend) / sizeof(s_arrBackend[0]) == i) {
+            return false;
+        }
+        pList->push_back(i);
+    }
+    return !pList->empty();
+}
+
+static bool parseOption(int argc, char *argv[], DmdBenchOption *pOption) {
+    pOption->bJson = false;
+    pOption->iStreams = 256;
+    pOption->iSenders = 2;
+    pOption->iDurationMs = 2000;
+    pOption->iSize = 1200;
+    pOption->vecBackend.clear();
+    pOption->vecBackend.push_back(DmdUdpRecvEpoll);
+    pOption->vecBackend.push_back(DmdUdpRecvUring);
+
+    static const struct option longOptions[] = {
+        {"json", no_argument, NULL, 'j'},
+        {"recv", required_argument, NULL, 'r'},
+        {"streams", required_argument, NULL, 'n'},
+        {"senders", required_argument, NULL, 's'},
+        {"duration", required_argument, NULL, 'd'},
+        {"size", required_argument, NULL, 'z'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    bool bValid = true;
+    while (-1 != (opt = getopt_long(argc, argv, "h", longOptions, NULL))) {
+        switch (opt) {
+        case 'j':
+            pOption->bJson = true;
+            break;
+        case 'r':
+            bValid = bValid && parseBackends(optarg, &pOption->vecBackend);
+            break;
+        case 'n':
+            pOption->iStreams = static_cast<unsigned int>(atoi(optarg));
+            bValid = bValid && pOption->iStreams > 0;
+            break;
+        case 's':
+            pOption->iSenders = static_cast<unsigned int>(atoi(optarg));
+            bValid = bValid && pOption->iSenders > 0;
+            break;
+        case 'd':
+            pOption->iDurationMs = static_cast<unsigned int>(atoi(optarg));
+            bValid = bValid && pOption->iDurationMs > 0;
+            break;
+        case 'z':
+            pOption->iSize = static_cast<unsigned int>(atoi(optarg));
+            bValid = bValid && pOption->iSize > 0
+                && pOption->iSize <= DMD_BENCH_MAX_DATAGRAM;
+            break;
+        case 'h':
+        default:
+            return false;
+        }
+    }
+    return bValid && optind == argc;
+}
+
+// counts what arrives, touching the first byte as a consumer would;
+class CDmdBenchCounter : public IDmdDatagramSink {
+public:
+    CDmdBenchCounter() : m_ulCount(0), m_iChecksum(0) {}
+
+    void OnDatagrams(const DmdDatagram *pDatagrams, unsigned int iCount) {
+        for (unsigned int i = 0; i < iCount; i++) {
+            m_iChecksum += pDatagrams[i].ulSize ? pDatagrams[i].pData[0] : 0;
+        }
+        m_ulCount += iCount;
+    }
+    uint64_t GetCount() const {return m_ulCount;}
+
+private:
+    uint64_t    m_ulCount;
+    uint8_t     m_iChecksum;
+};
+
+// sendmmsg() batches to every iSenders-th stream, from iFirst, until
+// stopped;
+static void sendRoutine(const std::vector<struct sockaddr_storage> *pAddrs,
+        unsigned int iFirst, unsigned int iSenders, unsigned int iSize,
+        std::atomic<bool> *pbRunning, std::atomic<uint64_t> *pulSent) {
+    struct sockaddr_storage addr;
+    int iSocket = DmdOpenUdpSocket("127.0.0.1", 0, &addr);
+    if (iSocket < 0) {
+        return;
+    }
+    std::vector<uint8_t> vecPayload(iSize, 0x5a);
+    struct iovec iov = {&vecPayload[0], vecPayload.size()};
+    struct mmsghdr arrMsgs[DMD_UDP_RECV_MAX_BATCH];
+    memset(arrMsgs, 0, sizeof(arrMsgs));
+    for (unsigned int i = 0; i < DMD_UDP_RECV_MAX_BATCH; i++) {
+        arrMsgs[i].msg_hdr.msg_iov = &iov;
+        arrMsgs[i].msg_hdr.msg_iovlen = 1;
+        arrMsgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    unsigned int iNext = iFirst;
+    uint64_t ulSent = 0;
+    while (pbRunning->load(std::memory_order_relaxed)) {
+        for (unsigned int i = 0; i < DMD_UDP_RECV_MAX_BATCH; i++) {
+            arrMsgs[i].msg_hdr.msg_name =
+                const_cast<struct sockaddr_storage *>(&(*pAddrs)[iNext]);
+            iNext += iSenders;
+            if (iNext >= pAddrs->size()) {
+                iNext = iFirst;
+            }
+        }
+        int iCount = sendmmsg(iSocket, arrMsgs, DMD_UDP_RECV_MAX_BATCH, 0);
+        if (iCount > 0) {
+            ulSent += iCount;
+        }
+    }
+    pulSent->fetch_add(ulSent);
+    close(iSocket);
+}
+
+static DMD_RESULT runBackend(const DmdBenchOption &option,
+        DmdUdpRecvBackend eBackend, DmdBenchResult *pResult) {
+    CDmdBenchCounter counter;
+    CDmdUdpReceiver receiver;
+    DmdUdpReceiverParam param;
+    memset(&param, 0, sizeof(param));
+    param.eBackend = eBackend;
+    param.iReceiveBufferBytes = 1024 * 1024;
+    if (DMD_S_OK != receiver.Init(param, &counter)) {
+        return DMD_S_FAIL;
+    }
+    std::vector<int> vecSockets;
+    std::vector<struct sockaddr_storage> vecAddrs(option.iStreams);
+    DMD_RESULT ret = DMD_S_OK;
+    for (unsigned int i = 0; i < option.iStreams && DMD_S_OK == ret; i++) {
+        int iSocket = DmdOpenUdpSocket("127.0.0.1", 0, &vecAddrs[i]);
+        if (iSocket < 0) {
+            ret = DMD_S_FAIL;
+            break;
+        }
+        vecSockets.push_back(iSocket);
+        ret = receiver.AddSocket(iSocket, i);
+    }
+
+    if (DMD_S_OK == ret) {
+        std::atomic<bool> bRunning(true);
+        std::atomic<uint64_t> ulSent(0);
+        std::vector<std::thread> vecSenders;
+        for (unsigned int i = 0; i < option.iSenders; i++) {
+            vecSenders.push_back(std::thread(sendRoutine, &vecAddrs, i,
+                        option.iSenders, option.iSize, &bRunning, &ulSent));
+        }
+        uint64_t ulStartUs = DmdGetTickCountUs();
+        uint64_t ulEndUs = ulStartUs + option.iDurationMs * 1000ULL;
+        while (DMD_S_OK == ret && DmdGetTickCountUs() < ulEndUs) {
+            ret = receiver.Poll(10);
+        }
+        uint64_t ulWallUs = DmdGetTickCountUs() - ulStartUs;
+        bRunning = false;
+        for (size_t i = 0; i < vecSenders.size(); i++) {
+            vecSenders[i].join();
+        }
+
+        DmdUdpReceiverStats stats;
+        receiver.GetStats(&stats);
+        pResult->eBackend = receiver.GetBackend();
+        pResult->ulSentCount = ulSent.load();
+        pResult->ulDatagramCount = counter.GetCount();
+        pResult->fKpps = ulWallUs ? 1000.0 * pResult->ulDatagramCount
+            / ulWallUs : 0.0;
+        pResult->fKppsPerCore = stats.ulRecvCpuUs ? 1000.0
+            * pResult->ulDatagramCount / stats.ulRecvCpuUs : 0.0;
+        pResult->fSyscallsPerKpkt = pResult->ulDatagramCount ? 1000.0
+            * stats.ulSyscallCount / pResult->ulDatagramCount : 0.0;
+        pResult->fCpuPercent = ulWallUs ? 100.0 * stats.ulRecvCpuUs
+            / ulWallUs : 0.0;
+    }
+    receiver.Uninit();
+    for (size_t i = 0; i < vecSockets.size(); i++) {
+        close(vecSockets[i]);
+    }
+    return ret;
+}
+
+static void printResult(const DmdBenchOption &option, bool bFirst,
+        const DmdBenchResult &result) {
+    if (option.bJson) {
+        fprintf(stdout, "%s  {\"recv\": \"%s\", \"streams\": %u, "
+                "\"size\": %u, \"sent\": %llu, \"received\": %llu, "
+                "\"kpps\": %.1f, \"kpps_per_core\": %.1f, "
+                "\"syscalls_per_kpkt\": %.2f, \"cpu_percent\": %.1f}",
+                bFirst ? "" : ",\n", s_arrBackend[result.eBackend],
+                option.iStreams, option.iSize,
+                static_cast<unsigned long long>(result.ulSentCount),
+                static_cast<unsigned long long>(result.ulDatagramCount),
+                result.fKpps, result.fKppsPerCore, result.fSyscallsPerKpkt,
+                result.fCpuPercent);
+        return;
+    }
+    if (bFirst) {
+        fprintf(stdout, "recv,streams,size,sent,received,kpps,kpps_per_core,"
+                "syscalls_per_kpkt,cpu_percent\n");
+    }
+    fprintf(stdout, "%s,%u,%u,%llu,%llu,%.1f,%.1f,%.2f,%.1f\n",
+            s_arrBackend[result.eBackend], option.iStreams, option.iSize,
+            static_cast<unsigned long long>(result.ulSentCount),
+            static_cast<unsigned long long>(result.ulDatagramCount),
+            result.fKpps, result.fKppsPerCore, result.fSyscallsPerKpkt,
+            result.fCpuPercent);
+}
+
+int main(int argc, char *argv[]) {
+    DmdBenchOption option;
+    if (!parseOption(argc, argv, &option)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    bool bFirst = true;
+    bool bFailed = false;
+    if (option.bJson) {
+        fprintf(stdout, "[\n");
+    }
+    for (size_t b = 0; b < option.vecBackend.size(); b++) {
+        DmdBenchResult result;
+        memset(&result, 0, sizeof(result));
+        if (DMD_S_OK != runBackend(option,
+                    static_cast<DmdUdpRecvBackend>(option.vecBackend[b]),
+                    &result)) {
+            fprintf(stderr, "failed to receive with %s\n",
+                    s_arrBackend[option.vecBackend[b]]);
+            bFailed = true;
+            continue;
+        }
+        printResult(option, bFirst, result);
+        bFirst = false;
+        fflush(stdout);
+    }
+    if (option.bJson) {
+        fprintf(stdout, "%s]\n", bFirst ? "" : "\n");
+    }
+
+    return bFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -47,6 +47,7 @@
 #include "IDmdDatatype.h"
 #include "IDmdCaptureEngine.h"
 #include "CDmdCaptureEngine.h"
+#include "DmdTimeUtils.h"
 
 namespace opendmd {
 
@@ -56,22 +57,29 @@ bool g_bCaptureThreadRunning = true;
 void *CaptureThreadRoutine(void *param) {
     DMD_LOG_INFO("At the beginning of capture thread function");
 
-    IDmdCaptureEngine *pVideoCapEngine =
-        reinterpret_cast<IDmdCaptureEngine*>(param);
+    DmdCaptureThreadParam *pThreadParam =
+        reinterpret_cast<DmdCaptureThreadParam*>(param);
+    IDmdCaptureEngine *pVideoCapEngine = pThreadParam->pCaptureEngine;
+    DmdStartup *pStartup = pThreadParam->pStartup;
 
     // set thread name;
     DmdThreadSetName("capture");
 
     DmdCaptureVideoFormat capVideoFormat = {DmdUnknown, 0, 0, 0, {0}};
     capVideoFormat.eVideoType = DmdI420;
-    capVideoFormat.iWidth = 1280;
-    capVideoFormat.iHeight = 720;
-    capVideoFormat.fFrameRate = 30.0f;
+    capVideoFormat.iWidth = DMD_CAPTURE_DEFAULT_WIDTH;
+    capVideoFormat.iHeight = DMD_CAPTURE_DEFAULT_HEIGHT;
+    capVideoFormat.fFrameRate = DMD_CAPTURE_DEFAULT_FRAMERATE;
 
+    uint64_t ulProbeStart = DmdGetTickCountUs();
     char *pDeviceName = GetDeviceName();
     if (NULL == pDeviceName) {
         DMD_LOG_ERROR("CaptureThreadRoutine(), "
                 << "could not get capture device name");
+        if (pStartup) {
+            pStartup->AddPhase("capture probe", ulProbeStart,
+                    DmdGetTickCountUs(), false);
+        }
         return NULL;
     }
 
@@ -79,8 +87,17 @@ void *CaptureThreadRoutine(void *param) {
             << "Get video device name = " << pDeviceName);
     strncpy(capVideoFormat.sVideoDevice, pDeviceName, strlen(pDeviceName));
 
-    pVideoCapEngine->Init(capVideoFormat);
-    pVideoCapEngine->StartCapture();
+    DMD_RESULT ret = pVideoCapEngine->Init(capVideoFormat);
+    uint64_t ulStreamStart = DmdGetTickCountUs();
+    if (pStartup) {
+        pStartup->AddPhase("capture probe", ulProbeStart, ulStreamStart,
+                DMD_S_OK == ret);
+    }
+    ret = pVideoCapEngine->StartCapture();
+    if (pStartup) {
+        pStartup->AddPhase("capture streamon", ulStreamStart,
+                DmdGetTickCountUs(), DMD_S_OK == ret);
+    }
     pVideoCapEngine->RunCaptureLoop();
     pVideoCapEngine->StopCapture();
     pVideoCapEngine->Uninit();
@@ -39,7 +39,22 @@
 #ifndef SRC_CAPTURE_CDMDCAPTURETHREAD_H
 #define SRC_CAPTURE_CDMDCAPTURETHREAD_H
 
+#include "IDmdCaptureEngine.h"
+#include "DmdStartup.h"
+
 namespace opendmd {
+
+#define DMD_CAPTURE_DEFAULT_WIDTH     1280
+#define DMD_CAPTURE_DEFAULT_HEIGHT    720
+#define DMD_CAPTURE_DEFAULT_FRAMERATE 30.0f
+
+// the camera is probed and started on its own capture thread, so cameras
+// open concurrently, and frames flow as soon as each one streams;
+typedef struct {
+    IDmdCaptureEngine *pCaptureEngine;
+    DmdStartup        *pStartup;  // receives the open phases, may be NULL;
+} DmdCaptureThreadParam;
+
 // for thread management;
 extern bool g_bCaptureThreadRunning;
 
@@ -67,10 +67,8 @@ const char *dmdVideoType[] = {
 };
 
 CDmdCaptureEngineLinux::CDmdCaptureEngineLinux() : m_pV4L2Impl(NULL),
-        m_bStartCapture(false) {
+        m_bStartCapture(false), m_pDataSink(NULL) {
     memset(&m_capVideoFormat, 0, sizeof(m_capVideoFormat));
-    m_pVideoRawData = new DmdVideoRawData();
-    memset(m_pVideoRawData, 0, sizeof(DmdVideoRawData));
 }
 
 CDmdCaptureEngineLinux::~CDmdCaptureEngineLinux() {
@@ -78,10 +76,6 @@ CDmdCaptureEngineLinux::~CDmdCaptureEngineLinux() {
         delete m_pV4L2Impl;
         m_pV4L2Impl = NULL;
     }
-    if (m_pVideoRawData) {
-        delete [] m_pVideoRawData->pSrcData;
-        delete m_pVideoRawData;
-    }
 }
 
 DMD_RESULT CDmdCaptureEngineLinux::Init(const DmdCaptureVideoFormat
@@ -119,6 +113,12 @@ DMD_RESULT CDmdCaptureEngineLinux::Uninit() {
     return DMD_S_OK;
 }
 
+DMD_RESULT CDmdCaptureEngineLinux::SetDataSink(
+        IDmdCaptureEngineSink *pDataSink) {
+    m_pDataSink = pDataSink;
+    return DMD_S_OK;
+}
+
 DMD_RESULT CDmdCaptureEngineLinux::StartCapture() {
     if (!m_pV4L2Impl) {
         DMD_LOG_ERROR("CDmdCaptureEngineLinux::StartCapture(), "
@@ -161,22 +161,13 @@ DMD_RESULT CDmdCaptureEngineLinux::StopCapture() {
 
 DMD_RESULT CDmdCaptureEngineLinux::DeliverVideoData(
         DmdVideoRawData *pVideoRawData) {
-    m_pVideoRawData->fmtVideoFormat = pVideoRawData->fmtVideoFormat;
-    if (m_pVideoRawData->pSrcData) {
-        delete [] m_pVideoRawData->pSrcData;
-        m_pVideoRawData->pSrcData = NULL;
+    // the frame points to mmaped v4l2 buffer, which is only valid during
+    // this call, downstream sink should consume or copy it before return.
+    if (NULL == m_pDataSink) {
+        return DMD_S_OK;
     }
-    m_pVideoRawData->ulDataLen = pVideoRawData->ulDataLen;
-    m_pVideoRawData->pSrcData = new uint8_t[m_pVideoRawData->ulDataLen];
-    if (m_pVideoRawData->pSrcData == NULL) {
-        DMD_LOG_ERROR("CDmdCaptureEngineLinux::StopCapture(), "
-                << "failed to allocate memory for VideoRawData");
-        return DMD_S_FAIL;
-    }
-    memcpy(m_pVideoRawData->pSrcData, pVideoRawData->pSrcData,
-            m_pVideoRawData->ulDataLen);
 
-    return DMD_S_OK;
+    return m_pDataSink->DeliverVideoData(pVideoRawData);
 }
 
 
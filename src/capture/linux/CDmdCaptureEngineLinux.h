@@ -56,6 +56,8 @@ public:
     DMD_RESULT Init(const DmdCaptureVideoFormat &capVideoFormat);
     DMD_RESULT Uninit();
 
+    DMD_RESULT SetDataSink(IDmdCaptureEngineSink *pDataSink);
+
     DMD_RESULT StartCapture();
     DMD_BOOL   IsCapturing();
     DMD_RESULT RunCaptureLoop();
@@ -68,7 +70,7 @@ private:
     DmdCaptureVideoFormat m_capVideoFormat;
     CDmdV4L2Impl         *m_pV4L2Impl;
     bool                  m_bStartCapture;
-    DmdVideoRawData      *m_pVideoRawData;
+    IDmdCaptureEngineSink *m_pDataSink;
 };
 
 }  // namespace opendmd
@@ -214,14 +214,47 @@ DMD_RESULT CDmdV4L2Impl::StopCapture() {
  * } DmdVideoRawData;
 */
 DMD_RESULT CDmdV4L2Impl::_deliverRawData(uint8_t *data, int length,
-            int width, int height) {
+            const struct timeval &timestamp) {
     DMD_RESULT ret = DMD_S_OK;
-    m_videoRawData.fmtVideoFormat.eVideoType = DmdYUYV;
+    struct v4l2_pix_format &pix = m_v4l2Param.fmt.fmt.pix;
+    unsigned int width = pix.width;
+    unsigned int height = pix.height;
+    size_t stride = pix.bytesperline;
+
+    memset(&m_videoRawData, 0, sizeof(m_videoRawData));
+    m_videoRawData.fmtVideoFormat.eVideoType =
+        v4l2PixelFormatToDmdVideoType(pix.pixelformat);
     m_videoRawData.fmtVideoFormat.iWidth = width;
     m_videoRawData.fmtVideoFormat.iHeight = height;
+    m_videoRawData.fmtVideoFormat.fFrameRate = m_videoFormat.fFrameRate;
+    m_videoRawData.fmtVideoFormat.ulTimestamp =
+        timestamp.tv_sec * 1000000ULL + timestamp.tv_usec;
     m_videoRawData.ulDataLen = length;
     m_videoRawData.pSrcData = data;
 
+    // describe planes of the single-planar buffer;
+    m_videoRawData.pSrcDataPanel[0] = data;
+    m_videoRawData.ulSrcDataStride[0] = stride;
+    m_videoRawData.ulPlaneCount = 1;
+    switch (m_videoRawData.fmtVideoFormat.eVideoType) {
+        case DmdI420:
+            m_videoRawData.pSrcDataPanel[1] = data + stride * height;
+            m_videoRawData.pSrcDataPanel[2] = m_videoRawData.pSrcDataPanel[1]
+                + (stride / 2) * ((height + 1) / 2);
+            m_videoRawData.ulSrcDataStride[1] = stride / 2;
+            m_videoRawData.ulSrcDataStride[2] = stride / 2;
+            m_videoRawData.ulPlaneCount = 3;
+            break;
+        case DmdNV12:
+        case DmdNV21:
+            m_videoRawData.pSrcDataPanel[1] = data + stride * height;
+            m_videoRawData.ulSrcDataStride[1] = stride;
+            m_videoRawData.ulPlaneCount = 2;
+            break;
+        default:
+            break;
+    }
+
     m_pDataSink->DeliverVideoData(&m_videoRawData);
 
     return ret;
@@ -285,7 +318,7 @@ DMD_RESULT CDmdV4L2Impl::RunCaptureLoop() {
                 << ", width:" << width << ", height:" << height
                 << ", length:" << buffers[buf.index].length);
         _deliverRawData(reinterpret_cast<uint8_t*>(buffers[buf.index].start),
-                buffers[buf.index].length, width, height);
+                buf.bytesused, buf.timestamp);
 
         // step 4, put request buffer back to queue
         if (-1 == v4l2IOCTL(fd, VIDIOC_QBUF, &buf)) {
@@ -86,7 +86,7 @@ public:
 
 private:
     DMD_RESULT _deliverRawData(uint8_t *data, int length,
-            int width, int heigth);
+            const struct timeval &timestamp);
 
 private:
     DMD_RESULT _v4l2OpenCaptureDevice();
@@ -431,6 +431,35 @@ uint32_t v4l2DmdVideoTypeToPixelFormat(DmdVideoType videoType) {
     return pixelFormat;
 }
 
+DmdVideoType v4l2PixelFormatToDmdVideoType(uint32_t pixelFormat) {
+    switch (pixelFormat) {
+        // YUV color space;
+        case V4L2_PIX_FMT_YUV420:
+            return DmdI420;
+        case V4L2_PIX_FMT_YUYV:
+            return DmdYUYV;
+        case V4L2_PIX_FMT_UYVY:
+            return DmdUYVY;
+        case V4L2_PIX_FMT_NV12:
+            return DmdNV12;
+        case V4L2_PIX_FMT_NV21:
+            return DmdNV21;
+
+        // RGB color space;
+        case V4L2_PIX_FMT_RGB24:
+            return DmdRGB24;
+        case V4L2_PIX_FMT_BGR24:
+            return DmdBGR24;
+        case V4L2_PIX_FMT_RGB32:
+            return DmdRGBA32;
+        case V4L2_PIX_FMT_BGR32:
+            return DmdBGRA32;
+
+        default:
+            return DmdUnknown;  // unsupported pixel format;
+    }
+}
+
 /*
  *  Flags for 'capability' and 'capturemode' fields
  *  #define V4L2_MODE_HIGHQUALITY 0x0001  //  High quality imaging mode
@@ -58,6 +58,7 @@ string v4l2PixFmtToString(uint32_t pixfmt);
 string v4l2FieldToString(uint32_t field);
 
 uint32_t v4l2DmdVideoTypeToPixelFormat(DmdVideoType videoType);
+DmdVideoType v4l2PixelFormatToDmdVideoType(uint32_t pixelFormat);
 string v4l2StreamParamToString(uint32_t streamparam);
 }  // namespace opendmd
 
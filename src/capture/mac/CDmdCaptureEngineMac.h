@@ -60,6 +60,8 @@ public:
     DMD_RESULT Init(const DmdCaptureVideoFormat &capVideoFormat);
     DMD_RESULT Uninit();
 
+    DMD_RESULT SetDataSink(IDmdCaptureEngineSink *pDataSink);
+
     DMD_RESULT StartCapture();
     DMD_BOOL   IsCapturing();
     DMD_RESULT RunCaptureLoop();
@@ -81,6 +83,7 @@ private:
     DmdCaptureVideoFormat m_capVideoFormat;
     MacCaptureSessionFormat m_capSessionFormat;
     DmdVideoRawData *m_pVideoRawData;
+    IDmdCaptureEngineSink *m_pDataSink;
 };
 
 DMD_RESULT CVImageBuffer2VideoRawPacket(
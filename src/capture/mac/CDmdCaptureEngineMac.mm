@@ -74,10 +74,11 @@ const char *dmdVideoType[] = {
     "DmdBGRA32",
 };
 
-CDmdCaptureEngineMac::CDmdCaptureEngineMac() : m_pVideoCapSession(nil) {
+CDmdCaptureEngineMac::CDmdCaptureEngineMac() : m_pVideoCapSession(nil),
+        m_pDataSink(NULL) {
     memset(&m_capVideoFormat, 0, sizeof(m_capVideoFormat));
     memset(&m_capSessionFormat, 0, sizeof(m_capSessionFormat));
-    m_pVideoRawData = new DmdVideoRawData;
+    m_pVideoRawData = new DmdVideoRawData();
 }
 
 CDmdCaptureEngineMac::~CDmdCaptureEngineMac() {
@@ -320,6 +321,12 @@ DMD_RESULT CDmdCaptureEngineMac::Uninit() {
     return DMD_S_OK;
 }
 
+DMD_RESULT CDmdCaptureEngineMac::SetDataSink(
+        IDmdCaptureEngineSink *pDataSink) {
+    m_pDataSink = pDataSink;
+    return DMD_S_OK;
+}
+
 DMD_RESULT CDmdCaptureEngineMac::StartCapture() {
     if (YES == [m_pVideoCapSession isRunning]) {
         DMD_LOG_ERROR("CDmdCaptureEngineMac::StartCapture(), "
@@ -345,8 +352,6 @@ DMD_RESULT CDmdCaptureEngineMac::RunCaptureLoop() {
         sleep(1);
         DMD_LOG_INFO("CDmdCaptureEngineMac::RunCaptureLoop(), "
                      << "capture thread is running");
-        // TODO(weizhenwei): push m_pVideoRawData to upper module;
-
     }
 
     return DMD_S_OK;
@@ -365,6 +370,10 @@ DMD_RESULT CDmdCaptureEngineMac::DeliverVideoData(
         if (DMD_S_OK == CVImageBuffer2VideoRawPacket(imageBuffer, *m_pVideoRawData)) {
             DMD_LOG_INFO("CDmdCaptureEngineMac::DeliverVideoData(), "
                          << "got a frame of raw data");
+            // pixel buffer is only locked during this call;
+            if (m_pDataSink) {
+                m_pDataSink->DeliverVideoData(m_pVideoRawData);
+            }
         }
         CVPixelBufferUnlockBaseAddress(imageBuffer, 0);
     }
@@ -380,18 +389,21 @@ DMD_RESULT CVImageBuffer2VideoRawPacket(CVImageBufferRef imageBuffer,
     packet.fmtVideoFormat.iWidth = CVPixelBufferGetWidth(imageBuffer);
     packet.fmtVideoFormat.iHeight = CVPixelBufferGetHeight(imageBuffer);
     packet.fmtVideoFormat.fFrameRate = 0;
-    packet.fmtVideoFormat.ulTimestamp = [[NSDate date] timeIntervalSince1970];
+    packet.fmtVideoFormat.ulTimestamp =
+        [[NSDate date] timeIntervalSince1970] * 1000000;
     packet.ulPlaneCount = CVPixelBufferGetPlaneCount(imageBuffer);
     if (kCVPixelFormatType_422YpCbCr8_yuvs == pixelFormat) {
         packet.fmtVideoFormat.eVideoType = DmdYUYV;
         packet.pSrcDataPanel[0] =
             (unsigned char *)CVPixelBufferGetBaseAddress(imageBuffer);
+        packet.ulSrcDataStride[0] = CVPixelBufferGetBytesPerRow(imageBuffer);
         packet.ulDataLen = CVPixelBufferGetBytesPerRow(imageBuffer)
             * packet.fmtVideoFormat.iHeight;
     } else if (kCVPixelFormatType_422YpCbCr8 == pixelFormat) {
         packet.fmtVideoFormat.eVideoType = DmdUYVY;
         packet.pSrcDataPanel[0] =
             (unsigned char *)CVPixelBufferGetBaseAddress(imageBuffer);
+        packet.ulSrcDataStride[0] = CVPixelBufferGetBytesPerRow(imageBuffer);
         packet.ulDataLen = CVPixelBufferGetBytesPerRow(imageBuffer)
             * packet.fmtVideoFormat.iHeight;
     } else if (kCVPixelFormatType_420YpCbCr8BiPlanarVideoRange
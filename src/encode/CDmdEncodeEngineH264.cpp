@@ -0,0 +1,572 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeEngineH264.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdEncodeEngineH264.cpp
+ ============================================================================
+ */
+
+#include "CDmdEncodeEngineH264.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+#include "CDmdEncodeEngine.h"
+
+namespace opendmd {
+
+static RC_MODES toOpenh264RcMode(DmdRateControlMode eRcMode) {
+    switch (eRcMode) {
+        case DmdRcQuality:
+            return RC_QUALITY_MODE;
+        case DmdRcBitrate:
+            return RC_BITRATE_MODE;
+        case DmdRcBufferBased:
+            return RC_BUFFERBASED_MODE;
+        case DmdRcTimestamp:
+            return RC_TIMESTAMP_MODE;
+        case DmdRcOff:
+            return RC_OFF_MODE;
+        default:
+            return RC_BITRATE_MODE;
+    }
+}
+
+static ECOMPLEXITY_MODE toOpenh264Complexity(DmdComplexityMode eComplexity) {
+    switch (eComplexity) {
+        case DmdComplexityLow:
+            return LOW_COMPLEXITY;
+        case DmdComplexityHigh:
+            return HIGH_COMPLEXITY;
+        case DmdComplexityMedium:
+        default:
+            return MEDIUM_COMPLEXITY;
+    }
+}
+
+static DmdEncodedFrameType toDmdFrameType(EVideoFrameType eFrameType) {
+    switch (eFrameType) {
+        case videoFrameTypeIDR:
+            return DmdFrameIDR;
+        case videoFrameTypeI:
+            return DmdFrameI;
+        case videoFrameTypeP:
+            return DmdFrameP;
+        case videoFrameTypeSkip:
+            return DmdFrameSkip;
+        default:
+            return DmdFrameInvalid;
+    }
+}
+
+CDmdEncodeEngineH264::CDmdEncodeEngineH264() : m_pDataSink(NULL),
+        m_pEncoder(NULL), m_iEncodeWidth(0), m_iEncodeHeight(0),
+        m_pBitstreamPool(new DmdFramePool()), m_ulBitstreamCapacity(0),
+        m_bLtrRefresh(true), m_uiIdrPicId(0), m_iFrameNum(0) {
+    memset(&m_encodeParam, 0, sizeof(m_encodeParam));
+}
+
+CDmdEncodeEngineH264::~CDmdEncodeEngineH264() {
+    destroyEncoder();
+}
+
+DMD_RESULT CDmdEncodeEngineH264::Init(const DmdEncodeParam &encodeParam) {
+    DMD_LOG_INFO("CDmdEncodeEngineH264::Init()"
+            << ", resolution = " << encodeParam.iWidth
+            << "x" << encodeParam.iHeight
+            << ", frame rate = " << encodeParam.fFrameRate
+            << ", target bitrate = " << encodeParam.iTargetBitrate
+            << ", max bitrate = " << encodeParam.iMaxBitrate
+            << ", gop size = " << encodeParam.iGopSize
+            << ", rc mode = " << encodeParam.eRcMode
+            << ", complexity = " << encodeParam.eComplexity
+            << ", ltr = " << encodeParam.bEnableLtr);
+    m_encodeParam = encodeParam;
+    if (m_encodeParam.fFrameRate <= 0) {
+        m_encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+    }
+    if (m_encodeParam.bEnableLtr && 0 == m_encodeParam.iLtrMarkPeriod) {
+        m_encodeParam.iLtrMarkPeriod = DMD_ENCODE_DEFAULT_LTR_PERIOD;
+    }
+    m_bLtrRefresh = true;
+
+    if (encodeParam.iWidth && encodeParam.iHeight) {
+        return createEncoder(encodeParam.iWidth, encodeParam.iHeight);
+    }
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::Uninit() {
+    destroyEncoder();
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::SetDataSink(
+        IDmdEncodeEngineSink *pDataSink) {
+    m_pDataSink = pDataSink;
+
+    return DMD_S_OK;
+}
+
+void CDmdEncodeEngineH264::fillEncoderParam(SEncParamExt *pParamExt,
+        unsigned int iWidth, unsigned int iHeight) {
+    m_pEncoder->GetDefaultParams(pParamExt);
+    pParamExt->iUsageType = CAMERA_VIDEO_REAL_TIME;
+    pParamExt->iPicWidth = iWidth;
+    pParamExt->iPicHeight = iHeight;
+    pParamExt->iTargetBitrate = m_encodeParam.iTargetBitrate;
+    pParamExt->iMaxBitrate = m_encodeParam.iMaxBitrate
+        ? m_encodeParam.iMaxBitrate : UNSPECIFIED_BIT_RATE;
+    pParamExt->iRCMode = toOpenh264RcMode(m_encodeParam.eRcMode);
+    pParamExt->fMaxFrameRate = m_encodeParam.fFrameRate;
+    pParamExt->iComplexityMode =
+        toOpenh264Complexity(m_encodeParam.eComplexity);
+    pParamExt->uiIntraPeriod = m_encodeParam.iGopSize;
+    pParamExt->iMultipleThreadIdc = m_encodeParam.iThreadCount;
+    pParamExt->bEnableFrameSkip = m_encodeParam.bEnableFrameSkip;
+    // sps/pps are repeated at every idr so a receiver can join anytime;
+    pParamExt->eSpsPpsIdStrategy = CONSTANT_ID;
+    // denoise runs in our preprocess stage already;
+    pParamExt->bEnableDenoise = false;
+    // marks are acknowledged by the engine, see acknowledgeLtrMarking();
+    if (m_encodeParam.bEnableLtr) {
+        pParamExt->bEnableLongTermReference = true;
+        pParamExt->iLTRRefNum = 1;
+        pParamExt->iLtrMarkPeriod = m_bLtrRefresh
+            ? m_encodeParam.iLtrMarkPeriod : DMD_LTR_FROZEN_MARK_PERIOD;
+        pParamExt->bIsLosslessLink = true;
+    }
+
+    // a second temporal layer costs some compression, so only if asked;
+    // the ltr profile keeps one layer, its p frames all chain to the marks;
+    if (m_encodeParam.bNonReferenceFrames && !m_encodeParam.bEnableLtr) {
+        pParamExt->iTemporalLayerNum = 2;
+    }
+    pParamExt->iSpatialLayerNum = 1;
+    SSpatialLayerConfig *pLayer = &pParamExt->sSpatialLayers[0];
+    pLayer->iVideoWidth = iWidth;
+    pLayer->iVideoHeight = iHeight;
+    pLayer->fFrameRate = m_encodeParam.fFrameRate;
+    pLayer->iSpatialBitrate = pParamExt->iTargetBitrate;
+    pLayer->iMaxSpatialBitrate = pParamExt->iMaxBitrate;
+    // fixed slice count lets the encoder threads work on one frame;
+    if (m_encodeParam.iSliceCount > 1) {
+        pLayer->sSliceArgument.uiSliceMode = SM_FIXEDSLCNUM_SLICE;
+        pLayer->sSliceArgument.uiSliceNum = m_encodeParam.iSliceCount;
+    }
+}
+
+DMD_RESULT CDmdEncodeEngineH264::createEncoder(unsigned int iWidth,
+        unsigned int iHeight) {
+    destroyEncoder();
+
+    int ret = WelsCreateSVCEncoder(&m_pEncoder);
+    if (0 != ret || NULL == m_pEncoder) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::createEncoder(), "
+                << "WelsCreateSVCEncoder failed, ret = " << ret);
+        m_pEncoder = NULL;
+        return DMD_S_FAIL;
+    }
+
+    SEncParamExt paramExt;
+    fillEncoderParam(&paramExt, iWidth, iHeight);
+    if (0 != (ret = m_pEncoder->InitializeExt(&paramExt))) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::createEncoder(), "
+                << "InitializeExt failed, ret = " << ret);
+        destroyEncoder();
+        return DMD_S_FAIL;
+    }
+
+    int iVideoFormat = videoFormatI420;
+    m_pEncoder->SetOption(ENCODER_OPTION_DATAFORMAT, &iVideoFormat);
+    m_iEncodeWidth = iWidth;
+    m_iEncodeHeight = iHeight;
+    m_uiIdrPicId = 0;
+    m_iFrameNum = 0;
+
+    DMD_LOG_INFO("CDmdEncodeEngineH264::createEncoder(), "
+            << "encoder created, " << iWidth << "x" << iHeight);
+    return DMD_S_OK;
+}
+
+void CDmdEncodeEngineH264::destroyEncoder() {
+    if (m_pEncoder) {
+        m_pEncoder->Uninitialize();
+        WelsDestroySVCEncoder(m_pEncoder);
+        m_pEncoder = NULL;
+    }
+    m_iEncodeWidth = 0;
+    m_iEncodeHeight = 0;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::EncodeFrame(
+        const DmdVideoRawData *pVideoRawData) {
+    if (NULL == pVideoRawData || NULL == pVideoRawData->pSrcDataPanel[0]) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::EncodeFrame(), "
+                << "invalid parameter");
+        return DMD_S_FAIL;
+    }
+    if (DmdI420 != pVideoRawData->fmtVideoFormat.eVideoType) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::EncodeFrame(), "
+                << "unsupported video type "
+                << pVideoRawData->fmtVideoFormat.eVideoType);
+        return DMD_S_FAIL;
+    }
+
+    unsigned int iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    if (NULL == m_pEncoder || iWidth != m_iEncodeWidth
+            || iHeight != m_iEncodeHeight) {
+        if (DMD_S_OK != createEncoder(iWidth, iHeight)) {
+            return DMD_S_FAIL;
+        }
+    }
+
+    SSourcePicture sourcePicture;
+    memset(&sourcePicture, 0, sizeof(sourcePicture));
+    sourcePicture.iColorFormat = videoFormatI420;
+    sourcePicture.iPicWidth = iWidth;
+    sourcePicture.iPicHeight = iHeight;
+    for (int i = 0; i < 3; i++) {
+        sourcePicture.pData[i] = pVideoRawData->pSrcDataPanel[i];
+        sourcePicture.iStride[i] =
+            static_cast<int>(pVideoRawData->ulSrcDataStride[i]);
+    }
+    sourcePicture.uiTimeStamp = static_cast<long long>(
+            pVideoRawData->fmtVideoFormat.ulTimestamp / 1000);
+
+    SFrameBSInfo frameBSInfo;
+    memset(&frameBSInfo, 0, sizeof(frameBSInfo));
+    int ret = m_pEncoder->EncodeFrame(&sourcePicture, &frameBSInfo);
+    if (cmResultSuccess != ret) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::EncodeFrame(), "
+                << "EncodeFrame failed, ret = " << ret);
+        return DMD_S_FAIL;
+    }
+
+    acknowledgeLtrMarking(frameBSInfo.eFrameType);
+
+    return deliverBitstream(frameBSInfo, pVideoRawData);
+}
+
+void CDmdEncodeEngineH264::acknowledgeLtrMarking(
+        EVideoFrameType eFrameType) {
+    // the encoder's idr_pic_id moves on after each idr, frame_num after
+    // each coded frame;
+    if (videoFrameTypeIDR == eFrameType) {
+        m_uiIdrPicId++;
+        m_iFrameNum = 0;
+    } else if (videoFrameTypeSkip != eFrameType
+            && videoFrameTypeInvalid != eFrameType) {
+        m_iFrameNum = (m_iFrameNum + 1) % DMD_H264_MAX_FRAME_NUM;
+    } else {
+        return;
+    }
+    if (!m_encodeParam.bEnableLtr) {
+        return;
+    }
+
+    // ignored by the encoder unless this frame was marked;
+    SLTRMarkingFeedback markingFeedback;
+    memset(&markingFeedback, 0, sizeof(markingFeedback));
+    markingFeedback.uiFeedbackType = LTR_MARKING_SUCCESS;
+    markingFeedback.uiIDRPicId = m_uiIdrPicId;
+    markingFeedback.iLTRFrameNum = m_iFrameNum;
+    m_pEncoder->SetOption(ENCODER_LTR_MARKING_FEEDBACK, &markingFeedback);
+}
+
+DMD_RESULT CDmdEncodeEngineH264::deliverBitstream(
+        const SFrameBSInfo &frameBSInfo,
+        const DmdVideoRawData *pVideoRawData) {
+    size_t ulTotalSize = 0;
+    unsigned int iNalCount = 0;
+    for (int i = 0; i < frameBSInfo.iLayerNum; i++) {
+        const SLayerBSInfo &layerInfo = frameBSInfo.sLayerInfo[i];
+        for (int j = 0; j < layerInfo.iNalCount; j++) {
+            ulTotalSize += layerInfo.pNalLengthInByte[j];
+        }
+        iNalCount += layerInfo.iNalCount;
+    }
+
+    DmdEncodedFrame encodedFrame;
+    memset(&encodedFrame, 0, sizeof(encodedFrame));
+    encodedFrame.eFrameType = toDmdFrameType(frameBSInfo.eFrameType);
+    encodedFrame.iWidth = m_iEncodeWidth;
+    encodedFrame.iHeight = m_iEncodeHeight;
+    encodedFrame.ulTimestamp = pVideoRawData->fmtVideoFormat.ulTimestamp;
+
+    DmdPooledFrame *pBitstream = NULL;
+    if (ulTotalSize) {
+        // iovec table first, the annex-b bytes right behind it; buffers
+        // are sized to the largest access unit seen, so that the pool
+        // does not churn between idr and p frame sizes;
+        size_t ulIovSize = iNalCount * sizeof(struct iovec);
+        size_t ulSize = ulIovSize + ulTotalSize;
+        if (ulSize > m_ulBitstreamCapacity) {
+            m_ulBitstreamCapacity = (ulSize + DMD_BITSTREAM_ALIGN - 1)
+                & ~static_cast<size_t>(DMD_BITSTREAM_ALIGN - 1);
+        }
+        pBitstream = m_pBitstreamPool->Acquire(m_ulBitstreamCapacity);
+        if (NULL == pBitstream) {
+            return DMD_S_FAIL;
+        }
+        struct iovec *pNalIov =
+            reinterpret_cast<struct iovec *>(pBitstream->GetData());
+        uint8_t *pData = pBitstream->GetData() + ulIovSize;
+
+        // layers are laid out back to back, the only copy of the output;
+        size_t ulOffset = 0;
+        unsigned int iNal = 0;
+        for (int i = 0; i < frameBSInfo.iLayerNum; i++) {
+            const SLayerBSInfo &layerInfo = frameBSInfo.sLayerInfo[i];
+            size_t ulLayerOffset = 0;
+            for (int j = 0; j < layerInfo.iNalCount; j++) {
+                size_t ulNalLen = layerInfo.pNalLengthInByte[j];
+                const uint8_t *pNal = layerInfo.pBsBuf + ulLayerOffset;
+                // each nal comes with a 3 or 4 byte start code;
+                size_t ulStartCode = ulNalLen > 3 && 0 == pNal[2] ? 4 : 3;
+                if (ulNalLen < ulStartCode) {
+                    ulStartCode = ulNalLen;
+                }
+                pNalIov[iNal].iov_base = pData + ulOffset + ulStartCode;
+                pNalIov[iNal].iov_len = ulNalLen - ulStartCode;
+                iNal++;
+                ulOffset += ulNalLen;
+                ulLayerOffset += ulNalLen;
+            }
+            memcpy(pData + ulOffset - ulLayerOffset, layerInfo.pBsBuf,
+                    ulLayerOffset);
+        }
+
+        encodedFrame.pData = pData;
+        encodedFrame.ulDataLen = ulTotalSize;
+        encodedFrame.iNalCount = iNalCount;
+        encodedFrame.pNalIov = pNalIov;
+        encodedFrame.pFrameBuffer = pBitstream;
+    }
+
+    // the sink takes its own reference to keep the output;
+    DMD_RESULT ret = DMD_S_OK;
+    if (m_pDataSink) {
+        ret = m_pDataSink->DeliverEncodedData(&encodedFrame);
+    }
+    if (pBitstream) {
+        pBitstream->Release();
+    }
+
+    return ret;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::Prepare(unsigned int iWidth,
+        unsigned int iHeight) {
+    if (0 == iWidth || 0 == iHeight) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::Prepare(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    if (NULL == m_pEncoder || iWidth != m_iEncodeWidth
+            || iHeight != m_iEncodeHeight) {
+        if (DMD_S_OK != createEncoder(iWidth, iHeight)) {
+            return DMD_S_FAIL;
+        }
+    }
+
+    size_t ulSize = static_cast<size_t>(iWidth) * iHeight * 3 / 2
+        / DMD_BITSTREAM_RESERVE_DIVISOR;
+    ulSize = (ulSize + DMD_BITSTREAM_ALIGN - 1)
+        & ~static_cast<size_t>(DMD_BITSTREAM_ALIGN - 1);
+    if (ulSize > m_ulBitstreamCapacity) {
+        m_ulBitstreamCapacity = ulSize;
+    }
+    return m_pBitstreamPool->Reserve(m_ulBitstreamCapacity,
+            DMD_BITSTREAM_RESERVE_COUNT);
+}
+
+DMD_RESULT CDmdEncodeEngineH264::ForceIntraFrame() {
+    if (NULL == m_pEncoder) {
+        // the first frame of a new encoder is an idr anyway;
+        return DMD_S_OK;
+    }
+
+    if (0 != m_pEncoder->ForceIntraFrame(true)) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::ForceIntraFrame(), "
+                << "ForceIntraFrame failed");
+        return DMD_S_FAIL;
+    }
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::SetRateControl(unsigned int iTargetBitrate,
+        float fFrameRate) {
+    if (0 == iTargetBitrate || fFrameRate <= 0) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::SetRateControl(), "
+                << "invalid bitrate " << iTargetBitrate
+                << " or frame rate " << fFrameRate);
+        return DMD_S_FAIL;
+    }
+
+    // kept for the next encoder re-creation as well;
+    m_encodeParam.iTargetBitrate = iTargetBitrate;
+    if (m_encodeParam.iMaxBitrate
+            && m_encodeParam.iMaxBitrate < iTargetBitrate) {
+        m_encodeParam.iMaxBitrate = iTargetBitrate;
+    }
+    m_encodeParam.fFrameRate = fFrameRate;
+    if (NULL == m_pEncoder) {
+        return DMD_S_OK;
+    }
+
+    int ret = 0;
+    SBitrateInfo bitrateInfo;
+    memset(&bitrateInfo, 0, sizeof(bitrateInfo));
+    bitrateInfo.iLayer = SPATIAL_LAYER_ALL;
+    if (m_encodeParam.iMaxBitrate) {
+        bitrateInfo.iBitrate = m_encodeParam.iMaxBitrate;
+        ret |= m_pEncoder->SetOption(ENCODER_OPTION_MAX_BITRATE, &bitrateInfo);
+    }
+    bitrateInfo.iBitrate = iTargetBitrate;
+    ret |= m_pEncoder->SetOption(ENCODER_OPTION_BITRATE, &bitrateInfo);
+    ret |= m_pEncoder->SetOption(ENCODER_OPTION_FRAME_RATE, &fFrameRate);
+    if (0 != ret) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::SetRateControl(), "
+                << "SetOption failed, ret = " << ret);
+        return DMD_S_FAIL;
+    }
+
+    DMD_LOG_INFO("CDmdEncodeEngineH264::SetRateControl(), "
+            << "target bitrate = " << iTargetBitrate
+            << ", frame rate = " << fFrameRate);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::SetComplexity(
+        DmdComplexityMode eComplexity) {
+    m_encodeParam.eComplexity = eComplexity;
+    if (NULL == m_pEncoder) {
+        return DMD_S_OK;
+    }
+
+    ECOMPLEXITY_MODE eMode = toOpenh264Complexity(eComplexity);
+    int ret = m_pEncoder->SetOption(ENCODER_OPTION_COMPLEXITY, &eMode);
+    if (0 != ret) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::SetComplexity(), "
+                << "SetOption failed, ret = " << ret);
+        return DMD_S_FAIL;
+    }
+
+    DMD_LOG_INFO("CDmdEncodeEngineH264::SetComplexity(), "
+            << "complexity = " << eComplexity);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::SetLtrRefresh(bool bRefresh) {
+    if (!m_encodeParam.bEnableLtr) {
+        return DMD_S_FAIL;
+    }
+    m_bLtrRefresh = bRefresh;
+    if (NULL == m_pEncoder) {
+        return DMD_S_OK;
+    }
+
+    int iPeriod = static_cast<int>(bRefresh ? m_encodeParam.iLtrMarkPeriod
+            : DMD_LTR_FROZEN_MARK_PERIOD);
+    int ret = m_pEncoder->SetOption(ENCODER_LTR_MARKING_PERIOD, &iPeriod);
+    if (0 != ret) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::SetLtrRefresh(), "
+                << "SetOption failed, ret = " << ret);
+        return DMD_S_FAIL;
+    }
+
+    DMD_LOG_INFO("CDmdEncodeEngineH264::SetLtrRefresh(), "
+            << "refresh = " << bRefresh);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeEngineH264::ForceLtrReference() {
+    if (!m_encodeParam.bEnableLtr) {
+        return DMD_S_FAIL;
+    }
+    if (NULL == m_pEncoder || 0 == m_iFrameNum) {
+        // nothing to recover from since the last idr;
+        return DMD_S_OK;
+    }
+
+    // as if a decoder had everything so far, so the next frame is coded
+    // against the long term reference;
+    SLTRRecoverRequest recoverRequest;
+    memset(&recoverRequest, 0, sizeof(recoverRequest));
+    recoverRequest.uiFeedbackType = LTR_RECOVERY_REQUEST;
+    recoverRequest.uiIDRPicId = m_uiIdrPicId;
+    recoverRequest.iLastCorrectFrameNum = m_iFrameNum;
+    recoverRequest.iCurrentFrameNum =
+        (m_iFrameNum + 1) % DMD_H264_MAX_FRAME_NUM;
+    int ret = m_pEncoder->SetOption(ENCODER_LTR_RECOVERY_REQUEST,
+            &recoverRequest);
+    if (0 != ret) {
+        DMD_LOG_ERROR("CDmdEncodeEngineH264::ForceLtrReference(), "
+                << "SetOption failed, ret = " << ret);
+        return DMD_S_FAIL;
+    }
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CreateVideoEncodeEngine(IDmdEncodeEngine **ppVideoEncEngine) {
+    if (NULL == ppVideoEncEngine) {
+        return DMD_S_FAIL;
+    }
+
+    CDmdEncodeEngineH264 *pH264VideoEncEngine = new CDmdEncodeEngineH264();
+    DMD_CHECK_NOTNULL(pH264VideoEncEngine);
+    *ppVideoEncEngine = pH264VideoEncEngine;
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT ReleaseVideoEncodeEngine(IDmdEncodeEngine **ppVideoEncEngine) {
+    if ((NULL == ppVideoEncEngine) || (NULL == *ppVideoEncEngine)) {
+        DMD_LOG_ERROR("ReleaseVideoEncodeEngine(), invalid videoEncEngine.");
+        return DMD_S_FAIL;
+    }
+
+    delete (*ppVideoEncEngine);
+    *ppVideoEncEngine = NULL;
+
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
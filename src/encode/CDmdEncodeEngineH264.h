@@ -0,0 +1,126 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeEngineH264.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdEncodeEngineH264.h
+ ============================================================================
+ */
+
+#ifndef SRC_ENCODE_CDMDENCODEENGINEH264_H
+#define SRC_ENCODE_CDMDENCODEENGINEH264_H
+
+#include <memory>
+
+#include "wels/codec_api.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "DmdFramePool.h"
+
+namespace opendmd {
+
+#define DMD_BITSTREAM_ALIGN 4096
+// reserved by Prepare(), a quarter of the raw frame holds an idr at the
+// bitrates used here;
+#define DMD_BITSTREAM_RESERVE_DIVISOR 4
+#define DMD_BITSTREAM_RESERVE_COUNT   2
+// marking period while ltr refresh is paused, never reached;
+#define DMD_LTR_FROZEN_MARK_PERIOD (1U << 30)
+// frame_num wraps here, openh264 writes log2_max_frame_num 15 to the sps;
+#define DMD_H264_MAX_FRAME_NUM     (1 << 15)
+
+/*
+ * H.264 encode engine on top of the vendored openh264 ISVCEncoder. The
+ * encoder is created lazily at the first frame when no resolution is
+ * configured, and re-created whenever the input resolution changes.
+ *
+ * Layer buffers of the encoder are copied once, into a pooled buffer that
+ * also carries the nal iovec table; consumers share that buffer by
+ * reference, and it returns to the pool when the last one releases it.
+ *
+ * There is no decoder feedback channel for long term references, so the
+ * engine acknowledges each coded frame itself, as a decoder on a lossless
+ * link would; openh264 only references a marked frame once acknowledged.
+ * Acknowledgements and recovery requests are built from the idr_pic_id
+ * and frame_num the encoder is known to write.
+ */
+class CDmdEncodeEngineH264 : public IDmdEncodeEngine {
+public:
+    CDmdEncodeEngineH264();
+    ~CDmdEncodeEngineH264();
+
+    DMD_RESULT Init(const DmdEncodeParam &encodeParam);
+    DMD_RESULT Uninit();
+
+    DMD_RESULT SetDataSink(IDmdEncodeEngineSink *pDataSink);
+    DMD_RESULT Prepare(unsigned int iWidth, unsigned int iHeight);
+
+    DMD_RESULT EncodeFrame(const DmdVideoRawData *pVideoRawData);
+    DMD_RESULT ForceIntraFrame();
+    DMD_RESULT SetRateControl(unsigned int iTargetBitrate, float fFrameRate);
+    DMD_RESULT SetComplexity(DmdComplexityMode eComplexity);
+    DMD_RESULT SetLtrRefresh(bool bRefresh);
+    DMD_RESULT ForceLtrReference();
+
+    // bitstream buffers allocated so far, flat in the steady state;
+    uint64_t GetBitstreamAllocCount() const {
+        return m_pBitstreamPool->GetAllocCount();
+    }
+
+private:
+    DMD_RESULT createEncoder(unsigned int iWidth, unsigned int iHeight);
+    void destroyEncoder();
+    void fillEncoderParam(SEncParamExt *pParamExt, unsigned int iWidth,
+            unsigned int iHeight);
+    DMD_RESULT deliverBitstream(const SFrameBSInfo &frameBSInfo,
+            const DmdVideoRawData *pVideoRawData);
+    void acknowledgeLtrMarking(EVideoFrameType eFrameType);
+
+private:
+    IDmdEncodeEngineSink   *m_pDataSink;
+    ISVCEncoder            *m_pEncoder;
+    DmdEncodeParam          m_encodeParam;
+    unsigned int            m_iEncodeWidth;
+    unsigned int            m_iEncodeHeight;
+    std::shared_ptr<DmdFramePool> m_pBitstreamPool;
+    size_t                  m_ulBitstreamCapacity;
+    // long term reference state, see ForceLtrReference();
+    bool                    m_bLtrRefresh;
+    uint16_t                m_uiIdrPicId;
+    int                     m_iFrameNum;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_ENCODE_CDMDENCODEENGINEH264_H
@@ -0,0 +1,344 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeScheduler.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdEncodeScheduler.cpp
+ ============================================================================
+ */
+
+#include "CDmdEncodeScheduler.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+#include "CDmdEncodeThread.h"
+
+namespace opendmd {
+
+// frames kept per frame offered, by degrade level;
+static const unsigned int s_iDegradeDecimation[DMD_ENCODE_DEGRADE_LEVEL_MAX
+    + 1] = {1, 1, 2, 3};
+
+CDmdEncodeScheduler::CDmdEncodeScheduler() : m_iWorkerCount(0),
+        m_iWindowMs(DMD_ENCODE_SCHEDULER_WINDOW_MS), m_bRunning(false),
+        m_iRunningWorkers(0), m_ulWindowStartUs(0), m_ulWindowBusyUs(0) {
+}
+
+CDmdEncodeScheduler::~CDmdEncodeScheduler() {
+    Uninit();
+}
+
+DMD_RESULT CDmdEncodeScheduler::Init(unsigned int iWorkerCount,
+        unsigned int iWindowMs) {
+    DMD_LOG_INFO("CDmdEncodeScheduler::Init(), workers = " << iWorkerCount
+            << ", window = " << iWindowMs << "ms");
+    if (0 == iWorkerCount || 0 == iWindowMs) {
+        DMD_LOG_ERROR("CDmdEncodeScheduler::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    m_iWorkerCount = iWorkerCount;
+    m_iWindowMs = iWindowMs;
+    m_ulWindowStartUs = 0;
+    m_ulWindowBusyUs = 0;
+    m_bRunning = true;
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeScheduler::Uninit() {
+    StopWorkers();
+
+    for (size_t i = 0; i < m_vecCameras.size(); i++) {
+        m_vecCameras[i]->pEncodeStage->SetListener(NULL);
+        delete m_vecCameras[i];
+    }
+    m_vecCameras.clear();
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeScheduler::AddCamera(CDmdEncodeStage *pEncodeStage,
+        unsigned int iPriority, unsigned int *pCameraId) {
+    if (NULL == pEncodeStage) {
+        return DMD_S_FAIL;
+    }
+
+    DmdEncodeCamera *pCamera = new DmdEncodeCamera;
+    if (NULL == pCamera) {
+        DMD_LOG_ERROR("CDmdEncodeScheduler::AddCamera(), "
+                << "failed to allocate camera");
+        return DMD_S_FAIL;
+    }
+    memset(pCamera, 0, sizeof(*pCamera));
+    pCamera->pEncodeStage = pEncodeStage;
+    pCamera->iPriority = iPriority;
+    pCamera->eComplexity = pEncodeStage->GetEncodeParam().eComplexity;
+
+    m_mtxSchedulerMutex.Lock();
+    m_vecCameras.push_back(pCamera);
+    unsigned int iCameraId = m_vecCameras.size() - 1;
+    m_mtxSchedulerMutex.Unlock();
+    pEncodeStage->SetListener(this);
+    if (pCameraId) {
+        *pCameraId = iCameraId;
+    }
+
+    DMD_LOG_INFO("CDmdEncodeScheduler::AddCamera(), camera " << iCameraId
+            << ", priority = " << iPriority);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeScheduler::AddWorkerThreads(
+        DmdThreadManager *pThreadManager) {
+    for (unsigned int i = 0; i < m_iWorkerCount; i++) {
+        if (DMD_S_OK != pThreadManager->addThread(DMD_THREAD_ENCODE,
+                    EncodeWorkerThreadRoutine, this, i)) {
+            return DMD_S_FAIL;
+        }
+    }
+
+    return DMD_S_OK;
+}
+
+void CDmdEncodeScheduler::StopWorkers() {
+    m_bRunning = false;
+
+    // workers poll every DMD_ENCODE_QUEUE_POLL_MS, do not wait forever
+    // for one that was never spawned;
+    m_mtxSchedulerMutex.Lock();
+    m_condFrameQueued.Broadcast();
+    for (int i = 0; m_iRunningWorkers && i < 10; i++) {
+        m_condWorkerExit.TimedWait(&m_mtxSchedulerMutex,
+                DMD_ENCODE_QUEUE_POLL_MS);
+    }
+    if (m_iRunningWorkers) {
+        DMD_LOG_ERROR("CDmdEncodeScheduler::StopWorkers(), "
+                << m_iRunningWorkers << " workers still running");
+    }
+    m_mtxSchedulerMutex.Unlock();
+}
+
+DMD_RESULT CDmdEncodeScheduler::GetCameraStats(unsigned int iCameraId,
+        DmdEncodeCameraStats *pStats) {
+    DMD_RESULT ret = DMD_S_FAIL;
+    m_mtxSchedulerMutex.Lock();
+    if (pStats && iCameraId < m_vecCameras.size()) {
+        *pStats = m_vecCameras[iCameraId]->stats;
+        ret = DMD_S_OK;
+    }
+    m_mtxSchedulerMutex.Unlock();
+
+    return ret;
+}
+
+void CDmdEncodeScheduler::OnFrameQueued(CDmdEncodeStage *pEncodeStage) {
+    m_mtxSchedulerMutex.Lock();
+    m_condFrameQueued.Signal();
+    m_mtxSchedulerMutex.Unlock();
+}
+
+DmdEncodeCamera *CDmdEncodeScheduler::pickCameraLocked() {
+    // earliest deadline first, the higher priority on a tie;
+    DmdEncodeCamera *pPicked = NULL;
+    uint64_t ulPickedDeadlineUs = 0;
+    for (size_t i = 0; i < m_vecCameras.size(); i++) {
+        DmdEncodeCamera *pCamera = m_vecCameras[i];
+        uint64_t ulQueuedUs = 0;
+        if (pCamera->bBusy
+                || !pCamera->pEncodeStage->PeekQueuedUs(&ulQueuedUs)) {
+            continue;
+        }
+        uint64_t ulDeadlineUs = ulQueuedUs
+            + pCamera->pEncodeStage->GetFrameIntervalUs();
+        if (NULL == pPicked || ulDeadlineUs < ulPickedDeadlineUs
+                || (ulDeadlineUs == ulPickedDeadlineUs
+                    && pCamera->iPriority > pPicked->iPriority)) {
+            pPicked = pCamera;
+            ulPickedDeadlineUs = ulDeadlineUs;
+        }
+    }
+
+    return pPicked;
+}
+
+bool CDmdEncodeScheduler::ScheduleOnce(unsigned int iTimeoutMs) {
+    m_mtxSchedulerMutex.Lock();
+    DmdEncodeCamera *pCamera = pickCameraLocked();
+    if (NULL == pCamera && iTimeoutMs && m_bRunning) {
+        m_condFrameQueued.TimedWait(&m_mtxSchedulerMutex, iTimeoutMs);
+        pCamera = pickCameraLocked();
+    }
+    if (NULL == pCamera) {
+        m_mtxSchedulerMutex.Unlock();
+        return false;
+    }
+    pCamera->bBusy = true;
+    m_mtxSchedulerMutex.Unlock();
+
+    uint64_t ulQueuedUs = 0;
+    uint64_t ulStartUs = DmdGetTickCountUs();
+    pCamera->pEncodeStage->EncodeQueuedFrame(0, &ulQueuedUs);
+    uint64_t ulFinishUs = DmdGetTickCountUs();
+
+    m_mtxSchedulerMutex.Lock();
+    pCamera->bBusy = false;
+    if (ulQueuedUs) {
+        finishFrameLocked(pCamera, ulQueuedUs, ulStartUs, ulFinishUs);
+    }
+    // the camera may have more frames queued for another worker;
+    m_condFrameQueued.Signal();
+    m_mtxSchedulerMutex.Unlock();
+
+    return 0 != ulQueuedUs;
+}
+
+DMD_RESULT CDmdEncodeScheduler::RunWorker() {
+    m_mtxSchedulerMutex.Lock();
+    m_iRunningWorkers++;
+    m_mtxSchedulerMutex.Unlock();
+
+    // g_bEncodeThreadRunning is defined at CDmdEncodeThread.cpp
+    // when SIGINT is send to openDMD, g_bEncodeThreadRunning = false;
+    while (g_bEncodeThreadRunning && m_bRunning) {
+        ScheduleOnce(DMD_ENCODE_QUEUE_POLL_MS);
+    }
+
+    m_mtxSchedulerMutex.Lock();
+    m_iRunningWorkers--;
+    m_condWorkerExit.Broadcast();
+    m_mtxSchedulerMutex.Unlock();
+
+    return DMD_S_OK;
+}
+
+void CDmdEncodeScheduler::finishFrameLocked(DmdEncodeCamera *pCamera,
+        uint64_t ulQueuedUs, uint64_t ulStartUs, uint64_t ulFinishUs) {
+    DmdEncodeCameraStats &stats = pCamera->stats;
+    uint64_t ulDeadlineUs = ulQueuedUs
+        + pCamera->pEncodeStage->GetFrameIntervalUs();
+    stats.ulScheduledCount++;
+    if (ulFinishUs > ulDeadlineUs) {
+        stats.ulDeadlineMissCount++;
+        pCamera->ulWindowMissCount++;
+        if (ulFinishUs - ulDeadlineUs > stats.ulMaxLatenessUs) {
+            stats.ulMaxLatenessUs = ulFinishUs - ulDeadlineUs;
+        }
+    }
+    m_ulWindowBusyUs += ulFinishUs - ulStartUs;
+
+    evaluateLocked(ulFinishUs);
+}
+
+void CDmdEncodeScheduler::evaluateLocked(uint64_t ulNowUs) {
+    if (0 == m_ulWindowStartUs) {
+        m_ulWindowStartUs = ulNowUs;
+        return;
+    }
+    uint64_t ulElapsedUs = ulNowUs - m_ulWindowStartUs;
+    if (ulElapsedUs < static_cast<uint64_t>(m_iWindowMs) * 1000) {
+        return;
+    }
+
+    bool bMissed = false;
+    unsigned int iMissPriority = 0;
+    for (size_t i = 0; i < m_vecCameras.size(); i++) {
+        if (m_vecCameras[i]->ulWindowMissCount) {
+            if (!bMissed || m_vecCameras[i]->iPriority > iMissPriority) {
+                iMissPriority = m_vecCameras[i]->iPriority;
+            }
+            bMissed = true;
+        }
+    }
+    uint64_t ulLoad = m_ulWindowBusyUs * 100 / (ulElapsedUs * m_iWorkerCount);
+
+    if (bMissed) {
+        // shed load from the least important camera first;
+        DmdEncodeCamera *pVictim = NULL;
+        for (size_t i = 0; i < m_vecCameras.size(); i++) {
+            DmdEncodeCamera *pCamera = m_vecCameras[i];
+            if (pCamera->stats.iDegradeLevel < DMD_ENCODE_DEGRADE_LEVEL_MAX
+                    && pCamera->iPriority <= iMissPriority
+                    && (NULL == pVictim
+                        || pCamera->iPriority < pVictim->iPriority)) {
+                pVictim = pCamera;
+            }
+        }
+        if (pVictim) {
+            setDegradeLevelLocked(pVictim,
+                    pVictim->stats.iDegradeLevel + 1);
+            pVictim->stats.ulDegradeCount++;
+        }
+    } else if (ulLoad < DMD_ENCODE_SCHEDULER_RESTORE_LOAD) {
+        DmdEncodeCamera *pRestored = NULL;
+        for (size_t i = 0; i < m_vecCameras.size(); i++) {
+            DmdEncodeCamera *pCamera = m_vecCameras[i];
+            if (pCamera->stats.iDegradeLevel
+                    && (NULL == pRestored
+                        || pCamera->iPriority > pRestored->iPriority)) {
+                pRestored = pCamera;
+            }
+        }
+        if (pRestored) {
+            setDegradeLevelLocked(pRestored,
+                    pRestored->stats.iDegradeLevel - 1);
+            pRestored->stats.ulRestoreCount++;
+        }
+    }
+
+    DMD_LOG_INFO("CDmdEncodeScheduler::evaluateLocked(), "
+            << "load:" << ulLoad << "%"
+            << ", deadline missed:" << bMissed
+            << ", miss priority:" << iMissPriority);
+    for (size_t i = 0; i < m_vecCameras.size(); i++) {
+        m_vecCameras[i]->ulWindowMissCount = 0;
+    }
+    m_ulWindowStartUs = ulNowUs;
+    m_ulWindowBusyUs = 0;
+}
+
+void CDmdEncodeScheduler::setDegradeLevelLocked(DmdEncodeCamera *pCamera,
+        unsigned int iLevel) {
+    DMD_LOG_INFO("CDmdEncodeScheduler::setDegradeLevelLocked(), "
+            << "priority " << pCamera->iPriority << " camera, level "
+            << pCamera->stats.iDegradeLevel << " -> " << iLevel);
+    pCamera->stats.iDegradeLevel = iLevel;
+    pCamera->pEncodeStage->SetComplexity(iLevel
+            ? DmdComplexityLow : pCamera->eComplexity);
+    pCamera->pEncodeStage->SetFrameDecimation(s_iDegradeDecimation[iLevel]);
+}
+
+}  // namespace opendmd
@@ -0,0 +1,142 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeScheduler.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdEncodeScheduler.h
+ ============================================================================
+ */
+
+#ifndef SRC_ENCODE_CDMDENCODESCHEDULER_H
+#define SRC_ENCODE_CDMDENCODESCHEDULER_H
+
+#include <atomic>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+
+#include "thread/DmdThreadCondition.h"
+#include "thread/DmdThreadManager.h"
+#include "thread/DmdThreadMutex.h"
+
+#include "CDmdEncodeStage.h"
+
+namespace opendmd {
+
+#define DMD_ENCODE_SCHEDULER_WINDOW_MS       1000
+#define DMD_ENCODE_SCHEDULER_RESTORE_LOAD    70  // percent of worker time;
+#define DMD_ENCODE_DEGRADE_LEVEL_MAX         3
+
+typedef struct {
+    uint64_t        ulScheduledCount;     // frames encoded by the workers;
+    uint64_t        ulDeadlineMissCount;  // finished after the deadline;
+    uint64_t        ulMaxLatenessUs;      // worst time past the deadline;
+    uint64_t        ulDegradeCount;
+    uint64_t        ulRestoreCount;
+    unsigned int    iDegradeLevel;        // 0 for full quality;
+} DmdEncodeCameraStats;
+
+typedef struct {
+    CDmdEncodeStage      *pEncodeStage;
+    unsigned int          iPriority;      // larger is more important;
+    DmdComplexityMode     eComplexity;    // as configured, restored to;
+    bool                  bBusy;          // a worker is encoding it;
+    uint64_t              ulWindowMissCount;
+    DmdEncodeCameraStats  stats;
+} DmdEncodeCamera;
+
+/*
+ * Shares a fixed number of encode workers among the cameras of a host,
+ * instead of one encode thread per camera. A frame is due one frame
+ * interval after capture delivered it; idle workers always take the
+ * camera whose oldest queued frame is due first, and a camera is encoded
+ * by one worker at a time.
+ *
+ * Once per window, if any camera missed a deadline, the lowest priority
+ * camera not above it is degraded one level: level 1 lowers the encoder
+ * complexity, levels 2 and 3 keep one of every 2 or 3 frames on top of
+ * that. When no camera missed and the workers have headroom, the highest
+ * priority degraded camera is restored one level.
+ */
+class CDmdEncodeScheduler : public IDmdEncodeStageListener {
+public:
+    CDmdEncodeScheduler();
+    ~CDmdEncodeScheduler();
+
+    DMD_RESULT Init(unsigned int iWorkerCount, unsigned int iWindowMs);
+    DMD_RESULT Uninit();
+
+    // before the workers run; the stage must be initialized;
+    DMD_RESULT AddCamera(CDmdEncodeStage *pEncodeStage,
+            unsigned int iPriority, unsigned int *pCameraId);
+    // add DMD_THREAD_ENCODE workers, spawned by the thread manager;
+    DMD_RESULT AddWorkerThreads(DmdThreadManager *pThreadManager);
+    // wait for the workers to leave RunWorker();
+    void StopWorkers();
+
+    DMD_RESULT GetCameraStats(unsigned int iCameraId,
+            DmdEncodeCameraStats *pStats);
+    unsigned int GetWorkerCount() const {return m_iWorkerCount;}
+
+    // worker side; ScheduleOnce() returns true if a frame was encoded;
+    DMD_RESULT RunWorker();
+    bool ScheduleOnce(unsigned int iTimeoutMs);
+
+    // IDmdEncodeStageListener interface, capture thread side;
+    void OnFrameQueued(CDmdEncodeStage *pEncodeStage);
+
+private:
+    DmdEncodeCamera *pickCameraLocked();
+    void finishFrameLocked(DmdEncodeCamera *pCamera, uint64_t ulQueuedUs,
+            uint64_t ulStartUs, uint64_t ulFinishUs);
+    void evaluateLocked(uint64_t ulNowUs);
+    void setDegradeLevelLocked(DmdEncodeCamera *pCamera,
+            unsigned int iLevel);
+
+private:
+    std::vector<DmdEncodeCamera *> m_vecCameras;
+    unsigned int           m_iWorkerCount;
+    unsigned int           m_iWindowMs;
+    std::atomic<bool>      m_bRunning;
+    unsigned int           m_iRunningWorkers;
+    uint64_t               m_ulWindowStartUs;
+    uint64_t               m_ulWindowBusyUs;
+    DmdThreadMutex         m_mtxSchedulerMutex;
+    DmdThreadCondition     m_condFrameQueued;
+    DmdThreadCondition     m_condWorkerExit;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_ENCODE_CDMDENCODESCHEDULER_H
@@ -0,0 +1,880 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeStage.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdEncodeStage.cpp
+ ============================================================================
+ */
+
+#include "CDmdEncodeStage.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+#include "CDmdColorConvert.h"
+#include "CDmdEncodeEngine.h"
+#include "CDmdEncodeThread.h"
+
+namespace opendmd {
+
+CDmdEncodeStage::CDmdEncodeStage() : m_pEncodeEngine(NULL),
+        m_pDataSink(NULL), m_pFreeQueue(NULL), m_pEncodeQueue(NULL),
+        m_pEncodingSlot(NULL), m_bForceIntra(false), m_iPendingComplexity(-1),
+        m_iDecimation(1), m_iDecimationCount(0), m_pListener(NULL),
+        m_pDetectEngine(NULL), m_bForceDetectIntra(false),
+        m_ulLastDetectKeptUs(0), m_eEncodingLayer(DmdLayerRecord),
+        m_bRatePending(false), m_iPendingBitrate(0), m_fPendingFrameRate(0),
+        m_ulMinFrameIntervalUs(0), m_ulLastKeptUs(0), m_iTargetBitrate(0),
+        m_fTargetFrameRate(0),
+        m_eGateMode(DmdGateActive), m_ulLastMotionUs(0), m_ulLastIdleKeptUs(0),
+        m_eEncodeGateMode(DmdGateActive), m_bEncodeMotion(false),
+        m_ulWindowStartUs(0),
+        m_ulWindowBytes(0), m_ulActiveFrameCount(0), m_ulActiveEncodeCpuUs(0),
+        m_ulActiveEncodedCount(0), m_ulActiveBytes(0) {
+    memset(&m_encodeParam, 0, sizeof(m_encodeParam));
+    memset(&m_gateParam, 0, sizeof(m_gateParam));
+    memset(&m_detectParam, 0, sizeof(m_detectParam));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdEncodeStage::~CDmdEncodeStage() {
+    Uninit();
+}
+
+DMD_RESULT CDmdEncodeStage::Init(const DmdEncodeParam &encodeParam,
+        unsigned int iQueueDepth) {
+    DMD_LOG_INFO("CDmdEncodeStage::Init(), queue depth = " << iQueueDepth);
+    if (0 == iQueueDepth) {
+        DMD_LOG_ERROR("CDmdEncodeStage::Init(), invalid queue depth");
+        return DMD_S_FAIL;
+    }
+
+    m_encodeParam = encodeParam;
+    if (m_encodeParam.fFrameRate <= 0) {
+        m_encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+    }
+    m_iTargetBitrate = m_encodeParam.iTargetBitrate;
+    m_fTargetFrameRate = m_encodeParam.fFrameRate;
+    m_bRatePending = false;
+    m_ulMinFrameIntervalUs = 0;
+    m_ulLastKeptUs = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_ulWindowStartUs = 0;
+    m_ulWindowBytes = 0;
+    m_ulActiveFrameCount = 0;
+    m_ulActiveEncodeCpuUs = 0;
+    m_ulActiveEncodedCount = 0;
+    m_ulActiveBytes = 0;
+    m_eGateMode = DmdGateActive;
+    m_eEncodeGateMode = DmdGateActive;
+    m_bEncodeMotion = false;
+
+    if (DMD_S_OK != CreateVideoEncodeEngine(&m_pEncodeEngine)) {
+        DMD_LOG_ERROR("CDmdEncodeStage::Init(), "
+                << "CreateVideoEncodeEngine failed");
+        return DMD_S_FAIL;
+    }
+    m_pEncodeEngine->SetDataSink(this);
+    if (DMD_S_OK != m_pEncodeEngine->Init(m_encodeParam)) {
+        ReleaseVideoEncodeEngine(&m_pEncodeEngine);
+        return DMD_S_FAIL;
+    }
+
+    m_pFreeQueue = new DmdBoundedQueue<DmdEncodeFrameSlot *>(iQueueDepth + 1);
+    m_pEncodeQueue = new DmdBoundedQueue<DmdEncodeFrameSlot *>(iQueueDepth);
+    if (NULL == m_pFreeQueue || NULL == m_pEncodeQueue) {
+        DMD_LOG_ERROR("CDmdEncodeStage::Init(), failed to allocate queue");
+        Uninit();
+        return DMD_S_FAIL;
+    }
+
+    // one more slot than the queue depth, for the frame being encoded;
+    return allocSlots(iQueueDepth + 1);
+}
+
+DMD_RESULT CDmdEncodeStage::Uninit() {
+    if (m_pEncodeEngine) {
+        m_pEncodeEngine->Uninit();
+        ReleaseVideoEncodeEngine(&m_pEncodeEngine);
+    }
+    if (m_pDetectEngine) {
+        m_pDetectEngine->Uninit();
+        ReleaseVideoEncodeEngine(&m_pDetectEngine);
+    }
+    memset(&m_detectParam, 0, sizeof(m_detectParam));
+    releaseSlots();
+    if (m_pFreeQueue) {
+        delete m_pFreeQueue;
+        m_pFreeQueue = NULL;
+    }
+    if (m_pEncodeQueue) {
+        delete m_pEncodeQueue;
+        m_pEncodeQueue = NULL;
+    }
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeStage::allocSlots(unsigned int iSlotCount) {
+    for (unsigned int i = 0; i < iSlotCount; i++) {
+        DmdEncodeFrameSlot *pSlot = new DmdEncodeFrameSlot;
+        if (NULL == pSlot) {
+            DMD_LOG_ERROR("CDmdEncodeStage::allocSlots(), "
+                    << "failed to allocate frame slot");
+            return DMD_S_FAIL;
+        }
+        memset(pSlot, 0, sizeof(*pSlot));
+        m_vecSlots.push_back(pSlot);
+        m_pFreeQueue->TryPush(pSlot);
+    }
+
+    return DMD_S_OK;
+}
+
+void CDmdEncodeStage::releaseSlots() {
+    for (size_t i = 0; i < m_vecSlots.size(); i++) {
+        releaseSlotFrame(m_vecSlots[i]);
+        if (m_vecSlots[i]->pBuffer) {
+            delete [] m_vecSlots[i]->pBuffer;
+        }
+        delete m_vecSlots[i];
+    }
+    m_vecSlots.clear();
+}
+
+DMD_RESULT CDmdEncodeStage::reserveSlotBuffer(DmdEncodeFrameSlot *pSlot,
+        size_t ulSize) {
+    if (ulSize <= pSlot->ulBufferSize) {
+        return DMD_S_OK;
+    }
+
+    if (pSlot->pBuffer) {
+        delete [] pSlot->pBuffer;
+    }
+    pSlot->pBuffer = new uint8_t[ulSize];
+    if (NULL == pSlot->pBuffer) {
+        DMD_LOG_ERROR("CDmdEncodeStage::reserveSlotBuffer(), "
+                << "failed to allocate " << ulSize << " bytes");
+        pSlot->ulBufferSize = 0;
+        return DMD_S_FAIL;
+    }
+    pSlot->ulBufferSize = ulSize;
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeStage::copyToSlot(DmdEncodeFrameSlot *pSlot,
+        const DmdVideoRawData *pVideoRawData) {
+    unsigned int iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    if (DMD_S_OK != reserveSlotBuffer(pSlot,
+                DmdI420FrameSize(iWidth, iHeight))) {
+        return DMD_S_FAIL;
+    }
+
+    memset(&pSlot->videoFrame, 0, sizeof(pSlot->videoFrame));
+    DmdSetupI420Planes(&pSlot->videoFrame, pSlot->pBuffer, iWidth, iHeight);
+
+    return DmdConvertToI420(pVideoRawData, &pSlot->videoFrame);
+}
+
+DMD_RESULT CDmdEncodeStage::bindToSlot(DmdEncodeFrameSlot *pSlot,
+        const DmdVideoRawData *pVideoRawData) {
+    pVideoRawData->pFrameBuffer->AddRef();
+    pSlot->pFrameBuffer = pVideoRawData->pFrameBuffer;
+    pSlot->videoFrame = *pVideoRawData;
+
+    return DMD_S_OK;
+}
+
+void CDmdEncodeStage::releaseSlotFrame(DmdEncodeFrameSlot *pSlot) {
+    if (pSlot->pFrameBuffer) {
+        pSlot->pFrameBuffer->Release();
+        pSlot->pFrameBuffer = NULL;
+    }
+}
+
+DMD_RESULT CDmdEncodeStage::deinterleaveChroma(DmdEncodeFrameSlot *pSlot,
+        DmdVideoRawData *pI420Frame) {
+    const DmdVideoRawData &nv12Frame = pSlot->videoFrame;
+    unsigned int iChromaWidth = (nv12Frame.fmtVideoFormat.iWidth + 1) / 2;
+    unsigned int iChromaHeight = (nv12Frame.fmtVideoFormat.iHeight + 1) / 2;
+    size_t ulChromaSize = iChromaWidth * iChromaHeight;
+    if (DMD_S_OK != reserveSlotBuffer(pSlot, ulChromaSize * 2)) {
+        return DMD_S_FAIL;
+    }
+
+    // luma stays in the frame handle;
+    *pI420Frame = nv12Frame;
+    pI420Frame->fmtVideoFormat.eVideoType = DmdI420;
+    pI420Frame->pSrcDataPanel[1] = pSlot->pBuffer;
+    pI420Frame->pSrcDataPanel[2] = pSlot->pBuffer + ulChromaSize;
+    pI420Frame->ulSrcDataStride[1] = iChromaWidth;
+    pI420Frame->ulSrcDataStride[2] = iChromaWidth;
+    pI420Frame->ulPlaneCount = 3;
+    for (unsigned int y = 0; y < iChromaHeight; y++) {
+        const uint8_t *pUV = nv12Frame.pSrcDataPanel[1]
+            + y * nv12Frame.ulSrcDataStride[1];
+        uint8_t *pU = pI420Frame->pSrcDataPanel[1] + y * iChromaWidth;
+        uint8_t *pV = pI420Frame->pSrcDataPanel[2] + y * iChromaWidth;
+        for (unsigned int x = 0; x < iChromaWidth; x++) {
+            pU[x] = pUV[2 * x];
+            pV[x] = pUV[2 * x + 1];
+        }
+    }
+
+    return DMD_S_OK;
+}
+
+void CDmdEncodeStage::SetDataSink(IDmdEncodeEngineSink *pDataSink) {
+    m_pDataSink = pDataSink;
+}
+
+void CDmdEncodeStage::SetMotionGate(const DmdMotionGateParam &gateParam) {
+    DMD_LOG_INFO("CDmdEncodeStage::SetMotionGate()"
+            << ", enable = " << gateParam.bEnable
+            << ", idle frame rate = " << gateParam.fIdleFrameRate
+            << ", idle bitrate = " << gateParam.iIdleBitrate
+            << ", hangover = " << gateParam.iHangoverMs << "ms"
+            << ", heartbeat only = " << gateParam.bHeartbeatOnly
+            << ", heartbeat = " << gateParam.iHeartbeatMs << "ms");
+    m_gateParam = gateParam;
+    if (0 == m_gateParam.iHeartbeatMs) {
+        m_gateParam.iHeartbeatMs = DMD_MOTION_GATE_DEFAULT_HEARTBEAT_MS;
+    }
+    m_eGateMode = DmdGateActive;
+    m_ulLastMotionUs = 0;
+    m_ulLastIdleKeptUs = 0;
+}
+
+DMD_RESULT CDmdEncodeStage::SetDetectLayer(
+        const DmdDetectLayerParam &detectParam) {
+    DMD_LOG_INFO("CDmdEncodeStage::SetDetectLayer()"
+            << ", enable = " << detectParam.bEnable
+            << ", scale divisor = " << detectParam.iScaleDivisor
+            << ", bitrate = " << detectParam.iTargetBitrate
+            << ", frame rate = " << detectParam.fFrameRate);
+    if (NULL == m_pEncodeEngine) {
+        DMD_LOG_ERROR("CDmdEncodeStage::SetDetectLayer(), not initialized");
+        return DMD_S_FAIL;
+    }
+    if (m_pDetectEngine) {
+        m_pDetectEngine->Uninit();
+        ReleaseVideoEncodeEngine(&m_pDetectEngine);
+    }
+    memset(&m_detectParam, 0, sizeof(m_detectParam));
+    if (!detectParam.bEnable) {
+        return DMD_S_OK;
+    }
+    if (detectParam.iScaleDivisor < 2 || 0 == detectParam.iTargetBitrate) {
+        DMD_LOG_ERROR("CDmdEncodeStage::SetDetectLayer(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    // same encoder settings, resolution follows the downscaled frame;
+    DmdEncodeParam encodeParam = m_encodeParam;
+    encodeParam.iWidth = 0;
+    encodeParam.iHeight = 0;
+    encodeParam.iTargetBitrate = detectParam.iTargetBitrate;
+    encodeParam.iMaxBitrate = 0;
+    encodeParam.bEnableLtr = false;
+    encodeParam.fFrameRate = detectParam.fFrameRate > 0
+        && detectParam.fFrameRate < m_encodeParam.fFrameRate
+        ? detectParam.fFrameRate : m_encodeParam.fFrameRate;
+    if (DMD_S_OK != CreateVideoEncodeEngine(&m_pDetectEngine)) {
+        DMD_LOG_ERROR("CDmdEncodeStage::SetDetectLayer(), "
+                << "CreateVideoEncodeEngine failed");
+        return DMD_S_FAIL;
+    }
+    m_pDetectEngine->SetDataSink(this);
+    if (DMD_S_OK != m_pDetectEngine->Init(encodeParam)) {
+        ReleaseVideoEncodeEngine(&m_pDetectEngine);
+        return DMD_S_FAIL;
+    }
+
+    m_detectParam = detectParam;
+    m_detectParam.fFrameRate = encodeParam.fFrameRate;
+    m_ulLastDetectKeptUs = 0;
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeStage::Warmup(unsigned int iWidth,
+        unsigned int iHeight) {
+    if (NULL == m_pEncodeEngine || 0 == iWidth || 0 == iHeight) {
+        DMD_LOG_ERROR("CDmdEncodeStage::Warmup(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    m_mtxEncodeMutex.Lock();
+    DMD_RESULT ret = m_pEncodeEngine->Prepare(iWidth, iHeight);
+    if (DMD_S_OK == ret && m_pDetectEngine) {
+        unsigned int iDivisor = m_detectParam.iScaleDivisor;
+        unsigned int iDetectWidth = DmdDownscaledSize(iWidth, iDivisor);
+        unsigned int iDetectHeight = DmdDownscaledSize(iHeight, iDivisor);
+        ret = m_pDetectEngine->Prepare(iDetectWidth, iDetectHeight);
+        m_vecDetectBuffer.resize(DmdI420FrameSize(iDetectWidth,
+                    iDetectHeight));
+    }
+    m_mtxEncodeMutex.Unlock();
+
+    return ret;
+}
+
+bool CDmdEncodeStage::detectLayerDue(uint64_t ulNowUs) {
+    if (NULL == m_pDetectEngine) {
+        return false;
+    }
+
+    // a tenth of tolerance for capture jitter, as limitFrameRate();
+    uint64_t ulIntervalUs = static_cast<uint64_t>(1000000
+            / m_detectParam.fFrameRate);
+    return 0 == m_ulLastDetectKeptUs || ulNowUs <= m_ulLastDetectKeptUs
+        || ulNowUs - m_ulLastDetectKeptUs >= ulIntervalUs - ulIntervalUs / 10;
+}
+
+bool CDmdEncodeStage::gateFrame(const DmdVideoRawData *pVideoRawData,
+        DmdMotionGateMode *pGateMode, bool *pForceIntra) {
+    *pGateMode = DmdGateActive;
+    *pForceIntra = false;
+    if (!m_gateParam.bEnable) {
+        return true;
+    }
+
+    uint64_t ulNowUs = pVideoRawData->fmtVideoFormat.ulTimestamp
+        ? pVideoRawData->fmtVideoFormat.ulTimestamp : DmdGetTickCountUs();
+    // frames the detector did not look at count as motion;
+    uint32_t ulFlags = pVideoRawData->ulFrameFlags;
+    bool bMotion = !(ulFlags & DMD_FRAME_FLAG_MOTION_ANALYSED)
+        || (ulFlags & DMD_FRAME_FLAG_MOTION);
+    if (bMotion) {
+        m_ulLastMotionUs = ulNowUs;
+        if (DmdGateIdle == m_eGateMode) {
+            // event start, full rate and an idr from this very frame,
+            // unless the background is kept as long term reference;
+            m_eGateMode = DmdGateActive;
+            *pForceIntra = !m_encodeParam.bEnableLtr;
+            m_mtxStatsMutex.Lock();
+            m_stats.ulMotionEventCount++;
+            m_mtxStatsMutex.Unlock();
+        }
+        return true;
+    }
+
+    if (DmdGateActive == m_eGateMode) {
+        if (ulNowUs - m_ulLastMotionUs
+                < static_cast<uint64_t>(m_gateParam.iHangoverMs) * 1000) {
+            return true;
+        }
+        m_eGateMode = DmdGateIdle;
+        m_ulLastIdleKeptUs = 0;
+    }
+
+    *pGateMode = DmdGateIdle;
+    m_mtxStatsMutex.Lock();
+    m_stats.ulIdleInputCount++;
+    m_mtxStatsMutex.Unlock();
+
+    uint64_t ulIntervalUs = 0;
+    if (m_gateParam.bHeartbeatOnly) {
+        ulIntervalUs = static_cast<uint64_t>(m_gateParam.iHeartbeatMs) * 1000;
+    } else if (m_gateParam.fIdleFrameRate > 0) {
+        ulIntervalUs = static_cast<uint64_t>(1000000
+                / m_gateParam.fIdleFrameRate);
+    }
+    if (0 == m_ulLastIdleKeptUs || ulNowUs - m_ulLastIdleKeptUs
+            >= ulIntervalUs) {
+        m_ulLastIdleKeptUs = ulNowUs;
+        *pForceIntra = m_gateParam.bHeartbeatOnly;
+        return true;
+    }
+
+    m_mtxStatsMutex.Lock();
+    m_stats.ulGatedCount++;
+    m_mtxStatsMutex.Unlock();
+
+    return false;
+}
+
+void CDmdEncodeStage::applyRateControl(DmdMotionGateMode eGateMode) {
+    bool bRateChanged = false;
+    m_mtxStatsMutex.Lock();
+    if (m_bRatePending) {
+        m_iTargetBitrate = m_iPendingBitrate;
+        m_fTargetFrameRate = m_fPendingFrameRate;
+        m_bRatePending = false;
+        bRateChanged = true;
+    }
+    m_mtxStatsMutex.Unlock();
+    if (eGateMode == m_eEncodeGateMode && !bRateChanged) {
+        return;
+    }
+
+    m_eEncodeGateMode = eGateMode;
+    unsigned int iBitrate = m_iTargetBitrate;
+    float fFrameRate = m_fTargetFrameRate;
+    if (DmdGateIdle == eGateMode) {
+        if (m_gateParam.iIdleBitrate && m_gateParam.iIdleBitrate < iBitrate) {
+            iBitrate = m_gateParam.iIdleBitrate;
+        }
+        float fIdleFrameRate = m_gateParam.bHeartbeatOnly
+            ? 1000.0f / m_gateParam.iHeartbeatMs
+            : m_gateParam.fIdleFrameRate;
+        // openh264 takes no frame rate below one;
+        fFrameRate = fIdleFrameRate < 1.0f ? 1.0f
+            : (fIdleFrameRate < fFrameRate ? fIdleFrameRate : fFrameRate);
+    }
+
+    DMD_LOG_INFO("CDmdEncodeStage::applyRateControl(), "
+            << (DmdGateIdle == eGateMode ? "idle" : "active")
+            << ", bitrate:" << iBitrate << ", frame rate:" << fFrameRate);
+    m_pEncodeEngine->SetRateControl(iBitrate, fFrameRate);
+}
+
+void CDmdEncodeStage::applyLtrControl(bool bMotion, bool bBackground) {
+    if (!m_encodeParam.bEnableLtr) {
+        return;
+    }
+
+    // no marks while the scene changes, the reference keeps the background;
+    if (bMotion != m_bEncodeMotion) {
+        m_bEncodeMotion = bMotion;
+        m_pEncodeEngine->SetLtrRefresh(!bMotion);
+    }
+    if (bBackground && DMD_S_OK == m_pEncodeEngine->ForceLtrReference()) {
+        m_mtxStatsMutex.Lock();
+        m_stats.ulLtrReferenceCount++;
+        m_mtxStatsMutex.Unlock();
+    }
+}
+
+void CDmdEncodeStage::SetTargetRate(unsigned int iBitrate,
+        float fFrameRate) {
+    if (0 == iBitrate || fFrameRate <= 0) {
+        return;
+    }
+    if (fFrameRate > m_encodeParam.fFrameRate) {
+        fFrameRate = m_encodeParam.fFrameRate;
+    }
+
+    m_mtxStatsMutex.Lock();
+    m_iPendingBitrate = iBitrate;
+    m_fPendingFrameRate = fFrameRate;
+    m_bRatePending = true;
+    m_mtxStatsMutex.Unlock();
+    m_ulMinFrameIntervalUs = fFrameRate < m_encodeParam.fFrameRate
+        ? static_cast<uint64_t>(1000000 / fFrameRate) : 0;
+}
+
+bool CDmdEncodeStage::limitFrameRate(const DmdVideoRawData *pVideoRawData) {
+    uint64_t ulIntervalUs = m_ulMinFrameIntervalUs;
+    uint64_t ulNowUs = pVideoRawData->fmtVideoFormat.ulTimestamp
+        ? pVideoRawData->fmtVideoFormat.ulTimestamp : DmdGetTickCountUs();
+    // a tenth of tolerance for capture jitter;
+    if (ulIntervalUs && m_ulLastKeptUs && ulNowUs > m_ulLastKeptUs
+            && ulNowUs - m_ulLastKeptUs < ulIntervalUs - ulIntervalUs / 10) {
+        return true;
+    }
+
+    m_ulLastKeptUs = ulNowUs;
+    return false;
+}
+
+void CDmdEncodeStage::SetListener(IDmdEncodeStageListener *pListener) {
+    m_pListener = pListener;
+}
+
+void CDmdEncodeStage::ForceIntraFrame() {
+    m_bForceIntra = true;
+    m_bForceDetectIntra = true;
+}
+
+void CDmdEncodeStage::SetComplexity(DmdComplexityMode eComplexity) {
+    m_iPendingComplexity = eComplexity;
+}
+
+void CDmdEncodeStage::SetFrameDecimation(unsigned int iKeepOneOf) {
+    m_iDecimation = iKeepOneOf ? iKeepOneOf : 1;
+}
+
+uint64_t CDmdEncodeStage::GetFrameIntervalUs() const {
+    return static_cast<uint64_t>(1000000 / m_encodeParam.fFrameRate);
+}
+
+bool CDmdEncodeStage::PeekQueuedUs(uint64_t *pQueuedUs) {
+    if (NULL == m_pEncodeQueue) {
+        return false;
+    }
+
+    DmdEncodeFrameSlot *pSlot = NULL;
+    m_mtxStatsMutex.Lock();
+    bool bRet = m_pEncodeQueue->TryPeek(&pSlot);
+    if (bRet) {
+        *pQueuedUs = pSlot->ulQueuedUs;
+    }
+    m_mtxStatsMutex.Unlock();
+
+    return bRet;
+}
+
+void CDmdEncodeStage::GetStats(DmdEncodeStats *pStats) {
+    if (NULL == pStats) {
+        return;
+    }
+
+    m_mtxStatsMutex.Lock();
+    *pStats = m_stats;
+    if (m_ulActiveFrameCount) {
+        pStats->ulSavedEncodeCpuUs = m_stats.ulGatedCount
+            * m_ulActiveEncodeCpuUs / m_ulActiveFrameCount;
+    }
+    if (m_ulActiveEncodedCount) {
+        pStats->ulSavedBytes = m_stats.ulGatedCount
+            * m_ulActiveBytes / m_ulActiveEncodedCount;
+    }
+    m_mtxStatsMutex.Unlock();
+}
+
+DMD_RESULT CDmdEncodeStage::DeliverVideoData(
+        DmdVideoRawData *pVideoRawData) {
+    if (NULL == pVideoRawData || NULL == m_pFreeQueue) {
+        return DMD_S_FAIL;
+    }
+
+    m_mtxStatsMutex.Lock();
+    m_stats.ulInputCount++;
+    m_mtxStatsMutex.Unlock();
+
+    // gate and rate limit apply to the record layer only;
+    DmdMotionGateMode eGateMode = DmdGateActive;
+    bool bForceIntra = false;
+    bool bRecord = gateFrame(pVideoRawData, &eGateMode, &bForceIntra);
+    if (bRecord && DmdGateActive == eGateMode && !bForceIntra
+            && limitFrameRate(pVideoRawData)) {
+        m_mtxStatsMutex.Lock();
+        m_stats.ulRateLimitedCount++;
+        m_mtxStatsMutex.Unlock();
+        bRecord = false;
+    }
+    uint64_t ulNowUs = pVideoRawData->fmtVideoFormat.ulTimestamp
+        ? pVideoRawData->fmtVideoFormat.ulTimestamp : DmdGetTickCountUs();
+    bool bDetect = detectLayerDue(ulNowUs);
+    if (!bRecord && !bDetect) {
+        return DMD_S_OK;
+    }
+
+    // decimation sheds load, but never the idr of an event start;
+    unsigned int iDecimation = m_iDecimation;
+    if (iDecimation > 1 && !bForceIntra
+            && 0 != m_iDecimationCount++ % iDecimation) {
+        m_mtxStatsMutex.Lock();
+        m_stats.ulDecimatedCount++;
+        m_mtxStatsMutex.Unlock();
+        return DMD_S_OK;
+    }
+    if (bDetect) {
+        m_ulLastDetectKeptUs = ulNowUs;
+    }
+
+    // encoder falls behind, drop the oldest queued frame and reuse its
+    // slot; otherwise a free slot is always left, see Init();
+    DmdEncodeFrameSlot *pSlot = NULL;
+    if (m_pEncodeQueue->Size() >= m_pEncodeQueue->Capacity()
+            && m_pEncodeQueue->TryPop(&pSlot)) {
+        m_mtxStatsMutex.Lock();
+        m_stats.ulDroppedCount++;
+        m_mtxStatsMutex.Unlock();
+        // never lose the idr of an event start;
+        if (pSlot->bRecord && pSlot->bForceIntra) {
+            m_bForceIntra = true;
+        }
+    } else if (!m_pFreeQueue->TryPop(&pSlot)) {
+        DMD_LOG_ERROR("CDmdEncodeStage::DeliverVideoData(), "
+                << "no free frame slot");
+        return DMD_S_FAIL;
+    }
+
+    releaseSlotFrame(pSlot);
+
+    DmdVideoType eVideoType = pVideoRawData->fmtVideoFormat.eVideoType;
+    bool bZeroCopy = pVideoRawData->pFrameBuffer
+        && (DmdI420 == eVideoType || DmdNV12 == eVideoType);
+    DMD_RESULT ret = bZeroCopy ? bindToSlot(pSlot, pVideoRawData)
+        : copyToSlot(pSlot, pVideoRawData);
+    if (DMD_S_OK != ret) {
+        m_pFreeQueue->TryPush(pSlot);
+        if (bRecord && bForceIntra) {
+            m_bForceIntra = true;
+        }
+        return DMD_S_FAIL;
+    }
+    pSlot->eGateMode = eGateMode;
+    pSlot->bForceIntra = bRecord && bForceIntra;
+    pSlot->bRecord = bRecord;
+    pSlot->bDetect = bDetect;
+    pSlot->bMotion = !(pVideoRawData->ulFrameFlags
+            & DMD_FRAME_FLAG_MOTION_ANALYSED)
+        || (pVideoRawData->ulFrameFlags & DMD_FRAME_FLAG_MOTION);
+    pSlot->bBackground =
+        0 != (pVideoRawData->ulFrameFlags & DMD_FRAME_FLAG_BACKGROUND);
+
+    m_mtxStatsMutex.Lock();
+    if (bZeroCopy) {
+        m_stats.ulZeroCopyCount++;
+    } else {
+        m_stats.ulCopyCount++;
+    }
+    // under the lock, PeekQueuedUs() may read a slot being recycled;
+    pSlot->ulQueuedUs = DmdGetTickCountUs();
+    m_mtxStatsMutex.Unlock();
+
+    m_pEncodeQueue->TryPush(pSlot);
+    if (m_pListener) {
+        m_pListener->OnFrameQueued(this);
+    }
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeStage::EncodeQueuedFrame(unsigned int iTimeoutMs,
+        uint64_t *pQueuedUs) {
+    if (pQueuedUs) {
+        *pQueuedUs = 0;
+    }
+    if (NULL == m_pEncodeQueue) {
+        return DMD_S_FAIL;
+    }
+
+    DmdEncodeFrameSlot *pSlot = NULL;
+    if (!m_pEncodeQueue->Pop(&pSlot, iTimeoutMs)) {
+        return DMD_S_OK;
+    }
+    if (pQueuedUs) {
+        *pQueuedUs = pSlot->ulQueuedUs;
+    }
+
+    m_mtxEncodeMutex.Lock();
+    int iComplexity = m_iPendingComplexity.exchange(-1);
+    if (iComplexity >= 0) {
+        m_pEncodeEngine->SetComplexity(
+                static_cast<DmdComplexityMode>(iComplexity));
+        if (m_pDetectEngine) {
+            m_pDetectEngine->SetComplexity(
+                    static_cast<DmdComplexityMode>(iComplexity));
+        }
+    }
+
+    // rate first, so the idr of an event start is encoded at full rate;
+    if (pSlot->bRecord) {
+        applyRateControl(pSlot->eGateMode);
+        applyLtrControl(pSlot->bMotion, pSlot->bBackground);
+        if (m_bForceIntra.exchange(false) || pSlot->bForceIntra) {
+            m_pEncodeEngine->ForceIntraFrame();
+        }
+    }
+
+    // build the source picture straight from the queued frame;
+    uint64_t ulStart = DmdGetTickCountUs();
+    DMD_RESULT ret = DMD_S_OK;
+    bool bChromaConverted = false;
+    DmdVideoRawData i420Frame;
+    if (DmdNV12 == pSlot->videoFrame.fmtVideoFormat.eVideoType) {
+        ret = deinterleaveChroma(pSlot, &i420Frame);
+        bChromaConverted = true;
+    } else {
+        i420Frame = pSlot->videoFrame;
+    }
+    uint64_t ulDetectCpuCost = 0;
+    if (DMD_S_OK == ret && pSlot->bDetect) {
+        ret = encodeDetectLayer(&i420Frame, &ulDetectCpuCost);
+    }
+    uint64_t ulCpuCost = 0;
+    if (DMD_S_OK == ret && pSlot->bRecord) {
+        uint64_t ulCpuStart = DmdGetThreadCpuTimeUs();
+        m_pEncodingSlot = pSlot;
+        m_eEncodingLayer = DmdLayerRecord;
+        ret = m_pEncodeEngine->EncodeFrame(&i420Frame);
+        m_pEncodingSlot = NULL;
+        ulCpuCost = DmdGetThreadCpuTimeUs() - ulCpuStart;
+    }
+    uint64_t ulCost = DmdGetTickCountUs() - ulStart;
+    DmdMotionGateMode eGateMode = pSlot->eGateMode;
+    bool bRecord = pSlot->bRecord;
+
+    m_mtxEncodeMutex.Unlock();
+
+    // the encoder is done with the planes;
+    releaseSlotFrame(pSlot);
+    m_pFreeQueue->TryPush(pSlot);
+
+    m_mtxStatsMutex.Lock();
+    m_stats.ulTotalEncodeCpuUs += ulCpuCost + ulDetectCpuCost;
+    m_stats.ulDetectEncodeCpuUs += ulDetectCpuCost;
+    if (bRecord && DmdGateActive == eGateMode) {
+        m_ulActiveFrameCount++;
+        m_ulActiveEncodeCpuUs += ulCpuCost;
+    }
+    if (bChromaConverted) {
+        m_stats.ulChromaConvertCount++;
+    }
+    m_stats.ulLastEncodeCostUs = ulCost;
+    m_stats.ulTotalEncodeCostUs += ulCost;
+    if (ulCost > m_stats.ulMaxEncodeCostUs) {
+        m_stats.ulMaxEncodeCostUs = ulCost;
+    }
+    m_mtxStatsMutex.Unlock();
+
+    return ret;
+}
+
+DMD_RESULT CDmdEncodeStage::encodeDetectLayer(
+        const DmdVideoRawData *pI420Frame, uint64_t *pCpuCostUs) {
+    uint64_t ulCpuStart = DmdGetThreadCpuTimeUs();
+    unsigned int iDivisor = m_detectParam.iScaleDivisor;
+    unsigned int iWidth = DmdDownscaledSize(
+            pI420Frame->fmtVideoFormat.iWidth, iDivisor);
+    unsigned int iHeight = DmdDownscaledSize(
+            pI420Frame->fmtVideoFormat.iHeight, iDivisor);
+    if (0 == iWidth || 0 == iHeight) {
+        DMD_LOG_ERROR("CDmdEncodeStage::encodeDetectLayer(), "
+                << "frame too small for divisor " << iDivisor);
+        return DMD_S_FAIL;
+    }
+    m_vecDetectBuffer.resize(DmdI420FrameSize(iWidth, iHeight));
+
+    DmdVideoRawData detectFrame;
+    memset(&detectFrame, 0, sizeof(detectFrame));
+    DmdSetupI420Planes(&detectFrame, &m_vecDetectBuffer[0], iWidth, iHeight);
+    DMD_RESULT ret = DmdDownscaleI420(pI420Frame, &detectFrame, iDivisor);
+    if (DMD_S_OK == ret) {
+        if (m_bForceDetectIntra.exchange(false)) {
+            m_pDetectEngine->ForceIntraFrame();
+        }
+        m_eEncodingLayer = DmdLayerDetect;
+        ret = m_pDetectEngine->EncodeFrame(&detectFrame);
+        m_eEncodingLayer = DmdLayerRecord;
+    }
+    *pCpuCostUs = DmdGetThreadCpuTimeUs() - ulCpuStart;
+
+    return ret;
+}
+
+DMD_RESULT CDmdEncodeStage::RunEncodeLoop() {
+    // g_bEncodeThreadRunning is defined at CDmdEncodeThread.cpp
+    // when SIGINT is send to openDMD, g_bEncodeThreadRunning = false;
+    while (g_bEncodeThreadRunning) {
+        EncodeQueuedFrame(DMD_ENCODE_QUEUE_POLL_MS);
+    }
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdEncodeStage::DeliverEncodedData(
+        DmdEncodedFrame *pEncodedFrame) {
+    uint64_t ulNow = DmdGetTickCountUs();
+    pEncodedFrame->eLayer = m_eEncodingLayer;
+    // without a gate every frame is active, as all of it matters;
+    pEncodedFrame->bMotion = DmdLayerRecord == m_eEncodingLayer
+        && m_pEncodingSlot && DmdGateActive == m_pEncodingSlot->eGateMode;
+    if (DmdLayerDetect == m_eEncodingLayer) {
+        if (DmdFrameSkip == pEncodedFrame->eFrameType
+                || 0 == pEncodedFrame->ulDataLen) {
+            return DMD_S_OK;
+        }
+        m_mtxStatsMutex.Lock();
+        m_stats.ulDetectEncodedCount++;
+        m_stats.ulDetectBytes += pEncodedFrame->ulDataLen;
+        m_mtxStatsMutex.Unlock();
+        return m_pDataSink ? m_pDataSink->DeliverEncodedData(pEncodedFrame)
+            : DMD_S_OK;
+    }
+
+    m_mtxStatsMutex.Lock();
+    if (DmdFrameSkip == pEncodedFrame->eFrameType
+            || 0 == pEncodedFrame->ulDataLen) {
+        m_stats.ulSkippedCount++;
+        m_mtxStatsMutex.Unlock();
+        return DMD_S_OK;
+    }
+
+    m_stats.ulEncodedCount++;
+    if (0 == m_stats.ulFirstFrameUs) {
+        m_stats.ulFirstFrameUs = ulNow;
+    }
+    if (DmdFrameIDR == pEncodedFrame->eFrameType) {
+        m_stats.ulIdrCount++;
+    }
+    m_stats.ulLastFrameBytes = pEncodedFrame->ulDataLen;
+    m_stats.ulTotalBytes += pEncodedFrame->ulDataLen;
+    if (m_pEncodingSlot && DmdGateActive == m_pEncodingSlot->eGateMode) {
+        m_ulActiveEncodedCount++;
+        m_ulActiveBytes += pEncodedFrame->ulDataLen;
+    }
+    if (m_pEncodingSlot) {
+        m_stats.ulLastLatencyUs = ulNow - m_pEncodingSlot->ulQueuedUs;
+        if (m_stats.ulLastLatencyUs > m_stats.ulMaxLatencyUs) {
+            m_stats.ulMaxLatencyUs = m_stats.ulLastLatencyUs;
+        }
+    }
+
+    if (0 == m_ulWindowStartUs) {
+        m_ulWindowStartUs = ulNow;
+    }
+    m_ulWindowBytes += pEncodedFrame->ulDataLen;
+    if (ulNow - m_ulWindowStartUs >= 1000000) {
+        m_stats.ulBitrateBps = m_ulWindowBytes * 8 * 1000000
+            / (ulNow - m_ulWindowStartUs);
+        m_ulWindowStartUs = ulNow;
+        m_ulWindowBytes = 0;
+    }
+    DmdEncodeStats stats = m_stats;
+    m_mtxStatsMutex.Unlock();
+
+    DMD_LOG_INFO("CDmdEncodeStage::DeliverEncodedData(), "
+            << "frame:" << stats.ulEncodedCount
+            << ", type:" << pEncodedFrame->eFrameType
+            << ", bytes:" << pEncodedFrame->ulDataLen
+            << ", nals:" << pEncodedFrame->iNalCount
+            << ", latency:" << stats.ulLastLatencyUs << "us"
+            << ", bitrate:" << stats.ulBitrateBps << "bps");
+
+    if (m_pDataSink) {
+        return m_pDataSink->DeliverEncodedData(pEncodedFrame);
+    }
+
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
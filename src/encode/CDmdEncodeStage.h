@@ -0,0 +1,298 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeStage.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdEncodeStage.h
+ ============================================================================
+ */
+
+#ifndef SRC_ENCODE_CDMDENCODESTAGE_H
+#define SRC_ENCODE_CDMDENCODESTAGE_H
+
+#include <atomic>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdCaptureEngine.h"
+#include "IDmdEncodeEngine.h"
+
+#include "thread/DmdBoundedQueue.h"
+#include "thread/DmdThreadMutex.h"
+
+namespace opendmd {
+
+#define DMD_ENCODE_DEFAULT_QUEUE_DEPTH 4
+
+#define DMD_MOTION_GATE_DEFAULT_IDLE_FRAMERATE  2.0f
+#define DMD_MOTION_GATE_DEFAULT_IDLE_BITRATE    (128 * 1024)
+#define DMD_MOTION_GATE_DEFAULT_HANGOVER_MS     3000
+#define DMD_MOTION_GATE_DEFAULT_HEARTBEAT_MS    5000
+
+#define DMD_DETECT_LAYER_DEFAULT_DIVISOR        4
+#define DMD_DETECT_LAYER_DEFAULT_BITRATE        (128 * 1024)
+#define DMD_DETECT_LAYER_DEFAULT_FRAMERATE      5.0f
+
+typedef enum {
+    DmdGateActive = 0,  // full frame rate and bitrate;
+    DmdGateIdle,        // no motion beyond the hangover;
+} DmdMotionGateMode;
+
+typedef struct {
+    bool            bEnable;
+    float           fIdleFrameRate;       // frames kept per second idle;
+    unsigned int    iIdleBitrate;         // in bps, 0 keeps the target;
+    unsigned int    iHangoverMs;          // stay active after last motion;
+    bool            bHeartbeatOnly;       // idle frames are idr only;
+    unsigned int    iHeartbeatMs;         // idr period when heartbeat only;
+} DmdMotionGateParam;
+
+typedef struct {
+    bool            bEnable;
+    unsigned int    iScaleDivisor;        // 2 for half, 4 for quarter size;
+    unsigned int    iTargetBitrate;       // in bps;
+    float           fFrameRate;
+} DmdDetectLayerParam;
+
+typedef struct {
+    uint64_t        ulInputCount;         // frames offered by capture;
+    uint64_t        ulEncodedCount;
+    uint64_t        ulDroppedCount;       // dropped on a full queue;
+    uint64_t        ulSkippedCount;       // skipped by rate control;
+    uint64_t        ulIdrCount;
+    uint64_t        ulTotalBytes;
+    uint64_t        ulLastFrameBytes;
+    uint64_t        ulLastEncodeCostUs;   // cost of EncodeFrame();
+    uint64_t        ulMaxEncodeCostUs;
+    uint64_t        ulTotalEncodeCostUs;
+    uint64_t        ulLastLatencyUs;      // from queued to encoded;
+    uint64_t        ulMaxLatencyUs;
+    uint64_t        ulBitrateBps;         // over the last second;
+    uint64_t        ulZeroCopyCount;      // encoded from the frame handle;
+    uint64_t        ulCopyCount;          // copied into a slot buffer;
+    uint64_t        ulChromaConvertCount; // nv12 chroma deinterleaved;
+    uint64_t        ulTotalEncodeCpuUs;   // encode thread cpu time;
+    uint64_t        ulGatedCount;         // not encoded, scene idle;
+    uint64_t        ulIdleInputCount;     // frames offered while idle;
+    uint64_t        ulMotionEventCount;   // idle to active switches;
+    uint64_t        ulSavedEncodeCpuUs;   // estimated from active frames;
+    uint64_t        ulSavedBytes;         // estimated from active frames;
+    uint64_t        ulDecimatedCount;     // skipped by frame decimation;
+    uint64_t        ulRateLimitedCount;   // beyond the target frame rate;
+    uint64_t        ulDetectEncodedCount; // detect layer frames;
+    uint64_t        ulDetectBytes;
+    uint64_t        ulDetectEncodeCpuUs;
+    uint64_t        ulLtrReferenceCount;  // predicted from the background;
+    uint64_t        ulFirstFrameUs;       // tick of the first delivery, 0;
+} DmdEncodeStats;
+
+typedef struct {
+    DmdVideoRawData  videoFrame;
+    IDmdFrameBuffer *pFrameBuffer;        // referenced, not copied;
+    uint8_t         *pBuffer;             // frame copy or nv12 chroma;
+    size_t           ulBufferSize;
+    uint64_t         ulQueuedUs;
+    DmdMotionGateMode eGateMode;
+    bool             bForceIntra;         // first frame of a motion event;
+    bool             bRecord;             // encode the record layer;
+    bool             bDetect;             // encode the detect layer;
+    bool             bMotion;             // scene changed, or not analysed;
+    bool             bBackground;         // changed back to the background;
+} DmdEncodeFrameSlot;
+
+class CDmdEncodeStage;
+
+// notified on the capture thread after a frame is queued;
+class IDmdEncodeStageListener {
+public:
+    IDmdEncodeStageListener() {}
+    virtual ~IDmdEncodeStageListener() {}
+    virtual void OnFrameQueued(CDmdEncodeStage *pEncodeStage) = 0;
+};
+
+/*
+ * Per-camera encode stage. Frames arrive from the preprocess stage on the
+ * capture thread and are queued; the encode thread drains the queue
+ * through the encode engine and delivers Annex-B access units to the
+ * downstream sink. Capture never blocks on the encoder: when the queue is
+ * full, the oldest queued frame is dropped.
+ *
+ * A frame that carries pFrameBuffer in I420 or NV12 is queued by
+ * reference, and the encoder reads its planes directly; the reference is
+ * held until EncodeFrame() returns. Only NV12 chroma is deinterleaved, as
+ * openh264 takes planar input only. Other frames are copied into the slot.
+ *
+ * With the motion gate enabled, frames the preprocess stage found static
+ * are thinned out to the idle frame rate, or to idr heartbeats, once the
+ * hangover has passed since the last motion; the encoder runs at the idle
+ * bitrate meanwhile. The first frame with motion restores the full rate
+ * and is encoded as an idr, so a recording starts decodable at the event.
+ *
+ * With the detect layer enabled, a reduced resolution copy of each frame
+ * is encoded by a second encoder at its own bitrate and frame rate, and
+ * the motion gate only applies to the full resolution record layer. The
+ * detect layer stays continuous, so the server can run detection on it
+ * alone while recording follows the events. Delivered frames are tagged
+ * with their layer.
+ *
+ * With bEnableLtr, the surveillance profile, the long term reference is
+ * refreshed while the scene is stable and kept while it changes; a frame
+ * the detector found back at the background, as when an object leaves, is
+ * predicted from that reference instead of re-sending the background. An
+ * event start is then no idr, which would drop the background reference;
+ * recordings start at the last periodic idr instead.
+ */
+class CDmdEncodeStage : public IDmdCaptureEngineSink,
+        public IDmdEncodeEngineSink {
+public:
+    CDmdEncodeStage();
+    ~CDmdEncodeStage();
+
+    DMD_RESULT Init(const DmdEncodeParam &encodeParam,
+            unsigned int iQueueDepth);
+    DMD_RESULT Uninit();
+
+    void SetDataSink(IDmdEncodeEngineSink *pDataSink);
+    // call before frames are delivered;
+    void SetMotionGate(const DmdMotionGateParam &gateParam);
+    // after Init(), before frames are delivered;
+    DMD_RESULT SetDetectLayer(const DmdDetectLayerParam &detectParam);
+    // creates the encoders and buffers for the expected capture size at
+    // start up, while the camera is still being opened; safe from any
+    // thread, a frame that comes early waits for it;
+    DMD_RESULT Warmup(unsigned int iWidth, unsigned int iHeight);
+    void SetListener(IDmdEncodeStageListener *pListener);
+    // take effect at the next encoded frame, safe from any thread;
+    void ForceIntraFrame();
+    void SetComplexity(DmdComplexityMode eComplexity);
+    // keep one of every iKeepOneOf frames, 1 to keep all;
+    void SetFrameDecimation(unsigned int iKeepOneOf);
+    // rate the network can take; frames beyond fFrameRate are dropped
+    // before queueing, idle mode never exceeds it either;
+    void SetTargetRate(unsigned int iBitrate, float fFrameRate);
+    void GetStats(DmdEncodeStats *pStats);
+    const DmdEncodeParam &GetEncodeParam() const {return m_encodeParam;}
+    uint64_t GetFrameIntervalUs() const;
+    // queued time of the oldest queued frame;
+    bool PeekQueuedUs(uint64_t *pQueuedUs);
+
+    // encode thread side, one thread at a time; pQueuedUs receives the
+    // queued time of the encoded frame, 0 if none;
+    DMD_RESULT EncodeQueuedFrame(unsigned int iTimeoutMs,
+            uint64_t *pQueuedUs = NULL);
+    DMD_RESULT RunEncodeLoop();
+
+    // IDmdCaptureEngineSink interface, capture thread side;
+    DMD_RESULT DeliverVideoData(DmdVideoRawData *pVideoRawData);
+
+    // IDmdEncodeEngineSink interface, called within EncodeFrame();
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame);
+
+private:
+    DMD_RESULT allocSlots(unsigned int iSlotCount);
+    void releaseSlots();
+    DMD_RESULT reserveSlotBuffer(DmdEncodeFrameSlot *pSlot, size_t ulSize);
+    DMD_RESULT copyToSlot(DmdEncodeFrameSlot *pSlot,
+            const DmdVideoRawData *pVideoRawData);
+    DMD_RESULT bindToSlot(DmdEncodeFrameSlot *pSlot,
+            const DmdVideoRawData *pVideoRawData);
+    void releaseSlotFrame(DmdEncodeFrameSlot *pSlot);
+    DMD_RESULT deinterleaveChroma(DmdEncodeFrameSlot *pSlot,
+            DmdVideoRawData *pI420Frame);
+    bool gateFrame(const DmdVideoRawData *pVideoRawData,
+            DmdMotionGateMode *pGateMode, bool *pForceIntra);
+    void applyRateControl(DmdMotionGateMode eGateMode);
+    void applyLtrControl(bool bMotion, bool bBackground);
+    bool limitFrameRate(const DmdVideoRawData *pVideoRawData);
+    bool detectLayerDue(uint64_t ulNowUs);
+    DMD_RESULT encodeDetectLayer(const DmdVideoRawData *pI420Frame,
+            uint64_t *pCpuCostUs);
+
+private:
+    IDmdEncodeEngine                        *m_pEncodeEngine;
+    IDmdEncodeEngineSink                    *m_pDataSink;
+    DmdEncodeParam                           m_encodeParam;
+    std::vector<DmdEncodeFrameSlot *>        m_vecSlots;
+    DmdBoundedQueue<DmdEncodeFrameSlot *>   *m_pFreeQueue;
+    DmdBoundedQueue<DmdEncodeFrameSlot *>   *m_pEncodeQueue;
+    DmdEncodeFrameSlot                      *m_pEncodingSlot;
+    std::atomic<bool>                        m_bForceIntra;
+    std::atomic<int>                         m_iPendingComplexity;
+    std::atomic<unsigned int>                m_iDecimation;
+    unsigned int                             m_iDecimationCount;
+    IDmdEncodeStageListener                 *m_pListener;
+
+    // detect layer, its own encoder and downscale buffer;
+    IDmdEncodeEngine                        *m_pDetectEngine;
+    DmdDetectLayerParam                      m_detectParam;
+    std::atomic<bool>                        m_bForceDetectIntra;
+    uint64_t                                 m_ulLastDetectKeptUs;
+    std::vector<uint8_t>                     m_vecDetectBuffer;
+    // layer within EncodeFrame(), encode thread side;
+    DmdEncodeLayer                           m_eEncodingLayer;
+
+    // target rate, pending under m_mtxStatsMutex, limited on capture
+    // thread and applied on encode thread;
+    bool                                     m_bRatePending;
+    unsigned int                             m_iPendingBitrate;
+    float                                    m_fPendingFrameRate;
+    std::atomic<uint64_t>                    m_ulMinFrameIntervalUs;
+    uint64_t                                 m_ulLastKeptUs;
+    unsigned int                             m_iTargetBitrate;
+    float                                    m_fTargetFrameRate;
+
+    // motion gate, capture thread side;
+    DmdMotionGateParam                       m_gateParam;
+    DmdMotionGateMode                        m_eGateMode;
+    uint64_t                                 m_ulLastMotionUs;
+    uint64_t                                 m_ulLastIdleKeptUs;
+    // rate control mode and ltr state of the encoder, encode thread side;
+    DmdMotionGateMode                        m_eEncodeGateMode;
+    bool                                     m_bEncodeMotion;
+
+    // held around the engines, against Warmup() on another thread;
+    DmdThreadMutex                           m_mtxEncodeMutex;
+    DmdThreadMutex                           m_mtxStatsMutex;
+    DmdEncodeStats                           m_stats;
+    uint64_t                                 m_ulWindowStartUs;
+    uint64_t                                 m_ulWindowBytes;
+    // active mode totals, base of the savings estimate;
+    uint64_t                                 m_ulActiveFrameCount;
+    uint64_t                                 m_ulActiveEncodeCpuUs;
+    uint64_t                                 m_ulActiveEncodedCount;
+    uint64_t                                 m_ulActiveBytes;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_ENCODE_CDMDENCODESTAGE_H
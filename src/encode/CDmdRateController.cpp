@@ -0,0 +1,419 @@
+/*
+ ============================================================================
+ * Name        : CDmdRateController.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdRateController.cpp
+ ============================================================================
+ */
+
+#include "CDmdRateController.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+static const char *s_strRateAction[] = {"hold", "increase", "decrease"};
+static const char *s_strRateReason[] = {"none", "loss", "delay", "headroom",
+    "estimate"};
+
+CDmdRateController::CDmdRateController() : m_ulLastChangeUs(0),
+        m_ulLastDecreaseUs(0) {
+    memset(&m_rateParam, 0, sizeof(m_rateParam));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdRateController::~CDmdRateController() {
+}
+
+DMD_RESULT CDmdRateController::Init(const DmdRateControlParam &rateParam,
+        CDmdEncodeStage *pEncodeStage) {
+    DMD_LOG_INFO("CDmdRateController::Init()"
+            << ", start bitrate = " << rateParam.iStartBitrate
+            << ", bitrate range = [" << rateParam.iMinBitrate
+            << ", " << rateParam.iMaxBitrate << "]"
+            << ", frame rate range = [" << rateParam.fMinFrameRate
+            << ", " << rateParam.fMaxFrameRate << "]"
+            << ", delay marks = " << rateParam.iLowDelayMs
+            << "/" << rateParam.iHighDelayMs << "ms"
+            << ", loss marks = " << rateParam.fLowLossRate
+            << "/" << rateParam.fHighLossRate);
+    if (0 == rateParam.iMinBitrate
+            || rateParam.iMinBitrate > rateParam.iMaxBitrate
+            || rateParam.fMinFrameRate <= 0
+            || rateParam.fMinFrameRate > rateParam.fMaxFrameRate) {
+        DMD_LOG_ERROR("CDmdRateController::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    m_rateParam = rateParam;
+    unsigned int iBitrate = rateParam.iStartBitrate;
+    if (iBitrate < rateParam.iMinBitrate) {
+        iBitrate = rateParam.iMinBitrate;
+    } else if (iBitrate > rateParam.iMaxBitrate) {
+        iBitrate = rateParam.iMaxBitrate;
+    }
+
+    m_mtxRateMutex.Lock();
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.iBitrate = iBitrate;
+    m_stats.fFrameRate = frameRateFor(iBitrate);
+    m_queDecisions.clear();
+    m_ulLastChangeUs = 0;
+    m_ulLastDecreaseUs = 0;
+    m_vecStreams.clear();
+    m_mtxRateMutex.Unlock();
+
+    return NULL == pEncodeStage ? DMD_S_OK
+        : AddStream(pEncodeStage, 1, 0, 0, NULL);
+}
+
+DMD_RESULT CDmdRateController::Uninit() {
+    m_mtxRateMutex.Lock();
+    m_vecStreams.clear();
+    m_stats.iStreamCount = 0;
+    m_queDecisions.clear();
+    m_mtxRateMutex.Unlock();
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdRateController::AddStream(CDmdEncodeStage *pEncodeStage,
+        unsigned int iPriority, unsigned int iMinBitrate,
+        unsigned int iMaxBitrate, unsigned int *pStreamId) {
+    if (NULL == pEncodeStage || 0 == iPriority
+            || (iMaxBitrate && iMinBitrate > iMaxBitrate)) {
+        DMD_LOG_ERROR("CDmdRateController::AddStream(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    DmdRateStream stream;
+    memset(&stream, 0, sizeof(stream));
+    stream.pEncodeStage = pEncodeStage;
+    stream.iPriority = iPriority;
+    stream.iMinBitrate = iMinBitrate;
+    stream.iMaxBitrate = iMaxBitrate;
+
+    m_mtxRateMutex.Lock();
+    if (pStreamId) {
+        *pStreamId = static_cast<unsigned int>(m_vecStreams.size());
+    }
+    m_vecStreams.push_back(stream);
+    m_stats.iStreamCount = static_cast<unsigned int>(m_vecStreams.size());
+    splitLocked(m_stats.iBitrate);
+    m_mtxRateMutex.Unlock();
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdRateController::SetStreamPriority(unsigned int iStreamId,
+        unsigned int iPriority) {
+    m_mtxRateMutex.Lock();
+    if (iStreamId >= m_vecStreams.size() || 0 == iPriority) {
+        m_mtxRateMutex.Unlock();
+        DMD_LOG_ERROR("CDmdRateController::SetStreamPriority(), "
+                << "invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_vecStreams[iStreamId].iPriority = iPriority;
+    splitLocked(m_stats.iBitrate);
+    m_mtxRateMutex.Unlock();
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdRateController::GetStream(unsigned int iStreamId,
+        DmdRateStream *pStream) {
+    m_mtxRateMutex.Lock();
+    if (iStreamId >= m_vecStreams.size() || NULL == pStream) {
+        m_mtxRateMutex.Unlock();
+        return DMD_S_FAIL;
+    }
+    *pStream = m_vecStreams[iStreamId];
+    m_mtxRateMutex.Unlock();
+    return DMD_S_OK;
+}
+
+// weighted water filling: minimums first, scaled down if even those do
+// not fit, then the rest by priority until a stream reaches its maximum,
+// whose excess is split again among the others;
+void CDmdRateController::splitLocked(unsigned int iBitrate) {
+    size_t ulCount = m_vecStreams.size();
+    if (0 == ulCount) {
+        return;
+    }
+    uint64_t ulMinSum = 0;
+    for (size_t i = 0; i < ulCount; i++) {
+        ulMinSum += m_vecStreams[i].iMinBitrate;
+    }
+    std::vector<uint64_t> vecShare(ulCount, 0);
+    std::vector<bool> vecCapped(ulCount, false);
+    uint64_t ulLeft = 0;
+    if (ulMinSum >= iBitrate) {
+        for (size_t i = 0; i < ulCount; i++) {
+            vecShare[i] = static_cast<uint64_t>(m_vecStreams[i].iMinBitrate)
+                * iBitrate / ulMinSum;
+        }
+    } else {
+        ulLeft = iBitrate - ulMinSum;
+        for (size_t i = 0; i < ulCount; i++) {
+            vecShare[i] = m_vecStreams[i].iMinBitrate;
+        }
+    }
+
+    while (ulLeft) {
+        uint64_t ulWeights = 0;
+        for (size_t i = 0; i < ulCount; i++) {
+            ulWeights += vecCapped[i] ? 0 : m_vecStreams[i].iPriority;
+        }
+        if (0 == ulWeights) {
+            break;  // all at their maximum, the rest goes unused;
+        }
+        bool bCapped = false;
+        for (size_t i = 0; i < ulCount; i++) {
+            const DmdRateStream &stream = m_vecStreams[i];
+            uint64_t ulOffer = ulLeft * stream.iPriority / ulWeights;
+            if (!vecCapped[i] && stream.iMaxBitrate
+                    && vecShare[i] + ulOffer >= stream.iMaxBitrate) {
+                ulLeft -= stream.iMaxBitrate - vecShare[i];
+                vecShare[i] = stream.iMaxBitrate;
+                vecCapped[i] = true;
+                bCapped = true;
+            }
+        }
+        if (bCapped) {
+            continue;
+        }
+        for (size_t i = 0; i < ulCount; i++) {
+            if (!vecCapped[i]) {
+                vecShare[i] += ulLeft * m_vecStreams[i].iPriority / ulWeights;
+            }
+        }
+        break;
+    }
+
+    for (size_t i = 0; i < ulCount; i++) {
+        DmdRateStream &stream = m_vecStreams[i];
+        stream.iBitrate = vecShare[i] ? static_cast<unsigned int>(vecShare[i])
+            : 1;
+        stream.fFrameRate = frameRateFor(stream.iBitrate);
+        stream.pEncodeStage->SetTargetRate(stream.iBitrate,
+                stream.fFrameRate);
+    }
+}
+
+void CDmdRateController::GetStats(DmdRateControlStats *pStats) {
+    if (pStats) {
+        m_mtxRateMutex.Lock();
+        *pStats = m_stats;
+        m_mtxRateMutex.Unlock();
+    }
+}
+
+void CDmdRateController::GetDecisions(
+        std::vector<DmdRateDecision> *pDecisions) {
+    if (pDecisions) {
+        m_mtxRateMutex.Lock();
+        pDecisions->assign(m_queDecisions.begin(), m_queDecisions.end());
+        m_mtxRateMutex.Unlock();
+    }
+}
+
+float CDmdRateController::frameRateFor(unsigned int iBitrate) {
+    if (iBitrate >= m_rateParam.iLowFrameRateBitrate) {
+        return m_rateParam.fMaxFrameRate;
+    }
+
+    float fFrameRate = m_rateParam.fMaxFrameRate * iBitrate
+        / m_rateParam.iLowFrameRateBitrate;
+    return fFrameRate < m_rateParam.fMinFrameRate
+        ? m_rateParam.fMinFrameRate : fFrameRate;
+}
+
+DmdRateAction CDmdRateController::decideLocked(
+        const DmdTransportFeedback &transportFeedback,
+        uint64_t ulQueueDelayUs, DmdRateReason *pReason,
+        unsigned int *pBitrate) {
+    uint64_t ulNowUs = transportFeedback.ulTimestampUs;
+    uint64_t ulBitrate = m_stats.iBitrate;
+    bool bLoss = transportFeedback.fLossRate >= m_rateParam.fHighLossRate;
+    bool bDelay = ulQueueDelayUs
+        >= static_cast<uint64_t>(m_rateParam.iHighDelayMs) * 1000;
+
+    if (bLoss || bDelay) {
+        *pReason = bLoss ? DmdRateReasonLoss : DmdRateReasonDelay;
+        if (m_ulLastDecreaseUs && ulNowUs - m_ulLastDecreaseUs
+                < static_cast<uint64_t>(m_rateParam.iDecreaseHoldMs) * 1000) {
+            return DmdRateHold;
+        }
+        // cut harder on heavy loss, never above the delivered rate;
+        uint64_t ulTarget = ulBitrate * 85 / 100;
+        if (bLoss && transportFeedback.fLossRate > 0.3f) {
+            ulTarget = ulBitrate * 70 / 100;
+        }
+        if (transportFeedback.ulSendRateBps
+                && transportFeedback.ulSendRateBps * 9 / 10 < ulTarget) {
+            ulTarget = transportFeedback.ulSendRateBps * 9 / 10;
+        }
+        if (ulTarget < m_rateParam.iMinBitrate) {
+            ulTarget = m_rateParam.iMinBitrate;
+        }
+        if (ulTarget >= ulBitrate) {
+            return DmdRateHold;
+        }
+        *pBitrate = static_cast<unsigned int>(ulTarget);
+        return DmdRateDecrease;
+    }
+
+    if (transportFeedback.ulEstimatedBps) {
+        uint64_t ulTarget = transportFeedback.ulEstimatedBps;
+        if (ulTarget < m_rateParam.iMinBitrate) {
+            ulTarget = m_rateParam.iMinBitrate;
+        } else if (ulTarget > m_rateParam.iMaxBitrate) {
+            ulTarget = m_rateParam.iMaxBitrate;
+        }
+        *pReason = DmdRateReasonEstimate;
+        // small steps would only reconfigure the encoders;
+        if (ulTarget * DMD_RATE_ESTIMATE_DEADBAND < ulBitrate
+                * (DMD_RATE_ESTIMATE_DEADBAND + 1)
+                && ulTarget * DMD_RATE_ESTIMATE_DEADBAND > ulBitrate
+                * (DMD_RATE_ESTIMATE_DEADBAND - 1)) {
+            return DmdRateHold;
+        }
+        *pBitrate = static_cast<unsigned int>(ulTarget);
+        return ulTarget < ulBitrate ? DmdRateDecrease : DmdRateIncrease;
+    }
+
+    bool bHeadroom = transportFeedback.fLossRate <= m_rateParam.fLowLossRate
+        && ulQueueDelayUs
+            <= static_cast<uint64_t>(m_rateParam.iLowDelayMs) * 1000;
+    if (!bHeadroom) {
+        *pReason = DmdRateReasonNone;
+        return DmdRateHold;
+    }
+
+    *pReason = DmdRateReasonHeadroom;
+    if (ulNowUs - m_ulLastChangeUs
+            < static_cast<uint64_t>(m_rateParam.iIncreaseHoldMs) * 1000
+            || ulBitrate >= m_rateParam.iMaxBitrate) {
+        return DmdRateHold;
+    }
+    uint64_t ulTarget = ulBitrate * 108 / 100 + 16 * 1024;
+    if (ulTarget > m_rateParam.iMaxBitrate) {
+        ulTarget = m_rateParam.iMaxBitrate;
+    }
+    if (m_stats.ulEstimatedBps && ulTarget > m_stats.ulEstimatedBps) {
+        ulTarget = m_stats.ulEstimatedBps;
+        if (ulTarget <= ulBitrate) {
+            return DmdRateHold;
+        }
+    }
+    *pBitrate = static_cast<unsigned int>(ulTarget);
+
+    return DmdRateIncrease;
+}
+
+void CDmdRateController::OnTransportFeedback(
+        const DmdTransportFeedback &transportFeedback) {
+    m_mtxRateMutex.Lock();
+    if (m_vecStreams.empty()) {
+        m_mtxRateMutex.Unlock();
+        return;
+    }
+
+    m_stats.ulFeedbackCount++;
+    if (transportFeedback.ulRttUs) {
+        m_stats.ulRttUs = transportFeedback.ulRttUs;
+    }
+    if (transportFeedback.ulEstimatedBps) {
+        m_stats.ulEstimatedBps = transportFeedback.ulEstimatedBps;
+    }
+    if (0 == m_ulLastChangeUs) {
+        m_ulLastChangeUs = transportFeedback.ulTimestampUs;
+    }
+    // bytes waiting take this long to drain at the current rate;
+    uint64_t ulQueueDelayUs = transportFeedback.ulQueueBytes * 8 * 1000000
+        / m_stats.iBitrate;
+    if (transportFeedback.ulQueueDelayUs > ulQueueDelayUs) {
+        ulQueueDelayUs = transportFeedback.ulQueueDelayUs;
+    }
+
+    DmdRateReason eReason = DmdRateReasonNone;
+    unsigned int iBitrate = m_stats.iBitrate;
+    DmdRateAction eAction = decideLocked(transportFeedback, ulQueueDelayUs,
+            &eReason, &iBitrate);
+    if (DmdRateHold == eAction) {
+        m_stats.ulHoldCount++;
+        m_mtxRateMutex.Unlock();
+        return;
+    }
+
+    if (DmdRateDecrease == eAction) {
+        m_stats.ulDecreaseCount++;
+        m_ulLastDecreaseUs = transportFeedback.ulTimestampUs;
+    } else {
+        m_stats.ulIncreaseCount++;
+    }
+    m_ulLastChangeUs = transportFeedback.ulTimestampUs;
+    m_stats.iBitrate = iBitrate;
+    m_stats.fFrameRate = frameRateFor(iBitrate);
+
+    DmdRateDecision decision;
+    decision.ulTimestampUs = transportFeedback.ulTimestampUs;
+    decision.eAction = eAction;
+    decision.eReason = eReason;
+    decision.iBitrate = iBitrate;
+    decision.fFrameRate = m_stats.fFrameRate;
+    decision.ulQueueDelayUs = ulQueueDelayUs;
+    decision.fLossRate = transportFeedback.fLossRate;
+    decision.ulSendRateBps = transportFeedback.ulSendRateBps;
+    decision.ulRttUs = m_stats.ulRttUs;
+    decision.ulEstimatedBps = m_stats.ulEstimatedBps;
+    m_queDecisions.push_back(decision);
+    if (m_queDecisions.size() > DMD_RATE_DECISION_LOG_SIZE) {
+        m_queDecisions.pop_front();
+    }
+    splitLocked(iBitrate);
+    m_mtxRateMutex.Unlock();
+
+    DMD_LOG_INFO("CDmdRateController::OnTransportFeedback(), "
+            << s_strRateAction[eAction]
+            << " for " << s_strRateReason[eReason]
+            << ", bitrate:" << iBitrate << "bps"
+            << ", frame rate:" << decision.fFrameRate
+            << ", queue delay:" << ulQueueDelayUs << "us"
+            << ", loss:" << transportFeedback.fLossRate
+            << ", send rate:" << transportFeedback.ulSendRateBps << "bps"
+            << ", rtt:" << decision.ulRttUs << "us");
+}
+
+}  // namespace opendmd
@@ -0,0 +1,199 @@
+/*
+ ============================================================================
+ * Name        : CDmdRateController.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdRateController.h
+ ============================================================================
+ */
+
+#ifndef SRC_ENCODE_CDMDRATECONTROLLER_H
+#define SRC_ENCODE_CDMDRATECONTROLLER_H
+
+#include <deque>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+
+#include "thread/DmdThreadMutex.h"
+
+#include "CDmdEncodeStage.h"
+
+namespace opendmd {
+
+#define DMD_RATE_DEFAULT_MIN_BITRATE            (128 * 1024)
+#define DMD_RATE_DEFAULT_MAX_BITRATE            (8 * 1024 * 1024)
+#define DMD_RATE_DEFAULT_MIN_FRAMERATE          5.0f
+#define DMD_RATE_DEFAULT_LOW_FRAMERATE_BITRATE  (512 * 1024)
+#define DMD_RATE_DEFAULT_HIGH_DELAY_MS          200
+#define DMD_RATE_DEFAULT_LOW_DELAY_MS           50
+#define DMD_RATE_DEFAULT_HIGH_LOSS_RATE         0.10f
+#define DMD_RATE_DEFAULT_LOW_LOSS_RATE          0.02f
+#define DMD_RATE_DEFAULT_DECREASE_HOLD_MS       300
+#define DMD_RATE_DEFAULT_INCREASE_HOLD_MS       1000
+#define DMD_RATE_DECISION_LOG_SIZE              64
+// estimates within 1/20 of the bitrate leave it;
+#define DMD_RATE_ESTIMATE_DEADBAND              20
+
+// the bitrates are of all streams together;
+typedef struct {
+    unsigned int    iStartBitrate;        // in bps;
+    unsigned int    iMinBitrate;
+    unsigned int    iMaxBitrate;
+    float           fMaxFrameRate;
+    float           fMinFrameRate;
+    unsigned int    iLowFrameRateBitrate; // frame rate scales down below;
+    unsigned int    iHighDelayMs;         // congested at or above;
+    unsigned int    iLowDelayMs;          // headroom at or below;
+    float           fHighLossRate;
+    float           fLowLossRate;
+    unsigned int    iDecreaseHoldMs;      // between two decreases;
+    unsigned int    iIncreaseHoldMs;      // after any change;
+} DmdRateControlParam;
+
+typedef enum {
+    DmdRateHold = 0,
+    DmdRateIncrease,
+    DmdRateDecrease,
+} DmdRateAction;
+
+typedef enum {
+    DmdRateReasonNone = 0,
+    DmdRateReasonLoss,
+    DmdRateReasonDelay,
+    DmdRateReasonHeadroom,
+    DmdRateReasonEstimate,
+} DmdRateReason;
+
+typedef struct {
+    uint64_t        ulTimestampUs;
+    DmdRateAction   eAction;
+    DmdRateReason   eReason;
+    unsigned int    iBitrate;             // after the decision;
+    float           fFrameRate;
+    uint64_t        ulQueueDelayUs;       // as seen by the decision;
+    float           fLossRate;
+    uint64_t        ulSendRateBps;
+    uint64_t        ulRttUs;              // last reported, 0 if unknown;
+    uint64_t        ulEstimatedBps;       // last estimate, 0 if none;
+} DmdRateDecision;
+
+typedef struct {
+    uint64_t        ulFeedbackCount;
+    uint64_t        ulIncreaseCount;
+    uint64_t        ulDecreaseCount;
+    uint64_t        ulHoldCount;
+    unsigned int    iBitrate;
+    float           fFrameRate;
+    uint64_t        ulRttUs;              // last reported, 0 if unknown;
+    uint64_t        ulEstimatedBps;       // last estimate, 0 if none;
+    unsigned int    iStreamCount;
+} DmdRateControlStats;
+
+// one camera of a client, its share of the aggregate;
+typedef struct {
+    CDmdEncodeStage *pEncodeStage;
+    unsigned int    iPriority;            // weight of the share, >= 1;
+    unsigned int    iMinBitrate;          // 0 for none;
+    unsigned int    iMaxBitrate;          // 0 for none;
+    unsigned int    iBitrate;             // as last split;
+    float           fFrameRate;
+} DmdRateStream;
+
+/*
+ * Adapts the encoder to the uplink from transport feedback. Loss or queue
+ * delay above the high marks cuts the bitrate at once, at most once per
+ * decrease hold, and never above what the link measured it delivered; it
+ * is raised by a small step only when both stay below the low marks for a
+ * whole increase hold. Between the marks the rate is held, which keeps it
+ * from oscillating around the link capacity. Frame rate follows bitrate
+ * below iLowFrameRateBitrate, so that a starved link gets fewer but still
+ * watchable frames.
+ *
+ * Feedback carrying a bandwidth estimate, from the delay gradient of the
+ * sender side estimator, is followed instead of stepping: the estimator
+ * already paces its own increases and decreases, the controller only
+ * skips changes within a few percent. The marks still cut on loss and
+ * on the local send queue, and the last estimate caps any increase.
+ *
+ * The cameras of a client share one transport, so one controller drives
+ * all of their encoders: the aggregate rate is split by priority weight,
+ * each stream first getting its minimum and none more than its maximum,
+ * what a capped stream leaves going to the others. Each stream's frame
+ * rate then follows its own share.
+ */
+class CDmdRateController : public IDmdTransportFeedbackSink {
+public:
+    CDmdRateController();
+    ~CDmdRateController();
+
+    // pEncodeStage may be NULL, streams are then added by AddStream();
+    DMD_RESULT Init(const DmdRateControlParam &rateParam,
+            CDmdEncodeStage *pEncodeStage);
+    DMD_RESULT Uninit();
+
+    DMD_RESULT AddStream(CDmdEncodeStage *pEncodeStage,
+            unsigned int iPriority, unsigned int iMinBitrate,
+            unsigned int iMaxBitrate, unsigned int *pStreamId);
+    DMD_RESULT SetStreamPriority(unsigned int iStreamId,
+            unsigned int iPriority);
+    DMD_RESULT GetStream(unsigned int iStreamId, DmdRateStream *pStream);
+
+    void GetStats(DmdRateControlStats *pStats);
+    // rate changes, oldest first, at most DMD_RATE_DECISION_LOG_SIZE;
+    void GetDecisions(std::vector<DmdRateDecision> *pDecisions);
+
+    // IDmdTransportFeedbackSink interface, transport thread side;
+    void OnTransportFeedback(const DmdTransportFeedback &transportFeedback);
+
+private:
+    DmdRateAction decideLocked(const DmdTransportFeedback &transportFeedback,
+            uint64_t ulQueueDelayUs, DmdRateReason *pReason,
+            unsigned int *pBitrate);
+    float frameRateFor(unsigned int iBitrate);
+    void splitLocked(unsigned int iBitrate);
+
+private:
+    DmdRateControlParam    m_rateParam;
+    std::vector<DmdRateStream> m_vecStreams;
+    DmdThreadMutex         m_mtxRateMutex;
+    DmdRateControlStats    m_stats;
+    std::deque<DmdRateDecision> m_queDecisions;
+    uint64_t               m_ulLastChangeUs;
+    uint64_t               m_ulLastDecreaseUs;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_ENCODE_CDMDRATECONTROLLER_H
@@ -53,6 +53,13 @@ typedef struct {
     char            sVideoDevice[maxDeviceNameLength];
 } DmdCaptureVideoFormat;
 
+class IDmdCaptureEngineSink {
+public:
+    IDmdCaptureEngineSink() {}
+    virtual ~IDmdCaptureEngineSink() {}
+    virtual DMD_RESULT DeliverVideoData(DmdVideoRawData *pVideoRawData) = 0;
+};
+
 class IDmdCaptureEngine {
  public:
     IDmdCaptureEngine() {}
@@ -61,19 +68,15 @@ class IDmdCaptureEngine {
     virtual DMD_RESULT Init(const DmdCaptureVideoFormat &capVideoFormat) = 0;
     virtual DMD_RESULT Uninit() = 0;
 
+    // captured frames are delivered to pDataSink at capture thread;
+    virtual DMD_RESULT SetDataSink(IDmdCaptureEngineSink *pDataSink) = 0;
+
     virtual DMD_RESULT StartCapture() = 0;
     virtual DMD_BOOL   IsCapturing() = 0;
     virtual DMD_RESULT RunCaptureLoop() = 0;
     virtual DMD_RESULT StopCapture() = 0;
 };
 
-class IDmdCaptureEngineSink {
-public:
-    IDmdCaptureEngineSink() {}
-    virtual ~IDmdCaptureEngineSink() {}
-    virtual DMD_RESULT DeliverVideoData(DmdVideoRawData *pVideoRawData) = 0;
-};
-
 }  // namespace opendmd
 
 #endif  // SRC_INCLUDE_IDMDCAPTUREENGINE_H
@@ -85,12 +85,27 @@ typedef struct {
     unsigned int    iWidth;
     unsigned int    iHeight;
     float           fFrameRate;
-    uint64_t        ulTimestamp;
+    uint64_t        ulTimestamp;  // capture time, in microseconds;
 } DmdVideoFormat;
 
 #define MAX_PLANE_COUNT 3
 #define MAX_PLANAR_NUM 4
 
+// per frame flags, filled by the preprocess stage;
+#define DMD_FRAME_FLAG_MOTION_ANALYSED  0x1  // motion detector has run;
+#define DMD_FRAME_FLAG_MOTION           0x2  // scene changed since last frame;
+#define DMD_FRAME_FLAG_BACKGROUND       0x4  // changed back to the background;
+
+// reference counted owner of frame planes, a consumer may keep the planes
+// beyond the delivery call by holding a reference;
+class IDmdFrameBuffer {
+public:
+    IDmdFrameBuffer() {}
+    virtual ~IDmdFrameBuffer() {}
+    virtual void AddRef() = 0;
+    virtual void Release() = 0;
+};
+
 typedef struct {
     uint8_t         *pSrcData;
     uint8_t         *pSrcDataPanel[MAX_PLANAR_NUM];
@@ -100,6 +115,8 @@ typedef struct {
     size_t          ulPlaneCount;
     unsigned int    ulRotation;
     size_t          ulDataLen;
+    IDmdFrameBuffer *pFrameBuffer;  // NULL if only valid during delivery;
+    uint32_t        ulFrameFlags;   // DMD_FRAME_FLAG_*;
 } DmdVideoRawData;
 
 }  // namespace opendmd
@@ -0,0 +1,162 @@
+/*
+ ============================================================================
+ * Name        : IDmdEncodeEngine.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file to define video encode engine interface.
+ ============================================================================
+ */
+
+#ifndef SRC_INCLUDE_IDMDENCODEENGINE_H
+#define SRC_INCLUDE_IDMDENCODEENGINE_H
+
+#include <sys/uio.h>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+typedef enum {
+    DmdRcQuality = 0,   // quality first, bitrate is a hint;
+    DmdRcBitrate,       // hold target bitrate;
+    DmdRcBufferBased,   // no bitrate control, only buffer status;
+    DmdRcTimestamp,     // bitrate control based on frame timestamp;
+    DmdRcOff,           // constant qp;
+} DmdRateControlMode;
+
+typedef enum {
+    DmdComplexityLow = 0,
+    DmdComplexityMedium,
+    DmdComplexityHigh,
+} DmdComplexityMode;
+
+// per camera encoder settings;
+typedef struct {
+    unsigned int        iWidth;          // 0 to follow the input frame;
+    unsigned int        iHeight;
+    float               fFrameRate;
+    unsigned int        iTargetBitrate;  // in bps;
+    unsigned int        iMaxBitrate;     // in bps, 0 for unspecified;
+    unsigned int        iGopSize;        // idr period in frames, 0 for once;
+    DmdRateControlMode  eRcMode;
+    DmdComplexityMode   eComplexity;
+    unsigned int        iThreadCount;    // encoder internal threads, 0 auto;
+    unsigned int        iSliceCount;     // slices per frame, 0 for one;
+    bool                bEnableFrameSkip;
+    bool                bEnableLtr;      // long term reference, surveillance;
+    unsigned int        iLtrMarkPeriod;  // frames between background marks;
+    // every other p frame in a second temporal layer, nri 0, for senders
+    // that drop non-reference frames; ignored with bEnableLtr;
+    bool                bNonReferenceFrames;
+} DmdEncodeParam;
+
+#define DMD_ENCODE_DEFAULT_FRAMERATE    30.0f
+#define DMD_ENCODE_DEFAULT_BITRATE      (1024 * 1024)
+#define DMD_ENCODE_DEFAULT_GOPSIZE      60
+#define DMD_ENCODE_DEFAULT_LTR_PERIOD   30
+
+typedef enum {
+    DmdFrameInvalid = 0,
+    DmdFrameIDR,
+    DmdFrameI,
+    DmdFrameP,
+    DmdFrameSkip,
+} DmdEncodedFrameType;
+
+// simulcast layers of a camera, each an independent h.264 stream;
+typedef enum {
+    DmdLayerRecord = 0,  // full resolution, gated by motion;
+    DmdLayerDetect,      // reduced resolution, continuous, for detection;
+} DmdEncodeLayer;
+
+/*
+ * pData is the whole access unit in annex-b, pNalIov lists its nal units
+ * without start codes, pointing into pData; a packetizer sends the iovecs
+ * and a disk writer the annex-b bytes, with no copy in between. Both live
+ * in pFrameBuffer, a consumer keeps them beyond the delivery call by
+ * taking a reference.
+ */
+typedef struct {
+    uint8_t             *pData;          // annex-b, start codes included;
+    size_t              ulDataLen;
+    unsigned int        iNalCount;
+    const struct iovec  *pNalIov;        // iNalCount entries;
+    IDmdFrameBuffer     *pFrameBuffer;   // owns pData and pNalIov;
+    DmdEncodedFrameType eFrameType;
+    unsigned int        iWidth;
+    unsigned int        iHeight;
+    uint64_t            ulTimestamp;     // capture time, in microseconds;
+    DmdEncodeLayer      eLayer;          // set by the encode stage;
+    bool                bMotion;         // record layer, gate active; set by
+                                         // the encode stage;
+} DmdEncodedFrame;
+
+class IDmdEncodeEngineSink {
+public:
+    IDmdEncodeEngineSink() {}
+    virtual ~IDmdEncodeEngineSink() {}
+    // pData is only valid during the call, unless pFrameBuffer is held;
+    virtual DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) = 0;
+};
+
+class IDmdEncodeEngine {
+public:
+    IDmdEncodeEngine() {}
+    virtual ~IDmdEncodeEngine() {}
+
+    virtual DMD_RESULT Init(const DmdEncodeParam &encodeParam) = 0;
+    virtual DMD_RESULT Uninit() = 0;
+
+    virtual DMD_RESULT SetDataSink(IDmdEncodeEngineSink *pDataSink) = 0;
+    // creates the encoder for the expected input ahead of the first frame,
+    // which is otherwise paid at that frame; from the encoding thread, or
+    // before it starts;
+    virtual DMD_RESULT Prepare(unsigned int iWidth, unsigned int iHeight) = 0;
+
+    // synchronous, encoded data is delivered before return;
+    virtual DMD_RESULT EncodeFrame(const DmdVideoRawData *pVideoRawData) = 0;
+    virtual DMD_RESULT ForceIntraFrame() = 0;
+    // applied on the fly, without re-creating the encoder;
+    virtual DMD_RESULT SetRateControl(unsigned int iTargetBitrate,
+            float fFrameRate) = 0;
+    virtual DMD_RESULT SetComplexity(DmdComplexityMode eComplexity) = 0;
+    // long term reference, with bEnableLtr only; marking is paused while
+    // the scene changes, so the reference keeps the clean background, and
+    // the next frame may be predicted from it instead of the last frame;
+    virtual DMD_RESULT SetLtrRefresh(bool bRefresh) = 0;
+    virtual DMD_RESULT ForceLtrReference() = 0;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_INCLUDE_IDMDENCODEENGINE_H
@@ -37,12 +37,15 @@
  */
 
 #include <pthread.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "DmdLog.h"
 #include "DmdSignal.h"
+#include "DmdTimeUtils.h"
 #include "CDmdCaptureEngine.h"
 #include "CDmdCaptureThread.h"
+#include "CDmdEncodeThread.h"
 
 #include "thread/DmdThreadManager.h"
 #include "client/DmdClientThreads.h"
@@ -52,8 +55,11 @@
 
 namespace opendmd {
 
-DmdClient::DmdClient() {
-    Init();
+DmdClient::DmdClient() : m_bStartupReported(false) {
+    uint64_t ulStart = DmdGetTickCountUs();
+    DMD_RESULT ret = Init();
+    m_startup.AddPhase("init", ulStart, DmdGetTickCountUs(),
+            DMD_S_OK == ret);
 }
 DmdClient::~DmdClient() {
     UnInit();
@@ -61,6 +67,11 @@ DmdClient::~DmdClient() {
 
 DMD_RESULT DmdClient::Init() {
     m_pCaptureEngine = NULL;
+    m_pPreprocessor = NULL;
+    m_pEncodeStage = NULL;
+    m_pEncodeScheduler = NULL;
+    m_pRateController = NULL;
+    memset(&m_captureThreadParam, 0, sizeof(m_captureThreadParam));
     CreateVideoCaptureEngine(&m_pCaptureEngine);
     if (nullptr == m_pCaptureEngine) {
         DMD_LOG_ERROR("DmdClient::Init(), "
@@ -68,14 +79,127 @@ DMD_RESULT DmdClient::Init() {
         return DMD_S_FAIL;
     }
 
+    // preprocess captured frames before encoding and detection;
+    DmdPreprocessParam preprocessParam;
+    memset(&preprocessParam, 0, sizeof(preprocessParam));
+    preprocessParam.denoiseParam.iStrength = DMD_DENOISE_DEFAULT_STRENGTH;
+    preprocessParam.denoiseParam.iThreshold = DMD_DENOISE_DEFAULT_THRESHOLD;
+    preprocessParam.motionParam.bEnable = true;
+    preprocessParam.motionParam.iBlockSize = DMD_MOTION_DEFAULT_BLOCK_SIZE;
+    preprocessParam.motionParam.iPixelThreshold =
+        DMD_MOTION_DEFAULT_PIXEL_THRESHOLD;
+    preprocessParam.motionParam.iMinChangedPermille =
+        DMD_MOTION_DEFAULT_MIN_PERMILLE;
+    m_pPreprocessor = new CDmdPreprocessor();
+    m_pPreprocessor->Init(preprocessParam);
+    m_pCaptureEngine->SetDataSink(m_pPreprocessor);
+
+    // encode preprocessed frames at encode thread;
+    DmdEncodeParam encodeParam;
+    memset(&encodeParam, 0, sizeof(encodeParam));
+    encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+    encodeParam.iTargetBitrate = DMD_ENCODE_DEFAULT_BITRATE;
+    encodeParam.iGopSize = DMD_ENCODE_DEFAULT_GOPSIZE;
+    encodeParam.eRcMode = DmdRcBitrate;
+    encodeParam.eComplexity = DmdComplexityMedium;
+    encodeParam.iThreadCount = 1;
+    encodeParam.bEnableFrameSkip = true;
+    m_pEncodeStage = new CDmdEncodeStage();
+    if (DMD_S_OK != m_pEncodeStage->Init(encodeParam,
+                DMD_ENCODE_DEFAULT_QUEUE_DEPTH)) {
+        DMD_LOG_ERROR("DmdClient::Init(), init encode stage failed");
+        return DMD_S_FAIL;
+    }
+    DmdMotionGateParam gateParam;
+    memset(&gateParam, 0, sizeof(gateParam));
+    gateParam.bEnable = true;
+    gateParam.fIdleFrameRate = DMD_MOTION_GATE_DEFAULT_IDLE_FRAMERATE;
+    gateParam.iIdleBitrate = DMD_MOTION_GATE_DEFAULT_IDLE_BITRATE;
+    gateParam.iHangoverMs = DMD_MOTION_GATE_DEFAULT_HANGOVER_MS;
+    gateParam.iHeartbeatMs = DMD_MOTION_GATE_DEFAULT_HEARTBEAT_MS;
+    m_pEncodeStage->SetMotionGate(gateParam);
+    // low resolution layer stays continuous for server side detection;
+    DmdDetectLayerParam detectParam;
+    memset(&detectParam, 0, sizeof(detectParam));
+    detectParam.bEnable = true;
+    detectParam.iScaleDivisor = DMD_DETECT_LAYER_DEFAULT_DIVISOR;
+    detectParam.iTargetBitrate = DMD_DETECT_LAYER_DEFAULT_BITRATE;
+    detectParam.fFrameRate = DMD_DETECT_LAYER_DEFAULT_FRAMERATE;
+    if (DMD_S_OK != m_pEncodeStage->SetDetectLayer(detectParam)) {
+        DMD_LOG_ERROR("DmdClient::Init(), set detect layer failed");
+        return DMD_S_FAIL;
+    }
+    m_pPreprocessor->SetDataSink(m_pEncodeStage);
+
+    // encode workers are shared by all cameras, never more than cores;
+    unsigned int iCameraCount = 1;
+    long lCoreCount = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int iWorkerCount = lCoreCount > 0
+        && static_cast<unsigned int>(lCoreCount) < iCameraCount
+        ? static_cast<unsigned int>(lCoreCount) : iCameraCount;
+    m_pEncodeScheduler = new CDmdEncodeScheduler();
+    if (DMD_S_OK != m_pEncodeScheduler->Init(iWorkerCount,
+                DMD_ENCODE_SCHEDULER_WINDOW_MS)
+            || DMD_S_OK != m_pEncodeScheduler->AddCamera(m_pEncodeStage,
+                0, NULL)) {
+        DMD_LOG_ERROR("DmdClient::Init(), init encode scheduler failed");
+        // no scheduler tells CreateAndSpawnThreads() there are no workers;
+        delete m_pEncodeScheduler;
+        m_pEncodeScheduler = NULL;
+        return DMD_S_FAIL;
+    }
+
+    // fed by the transport, follows the uplink;
+    DmdRateControlParam rateParam;
+    memset(&rateParam, 0, sizeof(rateParam));
+    rateParam.iStartBitrate = encodeParam.iTargetBitrate;
+    rateParam.iMinBitrate = DMD_RATE_DEFAULT_MIN_BITRATE;
+    rateParam.iMaxBitrate = DMD_RATE_DEFAULT_MAX_BITRATE;
+    rateParam.fMaxFrameRate = encodeParam.fFrameRate;
+    rateParam.fMinFrameRate = DMD_RATE_DEFAULT_MIN_FRAMERATE;
+    rateParam.iLowFrameRateBitrate = DMD_RATE_DEFAULT_LOW_FRAMERATE_BITRATE;
+    rateParam.iHighDelayMs = DMD_RATE_DEFAULT_HIGH_DELAY_MS;
+    rateParam.iLowDelayMs = DMD_RATE_DEFAULT_LOW_DELAY_MS;
+    rateParam.fHighLossRate = DMD_RATE_DEFAULT_HIGH_LOSS_RATE;
+    rateParam.fLowLossRate = DMD_RATE_DEFAULT_LOW_LOSS_RATE;
+    rateParam.iDecreaseHoldMs = DMD_RATE_DEFAULT_DECREASE_HOLD_MS;
+    rateParam.iIncreaseHoldMs = DMD_RATE_DEFAULT_INCREASE_HOLD_MS;
+    m_pRateController = new CDmdRateController();
+    if (DMD_S_OK != m_pRateController->Init(rateParam, m_pEncodeStage)) {
+        DMD_LOG_ERROR("DmdClient::Init(), init rate controller failed");
+        return DMD_S_FAIL;
+    }
+
     return DMD_S_OK;
 }
 
 DMD_RESULT DmdClient::UnInit() {
     if (m_pCaptureEngine) {
+        m_pCaptureEngine->SetDataSink(NULL);
         ReleaseVideoCaptureEngine(&m_pCaptureEngine);
         m_pCaptureEngine = NULL;
     }
+    if (m_pPreprocessor) {
+        m_pPreprocessor->SetDataSink(NULL);
+        m_pPreprocessor->Uninit();
+        delete m_pPreprocessor;
+        m_pPreprocessor = NULL;
+    }
+    if (m_pRateController) {
+        m_pRateController->Uninit();
+        delete m_pRateController;
+        m_pRateController = NULL;
+    }
+    if (m_pEncodeScheduler) {
+        m_pEncodeScheduler->Uninit();
+        delete m_pEncodeScheduler;
+        m_pEncodeScheduler = NULL;
+    }
+    if (m_pEncodeStage) {
+        m_pEncodeStage->Uninit();
+        delete m_pEncodeStage;
+        m_pEncodeStage = NULL;
+    }
 
     return DMD_S_OK;
 }
@@ -104,7 +228,13 @@ void DmdClient::InitSignal() {
     }
 }
 
-void DmdClient::CreateAndSpawnThreads() {
+DMD_RESULT DmdClient::CreateAndSpawnThreads() {
+    if (NULL == m_pEncodeScheduler) {
+        DMD_LOG_ERROR("DmdClient::CreateAndSpawnThreads(), "
+                << "encode scheduler not initialized");
+        return DMD_S_FAIL;
+    }
+
     // create signal manager thread;
     DmdThreadType eSignalManagerThread = DMD_THREAD_SIGMGR;
     DmdThreadRoutine pSigMgrRoutine = SignalManagerThreadRoutine;
@@ -113,11 +243,71 @@ void DmdClient::CreateAndSpawnThreads() {
     // create capture thread;
     DmdThreadType eCaptureThread = DMD_THREAD_CAPTURE;
     DmdThreadRoutine pCaptureRoutine = CaptureThreadRoutine;
+    m_captureThreadParam.pCaptureEngine = m_pCaptureEngine;
+    m_captureThreadParam.pStartup = &m_startup;
     g_ThreadManager->addThread(eCaptureThread, pCaptureRoutine,
-            m_pCaptureEngine);
+            &m_captureThreadParam);
+
+    // create encode worker threads;
+    if (DMD_S_OK != m_pEncodeScheduler->AddWorkerThreads(g_ThreadManager)) {
+        DMD_LOG_ERROR("DmdClient::CreateAndSpawnThreads(), "
+                << "add encode worker threads failed");
+        return DMD_S_FAIL;
+    }
 
     // spawn all working thread;
     g_ThreadManager->spawnAllThreads();
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT DmdClient::warmupEncoder(void *pParam) {
+    DmdClient *pClient = reinterpret_cast<DmdClient *>(pParam);
+    return pClient->m_pEncodeStage->Warmup(DMD_CAPTURE_DEFAULT_WIDTH,
+            DMD_CAPTURE_DEFAULT_HEIGHT);
+}
+
+DMD_RESULT DmdClient::warmupFramePool(void *pParam) {
+    DmdClient *pClient = reinterpret_cast<DmdClient *>(pParam);
+    return pClient->m_pPreprocessor->Warmup(DMD_CAPTURE_DEFAULT_WIDTH,
+            DMD_CAPTURE_DEFAULT_HEIGHT, DMD_CLIENT_WARMUP_FRAME_COUNT);
+}
+
+DMD_RESULT DmdClient::Warmup() {
+    if (NULL == m_pEncodeStage || NULL == m_pPreprocessor) {
+        DMD_LOG_ERROR("DmdClient::Warmup(), not initialized");
+        return DMD_S_FAIL;
+    }
+
+    // independent of each other and of the cameras, a failure only costs
+    // the first frame the time saved here;
+    DmdStartupTask arrTasks[] = {
+        {"encoder warmup", warmupEncoder, this},
+        {"frame pool", warmupFramePool, this},
+    };
+    DMD_RESULT ret = m_startup.RunParallel(arrTasks,
+            sizeof(arrTasks) / sizeof(arrTasks[0]));
+    if (DMD_S_OK != ret) {
+        DMD_LOG_WARNING("DmdClient::Warmup(), warm up incomplete");
+    }
+
+    return ret;
+}
+
+void DmdClient::reportStartup() {
+    if (m_bStartupReported || NULL == m_pEncodeStage) {
+        return;
+    }
+    DmdEncodeStats stats;
+    m_pEncodeStage->GetStats(&stats);
+    if (0 == stats.ulFirstFrameUs) {
+        return;
+    }
+
+    m_startup.AddPhase("first frame", m_startup.GetStartUs(),
+            stats.ulFirstFrameUs);
+    m_startup.Report();
+    m_bStartupReported = true;
 }
 
 void DmdClient::ExitAndCleanThreads() {
@@ -132,15 +322,24 @@ void DmdClient::ExitAndCleanThreads() {
 int DmdClient::DmdClientMain(int argc, char *argv[]) {
     DMD_LOG_INFO("At the beginning of client_main function");
 
+    uint64_t ulStart = DmdGetTickCountUs();
     InitGlobalThreadManager();
     InitSignal();
+    m_startup.AddPhase("signal", ulStart, DmdGetTickCountUs());
 
     if (1) {
-        // create and spawn threads;
-        CreateAndSpawnThreads();
+        // create and spawn threads, cameras open on their capture threads;
+        ulStart = DmdGetTickCountUs();
+        if (DMD_S_OK != CreateAndSpawnThreads()) {
+            DMD_LOG_ERROR("client_main(), create threads failed");
+            return DMD_S_FAIL;
+        }
+        m_startup.AddPhase("spawn threads", ulStart, DmdGetTickCountUs());
+        Warmup();
 
         while (g_bMainThreadRunning) {
             sleep(1);
+            reportStartup();
             DMD_LOG_INFO("client_main(), main thread is running");
         }
 
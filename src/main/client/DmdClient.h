@@ -41,8 +41,19 @@
 
 #include "IDmdDatatype.h"
 #include "IDmdCaptureEngine.h"
+#include "CDmdPreprocessor.h"
+#include "CDmdEncodeScheduler.h"
+#include "CDmdEncodeStage.h"
+#include "CDmdRateController.h"
+#include "CDmdCaptureThread.h"
+#include "DmdStartup.h"
 
 namespace opendmd {
+
+// output frames in flight: the queue, the one encoding and the one being
+// preprocessed;
+#define DMD_CLIENT_WARMUP_FRAME_COUNT (DMD_ENCODE_DEFAULT_QUEUE_DEPTH + 2)
+
 class DmdClient {
 public:
     DmdClient();
@@ -53,13 +64,27 @@ public:
 
     DMD_RESULT InitGlobalThreadManager();
     void InitSignal();
-    void CreateAndSpawnThreads();
+    DMD_RESULT CreateAndSpawnThreads();
     void ExitAndCleanThreads();
+    // encoders and pools are set up while the cameras open;
+    DMD_RESULT Warmup();
 
     int DmdClientMain(int argc, char *argv[]);
 
 private:
+    static DMD_RESULT warmupEncoder(void *pParam);
+    static DMD_RESULT warmupFramePool(void *pParam);
+    void reportStartup();
+
+private:
+    DmdStartup         m_startup;
+    bool               m_bStartupReported;
+    DmdCaptureThreadParam m_captureThreadParam;
     IDmdCaptureEngine *m_pCaptureEngine;
+    CDmdPreprocessor  *m_pPreprocessor;
+    CDmdEncodeStage   *m_pEncodeStage;
+    CDmdEncodeScheduler *m_pEncodeScheduler;
+    CDmdRateController *m_pRateController;
 };
 }  // namespace opendmd
 
@@ -43,6 +43,7 @@
 #include "DmdLog.h"
 #include "DmdSignal.h"
 #include "CDmdCaptureThread.h"
+#include "CDmdEncodeThread.h"
 #include "thread/DmdThreadUtils.h"
 #include "thread/DmdThread.h"
 #include "thread/DmdThreadManager.h"
@@ -71,6 +72,7 @@ void *SignalManagerThreadRoutine(void *param) {
             DMD_LOG_INFO("SignalManagerThreadRoutine(), "
                          "receive signal " << DmdSignalToString(sig));
             g_bCaptureThreadRunning = false;
+            g_bEncodeThreadRunning = false;
             g_bMainThreadRunning = false;
             break;
         }
@@ -0,0 +1,472 @@
+/*
+ ============================================================================
+ * Name        : CDmdBandwidthEstimator.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdBandwidthEstimator.cpp
+ ============================================================================
+ */
+
+#include "CDmdBandwidthEstimator.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+#define DMD_BWE_SEND_HISTORY_MASK   (DMD_BWE_SEND_HISTORY_SIZE - 1)
+// the receiver's clock starts here, arrival offsets count back from it;
+#define DMD_BWE_REPORT_CLOCK_BASE   (1ULL << 40)
+// a decrease shows in the feedback a round trip and this much later;
+#define DMD_BWE_RESPONSE_US         100000
+
+static bool earlierSent(const std::pair<uint64_t, size_t> &left,
+        const std::pair<uint64_t, size_t> &right) {
+    return left.first < right.first;
+}
+
+CDmdBandwidthEstimator::CDmdBandwidthEstimator() : m_pFeedbackSink(NULL),
+        m_ulRttUs(DMD_BWE_DEFAULT_RTT_US), m_ulLastStream(0),
+        m_bReportClock(false), m_iLastReportTimestamp(0), m_ulReportUs(0),
+        m_bGroup(false), m_bPrevGroup(false), m_fFirstArrivalMs(0),
+        m_fAccumulatedDelayMs(0), m_fSmoothedDelayMs(0), m_iDeltaCount(0),
+        m_fPrevSlope(0), m_fOveruseTimeMs(-1), m_iOveruseCounter(0),
+        m_fLastThresholdMs(-1), m_ulAckedBytes(0), m_iLossWindowCount(0),
+        m_iLossWindowLost(0), m_bLossEvaluated(false), m_fEstimate(0),
+        m_fLinkCapacity(0), m_ulLastUpdateUs(0), m_ulLastDecreaseUs(0) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_curGroup, 0, sizeof(m_curGroup));
+    memset(&m_prevGroup, 0, sizeof(m_prevGroup));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdBandwidthEstimator::~CDmdBandwidthEstimator() {
+}
+
+DMD_RESULT CDmdBandwidthEstimator::Init(const DmdBweParam &bweParam) {
+    DMD_LOG_INFO("CDmdBandwidthEstimator::Init()"
+            << ", start bitrate = " << bweParam.iStartBitrate
+            << ", bitrate range = [" << bweParam.iMinBitrate
+            << ", " << bweParam.iMaxBitrate << "]");
+    if (0 == bweParam.iMinBitrate
+            || bweParam.iMinBitrate > bweParam.iMaxBitrate) {
+        DMD_LOG_ERROR("CDmdBandwidthEstimator::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = bweParam;
+    m_vecStreams.clear();
+    m_ulLastStream = 0;
+    m_bReportClock = false;
+    m_bGroup = false;
+    m_bPrevGroup = false;
+    m_fAccumulatedDelayMs = 0;
+    m_fSmoothedDelayMs = 0;
+    m_queTrendline.clear();
+    m_iDeltaCount = 0;
+    m_fPrevSlope = 0;
+    m_fOveruseTimeMs = -1;
+    m_iOveruseCounter = 0;
+    m_fLastThresholdMs = -1;
+    m_queAckedBytes.clear();
+    m_ulAckedBytes = 0;
+    m_iLossWindowCount = 0;
+    m_iLossWindowLost = 0;
+    m_bLossEvaluated = false;
+    m_fLinkCapacity = 0;
+    m_ulLastUpdateUs = 0;
+    m_ulLastDecreaseUs = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.fThreshold = DMD_BWE_INITIAL_THRESHOLD_MS;
+    setEstimate(bweParam.iStartBitrate);
+    return DMD_S_OK;
+}
+
+void CDmdBandwidthEstimator::SetFeedbackSink(
+        IDmdTransportFeedbackSink *pFeedbackSink) {
+    m_pFeedbackSink = pFeedbackSink;
+}
+
+void CDmdBandwidthEstimator::SetRtt(uint64_t ulRttUs) {
+    if (ulRttUs) {
+        m_ulRttUs = ulRttUs;
+    }
+}
+
+CDmdBandwidthEstimator::DmdBweStream *CDmdBandwidthEstimator::findStream(
+        uint32_t iSsrc) {
+    if (m_ulLastStream < m_vecStreams.size()
+            && m_vecStreams[m_ulLastStream].iSsrc == iSsrc) {
+        return &m_vecStreams[m_ulLastStream];
+    }
+    for (size_t i = 0; i < m_vecStreams.size(); i++) {
+        if (m_vecStreams[i].iSsrc == iSsrc) {
+            m_ulLastStream = i;
+            return &m_vecStreams[i];
+        }
+    }
+    return NULL;
+}
+
+void CDmdBandwidthEstimator::OnPacketsSent(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, uint64_t ulNowUs) {
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        const DmdRtpPacket &packet = pPackets[i];
+        if (0 == packet.iIovCount
+                || packet.pIov[0].iov_len < DMD_RTP_HEADER_SIZE) {
+            continue;
+        }
+        const uint8_t *pHeader =
+            static_cast<const uint8_t *>(packet.pIov[0].iov_base);
+        uint32_t iSsrc = (static_cast<uint32_t>(pHeader[8]) << 24)
+            | (pHeader[9] << 16) | (pHeader[10] << 8) | pHeader[11];
+        DmdBweStream *pStream = findStream(iSsrc);
+        if (NULL == pStream) {
+            DmdBweStream stream;
+            stream.iSsrc = iSsrc;
+            DmdBweSent emptySent = {0, false, 0, 0};
+            stream.vecSent.assign(DMD_BWE_SEND_HISTORY_SIZE, emptySent);
+            m_vecStreams.push_back(stream);
+            m_ulLastStream = m_vecStreams.size() - 1;
+            pStream = &m_vecStreams.back();
+        }
+        DmdBweSent &sent =
+            pStream->vecSent[packet.iSequence & DMD_BWE_SEND_HISTORY_MASK];
+        sent.iSequence = packet.iSequence;
+        sent.bPending = true;
+        sent.iSize = static_cast<uint32_t>(packet.ulSize);
+        sent.ulSendUs = ulNowUs;
+    }
+}
+
+DMD_RESULT CDmdBandwidthEstimator::OnRtcp(const uint8_t *pData,
+        size_t ulSize, uint64_t ulNowUs) {
+    std::vector<DmdRtcpCcfb> vecFeedbacks;
+    if (DMD_S_OK != DmdRtcpParseCcfbs(pData, ulSize, &vecFeedbacks)) {
+        DMD_LOG_ERROR("CDmdBandwidthEstimator::OnRtcp(), malformed rtcp");
+        return DMD_S_FAIL;
+    }
+    if (vecFeedbacks.empty()) {
+        return DMD_S_OK;
+    }
+
+    for (size_t i = 0; i < vecFeedbacks.size(); i++) {
+        const DmdRtcpCcfb &ccfb = vecFeedbacks[i];
+        if (!m_bReportClock) {
+            m_bReportClock = true;
+            m_ulReportUs = DMD_BWE_REPORT_CLOCK_BASE;
+        } else {
+            int32_t iDelta = static_cast<int32_t>(ccfb.iReportTimestamp
+                    - m_iLastReportTimestamp);
+            m_ulReportUs += (static_cast<int64_t>(iDelta) * 1000000) >> 16;
+        }
+        m_iLastReportTimestamp = ccfb.iReportTimestamp;
+
+        m_vecAcked.clear();
+        for (size_t j = 0; j < ccfb.vecBlocks.size(); j++) {
+            onBlock(ccfb.vecBlocks[j], m_ulReportUs);
+        }
+        // streams interleave on the wire, the gradient wants send order;
+        std::vector<std::pair<uint64_t, size_t> > vecOrder(
+                m_vecAcked.size());
+        for (size_t j = 0; j < m_vecAcked.size(); j++) {
+            vecOrder[j] = std::make_pair(m_vecAcked[j].ulSendUs, j);
+        }
+        std::stable_sort(vecOrder.begin(), vecOrder.end(), earlierSent);
+        for (size_t j = 0; j < vecOrder.size(); j++) {
+            onAcked(m_vecAcked[vecOrder[j].second]);
+        }
+        m_stats.ulFeedbackCount++;
+    }
+    updateEstimate(ulNowUs);
+
+    if (m_pFeedbackSink) {
+        DmdTransportFeedback transportFeedback;
+        memset(&transportFeedback, 0, sizeof(transportFeedback));
+        transportFeedback.ulTimestampUs = ulNowUs;
+        transportFeedback.ulEstimatedBps = m_stats.iEstimate;
+        m_pFeedbackSink->OnTransportFeedback(transportFeedback);
+    }
+    return DMD_S_OK;
+}
+
+void CDmdBandwidthEstimator::onBlock(const DmdRtcpCcfbBlock &block,
+        uint64_t ulReportUs) {
+    DmdBweStream *pStream = findStream(block.iMediaSsrc);
+    if (NULL == pStream) {
+        m_stats.ulUnknownCount += block.vecArrivalOffsets.size();
+        return;
+    }
+    for (size_t i = 0; i < block.vecArrivalOffsets.size(); i++) {
+        uint16_t iSequence = static_cast<uint16_t>(block.iBeginSeq + i);
+        DmdBweSent &sent =
+            pStream->vecSent[iSequence & DMD_BWE_SEND_HISTORY_MASK];
+        if (!sent.bPending || sent.iSequence != iSequence) {
+            m_stats.ulUnknownCount++;
+            continue;
+        }
+        sent.bPending = false;
+        m_iLossWindowCount++;
+        int16_t iOffset = block.vecArrivalOffsets[i];
+        if (DMD_RTCP_CCFB_NOT_RECEIVED == iOffset) {
+            m_stats.ulLostCount++;
+            m_iLossWindowLost++;
+            continue;
+        }
+        m_stats.ulAckedCount++;
+        if (DMD_RTCP_CCFB_OVER_RANGE == iOffset) {
+            continue;  // arrived, too long ago to tell when;
+        }
+        DmdBweAcked acked;
+        acked.ulSendUs = sent.ulSendUs;
+        acked.ulArrivalUs = ulReportUs
+            - ((static_cast<uint64_t>(iOffset) * 1000000) >> 10);
+        acked.iSize = sent.iSize;
+        m_vecAcked.push_back(acked);
+    }
+}
+
+void CDmdBandwidthEstimator::onAcked(const DmdBweAcked &acked) {
+    m_queAckedBytes.push_back(std::make_pair(acked.ulArrivalUs,
+                acked.iSize));
+    m_ulAckedBytes += acked.iSize;
+    while (m_queAckedBytes.front().first + DMD_BWE_ACKED_WINDOW_US
+            < acked.ulArrivalUs) {
+        m_ulAckedBytes -= m_queAckedBytes.front().second;
+        m_queAckedBytes.pop_front();
+    }
+
+    if (!m_bGroup) {
+        m_bGroup = true;
+        m_curGroup.ulFirstSendUs = acked.ulSendUs;
+        m_curGroup.ulLastSendUs = acked.ulSendUs;
+        m_curGroup.ulLastArrivalUs = acked.ulArrivalUs;
+        return;
+    }
+    if (acked.ulSendUs < m_curGroup.ulFirstSendUs + DMD_BWE_BURST_US) {
+        m_curGroup.ulLastSendUs = std::max(m_curGroup.ulLastSendUs,
+                acked.ulSendUs);
+        m_curGroup.ulLastArrivalUs = std::max(m_curGroup.ulLastArrivalUs,
+                acked.ulArrivalUs);
+        return;
+    }
+
+    // the group is complete, its delay against the previous one;
+    if (m_bPrevGroup) {
+        double fSendDeltaMs = (static_cast<double>(m_curGroup.ulLastSendUs)
+                - m_prevGroup.ulLastSendUs) / 1000;
+        double fArrivalDeltaMs = (static_cast<double>(
+                    m_curGroup.ulLastArrivalUs)
+                - m_prevGroup.ulLastArrivalUs) / 1000;
+        if (fArrivalDeltaMs >= 0) {
+            updateTrend(fArrivalDeltaMs - fSendDeltaMs,
+                    m_curGroup.ulLastArrivalUs / 1000.0, fSendDeltaMs);
+        }
+    }
+    m_prevGroup = m_curGroup;
+    m_bPrevGroup = true;
+    m_curGroup.ulFirstSendUs = acked.ulSendUs;
+    m_curGroup.ulLastSendUs = acked.ulSendUs;
+    m_curGroup.ulLastArrivalUs = acked.ulArrivalUs;
+}
+
+void CDmdBandwidthEstimator::updateTrend(double fDelayMs, double fArrivalMs,
+        double fSendDeltaMs) {
+    if (m_queTrendline.empty()) {
+        m_fFirstArrivalMs = fArrivalMs;
+    }
+    m_iDeltaCount = std::min(m_iDeltaCount + 1, 1000U);
+    m_fAccumulatedDelayMs += fDelayMs;
+    m_fSmoothedDelayMs = DMD_BWE_TRENDLINE_SMOOTHING * m_fSmoothedDelayMs
+        + (1 - DMD_BWE_TRENDLINE_SMOOTHING) * m_fAccumulatedDelayMs;
+    m_queTrendline.push_back(std::make_pair(fArrivalMs - m_fFirstArrivalMs,
+                m_fSmoothedDelayMs));
+    if (m_queTrendline.size() > DMD_BWE_TRENDLINE_WINDOW) {
+        m_queTrendline.pop_front();
+    }
+
+    // least squares slope of the smoothed delay over arrival time;
+    double fSlope = m_fPrevSlope;
+    if (m_queTrendline.size() == DMD_BWE_TRENDLINE_WINDOW) {
+        double fMeanX = 0;
+        double fMeanY = 0;
+        for (size_t i = 0; i < m_queTrendline.size(); i++) {
+            fMeanX += m_queTrendline[i].first;
+            fMeanY += m_queTrendline[i].second;
+        }
+        fMeanX /= m_queTrendline.size();
+        fMeanY /= m_queTrendline.size();
+        double fNumerator = 0;
+        double fDenominator = 0;
+        for (size_t i = 0; i < m_queTrendline.size(); i++) {
+            double fX = m_queTrendline[i].first - fMeanX;
+            fNumerator += fX * (m_queTrendline[i].second - fMeanY);
+            fDenominator += fX * fX;
+        }
+        if (fDenominator > 0) {
+            fSlope = fNumerator / fDenominator;
+        }
+    }
+
+    // overuse only when above the threshold for a while, and rising;
+    double fTrend = std::min(m_iDeltaCount, 60U) * fSlope
+        * DMD_BWE_TRENDLINE_GAIN;
+    m_stats.fTrend = fTrend;
+    if (fTrend > m_stats.fThreshold) {
+        if (m_fOveruseTimeMs < 0) {
+            m_fOveruseTimeMs = fSendDeltaMs / 2;
+        } else {
+            m_fOveruseTimeMs += fSendDeltaMs;
+        }
+        m_iOveruseCounter++;
+        if (m_fOveruseTimeMs > DMD_BWE_OVERUSE_TIME_MS
+                && m_iOveruseCounter > 1 && fSlope >= m_fPrevSlope) {
+            m_fOveruseTimeMs = 0;
+            m_iOveruseCounter = 0;
+            if (DmdBweOveruse != m_stats.eUsage) {
+                m_stats.ulOveruseCount++;
+            }
+            m_stats.eUsage = DmdBweOveruse;
+        }
+    } else {
+        m_fOveruseTimeMs = -1;
+        m_iOveruseCounter = 0;
+        m_stats.eUsage = fTrend < -m_stats.fThreshold ? DmdBweUnderuse
+            : DmdBweNormal;
+    }
+    m_fPrevSlope = fSlope;
+    updateThreshold(fTrend, fArrivalMs);
+}
+
+// adapts fast toward a trend within it, slowly toward one above, so that
+// a competing tcp flow's queue does not starve us, nor noise trigger;
+void CDmdBandwidthEstimator::updateThreshold(double fTrend,
+        double fArrivalMs) {
+    if (m_fLastThresholdMs < 0) {
+        m_fLastThresholdMs = fArrivalMs;
+    }
+    double fAbsTrend = fabs(fTrend);
+    if (fAbsTrend > m_stats.fThreshold + 15) {
+        m_fLastThresholdMs = fArrivalMs;
+        return;  // a spike, not a trend;
+    }
+    double fGain = fAbsTrend < m_stats.fThreshold ? 0.039 : 0.0087;
+    double fElapsedMs = std::min(fArrivalMs - m_fLastThresholdMs, 100.0);
+    m_stats.fThreshold += fGain * (fAbsTrend - m_stats.fThreshold)
+        * fElapsedMs;
+    m_stats.fThreshold = std::max(6.0, std::min(m_stats.fThreshold, 600.0));
+    m_fLastThresholdMs = fArrivalMs;
+}
+
+void CDmdBandwidthEstimator::updateEstimate(uint64_t ulNowUs) {
+    double fAckedBps = 0;
+    if (m_queAckedBytes.size() > 1) {
+        uint64_t ulSpanUs = m_queAckedBytes.back().first
+            - m_queAckedBytes.front().first;
+        if (ulSpanUs >= DMD_BWE_ACKED_WINDOW_US / 2) {
+            fAckedBps = (m_ulAckedBytes - m_queAckedBytes.front().second)
+                * 8000000.0 / ulSpanUs;
+        }
+    }
+    m_stats.ulAckedRateBps = static_cast<uint64_t>(fAckedBps);
+
+    bool bLossFresh = false;
+    if (m_iLossWindowCount >= DMD_BWE_LOSS_WINDOW_PACKETS) {
+        m_stats.fLossRate = static_cast<float>(m_iLossWindowLost)
+            / m_iLossWindowCount;
+        m_iLossWindowCount = 0;
+        m_iLossWindowLost = 0;
+        bLossFresh = true;
+    }
+
+    if (0 == m_ulLastUpdateUs) {
+        m_ulLastUpdateUs = ulNowUs;
+    }
+    uint64_t ulResponseUs = m_ulRttUs + DMD_BWE_RESPONSE_US;
+    bool bCanDecrease = 0 == m_ulLastDecreaseUs
+        || ulNowUs - m_ulLastDecreaseUs >= ulResponseUs;
+    double fEstimate = m_fEstimate;
+    if (bLossFresh && m_stats.fLossRate > DMD_BWE_HIGH_LOSS_RATE) {
+        if (bCanDecrease) {
+            fEstimate *= 1 - 0.5 * m_stats.fLossRate;
+            m_ulLastDecreaseUs = ulNowUs;
+            m_stats.ulDecreaseCount++;
+        }
+    } else if (DmdBweOveruse == m_stats.eUsage) {
+        if (bCanDecrease) {
+            double fBase = fAckedBps > 0 ? fAckedBps : m_fEstimate;
+            fEstimate = std::min(m_fEstimate, 0.85 * fBase);
+            m_fLinkCapacity = fBase;
+            m_ulLastDecreaseUs = ulNowUs;
+            m_stats.ulDecreaseCount++;
+        }
+    } else if (DmdBweNormal == m_stats.eUsage
+            && m_stats.fLossRate <= DMD_BWE_LOW_LOSS_RATE) {
+        double fElapsedS = std::min(ulNowUs - m_ulLastUpdateUs,
+                static_cast<uint64_t>(1000000)) / 1000000.0;
+        if (m_fLinkCapacity > 0 && fEstimate > 1.15 * m_fLinkCapacity) {
+            m_fLinkCapacity = 0;  // past where it overused, the link grew;
+        }
+        if (m_fLinkCapacity > 0 && fEstimate >= 0.8 * m_fLinkCapacity) {
+            // near the last overuse, a packet a response time;
+            fEstimate += DMD_RTP_DEFAULT_MTU * 8.0 * fElapsedS * 1000000
+                / ulResponseUs;
+        } else {
+            fEstimate *= pow(1.08, fElapsedS);
+        }
+        // not beyond what the link showed it carries, while app limited;
+        double fLimit = 1.5 * fAckedBps + 10000;
+        if (fAckedBps > 0 && fEstimate > fLimit) {
+            fEstimate = std::max(m_fEstimate, fLimit);
+        }
+    }
+    m_ulLastUpdateUs = ulNowUs;
+    setEstimate(fEstimate);
+}
+
+void CDmdBandwidthEstimator::setEstimate(double fEstimate) {
+    m_fEstimate = std::max(static_cast<double>(m_param.iMinBitrate),
+            std::min(fEstimate, static_cast<double>(m_param.iMaxBitrate)));
+    m_stats.iEstimate = static_cast<unsigned int>(m_fEstimate);
+}
+
+void CDmdBandwidthEstimator::GetStats(DmdBweStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,218 @@
+/*
+ ============================================================================
+ * Name        : CDmdBandwidthEstimator.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdBandwidthEstimator.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDBANDWIDTHESTIMATOR_H
+#define SRC_NETWORK_CDMDBANDWIDTHESTIMATOR_H
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// packets of a stream remembered until their feedback, a power of two;
+#define DMD_BWE_SEND_HISTORY_SIZE     4096
+// packets sent within this of the first of a group are one burst;
+#define DMD_BWE_BURST_US              5000
+// delay gradient trendline, draft-ietf-rmcat-gcc;
+#define DMD_BWE_TRENDLINE_WINDOW      20
+#define DMD_BWE_TRENDLINE_SMOOTHING   0.9
+#define DMD_BWE_TRENDLINE_GAIN        4.0
+#define DMD_BWE_INITIAL_THRESHOLD_MS  12.5
+#define DMD_BWE_OVERUSE_TIME_MS       10.0
+// acknowledged rate, measured over this much arrival time;
+#define DMD_BWE_ACKED_WINDOW_US       500000
+// loss rate marks, evaluated over at least this many packets;
+#define DMD_BWE_HIGH_LOSS_RATE        0.10f
+#define DMD_BWE_LOW_LOSS_RATE         0.02f
+#define DMD_BWE_LOSS_WINDOW_PACKETS   50
+#define DMD_BWE_DEFAULT_RTT_US        100000
+
+typedef struct {
+    unsigned int    iStartBitrate;        // in bps;
+    unsigned int    iMinBitrate;
+    unsigned int    iMaxBitrate;
+} DmdBweParam;
+
+typedef enum {
+    DmdBweNormal = 0,
+    DmdBweOveruse,
+    DmdBweUnderuse,
+} DmdBweUsage;
+
+typedef struct {
+    uint64_t        ulFeedbackCount;
+    uint64_t        ulAckedCount;         // reported arrived;
+    uint64_t        ulLostCount;          // reported not received;
+    uint64_t        ulUnknownCount;       // reported, not in the history;
+    uint64_t        ulOveruseCount;
+    uint64_t        ulDecreaseCount;
+    unsigned int    iEstimate;            // in bps;
+    uint64_t        ulAckedRateBps;       // 0 until measured;
+    double          fTrend;               // modified trend, ms;
+    double          fThreshold;           // ms;
+    DmdBweUsage     eUsage;
+    float           fLossRate;            // of the last loss window;
+} DmdBweStats;
+
+/*
+ * Sender side bandwidth estimate from rfc 8888 feedback. Send times are
+ * kept per ssrc and sequence number; arrival times come back from the
+ * receiver, and of each burst of packets the change in one way delay
+ * against the previous burst, the delay gradient, goes into a trendline
+ * filter. A queue building up at the bottleneck shows as a rising trend
+ * long before it overflows into loss, which on a bufferbloated uplink
+ * may be seconds later. The trend is held against an adaptive threshold:
+ * overuse cuts the estimate to 85% of the acknowledged rate, at most once
+ * a round trip; underuse holds it while the queue drains; otherwise it
+ * grows by 8% a second, or by a packet a round trip near the rate that
+ * last overused. Heavy loss cuts it as well, in proportion.
+ *
+ * Each feedback passes the estimate on as ulEstimatedBps transport
+ * feedback, which the rate controller follows. Runs on the transport
+ * thread, which both sends and receives rtcp, no locking.
+ */
+class CDmdBandwidthEstimator {
+public:
+    CDmdBandwidthEstimator();
+    ~CDmdBandwidthEstimator();
+
+    DMD_RESULT Init(const DmdBweParam &bweParam);
+    void SetFeedbackSink(IDmdTransportFeedbackSink *pFeedbackSink);
+    // from rtcp, when a round trip measure comes in;
+    void SetRtt(uint64_t ulRttUs);
+
+    // packets as they were handed to the socket, of any ssrc;
+    void OnPacketsSent(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, uint64_t ulNowUs);
+    // a compound rtcp packet from the receiver; packets other than
+    // congestion control feedback are ignored;
+    DMD_RESULT OnRtcp(const uint8_t *pData, size_t ulSize, uint64_t ulNowUs);
+
+    unsigned int GetEstimate() const {return m_stats.iEstimate;}
+    void GetStats(DmdBweStats *pStats) const;
+
+private:
+    typedef struct {
+        uint16_t        iSequence;
+        bool            bPending;        // sent, no feedback yet;
+        uint32_t        iSize;
+        uint64_t        ulSendUs;
+    } DmdBweSent;
+
+    typedef struct {
+        uint32_t                    iSsrc;
+        std::vector<DmdBweSent>     vecSent;       // by sequence;
+    } DmdBweStream;
+
+    typedef struct {
+        uint64_t        ulSendUs;
+        uint64_t        ulArrivalUs;     // on the receiver's clock;
+        uint32_t        iSize;
+    } DmdBweAcked;
+
+    typedef struct {
+        uint64_t        ulFirstSendUs;
+        uint64_t        ulLastSendUs;
+        uint64_t        ulLastArrivalUs;
+    } DmdBweGroup;
+
+    DmdBweStream *findStream(uint32_t iSsrc);
+    void onBlock(const DmdRtcpCcfbBlock &block, uint64_t ulReportUs);
+    void onAcked(const DmdBweAcked &acked);
+    void updateTrend(double fDelayMs, double fArrivalMs,
+            double fSendDeltaMs);
+    void updateThreshold(double fTrend, double fArrivalMs);
+    void updateEstimate(uint64_t ulNowUs);
+    void setEstimate(double fEstimate);
+
+private:
+    DmdBweParam                       m_param;
+    IDmdTransportFeedbackSink        *m_pFeedbackSink;
+    uint64_t                          m_ulRttUs;
+    std::vector<DmdBweStream>         m_vecStreams;
+    size_t                            m_ulLastStream;
+    std::vector<DmdBweAcked>          m_vecAcked;    // of one feedback;
+
+    // the receiver's report timestamps, unwrapped;
+    bool                              m_bReportClock;
+    uint32_t                          m_iLastReportTimestamp;
+    uint64_t                          m_ulReportUs;
+
+    // burst groups and the trendline over their delay gradients;
+    bool                              m_bGroup;
+    bool                              m_bPrevGroup;
+    DmdBweGroup                       m_curGroup;
+    DmdBweGroup                       m_prevGroup;
+    double                            m_fFirstArrivalMs;
+    double                            m_fAccumulatedDelayMs;
+    double                            m_fSmoothedDelayMs;
+    std::deque<std::pair<double, double> > m_queTrendline;
+    unsigned int                      m_iDeltaCount;
+    double                            m_fPrevSlope;
+
+    // overuse detector;
+    double                            m_fOveruseTimeMs;   // < 0 if not;
+    unsigned int                      m_iOveruseCounter;
+    double                            m_fLastThresholdMs; // < 0 if never;
+
+    // acknowledged rate over the arrival window;
+    std::deque<std::pair<uint64_t, uint32_t> > m_queAckedBytes;
+    uint64_t                          m_ulAckedBytes;
+
+    unsigned int                      m_iLossWindowCount;
+    unsigned int                      m_iLossWindowLost;
+    bool                              m_bLossEvaluated;
+
+    double                            m_fEstimate;
+    double                            m_fLinkCapacity;   // 0 if unknown;
+    uint64_t                          m_ulLastUpdateUs;
+    uint64_t                          m_ulLastDecreaseUs;
+    DmdBweStats                       m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDBANDWIDTHESTIMATOR_H
@@ -0,0 +1,198 @@
+/*
+ ============================================================================
+ * Name        : CDmdCcfbGenerator.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdCcfbGenerator.cpp
+ ============================================================================
+ */
+
+#include "CDmdCcfbGenerator.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+#define DMD_CCFB_HISTORY_MASK   (DMD_CCFB_HISTORY_SIZE - 1)
+// unwrapped sequences start a cycle up, so that reordering before the
+// first packet does not go below zero;
+#define DMD_CCFB_SEQ_BASE       (1ULL << 16)
+
+CDmdCcfbGenerator::CDmdCcfbGenerator() : m_ulLastStream(0),
+        m_bPending(false), m_ulNextFeedbackUs(0) {
+    m_param.iSsrc = 0;
+    m_param.ulIntervalUs = DMD_CCFB_DEFAULT_INTERVAL_US;
+    m_ccfb.iSenderSsrc = 0;
+    m_ccfb.iReportTimestamp = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdCcfbGenerator::~CDmdCcfbGenerator() {
+}
+
+DMD_RESULT CDmdCcfbGenerator::Init(
+        const DmdCcfbGeneratorParam &generatorParam) {
+    if (0 == generatorParam.ulIntervalUs) {
+        DMD_LOG_ERROR("CDmdCcfbGenerator::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = generatorParam;
+    Reset();
+    return DMD_S_OK;
+}
+
+void CDmdCcfbGenerator::Reset() {
+    m_vecStreams.clear();
+    m_ulLastStream = 0;
+    m_bPending = false;
+    m_ulNextFeedbackUs = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdCcfbGenerator::DmdCcfbStream *CDmdCcfbGenerator::findStream(
+        uint32_t iSsrc, uint16_t iSequence) {
+    // packets come in runs of one stream;
+    if (m_ulLastStream < m_vecStreams.size()
+            && m_vecStreams[m_ulLastStream].iSsrc == iSsrc) {
+        return &m_vecStreams[m_ulLastStream];
+    }
+    for (size_t i = 0; i < m_vecStreams.size(); i++) {
+        if (m_vecStreams[i].iSsrc == iSsrc) {
+            m_ulLastStream = i;
+            return &m_vecStreams[i];
+        }
+    }
+
+    DmdCcfbStream stream;
+    stream.iSsrc = iSsrc;
+    stream.ulNextSeq = DMD_CCFB_SEQ_BASE + iSequence;
+    stream.ulHighestSeq = stream.ulNextSeq - 1;
+    DmdCcfbArrival emptyArrival = {0, 0};
+    stream.vecArrivals.assign(DMD_CCFB_HISTORY_SIZE, emptyArrival);
+    m_vecStreams.push_back(stream);
+    m_ulLastStream = m_vecStreams.size() - 1;
+    return &m_vecStreams.back();
+}
+
+void CDmdCcfbGenerator::OnPacket(uint32_t iMediaSsrc, uint16_t iSequence,
+        uint64_t ulArrivalUs) {
+    DmdCcfbStream *pStream = findStream(iMediaSsrc, iSequence);
+    m_stats.ulReceivedCount++;
+    int16_t iDelta = static_cast<int16_t>(iSequence
+            - static_cast<uint16_t>(pStream->ulHighestSeq));
+    uint64_t ulSequence = pStream->ulHighestSeq + iDelta;
+    if (ulSequence < pStream->ulNextSeq) {
+        m_stats.ulLateCount++;
+        return;
+    }
+    if (ulSequence > pStream->ulHighestSeq) {
+        pStream->ulHighestSeq = ulSequence;
+    }
+    DmdCcfbArrival &arrival =
+        pStream->vecArrivals[ulSequence & DMD_CCFB_HISTORY_MASK];
+    arrival.ulSequence = ulSequence;
+    arrival.ulArrivalUs = ulArrivalUs;
+    if (!m_bPending) {
+        m_bPending = true;
+        if (0 == m_ulNextFeedbackUs) {
+            m_ulNextFeedbackUs = ulArrivalUs + m_param.ulIntervalUs;
+        }
+    }
+}
+
+DMD_RESULT CDmdCcfbGenerator::BuildFeedback(uint64_t ulNowUs,
+        uint8_t *pBuffer, size_t ulCapacity, size_t *pSize) {
+    if (NULL == pBuffer || NULL == pSize) {
+        return DMD_S_FAIL;
+    }
+    *pSize = 0;
+    m_ulNextFeedbackUs = ulNowUs + m_param.ulIntervalUs;
+    if (!m_bPending) {
+        return DMD_S_OK;
+    }
+
+    // offsets count back from the report timestamp, in 1/1024 seconds,
+    // a 64th of the compact ntp unit;
+    uint32_t iReportTimestamp = DmdNtpCompactFromUs(ulNowUs);
+    m_ccfb.iSenderSsrc = m_param.iSsrc;
+    m_ccfb.iReportTimestamp = iReportTimestamp;
+    m_ccfb.vecBlocks.clear();
+    for (size_t i = 0; i < m_vecStreams.size(); i++) {
+        DmdCcfbStream &stream = m_vecStreams[i];
+        if (stream.ulHighestSeq < stream.ulNextSeq) {
+            continue;
+        }
+        uint64_t ulBegin = stream.ulNextSeq;
+        if (stream.ulHighestSeq - ulBegin >= DMD_CCFB_HISTORY_SIZE) {
+            ulBegin = stream.ulHighestSeq - DMD_CCFB_HISTORY_SIZE + 1;
+        }
+        m_ccfb.vecBlocks.resize(m_ccfb.vecBlocks.size() + 1);
+        DmdRtcpCcfbBlock &block = m_ccfb.vecBlocks.back();
+        block.iMediaSsrc = stream.iSsrc;
+        block.iBeginSeq = static_cast<uint16_t>(ulBegin);
+        for (uint64_t ulSeq = ulBegin; ulSeq <= stream.ulHighestSeq;
+                ulSeq++) {
+            const DmdCcfbArrival &arrival =
+                stream.vecArrivals[ulSeq & DMD_CCFB_HISTORY_MASK];
+            int16_t iOffset = DMD_RTCP_CCFB_NOT_RECEIVED;
+            if (arrival.ulSequence == ulSeq) {
+                uint32_t iAge = (iReportTimestamp
+                        - DmdNtpCompactFromUs(arrival.ulArrivalUs)) >> 6;
+                iOffset = iAge < DMD_RTCP_CCFB_OVER_RANGE
+                    ? static_cast<int16_t>(iAge) : DMD_RTCP_CCFB_OVER_RANGE;
+            }
+            block.vecArrivalOffsets.push_back(iOffset);
+        }
+        m_stats.ulReportedCount += block.vecArrivalOffsets.size();
+        stream.ulNextSeq = stream.ulHighestSeq + 1;
+    }
+    m_bPending = false;
+
+    if (DMD_S_OK != DmdRtcpWriteCcfb(m_ccfb, pBuffer, ulCapacity, pSize)) {
+        DMD_LOG_ERROR("CDmdCcfbGenerator::BuildFeedback(), "
+                << "buffer too small");
+        return DMD_S_FAIL;
+    }
+    m_stats.ulFeedbackCount++;
+    return DMD_S_OK;
+}
+
+void CDmdCcfbGenerator::GetStats(DmdCcfbGeneratorStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,124 @@
+/*
+ ============================================================================
+ * Name        : CDmdCcfbGenerator.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdCcfbGenerator.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDCCFBGENERATOR_H
+#define SRC_NETWORK_CDMDCCFBGENERATOR_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdRtcp.h"
+
+namespace opendmd {
+
+// a feedback per this, a few frames, well below a round trip;
+#define DMD_CCFB_DEFAULT_INTERVAL_US  50000
+// packets of a stream remembered, and reported on at most, per feedback;
+#define DMD_CCFB_HISTORY_SIZE         1024
+
+typedef struct {
+    uint32_t        iSsrc;               // ours, the reporter;
+    uint64_t        ulIntervalUs;
+} DmdCcfbGeneratorParam;
+
+typedef struct {
+    uint64_t        ulReceivedCount;
+    uint64_t        ulLateCount;         // after their sequence reported;
+    uint64_t        ulReportedCount;     // in feedback, lost included;
+    uint64_t        ulFeedbackCount;
+} DmdCcfbGeneratorStats;
+
+/*
+ * Receiver side of rfc 8888 congestion control feedback: notes when each
+ * packet of each ssrc arrives and reports those arrival times back, every
+ * ulIntervalUs, so the sender compares them with its send times. Each
+ * feedback covers the sequence numbers from the first not yet reported
+ * to the highest received, the missing ones as not received; a packet
+ * arriving after its sequence number was reported is counted late only.
+ * Runs on the receiving thread, no locking.
+ */
+class CDmdCcfbGenerator {
+public:
+    CDmdCcfbGenerator();
+    ~CDmdCcfbGenerator();
+
+    DMD_RESULT Init(const DmdCcfbGeneratorParam &generatorParam);
+    void Reset();
+
+    void OnPacket(uint32_t iMediaSsrc, uint16_t iSequence,
+            uint64_t ulArrivalUs);
+
+    bool IsFeedbackDue(uint64_t ulNowUs) const {
+        return m_bPending && ulNowUs >= m_ulNextFeedbackUs;
+    }
+    // a feedback of what arrived since the last one, and schedules the
+    // next one; pSize receives 0 if nothing arrived;
+    DMD_RESULT BuildFeedback(uint64_t ulNowUs, uint8_t *pBuffer,
+            size_t ulCapacity, size_t *pSize);
+
+    void GetStats(DmdCcfbGeneratorStats *pStats) const;
+
+private:
+    typedef struct {
+        uint64_t        ulSequence;      // unwrapped;
+        uint64_t        ulArrivalUs;
+    } DmdCcfbArrival;
+
+    typedef struct {
+        uint32_t                      iSsrc;
+        uint64_t                      ulNextSeq;     // first unreported;
+        uint64_t                      ulHighestSeq;  // unwrapped;
+        std::vector<DmdCcfbArrival>   vecArrivals;   // by sequence;
+    } DmdCcfbStream;
+
+    DmdCcfbStream *findStream(uint32_t iSsrc, uint16_t iSequence);
+
+    DmdCcfbGeneratorParam             m_param;
+    std::vector<DmdCcfbStream>        m_vecStreams;
+    size_t                            m_ulLastStream;
+    bool                              m_bPending;
+    uint64_t                          m_ulNextFeedbackUs;
+    DmdRtcpCcfb                       m_ccfb;
+    DmdCcfbGeneratorStats             m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDCCFBGENERATOR_H
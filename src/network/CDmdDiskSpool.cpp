@@ -0,0 +1,829 @@
+/*
+ ============================================================================
+ * Name        : CDmdDiskSpool.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdDiskSpool.cpp
+ ============================================================================
+ */
+
+#include "CDmdDiskSpool.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+#define DMD_SPOOL_RECORD_MAGIC    0x444d4452  // "DMDR";
+#define DMD_SPOOL_INDEX_MAGIC     0x444d4449  // "DMDI";
+#define DMD_SPOOL_INDEX_VERSION   1
+#define DMD_SPOOL_MAX_NAL_COUNT   4096
+#define DMD_SPOOL_FLAG_MOTION     0x1
+
+// in host order, the spool is not carried to another machine; 32 bytes,
+// followed by iNalCount CDmdDiskSpool::DmdSpoolNal and then the annex-b
+// data; iCrc covers all of it but iCrc;
+typedef struct {
+    uint32_t    iMagic;
+    uint32_t    iDataLen;
+    uint64_t    ulTimestamp;
+    uint16_t    iWidth;
+    uint16_t    iHeight;
+    uint8_t     iFrameType;
+    uint8_t     iLayer;
+    uint8_t     iFlags;
+    uint8_t     iReserved;
+    uint32_t    iNalCount;
+    uint32_t    iCrc;
+} DmdSpoolRecord;
+
+// the index is this, iSegmentCount DmdSpoolIndexEntry, and the crc of
+// both;
+typedef struct {
+    uint32_t    iMagic;
+    uint32_t    iVersion;
+    uint32_t    iSegmentCount;
+    uint32_t    iReadId;
+    uint64_t    ulReadOffset;
+    uint64_t    ulReadFrames;
+} DmdSpoolIndex;
+
+typedef struct {
+    uint32_t    iId;
+    uint32_t    iReserved;
+    uint64_t    ulBytes;
+    uint64_t    ulFrameCount;
+} DmdSpoolIndexEntry;
+
+static uint32_t DmdSpoolCrc(uint32_t iCrc, const void *pData, size_t ulLen) {
+    static uint32_t s_arrTable[256] = {0};
+    if (0 == s_arrTable[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            s_arrTable[i] = c;
+        }
+    }
+    const uint8_t *p = static_cast<const uint8_t *>(pData);
+    iCrc = ~iCrc;
+    for (size_t i = 0; i < ulLen; i++) {
+        iCrc = s_arrTable[(iCrc ^ p[i]) & 0xff] ^ (iCrc >> 8);
+    }
+    return ~iCrc;
+}
+
+static bool DmdSpoolReadFull(int iFd, void *pBuffer, size_t ulLen,
+        uint64_t ulOffset) {
+    uint8_t *p = static_cast<uint8_t *>(pBuffer);
+    while (ulLen > 0) {
+        ssize_t ret = pread(iFd, p, ulLen, ulOffset);
+        if (ret < 0 && EINTR == errno) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+        p += ret;
+        ulLen -= ret;
+        ulOffset += ret;
+    }
+    return true;
+}
+
+static bool DmdSpoolIsKeyFrame(DmdEncodedFrameType eFrameType) {
+    return DmdFrameIDR == eFrameType || DmdFrameI == eFrameType;
+}
+
+CDmdDiskSpool::CDmdDiskSpool() : m_bOpen(false), m_iWriteFd(-1),
+        m_iReadFd(-1), m_iReadId(0), m_iNextId(1), m_ulReadOffset(0),
+        m_ulReadFrames(0), m_bKeyFrameRequest(false), m_bIndexDirty(false),
+        m_ulLastCheckpointUs(0), m_ulDrainRateBps(0), m_fDrainTokens(0),
+        m_ulLastDrainUs(0) {
+    m_param.ulMaxBytes = 0;
+    m_param.ulSegmentBytes = 0;
+    m_param.ulCheckpointUs = 0;
+    m_param.ePolicy = DmdSpoolMotionOnly;
+    m_param.ulDrainRateBps = 0;
+    m_bWaitKey[DmdLayerRecord] = true;
+    m_bWaitKey[DmdLayerDetect] = true;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdDiskSpool::~CDmdDiskSpool() {
+    Close();
+}
+
+DMD_RESULT CDmdDiskSpool::Open(const DmdSpoolParam &spoolParam) {
+    if (spoolParam.sDirectory.empty()) {
+        DMD_LOG_ERROR("CDmdDiskSpool::Open(), no directory");
+        return DMD_S_FAIL;
+    }
+    if (mkdir(spoolParam.sDirectory.c_str(), 0755) < 0 && EEXIST != errno) {
+        DMD_LOG_ERROR("CDmdDiskSpool::Open(), mkdir " << spoolParam.sDirectory
+                << " failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+
+    m_mtxSpoolMutex.Lock();
+    if (m_bOpen) {
+        m_mtxSpoolMutex.Unlock();
+        DMD_LOG_ERROR("CDmdDiskSpool::Open(), already open");
+        return DMD_S_FAIL;
+    }
+    m_param = spoolParam;
+    if (0 == m_param.ulMaxBytes) {
+        m_param.ulMaxBytes = DMD_SPOOL_DEFAULT_MAX_BYTES;
+    }
+    if (0 == m_param.ulSegmentBytes) {
+        m_param.ulSegmentBytes = DMD_SPOOL_DEFAULT_SEGMENT_BYTES;
+    }
+    // eviction goes by segment, a few of them make the spool;
+    m_param.ulSegmentBytes = std::min(m_param.ulSegmentBytes,
+            m_param.ulMaxBytes / 4);
+    if (0 == m_param.ulCheckpointUs) {
+        m_param.ulCheckpointUs = DMD_SPOOL_DEFAULT_CHECKPOINT_US;
+    }
+    m_ulDrainRateBps = m_param.ulDrainRateBps;
+    m_fDrainTokens = 0;
+    m_ulLastDrainUs = 0;
+    m_ulLastCheckpointUs = 0;
+    m_bWaitKey[DmdLayerRecord] = true;
+    m_bWaitKey[DmdLayerDetect] = true;
+    m_bKeyFrameRequest = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+    recover();
+    m_bOpen = true;
+    DMD_LOG_INFO("CDmdDiskSpool::Open(), " << m_param.sDirectory
+            << ", segments = " << m_vecSegments.size()
+            << ", bytes = " << pendingBytesLocked()
+            << ", truncated = " << m_stats.ulTruncatedBytes);
+    m_mtxSpoolMutex.Unlock();
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdDiskSpool::Close() {
+    m_mtxSpoolMutex.Lock();
+    if (!m_bOpen) {
+        m_mtxSpoolMutex.Unlock();
+        return DMD_S_OK;
+    }
+    if (m_iWriteFd >= 0) {
+        sealLocked();
+    }
+    DMD_RESULT ret = writeIndexLocked();
+    if (m_iReadFd >= 0) {
+        close(m_iReadFd);
+        m_iReadFd = -1;
+    }
+    m_vecSegments.clear();
+    m_bOpen = false;
+    m_mtxSpoolMutex.Unlock();
+    return ret;
+}
+
+std::string CDmdDiskSpool::segmentPath(uint32_t iId) const {
+    char arrName[32];
+    snprintf(arrName, sizeof(arrName), "/spool-%08u.seg", iId);
+    return m_param.sDirectory + arrName;
+}
+
+void CDmdDiskSpool::recover() {
+    std::vector<uint32_t> vecIds;
+    DIR *pDir = opendir(m_param.sDirectory.c_str());
+    if (pDir) {
+        struct dirent *pEntry = NULL;
+        while (NULL != (pEntry = readdir(pDir))) {
+            unsigned int iId = 0;
+            char arrSuffix[8] = {0};
+            if (2 == sscanf(pEntry->d_name, "spool-%8u.%3s", &iId, arrSuffix)
+                    && 0 == strcmp(arrSuffix, "seg")) {
+                vecIds.push_back(iId);
+            }
+        }
+        closedir(pDir);
+    }
+    std::sort(vecIds.begin(), vecIds.end());
+
+    std::vector<DmdSpoolSegment> vecIndexed;
+    bool bIndexed = loadIndex(&vecIndexed);
+    m_vecSegments.clear();
+    for (size_t i = 0; i < vecIds.size(); i++) {
+        std::string sPath = segmentPath(vecIds[i]);
+        // drained before the crash, not yet deleted;
+        if (bIndexed && vecIds[i] < m_iReadId) {
+            unlink(sPath.c_str());
+            continue;
+        }
+        DmdSpoolSegment segment;
+        segment.iId = vecIds[i];
+        segment.ulBytes = 0;
+        segment.ulFrameCount = 0;
+        bool bKnown = false;
+        struct stat st;
+        for (size_t j = 0; j < vecIndexed.size(); j++) {
+            // sealed and synced, unless the file says otherwise;
+            if (vecIndexed[j].iId == segment.iId
+                    && 0 == stat(sPath.c_str(), &st)
+                    && vecIndexed[j].ulBytes
+                        == static_cast<uint64_t>(st.st_size)) {
+                segment = vecIndexed[j];
+                bKnown = true;
+                break;
+            }
+        }
+        if (!bKnown && DMD_S_OK != scanSegment(&segment)) {
+            continue;
+        }
+        if (0 == segment.ulBytes) {
+            unlink(sPath.c_str());
+            continue;
+        }
+        m_vecSegments.push_back(segment);
+    }
+
+    if (m_vecSegments.empty() || m_vecSegments.front().iId != m_iReadId
+            || m_ulReadOffset > m_vecSegments.front().ulBytes) {
+        m_ulReadOffset = 0;
+        m_ulReadFrames = 0;
+    }
+    m_iReadId = 0;
+    m_iNextId = vecIds.empty() ? 1 : vecIds.back() + 1;
+    // the index holds sealed segments only, it is written before any
+    // new segment is;
+    m_bIndexDirty = true;
+    writeIndexLocked();
+}
+
+bool CDmdDiskSpool::loadIndex(std::vector<DmdSpoolSegment> *pVecIndexed) {
+    m_iReadId = 0;
+    m_ulReadOffset = 0;
+    m_ulReadFrames = 0;
+    std::string sPath = m_param.sDirectory + "/spool.idx";
+    int iFd = open(sPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (iFd < 0) {
+        return false;
+    }
+    DmdSpoolIndex index;
+    bool bValid = DmdSpoolReadFull(iFd, &index, sizeof(index), 0)
+        && DMD_SPOOL_INDEX_MAGIC == index.iMagic
+        && DMD_SPOOL_INDEX_VERSION == index.iVersion
+        && index.iSegmentCount <= 1024 * 1024;
+    std::vector<DmdSpoolIndexEntry> vecEntries;
+    uint32_t iCrc = 0;
+    if (bValid) {
+        vecEntries.resize(index.iSegmentCount);
+        size_t ulEntryBytes = vecEntries.size() * sizeof(DmdSpoolIndexEntry);
+        bValid = (0 == ulEntryBytes || DmdSpoolReadFull(iFd,
+                    vecEntries.data(), ulEntryBytes, sizeof(index)))
+            && DmdSpoolReadFull(iFd, &iCrc, sizeof(iCrc),
+                    sizeof(index) + ulEntryBytes);
+        bValid = bValid && iCrc == DmdSpoolCrc(DmdSpoolCrc(0, &index,
+                    sizeof(index)), vecEntries.data(), ulEntryBytes);
+    }
+    close(iFd);
+    if (!bValid) {
+        DMD_LOG_WARNING("CDmdDiskSpool::loadIndex(), " << sPath
+                << " is damaged, scanning all segments");
+        return false;
+    }
+
+    m_iReadId = index.iReadId;
+    m_ulReadOffset = index.ulReadOffset;
+    m_ulReadFrames = index.ulReadFrames;
+    for (size_t i = 0; i < vecEntries.size(); i++) {
+        DmdSpoolSegment segment;
+        segment.iId = vecEntries[i].iId;
+        segment.ulBytes = vecEntries[i].ulBytes;
+        segment.ulFrameCount = vecEntries[i].ulFrameCount;
+        pVecIndexed->push_back(segment);
+    }
+    return true;
+}
+
+DMD_RESULT CDmdDiskSpool::scanSegment(DmdSpoolSegment *pSegment) {
+    std::string sPath = segmentPath(pSegment->iId);
+    int iFd = open(sPath.c_str(), O_RDWR | O_CLOEXEC);
+    if (iFd < 0) {
+        DMD_LOG_ERROR("CDmdDiskSpool::scanSegment(), open " << sPath
+                << " failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    struct stat st;
+    uint64_t ulFileBytes = 0 == fstat(iFd, &st) ? st.st_size : 0;
+    uint64_t ulOffset = 0;
+    uint64_t ulRecordBytes = 0;
+    DmdEncodedFrame frame;
+    while (DMD_S_OK == readRecordLocked(iFd, ulOffset, ulFileBytes, &frame,
+                &ulRecordBytes)) {
+        ulOffset += ulRecordBytes;
+        pSegment->ulFrameCount++;
+    }
+    pSegment->ulBytes = ulOffset;
+
+    // a torn tail, from a crash in the middle of a write;
+    if (ulFileBytes > ulOffset) {
+        DMD_LOG_WARNING("CDmdDiskSpool::scanSegment(), " << sPath
+                << " truncated from " << ulFileBytes << " to " << ulOffset);
+        m_stats.ulTruncatedBytes += ulFileBytes - ulOffset;
+        if (ftruncate(iFd, ulOffset) < 0) {
+            m_stats.ulWriteErrorCount++;
+        }
+    }
+    close(iFd);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdDiskSpool::writeIndexLocked() {
+    if (!m_bIndexDirty) {
+        return DMD_S_OK;
+    }
+    DmdSpoolIndex index;
+    memset(&index, 0, sizeof(index));
+    index.iMagic = DMD_SPOOL_INDEX_MAGIC;
+    index.iVersion = DMD_SPOOL_INDEX_VERSION;
+    index.iReadId = m_vecSegments.empty() ? m_iNextId
+        : m_vecSegments.front().iId;
+    index.ulReadOffset = m_ulReadOffset;
+    index.ulReadFrames = m_ulReadFrames;
+    std::vector<DmdSpoolIndexEntry> vecEntries;
+    for (size_t i = 0; i < m_vecSegments.size(); i++) {
+        // the open segment is scanned at Open() instead;
+        if (m_iWriteFd >= 0 && i + 1 == m_vecSegments.size()) {
+            break;
+        }
+        DmdSpoolIndexEntry entry;
+        entry.iId = m_vecSegments[i].iId;
+        entry.iReserved = 0;
+        entry.ulBytes = m_vecSegments[i].ulBytes;
+        entry.ulFrameCount = m_vecSegments[i].ulFrameCount;
+        vecEntries.push_back(entry);
+    }
+    index.iSegmentCount = vecEntries.size();
+    size_t ulEntryBytes = vecEntries.size() * sizeof(DmdSpoolIndexEntry);
+    uint32_t iCrc = DmdSpoolCrc(DmdSpoolCrc(0, &index, sizeof(index)),
+            vecEntries.data(), ulEntryBytes);
+
+    std::string sPath = m_param.sDirectory + "/spool.idx";
+    std::string sTempPath = sPath + ".tmp";
+    int iFd = open(sTempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644);
+    if (iFd < 0) {
+        m_stats.ulWriteErrorCount++;
+        return DMD_S_FAIL;
+    }
+    struct iovec arrIov[3];
+    arrIov[0].iov_base = &index;
+    arrIov[0].iov_len = sizeof(index);
+    arrIov[1].iov_base = vecEntries.data();
+    arrIov[1].iov_len = ulEntryBytes;
+    arrIov[2].iov_base = &iCrc;
+    arrIov[2].iov_len = sizeof(iCrc);
+    ssize_t ulExpected = sizeof(index) + ulEntryBytes + sizeof(iCrc);
+    bool bWritten = ulExpected == writev(iFd, arrIov, 3) && 0 == fdatasync(iFd);
+    close(iFd);
+    // rename replaces the index whole, the directory sync makes it and the
+    // segment files it names durable;
+    if (!bWritten || rename(sTempPath.c_str(), sPath.c_str()) < 0) {
+        m_stats.ulWriteErrorCount++;
+        unlink(sTempPath.c_str());
+        return DMD_S_FAIL;
+    }
+    int iDirFd = open(m_param.sDirectory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (iDirFd >= 0) {
+        fsync(iDirFd);
+        close(iDirFd);
+    }
+    m_bIndexDirty = false;
+    m_stats.ulCheckpointCount++;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdDiskSpool::DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) {
+    if (NULL == pEncodedFrame) {
+        return DMD_S_FAIL;
+    }
+    m_mtxSpoolMutex.Lock();
+    if (!m_bOpen) {
+        m_mtxSpoolMutex.Unlock();
+        return DMD_S_FAIL;
+    }
+    DMD_RESULT ret = DMD_S_OK;
+    if (acceptLocked(pEncodedFrame)) {
+        ret = appendLocked(pEncodedFrame);
+    }
+    m_mtxSpoolMutex.Unlock();
+    return ret;
+}
+
+bool CDmdDiskSpool::acceptLocked(const DmdEncodedFrame *pEncodedFrame) {
+    if (0 == pEncodedFrame->ulDataLen || NULL == pEncodedFrame->pData
+            || pEncodedFrame->eLayer > DmdLayerDetect) {
+        m_stats.ulFilteredCount++;
+        return false;
+    }
+    bool bAccept = true;
+    if (DmdSpoolMotionOnly == m_param.ePolicy) {
+        bAccept = DmdLayerRecord == pEncodedFrame->eLayer
+            && pEncodedFrame->bMotion;
+    } else if (DmdSpoolRecordLayer == m_param.ePolicy) {
+        bAccept = DmdLayerRecord == pEncodedFrame->eLayer;
+    }
+    if (!bAccept) {
+        // what follows the gap refers to frames not written;
+        m_bWaitKey[pEncodedFrame->eLayer] = true;
+        m_stats.ulFilteredCount++;
+        return false;
+    }
+    if (m_bWaitKey[pEncodedFrame->eLayer]) {
+        if (!DmdSpoolIsKeyFrame(pEncodedFrame->eFrameType)) {
+            m_bKeyFrameRequest = true;
+            m_stats.ulWaitKeyCount++;
+            return false;
+        }
+        m_bWaitKey[pEncodedFrame->eLayer] = false;
+    }
+    return true;
+}
+
+DMD_RESULT CDmdDiskSpool::appendLocked(const DmdEncodedFrame *pEncodedFrame) {
+    if (pEncodedFrame->ulDataLen > DMD_SPOOL_MAX_FRAME_BYTES
+            || pEncodedFrame->iNalCount > DMD_SPOOL_MAX_NAL_COUNT
+            || (pEncodedFrame->iNalCount && NULL == pEncodedFrame->pNalIov)) {
+        DMD_LOG_ERROR("CDmdDiskSpool::appendLocked(), frame of "
+                << pEncodedFrame->ulDataLen << " bytes, "
+                << pEncodedFrame->iNalCount << " nal units, not spooled");
+        m_stats.ulWriteErrorCount++;
+        m_bWaitKey[pEncodedFrame->eLayer] = true;
+        return DMD_S_FAIL;
+    }
+
+    DmdSpoolRecord record;
+    memset(&record, 0, sizeof(record));
+    record.iMagic = DMD_SPOOL_RECORD_MAGIC;
+    record.iDataLen = pEncodedFrame->ulDataLen;
+    record.ulTimestamp = pEncodedFrame->ulTimestamp;
+    record.iWidth = pEncodedFrame->iWidth;
+    record.iHeight = pEncodedFrame->iHeight;
+    record.iFrameType = pEncodedFrame->eFrameType;
+    record.iLayer = pEncodedFrame->eLayer;
+    record.iFlags = pEncodedFrame->bMotion ? DMD_SPOOL_FLAG_MOTION : 0;
+    record.iNalCount = pEncodedFrame->iNalCount;
+    m_vecWriteNals.resize(pEncodedFrame->iNalCount);
+    for (unsigned int i = 0; i < pEncodedFrame->iNalCount; i++) {
+        const uint8_t *pNal = static_cast<const uint8_t *>(
+                pEncodedFrame->pNalIov[i].iov_base);
+        m_vecWriteNals[i].iOffset = pNal - pEncodedFrame->pData;
+        m_vecWriteNals[i].iLength = pEncodedFrame->pNalIov[i].iov_len;
+    }
+    size_t ulNalBytes = pEncodedFrame->iNalCount * sizeof(DmdSpoolNal);
+    uint32_t iCrc = DmdSpoolCrc(0, &record, offsetof(DmdSpoolRecord, iCrc));
+    iCrc = DmdSpoolCrc(iCrc, m_vecWriteNals.data(), ulNalBytes);
+    record.iCrc = DmdSpoolCrc(iCrc, pEncodedFrame->pData,
+            pEncodedFrame->ulDataLen);
+    uint64_t ulRecordBytes = sizeof(record) + ulNalBytes
+        + pEncodedFrame->ulDataLen;
+
+    // a new segment starts at a key frame, so that evicting the one before
+    // leaves it decodable;
+    if (m_iWriteFd >= 0) {
+        uint64_t ulSegmentBytes = m_vecSegments.back().ulBytes;
+        if ((ulSegmentBytes >= m_param.ulSegmentBytes
+                    && DmdSpoolIsKeyFrame(pEncodedFrame->eFrameType))
+                || ulSegmentBytes >= 2 * m_param.ulSegmentBytes) {
+            sealLocked();
+        }
+    }
+    evictLocked(ulRecordBytes);
+    if (m_iWriteFd < 0 && DMD_S_OK != openSegmentLocked()) {
+        m_stats.ulWriteErrorCount++;
+        m_bWaitKey[pEncodedFrame->eLayer] = true;
+        return DMD_S_FAIL;
+    }
+
+    struct iovec arrIov[3];
+    arrIov[0].iov_base = &record;
+    arrIov[0].iov_len = sizeof(record);
+    arrIov[1].iov_base = m_vecWriteNals.data();
+    arrIov[1].iov_len = ulNalBytes;
+    arrIov[2].iov_base = pEncodedFrame->pData;
+    arrIov[2].iov_len = pEncodedFrame->ulDataLen;
+    DmdSpoolSegment &segment = m_vecSegments.back();
+    ssize_t ret = pwritev(m_iWriteFd, arrIov, 3, segment.ulBytes);
+    if (ret < 0 || static_cast<uint64_t>(ret) != ulRecordBytes) {
+        DMD_LOG_ERROR("CDmdDiskSpool::appendLocked(), write to segment "
+                << segment.iId << " failed, " << strerror(errno));
+        // the next record goes where this one would have;
+        if (ftruncate(m_iWriteFd, segment.ulBytes) < 0) {
+            sealLocked();
+        }
+        m_stats.ulWriteErrorCount++;
+        m_bWaitKey[pEncodedFrame->eLayer] = true;
+        return DMD_S_FAIL;
+    }
+    segment.ulBytes += ulRecordBytes;
+    segment.ulFrameCount++;
+    m_stats.ulWrittenCount++;
+    m_stats.ulWrittenBytes += ulRecordBytes;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdDiskSpool::openSegmentLocked() {
+    DmdSpoolSegment segment;
+    segment.iId = m_iNextId;
+    segment.ulBytes = 0;
+    segment.ulFrameCount = 0;
+    std::string sPath = segmentPath(segment.iId);
+    m_iWriteFd = open(sPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            0644);
+    if (m_iWriteFd < 0) {
+        DMD_LOG_ERROR("CDmdDiskSpool::openSegmentLocked(), open " << sPath
+                << " failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    m_iNextId++;
+    m_vecSegments.push_back(segment);
+    return DMD_S_OK;
+}
+
+void CDmdDiskSpool::sealLocked() {
+    // the one sync a segment gets, records are not synced each;
+    if (fdatasync(m_iWriteFd) < 0) {
+        m_stats.ulWriteErrorCount++;
+    }
+    close(m_iWriteFd);
+    m_iWriteFd = -1;
+    m_stats.ulSyncCount++;
+    if (0 == m_vecSegments.back().ulBytes) {
+        unlink(segmentPath(m_vecSegments.back().iId).c_str());
+        m_vecSegments.pop_back();
+    }
+    m_bIndexDirty = true;
+    writeIndexLocked();
+}
+
+void CDmdDiskSpool::evictLocked(uint64_t ulRecordBytes) {
+    while (pendingBytesLocked() + ulRecordBytes > m_param.ulMaxBytes
+            && !m_vecSegments.empty()
+            && (m_iWriteFd < 0 || m_vecSegments.size() > 1)) {
+        const DmdSpoolSegment &segment = m_vecSegments.front();
+        m_stats.ulEvictedCount++;
+        m_stats.ulEvictedBytes += segment.ulBytes - m_ulReadOffset;
+        DMD_LOG_WARNING("CDmdDiskSpool::evictLocked(), spool full, segment "
+                << segment.iId << " dropped");
+        dropFrontLocked();
+    }
+}
+
+void CDmdDiskSpool::dropFrontLocked() {
+    if (m_iReadFd >= 0) {
+        close(m_iReadFd);
+        m_iReadFd = -1;
+    }
+    unlink(segmentPath(m_vecSegments.front().iId).c_str());
+    m_vecSegments.erase(m_vecSegments.begin());
+    m_ulReadOffset = 0;
+    m_ulReadFrames = 0;
+    m_bIndexDirty = true;
+    writeIndexLocked();
+}
+
+void CDmdDiskSpool::SetDrainRate(uint64_t ulRateBps) {
+    m_mtxSpoolMutex.Lock();
+    m_ulDrainRateBps = ulRateBps;
+    m_mtxSpoolMutex.Unlock();
+}
+
+unsigned int CDmdDiskSpool::Drain(uint64_t ulNowUs,
+        IDmdEncodeEngineSink *pSink) {
+    if (NULL == pSink) {
+        return 0;
+    }
+    m_mtxSpoolMutex.Lock();
+    if (!m_bOpen) {
+        m_mtxSpoolMutex.Unlock();
+        return 0;
+    }
+    if (m_ulLastDrainUs && ulNowUs > m_ulLastDrainUs) {
+        m_fDrainTokens += static_cast<double>(ulNowUs - m_ulLastDrainUs)
+            * m_ulDrainRateBps / 8000000;
+    }
+    m_ulLastDrainUs = ulNowUs;
+    double fBurst = static_cast<double>(m_ulDrainRateBps)
+        * DMD_SPOOL_DRAIN_BURST_US / 8000000;
+    m_fDrainTokens = std::min(m_fDrainTokens, fBurst);
+    if (0 == m_ulLastCheckpointUs) {
+        m_ulLastCheckpointUs = ulNowUs;
+    }
+
+    unsigned int iDrained = 0;
+    // a frame goes once there are any tokens, larger ones borrow from
+    // what follows;
+    while (m_fDrainTokens > 0 && !m_vecSegments.empty()) {
+        DmdSpoolSegment &segment = m_vecSegments.front();
+        bool bWriting = m_iWriteFd >= 0 && 1 == m_vecSegments.size();
+        if (m_ulReadOffset >= segment.ulBytes) {
+            if (bWriting) {
+                break;
+            }
+            dropFrontLocked();
+            continue;
+        }
+        if (m_iReadFd < 0 || m_iReadId != segment.iId) {
+            if (m_iReadFd >= 0) {
+                close(m_iReadFd);
+            }
+            m_iReadFd = open(segmentPath(segment.iId).c_str(),
+                    O_RDONLY | O_CLOEXEC);
+            m_iReadId = segment.iId;
+        }
+        DmdEncodedFrame frame;
+        uint64_t ulRecordBytes = 0;
+        if (m_iReadFd < 0 || DMD_S_OK != readRecordLocked(m_iReadFd,
+                    m_ulReadOffset, segment.ulBytes, &frame, &ulRecordBytes)) {
+            // past what the crc vouched for at Open(), nothing is trusted;
+            DMD_LOG_ERROR("CDmdDiskSpool::Drain(), bad record in segment "
+                    << segment.iId << " at " << m_ulReadOffset);
+            m_stats.ulCorruptCount++;
+            m_ulReadFrames = segment.ulFrameCount;
+            m_ulReadOffset = segment.ulBytes;
+            m_bIndexDirty = true;
+            continue;
+        }
+        pSink->DeliverEncodedData(&frame);
+        m_ulReadOffset += ulRecordBytes;
+        m_ulReadFrames++;
+        m_bIndexDirty = true;
+        m_fDrainTokens -= ulRecordBytes;
+        m_stats.ulDrainedCount++;
+        m_stats.ulDrainedBytes += ulRecordBytes;
+        iDrained++;
+    }
+
+    // a crash repeats what was drained since;
+    if (m_bIndexDirty
+            && ulNowUs - m_ulLastCheckpointUs >= m_param.ulCheckpointUs) {
+        writeIndexLocked();
+        m_ulLastCheckpointUs = ulNowUs;
+    }
+    m_mtxSpoolMutex.Unlock();
+    return iDrained;
+}
+
+DMD_RESULT CDmdDiskSpool::readRecordLocked(int iFd, uint64_t ulOffset,
+        uint64_t ulLimit, DmdEncodedFrame *pFrame, uint64_t *pRecordBytes) {
+    DmdSpoolRecord record;
+    if (ulOffset + sizeof(record) > ulLimit
+            || !DmdSpoolReadFull(iFd, &record, sizeof(record), ulOffset)
+            || DMD_SPOOL_RECORD_MAGIC != record.iMagic
+            || record.iDataLen > DMD_SPOOL_MAX_FRAME_BYTES
+            || record.iNalCount > DMD_SPOOL_MAX_NAL_COUNT
+            || record.iLayer > DmdLayerDetect) {
+        return DMD_S_FAIL;
+    }
+    size_t ulNalBytes = record.iNalCount * sizeof(DmdSpoolNal);
+    uint64_t ulRecordBytes = sizeof(record) + ulNalBytes + record.iDataLen;
+    if (ulOffset + ulRecordBytes > ulLimit) {
+        return DMD_S_FAIL;
+    }
+    m_vecReadBuffer.resize(ulNalBytes + record.iDataLen);
+    if (!DmdSpoolReadFull(iFd, m_vecReadBuffer.data(), m_vecReadBuffer.size(),
+                ulOffset + sizeof(record))) {
+        return DMD_S_FAIL;
+    }
+    uint32_t iCrc = DmdSpoolCrc(0, &record, offsetof(DmdSpoolRecord, iCrc));
+    if (record.iCrc != DmdSpoolCrc(iCrc, m_vecReadBuffer.data(),
+                m_vecReadBuffer.size())) {
+        return DMD_S_FAIL;
+    }
+
+    uint8_t *pData = m_vecReadBuffer.data() + ulNalBytes;
+    const DmdSpoolNal *pNals =
+        reinterpret_cast<const DmdSpoolNal *>(m_vecReadBuffer.data());
+    m_vecReadNals.resize(record.iNalCount);
+    for (unsigned int i = 0; i < record.iNalCount; i++) {
+        if (static_cast<uint64_t>(pNals[i].iOffset) + pNals[i].iLength
+                > record.iDataLen) {
+            return DMD_S_FAIL;
+        }
+        m_vecReadNals[i].iov_base = pData + pNals[i].iOffset;
+        m_vecReadNals[i].iov_len = pNals[i].iLength;
+    }
+    memset(pFrame, 0, sizeof(*pFrame));
+    pFrame->pData = pData;
+    pFrame->ulDataLen = record.iDataLen;
+    pFrame->iNalCount = record.iNalCount;
+    pFrame->pNalIov = m_vecReadNals.data();
+    pFrame->pFrameBuffer = NULL;
+    pFrame->eFrameType = static_cast<DmdEncodedFrameType>(record.iFrameType);
+    pFrame->iWidth = record.iWidth;
+    pFrame->iHeight = record.iHeight;
+    pFrame->ulTimestamp = record.ulTimestamp;
+    pFrame->eLayer = static_cast<DmdEncodeLayer>(record.iLayer);
+    pFrame->bMotion = record.iFlags & DMD_SPOOL_FLAG_MOTION;
+    *pRecordBytes = ulRecordBytes;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdDiskSpool::Checkpoint() {
+    m_mtxSpoolMutex.Lock();
+    DMD_RESULT ret = m_bOpen ? writeIndexLocked() : DMD_S_FAIL;
+    m_mtxSpoolMutex.Unlock();
+    return ret;
+}
+
+bool CDmdDiskSpool::TakeKeyFrameRequest() {
+    m_mtxSpoolMutex.Lock();
+    bool bRequest = m_bKeyFrameRequest;
+    m_bKeyFrameRequest = false;
+    m_mtxSpoolMutex.Unlock();
+    return bRequest;
+}
+
+uint64_t CDmdDiskSpool::pendingBytesLocked() const {
+    uint64_t ulBytes = 0;
+    for (size_t i = 0; i < m_vecSegments.size(); i++) {
+        ulBytes += m_vecSegments[i].ulBytes;
+    }
+    return ulBytes - std::min(ulBytes, m_ulReadOffset);
+}
+
+uint64_t CDmdDiskSpool::pendingFramesLocked() const {
+    uint64_t ulFrames = 0;
+    for (size_t i = 0; i < m_vecSegments.size(); i++) {
+        ulFrames += m_vecSegments[i].ulFrameCount;
+    }
+    return ulFrames - std::min(ulFrames, m_ulReadFrames);
+}
+
+bool CDmdDiskSpool::IsEmpty() {
+    m_mtxSpoolMutex.Lock();
+    bool bEmpty = 0 == pendingBytesLocked();
+    m_mtxSpoolMutex.Unlock();
+    return bEmpty;
+}
+
+float CDmdDiskSpool::GetFillLevel() {
+    m_mtxSpoolMutex.Lock();
+    float fFillLevel = m_param.ulMaxBytes
+        ? static_cast<float>(pendingBytesLocked()) / m_param.ulMaxBytes : 0;
+    m_mtxSpoolMutex.Unlock();
+    return fFillLevel;
+}
+
+void CDmdDiskSpool::GetStats(DmdSpoolStats *pStats) {
+    if (NULL == pStats) {
+        return;
+    }
+    m_mtxSpoolMutex.Lock();
+    *pStats = m_stats;
+    pStats->ulBytes = pendingBytesLocked();
+    pStats->ulFrameCount = pendingFramesLocked();
+    pStats->iSegmentCount = m_vecSegments.size();
+    pStats->fFillLevel = m_param.ulMaxBytes
+        ? static_cast<float>(pStats->ulBytes) / m_param.ulMaxBytes : 0;
+    m_mtxSpoolMutex.Unlock();
+}
+
+}  // namespace opendmd
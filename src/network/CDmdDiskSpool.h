@@ -0,0 +1,202 @@
+/*
+ ============================================================================
+ * Name        : CDmdDiskSpool.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdDiskSpool.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDDISKSPOOL_H
+#define SRC_NETWORK_CDMDDISKSPOOL_H
+
+#include <sys/uio.h>
+
+#include <string>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "thread/DmdThreadMutex.h"
+
+namespace opendmd {
+
+#define DMD_SPOOL_DEFAULT_MAX_BYTES       (1024ULL * 1024 * 1024)
+// a segment is sealed, and synced, at the first key frame beyond this,
+// or at twice this without one;
+#define DMD_SPOOL_DEFAULT_SEGMENT_BYTES   (16ULL * 1024 * 1024)
+// how much drain progress a crash may repeat;
+#define DMD_SPOOL_DEFAULT_CHECKPOINT_US   1000000
+#define DMD_SPOOL_MAX_FRAME_BYTES         (16 * 1024 * 1024)
+// drained frames may go this far ahead of the rate;
+#define DMD_SPOOL_DRAIN_BURST_US          100000
+
+typedef enum {
+    DmdSpoolMotionOnly = 0,   // record layer frames of a motion event;
+    DmdSpoolRecordLayer,      // all of the record layer;
+    DmdSpoolAll,              // detect layer too;
+} DmdSpoolPolicy;
+
+typedef struct {
+    std::string     sDirectory;          // one per camera, made if missing;
+    uint64_t        ulMaxBytes;          // oldest segments go beyond;
+    uint64_t        ulSegmentBytes;
+    uint64_t        ulCheckpointUs;
+    DmdSpoolPolicy  ePolicy;
+    uint64_t        ulDrainRateBps;      // until SetDrainRate();
+} DmdSpoolParam;
+
+typedef struct {
+    uint64_t        ulWrittenCount;
+    uint64_t        ulWrittenBytes;
+    uint64_t        ulFilteredCount;     // not of the policy;
+    uint64_t        ulWaitKeyCount;      // dropped until a key frame;
+    uint64_t        ulEvictedCount;      // segments dropped, spool full;
+    uint64_t        ulEvictedBytes;
+    uint64_t        ulDrainedCount;
+    uint64_t        ulDrainedBytes;
+    uint64_t        ulTruncatedBytes;    // torn tail cut at Open();
+    uint64_t        ulCorruptCount;      // bad records, skipped;
+    uint64_t        ulWriteErrorCount;
+    uint64_t        ulSyncCount;         // segments sealed;
+    uint64_t        ulCheckpointCount;
+    // at the time of the call;
+    uint64_t        ulBytes;             // waiting to drain;
+    uint64_t        ulFrameCount;
+    unsigned int    iSegmentCount;
+    float           fFillLevel;          // ulBytes of ulMaxBytes;
+} DmdSpoolStats;
+
+/*
+ * Store and forward for encoded video while the server or the uplink is
+ * down. The client hands the spool its encoded frames instead of the
+ * packetizer; those of the policy, motion events by default, are
+ * appended to segment files, each frame behind a header with its length,
+ * capture time and crc. Segments start at key frames where they can,
+ * so that evicting the oldest, when the spool is full, leaves the rest
+ * decodable. Once reconnected, Drain() hands the frames back, oldest
+ * first and with their capture times, at a rate the caller sets to the
+ * headroom live traffic leaves.
+ *
+ * Crash consistency costs no sync per frame: a segment is synced once,
+ * when it is sealed, and Open() cuts the last one back to its last
+ * whole record by crc. A small index, rewritten by rename at each seal
+ * and checkpoint, holds the drain position and a summary of each sealed
+ * segment, so that reopening reads no more than the last segment; a
+ * crash repeats at most one checkpoint interval of drained frames.
+ *
+ * Writer and drain may run on different threads; file i/o is done under
+ * the spool lock, and so is the drain sink called, it must not call back
+ * into the spool.
+ */
+class CDmdDiskSpool : public IDmdEncodeEngineSink {
+public:
+    CDmdDiskSpool();
+    ~CDmdDiskSpool();
+
+    // recovers what a previous run left in the directory;
+    DMD_RESULT Open(const DmdSpoolParam &spoolParam);
+    DMD_RESULT Close();
+
+    // IDmdEncodeEngineSink interface, the writer side;
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame);
+    // true once after frames were dropped until a key frame;
+    bool TakeKeyFrameRequest();
+
+    void SetDrainRate(uint64_t ulRateBps);
+    // hands the frames due by ulNowUs to pSink, oldest first; a frame's
+    // pFrameBuffer is NULL, its data valid only during the call;
+    unsigned int Drain(uint64_t ulNowUs, IDmdEncodeEngineSink *pSink);
+    // writes the index now;
+    DMD_RESULT Checkpoint();
+
+    bool IsEmpty();
+    float GetFillLevel();
+    void GetStats(DmdSpoolStats *pStats);
+
+private:
+    typedef struct {
+        uint32_t        iId;
+        uint64_t        ulBytes;         // whole records only;
+        uint64_t        ulFrameCount;
+    } DmdSpoolSegment;
+    // a nal unit without its start code, as in pNalIov; after each record
+    // header in the segment;
+    typedef struct {
+        uint32_t        iOffset;
+        uint32_t        iLength;
+    } DmdSpoolNal;
+
+    std::string segmentPath(uint32_t iId) const;
+    void recover();
+    bool loadIndex(std::vector<DmdSpoolSegment> *pVecIndexed);
+    DMD_RESULT scanSegment(DmdSpoolSegment *pSegment);
+    DMD_RESULT writeIndexLocked();
+    bool acceptLocked(const DmdEncodedFrame *pEncodedFrame);
+    DMD_RESULT appendLocked(const DmdEncodedFrame *pEncodedFrame);
+    DMD_RESULT openSegmentLocked();
+    void sealLocked();
+    void evictLocked(uint64_t ulRecordBytes);
+    void dropFrontLocked();
+    DMD_RESULT readRecordLocked(int iFd, uint64_t ulOffset,
+            uint64_t ulLimit, DmdEncodedFrame *pFrame, uint64_t *pRecordBytes);
+    uint64_t pendingBytesLocked() const;
+    uint64_t pendingFramesLocked() const;
+
+private:
+    DmdSpoolParam                    m_param;
+    bool                             m_bOpen;
+    DmdThreadMutex                   m_mtxSpoolMutex;
+    std::vector<DmdSpoolSegment>     m_vecSegments;   // oldest first;
+    int                              m_iWriteFd;      // last segment;
+    int                              m_iReadFd;       // first segment;
+    uint32_t                         m_iReadId;       // of m_iReadFd;
+    uint32_t                         m_iNextId;
+    uint64_t                         m_ulReadOffset;  // in the first;
+    uint64_t                         m_ulReadFrames;
+    bool                             m_bWaitKey[DmdLayerDetect + 1];
+    bool                             m_bKeyFrameRequest;
+    bool                             m_bIndexDirty;
+    uint64_t                         m_ulLastCheckpointUs;
+    uint64_t                         m_ulDrainRateBps;
+    double                           m_fDrainTokens;  // bytes;
+    uint64_t                         m_ulLastDrainUs;
+    std::vector<uint8_t>             m_vecReadBuffer;
+    std::vector<struct iovec>        m_vecReadNals;
+    std::vector<DmdSpoolNal>         m_vecWriteNals;  // of the append;
+    DmdSpoolStats                    m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDDISKSPOOL_H
@@ -0,0 +1,271 @@
+/*
+ ============================================================================
+ * Name        : CDmdFecDecoder.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : rebuilds lost rtp packets from xor parity.
+ ============================================================================
+ */
+
+#include "CDmdFecDecoder.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+CDmdFecDecoder::CDmdFecDecoder() : m_iMediaSsrc(0), m_pRecoveredSink(NULL),
+        m_bStarted(false), m_iHighest(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdFecDecoder::~CDmdFecDecoder() {
+}
+
+DMD_RESULT CDmdFecDecoder::Init(uint32_t iMediaSsrc,
+        IDmdRtpPacketSink *pRecoveredSink) {
+    if (NULL == pRecoveredSink) {
+        DMD_LOG_ERROR("CDmdFecDecoder::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_iMediaSsrc = iMediaSsrc;
+    m_pRecoveredSink = pRecoveredSink;
+    m_vecSlots.resize(DMD_FEC_MEDIA_WINDOW);
+    for (size_t i = 0; i < m_vecSlots.size(); i++) {
+        m_vecSlots[i].bValid = false;
+        m_vecSlots[i].vecData.reserve(DMD_RTP_DEFAULT_MTU);
+    }
+    m_dequePending.clear();
+    m_bStarted = false;
+    m_iHighest = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    return DMD_S_OK;
+}
+
+void CDmdFecDecoder::storeMedia(uint16_t iSequence, const uint8_t *pData,
+        size_t ulSize) {
+    DmdFecMediaSlot &slot = m_vecSlots[iSequence & (DMD_FEC_MEDIA_WINDOW - 1)];
+    slot.bValid = true;
+    slot.iSequence = iSequence;
+    slot.vecData.assign(pData, pData + ulSize);
+    if (!m_bStarted || static_cast<int16_t>(iSequence - m_iHighest) > 0) {
+        m_iHighest = iSequence;
+        m_bStarted = true;
+    }
+}
+
+bool CDmdFecDecoder::hasMedia(uint16_t iSequence) const {
+    const DmdFecMediaSlot &slot =
+        m_vecSlots[iSequence & (DMD_FEC_MEDIA_WINDOW - 1)];
+    return slot.bValid && slot.iSequence == iSequence;
+}
+
+DMD_RESULT CDmdFecDecoder::OnMediaPacket(const uint8_t *pData,
+        size_t ulSize) {
+    DmdRtpHeader rtpHeader;
+    if (m_vecSlots.empty()
+            || DMD_S_OK != DmdRtpParseHeader(pData, ulSize, &rtpHeader, NULL)
+            || rtpHeader.iSsrc != m_iMediaSsrc) {
+        return DMD_S_FAIL;
+    }
+    m_stats.ulMediaPacketCount++;
+    m_stats.ulMediaBytes += ulSize;
+    storeMedia(rtpHeader.iSequence, pData, ulSize);
+    expirePending();
+    recoverPending();
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdFecDecoder::OnFecPacket(const uint8_t *pData, size_t ulSize) {
+    DmdRtpHeader rtpHeader;
+    size_t ulHeaderSize = 0;
+    if (m_vecSlots.empty()
+            || DMD_S_OK != DmdRtpParseHeader(pData, ulSize, &rtpHeader,
+                &ulHeaderSize)
+            || ulSize < ulHeaderSize + DMD_FEC_HEADER_SIZE
+                + DMD_FEC_LEVEL_HEADER_SIZE) {
+        return DMD_S_FAIL;
+    }
+    const uint8_t *pFec = pData + ulHeaderSize;
+    size_t ulFecSize = ulSize - ulHeaderSize;
+    const uint8_t *pLevel = pFec + DMD_FEC_HEADER_SIZE;
+    size_t ulProtection = (pLevel[0] << 8) | pLevel[1];
+    // long masks, the L bit, are not produced by CDmdFecEncoder;
+    if ((pFec[0] & 0x40) || ulFecSize < DMD_FEC_HEADER_SIZE
+            + DMD_FEC_LEVEL_HEADER_SIZE + ulProtection) {
+        DMD_LOG_WARNING("CDmdFecDecoder::OnFecPacket(), unsupported or "
+                "truncated fec packet, " << ulSize << " bytes");
+        return DMD_S_FAIL;
+    }
+    m_stats.ulFecPacketCount++;
+    m_stats.ulFecBytes += ulSize;
+
+    DmdFecPending pending;
+    pending.iBase = static_cast<uint16_t>((pFec[2] << 8) | pFec[3]);
+    pending.iMask = static_cast<uint16_t>((pLevel[2] << 8) | pLevel[3]);
+    pending.vecData.assign(pFec, pFec + ulFecSize);
+    if (tryRecover(pending)) {
+        recoverPending();
+        return DMD_S_OK;
+    }
+    if (m_dequePending.size() >= DMD_FEC_MAX_PENDING) {
+        m_stats.ulUnrecoverableCount++;
+        m_dequePending.pop_front();
+    }
+    m_dequePending.push_back(pending);
+    return DMD_S_OK;
+}
+
+bool CDmdFecDecoder::tryRecover(const DmdFecPending &pending) {
+    unsigned int iMissingCount = 0;
+    uint16_t iMissing = 0;
+    for (int i = 0; i < DMD_FEC_MAX_GROUP_SIZE; i++) {
+        if (0 == (pending.iMask & (0x8000 >> i))) {
+            continue;
+        }
+        uint16_t iSequence = static_cast<uint16_t>(pending.iBase + i);
+        if (!hasMedia(iSequence)) {
+            iMissingCount++;
+            iMissing = iSequence;
+        }
+    }
+    if (0 == iMissingCount) {
+        return true;
+    }
+    if (iMissingCount > 1) {
+        return false;
+    }
+
+    // xor the run back together, the fec header stands in for the header
+    // fields of the missing packet;
+    const uint8_t *pFec = &pending.vecData[0];
+    const uint8_t *pLevel = pFec + DMD_FEC_HEADER_SIZE;
+    size_t ulProtection = (pLevel[0] << 8) | pLevel[1];
+    uint8_t arrHeader[8];
+    memcpy(arrHeader, pFec, 2);
+    memcpy(arrHeader + 4, pFec + 4, 4);
+    uint16_t iLength = static_cast<uint16_t>((pFec[8] << 8) | pFec[9]);
+    m_vecRecovered.assign(DMD_RTP_HEADER_SIZE + ulProtection, 0);
+    uint8_t *pPayload = &m_vecRecovered[DMD_RTP_HEADER_SIZE];
+    memcpy(pPayload, pLevel + DMD_FEC_LEVEL_HEADER_SIZE, ulProtection);
+    for (int i = 0; i < DMD_FEC_MAX_GROUP_SIZE; i++) {
+        uint16_t iSequence = static_cast<uint16_t>(pending.iBase + i);
+        if (0 == (pending.iMask & (0x8000 >> i)) || iSequence == iMissing) {
+            continue;
+        }
+        const std::vector<uint8_t> &media =
+            m_vecSlots[iSequence & (DMD_FEC_MEDIA_WINDOW - 1)].vecData;
+        arrHeader[0] ^= media[0];
+        arrHeader[1] ^= media[1];
+        for (int k = 4; k < 8; k++) {
+            arrHeader[k] ^= media[k];
+        }
+        size_t ulMediaPayload = media.size() - DMD_RTP_HEADER_SIZE;
+        iLength ^= static_cast<uint16_t>(ulMediaPayload);
+        DmdFecXor(pPayload, &media[DMD_RTP_HEADER_SIZE],
+                ulMediaPayload < ulProtection ? ulMediaPayload : ulProtection);
+    }
+    if (iLength > ulProtection) {
+        m_stats.ulUnrecoverableCount++;
+        DMD_LOG_WARNING("CDmdFecDecoder::tryRecover(), sequence "
+                << iMissing << " recovered with a bad length " << iLength);
+        return true;
+    }
+
+    DmdRtpHeader rtpHeader;
+    rtpHeader.bMarker = 0 != (arrHeader[1] & 0x80);
+    rtpHeader.iPayloadType = arrHeader[1] & 0x7f;
+    rtpHeader.iSequence = iMissing;
+    rtpHeader.iTimestamp = (static_cast<uint32_t>(arrHeader[4]) << 24)
+        | (arrHeader[5] << 16) | (arrHeader[6] << 8) | arrHeader[7];
+    rtpHeader.iSsrc = m_iMediaSsrc;
+    DmdRtpWriteHeader(rtpHeader, &m_vecRecovered[0]);
+    // padding, extension and csrc count of the original;
+    m_vecRecovered[0] |= arrHeader[0] & 0x3f;
+    m_vecRecovered.resize(DMD_RTP_HEADER_SIZE + iLength);
+    storeMedia(iMissing, &m_vecRecovered[0], m_vecRecovered.size());
+    m_stats.ulRecoveredCount++;
+
+    struct iovec iov = {&m_vecRecovered[0], m_vecRecovered.size()};
+    DmdRtpPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.pIov = &iov;
+    packet.iIovCount = 1;
+    packet.ulSize = m_vecRecovered.size();
+    packet.iSequence = iMissing;
+    packet.iTimestamp = rtpHeader.iTimestamp;
+    packet.bMarker = rtpHeader.bMarker;
+    unsigned int iSent = 0;
+    m_pRecoveredSink->SendPackets(&packet, 1, &iSent);
+    return true;
+}
+
+void CDmdFecDecoder::recoverPending() {
+    bool bProgress = true;
+    while (bProgress) {
+        bProgress = false;
+        std::deque<DmdFecPending>::iterator it = m_dequePending.begin();
+        while (it != m_dequePending.end()) {
+            uint64_t ulRecovered = m_stats.ulRecoveredCount;
+            if (tryRecover(*it)) {
+                it = m_dequePending.erase(it);
+                bProgress = bProgress
+                    || ulRecovered != m_stats.ulRecoveredCount;
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+// a run whose packets left the media window can no longer be repaired;
+void CDmdFecDecoder::expirePending() {
+    while (!m_dequePending.empty()) {
+        int iAge = static_cast<int16_t>(m_iHighest
+                - m_dequePending.front().iBase);
+        if (iAge < DMD_FEC_MEDIA_WINDOW / 2) {
+            break;
+        }
+        m_stats.ulUnrecoverableCount++;
+        m_dequePending.pop_front();
+    }
+}
+
+void CDmdFecDecoder::GetStats(DmdFecDecoderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,122 @@
+/*
+ ============================================================================
+ * Name        : CDmdFecDecoder.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdFecDecoder.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDFECDECODER_H
+#define SRC_NETWORK_CDMDFECDECODER_H
+
+#include <sys/uio.h>
+
+#include <deque>
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdFec.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// media packets kept to repair from, a power of two;
+#define DMD_FEC_MEDIA_WINDOW        512
+// parity packets waiting for their run to be complete enough;
+#define DMD_FEC_MAX_PENDING         64
+
+typedef struct {
+    uint64_t        ulMediaPacketCount;
+    uint64_t        ulMediaBytes;
+    uint64_t        ulFecPacketCount;
+    uint64_t        ulFecBytes;          // the overhead;
+    uint64_t        ulRecoveredCount;
+    uint64_t        ulUnrecoverableCount; // runs that lost two or more;
+} DmdFecDecoderStats;
+
+/*
+ * Server side of CDmdFecEncoder, for one media ssrc: rebuilds a packet
+ * missing from a parity run out of the rest of the run, and hands it to
+ * the recovered sink before depacketization, as if it had arrived. A
+ * repaired packet may complete another run, so runs are retried until
+ * nothing more comes back.
+ */
+class CDmdFecDecoder {
+public:
+    CDmdFecDecoder();
+    ~CDmdFecDecoder();
+
+    DMD_RESULT Init(uint32_t iMediaSsrc, IDmdRtpPacketSink *pRecoveredSink);
+
+    // whole rtp packets as received;
+    DMD_RESULT OnMediaPacket(const uint8_t *pData, size_t ulSize);
+    DMD_RESULT OnFecPacket(const uint8_t *pData, size_t ulSize);
+
+    void GetStats(DmdFecDecoderStats *pStats) const;
+
+private:
+    typedef struct {
+        bool                    bValid;
+        uint16_t                iSequence;
+        std::vector<uint8_t>    vecData;
+    } DmdFecMediaSlot;
+
+    typedef struct {
+        uint16_t                iBase;
+        uint16_t                iMask;
+        std::vector<uint8_t>    vecData;   // fec header onwards;
+    } DmdFecPending;
+
+    void storeMedia(uint16_t iSequence, const uint8_t *pData, size_t ulSize);
+    bool hasMedia(uint16_t iSequence) const;
+    // true if the run is done with, repaired or complete;
+    bool tryRecover(const DmdFecPending &pending);
+    void recoverPending();
+    void expirePending();
+
+private:
+    uint32_t                       m_iMediaSsrc;
+    IDmdRtpPacketSink             *m_pRecoveredSink;
+    std::vector<DmdFecMediaSlot>   m_vecSlots;
+    std::deque<DmdFecPending>      m_dequePending;
+    bool                           m_bStarted;
+    uint16_t                       m_iHighest;
+    std::vector<uint8_t>           m_vecRecovered;
+    DmdFecDecoderStats             m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDFECDECODER_H
@@ -0,0 +1,227 @@
+/*
+ ============================================================================
+ * Name        : CDmdFecEncoder.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : xor parity packets over rtp packet runs.
+ ============================================================================
+ */
+
+#include "CDmdFecEncoder.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+// fec packet overhead beyond the parity payload;
+#define DMD_FEC_PACKET_OVERHEAD \
+    (DMD_RTP_HEADER_SIZE + DMD_FEC_HEADER_SIZE + DMD_FEC_LEVEL_HEADER_SIZE)
+
+CDmdFecEncoder::CDmdFecEncoder() : m_iSequence(0) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdFecEncoder::~CDmdFecEncoder() {
+}
+
+DMD_RESULT CDmdFecEncoder::Init(const DmdFecEncoderParam &encoderParam) {
+    m_param = encoderParam;
+    if (0 == m_param.iPayloadType) {
+        m_param.iPayloadType = DMD_RTP_FEC_PAYLOAD_TYPE;
+    }
+    SetProtection(m_param.iDeltaPercent, m_param.iKeyPercent);
+    m_iSequence = m_param.iFirstSequence;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_vecArena.reserve(DMD_FEC_MAX_GROUP_SIZE * DMD_RTP_DEFAULT_MTU);
+    DMD_LOG_INFO("CDmdFecEncoder::Init(), ssrc = " << m_param.iSsrc
+            << ", delta = " << m_param.iDeltaPercent << "%, key = "
+            << m_param.iKeyPercent << "%");
+
+    return DMD_S_OK;
+}
+
+void CDmdFecEncoder::SetProtection(unsigned int iDeltaPercent,
+        unsigned int iKeyPercent) {
+    m_param.iDeltaPercent = iDeltaPercent > 100 ? 100 : iDeltaPercent;
+    m_param.iKeyPercent = iKeyPercent > 100 ? 100 : iKeyPercent;
+}
+
+size_t CDmdFecEncoder::buildFec(const DmdRtpPacket *pGroup,
+        unsigned int iGroupSize, uint8_t *pBuffer) {
+    uint8_t *pFecHeader = pBuffer + DMD_RTP_HEADER_SIZE;
+    uint8_t *pLevelHeader = pFecHeader + DMD_FEC_HEADER_SIZE;
+    uint8_t *pParity = pLevelHeader + DMD_FEC_LEVEL_HEADER_SIZE;
+    size_t ulProtection = 0;
+    for (unsigned int i = 0; i < iGroupSize; i++) {
+        if (pGroup[i].ulSize - DMD_RTP_HEADER_SIZE > ulProtection) {
+            ulProtection = pGroup[i].ulSize - DMD_RTP_HEADER_SIZE;
+        }
+    }
+    memset(pFecHeader, 0, DMD_FEC_HEADER_SIZE);
+    memset(pParity, 0, ulProtection);
+
+    uint16_t iLengthRecovery = 0;
+    uint16_t iMask = 0;
+    for (unsigned int i = 0; i < iGroupSize; i++) {
+        const DmdRtpPacket &packet = pGroup[i];
+        // header bytes are gathered, the rest xors in place;
+        uint8_t arrHeader[DMD_RTP_HEADER_SIZE];
+        size_t ulOffset = 0;
+        for (unsigned int j = 0; j < packet.iIovCount; j++) {
+            const uint8_t *pData =
+                static_cast<const uint8_t *>(packet.pIov[j].iov_base);
+            size_t ulLen = packet.pIov[j].iov_len;
+            while (ulLen && ulOffset < DMD_RTP_HEADER_SIZE) {
+                arrHeader[ulOffset++] = *pData++;
+                ulLen--;
+            }
+            DmdFecXor(pParity + ulOffset - DMD_RTP_HEADER_SIZE, pData, ulLen);
+            ulOffset += ulLen;
+        }
+        pFecHeader[0] ^= arrHeader[0] & 0x3f;
+        pFecHeader[1] ^= arrHeader[1];
+        for (int k = 4; k < 8; k++) {
+            pFecHeader[k] ^= arrHeader[k];
+        }
+        iLengthRecovery ^= static_cast<uint16_t>(packet.ulSize
+                - DMD_RTP_HEADER_SIZE);
+        iMask |= static_cast<uint16_t>(0x8000 >> static_cast<uint16_t>(
+                    packet.iSequence - pGroup[0].iSequence));
+    }
+    // sequence number base, then length recovery;
+    pFecHeader[2] = static_cast<uint8_t>(pGroup[0].iSequence >> 8);
+    pFecHeader[3] = static_cast<uint8_t>(pGroup[0].iSequence);
+    pFecHeader[8] = static_cast<uint8_t>(iLengthRecovery >> 8);
+    pFecHeader[9] = static_cast<uint8_t>(iLengthRecovery);
+    pLevelHeader[0] = static_cast<uint8_t>(ulProtection >> 8);
+    pLevelHeader[1] = static_cast<uint8_t>(ulProtection);
+    pLevelHeader[2] = static_cast<uint8_t>(iMask >> 8);
+    pLevelHeader[3] = static_cast<uint8_t>(iMask);
+
+    DmdRtpHeader rtpHeader;
+    rtpHeader.bMarker = false;
+    rtpHeader.iPayloadType = m_param.iPayloadType;
+    rtpHeader.iSequence = m_iSequence++;
+    rtpHeader.iTimestamp = pGroup[0].iTimestamp;
+    rtpHeader.iSsrc = m_param.iSsrc;
+    DmdRtpWriteHeader(rtpHeader, pBuffer);
+
+    return DMD_FEC_PACKET_OVERHEAD + ulProtection;
+}
+
+DMD_RESULT CDmdFecEncoder::ProtectFrame(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, bool bKeyFrame,
+        const DmdRtpPacket **ppFecPackets, unsigned int *piFecCount) {
+    if (NULL == pPackets || NULL == ppFecPackets || NULL == piFecCount) {
+        DMD_LOG_ERROR("CDmdFecEncoder::ProtectFrame(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    *ppFecPackets = NULL;
+    *piFecCount = 0;
+
+    m_stats.ulFrameCount++;
+    m_stats.ulMediaPacketCount += iPacketCount;
+    size_t ulMaxSize = 0;
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        if (pPackets[i].ulSize < DMD_RTP_HEADER_SIZE) {
+            DMD_LOG_ERROR("CDmdFecEncoder::ProtectFrame(), packet " << i
+                    << " without rtp header");
+            return DMD_S_FAIL;
+        }
+        m_stats.ulMediaBytes += pPackets[i].ulSize;
+        if (pPackets[i].ulSize > ulMaxSize) {
+            ulMaxSize = pPackets[i].ulSize;
+        }
+    }
+
+    unsigned int iPercent = bKeyFrame ? m_param.iKeyPercent
+        : m_param.iDeltaPercent;
+    unsigned int iGroupCount = (iPacketCount * iPercent + 50) / 100;
+    if (0 == iGroupCount && bKeyFrame && iPercent && iPacketCount) {
+        iGroupCount = 1;
+    }
+    if (0 == iGroupCount) {
+        return DMD_S_OK;
+    }
+    // the mask covers DMD_FEC_MAX_GROUP_SIZE packets;
+    unsigned int iMinGroups = (iPacketCount + DMD_FEC_MAX_GROUP_SIZE - 1)
+        / DMD_FEC_MAX_GROUP_SIZE;
+    if (iGroupCount < iMinGroups) {
+        iGroupCount = iMinGroups;
+    }
+    if (iGroupCount > iPacketCount) {
+        iGroupCount = iPacketCount;
+    }
+
+    // one slot per fec packet; ulMaxSize bounds the parity of any run;
+    size_t ulSlotSize = DMD_FEC_PACKET_OVERHEAD + ulMaxSize
+        - DMD_RTP_HEADER_SIZE;
+    if (m_vecArena.size() < iGroupCount * ulSlotSize) {
+        m_vecArena.resize(iGroupCount * ulSlotSize);
+    }
+    m_vecIov.resize(iGroupCount);
+    m_vecPackets.resize(iGroupCount);
+    for (unsigned int i = 0; i < iGroupCount; i++) {
+        unsigned int iFirst = i * iPacketCount / iGroupCount;
+        unsigned int iEnd = (i + 1) * iPacketCount / iGroupCount;
+        uint8_t *pBuffer = &m_vecArena[i * ulSlotSize];
+        size_t ulSize = buildFec(pPackets + iFirst, iEnd - iFirst, pBuffer);
+
+        m_vecIov[i].iov_base = pBuffer;
+        m_vecIov[i].iov_len = ulSize;
+        DmdRtpPacket &packet = m_vecPackets[i];
+        memset(&packet, 0, sizeof(packet));
+        packet.pIov = &m_vecIov[i];
+        packet.iIovCount = 1;
+        packet.ulSize = ulSize;
+        packet.iSequence = static_cast<uint16_t>(m_iSequence - 1);
+        packet.iTimestamp = pPackets[iFirst].iTimestamp;
+        m_stats.ulFecBytes += ulSize;
+    }
+    m_stats.ulFecPacketCount += iGroupCount;
+
+    *ppFecPackets = &m_vecPackets[0];
+    *piFecCount = iGroupCount;
+    return DMD_S_OK;
+}
+
+void CDmdFecEncoder::GetStats(DmdFecEncoderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,113 @@
+/*
+ ============================================================================
+ * Name        : CDmdFecEncoder.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdFecEncoder.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDFECENCODER_H
+#define SRC_NETWORK_CDMDFECENCODER_H
+
+#include <sys/uio.h>
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdFec.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// parity packets per 100 media packets of a frame;
+#define DMD_FEC_DEFAULT_DELTA_PERCENT   10
+#define DMD_FEC_DEFAULT_KEY_PERCENT     30
+
+typedef struct {
+    uint32_t        iSsrc;            // of the fec stream;
+    uint8_t         iPayloadType;
+    uint16_t        iFirstSequence;
+    unsigned int    iDeltaPercent;    // 0 leaves delta frames bare;
+    unsigned int    iKeyPercent;
+} DmdFecEncoderParam;
+
+typedef struct {
+    uint64_t        ulFrameCount;
+    uint64_t        ulMediaPacketCount;
+    uint64_t        ulMediaBytes;
+    uint64_t        ulFecPacketCount;
+    uint64_t        ulFecBytes;
+} DmdFecEncoderStats;
+
+/*
+ * ULPFEC style xor parity, rfc 5109 headers with a 16 bit mask, sent as
+ * a separate rtp stream. The packets of a frame are split into runs of
+ * consecutive packets, one parity packet each, so that any one loss in
+ * a run is repaired without a round trip; key frames get more, shorter
+ * runs than delta frames. A frame too small for a whole parity packet at
+ * its rate gets none, except key frames, which always get one.
+ */
+class CDmdFecEncoder {
+public:
+    CDmdFecEncoder();
+    ~CDmdFecEncoder();
+
+    DMD_RESULT Init(const DmdFecEncoderParam &encoderParam);
+    // may change between frames, as loss reports come in;
+    void SetProtection(unsigned int iDeltaPercent, unsigned int iKeyPercent);
+
+    // ppFecPackets are valid until the next call;
+    DMD_RESULT ProtectFrame(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, bool bKeyFrame,
+            const DmdRtpPacket **ppFecPackets, unsigned int *piFecCount);
+
+    void GetStats(DmdFecEncoderStats *pStats) const;
+
+private:
+    size_t buildFec(const DmdRtpPacket *pGroup, unsigned int iGroupSize,
+            uint8_t *pBuffer);
+
+private:
+    DmdFecEncoderParam           m_param;
+    uint16_t                     m_iSequence;
+    std::vector<uint8_t>         m_vecArena;
+    std::vector<struct iovec>    m_vecIov;
+    std::vector<DmdRtpPacket>    m_vecPackets;
+    DmdFecEncoderStats           m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDFECENCODER_H
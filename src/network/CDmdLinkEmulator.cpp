@@ -0,0 +1,193 @@
+/*
+ ============================================================================
+ * Name        : CDmdLinkEmulator.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdLinkEmulator.cpp
+ ============================================================================
+ */
+
+#include "CDmdLinkEmulator.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+CDmdLinkEmulator::CDmdLinkEmulator() : m_pNextSink(NULL), m_iRandom(1),
+        m_ulLinkFreeUs(0) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdLinkEmulator::~CDmdLinkEmulator() {
+}
+
+DMD_RESULT CDmdLinkEmulator::Init(const DmdLinkEmulatorParam &emulatorParam,
+        IDmdRtpPacketSink *pNextSink) {
+    if (NULL == pNextSink || emulatorParam.fLossRate < 0
+            || emulatorParam.fLossRate > 1) {
+        DMD_LOG_ERROR("CDmdLinkEmulator::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = emulatorParam;
+    m_pNextSink = pNextSink;
+    m_iRandom = emulatorParam.iSeed ? emulatorParam.iSeed : 1;
+    m_ulLinkFreeUs = 0;
+    m_quePackets.clear();
+    memset(&m_stats, 0, sizeof(m_stats));
+    return DMD_S_OK;
+}
+
+void CDmdLinkEmulator::SetParam(const DmdLinkEmulatorParam &emulatorParam) {
+    m_param = emulatorParam;
+}
+
+DMD_RESULT CDmdLinkEmulator::SendPackets(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, unsigned int *piSentCount) {
+    DMD_RESULT ret = SendPacketsAt(pPackets, iPacketCount,
+            DmdGetTickCountUs());
+    if (piSentCount) {
+        *piSentCount = DMD_S_OK == ret ? iPacketCount : 0;
+    }
+    return ret;
+}
+
+DMD_RESULT CDmdLinkEmulator::SendPacketsAt(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, uint64_t ulNowUs) {
+    if (NULL == m_pNextSink || (iPacketCount && NULL == pPackets)) {
+        return DMD_S_FAIL;
+    }
+
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        const DmdRtpPacket &packet = pPackets[i];
+        m_stats.ulPacketCount++;
+        if (m_ulLinkFreeUs < ulNowUs) {
+            m_ulLinkFreeUs = ulNowUs;
+        }
+        // what is still queued drains at the link rate;
+        size_t ulQueueBytes = static_cast<size_t>((m_ulLinkFreeUs - ulNowUs)
+                * m_param.ulRateBps / 8000000);
+        if (m_param.ulMaxQueueBytes && m_param.ulRateBps
+                && ulQueueBytes + packet.ulSize > m_param.ulMaxQueueBytes) {
+            m_stats.ulDroppedCount++;
+            continue;
+        }
+        uint64_t ulSendUs = m_param.ulRateBps
+            ? packet.ulSize * 8 * 1000000 / m_param.ulRateBps : 0;
+        m_ulLinkFreeUs += ulSendUs;
+        m_stats.ulQueueBytes = ulQueueBytes + packet.ulSize;
+        if (m_ulLinkFreeUs - ulNowUs > m_stats.ulMaxQueueDelayUs) {
+            m_stats.ulMaxQueueDelayUs = m_ulLinkFreeUs - ulNowUs;
+        }
+
+        // xorshift, repeatable per seed;
+        m_iRandom ^= m_iRandom << 13;
+        m_iRandom ^= m_iRandom >> 17;
+        m_iRandom ^= m_iRandom << 5;
+        if (m_iRandom < m_param.fLossRate * 4294967295.0) {
+            m_stats.ulLostCount++;
+            continue;
+        }
+
+        DmdLinkPacket linkPacket;
+        linkPacket.vecData.resize(packet.ulSize);
+        size_t ulOffset = 0;
+        for (unsigned int j = 0; j < packet.iIovCount; j++) {
+            memcpy(&linkPacket.vecData[ulOffset], packet.pIov[j].iov_base,
+                    packet.pIov[j].iov_len);
+            ulOffset += packet.pIov[j].iov_len;
+        }
+        linkPacket.iSequence = packet.iSequence;
+        linkPacket.iTimestamp = packet.iTimestamp;
+        linkPacket.bMarker = packet.bMarker;
+        linkPacket.ulLeaveUs = m_ulLinkFreeUs;
+        linkPacket.ulArriveUs = m_ulLinkFreeUs + m_param.ulDelayUs;
+        // a delay lowered by SetParam() does not overtake;
+        if (!m_quePackets.empty()
+                && linkPacket.ulArriveUs < m_quePackets.back().ulArriveUs) {
+            linkPacket.ulArriveUs = m_quePackets.back().ulArriveUs;
+        }
+        m_quePackets.push_back(linkPacket);
+    }
+    return DMD_S_OK;
+}
+
+unsigned int CDmdLinkEmulator::Deliver(uint64_t ulNowUs, uint64_t *pNextUs) {
+    size_t ulCount = 0;
+    while (ulCount < m_quePackets.size()
+            && m_quePackets[ulCount].ulArriveUs <= ulNowUs) {
+        ulCount++;
+    }
+    if (ulCount) {
+        m_vecIov.resize(ulCount);
+        m_vecDeliver.resize(ulCount);
+        for (size_t i = 0; i < ulCount; i++) {
+            DmdLinkPacket &linkPacket = m_quePackets[i];
+            m_vecIov[i].iov_base = &linkPacket.vecData[0];
+            m_vecIov[i].iov_len = linkPacket.vecData.size();
+            DmdRtpPacket &packet = m_vecDeliver[i];
+            memset(&packet, 0, sizeof(packet));
+            packet.pIov = &m_vecIov[i];
+            packet.iIovCount = 1;
+            packet.ulSize = linkPacket.vecData.size();
+            packet.iSequence = linkPacket.iSequence;
+            packet.iTimestamp = linkPacket.iTimestamp;
+            packet.bMarker = linkPacket.bMarker;
+        }
+        unsigned int iSentCount = 0;
+        m_pNextSink->SendPackets(&m_vecDeliver[0],
+                static_cast<unsigned int>(ulCount), &iSentCount);
+        m_stats.ulDeliveredCount += ulCount;
+        m_quePackets.erase(m_quePackets.begin(),
+                m_quePackets.begin() + ulCount);
+    }
+
+    m_stats.ulQueueBytes = m_ulLinkFreeUs > ulNowUs
+        ? static_cast<size_t>((m_ulLinkFreeUs - ulNowUs)
+                * m_param.ulRateBps / 8000000) : 0;
+    if (pNextUs) {
+        *pNextUs = m_quePackets.empty() ? 0 : m_quePackets.front().ulArriveUs;
+    }
+    return static_cast<unsigned int>(ulCount);
+}
+
+void CDmdLinkEmulator::GetStats(DmdLinkEmulatorStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,124 @@
+/*
+ ============================================================================
+ * Name        : CDmdLinkEmulator.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdLinkEmulator.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDLINKEMULATOR_H
+#define SRC_NETWORK_CDMDLINKEMULATOR_H
+
+#include <deque>
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+typedef struct {
+    uint64_t        ulRateBps;           // bottleneck, 0 for no limit;
+    uint64_t        ulDelayUs;           // propagation, one way;
+    float           fLossRate;           // random, 0.0 to 1.0;
+    size_t          ulMaxQueueBytes;     // tail drop beyond, 0 for none;
+    uint32_t        iSeed;               // of the loss, for repeatable runs;
+} DmdLinkEmulatorParam;
+
+typedef struct {
+    uint64_t        ulPacketCount;       // taken;
+    uint64_t        ulDeliveredCount;
+    uint64_t        ulLostCount;         // at random;
+    uint64_t        ulDroppedCount;      // queue full;
+    uint64_t        ulMaxQueueDelayUs;
+    size_t          ulQueueBytes;        // at the last call;
+} DmdLinkEmulatorStats;
+
+/*
+ * A packet sink that behaves as a bottleneck link in front of the next
+ * one: packets queue behind each other at ulRateBps, in a buffer as deep
+ * as ulMaxQueueBytes, and are delivered ulDelayUs after they leave it,
+ * some lost at random on the way. Put before a loopback socket, it gives
+ * the congestion control tests the delay, bufferbloat and loss of a real
+ * uplink. Packets are copied on the way in.
+ *
+ * Time is the caller's: SendPacketsAt() and Deliver() take it, so tests
+ * run simulated seconds at once; SendPackets() uses the monotonic clock.
+ * Not thread safe.
+ */
+class CDmdLinkEmulator : public IDmdRtpPacketSink {
+public:
+    CDmdLinkEmulator();
+    ~CDmdLinkEmulator();
+
+    DMD_RESULT Init(const DmdLinkEmulatorParam &emulatorParam,
+            IDmdRtpPacketSink *pNextSink);
+    // changes the link from now on, the queue kept;
+    void SetParam(const DmdLinkEmulatorParam &emulatorParam);
+
+    // IDmdRtpPacketSink interface; lost and dropped packets count as sent;
+    DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount);
+    DMD_RESULT SendPacketsAt(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, uint64_t ulNowUs);
+    // hands what has arrived by ulNowUs to the next sink; pNextUs
+    // receives when the next packet does, 0 if none is on its way;
+    unsigned int Deliver(uint64_t ulNowUs, uint64_t *pNextUs);
+
+    void GetStats(DmdLinkEmulatorStats *pStats) const;
+
+private:
+    typedef struct {
+        std::vector<uint8_t>    vecData;
+        uint16_t                iSequence;
+        uint32_t                iTimestamp;
+        bool                    bMarker;
+        uint64_t                ulLeaveUs;    // out of the queue;
+        uint64_t                ulArriveUs;
+    } DmdLinkPacket;
+
+    DmdLinkEmulatorParam              m_param;
+    IDmdRtpPacketSink                *m_pNextSink;
+    uint32_t                          m_iRandom;
+    uint64_t                          m_ulLinkFreeUs;
+    std::deque<DmdLinkPacket>         m_quePackets;   // by arrival;
+    std::vector<struct iovec>         m_vecIov;
+    std::vector<DmdRtpPacket>         m_vecDeliver;
+    DmdLinkEmulatorStats              m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDLINKEMULATOR_H
@@ -0,0 +1,175 @@
+/*
+ ============================================================================
+ * Name        : CDmdNackGenerator.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : rtp gap tracking and nack scheduling on the receiver.
+ ============================================================================
+ */
+
+#include "CDmdNackGenerator.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+CDmdNackGenerator::CDmdNackGenerator() : m_bStarted(false), m_ulHighest(0),
+        m_bKeyFrameRequest(false) {
+    m_param.ulJitterDelayUs = DMD_NACK_DEFAULT_JITTER_DELAY_US;
+    m_param.ulRttUs = DMD_NACK_DEFAULT_RTT_US;
+    m_param.ulReorderUs = DMD_NACK_DEFAULT_REORDER_US;
+    m_param.iMaxRetries = DMD_NACK_DEFAULT_MAX_RETRIES;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdNackGenerator::~CDmdNackGenerator() {
+}
+
+DMD_RESULT CDmdNackGenerator::Init(
+        const DmdNackGeneratorParam &generatorParam) {
+    if (0 == generatorParam.ulJitterDelayUs || 0 == generatorParam.ulRttUs) {
+        DMD_LOG_ERROR("CDmdNackGenerator::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = generatorParam;
+    Reset();
+    return DMD_S_OK;
+}
+
+void CDmdNackGenerator::Reset() {
+    m_bStarted = false;
+    m_ulHighest = 0;
+    m_mapMissing.clear();
+    m_bKeyFrameRequest = false;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CDmdNackGenerator::SetRtt(uint64_t ulRttUs) {
+    if (ulRttUs) {
+        m_param.ulRttUs = ulRttUs;
+    }
+}
+
+void CDmdNackGenerator::OnPacket(uint16_t iSequence, uint64_t ulNowUs) {
+    m_stats.ulReceivedCount++;
+    if (!m_bStarted) {
+        // far from zero, so that unwrapping never goes negative;
+        m_ulHighest = (1ULL << 32) + iSequence;
+        m_bStarted = true;
+        return;
+    }
+
+    int16_t iDelta = static_cast<int16_t>(iSequence
+            - static_cast<uint16_t>(m_ulHighest));
+    uint64_t ulSequence = m_ulHighest + iDelta;
+    if (iDelta > 0) {
+        uint64_t ulGap = static_cast<uint64_t>(iDelta) - 1;
+        if (ulGap + m_mapMissing.size() > DMD_NACK_MAX_MISSING) {
+            DMD_LOG_WARNING("CDmdNackGenerator::OnPacket(), " << ulGap
+                    << " packets missing, key frame instead of nack");
+            m_stats.ulMissingCount += ulGap;
+            m_stats.ulLostCount += ulGap + m_mapMissing.size();
+            m_mapMissing.clear();
+            m_bKeyFrameRequest = true;
+        } else {
+            DmdNackEntry entry = {ulNowUs, 0, 0};
+            for (uint64_t ulMissing = m_ulHighest + 1; ulMissing < ulSequence;
+                    ulMissing++) {
+                m_mapMissing[ulMissing] = entry;
+            }
+            m_stats.ulMissingCount += ulGap;
+        }
+        m_ulHighest = ulSequence;
+        return;
+    }
+
+    std::map<uint64_t, DmdNackEntry>::iterator it =
+        m_mapMissing.find(ulSequence);
+    if (it == m_mapMissing.end()) {
+        m_stats.ulDuplicateCount++;
+        return;
+    }
+    if (it->second.iRetries) {
+        m_stats.ulRecoveredCount++;
+    }
+    m_mapMissing.erase(it);
+}
+
+void CDmdNackGenerator::GetNackList(uint64_t ulNowUs,
+        std::vector<uint16_t> *pVecSequences) {
+    pVecSequences->clear();
+    std::map<uint64_t, DmdNackEntry>::iterator it = m_mapMissing.begin();
+    while (it != m_mapMissing.end()) {
+        DmdNackEntry &entry = it->second;
+        // an answer arriving after the deadline is no use, stop asking;
+        uint64_t ulDeadlineUs = entry.ulFirstMissUs + m_param.ulJitterDelayUs;
+        if (ulNowUs + m_param.ulRttUs > ulDeadlineUs
+                || entry.iRetries >= m_param.iMaxRetries) {
+            if (0 == entry.iRetries || ulNowUs >= ulDeadlineUs) {
+                m_stats.ulLostCount++;
+                m_bKeyFrameRequest = true;
+                it = m_mapMissing.erase(it);
+            } else {
+                ++it;  // the last request may still be answered;
+            }
+            continue;
+        }
+
+        bool bDue = entry.iRetries
+            ? ulNowUs >= entry.ulLastNackUs + m_param.ulRttUs
+            : ulNowUs >= entry.ulFirstMissUs + m_param.ulReorderUs;
+        if (bDue) {
+            entry.ulLastNackUs = ulNowUs;
+            entry.iRetries++;
+            m_stats.ulNackedCount++;
+            pVecSequences->push_back(static_cast<uint16_t>(it->first));
+        }
+        ++it;
+    }
+}
+
+bool CDmdNackGenerator::TakeKeyFrameRequest() {
+    bool bRequest = m_bKeyFrameRequest;
+    m_bKeyFrameRequest = false;
+    return bRequest;
+}
+
+void CDmdNackGenerator::GetStats(DmdNackGeneratorStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,120 @@
+/*
+ ============================================================================
+ * Name        : CDmdNackGenerator.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdNackGenerator.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDNACKGENERATOR_H
+#define SRC_NETWORK_CDMDNACKGENERATOR_H
+
+#include <map>
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+// how long a packet may be late and still be played;
+#define DMD_NACK_DEFAULT_JITTER_DELAY_US  200000
+#define DMD_NACK_DEFAULT_RTT_US           50000
+// a gap this young may still be reordering, not loss;
+#define DMD_NACK_DEFAULT_REORDER_US       5000
+#define DMD_NACK_DEFAULT_MAX_RETRIES      3
+// beyond this many missing, ask for a key frame instead;
+#define DMD_NACK_MAX_MISSING              1000
+
+typedef struct {
+    uint64_t        ulJitterDelayUs;
+    uint64_t        ulRttUs;
+    uint64_t        ulReorderUs;
+    unsigned int    iMaxRetries;
+} DmdNackGeneratorParam;
+
+typedef struct {
+    uint64_t        ulReceivedCount;
+    uint64_t        ulDuplicateCount;
+    uint64_t        ulMissingCount;      // sequence numbers found missing;
+    uint64_t        ulNackedCount;       // requests, retries included;
+    uint64_t        ulRecoveredCount;    // arrived after a request;
+    uint64_t        ulLostCount;         // given up;
+} DmdNackGeneratorStats;
+
+/*
+ * Receiver side of rtp retransmission. Tracks gaps in the sequence
+ * numbers of one ssrc; GetNackList() asks for a missing packet once it
+ * is past the reorder window, and again every round trip, but only while
+ * the answer can still arrive before the packet's jitter buffer deadline,
+ * one jitter delay after the gap was seen. Packets given up on, and gaps
+ * too large to ask for, raise a key frame request instead.
+ */
+class CDmdNackGenerator {
+public:
+    CDmdNackGenerator();
+    ~CDmdNackGenerator();
+
+    DMD_RESULT Init(const DmdNackGeneratorParam &generatorParam);
+    void Reset();
+    // from rtcp, when a round trip measure comes in;
+    void SetRtt(uint64_t ulRttUs);
+
+    void OnPacket(uint16_t iSequence, uint64_t ulNowUs);
+    // sequence numbers to ask for now, in order; pVecSequences is
+    // cleared first;
+    void GetNackList(uint64_t ulNowUs, std::vector<uint16_t> *pVecSequences);
+    // true once after a loss that retransmission cannot repair;
+    bool TakeKeyFrameRequest();
+
+    size_t GetMissingCount() const {return m_mapMissing.size();}
+    void GetStats(DmdNackGeneratorStats *pStats) const;
+
+private:
+    typedef struct {
+        uint64_t        ulFirstMissUs;
+        uint64_t        ulLastNackUs;
+        unsigned int    iRetries;
+    } DmdNackEntry;
+
+    DmdNackGeneratorParam             m_param;
+    bool                              m_bStarted;
+    uint64_t                          m_ulHighest;   // unwrapped;
+    std::map<uint64_t, DmdNackEntry>  m_mapMissing;  // by unwrapped seq;
+    bool                              m_bKeyFrameRequest;
+    DmdNackGeneratorStats             m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDNACKGENERATOR_H
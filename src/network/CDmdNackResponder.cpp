@@ -0,0 +1,169 @@
+/*
+ ============================================================================
+ * Name        : CDmdNackResponder.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : answers rtcp generic nacks from the rtp history.
+ ============================================================================
+ */
+
+#include "CDmdNackResponder.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+CDmdNackResponder::CDmdNackResponder() : m_pHistory(NULL),
+        m_pPacketSink(NULL), m_pPacer(NULL), m_iSsrc(0),
+        m_ulResendIntervalUs(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdNackResponder::~CDmdNackResponder() {
+}
+
+DMD_RESULT CDmdNackResponder::Init(CDmdRtpHistory *pHistory,
+        IDmdRtpPacketSink *pPacketSink, uint32_t iSsrc,
+        uint64_t ulResendIntervalUs) {
+    if (NULL == pHistory || NULL == pPacketSink) {
+        DMD_LOG_ERROR("CDmdNackResponder::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_pHistory = pHistory;
+    m_pPacketSink = pPacketSink;
+    m_pPacer = NULL;
+    m_iSsrc = iSsrc;
+    m_ulResendIntervalUs = ulResendIntervalUs;
+    memset(&m_stats, 0, sizeof(m_stats));
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdNackResponder::Init(CDmdRtpHistory *pHistory,
+        CDmdPacer *pPacer, uint32_t iSsrc, uint64_t ulResendIntervalUs) {
+    if (NULL == pHistory || NULL == pPacer) {
+        DMD_LOG_ERROR("CDmdNackResponder::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_pHistory = pHistory;
+    m_pPacketSink = NULL;
+    m_pPacer = pPacer;
+    m_iSsrc = iSsrc;
+    m_ulResendIntervalUs = ulResendIntervalUs;
+    memset(&m_stats, 0, sizeof(m_stats));
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdNackResponder::OnRtcp(const uint8_t *pData, size_t ulSize,
+        uint64_t ulNowUs) {
+    if (NULL == m_pHistory) {
+        DMD_LOG_ERROR("CDmdNackResponder::OnRtcp(), not initialized");
+        return DMD_S_FAIL;
+    }
+    m_vecNacks.clear();
+    if (DMD_S_OK != DmdRtcpParseNacks(pData, ulSize, &m_vecNacks)) {
+        DMD_LOG_WARNING("CDmdNackResponder::OnRtcp(), malformed rtcp, "
+                << ulSize << " bytes");
+        return DMD_S_FAIL;
+    }
+
+    // the iovecs must not move once packets point at them;
+    size_t ulRequested = 0;
+    for (size_t i = 0; i < m_vecNacks.size(); i++) {
+        ulRequested += m_vecNacks[i].vecSequences.size();
+    }
+    m_vecIov.resize(ulRequested);
+    m_vecPackets.clear();
+    for (size_t i = 0; i < m_vecNacks.size(); i++) {
+        const DmdRtcpNack &nack = m_vecNacks[i];
+        if (nack.iMediaSsrc != m_iSsrc) {
+            continue;
+        }
+        m_stats.ulNackCount++;
+        for (size_t j = 0; j < nack.vecSequences.size(); j++) {
+            m_stats.ulRequestedCount++;
+            DmdRtpHistoryEntry *pEntry =
+                m_pHistory->Find(nack.vecSequences[j]);
+            if (NULL == pEntry) {
+                m_stats.ulMissingCount++;
+                continue;
+            }
+            if (pEntry->ulResentUs
+                    && ulNowUs - pEntry->ulResentUs < m_ulResendIntervalUs) {
+                m_stats.ulThrottledCount++;
+                continue;
+            }
+            pEntry->ulResentUs = ulNowUs;
+
+            struct iovec &iov = m_vecIov[m_vecPackets.size()];
+            iov.iov_base = pEntry->pData;
+            iov.iov_len = pEntry->ulSize;
+            DmdRtpPacket packet;
+            memset(&packet, 0, sizeof(packet));
+            packet.pIov = &iov;
+            packet.iIovCount = 1;
+            packet.ulSize = pEntry->ulSize;
+            packet.iSequence = pEntry->iSequence;
+            m_vecPackets.push_back(packet);
+        }
+    }
+    if (m_vecPackets.empty()) {
+        return DMD_S_OK;
+    }
+
+    unsigned int iSent = 0;
+    unsigned int iCount = static_cast<unsigned int>(m_vecPackets.size());
+    DMD_RESULT ret = DMD_S_OK;
+    if (m_pPacer) {
+        // copied by the pacer, sent from its thread;
+        ret = m_pPacer->EnqueuePackets(&m_vecPackets[0], iCount,
+                DmdPacerPriorityControl, ulNowUs);
+        iSent = DMD_S_OK == ret ? iCount : 0;
+    } else {
+        ret = m_pPacketSink->SendPackets(&m_vecPackets[0], iCount, &iSent);
+    }
+    for (unsigned int i = 0; i < iSent; i++) {
+        m_stats.ulResentBytes += m_vecPackets[i].ulSize;
+    }
+    m_stats.ulResentCount += iSent;
+    return ret;
+}
+
+void CDmdNackResponder::GetStats(DmdNackResponderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
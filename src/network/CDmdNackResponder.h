@@ -0,0 +1,110 @@
+/*
+ ============================================================================
+ * Name        : CDmdNackResponder.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdNackResponder.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDNACKRESPONDER_H
+#define SRC_NETWORK_CDMDNACKRESPONDER_H
+
+#include <sys/uio.h>
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "CDmdPacer.h"
+#include "CDmdRtpHistory.h"
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// a packet is resent at most once in this interval, however often asked;
+#define DMD_NACK_DEFAULT_RESEND_INTERVAL_US  10000
+
+typedef struct {
+    uint64_t        ulNackCount;         // nacks for our ssrc;
+    uint64_t        ulRequestedCount;    // sequence numbers asked;
+    uint64_t        ulResentCount;
+    uint64_t        ulResentBytes;
+    uint64_t        ulMissingCount;      // evicted from the history;
+    uint64_t        ulThrottledCount;    // resent too recently;
+} DmdNackResponderStats;
+
+/*
+ * Sender side of rtp retransmission: answers the generic nacks of a
+ * receiver from a CDmdRtpHistory, resending each packet as it was sent,
+ * same ssrc and sequence number, instead of an rfc 4588 rtx stream; the
+ * receiver's depacketizer cannot tell a retransmission from a late
+ * packet. Runs on the thread that stores into the history.
+ *
+ * Given a CDmdPacer, retransmissions are queued at control priority,
+ * ahead of video and within its rate; the pacer thread alone then calls
+ * the socket. Given a packet sink, it is called at once, so it must not
+ * be one another thread sends on, the pacer's sink in particular.
+ */
+class CDmdNackResponder {
+public:
+    CDmdNackResponder();
+    ~CDmdNackResponder();
+
+    DMD_RESULT Init(CDmdRtpHistory *pHistory, IDmdRtpPacketSink *pPacketSink,
+            uint32_t iSsrc, uint64_t ulResendIntervalUs);
+    DMD_RESULT Init(CDmdRtpHistory *pHistory, CDmdPacer *pPacer,
+            uint32_t iSsrc, uint64_t ulResendIntervalUs);
+
+    // a compound rtcp packet from the receiver; other packet types and
+    // nacks for other ssrcs are ignored;
+    DMD_RESULT OnRtcp(const uint8_t *pData, size_t ulSize, uint64_t ulNowUs);
+
+    void GetStats(DmdNackResponderStats *pStats) const;
+
+private:
+    CDmdRtpHistory              *m_pHistory;
+    IDmdRtpPacketSink           *m_pPacketSink;
+    CDmdPacer                   *m_pPacer;
+    uint32_t                     m_iSsrc;
+    uint64_t                     m_ulResendIntervalUs;
+    std::vector<DmdRtcpNack>     m_vecNacks;
+    std::vector<struct iovec>    m_vecIov;
+    std::vector<DmdRtpPacket>    m_vecPackets;
+    DmdNackResponderStats        m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDNACKRESPONDER_H
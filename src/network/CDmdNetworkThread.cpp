@@ -0,0 +1,67 @@
+/*
+ ============================================================================
+ * Name        : CDmdNetworkThread.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : network thread routines.
+ ============================================================================
+ */
+
+#include "CDmdNetworkThread.h"
+
+#include <pthread.h>
+#include "thread/DmdThreadUtils.h"
+
+#include "DmdLog.h"
+#include "IDmdDatatype.h"
+#include "CDmdPacer.h"
+
+namespace opendmd {
+
+void *PacerThreadRoutine(void *param) {
+    DMD_LOG_INFO("At the beginning of pacer thread function");
+
+    CDmdPacer *pPacer = reinterpret_cast<CDmdPacer*>(param);
+
+    // set thread name;
+    DmdThreadSetName("pacer");
+
+    pPacer->Run();
+
+    DMD_LOG_INFO("PacerThreadRoutine(), pacer thread is exiting");
+
+    // exit the thread;
+    pthread_exit(NULL);
+}
+
+}  // namespace opendmd
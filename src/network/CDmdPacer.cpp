@@ -0,0 +1,696 @@
+/*
+ ============================================================================
+ * Name        : CDmdPacer.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : token bucket packet pacer.
+ ============================================================================
+ */
+
+#include "CDmdPacer.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+#include "CDmdNetworkThread.h"
+
+namespace opendmd {
+
+CDmdPacer::CDmdPacer() : m_pPacketSink(NULL), m_pFeedbackSink(NULL),
+        m_pBufferPool(new DmdFramePool()), m_ulVideoQueueBytes(0),
+        m_ulRateBps(0), m_fTokens(0.0), m_ulRefillUs(0), m_ulFeedbackUs(0),
+        m_ulFeedbackBytes(0), m_iTimerFd(-1), m_iEventFd(-1),
+        m_bRunning(false), m_bThreadRunning(false) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdPacer::~CDmdPacer() {
+    Uninit();
+}
+
+DMD_RESULT CDmdPacer::Init(const DmdPacerParam &pacerParam,
+        IDmdRtpPacketSink *pPacketSink) {
+    if (NULL == pPacketSink || pacerParam.fFrameRate <= 0.0f) {
+        DMD_LOG_ERROR("CDmdPacer::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    Uninit();
+
+    m_param = pacerParam;
+    if (m_param.fSpreadRatio <= 0.0f || m_param.fSpreadRatio > 1.0f) {
+        m_param.fSpreadRatio = DMD_PACER_DEFAULT_SPREAD_RATIO;
+    }
+    if (0 == m_param.ulMinRateBps) {
+        m_param.ulMinRateBps = DMD_PACER_DEFAULT_MIN_RATE;
+    }
+    if (0 == m_param.ulBurstBytes) {
+        m_param.ulBurstBytes = DMD_PACER_DEFAULT_BURST_BYTES;
+    }
+    m_pPacketSink = pPacketSink;
+    m_ulRateBps = m_param.ulMinRateBps;
+    m_fTokens = static_cast<double>(m_param.ulBurstBytes);
+    m_ulRefillUs = 0;
+    m_ulVideoQueueBytes = 0;
+    m_mapStreams.clear();
+    m_ulFeedbackUs = 0;
+    m_ulFeedbackBytes = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_vecSending.reserve(DMD_PACER_MAX_BATCH);
+    m_vecSendPackets.reserve(DMD_PACER_MAX_BATCH);
+
+    m_iEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    m_iTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (m_iEventFd < 0 || m_iTimerFd < 0) {
+        DMD_LOG_ERROR("CDmdPacer::Init(), eventfd or timerfd failed, "
+                << strerror(errno));
+        Uninit();
+        return DMD_S_FAIL;
+    }
+    m_bRunning = true;
+    DMD_LOG_INFO("CDmdPacer::Init(), spread ratio = " << m_param.fSpreadRatio
+            << ", rate = " << m_param.ulMinRateBps << " to "
+            << m_param.ulMaxRateBps << "bps, burst = "
+            << m_param.ulBurstBytes);
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdPacer::Uninit() {
+    Stop();
+
+    m_mtxPacerMutex.Lock();
+    for (int i = 0; i < DmdPacerPriorityCount; i++) {
+        std::deque<DmdPacedPacket> &queue = m_arrQueues[i];
+        for (size_t j = 0; j < queue.size(); j++) {
+            queue[j].pBuffer->Release();
+        }
+        queue.clear();
+    }
+    m_queVideoFrames.clear();
+    m_ulVideoQueueBytes = 0;
+    m_mapStreams.clear();
+    m_mtxPacerMutex.Unlock();
+
+    if (m_iTimerFd >= 0) {
+        close(m_iTimerFd);
+        m_iTimerFd = -1;
+    }
+    if (m_iEventFd >= 0) {
+        close(m_iEventFd);
+        m_iEventFd = -1;
+    }
+    m_pPacketSink = NULL;
+    return DMD_S_OK;
+}
+
+void CDmdPacer::SetFeedbackSink(IDmdTransportFeedbackSink *pFeedbackSink) {
+    m_mtxPacerMutex.Lock();
+    m_pFeedbackSink = pFeedbackSink;
+    m_mtxPacerMutex.Unlock();
+}
+
+void CDmdPacer::refillLocked(uint64_t ulNowUs) {
+    if (m_ulRefillUs && ulNowUs > m_ulRefillUs) {
+        m_fTokens += static_cast<double>(ulNowUs - m_ulRefillUs)
+            * m_ulRateBps / 8000000.0;
+        if (m_fTokens > m_param.ulBurstBytes) {
+            m_fTokens = static_cast<double>(m_param.ulBurstBytes);
+        }
+    }
+    if (ulNowUs > m_ulRefillUs) {
+        m_ulRefillUs = ulNowUs;
+    }
+}
+
+// drain all video queued within the spread of one frame interval;
+void CDmdPacer::setRateLocked() {
+    double fSpreadUs = m_param.fSpreadRatio * 1000000.0 / m_param.fFrameRate;
+    uint64_t ulRate = static_cast<uint64_t>(m_ulVideoQueueBytes * 8
+            * 1000000.0 / fSpreadUs);
+    if (ulRate < m_param.ulMinRateBps) {
+        ulRate = m_param.ulMinRateBps;
+    }
+    if (m_param.ulMaxRateBps && ulRate > m_param.ulMaxRateBps) {
+        ulRate = m_param.ulMaxRateBps;
+    }
+    m_ulRateBps = ulRate;
+}
+
+// of the nal units the packets carry; one that cannot tell counts as a
+// reference;
+static DmdPacerFrameClass DmdPacerClassifyFrame(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount) {
+    DmdPacerFrameClass eClass = DmdPacerFrameNonReference;
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        DmdRtpNalInfo nalInfo;
+        if (DMD_S_OK != DmdRtpGetNalInfo(pPackets[i], &nalInfo)) {
+            eClass = DmdPacerFrameReference;
+        } else if (DMD_H264_NAL_IDR == nalInfo.iNalType
+                || DMD_H264_NAL_SPS == nalInfo.iNalType) {
+            return DmdPacerFrameKey;
+        } else if (nalInfo.iNri) {
+            eClass = DmdPacerFrameReference;
+        }
+    }
+    return eClass;
+}
+
+// drops the frames marked, their packets with them;
+size_t CDmdPacer::discardFramesLocked(const std::vector<bool> &vecDrop) {
+    std::deque<DmdPacedPacket> &video = m_arrQueues[DmdPacerPriorityVideo];
+    std::deque<DmdPacedPacket> queKeptPackets;
+    std::deque<DmdPacedFrame> queKeptFrames;
+    size_t ulPacket = 0;
+    size_t ulDropped = 0;
+    for (size_t i = 0; i < m_queVideoFrames.size(); i++) {
+        const DmdPacedFrame &frame = m_queVideoFrames[i];
+        for (unsigned int j = 0; j < frame.iPacketCount; j++, ulPacket++) {
+            if (vecDrop[i]) {
+                video[ulPacket].pBuffer->Release();
+            } else {
+                queKeptPackets.push_back(video[ulPacket]);
+            }
+        }
+        if (!vecDrop[i]) {
+            queKeptFrames.push_back(frame);
+            continue;
+        }
+        m_ulVideoQueueBytes -= frame.ulBytes;
+        m_stats.ulDroppedFrameCount++;
+        m_stats.arrDroppedFrames[frame.eClass]++;
+        ulDropped++;
+    }
+    if (ulDropped) {
+        video.swap(queKeptPackets);
+        m_queVideoFrames.swap(queKeptFrames);
+        setRateLocked();
+    }
+    return ulDropped;
+}
+
+// the frame queued if true, else counted as dropped;
+bool CDmdPacer::admitFrameLocked(uint32_t iSsrc, DmdPacerFrameClass eClass,
+        size_t ulBytes) {
+    // nothing of the stream before its next key frame decodes;
+    DmdPacerStream &stream = m_mapStreams[iSsrc];
+    if (stream.bWaitKeyFrame && DmdPacerFrameKey != eClass) {
+        m_stats.ulDroppedFrameCount++;
+        m_stats.arrDroppedFrames[eClass]++;
+        return false;
+    }
+    stream.bWaitKeyFrame = false;
+    if (0 == m_param.ulMaxQueueBytes
+            || m_ulVideoQueueBytes + ulBytes <= m_param.ulMaxQueueBytes) {
+        return true;
+    }
+
+    // room is made from what costs the streams less, non-reference frames
+    // of any first; a key frame does without every frame of its stream
+    // before it;
+    if (DmdPacerFrameNonReference != eClass) {
+        std::vector<bool> vecDrop(m_queVideoFrames.size(), false);
+        uint64_t ulQueueBytes = m_ulVideoQueueBytes;
+        for (size_t i = 0; i < vecDrop.size()
+                && ulQueueBytes + ulBytes > m_param.ulMaxQueueBytes; i++) {
+            const DmdPacedFrame &frame = m_queVideoFrames[i];
+            if (!frame.bStarted && DmdPacerFrameNonReference == frame.eClass) {
+                vecDrop[i] = true;
+                ulQueueBytes -= frame.ulBytes;
+            }
+        }
+        if (DmdPacerFrameKey == eClass
+                && ulQueueBytes + ulBytes > m_param.ulMaxQueueBytes) {
+            for (size_t i = 0; i < vecDrop.size(); i++) {
+                const DmdPacedFrame &frame = m_queVideoFrames[i];
+                if (!frame.bStarted && !vecDrop[i]
+                        && frame.iSsrc == iSsrc) {
+                    vecDrop[i] = true;
+                    ulQueueBytes -= frame.ulBytes;
+                }
+            }
+            m_stats.ulFlushCount++;
+        }
+        discardFramesLocked(vecDrop);
+        if (ulQueueBytes + ulBytes <= m_param.ulMaxQueueBytes) {
+            return true;
+        }
+    }
+
+    m_stats.ulDroppedFrameCount++;
+    m_stats.arrDroppedFrames[eClass]++;
+    if (DmdPacerFrameNonReference != eClass) {
+        stream.bWaitKeyFrame = true;
+        stream.bKeyFrameRequest = true;
+    }
+    DMD_LOG_WARNING("CDmdPacer::admitFrameLocked(), queue full, "
+            << ulBytes << " bytes frame of class " << eClass << ", ssrc "
+            << iSsrc << " dropped");
+    return false;
+}
+
+// once the oldest video waits too long; frames started are left to
+// finish, the receiver would lose what was sent of them;
+void CDmdPacer::dropFramesLocked(uint64_t ulNowUs) {
+    const std::deque<DmdPacedPacket> &video =
+        m_arrQueues[DmdPacerPriorityVideo];
+    if (video.empty()) {
+        return;
+    }
+    uint64_t ulDelayUs = ulNowUs > video.front().ulEnqueueUs
+        ? ulNowUs - video.front().ulEnqueueUs : 0;
+    bool bFlush = m_param.ulFlushDelayUs && ulDelayUs >= m_param.ulFlushDelayUs;
+    if (!bFlush && (0 == m_param.ulDropDelayUs
+                || ulDelayUs < m_param.ulDropDelayUs)) {
+        return;
+    }
+
+    // nothing refers to non-reference frames, the rest decodes without;
+    std::vector<bool> vecDrop(m_queVideoFrames.size(), false);
+    std::map<uint32_t, size_t> mapKeys;  // the newest key frame by ssrc;
+    for (size_t i = 0; i < vecDrop.size(); i++) {
+        const DmdPacedFrame &frame = m_queVideoFrames[i];
+        if (frame.bStarted) {
+            continue;
+        }
+        vecDrop[i] = DmdPacerFrameNonReference == frame.eClass;
+        if (DmdPacerFrameKey == frame.eClass) {
+            mapKeys[frame.iSsrc] = i;
+        }
+    }
+    if (!bFlush) {
+        discardFramesLocked(vecDrop);
+        return;
+    }
+
+    // and beyond that, every frame before the newest key frame of its
+    // stream; a stream without one waits for the next;
+    for (size_t i = 0; i < vecDrop.size(); i++) {
+        const DmdPacedFrame &frame = m_queVideoFrames[i];
+        if (frame.bStarted) {
+            continue;
+        }
+        std::map<uint32_t, size_t>::const_iterator it =
+            mapKeys.find(frame.iSsrc);
+        if (it == mapKeys.end()) {
+            DmdPacerStream &stream = m_mapStreams[frame.iSsrc];
+            stream.bWaitKeyFrame = true;
+            stream.bKeyFrameRequest = true;
+            vecDrop[i] = true;
+        } else if (i < it->second) {
+            vecDrop[i] = true;
+        }
+    }
+    size_t ulDropped = discardFramesLocked(vecDrop);
+    if (0 == ulDropped) {
+        return;  // a started frame, a key frame still going out;
+    }
+    m_stats.ulFlushCount++;
+    DMD_LOG_WARNING("CDmdPacer::dropFramesLocked(), queue " << ulDelayUs
+            << "us, " << ulDropped << " frames flushed, "
+            << m_ulVideoQueueBytes << " bytes left");
+}
+
+DMD_RESULT CDmdPacer::EnqueuePackets(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, DmdPacerPriority ePriority,
+        uint64_t ulNowUs) {
+    if (NULL == pPackets || 0 == iPacketCount
+            || ePriority >= DmdPacerPriorityCount || NULL == m_pPacketSink) {
+        DMD_LOG_ERROR("CDmdPacer::EnqueuePackets(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    // one pooled buffer for the packets of the call, copied flat;
+    size_t ulTotal = 0;
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        ulTotal += pPackets[i].ulSize;
+    }
+    DmdPooledFrame *pBuffer = m_pBufferPool->Acquire(ulTotal);
+    if (NULL == pBuffer) {
+        DMD_LOG_ERROR("CDmdPacer::EnqueuePackets(), out of memory");
+        return DMD_S_FAIL;
+    }
+    DmdPacerFrameClass eClass = DmdPacerFrameKey;
+    DmdRtpHeader rtpHeader;
+    memset(&rtpHeader, 0, sizeof(rtpHeader));
+    bool bRtp = false;
+    if (DmdPacerPriorityVideo == ePriority) {
+        eClass = DmdPacerClassifyFrame(pPackets, iPacketCount);
+        // not rtp, as in tests, is one stream of ssrc 0, sent as it is;
+        bRtp = pPackets[0].iIovCount && DMD_S_OK == DmdRtpParseHeader(
+                static_cast<const uint8_t *>(pPackets[0].pIov[0].iov_base),
+                pPackets[0].pIov[0].iov_len, &rtpHeader, NULL);
+        if (!bRtp) {
+            rtpHeader.iSsrc = 0;
+        }
+    }
+    std::vector<DmdPacedPacket> vecPackets(iPacketCount);
+    uint8_t *pData = pBuffer->GetData();
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        const DmdRtpPacket &packet = pPackets[i];
+        DmdPacedPacket &paced = vecPackets[i];
+        paced.iov.iov_base = pData;
+        paced.iov.iov_len = packet.ulSize;
+        for (unsigned int j = 0; j < packet.iIovCount; j++) {
+            memcpy(pData, packet.pIov[j].iov_base, packet.pIov[j].iov_len);
+            pData += packet.pIov[j].iov_len;
+        }
+        if (i) {
+            pBuffer->AddRef();
+        }
+        paced.pBuffer = pBuffer;
+        paced.ulEnqueueUs = ulNowUs;
+        paced.iSequence = packet.iSequence;
+        paced.iTimestamp = packet.iTimestamp;
+        paced.bMarker = packet.bMarker;
+    }
+
+    m_mtxPacerMutex.Lock();
+    if (DmdPacerPriorityVideo == ePriority
+            && !admitFrameLocked(rtpHeader.iSsrc, eClass, ulTotal)) {
+        m_mtxPacerMutex.Unlock();
+        for (unsigned int i = 0; i < iPacketCount; i++) {
+            pBuffer->Release();
+        }
+        return DMD_S_FAIL;
+    }
+    refillLocked(ulNowUs);
+    std::deque<DmdPacedPacket> &queue = m_arrQueues[ePriority];
+    queue.insert(queue.end(), vecPackets.begin(), vecPackets.end());
+    if (DmdPacerPriorityVideo == ePriority) {
+        DmdPacedFrame frame;
+        frame.iPacketCount = iPacketCount;
+        frame.ulBytes = ulTotal;
+        frame.bStarted = false;
+        frame.eClass = eClass;
+        frame.iSsrc = rtpHeader.iSsrc;
+        frame.bRtp = bRtp;
+        m_queVideoFrames.push_back(frame);
+        m_ulVideoQueueBytes += ulTotal;
+        m_stats.ulFrameCount++;
+        setRateLocked();
+    }
+    m_mtxPacerMutex.Unlock();
+
+    // wake the pacer thread;
+    if (m_iEventFd >= 0) {
+        uint64_t ulValue = 1;
+        if (write(m_iEventFd, &ulValue, sizeof(ulValue)) < 0) {
+            DMD_LOG_WARNING("CDmdPacer::EnqueuePackets(), wake failed, "
+                    << strerror(errno));
+        }
+    }
+
+    return DMD_S_OK;
+}
+
+unsigned int CDmdPacer::PaceOnce(uint64_t ulNowUs, uint64_t *pNextUs) {
+    uint64_t ulNextUs = 0;
+
+    m_mtxPacerMutex.Lock();
+    refillLocked(ulNowUs);
+    m_vecSending.clear();
+    // classes ahead of video bypass the bucket, but use up its tokens;
+    for (int i = 0; i < DmdPacerPriorityVideo; i++) {
+        std::deque<DmdPacedPacket> &queue = m_arrQueues[i];
+        while (!queue.empty() && m_vecSending.size() < DMD_PACER_MAX_BATCH) {
+            m_fTokens -= queue.front().iov.iov_len;
+            m_vecSending.push_back(queue.front());
+            queue.pop_front();
+            m_stats.ulBypassPacketCount++;
+        }
+        if (!queue.empty()) {
+            ulNextUs = ulNowUs;
+        }
+    }
+    dropFramesLocked(ulNowUs);
+    // a packet larger than the bucket goes once the bucket is full;
+    std::deque<DmdPacedPacket> &video = m_arrQueues[DmdPacerPriorityVideo];
+    while (!video.empty() && m_vecSending.size() < DMD_PACER_MAX_BATCH) {
+        DmdPacedPacket &head = video.front();
+        if (m_fTokens < head.iov.iov_len
+                && m_fTokens < m_param.ulBurstBytes) {
+            break;
+        }
+        m_fTokens -= head.iov.iov_len;
+        uint64_t ulDelayUs = ulNowUs > head.ulEnqueueUs
+            ? ulNowUs - head.ulEnqueueUs : 0;
+        m_stats.ulQueueDelaySumUs += ulDelayUs;
+        if (ulDelayUs > m_stats.ulMaxQueueDelayUs) {
+            m_stats.ulMaxQueueDelayUs = ulDelayUs;
+        }
+        m_ulVideoQueueBytes -= head.iov.iov_len;
+        DmdPacedFrame &frame = m_queVideoFrames.front();
+        if (frame.bRtp) {
+            renumberLocked(frame.iSsrc, &head);
+        }
+        frame.bStarted = true;
+        frame.ulBytes -= head.iov.iov_len;
+        if (0 == --frame.iPacketCount) {
+            m_queVideoFrames.pop_front();
+        }
+        m_vecSending.push_back(head);
+        video.pop_front();
+    }
+    if (!video.empty() && 0 == ulNextUs) {
+        double fWanted = static_cast<double>(video.front().iov.iov_len);
+        if (fWanted > m_param.ulBurstBytes) {
+            fWanted = static_cast<double>(m_param.ulBurstBytes);
+        }
+        uint64_t ulWaitUs = static_cast<uint64_t>((fWanted - m_fTokens)
+                * 8000000.0 / m_ulRateBps) + 1;
+        ulNextUs = m_vecSending.size() < DMD_PACER_MAX_BATCH
+            ? ulNowUs + ulWaitUs : ulNowUs;
+    }
+    IDmdTransportFeedbackSink *pFeedbackSink = m_pFeedbackSink;
+    m_mtxPacerMutex.Unlock();
+
+    unsigned int iSent = 0;
+    uint64_t ulBytes = 0;
+    if (!m_vecSending.empty()) {
+        m_vecSendPackets.resize(m_vecSending.size());
+        for (size_t i = 0; i < m_vecSending.size(); i++) {
+            DmdRtpPacket &packet = m_vecSendPackets[i];
+            const DmdPacedPacket &paced = m_vecSending[i];
+            packet.pIov = &paced.iov;
+            packet.iIovCount = 1;
+            packet.ulSize = paced.iov.iov_len;
+            packet.iSequence = paced.iSequence;
+            packet.iTimestamp = paced.iTimestamp;
+            packet.bMarker = paced.bMarker;
+            packet.pFrameBuffer = paced.pBuffer;
+        }
+        m_pPacketSink->SendPackets(&m_vecSendPackets[0],
+                static_cast<unsigned int>(m_vecSendPackets.size()), &iSent);
+        for (unsigned int i = 0; i < iSent; i++) {
+            ulBytes += m_vecSendPackets[i].ulSize;
+        }
+        releaseSending();
+
+        m_mtxPacerMutex.Lock();
+        m_stats.ulSendCallCount++;
+        m_stats.ulPacketCount += iSent;
+        m_stats.ulByteCount += ulBytes;
+        m_mtxPacerMutex.Unlock();
+    }
+
+    m_ulFeedbackBytes += ulBytes;
+    if (pFeedbackSink) {
+        if (0 == m_ulFeedbackUs) {
+            m_ulFeedbackUs = ulNowUs;
+        } else if (ulNowUs - m_ulFeedbackUs >= DMD_PACER_FEEDBACK_INTERVAL_US) {
+            reportFeedback(ulNowUs);
+        }
+    }
+    if (pNextUs) {
+        *pNextUs = ulNextUs;
+    }
+    return iSent;
+}
+
+// the frames dropped leave no gap in the sequence numbers sent;
+void CDmdPacer::renumberLocked(uint32_t iSsrc, DmdPacedPacket *pPacket) {
+    DmdPacerStream &stream = m_mapStreams[iSsrc];
+    if (!stream.bSequenceStarted) {
+        stream.bSequenceStarted = true;
+        stream.iNextSequence = pPacket->iSequence;
+    }
+    pPacket->iSequence = stream.iNextSequence++;
+    uint8_t *pData = static_cast<uint8_t *>(pPacket->iov.iov_base);
+    pData[2] = static_cast<uint8_t>(pPacket->iSequence >> 8);
+    pData[3] = static_cast<uint8_t>(pPacket->iSequence);
+}
+
+void CDmdPacer::releaseSending() {
+    for (size_t i = 0; i < m_vecSending.size(); i++) {
+        m_vecSending[i].pBuffer->Release();
+    }
+    m_vecSending.clear();
+}
+
+void CDmdPacer::reportFeedback(uint64_t ulNowUs) {
+    DmdTransportFeedback transportFeedback;
+    memset(&transportFeedback, 0, sizeof(transportFeedback));
+    transportFeedback.ulTimestampUs = ulNowUs;
+    transportFeedback.ulSendRateBps = m_ulFeedbackBytes * 8 * 1000000
+        / (ulNowUs - m_ulFeedbackUs);
+
+    m_mtxPacerMutex.Lock();
+    const std::deque<DmdPacedPacket> &video =
+        m_arrQueues[DmdPacerPriorityVideo];
+    transportFeedback.ulQueueBytes = m_ulVideoQueueBytes;
+    if (!video.empty() && ulNowUs > video.front().ulEnqueueUs) {
+        transportFeedback.ulQueueDelayUs =
+            ulNowUs - video.front().ulEnqueueUs;
+    }
+    IDmdTransportFeedbackSink *pFeedbackSink = m_pFeedbackSink;
+    m_mtxPacerMutex.Unlock();
+
+    m_ulFeedbackUs = ulNowUs;
+    m_ulFeedbackBytes = 0;
+    if (pFeedbackSink) {
+        pFeedbackSink->OnTransportFeedback(transportFeedback);
+    }
+}
+
+DMD_RESULT CDmdPacer::AddPacerThread(DmdThreadManager *pThreadManager) {
+    return pThreadManager->addThread(DMD_THREAD_NETWORK, PacerThreadRoutine,
+            this);
+}
+
+DMD_RESULT CDmdPacer::Run() {
+    if (m_iTimerFd < 0 || m_iEventFd < 0) {
+        DMD_LOG_ERROR("CDmdPacer::Run(), not initialized");
+        return DMD_S_FAIL;
+    }
+    m_mtxPacerMutex.Lock();
+    m_bThreadRunning = true;
+    m_mtxPacerMutex.Unlock();
+
+    while (m_bRunning) {
+        uint64_t ulNextUs = 0;
+        PaceOnce(DmdGetTickCountUs(), &ulNextUs);
+
+        // DmdGetTickCountUs() is CLOCK_MONOTONIC as well, a zero
+        // it_value disarms the timer;
+        struct itimerspec timerSpec;
+        memset(&timerSpec, 0, sizeof(timerSpec));
+        timerSpec.it_value.tv_sec = ulNextUs / 1000000;
+        timerSpec.it_value.tv_nsec = (ulNextUs % 1000000) * 1000;
+        timerfd_settime(m_iTimerFd, TFD_TIMER_ABSTIME, &timerSpec, NULL);
+
+        struct pollfd arrPoll[2];
+        arrPoll[0].fd = m_iEventFd;
+        arrPoll[0].events = POLLIN;
+        arrPoll[1].fd = m_iTimerFd;
+        arrPoll[1].events = POLLIN;
+        if (poll(arrPoll, 2, DMD_PACER_POLL_MS) > 0) {
+            uint64_t ulValue = 0;
+            if (arrPoll[0].revents & POLLIN) {
+                read(m_iEventFd, &ulValue, sizeof(ulValue));
+            }
+            if (arrPoll[1].revents & POLLIN) {
+                read(m_iTimerFd, &ulValue, sizeof(ulValue));
+            }
+        }
+    }
+
+    m_mtxPacerMutex.Lock();
+    m_bThreadRunning = false;
+    m_condPacerExit.Broadcast();
+    m_mtxPacerMutex.Unlock();
+
+    return DMD_S_OK;
+}
+
+void CDmdPacer::Stop() {
+    m_bRunning = false;
+    if (m_iEventFd >= 0) {
+        uint64_t ulValue = 1;
+        write(m_iEventFd, &ulValue, sizeof(ulValue));
+    }
+
+    // Run() polls every DMD_PACER_POLL_MS, do not wait forever for a
+    // thread that was never spawned;
+    m_mtxPacerMutex.Lock();
+    for (int i = 0; m_bThreadRunning && i < 10; i++) {
+        m_condPacerExit.TimedWait(&m_mtxPacerMutex, DMD_PACER_POLL_MS);
+    }
+    if (m_bThreadRunning) {
+        DMD_LOG_ERROR("CDmdPacer::Stop(), pacer thread still running");
+    }
+    m_mtxPacerMutex.Unlock();
+}
+
+bool CDmdPacer::TakeKeyFrameRequest(uint32_t *piSsrc) {
+    bool bRequest = false;
+    m_mtxPacerMutex.Lock();
+    std::map<uint32_t, DmdPacerStream>::iterator it = m_mapStreams.begin();
+    for (; it != m_mapStreams.end(); ++it) {
+        if (it->second.bKeyFrameRequest) {
+            it->second.bKeyFrameRequest = false;
+            if (piSsrc) {
+                *piSsrc = it->first;
+            }
+            bRequest = true;
+            break;
+        }
+    }
+    m_mtxPacerMutex.Unlock();
+    return bRequest;
+}
+
+void CDmdPacer::GetStats(DmdPacerStats *pStats, uint64_t ulNowUs) {
+    if (NULL == pStats) {
+        return;
+    }
+    m_mtxPacerMutex.Lock();
+    m_stats.ulQueueBytes = m_ulVideoQueueBytes;
+    m_stats.ulQueueDelayUs = 0;
+    const std::deque<DmdPacedPacket> &video =
+        m_arrQueues[DmdPacerPriorityVideo];
+    if (!video.empty() && ulNowUs > video.front().ulEnqueueUs) {
+        m_stats.ulQueueDelayUs = ulNowUs - video.front().ulEnqueueUs;
+    }
+    m_stats.ulRateBps = m_ulRateBps;
+    *pStats = m_stats;
+    m_mtxPacerMutex.Unlock();
+}
+
+}  // namespace opendmd
@@ -0,0 +1,252 @@
+/*
+ ============================================================================
+ * Name        : CDmdPacer.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdPacer.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDPACER_H
+#define SRC_NETWORK_CDMDPACER_H
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+#include "DmdFramePool.h"
+#include "thread/DmdThreadCondition.h"
+#include "thread/DmdThreadManager.h"
+#include "thread/DmdThreadMutex.h"
+
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// a frame's packets leave within this part of the frame interval;
+#define DMD_PACER_DEFAULT_SPREAD_RATIO   0.5f
+// bucket depth, what may leave back to back in one wakeup;
+#define DMD_PACER_DEFAULT_BURST_BYTES    (4 * DMD_RTP_DEFAULT_MTU)
+#define DMD_PACER_DEFAULT_MIN_RATE       (1024 * 1024)
+// packets per call to the packet sink;
+#define DMD_PACER_MAX_BATCH              64
+#define DMD_PACER_FEEDBACK_INTERVAL_US   100000
+// how often Run() checks for Stop() without a wakeup;
+#define DMD_PACER_POLL_MS                100
+
+// classes above DmdPacerPriorityVideo are never held by the bucket;
+typedef enum {
+    DmdPacerPriorityControl = 0,    // rtcp, retransmissions;
+    DmdPacerPriorityAudio,
+    DmdPacerPriorityEvent,          // motion events;
+    DmdPacerPriorityVideo,
+    DmdPacerPriorityCount,
+} DmdPacerPriority;
+
+// video frames by what dropping one costs the stream, from its nal units;
+typedef enum {
+    DmdPacerFrameKey = 0,           // idr, the stream resumes from it;
+    DmdPacerFrameReference,         // later frames refer to it;
+    DmdPacerFrameNonReference,      // nothing does, nri 0;
+    DmdPacerFrameClassCount,
+} DmdPacerFrameClass;
+
+typedef struct {
+    float           fFrameRate;
+    float           fSpreadRatio;     // 0 for the default;
+    uint64_t        ulMinRateBps;     // pacing rate floor, 0 for default;
+    uint64_t        ulMaxRateBps;     // link rate, 0 for no limit;
+    size_t          ulBurstBytes;     // 0 for the default;
+    size_t          ulMaxQueueBytes;  // video frames beyond are dropped,
+                                      // 0 for no limit;
+    uint64_t        ulDropDelayUs;    // non-reference frames dropped once
+                                      // the oldest waits this, 0 never;
+    uint64_t        ulFlushDelayUs;   // every frame up to the newest key
+                                      // frame, 0 never;
+} DmdPacerParam;
+
+typedef struct {
+    uint64_t        ulFrameCount;         // video frames queued;
+    uint64_t        ulDroppedFrameCount;  // all classes;
+    // by DmdPacerFrameClass;
+    uint64_t        arrDroppedFrames[DmdPacerFrameClassCount];
+    uint64_t        ulFlushCount;         // drops up to a key frame;
+    uint64_t        ulPacketCount;        // sent, all classes;
+    uint64_t        ulByteCount;
+    uint64_t        ulBypassPacketCount;  // sent ahead of the bucket;
+    uint64_t        ulSendCallCount;
+    // video packets, from enqueue to send;
+    uint64_t        ulQueueDelaySumUs;
+    uint64_t        ulMaxQueueDelayUs;
+    // at the time of the call;
+    uint64_t        ulQueueBytes;
+    uint64_t        ulQueueDelayUs;       // age of the oldest video packet;
+    uint64_t        ulRateBps;            // current pacing rate;
+} DmdPacerStats;
+
+// a copy of a packet, waiting in its class queue;
+typedef struct {
+    struct iovec    iov;
+    DmdPooledFrame *pBuffer;     // holds one reference per packet;
+    uint64_t        ulEnqueueUs;
+    uint16_t        iSequence;
+    uint32_t        iTimestamp;
+    bool            bMarker;
+} DmdPacedPacket;
+
+/*
+ * Sits between the packetizer and the socket so that key frames, 10 to
+ * 30 times the size of a P frame, do not leave at line rate and overflow
+ * switch and wifi buffers. Each video frame sets the token bucket rate to
+ * drain the video queue within fSpreadRatio of a frame interval, between
+ * ulMinRateBps and ulMaxRateBps; control, audio and events go out on the
+ * next wakeup, ahead of the bucket, whose tokens they still consume.
+ *
+ * Video frames are dropped whole and never once started, cheapest class
+ * first, so that what is sent still decodes. Non-reference frames go
+ * when the oldest video waits ulDropDelayUs, or to make room for a
+ * reference frame within ulMaxQueueBytes; beyond ulFlushDelayUs, every
+ * frame before the newest key frame of its stream. A stream without one
+ * queued, or whose reference frame finds no room, resumes at its next key
+ * frame, which TakeKeyFrameRequest() asks for; cameras sharing the pacer
+ * are told apart by ssrc, and one waiting holds back none of the others.
+ * So that a receiver does not take drops for loss and ask for them, rtp
+ * video is renumbered as it leaves, each ssrc from the first sequence
+ * number it sent; the history, and all else by sequence number, is to
+ * store what the packet sink is given, and retransmissions, of any
+ * priority but video, go as they are.
+ * The h264 engine gives every other P frame nri 0 with
+ * bNonReferenceFrames, except in the long term reference profile;
+ * otherwise all P frames are reference frames.
+ *
+ * Packets are copied on enqueue, as the packetizer reuses its headers on
+ * the next frame. PaceOnce() sends what is due and is the whole of the
+ * pacing logic; Run() calls it from a DMD_THREAD_NETWORK thread, asleep
+ * on a timerfd until the next packet is due or an eventfd on enqueue.
+ */
+class CDmdPacer {
+public:
+    CDmdPacer();
+    ~CDmdPacer();
+
+    DMD_RESULT Init(const DmdPacerParam &pacerParam,
+            IDmdRtpPacketSink *pPacketSink);
+    DMD_RESULT Uninit();
+    void SetFeedbackSink(IDmdTransportFeedbackSink *pFeedbackSink);
+
+    // any thread; the packets of a video call are one frame;
+    DMD_RESULT EnqueuePackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, DmdPacerPriority ePriority,
+            uint64_t ulNowUs);
+    // pacer thread; sends what is due at ulNowUs, pNextUs receives when
+    // the next packet is, 0 when the queues are empty;
+    unsigned int PaceOnce(uint64_t ulNowUs, uint64_t *pNextUs);
+
+    // add a DMD_THREAD_NETWORK thread, spawned by the thread manager;
+    DMD_RESULT AddPacerThread(DmdThreadManager *pThreadManager);
+    DMD_RESULT Run();
+    // wait for Run() to return;
+    void Stop();
+
+    // true once per request, piSsrc receives the stream that needs a key
+    // frame;
+    bool TakeKeyFrameRequest(uint32_t *piSsrc = NULL);
+    void GetStats(DmdPacerStats *pStats, uint64_t ulNowUs);
+
+private:
+    // a video frame, its packets consecutive in the video queue;
+    typedef struct {
+        unsigned int        iPacketCount;    // still queued;
+        uint64_t            ulBytes;
+        bool                bStarted;        // some of it sent;
+        DmdPacerFrameClass  eClass;
+        uint32_t            iSsrc;
+        bool                bRtp;            // renumbered as it leaves;
+    } DmdPacedFrame;
+
+    // video state of one ssrc;
+    typedef struct {
+        bool                bWaitKeyFrame;   // frames dropped until one;
+        bool                bKeyFrameRequest;
+        bool                bSequenceStarted;
+        uint16_t            iNextSequence;   // of the next packet sent;
+    } DmdPacerStream;
+
+    void refillLocked(uint64_t ulNowUs);
+    void dropFramesLocked(uint64_t ulNowUs);
+    size_t discardFramesLocked(const std::vector<bool> &vecDrop);
+    bool admitFrameLocked(uint32_t iSsrc, DmdPacerFrameClass eClass,
+            size_t ulBytes);
+    void setRateLocked();
+    void renumberLocked(uint32_t iSsrc, DmdPacedPacket *pPacket);
+    void releaseSending();
+    void reportFeedback(uint64_t ulNowUs);
+
+private:
+    DmdPacerParam                    m_param;
+    IDmdRtpPacketSink               *m_pPacketSink;
+    IDmdTransportFeedbackSink       *m_pFeedbackSink;
+    std::shared_ptr<DmdFramePool>    m_pBufferPool;
+
+    DmdThreadMutex                   m_mtxPacerMutex;
+    DmdThreadCondition               m_condPacerExit;
+    std::deque<DmdPacedPacket>       m_arrQueues[DmdPacerPriorityCount];
+    std::deque<DmdPacedFrame>        m_queVideoFrames;
+    uint64_t                         m_ulVideoQueueBytes;
+    std::map<uint32_t, DmdPacerStream>  m_mapStreams;    // by ssrc;
+    uint64_t                         m_ulRateBps;
+    double                           m_fTokens;           // in bytes;
+    uint64_t                         m_ulRefillUs;
+    DmdPacerStats                    m_stats;
+
+    // pacer thread only;
+    std::vector<DmdPacedPacket>      m_vecSending;
+    std::vector<DmdRtpPacket>        m_vecSendPackets;
+    uint64_t                         m_ulFeedbackUs;
+    uint64_t                         m_ulFeedbackBytes;
+
+    int                              m_iTimerFd;
+    int                              m_iEventFd;
+    std::atomic<bool>                m_bRunning;
+    bool                             m_bThreadRunning;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDPACER_H
@@ -0,0 +1,220 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtcpReceiver.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdRtcpReceiver.cpp
+ ============================================================================
+ */
+
+#include "CDmdRtcpReceiver.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+CDmdRtcpReceiver::CDmdRtcpReceiver() {
+    memset(&m_param, 0, sizeof(m_param));
+    Reset();
+}
+
+CDmdRtcpReceiver::~CDmdRtcpReceiver() {
+}
+
+DMD_RESULT CDmdRtcpReceiver::Init(const DmdRtcpReceiverParam &receiverParam) {
+    if (0 == receiverParam.iClockRate
+            || receiverParam.fBandwidthFraction <= 0.0f) {
+        DMD_LOG_ERROR("CDmdRtcpReceiver::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = receiverParam;
+    Reset();
+    return DMD_S_OK;
+}
+
+void CDmdRtcpReceiver::Reset() {
+    m_bStarted = false;
+    m_ulBaseSeq = 0;
+    m_ulHighestSeq = 0;
+    m_ulExpectedPrior = 0;
+    m_ulReceivedPrior = 0;
+    m_iLastTransit = 0;
+    m_iJitterQ4 = 0;
+    m_bHasSenderReport = false;
+    memset(&m_senderInfo, 0, sizeof(m_senderInfo));
+    m_ulSenderReportUs = 0;
+    m_ulNextReportUs = 0;
+    m_ulLastReportUs = 0;
+    m_ulLastReportBytes = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CDmdRtcpReceiver::OnPacket(uint16_t iSequence, uint32_t iTimestamp,
+        size_t ulSize, uint64_t ulArrivalUs) {
+    m_stats.ulReceivedCount++;
+    m_stats.ulReceivedBytes += ulSize;
+    // relative transit time, in media clock units, wraps as rtp does;
+    uint32_t iTransit = DmdRtpTimestamp(ulArrivalUs, m_param.iClockRate)
+        - iTimestamp;
+    if (!m_bStarted) {
+        m_ulBaseSeq = iSequence;
+        m_ulHighestSeq = iSequence;
+        m_iLastTransit = iTransit;
+        m_ulLastReportUs = ulArrivalUs;
+        m_bStarted = true;
+        return;
+    }
+
+    int16_t iDelta = static_cast<int16_t>(iSequence
+            - static_cast<uint16_t>(m_ulHighestSeq));
+    if (iDelta > 0) {
+        m_ulHighestSeq += iDelta;
+    }
+
+    int32_t iDiff = static_cast<int32_t>(iTransit - m_iLastTransit);
+    uint32_t iDistance = iDiff < 0 ? -iDiff : iDiff;
+    m_iLastTransit = iTransit;
+    m_iJitterQ4 += iDistance - ((m_iJitterQ4 + 8) >> 4);
+}
+
+DMD_RESULT CDmdRtcpReceiver::OnRtcp(const uint8_t *pData, size_t ulSize,
+        uint64_t ulNowUs) {
+    m_vecReports.clear();
+    if (DMD_S_OK != DmdRtcpParseReports(pData, ulSize, &m_vecReports)) {
+        DMD_LOG_WARNING("CDmdRtcpReceiver::OnRtcp(), malformed rtcp, "
+                << ulSize << " bytes");
+        return DMD_S_FAIL;
+    }
+
+    for (size_t i = 0; i < m_vecReports.size(); i++) {
+        const DmdRtcpReport &report = m_vecReports[i];
+        if (DMD_RTCP_PT_SR != report.iPacketType
+                || report.iSsrc != m_param.iMediaSsrc) {
+            continue;
+        }
+        m_senderInfo = report.senderInfo;
+        m_ulSenderReportUs = ulNowUs;
+        m_bHasSenderReport = true;
+        m_stats.ulSenderReportCount++;
+    }
+    return DMD_S_OK;
+}
+
+void CDmdRtcpReceiver::fillBlock(uint64_t ulNowUs,
+        DmdRtcpReportBlock *pBlock) {
+    memset(pBlock, 0, sizeof(*pBlock));
+    pBlock->iSsrc = m_param.iMediaSsrc;
+    if (m_bStarted) {
+        uint64_t ulExpected = m_ulHighestSeq - m_ulBaseSeq + 1;
+        m_stats.lLostCount = static_cast<int64_t>(ulExpected)
+            - static_cast<int64_t>(m_stats.ulReceivedCount);
+
+        // appendix a.3, loss over the interval since the last report;
+        int64_t lExpectedInterval = ulExpected - m_ulExpectedPrior;
+        int64_t lReceivedInterval = m_stats.ulReceivedCount
+            - m_ulReceivedPrior;
+        int64_t lLostInterval = lExpectedInterval - lReceivedInterval;
+        m_ulExpectedPrior = ulExpected;
+        m_ulReceivedPrior = m_stats.ulReceivedCount;
+        if (lExpectedInterval > 0 && lLostInterval > 0) {
+            pBlock->iFractionLost = static_cast<uint8_t>(
+                    (lLostInterval << 8) / lExpectedInterval);
+        }
+        pBlock->iCumulativeLost = static_cast<int32_t>(m_stats.lLostCount);
+        pBlock->iExtHighestSeq = static_cast<uint32_t>(m_ulHighestSeq);
+        pBlock->iJitter = m_iJitterQ4 >> 4;
+    }
+    m_stats.fLossRate = pBlock->iFractionLost / 256.0f;
+    m_stats.ulJitterUs = static_cast<uint64_t>(pBlock->iJitter) * 1000000
+        / m_param.iClockRate;
+
+    if (m_bHasSenderReport) {
+        pBlock->iLastSr = DmdNtpCompact(m_senderInfo.ulNtpTime);
+        pBlock->iDelaySinceLastSr =
+            DmdNtpCompactFromUs(ulNowUs - m_ulSenderReportUs);
+    }
+}
+
+DMD_RESULT CDmdRtcpReceiver::BuildReport(uint64_t ulNowUs, uint8_t *pBuffer,
+        size_t ulCapacity, size_t *pSize) {
+    if (0 == m_param.iClockRate) {
+        DMD_LOG_ERROR("CDmdRtcpReceiver::BuildReport(), not initialized");
+        return DMD_S_FAIL;
+    }
+
+    DmdRtcpReportBlock reportBlock;
+    fillBlock(ulNowUs, &reportBlock);
+    if (DMD_S_OK != DmdRtcpWriteReport(m_param.iSsrc, NULL, &reportBlock, 1,
+                pBuffer, ulCapacity, pSize)) {
+        DMD_LOG_ERROR("CDmdRtcpReceiver::BuildReport(), buffer too small, "
+                << ulCapacity << " bytes");
+        return DMD_S_FAIL;
+    }
+    m_stats.ulReportCount++;
+
+    // the report interval follows the media rate, as rfc 3550 sizes it;
+    if (ulNowUs > m_ulLastReportUs) {
+        m_stats.ulReceiveRateBps = (m_stats.ulReceivedBytes
+                - m_ulLastReportBytes) * 8 * 1000000
+            / (ulNowUs - m_ulLastReportUs);
+    }
+    m_ulLastReportUs = ulNowUs;
+    m_ulLastReportBytes = m_stats.ulReceivedBytes;
+    m_ulNextReportUs = ulNowUs + DmdRtcpReportIntervalUs(
+            *pSize + DMD_RTCP_WIRE_OVERHEAD, m_stats.ulReceiveRateBps,
+            m_param.fBandwidthFraction, m_param.ulMinIntervalUs);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdRtcpReceiver::GetCaptureTimeUs(uint32_t iTimestamp,
+        uint64_t *pWallClockUs) const {
+    if (!m_bHasSenderReport || NULL == pWallClockUs) {
+        return DMD_S_FAIL;
+    }
+    int64_t lDelta = static_cast<int32_t>(iTimestamp
+            - m_senderInfo.iRtpTimestamp);
+    *pWallClockUs = DmdNtpToUs(m_senderInfo.ulNtpTime)
+        + lDelta * 1000000 / static_cast<int64_t>(m_param.iClockRate);
+    return DMD_S_OK;
+}
+
+void CDmdRtcpReceiver::GetStats(DmdRtcpReceiverStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
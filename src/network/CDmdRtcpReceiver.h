@@ -0,0 +1,129 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtcpReceiver.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdRtcpReceiver.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDRTCPRECEIVER_H
+#define SRC_NETWORK_CDMDRTCPRECEIVER_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdRtcp.h"
+
+namespace opendmd {
+
+typedef struct {
+    uint32_t        iSsrc;               // ours, the reporter;
+    uint32_t        iMediaSsrc;          // the source received;
+    uint32_t        iClockRate;
+    float           fBandwidthFraction;
+    uint64_t        ulMinIntervalUs;
+} DmdRtcpReceiverParam;
+
+typedef struct {
+    uint64_t        ulReceivedCount;
+    uint64_t        ulReceivedBytes;
+    int64_t         lLostCount;          // negative with duplicates;
+    float           fLossRate;           // of the last report;
+    uint64_t        ulJitterUs;
+    uint64_t        ulReceiveRateBps;    // between the last two reports;
+    uint64_t        ulSenderReportCount;
+    uint64_t        ulReportCount;       // receiver reports built;
+} DmdRtcpReceiverStats;
+
+/*
+ * Receiver side of rfc 3550 reports for one media ssrc: counts what
+ * arrives, keeps the interarrival jitter of appendix A.8 and the loss of
+ * appendix A.3, and builds the receiver reports the sender times its
+ * round trip and loss rate with. The last sender report maps the rtp
+ * timestamps of the stream to the capture wall clock of the sender, for
+ * end to end latency. Runs on the receiving thread, no locking.
+ */
+class CDmdRtcpReceiver {
+public:
+    CDmdRtcpReceiver();
+    ~CDmdRtcpReceiver();
+
+    DMD_RESULT Init(const DmdRtcpReceiverParam &receiverParam);
+    void Reset();
+
+    void OnPacket(uint16_t iSequence, uint32_t iTimestamp, size_t ulSize,
+            uint64_t ulArrivalUs);
+    // a compound rtcp packet from the sender; reports of other ssrcs and
+    // other packet types are ignored;
+    DMD_RESULT OnRtcp(const uint8_t *pData, size_t ulSize, uint64_t ulNowUs);
+
+    bool IsReportDue(uint64_t ulNowUs) const {
+        return ulNowUs >= m_ulNextReportUs;
+    }
+    // a receiver report with one block for the media ssrc, and schedules
+    // the next one;
+    DMD_RESULT BuildReport(uint64_t ulNowUs, uint8_t *pBuffer,
+            size_t ulCapacity, size_t *pSize);
+
+    // sender wall clock when iTimestamp was captured, from the last sender
+    // report; fails before the first one;
+    DMD_RESULT GetCaptureTimeUs(uint32_t iTimestamp,
+            uint64_t *pWallClockUs) const;
+    void GetStats(DmdRtcpReceiverStats *pStats) const;
+
+private:
+    void fillBlock(uint64_t ulNowUs, DmdRtcpReportBlock *pBlock);
+
+    DmdRtcpReceiverParam              m_param;
+    bool                              m_bStarted;
+    uint64_t                          m_ulBaseSeq;       // extended;
+    uint64_t                          m_ulHighestSeq;    // extended;
+    uint64_t                          m_ulExpectedPrior;
+    uint64_t                          m_ulReceivedPrior;
+    uint32_t                          m_iLastTransit;
+    uint32_t                          m_iJitterQ4;       // jitter * 16;
+    bool                              m_bHasSenderReport;
+    DmdRtcpSenderInfo                 m_senderInfo;
+    uint64_t                          m_ulSenderReportUs;  // arrival;
+    uint64_t                          m_ulNextReportUs;
+    uint64_t                          m_ulLastReportUs;
+    uint64_t                          m_ulLastReportBytes;
+    std::vector<DmdRtcpReport>        m_vecReports;
+    DmdRtcpReceiverStats              m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDRTCPRECEIVER_H
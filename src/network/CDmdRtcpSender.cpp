@@ -0,0 +1,194 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtcpSender.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdRtcpSender.cpp
+ ============================================================================
+ */
+
+#include "CDmdRtcpSender.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+CDmdRtcpSender::CDmdRtcpSender() : m_pFeedbackSink(NULL),
+        m_lWallClockOffsetUs(0), m_ulNextReportUs(0), m_ulLastReportUs(0),
+        m_ulLastReportBytes(0), m_ulSentBytes(0) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdRtcpSender::~CDmdRtcpSender() {
+}
+
+DMD_RESULT CDmdRtcpSender::Init(const DmdRtcpSenderParam &senderParam) {
+    if (0 == senderParam.iClockRate
+            || senderParam.fBandwidthFraction <= 0.0f) {
+        DMD_LOG_ERROR("CDmdRtcpSender::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = senderParam;
+    m_lWallClockOffsetUs = static_cast<int64_t>(DmdGetWallClockUs())
+        - static_cast<int64_t>(DmdGetTickCountUs());
+    m_ulNextReportUs = 0;
+    m_ulLastReportUs = 0;
+    m_ulLastReportBytes = 0;
+    m_ulSentBytes = 0;
+    memset(&m_stats, 0, sizeof(m_stats));
+    return DMD_S_OK;
+}
+
+void CDmdRtcpSender::SetFeedbackSink(
+        IDmdTransportFeedbackSink *pFeedbackSink) {
+    m_pFeedbackSink = pFeedbackSink;
+}
+
+void CDmdRtcpSender::OnPacketsSent(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount) {
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        m_stats.ulPacketCount++;
+        m_stats.ulOctetCount += pPackets[i].ulSize - DMD_RTP_HEADER_SIZE;
+        m_ulSentBytes += pPackets[i].ulSize;
+    }
+}
+
+uint64_t CDmdRtcpSender::GetNtpTime(uint64_t ulNowUs) const {
+    return DmdNtpFromUs(static_cast<uint64_t>(
+                static_cast<int64_t>(ulNowUs) + m_lWallClockOffsetUs));
+}
+
+DMD_RESULT CDmdRtcpSender::BuildReport(uint64_t ulNowUs, uint8_t *pBuffer,
+        size_t ulCapacity, size_t *pSize) {
+    if (0 == m_param.iClockRate) {
+        DMD_LOG_ERROR("CDmdRtcpSender::BuildReport(), not initialized");
+        return DMD_S_FAIL;
+    }
+
+    // the same mapping the packetizer applies to capture timestamps;
+    DmdRtcpSenderInfo senderInfo;
+    senderInfo.ulNtpTime = GetNtpTime(ulNowUs);
+    senderInfo.iRtpTimestamp = DmdRtpTimestamp(ulNowUs, m_param.iClockRate)
+        + m_param.iTimestampOffset;
+    senderInfo.iPacketCount = static_cast<uint32_t>(m_stats.ulPacketCount);
+    senderInfo.iOctetCount = static_cast<uint32_t>(m_stats.ulOctetCount);
+    if (DMD_S_OK != DmdRtcpWriteReport(m_param.iSsrc, &senderInfo, NULL, 0,
+                pBuffer, ulCapacity, pSize)) {
+        DMD_LOG_ERROR("CDmdRtcpSender::BuildReport(), buffer too small, "
+                << ulCapacity << " bytes");
+        return DMD_S_FAIL;
+    }
+    m_stats.ulReportCount++;
+
+    // the report interval follows the media rate, as rfc 3550 sizes it;
+    if (m_ulLastReportUs && ulNowUs > m_ulLastReportUs) {
+        m_stats.ulSendRateBps = (m_ulSentBytes - m_ulLastReportBytes)
+            * 8 * 1000000 / (ulNowUs - m_ulLastReportUs);
+    }
+    m_ulLastReportUs = ulNowUs;
+    m_ulLastReportBytes = m_ulSentBytes;
+    m_ulNextReportUs = ulNowUs + DmdRtcpReportIntervalUs(
+            *pSize + DMD_RTCP_WIRE_OVERHEAD, m_stats.ulSendRateBps,
+            m_param.fBandwidthFraction, m_param.ulMinIntervalUs);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdRtcpSender::OnRtcp(const uint8_t *pData, size_t ulSize,
+        uint64_t ulNowUs) {
+    m_vecReports.clear();
+    if (DMD_S_OK != DmdRtcpParseReports(pData, ulSize, &m_vecReports)) {
+        DMD_LOG_WARNING("CDmdRtcpSender::OnRtcp(), malformed rtcp, "
+                << ulSize << " bytes");
+        return DMD_S_FAIL;
+    }
+
+    for (size_t i = 0; i < m_vecReports.size(); i++) {
+        const std::vector<DmdRtcpReportBlock> &vecBlocks =
+            m_vecReports[i].vecBlocks;
+        for (size_t j = 0; j < vecBlocks.size(); j++) {
+            if (vecBlocks[j].iSsrc == m_param.iSsrc) {
+                onReportBlock(vecBlocks[j], ulNowUs);
+            }
+        }
+    }
+    return DMD_S_OK;
+}
+
+void CDmdRtcpSender::onReportBlock(const DmdRtcpReportBlock &reportBlock,
+        uint64_t ulNowUs) {
+    m_stats.ulReceiverReportCount++;
+    m_stats.fLossRate = reportBlock.iFractionLost / 256.0f;
+    m_stats.iCumulativeLost = reportBlock.iCumulativeLost;
+    m_stats.ulJitterUs = static_cast<uint64_t>(reportBlock.iJitter)
+        * 1000000 / m_param.iClockRate;
+
+    // no sender report reached the receiver yet, no round trip;
+    if (reportBlock.iLastSr) {
+        uint32_t iNow = DmdNtpCompact(GetNtpTime(ulNowUs));
+        uint32_t iRtt = iNow - reportBlock.iLastSr
+            - reportBlock.iDelaySinceLastSr;
+        // negative from rounding on a short path, or from a bogus report;
+        if (iRtt < 0x80000000U) {
+            m_stats.ulRttUs = DmdNtpCompactToUs(iRtt);
+        }
+    }
+
+    DMD_LOG_INFO("CDmdRtcpSender::onReportBlock(), ssrc:" << m_param.iSsrc
+            << ", rtt:" << m_stats.ulRttUs << "us"
+            << ", loss:" << m_stats.fLossRate
+            << ", cumulative lost:" << m_stats.iCumulativeLost
+            << ", jitter:" << m_stats.ulJitterUs << "us");
+
+    if (m_pFeedbackSink) {
+        DmdTransportFeedback transportFeedback;
+        memset(&transportFeedback, 0, sizeof(transportFeedback));
+        transportFeedback.ulTimestampUs = ulNowUs;
+        transportFeedback.fLossRate = m_stats.fLossRate;
+        transportFeedback.ulSendRateBps = m_stats.ulSendRateBps;
+        transportFeedback.ulRttUs = m_stats.ulRttUs;
+        transportFeedback.ulJitterUs = m_stats.ulJitterUs;
+        m_pFeedbackSink->OnTransportFeedback(transportFeedback);
+    }
+}
+
+void CDmdRtcpSender::GetStats(DmdRtcpSenderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
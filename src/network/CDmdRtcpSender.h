@@ -0,0 +1,127 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtcpSender.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdRtcpSender.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDRTCPSENDER_H
+#define SRC_NETWORK_CDMDRTCPSENDER_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+typedef struct {
+    uint32_t        iSsrc;
+    uint32_t        iClockRate;
+    uint32_t        iTimestampOffset;    // as given to the packetizer;
+    float           fBandwidthFraction;
+    uint64_t        ulMinIntervalUs;
+} DmdRtcpSenderParam;
+
+typedef struct {
+    uint64_t        ulPacketCount;
+    uint64_t        ulOctetCount;        // payload only;
+    uint64_t        ulSendRateBps;       // between the last two reports;
+    uint64_t        ulReportCount;       // sender reports built;
+    uint64_t        ulReceiverReportCount;  // blocks about our ssrc;
+    uint64_t        ulRttUs;             // last measured, 0 if unknown;
+    float           fLossRate;           // of the last receiver report;
+    int32_t         iCumulativeLost;
+    uint64_t        ulJitterUs;
+} DmdRtcpSenderStats;
+
+/*
+ * Sender side of rfc 3550 reports for one ssrc. Sender reports pair an
+ * ntp time with the rtp timestamp of the same instant; both come from
+ * the monotonic clock the capture timestamps are taken on, the ntp time
+ * offset to the wall clock once at Init(), so a receiver maps each
+ * frame's rtp timestamp back to its capture wall clock, and a wall clock
+ * step does not show as a round trip change. Report blocks about our ssrc
+ * give the round trip, from their lsr and dlsr, the loss and the jitter,
+ * which are passed on as transport feedback. Runs on the sending thread,
+ * as the packet sink does.
+ */
+class CDmdRtcpSender {
+public:
+    CDmdRtcpSender();
+    ~CDmdRtcpSender();
+
+    DMD_RESULT Init(const DmdRtcpSenderParam &senderParam);
+    void SetFeedbackSink(IDmdTransportFeedbackSink *pFeedbackSink);
+
+    // packets as they were handed to the socket;
+    void OnPacketsSent(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount);
+    // a compound rtcp packet from the receiver; reports about other ssrcs
+    // and other packet types are ignored;
+    DMD_RESULT OnRtcp(const uint8_t *pData, size_t ulSize, uint64_t ulNowUs);
+
+    bool IsReportDue(uint64_t ulNowUs) const {
+        return ulNowUs >= m_ulNextReportUs;
+    }
+    // a sender report for ulNowUs, and schedules the next one;
+    DMD_RESULT BuildReport(uint64_t ulNowUs, uint8_t *pBuffer,
+            size_t ulCapacity, size_t *pSize);
+
+    // the ntp time sender reports carry for ulNowUs;
+    uint64_t GetNtpTime(uint64_t ulNowUs) const;
+    void GetStats(DmdRtcpSenderStats *pStats) const;
+
+private:
+    void onReportBlock(const DmdRtcpReportBlock &reportBlock,
+            uint64_t ulNowUs);
+
+    DmdRtcpSenderParam                m_param;
+    IDmdTransportFeedbackSink        *m_pFeedbackSink;
+    int64_t                           m_lWallClockOffsetUs;
+    uint64_t                          m_ulNextReportUs;
+    uint64_t                          m_ulLastReportUs;
+    uint64_t                          m_ulLastReportBytes;
+    uint64_t                          m_ulSentBytes;  // header included;
+    std::vector<DmdRtcpReport>        m_vecReports;
+    DmdRtcpSenderStats                m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDRTCPSENDER_H
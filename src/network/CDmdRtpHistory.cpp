@@ -0,0 +1,140 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtpHistory.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : ring of sent rtp packets for retransmission.
+ ============================================================================
+ */
+
+#include "CDmdRtpHistory.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+CDmdRtpHistory::CDmdRtpHistory() : m_ulSlotSize(0), m_iSlotMask(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdRtpHistory::~CDmdRtpHistory() {
+}
+
+DMD_RESULT CDmdRtpHistory::Init(size_t ulMaxBytes, size_t ulMaxPacketSize) {
+    if (0 == ulMaxPacketSize
+            || ulMaxBytes / ulMaxPacketSize < DMD_RTP_HISTORY_MIN_SLOTS) {
+        DMD_LOG_ERROR("CDmdRtpHistory::Init(), " << ulMaxBytes
+                << " bytes hold less than " << DMD_RTP_HISTORY_MIN_SLOTS
+                << " packets of " << ulMaxPacketSize);
+        return DMD_S_FAIL;
+    }
+
+    unsigned int iSlotCount = DMD_RTP_HISTORY_MIN_SLOTS;
+    while (iSlotCount * 2 <= ulMaxBytes / ulMaxPacketSize
+            && iSlotCount * 2 <= 65536) {
+        iSlotCount *= 2;
+    }
+    m_ulSlotSize = ulMaxPacketSize;
+    m_iSlotMask = iSlotCount - 1;
+    m_vecData.assign(iSlotCount * ulMaxPacketSize, 0);
+    m_vecSlots.resize(iSlotCount);
+    for (unsigned int i = 0; i < iSlotCount; i++) {
+        m_vecSlots[i].pData = &m_vecData[i * ulMaxPacketSize];
+    }
+    Reset();
+    DMD_LOG_INFO("CDmdRtpHistory::Init(), " << iSlotCount << " slots of "
+            << ulMaxPacketSize << " bytes");
+
+    return DMD_S_OK;
+}
+
+void CDmdRtpHistory::Reset() {
+    for (size_t i = 0; i < m_vecSlots.size(); i++) {
+        m_vecSlots[i].ulSize = 0;
+        m_vecSlots[i].bValid = false;
+        m_vecSlots[i].ulSentUs = 0;
+        m_vecSlots[i].ulResentUs = 0;
+    }
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+void CDmdRtpHistory::Store(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, uint64_t ulNowUs) {
+    if (m_vecSlots.empty()) {
+        return;
+    }
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        const DmdRtpPacket &packet = pPackets[i];
+        DmdRtpHistoryEntry &entry = m_vecSlots[packet.iSequence & m_iSlotMask];
+        if (packet.ulSize > m_ulSlotSize) {
+            // a stale packet must not answer for this sequence;
+            entry.bValid = false;
+            m_stats.ulOversizeCount++;
+            continue;
+        }
+        uint8_t *pData = entry.pData;
+        for (unsigned int j = 0; j < packet.iIovCount; j++) {
+            memcpy(pData, packet.pIov[j].iov_base, packet.pIov[j].iov_len);
+            pData += packet.pIov[j].iov_len;
+        }
+        entry.ulSize = packet.ulSize;
+        entry.iSequence = packet.iSequence;
+        entry.bValid = true;
+        entry.ulSentUs = ulNowUs;
+        entry.ulResentUs = 0;
+        m_stats.ulStoredCount++;
+    }
+}
+
+DmdRtpHistoryEntry *CDmdRtpHistory::Find(uint16_t iSequence) {
+    if (m_vecSlots.empty()) {
+        return NULL;
+    }
+    m_stats.ulLookupCount++;
+    DmdRtpHistoryEntry &entry = m_vecSlots[iSequence & m_iSlotMask];
+    if (!entry.bValid || entry.iSequence != iSequence) {
+        return NULL;
+    }
+    m_stats.ulHitCount++;
+    return &entry;
+}
+
+void CDmdRtpHistory::GetStats(DmdRtpHistoryStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,105 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtpHistory.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdRtpHistory.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDRTPHISTORY_H
+#define SRC_NETWORK_CDMDRTPHISTORY_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+#define DMD_RTP_HISTORY_DEFAULT_BYTES   (2 * 1024 * 1024)
+#define DMD_RTP_HISTORY_MIN_SLOTS       16
+
+// a packet as it was sent;
+typedef struct {
+    uint8_t        *pData;
+    size_t          ulSize;
+    uint16_t        iSequence;
+    bool            bValid;
+    uint64_t        ulSentUs;
+    uint64_t        ulResentUs;     // last retransmission, 0 if none;
+} DmdRtpHistoryEntry;
+
+typedef struct {
+    uint64_t        ulStoredCount;
+    uint64_t        ulOversizeCount;   // larger than a slot, not kept;
+    uint64_t        ulLookupCount;
+    uint64_t        ulHitCount;
+} DmdRtpHistoryStats;
+
+/*
+ * Recently sent rtp packets for retransmission, in a ring of fixed size
+ * slots indexed by the low bits of the sequence number: a lookup is one
+ * index, and a packet evicts the one a ring length before it. Memory is
+ * ulMaxBytes at most, as ulMaxBytes / ulMaxPacketSize slots rounded down
+ * to a power of two. Not locked; store and look up on the sending thread.
+ */
+class CDmdRtpHistory {
+public:
+    CDmdRtpHistory();
+    ~CDmdRtpHistory();
+
+    DMD_RESULT Init(size_t ulMaxBytes, size_t ulMaxPacketSize);
+    void Reset();
+
+    void Store(const DmdRtpPacket *pPackets, unsigned int iPacketCount,
+            uint64_t ulNowUs);
+    // NULL if evicted or never sent; valid until the next Store();
+    DmdRtpHistoryEntry *Find(uint16_t iSequence);
+
+    unsigned int GetSlotCount() const {return m_iSlotMask + 1;}
+    size_t GetCapacityBytes() const {return m_vecData.size();}
+    void GetStats(DmdRtpHistoryStats *pStats) const;
+
+private:
+    std::vector<uint8_t>             m_vecData;
+    std::vector<DmdRtpHistoryEntry>  m_vecSlots;
+    size_t                           m_ulSlotSize;
+    unsigned int                     m_iSlotMask;
+    DmdRtpHistoryStats               m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDRTPHISTORY_H
@@ -0,0 +1,302 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtpPacketizer.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : h.264 rtp packetizer, rfc 6184.
+ ============================================================================
+ */
+
+#include "CDmdRtpPacketizer.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+// fu indicator and fu header;
+#define DMD_RTP_FU_A_HEADER_SIZE    2
+// stap-a nal header, then a 16 bit size before each nal;
+#define DMD_RTP_STAP_A_HEADER_SIZE  1
+#define DMD_RTP_STAP_A_SIZE_FIELD   2
+// below this there is no room for a useful fragment;
+#define DMD_RTP_MIN_MTU             (DMD_RTP_HEADER_SIZE + 64)
+
+CDmdRtpPacketizer::CDmdRtpPacketizer() : m_ulMaxPayload(0), m_iSequence(0),
+        m_iTimestamp(0), m_pFrameBuffer(NULL), m_ulArenaUsed(0),
+        m_iIovUsed(0), m_iPacketUsed(0) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdRtpPacketizer::~CDmdRtpPacketizer() {
+}
+
+DMD_RESULT CDmdRtpPacketizer::Init(
+        const DmdRtpPacketizerParam &packetizerParam) {
+    DMD_LOG_INFO("CDmdRtpPacketizer::Init(), ssrc = "
+            << packetizerParam.iSsrc << ", mtu = " << packetizerParam.ulMtu
+            << ", aggregate = " << packetizerParam.bAggregate);
+    if (packetizerParam.ulMtu < DMD_RTP_MIN_MTU
+            || packetizerParam.iPayloadType > 127) {
+        DMD_LOG_ERROR("CDmdRtpPacketizer::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    m_param = packetizerParam;
+    m_ulMaxPayload = m_param.ulMtu - DMD_RTP_HEADER_SIZE;
+    m_iSequence = m_param.iFirstSequence;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    return DMD_S_OK;
+}
+
+void CDmdRtpPacketizer::reserve(const DmdEncodedFrame *pEncodedFrame) {
+    // upper bounds: each nal may be fragmented on its own, every packet
+    // takes a header iovec and a payload iovec, a stap-a a size field and
+    // a payload iovec per nal;
+    size_t ulFragment = m_ulMaxPayload - DMD_RTP_FU_A_HEADER_SIZE;
+    size_t ulPackets = 0;
+    for (unsigned int i = 0; i < pEncodedFrame->iNalCount; i++) {
+        ulPackets += pEncodedFrame->pNalIov[i].iov_len / ulFragment + 1;
+    }
+    size_t ulIovs = 2 * ulPackets + 2 * pEncodedFrame->iNalCount;
+    size_t ulArena = ulPackets * (DMD_RTP_HEADER_SIZE
+            + DMD_RTP_FU_A_HEADER_SIZE)
+        + pEncodedFrame->iNalCount * DMD_RTP_STAP_A_SIZE_FIELD;
+
+    if (m_vecPackets.size() < ulPackets) {
+        m_vecPackets.resize(ulPackets);
+    }
+    if (m_vecIov.size() < ulIovs) {
+        m_vecIov.resize(ulIovs);
+    }
+    if (m_vecArena.size() < ulArena) {
+        m_vecArena.resize(ulArena);
+    }
+    m_ulArenaUsed = 0;
+    m_iIovUsed = 0;
+    m_iPacketUsed = 0;
+}
+
+uint8_t *CDmdRtpPacketizer::beginPacket(size_t ulHeaderSize) {
+    uint8_t *pHeader = &m_vecArena[m_ulArenaUsed];
+    m_ulArenaUsed += ulHeaderSize;
+
+    DmdRtpHeader rtpHeader;
+    rtpHeader.bMarker = false;
+    rtpHeader.iPayloadType = m_param.iPayloadType;
+    rtpHeader.iSequence = m_iSequence;
+    rtpHeader.iTimestamp = m_iTimestamp;
+    rtpHeader.iSsrc = m_param.iSsrc;
+    DmdRtpWriteHeader(rtpHeader, pHeader);
+
+    struct iovec *pIov = &m_vecIov[m_iIovUsed++];
+    pIov->iov_base = pHeader;
+    pIov->iov_len = ulHeaderSize;
+
+    DmdRtpPacket *pPacket = &m_vecPackets[m_iPacketUsed++];
+    pPacket->pIov = pIov;
+    pPacket->iIovCount = 1;
+    pPacket->ulSize = ulHeaderSize;
+    pPacket->iSequence = m_iSequence;
+    pPacket->iTimestamp = m_iTimestamp;
+    pPacket->bMarker = false;
+    pPacket->pFrameBuffer = m_pFrameBuffer;
+
+    m_iSequence++;
+    m_stats.ulHeaderBytes += ulHeaderSize;
+    return pHeader + DMD_RTP_HEADER_SIZE;
+}
+
+void CDmdRtpPacketizer::addPayload(const void *pData, size_t ulSize) {
+    // iovecs of a packet are consecutive in the table;
+    struct iovec *pIov = &m_vecIov[m_iIovUsed++];
+    pIov->iov_base = const_cast<void *>(pData);
+    pIov->iov_len = ulSize;
+
+    DmdRtpPacket *pPacket = &m_vecPackets[m_iPacketUsed - 1];
+    pPacket->iIovCount++;
+    pPacket->ulSize += ulSize;
+}
+
+void CDmdRtpPacketizer::addSingleNal(const struct iovec &nal) {
+    beginPacket(DMD_RTP_HEADER_SIZE);
+    addPayload(nal.iov_base, nal.iov_len);
+    m_stats.ulSingleNalCount++;
+    m_stats.ulPayloadBytes += nal.iov_len;
+}
+
+unsigned int CDmdRtpPacketizer::addStapA(const struct iovec *pNals,
+        unsigned int iNalCount) {
+    // as many of the following nals as fit, at least two;
+    size_t ulSize = DMD_RTP_STAP_A_HEADER_SIZE;
+    unsigned int iCount = 0;
+    uint8_t iNri = 0;
+    uint8_t iForbidden = 0;
+    while (iCount < iNalCount && pNals[iCount].iov_len > 0) {
+        size_t ulNext = ulSize + DMD_RTP_STAP_A_SIZE_FIELD
+            + pNals[iCount].iov_len;
+        if (ulNext > m_ulMaxPayload) {
+            break;
+        }
+        const uint8_t *pNal =
+            static_cast<const uint8_t *>(pNals[iCount].iov_base);
+        if ((pNal[0] & DMD_H264_NAL_NRI_MASK) > iNri) {
+            iNri = pNal[0] & DMD_H264_NAL_NRI_MASK;
+        }
+        iForbidden |= pNal[0] & DMD_H264_NAL_F_MASK;
+        ulSize = ulNext;
+        iCount++;
+    }
+    if (iCount < 2) {
+        return 0;
+    }
+
+    uint8_t *pPayload = beginPacket(DMD_RTP_HEADER_SIZE
+            + DMD_RTP_STAP_A_HEADER_SIZE + DMD_RTP_STAP_A_SIZE_FIELD);
+    pPayload[0] = iForbidden | iNri | DMD_H264_NAL_STAP_A;
+    for (unsigned int i = 0; i < iCount; i++) {
+        uint8_t *pSize = pPayload + DMD_RTP_STAP_A_HEADER_SIZE;
+        if (i > 0) {
+            // the first size field shares the header iovec;
+            pSize = &m_vecArena[m_ulArenaUsed];
+            m_ulArenaUsed += DMD_RTP_STAP_A_SIZE_FIELD;
+            addPayload(pSize, DMD_RTP_STAP_A_SIZE_FIELD);
+            m_stats.ulHeaderBytes += DMD_RTP_STAP_A_SIZE_FIELD;
+        }
+        pSize[0] = static_cast<uint8_t>(pNals[i].iov_len >> 8);
+        pSize[1] = static_cast<uint8_t>(pNals[i].iov_len);
+        addPayload(pNals[i].iov_base, pNals[i].iov_len);
+        m_stats.ulPayloadBytes += pNals[i].iov_len;
+    }
+    m_stats.ulStapACount++;
+
+    return iCount;
+}
+
+void CDmdRtpPacketizer::addFuA(const struct iovec &nal) {
+    // the nal header travels in the fu indicator and fu header;
+    const uint8_t *pNal = static_cast<const uint8_t *>(nal.iov_base);
+    const uint8_t *pData = pNal + 1;
+    size_t ulRemain = nal.iov_len - 1;
+    size_t ulFragment = m_ulMaxPayload - DMD_RTP_FU_A_HEADER_SIZE;
+    // even sizes, so the last fragment is not a runt;
+    size_t ulCount = (ulRemain + ulFragment - 1) / ulFragment;
+    size_t ulSize = (ulRemain + ulCount - 1) / ulCount;
+
+    for (size_t i = 0; i < ulCount; i++) {
+        size_t ulLen = ulRemain < ulSize ? ulRemain : ulSize;
+        uint8_t *pPayload = beginPacket(DMD_RTP_HEADER_SIZE
+                + DMD_RTP_FU_A_HEADER_SIZE);
+        pPayload[0] = (pNal[0] & (DMD_H264_NAL_F_MASK | DMD_H264_NAL_NRI_MASK))
+            | DMD_H264_NAL_FU_A;
+        pPayload[1] = pNal[0] & DMD_H264_NAL_TYPE_MASK;
+        if (0 == i) {
+            pPayload[1] |= DMD_H264_FU_START;
+        }
+        if (i + 1 == ulCount) {
+            pPayload[1] |= DMD_H264_FU_END;
+        }
+        addPayload(pData, ulLen);
+        pData += ulLen;
+        ulRemain -= ulLen;
+        m_stats.ulFuACount++;
+    }
+    m_stats.ulPayloadBytes += nal.iov_len - 1;
+}
+
+DMD_RESULT CDmdRtpPacketizer::Packetize(const DmdEncodedFrame *pEncodedFrame,
+        const DmdRtpPacket **ppPackets, unsigned int *piPacketCount) {
+    if (NULL == pEncodedFrame || NULL == ppPackets || NULL == piPacketCount
+            || (pEncodedFrame->iNalCount && NULL == pEncodedFrame->pNalIov)
+            || 0 == m_ulMaxPayload) {
+        DMD_LOG_ERROR("CDmdRtpPacketizer::Packetize(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    *ppPackets = NULL;
+    *piPacketCount = 0;
+
+    reserve(pEncodedFrame);
+    m_iTimestamp = DmdRtpTimestamp(pEncodedFrame->ulTimestamp,
+            DMD_RTP_H264_CLOCK_RATE) + m_param.iTimestampOffset;
+    m_pFrameBuffer = pEncodedFrame->pFrameBuffer;
+
+    const struct iovec *pNals = pEncodedFrame->pNalIov;
+    unsigned int iNalCount = pEncodedFrame->iNalCount;
+    for (unsigned int i = 0; i < iNalCount;) {
+        size_t ulLen = pNals[i].iov_len;
+        if (0 == ulLen) {
+            i++;
+            continue;
+        }
+        if (ulLen > m_ulMaxPayload) {
+            addFuA(pNals[i]);
+            i++;
+            continue;
+        }
+        unsigned int iAggregated = m_param.bAggregate
+            ? addStapA(pNals + i, iNalCount - i) : 0;
+        if (iAggregated) {
+            i += iAggregated;
+            continue;
+        }
+        addSingleNal(pNals[i]);
+        i++;
+    }
+    m_pFrameBuffer = NULL;
+    if (0 == m_iPacketUsed) {
+        return DMD_S_OK;
+    }
+
+    // the marker closes the access unit, patched into the written header;
+    DmdRtpPacket *pLast = &m_vecPackets[m_iPacketUsed - 1];
+    pLast->bMarker = true;
+    static_cast<uint8_t *>(pLast->pIov[0].iov_base)[1] |= 0x80;
+
+    m_stats.ulFrameCount++;
+    m_stats.ulPacketCount += m_iPacketUsed;
+    *ppPackets = &m_vecPackets[0];
+    *piPacketCount = m_iPacketUsed;
+
+    return DMD_S_OK;
+}
+
+void CDmdRtpPacketizer::GetStats(DmdRtpPacketizerStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,127 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtpPacketizer.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdRtpPacketizer.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDRTPPACKETIZER_H
+#define SRC_NETWORK_CDMDRTPPACKETIZER_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+typedef struct {
+    uint32_t        iSsrc;
+    uint8_t         iPayloadType;
+    size_t          ulMtu;               // largest rtp packet, header in;
+    uint16_t        iFirstSequence;      // random per stream, rfc 3550;
+    uint32_t        iTimestampOffset;    // random per stream, rfc 3550;
+    bool            bAggregate;          // stap-a for small nal units;
+} DmdRtpPacketizerParam;
+
+typedef struct {
+    uint64_t        ulFrameCount;
+    uint64_t        ulPacketCount;
+    uint64_t        ulSingleNalCount;    // packets of one whole nal;
+    uint64_t        ulFuACount;          // fragments;
+    uint64_t        ulStapACount;        // aggregates;
+    uint64_t        ulPayloadBytes;      // nal bytes, referenced;
+    uint64_t        ulHeaderBytes;       // rtp and rfc 6184 headers;
+} DmdRtpPacketizerStats;
+
+/*
+ * RFC 6184 packetizer in non-interleaved mode. A nal unit that fits the
+ * mtu goes out whole, or aggregated with its small neighbours into a
+ * STAP-A, as sps, pps and the first slice of an idr usually are; larger
+ * ones are split into FU-A fragments of even size. The last packet of an
+ * access unit carries the marker bit.
+ *
+ * Payloads are never copied: each packet is a gather list, its headers in
+ * an arena of the packetizer, the nal bytes referenced straight from the
+ * encoder's pNalIov. Arena, iovec and packet tables keep their capacity
+ * between frames, so the steady state allocates nothing.
+ */
+class CDmdRtpPacketizer {
+public:
+    CDmdRtpPacketizer();
+    ~CDmdRtpPacketizer();
+
+    DMD_RESULT Init(const DmdRtpPacketizerParam &packetizerParam);
+
+    // packets stay valid until the next call, their payload as long as
+    // pEncodedFrame->pFrameBuffer; a skipped frame gives no packet;
+    DMD_RESULT Packetize(const DmdEncodedFrame *pEncodedFrame,
+            const DmdRtpPacket **ppPackets, unsigned int *piPacketCount);
+
+    uint16_t GetNextSequence() const {return m_iSequence;}
+    const DmdRtpPacketizerParam &GetParam() const {return m_param;}
+    void GetStats(DmdRtpPacketizerStats *pStats) const;
+
+private:
+    void reserve(const DmdEncodedFrame *pEncodedFrame);
+    uint8_t *beginPacket(size_t ulHeaderSize);
+    void addPayload(const void *pData, size_t ulSize);
+    void addSingleNal(const struct iovec &nal);
+    unsigned int addStapA(const struct iovec *pNals, unsigned int iNalCount);
+    void addFuA(const struct iovec &nal);
+
+private:
+    DmdRtpPacketizerParam          m_param;
+    size_t                         m_ulMaxPayload;
+    uint16_t                       m_iSequence;
+    uint32_t                       m_iTimestamp;      // of the frame;
+    IDmdFrameBuffer               *m_pFrameBuffer;    // of the frame;
+
+    // sized up front for the frame, never reallocated while filled;
+    std::vector<uint8_t>           m_vecArena;
+    std::vector<struct iovec>      m_vecIov;
+    std::vector<DmdRtpPacket>      m_vecPackets;
+    size_t                         m_ulArenaUsed;
+    unsigned int                   m_iIovUsed;
+    unsigned int                   m_iPacketUsed;
+
+    DmdRtpPacketizerStats          m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDRTPPACKETIZER_H
@@ -0,0 +1,150 @@
+/*
+ ============================================================================
+ * Name        : CDmdShmFrameSender.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdShmFrameSender.cpp
+ ============================================================================
+ */
+
+#include "CDmdShmFrameSender.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+CDmdShmFrameSender::CDmdShmFrameSender() : m_pRing(NULL) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdShmFrameSender::~CDmdShmFrameSender() {
+}
+
+DMD_RESULT CDmdShmFrameSender::Init(CDmdShmRing *pRing) {
+    if (NULL == pRing) {
+        DMD_LOG_ERROR("CDmdShmFrameSender::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_pRing = pRing;
+    memset(&m_stats, 0, sizeof(m_stats));
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdShmFrameSender::DeliverEncodedData(
+        DmdEncodedFrame *pEncodedFrame) {
+    if (NULL == m_pRing || NULL == pEncodedFrame) {
+        return DMD_S_FAIL;
+    }
+    uint64_t ulCpuStart = DmdGetThreadCpuTimeUs();
+    uint8_t *pData = NULL;
+    uint32_t iSize = static_cast<uint32_t>(pEncodedFrame->ulDataLen);
+    if (DMD_S_OK != m_pRing->Reserve(iSize, &pData)) {
+        m_stats.ulDroppedCount++;
+        DMD_LOG_WARNING("CDmdShmFrameSender::DeliverEncodedData(), ring "
+                << "full, " << iSize << " bytes dropped");
+        return DMD_S_FAIL;
+    }
+    memcpy(pData, pEncodedFrame->pData, iSize);
+
+    DmdShmRecord record;
+    memset(&record, 0, sizeof(record));
+    record.iType = DmdShmRecordEncoded;
+    record.iSize = iSize;
+    record.ulTimestamp = pEncodedFrame->ulTimestamp;
+    record.iWidth = pEncodedFrame->iWidth;
+    record.iHeight = pEncodedFrame->iHeight;
+    record.iFormat = pEncodedFrame->eFrameType;
+    record.iLayer = pEncodedFrame->eLayer;
+    DMD_RESULT ret = m_pRing->Commit(record);
+    m_stats.ulFrameCount++;
+    m_stats.ulByteCount += iSize;
+    m_stats.ulSendCpuUs += DmdGetThreadCpuTimeUs() - ulCpuStart;
+    return ret;
+}
+
+DMD_RESULT CDmdShmFrameSender::DeliverVideoData(
+        DmdVideoRawData *pVideoRawData) {
+    if (NULL == m_pRing || NULL == pVideoRawData
+            || pVideoRawData->ulPlaneCount > MAX_PLANE_COUNT) {
+        return DMD_S_FAIL;
+    }
+    uint64_t ulCpuStart = DmdGetThreadCpuTimeUs();
+    size_t ulSize = 0;
+    for (size_t i = 0; i < pVideoRawData->ulPlaneCount; i++) {
+        ulSize += pVideoRawData->ulSrcDataLength[i];
+    }
+    uint8_t *pData = NULL;
+    if (DMD_S_OK != m_pRing->Reserve(static_cast<uint32_t>(ulSize),
+                &pData)) {
+        m_stats.ulDroppedCount++;
+        DMD_LOG_WARNING("CDmdShmFrameSender::DeliverVideoData(), ring "
+                << "full, " << ulSize << " bytes dropped");
+        return DMD_S_FAIL;
+    }
+
+    DmdShmRecord record;
+    memset(&record, 0, sizeof(record));
+    record.iType = DmdShmRecordRaw;
+    record.iSize = static_cast<uint32_t>(ulSize);
+    record.ulTimestamp = pVideoRawData->fmtVideoFormat.ulTimestamp;
+    record.iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    record.iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    record.iFormat = pVideoRawData->fmtVideoFormat.eVideoType;
+    record.iFlags = pVideoRawData->ulFrameFlags;
+    record.iPlaneCount = static_cast<uint32_t>(pVideoRawData->ulPlaneCount);
+    // planes back to back, strides kept as they are;
+    for (size_t i = 0; i < pVideoRawData->ulPlaneCount; i++) {
+        size_t ulLength = pVideoRawData->ulSrcDataLength[i];
+        memcpy(pData, pVideoRawData->pSrcDataPanel[i], ulLength);
+        pData += ulLength;
+        record.arrPlaneSize[i] = static_cast<uint32_t>(ulLength);
+        record.arrStride[i] =
+            static_cast<uint32_t>(pVideoRawData->ulSrcDataStride[i]);
+    }
+    DMD_RESULT ret = m_pRing->Commit(record);
+    m_stats.ulFrameCount++;
+    m_stats.ulByteCount += ulSize;
+    m_stats.ulSendCpuUs += DmdGetThreadCpuTimeUs() - ulCpuStart;
+    return ret;
+}
+
+void CDmdShmFrameSender::GetStats(DmdShmFrameSenderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
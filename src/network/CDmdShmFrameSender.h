@@ -0,0 +1,86 @@
+/*
+ ============================================================================
+ * Name        : CDmdShmFrameSender.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdShmFrameSender.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDSHMFRAMESENDER_H
+#define SRC_NETWORK_CDMDSHMFRAMESENDER_H
+
+#include "IDmdDatatype.h"
+#include "IDmdCaptureEngine.h"
+#include "IDmdEncodeEngine.h"
+
+#include "CDmdShmRing.h"
+
+namespace opendmd {
+
+typedef struct {
+    uint64_t        ulFrameCount;
+    uint64_t        ulByteCount;
+    uint64_t        ulDroppedCount;
+    uint64_t        ulSendCpuUs;         // in DeliverXxx(), thread cpu;
+} DmdShmFrameSenderStats;
+
+/*
+ * Writes encoded access units, or raw frames, into a CDmdShmRing in
+ * place of the rtp packetizer and udp sender when the server runs on the
+ * same box; the server reads them back as whole frames, with no
+ * depacketizing and no socket in between. A frame the ring has no room
+ * for is dropped and counted. Delivery threads only, one at a time, as
+ * the ring has a single producer.
+ */
+class CDmdShmFrameSender : public IDmdEncodeEngineSink,
+    public IDmdCaptureEngineSink {
+public:
+    CDmdShmFrameSender();
+    virtual ~CDmdShmFrameSender();
+
+    DMD_RESULT Init(CDmdShmRing *pRing);
+
+    virtual DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame);
+    virtual DMD_RESULT DeliverVideoData(DmdVideoRawData *pVideoRawData);
+
+    void GetStats(DmdShmFrameSenderStats *pStats) const;
+
+private:
+    CDmdShmRing                *m_pRing;
+    DmdShmFrameSenderStats      m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDSHMFRAMESENDER_H
@@ -0,0 +1,330 @@
+/*
+ ============================================================================
+ * Name        : CDmdShmRing.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdShmRing.cpp
+ ============================================================================
+ */
+
+#include "CDmdShmRing.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+
+#include "DmdLog.h"
+#include "DmdSocketUtils.h"
+
+namespace opendmd {
+
+CDmdShmRing::CDmdShmRing() : m_iMemFd(-1), m_iEventFd(-1), m_pMapping(NULL),
+        m_ulMapSize(0), m_pControl(NULL), m_pData(NULL), m_ulCapacity(0),
+        m_ulReservedPos(0), m_iReservedSize(0), m_bReserved(false),
+        m_ulPeekEnd(0), m_bPeeked(false) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdShmRing::~CDmdShmRing() {
+    Uninit();
+}
+
+size_t CDmdShmRing::recordBytes(uint32_t iSize) {
+    return (sizeof(DmdShmRecord) + iSize + DMD_SHM_RECORD_ALIGN - 1)
+        & ~static_cast<size_t>(DMD_SHM_RECORD_ALIGN - 1);
+}
+
+DMD_RESULT CDmdShmRing::map(size_t ulMapSize) {
+    void *pMapping = mmap(NULL, ulMapSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED, m_iMemFd, 0);
+    if (MAP_FAILED == pMapping) {
+        DMD_LOG_ERROR("CDmdShmRing::map(), mmap " << ulMapSize
+                << " bytes failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    m_pMapping = static_cast<uint8_t *>(pMapping);
+    m_ulMapSize = ulMapSize;
+    m_pControl = reinterpret_cast<DmdShmRingControl *>(m_pMapping);
+    m_pData = m_pMapping + DMD_SHM_RING_HEADER_SIZE;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdShmRing::Create(size_t ulCapacity) {
+    Uninit();
+    m_ulCapacity = DMD_SHM_RECORD_ALIGN * 2;
+    while (m_ulCapacity < ulCapacity) {
+        m_ulCapacity <<= 1;
+    }
+
+    m_iMemFd = memfd_create("opendmd-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    m_iEventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_iMemFd < 0 || m_iEventFd < 0) {
+        DMD_LOG_ERROR("CDmdShmRing::Create(), memfd or eventfd failed, "
+                << strerror(errno));
+        Uninit();
+        return DMD_S_FAIL;
+    }
+    // sealed, so that the consumer can trust the size it maps;
+    size_t ulMapSize = DMD_SHM_RING_HEADER_SIZE + m_ulCapacity;
+    if (0 != ftruncate(m_iMemFd, ulMapSize)
+            || 0 != fcntl(m_iMemFd, F_ADD_SEALS,
+                F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+            || DMD_S_OK != map(ulMapSize)) {
+        DMD_LOG_ERROR("CDmdShmRing::Create(), size " << ulMapSize
+                << " bytes failed, " << strerror(errno));
+        Uninit();
+        return DMD_S_FAIL;
+    }
+
+    // a fresh memfd reads as zeros, construct the control block in place;
+    m_pControl = new (m_pMapping) DmdShmRingControl;
+    m_pControl->iMagic = DMD_SHM_RING_MAGIC;
+    m_pControl->iVersion = DMD_SHM_RING_VERSION;
+    m_pControl->ulCapacity = m_ulCapacity;
+    m_pControl->ulWritePos.store(0);
+    m_pControl->ulReadPos.store(0);
+    m_pControl->iReaderWaiting.store(0);
+    DMD_LOG_INFO("CDmdShmRing::Create(), capacity:" << m_ulCapacity);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdShmRing::Offer(int iSocket) {
+    if (m_iMemFd < 0) {
+        DMD_LOG_ERROR("CDmdShmRing::Offer(), not created");
+        return DMD_S_FAIL;
+    }
+    int arrFds[2] = {m_iMemFd, m_iEventFd};
+    return DmdSendFds(iSocket, arrFds, 2);
+}
+
+DMD_RESULT CDmdShmRing::Attach(int iMemFd, int iEventFd) {
+    Uninit();
+    m_iMemFd = iMemFd;
+    m_iEventFd = iEventFd;
+    struct stat st;
+    int iSeals = fcntl(m_iMemFd, F_GET_SEALS);
+    if (0 != fstat(m_iMemFd, &st) || iSeals < 0
+            || !(iSeals & F_SEAL_SHRINK)
+            || st.st_size <= DMD_SHM_RING_HEADER_SIZE
+            || DMD_S_OK != map(st.st_size)) {
+        DMD_LOG_ERROR("CDmdShmRing::Attach(), not a sealed ring");
+        Uninit();
+        return DMD_S_FAIL;
+    }
+    if (DMD_SHM_RING_MAGIC != m_pControl->iMagic
+            || DMD_SHM_RING_VERSION != m_pControl->iVersion
+            || m_pControl->ulCapacity + DMD_SHM_RING_HEADER_SIZE
+                != static_cast<uint64_t>(st.st_size)) {
+        DMD_LOG_ERROR("CDmdShmRing::Attach(), bad control block, magic:"
+                << m_pControl->iMagic << ", version:"
+                << m_pControl->iVersion);
+        Uninit();
+        return DMD_S_FAIL;
+    }
+    m_ulCapacity = m_pControl->ulCapacity;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdShmRing::Accept(int iSocket) {
+    int arrFds[2] = {-1, -1};
+    if (DMD_S_OK != DmdRecvFds(iSocket, arrFds, 2)) {
+        return DMD_S_FAIL;
+    }
+    return Attach(arrFds[0], arrFds[1]);
+}
+
+void CDmdShmRing::Uninit() {
+    if (m_pMapping) {
+        munmap(m_pMapping, m_ulMapSize);
+        m_pMapping = NULL;
+    }
+    if (m_iMemFd >= 0) {
+        close(m_iMemFd);
+        m_iMemFd = -1;
+    }
+    if (m_iEventFd >= 0) {
+        close(m_iEventFd);
+        m_iEventFd = -1;
+    }
+    m_ulMapSize = 0;
+    m_pControl = NULL;
+    m_pData = NULL;
+    m_ulCapacity = 0;
+    m_bReserved = false;
+    m_bPeeked = false;
+}
+
+DMD_RESULT CDmdShmRing::Reserve(uint32_t iSize, uint8_t **ppData) {
+    if (NULL == m_pControl || NULL == ppData) {
+        return DMD_S_FAIL;
+    }
+    size_t ulBytes = recordBytes(iSize);
+    uint64_t ulWrite = m_pControl->ulWritePos.load(std::memory_order_relaxed);
+    uint64_t ulRead = m_pControl->ulReadPos.load(std::memory_order_acquire);
+    size_t ulOffset = ulWrite & (m_ulCapacity - 1);
+    size_t ulTail = m_ulCapacity - ulOffset;
+    // a record never wraps, the tail is padded instead;
+    size_t ulPadding = ulTail < ulBytes ? ulTail : 0;
+    if (ulBytes > m_ulCapacity / 2
+            || ulWrite + ulPadding + ulBytes - ulRead > m_ulCapacity) {
+        m_stats.ulDroppedCount++;
+        m_bReserved = false;
+        return DMD_S_FAIL;
+    }
+
+    if (ulPadding) {
+        DmdShmRecord *pPadding =
+            reinterpret_cast<DmdShmRecord *>(m_pData + ulOffset);
+        memset(pPadding, 0, sizeof(*pPadding));
+        pPadding->iType = DmdShmRecordPadding;
+        pPadding->iSize = static_cast<uint32_t>(ulTail
+                - sizeof(DmdShmRecord));
+        ulOffset = 0;
+    }
+    m_ulReservedPos = ulWrite + ulPadding;
+    m_iReservedSize = iSize;
+    m_bReserved = true;
+    *ppData = m_pData + ulOffset + sizeof(DmdShmRecord);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdShmRing::Commit(const DmdShmRecord &record) {
+    if (!m_bReserved) {
+        return DMD_S_FAIL;
+    }
+    m_bReserved = false;
+    // beyond the reservation, the next record or the reader's is overrun;
+    if (record.iSize > m_iReservedSize) {
+        DMD_LOG_ERROR("CDmdShmRing::Commit(), " << record.iSize
+                << " bytes committed, " << m_iReservedSize << " reserved");
+        m_stats.ulDroppedCount++;
+        return DMD_S_FAIL;
+    }
+    memcpy(m_pData + (m_ulReservedPos & (m_ulCapacity - 1)), &record,
+            sizeof(record));
+    m_pControl->ulWritePos.store(m_ulReservedPos + recordBytes(record.iSize));
+    m_stats.ulWrittenCount++;
+    m_stats.ulWrittenBytes += record.iSize;
+
+    // paired with the store and recheck in Wait(), one side sees the other;
+    if (m_pControl->iReaderWaiting.load()) {
+        uint64_t ulOne = 1;
+        if (write(m_iEventFd, &ulOne, sizeof(ulOne)) > 0) {
+            m_stats.ulSignalCount++;
+        }
+    }
+    return DMD_S_OK;
+}
+
+bool CDmdShmRing::IsEmpty() const {
+    return NULL == m_pControl || m_pControl->ulReadPos.load(
+            std::memory_order_relaxed) == m_pControl->ulWritePos.load();
+}
+
+DMD_RESULT CDmdShmRing::Peek(const DmdShmRecord **ppRecord,
+        const uint8_t **ppData) {
+    if (NULL == m_pControl || NULL == ppRecord || NULL == ppData) {
+        return DMD_S_FAIL;
+    }
+    uint64_t ulRead = m_pControl->ulReadPos.load(std::memory_order_relaxed);
+    uint64_t ulWrite = m_pControl->ulWritePos.load(std::memory_order_acquire);
+    while (ulRead != ulWrite) {
+        const DmdShmRecord *pRecord = reinterpret_cast<const DmdShmRecord *>(
+                m_pData + (ulRead & (m_ulCapacity - 1)));
+        size_t ulBytes = recordBytes(pRecord->iSize);
+        // the producer is another process, do not trust it blindly;
+        if (ulBytes > ulWrite - ulRead || ulBytes > m_ulCapacity
+                - (ulRead & (m_ulCapacity - 1))) {
+            DMD_LOG_ERROR("CDmdShmRing::Peek(), corrupt record, size:"
+                    << pRecord->iSize);
+            return DMD_S_FAIL;
+        }
+        if (DmdShmRecordPadding == pRecord->iType) {
+            ulRead += ulBytes;
+            m_pControl->ulReadPos.store(ulRead, std::memory_order_release);
+            continue;
+        }
+        *ppRecord = pRecord;
+        *ppData = reinterpret_cast<const uint8_t *>(pRecord + 1);
+        m_ulPeekEnd = ulRead + ulBytes;
+        m_bPeeked = true;
+        return DMD_S_OK;
+    }
+    return DMD_S_FAIL;
+}
+
+void CDmdShmRing::Release() {
+    if (m_bPeeked) {
+        m_bPeeked = false;
+        m_pControl->ulReadPos.store(m_ulPeekEnd, std::memory_order_release);
+        m_stats.ulReadCount++;
+    }
+}
+
+DMD_RESULT CDmdShmRing::Wait(int iTimeoutMs) {
+    if (NULL == m_pControl) {
+        return DMD_S_FAIL;
+    }
+    if (!IsEmpty()) {
+        return DMD_S_OK;
+    }
+    m_pControl->iReaderWaiting.store(1);
+    if (IsEmpty()) {
+        m_stats.ulWaitCount++;
+        struct pollfd pfd = {m_iEventFd, POLLIN, 0};
+        if (poll(&pfd, 1, iTimeoutMs) > 0) {
+            uint64_t ulCount = 0;
+            if (read(m_iEventFd, &ulCount, sizeof(ulCount)) < 0) {
+                DMD_LOG_WARNING("CDmdShmRing::Wait(), read eventfd failed, "
+                        << strerror(errno));
+            }
+        }
+    }
+    m_pControl->iReaderWaiting.store(0);
+    return IsEmpty() ? DMD_S_FAIL : DMD_S_OK;
+}
+
+void CDmdShmRing::GetStats(DmdShmRingStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
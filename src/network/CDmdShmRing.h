@@ -0,0 +1,164 @@
+/*
+ ============================================================================
+ * Name        : CDmdShmRing.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdShmRing.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDSHMRING_H
+#define SRC_NETWORK_CDMDSHMRING_H
+
+#include <atomic>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+#define DMD_SHM_RING_MAGIC            0x444d4453  // "DMDS";
+#define DMD_SHM_RING_VERSION          1
+#define DMD_SHM_RING_DEFAULT_CAPACITY (8 * 1024 * 1024)
+// the control block has a page of its own, data starts page aligned;
+#define DMD_SHM_RING_HEADER_SIZE      4096
+#define DMD_SHM_RECORD_ALIGN          64
+
+typedef enum {
+    DmdShmRecordPadding = 0,  // skipped, fills the tail before a wrap;
+    DmdShmRecordEncoded,      // annex-b access unit;
+    DmdShmRecordRaw,          // planes of a raw frame, back to back;
+} DmdShmRecordType;
+
+// precedes every record in the ring, 64 bytes;
+typedef struct {
+    uint32_t        iType;               // DmdShmRecordType;
+    uint32_t        iSize;               // payload, header excluded;
+    uint64_t        ulTimestamp;         // capture time, in microseconds;
+    uint32_t        iWidth;
+    uint32_t        iHeight;
+    uint32_t        iFormat;             // DmdEncodedFrameType or
+                                         // DmdVideoType;
+    uint32_t        iLayer;              // DmdEncodeLayer;
+    uint32_t        iFlags;              // DMD_FRAME_FLAG_*;
+    uint32_t        iPlaneCount;         // raw frames only;
+    uint32_t        arrPlaneSize[MAX_PLANE_COUNT];
+    uint32_t        arrStride[MAX_PLANE_COUNT];
+} DmdShmRecord;
+// a record starts on a slot, its payload right after the header;
+static_assert(sizeof(DmdShmRecord) == DMD_SHM_RECORD_ALIGN,
+        "DmdShmRecord must fill exactly one record slot");
+
+typedef struct {
+    uint64_t        ulWrittenCount;
+    uint64_t        ulWrittenBytes;      // payload;
+    uint64_t        ulDroppedCount;      // ring full;
+    uint64_t        ulReadCount;
+    uint64_t        ulSignalCount;       // eventfd writes;
+    uint64_t        ulWaitCount;         // reader went to sleep;
+} DmdShmRingStats;
+
+/*
+ * Single producer, single consumer record ring in a sealed memfd, for a
+ * client and server on the same box. The producer Create()s it and hands
+ * the memfd and the data eventfd to the consumer over a unix socket with
+ * Offer(); the consumer maps the same pages with Accept(). Records are
+ * written in place after Reserve() and read in place with Peek(), so a
+ * frame is copied once, into the ring, instead of being packetized and
+ * pushed through the socket layer twice. The producer never blocks: a
+ * record that does not fit is dropped, as a congested link would. The
+ * eventfd is only written when the consumer sleeps in Wait(), so a busy
+ * consumer costs the producer no syscall at all.
+ */
+class CDmdShmRing {
+public:
+    CDmdShmRing();
+    ~CDmdShmRing();
+
+    // producer side, ulCapacity rounded up to a power of two;
+    DMD_RESULT Create(size_t ulCapacity);
+    DMD_RESULT Offer(int iSocket);
+    // consumer side, takes ownership of the descriptors;
+    DMD_RESULT Attach(int iMemFd, int iEventFd);
+    DMD_RESULT Accept(int iSocket);
+    void Uninit();
+
+    // a payload area of iSize bytes, valid until Commit(); fails if the
+    // ring is full, the record is then dropped;
+    DMD_RESULT Reserve(uint32_t iSize, uint8_t **ppData);
+    // publishes the reserved record, record.iSize bytes of payload, no
+    // more than were reserved, else the record is dropped;
+    DMD_RESULT Commit(const DmdShmRecord &record);
+
+    // the oldest record, in place, until Release(); fails if empty;
+    DMD_RESULT Peek(const DmdShmRecord **ppRecord, const uint8_t **ppData);
+    void Release();
+    // up to iTimeoutMs for a record, -1 for no limit;
+    DMD_RESULT Wait(int iTimeoutMs);
+    bool IsEmpty() const;
+
+    int GetEventFd() const {return m_iEventFd;}
+    size_t GetCapacity() const {return m_ulCapacity;}
+    void GetStats(DmdShmRingStats *pStats) const;
+
+private:
+    // shared by both processes, in the first page of the memfd;
+    typedef struct {
+        uint32_t                iMagic;
+        uint32_t                iVersion;
+        uint64_t                ulCapacity;
+        alignas(64) std::atomic<uint64_t> ulWritePos;
+        alignas(64) std::atomic<uint64_t> ulReadPos;
+        std::atomic<uint32_t>   iReaderWaiting;
+    } DmdShmRingControl;
+
+    DMD_RESULT map(size_t ulMapSize);
+    static size_t recordBytes(uint32_t iSize);
+
+    int                     m_iMemFd;
+    int                     m_iEventFd;
+    uint8_t                *m_pMapping;
+    size_t                  m_ulMapSize;
+    DmdShmRingControl      *m_pControl;
+    uint8_t                *m_pData;
+    size_t                  m_ulCapacity;
+    uint64_t                m_ulReservedPos;  // producer, record start;
+    uint32_t                m_iReservedSize;
+    bool                    m_bReserved;
+    uint64_t                m_ulPeekEnd;      // consumer, after the peek;
+    bool                    m_bPeeked;
+    DmdShmRingStats         m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDSHMRING_H
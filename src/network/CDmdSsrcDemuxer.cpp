@@ -0,0 +1,244 @@
+/*
+ ============================================================================
+ * Name        : CDmdSsrcDemuxer.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdSsrcDemuxer.cpp
+ ============================================================================
+ */
+
+#include "CDmdSsrcDemuxer.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// spreads ssrcs a peer picked badly, sequential ones say, over the table;
+static inline uint32_t slotOf(uint32_t iSsrc, uint32_t iMask) {
+    return (iSsrc * 0x9e3779b1U >> 16 ^ iSsrc) & iMask;
+}
+
+static inline uint32_t readU32(const uint8_t *pData) {
+    return static_cast<uint32_t>(pData[0]) << 24
+        | static_cast<uint32_t>(pData[1]) << 16
+        | static_cast<uint32_t>(pData[2]) << 8 | pData[3];
+}
+
+CDmdSsrcDemuxer::CDmdSsrcDemuxer() : m_pUnknownSink(NULL), m_iMask(0),
+        m_ulStreamCount(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdSsrcDemuxer::~CDmdSsrcDemuxer() {
+    Uninit();
+}
+
+DMD_RESULT CDmdSsrcDemuxer::Init(IDmdDatagramSink *pUnknownSink) {
+    Uninit();
+    m_pUnknownSink = pUnknownSink;
+    memset(&m_stats, 0, sizeof(m_stats));
+    rebuild(DMD_SSRC_TABLE_MIN_SIZE);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdSsrcDemuxer::Uninit() {
+    m_vecTable.clear();
+    m_iMask = 0;
+    m_ulStreamCount = 0;
+    m_pUnknownSink = NULL;
+    return DMD_S_OK;
+}
+
+void CDmdSsrcDemuxer::insert(uint32_t iSsrc, IDmdDatagramSink *pSink) {
+    uint32_t iSlot = slotOf(iSsrc, m_iMask);
+    while (m_vecTable[iSlot].pSink) {
+        iSlot = (iSlot + 1) & m_iMask;
+    }
+    m_vecTable[iSlot].iSsrc = iSsrc;
+    m_vecTable[iSlot].pSink = pSink;
+}
+
+void CDmdSsrcDemuxer::rebuild(size_t ulSize) {
+    std::vector<DmdSsrcSlot> vecOld;
+    vecOld.swap(m_vecTable);
+    DmdSsrcSlot emptySlot = {0, NULL};
+    m_vecTable.assign(ulSize, emptySlot);
+    m_iMask = static_cast<uint32_t>(ulSize - 1);
+    for (size_t i = 0; i < vecOld.size(); i++) {
+        if (vecOld[i].pSink) {
+            insert(vecOld[i].iSsrc, vecOld[i].pSink);
+        }
+    }
+}
+
+IDmdDatagramSink *CDmdSsrcDemuxer::lookup(uint32_t iSsrc) {
+    uint32_t iSlot = slotOf(iSsrc, m_iMask);
+    while (m_vecTable[iSlot].pSink) {
+        if (m_vecTable[iSlot].iSsrc == iSsrc) {
+            return m_vecTable[iSlot].pSink;
+        }
+        iSlot = (iSlot + 1) & m_iMask;
+    }
+    return NULL;
+}
+
+DMD_RESULT CDmdSsrcDemuxer::AddStream(uint32_t iSsrc,
+        IDmdDatagramSink *pSink) {
+    if (NULL == pSink || m_vecTable.empty()) {
+        DMD_LOG_ERROR("CDmdSsrcDemuxer::AddStream(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    if (lookup(iSsrc)) {
+        DMD_LOG_ERROR("CDmdSsrcDemuxer::AddStream(), ssrc " << iSsrc
+                << " taken");
+        return DMD_S_FAIL;
+    }
+    if ((m_ulStreamCount + 1) * DMD_SSRC_TABLE_LOAD_FACTOR
+            > m_vecTable.size()) {
+        rebuild(m_vecTable.size() * 2);
+    }
+    insert(iSsrc, pSink);
+    m_ulStreamCount++;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdSsrcDemuxer::RemoveStream(uint32_t iSsrc) {
+    if (m_vecTable.empty()) {
+        return DMD_S_FAIL;
+    }
+    uint32_t iSlot = slotOf(iSsrc, m_iMask);
+    while (m_vecTable[iSlot].pSink && m_vecTable[iSlot].iSsrc != iSsrc) {
+        iSlot = (iSlot + 1) & m_iMask;
+    }
+    if (NULL == m_vecTable[iSlot].pSink) {
+        return DMD_S_FAIL;
+    }
+    // no tombstones, the chain after it is put back in place;
+    m_vecTable[iSlot].pSink = NULL;
+    m_ulStreamCount--;
+    rebuild(m_vecTable.size());
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdSsrcDemuxer::GetStreamSsrc(const uint8_t *pData,
+        size_t ulSize, uint32_t *piSsrc, bool *pbRtcp) {
+    if (ulSize < 8 || DMD_RTP_VERSION != pData[0] >> 6) {
+        return DMD_S_FAIL;
+    }
+    // rfc 5761: rtcp packet types 192 to 223 are no rtp payload type;
+    uint8_t iType = pData[1];
+    *pbRtcp = iType >= 192 && iType <= 223;
+    if (!*pbRtcp) {
+        if (ulSize < DMD_RTP_HEADER_SIZE) {
+            return DMD_S_FAIL;
+        }
+        *piSsrc = readU32(pData + 8);
+        return DMD_S_OK;
+    }
+
+    // the first of a compound packet decides; reports and sdes go by
+    // their sender, unless a receiver report has a block to go by;
+    bool bAboutMedia = DMD_RTCP_PT_RTPFB == iType
+        || DMD_RTCP_PT_RTPFB + 1 == iType
+        || (DMD_RTCP_PT_RR == iType && (pData[0] & 0x1f));
+    if (bAboutMedia) {
+        if (ulSize < 12) {
+            return DMD_S_FAIL;
+        }
+        *piSsrc = readU32(pData + 8);
+        return DMD_S_OK;
+    }
+    *piSsrc = readU32(pData + 4);
+    return DMD_S_OK;
+}
+
+void CDmdSsrcDemuxer::OnDatagrams(const DmdDatagram *pDatagrams,
+        unsigned int iCount) {
+    unsigned int iRunStart = 0;
+    IDmdDatagramSink *pRunSink = NULL;
+    // the stream of the last datagram, most follow one of their own;
+    bool bCached = false;
+    uint32_t iCachedSsrc = 0;
+    IDmdDatagramSink *pCachedSink = NULL;
+    for (unsigned int i = 0; i <= iCount; i++) {
+        IDmdDatagramSink *pSink = NULL;
+        if (i < iCount) {
+            uint32_t iSsrc = 0;
+            bool bRtcp = false;
+            if (DMD_S_OK != GetStreamSsrc(pDatagrams[i].pData,
+                        pDatagrams[i].ulSize, &iSsrc, &bRtcp)) {
+                m_stats.ulMalformedCount++;
+            } else {
+                if (bRtcp) {
+                    m_stats.ulRtcpCount++;
+                } else {
+                    m_stats.ulRtpCount++;
+                }
+                if (!bCached || iSsrc != iCachedSsrc) {
+                    bCached = true;
+                    iCachedSsrc = iSsrc;
+                    pCachedSink = lookup(iSsrc);
+                    m_stats.ulLookupCount++;
+                }
+                pSink = pCachedSink;
+                if (NULL == pSink) {
+                    m_stats.ulUnknownCount++;
+                    pSink = m_pUnknownSink;
+                }
+            }
+            if (i > iRunStart && pSink == pRunSink) {
+                continue;
+            }
+        }
+        // malformed datagrams, and those of no sink, end up in a run of
+        // NULL and are dropped;
+        if (i > iRunStart && pRunSink) {
+            m_stats.ulDeliverCount++;
+            pRunSink->OnDatagrams(pDatagrams + iRunStart, i - iRunStart);
+        }
+        iRunStart = i;
+        pRunSink = pSink;
+    }
+}
+
+void CDmdSsrcDemuxer::GetStats(DmdSsrcDemuxerStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
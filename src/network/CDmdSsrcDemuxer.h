@@ -0,0 +1,119 @@
+/*
+ ============================================================================
+ * Name        : CDmdSsrcDemuxer.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdSsrcDemuxer.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDSSRCDEMUXER_H
+#define SRC_NETWORK_CDMDSSRCDEMUXER_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "CDmdUdpReceiver.h"
+
+namespace opendmd {
+
+// slots per stream at least, keeps probe chains short;
+#define DMD_SSRC_TABLE_LOAD_FACTOR  2
+#define DMD_SSRC_TABLE_MIN_SIZE     16
+
+typedef struct {
+    uint64_t        ulRtpCount;
+    uint64_t        ulRtcpCount;
+    uint64_t        ulUnknownCount;      // no stream of that ssrc;
+    uint64_t        ulMalformedCount;    // too short, or not version 2;
+    uint64_t        ulLookupCount;       // table lookups, runs share one;
+    uint64_t        ulDeliverCount;      // calls to a stream sink;
+} DmdSsrcDemuxerStats;
+
+/*
+ * Splits the datagrams of a socket shared by many streams, rtp and rtcp
+ * multiplexed (rfc 5761), into the sink of each stream's pipeline. A
+ * datagram costs one lookup in an open addressing table of ssrcs, built
+ * as streams are added, and a run of datagrams of one stream costs one
+ * lookup and one call to its sink, the datagrams passed in place. Rtcp
+ * goes to the stream it is about: the sender of a report or sdes, the
+ * reportee of a receiver report, the media source of feedback.
+ *
+ * Streams are added and removed on the receiving thread, or before it
+ * runs.
+ */
+class CDmdSsrcDemuxer : public IDmdDatagramSink {
+public:
+    CDmdSsrcDemuxer();
+    ~CDmdSsrcDemuxer();
+
+    // pUnknownSink gets datagrams of no known stream, may be NULL;
+    DMD_RESULT Init(IDmdDatagramSink *pUnknownSink);
+    DMD_RESULT Uninit();
+
+    // fails on an ssrc taken, ssrcs of a client must be unique;
+    DMD_RESULT AddStream(uint32_t iSsrc, IDmdDatagramSink *pSink);
+    DMD_RESULT RemoveStream(uint32_t iSsrc);
+    size_t GetStreamCount() const {return m_ulStreamCount;}
+
+    // IDmdDatagramSink interface;
+    void OnDatagrams(const DmdDatagram *pDatagrams, unsigned int iCount);
+
+    // the ssrc a datagram belongs to, rtp or rtcp; fails if malformed;
+    static DMD_RESULT GetStreamSsrc(const uint8_t *pData, size_t ulSize,
+            uint32_t *piSsrc, bool *pbRtcp);
+
+    void GetStats(DmdSsrcDemuxerStats *pStats) const;
+
+private:
+    typedef struct {
+        uint32_t            iSsrc;
+        IDmdDatagramSink   *pSink;       // NULL if free;
+    } DmdSsrcSlot;
+
+    IDmdDatagramSink *lookup(uint32_t iSsrc);
+    void rebuild(size_t ulSize);
+    void insert(uint32_t iSsrc, IDmdDatagramSink *pSink);
+
+private:
+    IDmdDatagramSink           *m_pUnknownSink;
+    std::vector<DmdSsrcSlot>    m_vecTable;    // a power of two;
+    uint32_t                    m_iMask;
+    size_t                      m_ulStreamCount;
+    DmdSsrcDemuxerStats         m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDSSRCDEMUXER_H
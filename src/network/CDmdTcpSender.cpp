@@ -0,0 +1,605 @@
+/*
+ ============================================================================
+ * Name        : CDmdTcpSender.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdTcpSender.cpp
+ ============================================================================
+ */
+
+#include "CDmdTcpSender.h"
+
+#include <errno.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+namespace opendmd {
+
+CDmdTcpSender::CDmdTcpSender() : m_iSocket(-1), m_bZeroCopy(false),
+        m_iZeroCopyNext(0), m_bWaitKeyFrame(false), m_bDiscarding(false),
+        m_iDiscardTimestamp(0), m_bKeyFrameRequest(false),
+        m_ulQueueBytes(0) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdTcpSender::~CDmdTcpSender() {
+    Uninit();
+    for (size_t i = 0; i < m_vecFreeFrames.size(); i++) {
+        delete m_vecFreeFrames[i];
+    }
+    m_vecFreeFrames.clear();
+}
+
+DMD_RESULT CDmdTcpSender::Init(const DmdTcpSenderParam &senderParam) {
+    Uninit();
+    m_param = senderParam;
+    if (0 == m_param.ulZeroCopyMinBytes) {
+        m_param.ulZeroCopyMinBytes = DMD_TCP_DEFAULT_ZEROCOPY_BYTES;
+    }
+    if (0 == m_param.ulDropDelayUs) {
+        m_param.ulDropDelayUs = DMD_TCP_DEFAULT_DROP_DELAY_US;
+    }
+    if (0 == m_param.ulFlushDelayUs) {
+        m_param.ulFlushDelayUs = DMD_TCP_DEFAULT_FLUSH_DELAY_US;
+    }
+    if (0 == m_param.ulMaxQueueBytes) {
+        m_param.ulMaxQueueBytes = DMD_TCP_DEFAULT_MAX_QUEUE_BYTES;
+    }
+    if (0 == m_param.iNotSentLowat) {
+        m_param.iNotSentLowat = DMD_TCP_DEFAULT_NOTSENT_LOWAT;
+    }
+    if (0 == m_param.iRemoteAddrLen
+            || m_param.ulDropDelayUs > m_param.ulFlushDelayUs) {
+        DMD_LOG_ERROR("CDmdTcpSender::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_iZeroCopyNext = 0;
+    m_bWaitKeyFrame = false;
+    m_bDiscarding = false;
+    m_bKeyFrameRequest = false;
+    m_vecIov.reserve(DMD_TCP_MAX_IOV);
+    return connectSocket();
+}
+
+DMD_RESULT CDmdTcpSender::connectSocket() {
+    m_iSocket = socket(m_param.remoteAddr.ss_family,
+            SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (m_iSocket < 0) {
+        DMD_LOG_ERROR("CDmdTcpSender::connectSocket(), socket failed, "
+                << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    // frames are corked with MSG_MORE instead of waiting on nagle;
+    int iOn = 1;
+    setsockopt(m_iSocket, IPPROTO_TCP, TCP_NODELAY, &iOn, sizeof(iOn));
+    if (m_param.iSendBufferBytes > 0) {
+        setsockopt(m_iSocket, SOL_SOCKET, SO_SNDBUF,
+                &m_param.iSendBufferBytes, sizeof(m_param.iSendBufferBytes));
+    }
+    if (m_param.iNotSentLowat > 0) {
+        setsockopt(m_iSocket, IPPROTO_TCP, TCP_NOTSENT_LOWAT,
+                &m_param.iNotSentLowat, sizeof(m_param.iNotSentLowat));
+    }
+    m_bZeroCopy = m_param.bZeroCopy && 0 == setsockopt(m_iSocket,
+            SOL_SOCKET, SO_ZEROCOPY, &iOn, sizeof(iOn));
+    if (m_param.bZeroCopy && !m_bZeroCopy) {
+        DMD_LOG_WARNING("CDmdTcpSender::connectSocket(), no SO_ZEROCOPY, "
+                << strerror(errno));
+    }
+
+    int ret = connect(m_iSocket,
+            reinterpret_cast<const struct sockaddr *>(&m_param.remoteAddr),
+            m_param.iRemoteAddrLen);
+    if (0 != ret && EINPROGRESS == errno) {
+        struct pollfd pfd = {m_iSocket, POLLOUT, 0};
+        int iError = ETIMEDOUT;
+        socklen_t iLen = sizeof(iError);
+        if (poll(&pfd, 1, DMD_TCP_CONNECT_TIMEOUT_MS) > 0) {
+            getsockopt(m_iSocket, SOL_SOCKET, SO_ERROR, &iError, &iLen);
+        }
+        errno = iError;
+        ret = 0 == iError ? 0 : -1;
+    }
+    if (0 != ret) {
+        DMD_LOG_ERROR("CDmdTcpSender::connectSocket(), connect failed, "
+                << strerror(errno));
+        close(m_iSocket);
+        m_iSocket = -1;
+        return DMD_S_FAIL;
+    }
+    DMD_LOG_INFO("CDmdTcpSender::connectSocket(), connected, zerocopy:"
+            << m_bZeroCopy);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdTcpSender::Uninit() {
+    if (m_iSocket >= 0) {
+        close(m_iSocket);
+        m_iSocket = -1;
+    }
+    // the connection is gone, no completion will come;
+    while (!m_queZeroCopy.empty()) {
+        DmdTcpFrame *pFrame = m_queZeroCopy.front().pFrame;
+        m_queZeroCopy.pop_front();
+        if (0 == --pFrame->iZeroCopyPending && pFrame->bRetired) {
+            recycleFrame(pFrame);
+        }
+    }
+    while (!m_queFrames.empty()) {
+        DmdTcpFrame *pFrame = m_queFrames.front();
+        m_queFrames.pop_front();
+        pFrame->iZeroCopyPending = 0;
+        recycleFrame(pFrame);
+    }
+    m_ulQueueBytes = 0;
+    return DMD_S_OK;
+}
+
+CDmdTcpSender::DmdTcpFrame *CDmdTcpSender::takeFrame() {
+    DmdTcpFrame *pFrame = NULL;
+    if (m_vecFreeFrames.empty()) {
+        pFrame = new DmdTcpFrame;
+        if (NULL == pFrame) {
+            DMD_LOG_ERROR("CDmdTcpSender::takeFrame(), "
+                    << "create frame failed");
+            return NULL;
+        }
+    } else {
+        pFrame = m_vecFreeFrames.back();
+        m_vecFreeFrames.pop_back();
+    }
+    pFrame->iTimestamp = 0;
+    pFrame->ulEnqueueUs = 0;
+    pFrame->bComplete = false;
+    pFrame->bReference = false;
+    pFrame->bKey = false;
+    pFrame->bZeroCopy = false;
+    pFrame->iPacketCount = 0;
+    pFrame->ulBytes = 0;
+    pFrame->ulSent = 0;
+    pFrame->iZeroCopyPending = 0;
+    pFrame->bRetired = false;
+    return pFrame;
+}
+
+void CDmdTcpSender::recycleFrame(DmdTcpFrame *pFrame) {
+    for (size_t i = 0; i < pFrame->vecBuffers.size(); i++) {
+        pFrame->vecBuffers[i]->Release();
+    }
+    pFrame->vecBuffers.clear();
+    pFrame->vecCopy.clear();
+    pFrame->vecChunks.clear();
+    m_vecFreeFrames.push_back(pFrame);
+}
+
+// written whole; kept while the kernel may still read its pages;
+void CDmdTcpSender::retireFrame(DmdTcpFrame *pFrame) {
+    m_stats.ulFrameCount++;
+    m_stats.ulPacketCount += pFrame->iPacketCount;
+    pFrame->bRetired = true;
+    if (0 == pFrame->iZeroCopyPending) {
+        recycleFrame(pFrame);
+    }
+}
+
+void CDmdTcpSender::addPacket(DmdTcpFrame *pFrame,
+        const DmdRtpPacket &packet) {
+    uint8_t arrFraming[DMD_TCP_FRAMING_SIZE] = {DMD_TCP_FRAMING_MAGIC,
+        m_param.iChannel, static_cast<uint8_t>(packet.ulSize >> 8),
+        static_cast<uint8_t>(packet.ulSize)};
+    DmdTcpChunk chunk = {NULL, pFrame->vecCopy.size(), sizeof(arrFraming)};
+    pFrame->vecCopy.insert(pFrame->vecCopy.end(), arrFraming,
+            arrFraming + sizeof(arrFraming));
+    for (unsigned int i = 0; i < packet.iIovCount; i++) {
+        const uint8_t *pData =
+            static_cast<const uint8_t *>(packet.pIov[i].iov_base);
+        size_t ulSize = packet.pIov[i].iov_len;
+        if (ulSize > DMD_TCP_COPY_MAX_BYTES && packet.pFrameBuffer) {
+            pFrame->vecChunks.push_back(chunk);
+            chunk.pData = pData;
+            chunk.ulSize = ulSize;
+            pFrame->vecChunks.push_back(chunk);
+            chunk.pData = NULL;
+            chunk.ulOffset = pFrame->vecCopy.size();
+            chunk.ulSize = 0;
+            continue;
+        }
+        // copied next to the framing, one gather entry for both;
+        pFrame->vecCopy.insert(pFrame->vecCopy.end(), pData, pData + ulSize);
+        chunk.ulSize += ulSize;
+    }
+    if (chunk.ulSize) {
+        pFrame->vecChunks.push_back(chunk);
+    }
+    if (packet.pFrameBuffer && (pFrame->vecBuffers.empty()
+                || pFrame->vecBuffers.back() != packet.pFrameBuffer)) {
+        packet.pFrameBuffer->AddRef();
+        pFrame->vecBuffers.push_back(packet.pFrameBuffer);
+    }
+
+    DmdRtpNalInfo nalInfo;
+    if (DMD_S_OK == DmdRtpGetNalInfo(packet, &nalInfo)) {
+        pFrame->bReference = pFrame->bReference || 0 != nalInfo.iNri;
+        pFrame->bKey = pFrame->bKey || DMD_H264_NAL_IDR == nalInfo.iNalType
+            || DMD_H264_NAL_SPS == nalInfo.iNalType;
+    } else {
+        pFrame->bReference = true;
+    }
+    pFrame->iPacketCount++;
+    pFrame->ulBytes += DMD_TCP_FRAMING_SIZE + packet.ulSize;
+    m_ulQueueBytes += DMD_TCP_FRAMING_SIZE + packet.ulSize;
+}
+
+DMD_RESULT CDmdTcpSender::EnqueuePackets(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, uint64_t ulNowUs) {
+    if (m_iSocket < 0 || (iPacketCount && NULL == pPackets)) {
+        return DMD_S_FAIL;
+    }
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        const DmdRtpPacket &packet = pPackets[i];
+        if (packet.ulSize > 0xffff) {
+            m_stats.ulErrorCount++;
+            continue;
+        }
+        if (m_bDiscarding && packet.iTimestamp == m_iDiscardTimestamp) {
+            continue;
+        }
+        m_bDiscarding = false;
+
+        DmdTcpFrame *pFrame = m_queFrames.empty() ? NULL : m_queFrames.back();
+        if (NULL == pFrame || pFrame->bComplete
+                || pFrame->iTimestamp != packet.iTimestamp) {
+            // after a flush, nothing but a key frame decodes;
+            DmdRtpNalInfo nalInfo;
+            if (m_bWaitKeyFrame) {
+                if (DMD_S_OK != DmdRtpGetNalInfo(packet, &nalInfo)
+                        || (DMD_H264_NAL_IDR != nalInfo.iNalType
+                            && DMD_H264_NAL_SPS != nalInfo.iNalType)) {
+                    m_bDiscarding = true;
+                    m_iDiscardTimestamp = packet.iTimestamp;
+                    m_stats.ulDroppedFrameCount++;
+                    continue;
+                }
+                m_bWaitKeyFrame = false;
+            }
+            pFrame = takeFrame();
+            if (NULL == pFrame) {
+                return DMD_S_FAIL;
+            }
+            pFrame->iTimestamp = packet.iTimestamp;
+            pFrame->ulEnqueueUs = ulNowUs;
+            m_queFrames.push_back(pFrame);
+        }
+        addPacket(pFrame, packet);
+        pFrame->bComplete = packet.bMarker;
+    }
+    m_stats.ulQueueBytes = m_ulQueueBytes;
+    return DMD_S_OK;
+}
+
+// a frame not started, the iterator then points past it;
+bool CDmdTcpSender::dropFrame(std::deque<DmdTcpFrame *>::iterator *pIt) {
+    DmdTcpFrame *pFrame = **pIt;
+    if (pFrame->ulSent) {
+        ++*pIt;
+        return false;
+    }
+    if (!pFrame->bComplete) {
+        // the rest of it is on the way;
+        m_bDiscarding = true;
+        m_iDiscardTimestamp = pFrame->iTimestamp;
+    }
+    m_ulQueueBytes -= pFrame->ulBytes;
+    recycleFrame(pFrame);
+    *pIt = m_queFrames.erase(*pIt);
+    return true;
+}
+
+void CDmdTcpSender::dropFrames(uint64_t ulNowUs) {
+    if (m_queFrames.empty()) {
+        return;
+    }
+    uint64_t ulDelayUs = ulNowUs > m_queFrames.front()->ulEnqueueUs
+        ? ulNowUs - m_queFrames.front()->ulEnqueueUs : 0;
+    if (ulDelayUs > m_stats.ulMaxQueueDelayUs) {
+        m_stats.ulMaxQueueDelayUs = ulDelayUs;
+    }
+    bool bFlush = ulDelayUs >= m_param.ulFlushDelayUs
+        || m_ulQueueBytes > m_param.ulMaxQueueBytes;
+    if (!bFlush && ulDelayUs < m_param.ulDropDelayUs) {
+        return;
+    }
+
+    std::deque<DmdTcpFrame *>::iterator it = m_queFrames.begin();
+    if (!bFlush) {
+        // nothing refers to these, the stream decodes without them;
+        while (it != m_queFrames.end()) {
+            if ((*it)->bReference || !(*it)->bComplete) {
+                ++it;
+            } else if (dropFrame(&it)) {
+                m_stats.ulDroppedNonRefCount++;
+            }
+        }
+        m_stats.ulQueueBytes = m_ulQueueBytes;
+        return;
+    }
+
+    // everything before the newest key frame not started;
+    size_t ulKey = m_queFrames.size();
+    for (size_t i = 0; i < m_queFrames.size(); i++) {
+        if (m_queFrames[i]->bKey && 0 == m_queFrames[i]->ulSent) {
+            ulKey = i;
+        }
+    }
+    if (ulKey == m_queFrames.size()) {
+        // no key frame to resume from, ask for one;
+        m_bWaitKeyFrame = true;
+        m_bKeyFrameRequest = true;
+    }
+    size_t ulDropped = 0;
+    for (size_t i = 0; i < ulKey; i++) {
+        if (dropFrame(&it)) {
+            ulDropped++;
+        }
+    }
+    m_stats.ulDroppedFrameCount += ulDropped;
+    m_stats.ulFlushCount++;
+    m_stats.ulQueueBytes = m_ulQueueBytes;
+    DMD_LOG_WARNING("CDmdTcpSender::dropFrames(), queue " << ulDelayUs
+            << "us, " << ulDropped << " frames flushed, "
+            << m_ulQueueBytes << " bytes left");
+}
+
+DMD_RESULT CDmdTcpSender::Flush(uint64_t ulNowUs) {
+    if (m_iSocket < 0) {
+        return DMD_S_FAIL;
+    }
+    dropFrames(ulNowUs);
+
+    while (!m_queFrames.empty()) {
+        DmdTcpFrame *pHead = m_queFrames.front();
+        if (pHead->ulSent == pHead->ulBytes) {
+            if (!pHead->bComplete) {
+                break;  // the rest of the frame is not here yet;
+            }
+            m_queFrames.pop_front();
+            retireFrame(pHead);
+            continue;
+        }
+        // the copy buffer of a frame still arriving may be reallocated
+        // while the kernel holds its pages, so such a frame copies;
+        if (0 == pHead->ulSent) {
+            pHead->bZeroCopy = m_bZeroCopy && pHead->bComplete
+                && pHead->ulBytes >= m_param.ulZeroCopyMinBytes;
+        }
+
+        // the unsent bytes of the head frame, and of the frames after it
+        // unless zerocopy, which completes per frame;
+        m_vecIov.clear();
+        size_t ulTotal = 0;
+        bool bFrameEnd = false;
+        for (size_t f = 0; f < m_queFrames.size(); f++) {
+            DmdTcpFrame *pFrame = m_queFrames[f];
+            if (f && (pHead->bZeroCopy || 0 != pFrame->ulSent)) {
+                break;
+            }
+            size_t ulSkip = pFrame->ulSent;
+            size_t c = 0;
+            for (; c < pFrame->vecChunks.size()
+                    && m_vecIov.size() < DMD_TCP_MAX_IOV; c++) {
+                const DmdTcpChunk &chunk = pFrame->vecChunks[c];
+                if (ulSkip >= chunk.ulSize) {
+                    ulSkip -= chunk.ulSize;
+                    continue;
+                }
+                const uint8_t *pData = chunk.pData ? chunk.pData
+                    : &pFrame->vecCopy[chunk.ulOffset];
+                struct iovec iov = {const_cast<uint8_t *>(pData + ulSkip),
+                    chunk.ulSize - ulSkip};
+                m_vecIov.push_back(iov);
+                ulTotal += iov.iov_len;
+                ulSkip = 0;
+            }
+            bFrameEnd = c == pFrame->vecChunks.size() && pFrame->bComplete;
+            if (!bFrameEnd) {
+                break;
+            }
+        }
+
+        // corked until the last bytes of a frame;
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &m_vecIov[0];
+        msg.msg_iovlen = m_vecIov.size();
+        int iFlags = MSG_DONTWAIT | MSG_NOSIGNAL | (bFrameEnd ? 0 : MSG_MORE);
+        if (pHead->bZeroCopy) {
+            iFlags |= MSG_ZEROCOPY;
+        }
+        ssize_t ret = sendmsg(m_iSocket, &msg, iFlags);
+        m_stats.ulSyscallCount++;
+        if (ret < 0 && ENOBUFS == errno && pHead->bZeroCopy) {
+            // out of optmem for pinned pages, this frame copies;
+            pHead->bZeroCopy = false;
+            continue;
+        }
+        if (ret < 0) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                m_stats.ulBlockedCount++;
+                break;
+            }
+            m_stats.ulErrorCount++;
+            DMD_LOG_ERROR("CDmdTcpSender::Flush(), sendmsg failed, "
+                    << strerror(errno));
+            return DMD_S_FAIL;
+        }
+        if (pHead->bZeroCopy) {
+            DmdTcpZeroCopy zeroCopy = {m_iZeroCopyNext++, pHead};
+            m_queZeroCopy.push_back(zeroCopy);
+            pHead->iZeroCopyPending++;
+            m_stats.ulZeroCopyCount++;
+        }
+
+        size_t ulWritten = static_cast<size_t>(ret);
+        m_stats.ulByteCount += ulWritten;
+        m_ulQueueBytes -= ulWritten;
+        while (ulWritten) {
+            DmdTcpFrame *pFrame = m_queFrames.front();
+            size_t ulTake = pFrame->ulBytes - pFrame->ulSent;
+            ulTake = ulTake < ulWritten ? ulTake : ulWritten;
+            pFrame->ulSent += ulTake;
+            ulWritten -= ulTake;
+            if (pFrame->ulSent == pFrame->ulBytes && pFrame->bComplete) {
+                m_queFrames.pop_front();
+                retireFrame(pFrame);
+            }
+        }
+        if (static_cast<size_t>(ret) < ulTotal) {
+            m_stats.ulBlockedCount++;
+            break;
+        }
+    }
+    m_stats.ulQueueBytes = m_ulQueueBytes;
+    return DMD_S_OK;
+}
+
+void CDmdTcpSender::completeZeroCopy(uint32_t iFirst, uint32_t iLast,
+        bool bCopied) {
+    std::deque<DmdTcpZeroCopy>::iterator it = m_queZeroCopy.begin();
+    while (it != m_queZeroCopy.end()) {
+        if (it->iId - iFirst > iLast - iFirst) {
+            ++it;
+            continue;
+        }
+        DmdTcpFrame *pFrame = it->pFrame;
+        it = m_queZeroCopy.erase(it);
+        if (bCopied) {
+            m_stats.ulZeroCopyCopiedCount++;
+        }
+        if (0 == --pFrame->iZeroCopyPending && pFrame->bRetired) {
+            recycleFrame(pFrame);
+        }
+    }
+    if (bCopied && m_bZeroCopy) {
+        // pinning pages only costs when the device copies anyway;
+        m_bZeroCopy = false;
+        DMD_LOG_INFO("CDmdTcpSender::completeZeroCopy(), the kernel "
+                << "copied, zerocopy off");
+    }
+}
+
+DMD_RESULT CDmdTcpSender::ReapCompletions() {
+    if (m_iSocket < 0) {
+        return DMD_S_FAIL;
+    }
+    while (!m_queZeroCopy.empty()) {
+        char arrControl[CMSG_SPACE(sizeof(struct sock_extended_err))
+            + CMSG_SPACE(sizeof(struct sockaddr_in6))];
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = arrControl;
+        msg.msg_controllen = sizeof(arrControl);
+        if (recvmsg(m_iSocket, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for (struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg); pCmsg;
+                pCmsg = CMSG_NXTHDR(&msg, pCmsg)) {
+            if (!(SOL_IP == pCmsg->cmsg_level
+                        && IP_RECVERR == pCmsg->cmsg_type)
+                    && !(SOL_IPV6 == pCmsg->cmsg_level
+                        && IPV6_RECVERR == pCmsg->cmsg_type)) {
+                continue;
+            }
+            const struct sock_extended_err *pError =
+                reinterpret_cast<const struct sock_extended_err *>(
+                        CMSG_DATA(pCmsg));
+            if (SO_EE_ORIGIN_ZEROCOPY == pError->ee_origin
+                    && 0 == pError->ee_errno) {
+                completeZeroCopy(pError->ee_info, pError->ee_data,
+                        0 != (pError->ee_code & SO_EE_CODE_ZEROCOPY_COPIED));
+            }
+        }
+    }
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdTcpSender::SendPackets(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, unsigned int *piSentCount) {
+    uint64_t ulNowUs = DmdGetTickCountUs();
+    if (!m_queZeroCopy.empty()) {
+        ReapCompletions();
+    }
+    DMD_RESULT ret = EnqueuePackets(pPackets, iPacketCount, ulNowUs);
+    if (DMD_S_OK == ret) {
+        ret = Flush(ulNowUs);
+    }
+    if (piSentCount) {
+        *piSentCount = DMD_S_OK == ret ? iPacketCount : 0;
+    }
+    return ret;
+}
+
+bool CDmdTcpSender::TakeKeyFrameRequest() {
+    bool bRequest = m_bKeyFrameRequest;
+    m_bKeyFrameRequest = false;
+    return bRequest;
+}
+
+void CDmdTcpSender::GetStats(DmdTcpSenderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,205 @@
+/*
+ ============================================================================
+ * Name        : CDmdTcpSender.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdTcpSender.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDTCPSENDER_H
+#define SRC_NETWORK_CDMDTCPSENDER_H
+
+#include <sys/socket.h>
+
+#include <deque>
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// rtsp interleaved framing, rfc 2326 section 10.12: '$', channel, length;
+#define DMD_TCP_FRAMING_MAGIC            0x24
+#define DMD_TCP_FRAMING_SIZE             4
+// iovecs per sendmsg(), IOV_MAX;
+#define DMD_TCP_MAX_IOV                  1024
+// gather entries this short are copied, headers from the packetizer's
+// arena; longer ones are referenced in the frame buffer;
+#define DMD_TCP_COPY_MAX_BYTES           64
+#define DMD_TCP_CONNECT_TIMEOUT_MS       3000
+#define DMD_TCP_DEFAULT_ZEROCOPY_BYTES   (64 * 1024)
+#define DMD_TCP_DEFAULT_NOTSENT_LOWAT    (64 * 1024)
+#define DMD_TCP_DEFAULT_DROP_DELAY_US    200000
+#define DMD_TCP_DEFAULT_FLUSH_DELAY_US   1000000
+#define DMD_TCP_DEFAULT_MAX_QUEUE_BYTES  (8 * 1024 * 1024)
+
+typedef struct {
+    struct sockaddr_storage remoteAddr;
+    socklen_t               iRemoteAddrLen;
+    uint8_t                 iChannel;            // interleaved channel;
+    bool                    bZeroCopy;           // MSG_ZEROCOPY if allowed;
+    // 0 picks the DMD_TCP_DEFAULT_* value, but for iSendBufferBytes;
+    size_t                  ulZeroCopyMinBytes;  // whole frames this large;
+    int                     iSendBufferBytes;    // 0 for the kernel's;
+    int                     iNotSentLowat;       // TCP_NOTSENT_LOWAT, <0 off;
+    uint64_t                ulDropDelayUs;       // non-reference dropped;
+    uint64_t                ulFlushDelayUs;      // up to a key frame;
+    size_t                  ulMaxQueueBytes;     // flushed beyond;
+} DmdTcpSenderParam;
+
+typedef struct {
+    uint64_t        ulFrameCount;        // whole frames written;
+    uint64_t        ulPacketCount;
+    uint64_t        ulByteCount;         // framing included;
+    uint64_t        ulSyscallCount;      // sendmsg();
+    uint64_t        ulBlockedCount;      // send buffer full;
+    uint64_t        ulDroppedNonRefCount;  // non-reference frames;
+    uint64_t        ulDroppedFrameCount;   // flushed, reference included;
+    uint64_t        ulFlushCount;
+    uint64_t        ulZeroCopyCount;     // MSG_ZEROCOPY sends;
+    uint64_t        ulZeroCopyCopiedCount;  // the kernel copied anyway;
+    uint64_t        ulQueueBytes;        // now;
+    uint64_t        ulMaxQueueDelayUs;
+    uint64_t        ulErrorCount;
+} DmdTcpSenderStats;
+
+/*
+ * Rtp over a tcp connection, for networks that block udp, framed as rtsp
+ * interleaved data. Packets are queued per frame and written with as few
+ * sendmsg() calls as their iovecs allow; TCP_NODELAY sends a frame's last
+ * bytes at once, and MSG_MORE on every write before them corks the frame
+ * so that its segments go out full. Large frames, key frames mostly, can
+ * go with MSG_ZEROCOPY if they are whole when their first bytes are
+ * written: the frame keeps its buffer references until the kernel
+ * reports completion on the error queue, ReapCompletions(); it is turned
+ * off once the kernel reports it copied anyway, as on loopback.
+ *
+ * Tcp never drops, so a congested link would grow the queue, and the
+ * latency, without bound. Frames not started are dropped instead once the
+ * oldest waits ulDropDelayUs, non-reference ones only, and beyond
+ * ulFlushDelayUs or ulMaxQueueBytes every frame up to the newest key
+ * frame; if none is queued, the stream resumes at the next key frame,
+ * which TakeKeyFrameRequest() asks for. TCP_NOTSENT_LOWAT keeps the
+ * kernel's share of the backlog small, where nothing can be dropped.
+ * Runs on the sending thread.
+ */
+class CDmdTcpSender : public IDmdRtpPacketSink {
+public:
+    CDmdTcpSender();
+    ~CDmdTcpSender();
+
+    DMD_RESULT Init(const DmdTcpSenderParam &senderParam);
+    DMD_RESULT Uninit();
+
+    // IDmdRtpPacketSink interface, queued and written as far as the
+    // socket takes;
+    DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount = NULL);
+    DMD_RESULT EnqueuePackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, uint64_t ulNowUs);
+    // writes queued frames until the socket blocks; poll GetSocket() for
+    // POLLOUT while HasPending();
+    DMD_RESULT Flush(uint64_t ulNowUs);
+    // MSG_ZEROCOPY completions, on POLLERR;
+    DMD_RESULT ReapCompletions();
+
+    bool HasPending() const {return !m_queFrames.empty();}
+    bool TakeKeyFrameRequest();
+    int GetSocket() const {return m_iSocket;}
+    bool IsZeroCopyEnabled() const {return m_bZeroCopy;}
+    void GetStats(DmdTcpSenderStats *pStats) const;
+
+private:
+    // a gather entry, in the frame's copy buffer or a frame buffer;
+    typedef struct {
+        const uint8_t  *pData;           // NULL if copied;
+        size_t          ulOffset;        // into vecCopy, if copied;
+        size_t          ulSize;
+    } DmdTcpChunk;
+
+    typedef struct {
+        uint32_t                        iTimestamp;
+        uint64_t                        ulEnqueueUs;
+        bool                            bComplete;   // marker seen;
+        bool                            bReference;
+        bool                            bKey;
+        bool                            bZeroCopy;
+        unsigned int                    iPacketCount;
+        size_t                          ulBytes;
+        size_t                          ulSent;
+        unsigned int                    iZeroCopyPending;
+        bool                            bRetired;    // written whole;
+        std::vector<uint8_t>            vecCopy;
+        std::vector<DmdTcpChunk>        vecChunks;
+        std::vector<IDmdFrameBuffer *>  vecBuffers;  // referenced;
+    } DmdTcpFrame;
+
+    typedef struct {
+        uint32_t        iId;
+        DmdTcpFrame    *pFrame;
+    } DmdTcpZeroCopy;
+
+    DMD_RESULT connectSocket();
+    DmdTcpFrame *takeFrame();
+    void recycleFrame(DmdTcpFrame *pFrame);
+    void retireFrame(DmdTcpFrame *pFrame);
+    void addPacket(DmdTcpFrame *pFrame, const DmdRtpPacket &packet);
+    void dropFrames(uint64_t ulNowUs);
+    bool dropFrame(std::deque<DmdTcpFrame *>::iterator *pIt);
+    void completeZeroCopy(uint32_t iFirst, uint32_t iLast, bool bCopied);
+
+private:
+    DmdTcpSenderParam              m_param;
+    int                            m_iSocket;
+    bool                           m_bZeroCopy;
+    uint32_t                       m_iZeroCopyNext;   // kernel's counter;
+    bool                           m_bWaitKeyFrame;
+    bool                           m_bDiscarding;     // rest of a frame;
+    uint32_t                       m_iDiscardTimestamp;
+    bool                           m_bKeyFrameRequest;
+    size_t                         m_ulQueueBytes;
+
+    std::deque<DmdTcpFrame *>      m_queFrames;       // oldest first;
+    std::deque<DmdTcpZeroCopy>     m_queZeroCopy;     // by id;
+    std::vector<DmdTcpFrame *>     m_vecFreeFrames;   // capacity kept;
+    std::vector<struct iovec>      m_vecIov;
+
+    DmdTcpSenderStats              m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDTCPSENDER_H
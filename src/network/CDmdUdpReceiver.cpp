@@ -0,0 +1,356 @@
+/*
+ ============================================================================
+ * Name        : CDmdUdpReceiver.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdUdpReceiver.cpp
+ ============================================================================
+ */
+
+#include "CDmdUdpReceiver.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+// submissions per io_uring_enter(), the multishot arms of a poll;
+#define DMD_UDP_RECV_URING_ENTRIES  256
+
+CDmdUdpReceiver::CDmdUdpReceiver() : m_pSink(NULL),
+        m_eBackend(DmdUdpRecvEpoll), m_iEpoll(-1) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_msgMultishot, 0, sizeof(m_msgMultishot));
+    memset(m_arrMsgs, 0, sizeof(m_arrMsgs));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdUdpReceiver::~CDmdUdpReceiver() {
+    Uninit();
+}
+
+DMD_RESULT CDmdUdpReceiver::Init(const DmdUdpReceiverParam &receiverParam,
+        IDmdDatagramSink *pSink) {
+    Uninit();
+    unsigned int iBufferCount = receiverParam.iBufferCount;
+    if (NULL == pSink || (iBufferCount & (iBufferCount - 1))) {
+        DMD_LOG_ERROR("CDmdUdpReceiver::Init(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_param = receiverParam;
+    if (0 == m_param.iBufferCount) {
+        m_param.iBufferCount = DMD_UDP_RECV_DEFAULT_BUFFERS;
+    }
+    m_pSink = pSink;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    bool bMultishot = DmdUringMultishot == CDmdUring::ProbeLevel();
+    m_eBackend = DmdUdpRecvEpoll;
+    if (DmdUdpRecvEpoll != m_param.eBackend && bMultishot
+            && DMD_S_OK == initUring()) {
+        m_eBackend = DmdUdpRecvUring;
+    } else if (DmdUdpRecvUring == m_param.eBackend) {
+        DMD_LOG_WARNING("CDmdUdpReceiver::Init(), no multishot io_uring, "
+                << "epoll instead");
+    }
+
+    if (DmdUdpRecvEpoll == m_eBackend) {
+        m_iEpoll = epoll_create1(EPOLL_CLOEXEC);
+        if (m_iEpoll < 0) {
+            DMD_LOG_ERROR("CDmdUdpReceiver::Init(), epoll_create1 failed, "
+                    << strerror(errno));
+            return DMD_S_FAIL;
+        }
+        m_vecBuffer.resize(DMD_UDP_RECV_MAX_BATCH * DMD_UDP_RECV_BUFFER_SIZE);
+        for (unsigned int i = 0; i < DMD_UDP_RECV_MAX_BATCH; i++) {
+            m_arrIov[i].iov_base = &m_vecBuffer[i * DMD_UDP_RECV_BUFFER_SIZE];
+            m_arrIov[i].iov_len = DMD_UDP_RECV_BUFFER_SIZE;
+        }
+    }
+    DMD_LOG_INFO("CDmdUdpReceiver::Init(), backend = " << m_eBackend);
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpReceiver::initUring() {
+    if (DMD_S_OK != m_uring.Init(DMD_UDP_RECV_URING_ENTRIES,
+                2 * m_param.iBufferCount)
+            || DMD_S_OK != m_uring.SetupBuffers(DMD_UDP_RECV_BUFFER_GROUP,
+                m_param.iBufferCount, DMD_UDP_RECV_BUFFER_SIZE)) {
+        m_uring.Uninit();
+        return DMD_S_FAIL;
+    }
+    // every buffer starts with io_uring_recvmsg_out, then the name area;
+    m_msgMultishot.msg_namelen = sizeof(struct sockaddr_in6);
+    m_msgMultishot.msg_controllen = 0;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpReceiver::Uninit() {
+    m_uring.Uninit();
+    if (m_iEpoll >= 0) {
+        close(m_iEpoll);
+        m_iEpoll = -1;
+    }
+    m_vecSockets.clear();
+    m_pSink = NULL;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpReceiver::AddSocket(int iSocket, int iStreamId) {
+    if (NULL == m_pSink || iSocket < 0) {
+        DMD_LOG_ERROR("CDmdUdpReceiver::AddSocket(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    int iFlags = fcntl(iSocket, F_GETFL);
+    fcntl(iSocket, F_SETFL, iFlags | O_NONBLOCK);
+    if (m_param.iReceiveBufferBytes > 0) {
+        setsockopt(iSocket, SOL_SOCKET, SO_RCVBUF,
+                &m_param.iReceiveBufferBytes,
+                sizeof(m_param.iReceiveBufferBytes));
+    }
+    if (DmdUdpRecvEpoll == m_eBackend) {
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u32 = static_cast<uint32_t>(m_vecSockets.size());
+        if (0 != epoll_ctl(m_iEpoll, EPOLL_CTL_ADD, iSocket, &event)) {
+            DMD_LOG_ERROR("CDmdUdpReceiver::AddSocket(), epoll_ctl failed, "
+                    << strerror(errno));
+            return DMD_S_FAIL;
+        }
+    }
+    // armed by the next Poll();
+    DmdUdpRecvSocket socket = {iSocket, iStreamId, false};
+    m_vecSockets.push_back(socket);
+    return DMD_S_OK;
+}
+
+void CDmdUdpReceiver::deliver(unsigned int iCount) {
+    if (0 == iCount) {
+        return;
+    }
+    for (unsigned int i = 0; i < iCount; i++) {
+        m_stats.ulByteCount += m_arrDatagrams[i].ulSize;
+        if (m_arrDatagrams[i].bTruncated) {
+            m_stats.ulTruncatedCount++;
+        }
+    }
+    m_stats.ulDatagramCount += iCount;
+    m_stats.ulDeliverCount++;
+    m_pSink->OnDatagrams(m_arrDatagrams, iCount);
+}
+
+void CDmdUdpReceiver::drainSocket(const DmdUdpRecvSocket &socket) {
+    while (true) {
+        for (unsigned int i = 0; i < DMD_UDP_RECV_MAX_BATCH; i++) {
+            struct msghdr *pMsg = &m_arrMsgs[i].msg_hdr;
+            pMsg->msg_name = &m_arrAddrs[i];
+            pMsg->msg_namelen = sizeof(m_arrAddrs[i]);
+            pMsg->msg_iov = &m_arrIov[i];
+            pMsg->msg_iovlen = 1;
+            pMsg->msg_control = NULL;
+            pMsg->msg_controllen = 0;
+            pMsg->msg_flags = 0;
+        }
+        m_stats.ulSyscallCount++;
+        int iCount = recvmmsg(socket.iSocket, m_arrMsgs,
+                DMD_UDP_RECV_MAX_BATCH, MSG_DONTWAIT, NULL);
+        if (iCount <= 0) {
+            if (iCount < 0 && EAGAIN != errno && EWOULDBLOCK != errno) {
+                m_stats.ulErrorCount++;
+                DMD_LOG_WARNING("CDmdUdpReceiver::drainSocket(), "
+                        << "recvmmsg failed, " << strerror(errno));
+            }
+            return;
+        }
+        for (int i = 0; i < iCount; i++) {
+            const struct msghdr &msg = m_arrMsgs[i].msg_hdr;
+            DmdDatagram &datagram = m_arrDatagrams[i];
+            datagram.iStreamId = socket.iStreamId;
+            datagram.pData = static_cast<const uint8_t *>(
+                    m_arrIov[i].iov_base);
+            datagram.ulSize = m_arrMsgs[i].msg_len;
+            datagram.bTruncated = 0 != (msg.msg_flags & MSG_TRUNC);
+            datagram.pSrcAddr =
+                reinterpret_cast<const struct sockaddr *>(&m_arrAddrs[i]);
+            datagram.iSrcAddrLen = msg.msg_namelen;
+        }
+        deliver(iCount);
+        if (iCount < DMD_UDP_RECV_MAX_BATCH) {
+            return;  // drained, no call to find it empty;
+        }
+    }
+}
+
+DMD_RESULT CDmdUdpReceiver::pollEpoll(int iTimeoutMs) {
+    struct epoll_event arrEvents[DMD_UDP_RECV_MAX_BATCH];
+    m_stats.ulSyscallCount++;
+    int iCount = epoll_wait(m_iEpoll, arrEvents, DMD_UDP_RECV_MAX_BATCH,
+            iTimeoutMs);
+    if (iCount < 0) {
+        if (EINTR == errno) {
+            return DMD_S_OK;
+        }
+        DMD_LOG_ERROR("CDmdUdpReceiver::pollEpoll(), epoll_wait failed, "
+                << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    for (int i = 0; i < iCount; i++) {
+        drainSocket(m_vecSockets[arrEvents[i].data.u32]);
+    }
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpReceiver::armUring(unsigned int iIndex) {
+    struct io_uring_sqe *pSqe = m_uring.GetSqe();
+    if (NULL == pSqe) {
+        return DMD_S_FAIL;  // the ring is full, next poll;
+    }
+    pSqe->opcode = IORING_OP_RECVMSG;
+    pSqe->fd = m_vecSockets[iIndex].iSocket;
+    pSqe->addr = reinterpret_cast<uint64_t>(&m_msgMultishot);
+    pSqe->len = 1;
+    pSqe->ioprio = IORING_RECV_MULTISHOT;
+    pSqe->flags = IOSQE_BUFFER_SELECT;
+    pSqe->buf_group = DMD_UDP_RECV_BUFFER_GROUP;
+    pSqe->user_data = iIndex;
+    m_vecSockets[iIndex].bArmed = true;
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpReceiver::pollUring(int iTimeoutMs) {
+    for (unsigned int i = 0; i < m_vecSockets.size(); i++) {
+        if (!m_vecSockets[i].bArmed && DMD_S_OK != armUring(i)) {
+            break;
+        }
+    }
+    // nothing to submit and completions waiting, no syscall at all;
+    if (m_uring.GetPendingSqes() || NULL == m_uring.PeekCqe()) {
+        bool bWait = NULL == m_uring.PeekCqe();
+        int64_t lTimeoutUs = iTimeoutMs < 0 ? -1
+            : static_cast<int64_t>(iTimeoutMs) * 1000;
+        m_stats.ulSyscallCount++;
+        int ret = m_uring.Enter(bWait ? 1 : 0, lTimeoutUs);
+        if (ret < 0 && -ETIME != ret) {
+            DMD_LOG_ERROR("CDmdUdpReceiver::pollUring(), io_uring_enter "
+                    << "failed, " << strerror(-ret));
+            return DMD_S_FAIL;
+        }
+    }
+
+    const size_t ulHeader = sizeof(struct io_uring_recvmsg_out)
+        + m_msgMultishot.msg_namelen + m_msgMultishot.msg_controllen;
+    unsigned int iCount = 0;
+    struct io_uring_cqe *pCqe = NULL;
+    while (NULL != (pCqe = m_uring.PeekCqe())) {
+        DmdUdpRecvSocket &socket = m_vecSockets[pCqe->user_data];
+        int iResult = pCqe->res;
+        uint32_t iFlags = pCqe->flags;
+        m_uring.SeenCqe();
+        if (!(iFlags & IORING_CQE_F_MORE)) {
+            // ended, by an error or an empty buffer ring;
+            socket.bArmed = false;
+            m_stats.ulRearmCount++;
+        }
+        if (iResult < 0) {
+            if (-ENOBUFS == iResult) {
+                m_stats.ulNoBufferCount++;
+            } else {
+                m_stats.ulErrorCount++;
+                DMD_LOG_WARNING("CDmdUdpReceiver::pollUring(), recvmsg "
+                        << "failed, " << strerror(-iResult));
+            }
+            continue;
+        }
+        if (!(iFlags & IORING_CQE_F_BUFFER)) {
+            continue;
+        }
+        uint16_t iBufferId =
+            static_cast<uint16_t>(iFlags >> IORING_CQE_BUFFER_SHIFT);
+        const uint8_t *pBuffer = m_uring.GetBuffer(iBufferId);
+        const struct io_uring_recvmsg_out *pOut =
+            reinterpret_cast<const struct io_uring_recvmsg_out *>(pBuffer);
+        size_t ulCapacity = m_uring.GetBufferSize() - ulHeader;
+        DmdDatagram &datagram = m_arrDatagrams[iCount];
+        datagram.iStreamId = socket.iStreamId;
+        datagram.pData = pBuffer + ulHeader;
+        datagram.ulSize = pOut->payloadlen < ulCapacity
+            ? pOut->payloadlen : ulCapacity;
+        datagram.bTruncated = 0 != (pOut->flags & MSG_TRUNC);
+        datagram.pSrcAddr = reinterpret_cast<const struct sockaddr *>(
+                pBuffer + sizeof(*pOut));
+        datagram.iSrcAddrLen = pOut->namelen < m_msgMultishot.msg_namelen
+            ? pOut->namelen : m_msgMultishot.msg_namelen;
+        m_arrBufferIds[iCount++] = iBufferId;
+        if (DMD_UDP_RECV_MAX_BATCH == iCount) {
+            deliver(iCount);
+            for (unsigned int i = 0; i < iCount; i++) {
+                m_uring.RecycleBuffer(m_arrBufferIds[i]);
+            }
+            iCount = 0;
+        }
+    }
+    deliver(iCount);
+    for (unsigned int i = 0; i < iCount; i++) {
+        m_uring.RecycleBuffer(m_arrBufferIds[i]);
+    }
+    m_uring.CommitBuffers();
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpReceiver::Poll(int iTimeoutMs) {
+    if (NULL == m_pSink) {
+        DMD_LOG_ERROR("CDmdUdpReceiver::Poll(), not initialized");
+        return DMD_S_FAIL;
+    }
+    uint64_t ulCpuStart = DmdGetThreadCpuTimeUs();
+    DMD_RESULT ret = DmdUdpRecvUring == m_eBackend ? pollUring(iTimeoutMs)
+        : pollEpoll(iTimeoutMs);
+    m_stats.ulRecvCpuUs += DmdGetThreadCpuTimeUs() - ulCpuStart;
+    return ret;
+}
+
+void CDmdUdpReceiver::GetStats(DmdUdpReceiverStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
@@ -0,0 +1,168 @@
+/*
+ ============================================================================
+ * Name        : CDmdUdpReceiver.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdUdpReceiver.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDUDPRECEIVER_H
+#define SRC_NETWORK_CDMDUDPRECEIVER_H
+
+#include <sys/socket.h>
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "CDmdUring.h"
+
+namespace opendmd {
+
+// datagrams per recvmmsg() and per delivery;
+#define DMD_UDP_RECV_MAX_BATCH        64
+// a datagram of DMD_RTP_DEFAULT_MTU, with the multishot header and the
+// source address in front;
+#define DMD_UDP_RECV_BUFFER_SIZE      2048
+#define DMD_UDP_RECV_DEFAULT_BUFFERS  4096
+#define DMD_UDP_RECV_BUFFER_GROUP     0
+
+typedef enum {
+    DmdUdpRecvAuto = 0,   // io_uring where the kernel has multishot;
+    DmdUdpRecvEpoll,      // epoll_wait(), then recvmmsg() per socket;
+    DmdUdpRecvUring,      // multishot recvmsg() from a buffer ring;
+} DmdUdpRecvBackend;
+
+typedef struct {
+    int                     iStreamId;     // of AddSocket();
+    const uint8_t          *pData;
+    size_t                  ulSize;
+    bool                    bTruncated;    // longer than the buffer;
+    const struct sockaddr  *pSrcAddr;
+    socklen_t               iSrcAddrLen;
+} DmdDatagram;
+
+class IDmdDatagramSink {
+public:
+    IDmdDatagramSink() {}
+    virtual ~IDmdDatagramSink() {}
+    // the datagrams are valid during the call only;
+    virtual void OnDatagrams(const DmdDatagram *pDatagrams,
+            unsigned int iCount) = 0;
+};
+
+typedef struct {
+    DmdUdpRecvBackend       eBackend;
+    unsigned int            iBufferCount;       // io_uring, a power of two;
+    int                     iReceiveBufferBytes;  // SO_RCVBUF, 0 default;
+} DmdUdpReceiverParam;
+
+typedef struct {
+    uint64_t        ulDatagramCount;
+    uint64_t        ulByteCount;
+    uint64_t        ulSyscallCount;
+    uint64_t        ulDeliverCount;      // OnDatagrams();
+    uint64_t        ulTruncatedCount;
+    uint64_t        ulNoBufferCount;     // multishot ended, ring empty;
+    uint64_t        ulRearmCount;
+    uint64_t        ulErrorCount;
+    uint64_t        ulRecvCpuUs;         // calling thread, in Poll();
+} DmdUdpReceiverStats;
+
+/*
+ * Receives the udp sockets of many streams on one thread, as a server
+ * with hundreds of cameras does. With epoll, a wakeup costs epoll_wait()
+ * and at least one recvmmsg() per ready socket.
+ * With io_uring, every socket has one multishot recvmsg armed that lands
+ * datagrams in buffers of a provided ring, so a single io_uring_enter()
+ * waits for, and returns, the datagrams of all sockets; buffers go back
+ * to the ring after delivery. DmdUdpRecvAuto takes io_uring only where
+ * CDmdUring::ProbeLevel() finds multishot support, epoll otherwise.
+ */
+class CDmdUdpReceiver {
+public:
+    CDmdUdpReceiver();
+    ~CDmdUdpReceiver();
+
+    DMD_RESULT Init(const DmdUdpReceiverParam &receiverParam,
+            IDmdDatagramSink *pSink);
+    DMD_RESULT Uninit();
+
+    // a bound udp socket, made non-blocking, still owned by the caller;
+    DMD_RESULT AddSocket(int iSocket, int iStreamId);
+    // waits up to iTimeoutMs, -1 for no limit, and delivers whatever
+    // arrived;
+    DMD_RESULT Poll(int iTimeoutMs);
+
+    DmdUdpRecvBackend GetBackend() const {return m_eBackend;}
+    void GetStats(DmdUdpReceiverStats *pStats) const;
+
+private:
+    typedef struct {
+        int             iSocket;
+        int             iStreamId;
+        bool            bArmed;          // multishot running;
+    } DmdUdpRecvSocket;
+
+    DMD_RESULT initUring();
+    DMD_RESULT armUring(unsigned int iIndex);
+    DMD_RESULT pollEpoll(int iTimeoutMs);
+    DMD_RESULT pollUring(int iTimeoutMs);
+    void drainSocket(const DmdUdpRecvSocket &socket);
+    void deliver(unsigned int iCount);
+
+private:
+    DmdUdpReceiverParam             m_param;
+    IDmdDatagramSink               *m_pSink;
+    DmdUdpRecvBackend               m_eBackend;
+    int                             m_iEpoll;
+    std::vector<DmdUdpRecvSocket>   m_vecSockets;
+
+    CDmdUring                       m_uring;
+    struct msghdr                   m_msgMultishot;  // layout template;
+
+    // one recvmmsg() batch, and the datagrams of one delivery;
+    struct mmsghdr                  m_arrMsgs[DMD_UDP_RECV_MAX_BATCH];
+    struct iovec                    m_arrIov[DMD_UDP_RECV_MAX_BATCH];
+    struct sockaddr_storage         m_arrAddrs[DMD_UDP_RECV_MAX_BATCH];
+    std::vector<uint8_t>            m_vecBuffer;
+    DmdDatagram                     m_arrDatagrams[DMD_UDP_RECV_MAX_BATCH];
+    uint16_t                        m_arrBufferIds[DMD_UDP_RECV_MAX_BATCH];
+
+    DmdUdpReceiverStats             m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDUDPRECEIVER_H
@@ -0,0 +1,372 @@
+/*
+ ============================================================================
+ * Name        : CDmdUdpSender.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : batched udp sender, sendmmsg, udp gso and io_uring.
+ ============================================================================
+ */
+
+#include "CDmdUdpSender.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+namespace opendmd {
+
+// iovecs of one batch, a gso run takes those of all its packets;
+#define DMD_UDP_BATCH_IOV   (DMD_UDP_MAX_BATCH * 8)
+#define DMD_UDP_CONTROL_LEN CMSG_SPACE(sizeof(uint16_t))
+
+CDmdUdpSender::CDmdUdpSender() : m_iSocket(-1), m_bGsoEnabled(false),
+        m_bUringEnabled(false) {
+    memset(&m_param, 0, sizeof(m_param));
+    memset(&m_stats, 0, sizeof(m_stats));
+    memset(m_arrMsgs, 0, sizeof(m_arrMsgs));
+}
+
+CDmdUdpSender::~CDmdUdpSender() {
+    Uninit();
+}
+
+DMD_RESULT CDmdUdpSender::Init(const DmdUdpSenderParam &senderParam) {
+    Uninit();
+    m_param = senderParam;
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    m_iSocket = socket(m_param.remoteAddr.ss_family,
+            SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (m_iSocket < 0) {
+        DMD_LOG_ERROR("CDmdUdpSender::Init(), socket failed, "
+                << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    if (m_param.iSendBufferBytes > 0) {
+        setsockopt(m_iSocket, SOL_SOCKET, SO_SNDBUF,
+                &m_param.iSendBufferBytes, sizeof(m_param.iSendBufferBytes));
+    }
+    // connected, so messages need no address and the route is cached;
+    if (0 != connect(m_iSocket,
+                reinterpret_cast<struct sockaddr *>(&m_param.remoteAddr),
+                m_param.iRemoteAddrLen)) {
+        DMD_LOG_ERROR("CDmdUdpSender::Init(), connect failed, "
+                << strerror(errno));
+        Uninit();
+        return DMD_S_FAIL;
+    }
+
+    m_bGsoEnabled = (DmdUdpSendGso == m_param.eMode
+            || DmdUdpSendUring == m_param.eMode) && probeGso();
+    m_bUringEnabled = DmdUdpSendUring == m_param.eMode
+        && DmdUringNone != CDmdUring::ProbeLevel()
+        && DMD_S_OK == m_uring.Init(DMD_UDP_MAX_BATCH);
+    if (DmdUdpSendUring == m_param.eMode && !m_bUringEnabled) {
+        DMD_LOG_WARNING("CDmdUdpSender::Init(), no io_uring, sendmmsg "
+                << "instead");
+    }
+    m_vecIov.resize(DMD_UDP_BATCH_IOV);
+    m_vecControl.assign(DMD_UDP_MAX_BATCH * DMD_UDP_CONTROL_LEN, 0);
+    DMD_LOG_INFO("CDmdUdpSender::Init(), mode = " << m_param.eMode
+            << ", gso = " << m_bGsoEnabled << ", io_uring = "
+            << m_bUringEnabled);
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpSender::Uninit() {
+    if (m_iSocket >= 0) {
+        close(m_iSocket);
+        m_iSocket = -1;
+    }
+    m_bGsoEnabled = false;
+    m_bUringEnabled = false;
+    m_uring.Uninit();
+    return DMD_S_OK;
+}
+
+bool CDmdUdpSender::probeGso() {
+    int iSegment = 0;
+    socklen_t iLen = sizeof(iSegment);
+    if (0 != getsockopt(m_iSocket, SOL_UDP, UDP_SEGMENT, &iSegment, &iLen)) {
+        DMD_LOG_WARNING("CDmdUdpSender::probeGso(), udp gso unsupported, "
+                << strerror(errno) << ", batching only");
+        return false;
+    }
+    return true;
+}
+
+// packets at the head that go out as one gso message: all of the same
+// size, except that the last may be shorter;
+unsigned int CDmdUdpSender::gsoRunLength(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount) {
+    size_t ulSegment = pPackets[0].ulSize;
+    size_t ulBytes = ulSegment;
+    unsigned int iIovCount = pPackets[0].iIovCount;
+    unsigned int iRun = 1;
+    while (iRun < iPacketCount && iRun < DMD_UDP_MAX_GSO_SEGMENTS) {
+        const DmdRtpPacket &packet = pPackets[iRun];
+        if (packet.ulSize > ulSegment
+                || ulBytes + packet.ulSize > DMD_UDP_MAX_GSO_BYTES
+                || iIovCount + packet.iIovCount > DMD_UDP_BATCH_IOV) {
+            break;
+        }
+        ulBytes += packet.ulSize;
+        iIovCount += packet.iIovCount;
+        iRun++;
+        if (packet.ulSize < ulSegment) {
+            break;
+        }
+    }
+    return iRun;
+}
+
+DMD_RESULT CDmdUdpSender::sendEach(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, unsigned int *piSentCount) {
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        msg.msg_iov = const_cast<struct iovec *>(pPackets[i].pIov);
+        msg.msg_iovlen = pPackets[i].iIovCount;
+        m_stats.ulSyscallCount++;
+        if (sendmsg(m_iSocket, &msg, 0) < 0) {
+            if (EAGAIN == errno || EWOULDBLOCK == errno || ENOBUFS == errno) {
+                m_stats.ulDroppedCount += iPacketCount - i;
+                return DMD_S_OK;
+            }
+            // icmp errors of a connected socket surface on a later send;
+            m_stats.ulErrorCount++;
+            DMD_LOG_WARNING("CDmdUdpSender::sendEach(), sendmsg failed, "
+                    << strerror(errno));
+            continue;
+        }
+        (*piSentCount)++;
+        m_stats.ulPacketCount++;
+        m_stats.ulByteCount += pPackets[i].ulSize;
+    }
+    return DMD_S_OK;
+}
+
+// the batch as one chain of linked sendmsg entries, one io_uring_enter()
+// that waits for all of them; returns as sendmmsg() does, the messages
+// sent before the first failure, or -1 with errno if the first failed;
+int CDmdUdpSender::sendUring(unsigned int iMsgCount) {
+    for (unsigned int i = 0; i < iMsgCount; i++) {
+        struct io_uring_sqe *pSqe = m_uring.GetSqe();
+        pSqe->opcode = IORING_OP_SENDMSG;
+        pSqe->fd = m_iSocket;
+        pSqe->addr = reinterpret_cast<uint64_t>(&m_arrMsgs[i].msg_hdr);
+        pSqe->len = 1;
+        // a full send buffer fails at once instead of waiting on poll;
+        pSqe->msg_flags = MSG_DONTWAIT;
+        pSqe->flags = i + 1 < iMsgCount ? IOSQE_IO_LINK : 0;
+        pSqe->user_data = i;
+    }
+    int ret = m_uring.Enter(iMsgCount, -1);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    int iResult[DMD_UDP_MAX_BATCH];
+    unsigned int iReaped = 0;
+    while (iReaped < iMsgCount) {
+        struct io_uring_cqe *pCqe = m_uring.PeekCqe();
+        if (NULL == pCqe) {
+            // woken early, all of the chain completes before long;
+            m_uring.Enter(iMsgCount - iReaped, -1);
+            continue;
+        }
+        iResult[pCqe->user_data] = pCqe->res;
+        m_uring.SeenCqe();
+        iReaped++;
+    }
+    for (unsigned int i = 0; i < iMsgCount; i++) {
+        if (iResult[i] < 0) {
+            errno = -iResult[i];
+            return i > 0 ? static_cast<int>(i) : -1;
+        }
+    }
+    return static_cast<int>(iMsgCount);
+}
+
+DMD_RESULT CDmdUdpSender::sendBatched(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, unsigned int *piSentCount) {
+    unsigned int iNext = 0;
+    while (iNext < iPacketCount) {
+        // fill one batch;
+        unsigned int iMsgCount = 0;
+        unsigned int iIovUsed = 0;
+        unsigned int iPacket = iNext;
+        while (iPacket < iPacketCount && iMsgCount < DMD_UDP_MAX_BATCH) {
+            const DmdRtpPacket *pPacket = &pPackets[iPacket];
+            struct msghdr *pMsg = &m_arrMsgs[iMsgCount].msg_hdr;
+            memset(pMsg, 0, sizeof(*pMsg));
+            unsigned int iRun = m_bGsoEnabled
+                ? gsoRunLength(pPacket, iPacketCount - iPacket) : 1;
+            if (iRun > 1) {
+                unsigned int iIovCount = 0;
+                for (unsigned int i = 0; i < iRun; i++) {
+                    iIovCount += pPacket[i].iIovCount;
+                }
+                if (iIovUsed + iIovCount > DMD_UDP_BATCH_IOV) {
+                    break;  // goes first in the next batch;
+                }
+                // the iovecs of a run are laid out back to back;
+                struct iovec *pIov = &m_vecIov[iIovUsed];
+                for (unsigned int i = 0; i < iRun; i++) {
+                    memcpy(pIov, pPacket[i].pIov,
+                            pPacket[i].iIovCount * sizeof(struct iovec));
+                    pIov += pPacket[i].iIovCount;
+                }
+                pMsg->msg_iov = &m_vecIov[iIovUsed];
+                pMsg->msg_iovlen = iIovCount;
+                iIovUsed += iIovCount;
+
+                uint8_t *pControl = &m_vecControl[iMsgCount
+                    * DMD_UDP_CONTROL_LEN];
+                memset(pControl, 0, DMD_UDP_CONTROL_LEN);
+                pMsg->msg_control = pControl;
+                pMsg->msg_controllen = DMD_UDP_CONTROL_LEN;
+                struct cmsghdr *pCmsg = CMSG_FIRSTHDR(pMsg);
+                pCmsg->cmsg_level = SOL_UDP;
+                pCmsg->cmsg_type = UDP_SEGMENT;
+                pCmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t iSegment = static_cast<uint16_t>(pPacket->ulSize);
+                memcpy(CMSG_DATA(pCmsg), &iSegment, sizeof(iSegment));
+            } else {
+                // a single packet uses the packetizer's iovecs as they are;
+                pMsg->msg_iov = const_cast<struct iovec *>(pPacket->pIov);
+                pMsg->msg_iovlen = pPacket->iIovCount;
+            }
+            m_arrFirstPacket[iMsgCount] = iPacket;
+            m_arrMsgPackets[iMsgCount] = iRun;
+            iMsgCount++;
+            iPacket += iRun;
+        }
+
+        m_stats.ulSyscallCount++;
+        int iSent = m_bUringEnabled ? sendUring(iMsgCount)
+            : sendmmsg(m_iSocket, m_arrMsgs, iMsgCount, 0);
+        // errno is only set when nothing was sent;
+        int iError = iSent < 0 ? errno : 0;
+        for (int i = 0; i < iSent; i++) {
+            const DmdRtpPacket *pPacket = &pPackets[m_arrFirstPacket[i]];
+            for (unsigned int j = 0; j < m_arrMsgPackets[i]; j++) {
+                m_stats.ulByteCount += pPacket[j].ulSize;
+            }
+            if (m_arrMsgPackets[i] > 1) {
+                m_stats.ulGsoMessageCount++;
+            }
+            m_stats.ulPacketCount += m_arrMsgPackets[i];
+            *piSentCount += m_arrMsgPackets[i];
+        }
+        if (static_cast<unsigned int>(iSent) == iMsgCount) {
+            iNext = iPacket;
+            continue;
+        }
+
+        // the batch was cut short, retry the rest, where a failure reports;
+        if (iSent > 0) {
+            iNext = m_arrFirstPacket[iSent];
+            continue;
+        }
+
+        // the first message failed;
+        if (EAGAIN == iError || EWOULDBLOCK == iError || ENOBUFS == iError) {
+            m_stats.ulDroppedCount += iPacketCount - iNext;
+            return DMD_S_OK;
+        }
+        if (m_bGsoEnabled && m_arrMsgPackets[0] > 1
+                && (EIO == iError || EINVAL == iError
+                    || ENOPROTOOPT == iError || EOPNOTSUPP == iError)) {
+            DMD_LOG_WARNING("CDmdUdpSender::sendBatched(), gso send failed, "
+                    << strerror(iError) << ", batching only from now");
+            m_bGsoEnabled = false;
+            continue;
+        }
+        // skip the packets of the failing message, as sendEach() does;
+        m_stats.ulErrorCount++;
+        DMD_LOG_WARNING("CDmdUdpSender::sendBatched(), sendmmsg failed, "
+                << strerror(iError));
+        iNext += m_arrMsgPackets[0];
+    }
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdUdpSender::SendPackets(const DmdRtpPacket *pPackets,
+        unsigned int iPacketCount, unsigned int *piSentCount) {
+    unsigned int iSentCount = 0;
+    if (piSentCount) {
+        *piSentCount = 0;
+    }
+    if (m_iSocket < 0 || (NULL == pPackets && iPacketCount)) {
+        DMD_LOG_ERROR("CDmdUdpSender::SendPackets(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    if (0 == iPacketCount) {
+        return DMD_S_OK;
+    }
+
+    uint64_t ulCpuStart = DmdGetThreadCpuTimeUs();
+    DMD_RESULT ret = DmdUdpSendEach == m_param.eMode
+        ? sendEach(pPackets, iPacketCount, &iSentCount)
+        : sendBatched(pPackets, iPacketCount, &iSentCount);
+    m_stats.ulSendCpuUs += DmdGetThreadCpuTimeUs() - ulCpuStart;
+    m_stats.ulCallCount++;
+    if (piSentCount) {
+        *piSentCount = iSentCount;
+    }
+
+    return ret;
+}
+
+void CDmdUdpSender::GetStats(DmdUdpSenderStats *pStats) const {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+}  // namespace opendmd
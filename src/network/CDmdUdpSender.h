@@ -0,0 +1,144 @@
+/*
+ ============================================================================
+ * Name        : CDmdUdpSender.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdUdpSender.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDUDPSENDER_H
+#define SRC_NETWORK_CDMDUDPSENDER_H
+
+#include <sys/socket.h>
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+#include "CDmdUring.h"
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// messages per sendmmsg();
+#define DMD_UDP_MAX_BATCH           64
+// udp_segment limits of the kernel, UDP_MAX_SEGMENTS and a datagram;
+#define DMD_UDP_MAX_GSO_SEGMENTS    64
+#define DMD_UDP_MAX_GSO_BYTES       60000
+
+typedef enum {
+    DmdUdpSendEach = 0,   // one sendmsg() per packet, the baseline;
+    DmdUdpSendBatch,      // one sendmmsg() per batch of packets;
+    DmdUdpSendGso,        // batched, equal size runs as one udp_segment;
+    DmdUdpSendUring,      // as gso, a batch as linked io_uring sendmsg;
+} DmdUdpSendMode;
+
+typedef struct {
+    struct sockaddr_storage remoteAddr;
+    socklen_t               iRemoteAddrLen;
+    DmdUdpSendMode          eMode;
+    int                     iSendBufferBytes;  // 0 for the system default;
+} DmdUdpSenderParam;
+
+typedef struct {
+    uint64_t        ulCallCount;          // SendPackets(), a frame each;
+    uint64_t        ulSyscallCount;
+    uint64_t        ulPacketCount;
+    uint64_t        ulByteCount;
+    uint64_t        ulGsoMessageCount;    // messages split by the kernel;
+    uint64_t        ulDroppedCount;       // send buffer full;
+    uint64_t        ulErrorCount;
+    uint64_t        ulSendCpuUs;          // calling thread, in SendPackets;
+} DmdUdpSenderStats;
+
+/*
+ * Sends rtp packets over a connected udp socket straight from their
+ * iovecs. Packets of a call go out in as few syscalls as possible: up to
+ * DMD_UDP_MAX_BATCH messages per sendmmsg(), and with DmdUdpSendGso, a
+ * run of equal size packets, as the FU-A fragments of a key frame are,
+ * as one message the kernel segments (UDP_SEGMENT, linux 4.18). GSO is
+ * probed at Init(), and dropped for good when a send fails on it, as it
+ * does on devices without checksum offload; the run is resent batched.
+ * DmdUdpSendUring submits the messages of a batch to an io_uring instead,
+ * linked so that they go out in order and stop at the first failure, as
+ * sendmmsg() does; without io_uring it batches with sendmmsg().
+ */
+class CDmdUdpSender : public IDmdRtpPacketSink {
+public:
+    CDmdUdpSender();
+    ~CDmdUdpSender();
+
+    DMD_RESULT Init(const DmdUdpSenderParam &senderParam);
+    DMD_RESULT Uninit();
+
+    // IDmdRtpPacketSink interface; packets not handed to the kernel are
+    // dropped when the send buffer is full;
+    DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount = NULL);
+
+    int GetSocket() const {return m_iSocket;}
+    bool IsGsoEnabled() const {return m_bGsoEnabled;}
+    bool IsUringEnabled() const {return m_bUringEnabled;}
+    void GetStats(DmdUdpSenderStats *pStats) const;
+
+private:
+    bool probeGso();
+    unsigned int gsoRunLength(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount);
+    DMD_RESULT sendEach(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount);
+    DMD_RESULT sendBatched(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount);
+    int sendUring(unsigned int iMsgCount);
+
+private:
+    DmdUdpSenderParam          m_param;
+    int                        m_iSocket;
+    bool                       m_bGsoEnabled;
+    bool                       m_bUringEnabled;
+    CDmdUring                  m_uring;
+
+    // one sendmmsg() batch, built per call without allocation;
+    struct mmsghdr             m_arrMsgs[DMD_UDP_MAX_BATCH];
+    unsigned int               m_arrFirstPacket[DMD_UDP_MAX_BATCH];
+    unsigned int               m_arrMsgPackets[DMD_UDP_MAX_BATCH];
+    std::vector<struct iovec>  m_vecIov;
+    std::vector<uint8_t>       m_vecControl;
+
+    DmdUdpSenderStats          m_stats;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDUDPSENDER_H
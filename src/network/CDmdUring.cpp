@@ -0,0 +1,365 @@
+/*
+ ============================================================================
+ * Name        : CDmdUring.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdUring.cpp
+ ============================================================================
+ */
+
+#include "CDmdUring.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+static int uringSetup(unsigned int iEntries, struct io_uring_params *pParams) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, iEntries, pParams));
+}
+
+static int uringEnter(int iFd, unsigned int iSubmit, unsigned int iWait,
+        unsigned int iFlags, void *pArg, size_t ulArgSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, iFd, iSubmit, iWait,
+                iFlags, pArg, ulArgSize));
+}
+
+static int uringRegister(int iFd, unsigned int iOpcode, void *pArg,
+        unsigned int iArgCount) {
+    return static_cast<int>(syscall(__NR_io_uring_register, iFd, iOpcode,
+                pArg, iArgCount));
+}
+
+static bool probeOps(int iFd, const uint8_t *pOps, size_t ulOpCount) {
+    size_t ulSize = sizeof(struct io_uring_probe)
+        + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *pProbe =
+        static_cast<struct io_uring_probe *>(calloc(1, ulSize));
+    if (NULL == pProbe) {
+        return false;
+    }
+    bool bSupported = 0 == uringRegister(iFd, IORING_REGISTER_PROBE,
+            pProbe, 256);
+    for (size_t i = 0; bSupported && i < ulOpCount; i++) {
+        bSupported = pOps[i] <= pProbe->last_op
+            && (pProbe->ops[pOps[i]].flags & IO_URING_OP_SUPPORTED);
+    }
+    free(pProbe);
+    return bSupported;
+}
+
+static DmdUringLevel probeKernel() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int iFd = uringSetup(4, &params);
+    if (iFd < 0) {
+        DMD_LOG_INFO("CDmdUring::ProbeLevel(), no io_uring, "
+                << strerror(errno));
+        return DmdUringNone;
+    }
+    DmdUringLevel eLevel = DmdUringNone;
+    const uint8_t arrBatchOps[] = {IORING_OP_SENDMSG, IORING_OP_RECVMSG};
+    if ((params.features & IORING_FEAT_EXT_ARG)
+            && (params.features & IORING_FEAT_NODROP)
+            && probeOps(iFd, arrBatchOps, sizeof(arrBatchOps))) {
+        eLevel = DmdUringBatch;
+    }
+
+    // multishot recvmsg has no probe of its own, IORING_OP_SEND_ZC came
+    // with it in 6.0; buffer rings are tried for real;
+    const uint8_t arrMultishotOps[] = {IORING_OP_SEND_ZC};
+    long lPageSize = sysconf(_SC_PAGESIZE);
+    void *pRing = NULL;
+    if (DmdUringBatch == eLevel
+            && probeOps(iFd, arrMultishotOps, sizeof(arrMultishotOps))
+            && 0 == posix_memalign(&pRing, lPageSize, lPageSize)) {
+        memset(pRing, 0, lPageSize);
+        struct io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof(reg));
+        reg.ring_addr = reinterpret_cast<uint64_t>(pRing);
+        reg.ring_entries = 1;
+        reg.bgid = 0;
+        if (0 == uringRegister(iFd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+            uringRegister(iFd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+            eLevel = DmdUringMultishot;
+        }
+    }
+    free(pRing);
+    close(iFd);
+    DMD_LOG_INFO("CDmdUring::ProbeLevel(), level = " << eLevel
+            << ", features = " << std::hex << params.features);
+    return eLevel;
+}
+
+DmdUringLevel CDmdUring::ProbeLevel() {
+    static DmdUringLevel s_eLevel = probeKernel();
+    return s_eLevel;
+}
+
+CDmdUring::CDmdUring() : m_iFd(-1), m_pSqRing(NULL), m_ulSqRingSize(0),
+        m_pCqRing(NULL), m_ulCqRingSize(0), m_pSqes(NULL), m_ulSqesSize(0),
+        m_piSqHead(NULL), m_piSqTail(NULL), m_piSqArray(NULL), m_iSqMask(0),
+        m_iSqEntries(0), m_iSqPending(0), m_piCqHead(NULL),
+        m_piCqTail(NULL), m_iCqMask(0), m_pCqes(NULL), m_pBufRing(NULL),
+        m_ulBufRingSize(0), m_pBuffers(NULL), m_ulBufferSize(0),
+        m_iBufCount(0), m_iBufGroup(0), m_iBufTail(0) {
+}
+
+CDmdUring::~CDmdUring() {
+    Uninit();
+}
+
+DMD_RESULT CDmdUring::Init(unsigned int iEntries, unsigned int iCqEntries) {
+    Uninit();
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    if (iCqEntries > 2 * iEntries) {
+        params.flags |= IORING_SETUP_CQSIZE;
+        params.cq_entries = iCqEntries;
+    }
+    m_iFd = uringSetup(iEntries, &params);
+    if (m_iFd < 0) {
+        DMD_LOG_ERROR("CDmdUring::Init(), io_uring_setup failed, "
+                << strerror(errno));
+        return DMD_S_FAIL;
+    }
+
+    m_ulSqRingSize = params.sq_off.array
+        + params.sq_entries * sizeof(unsigned int);
+    m_ulCqRingSize = params.cq_off.cqes
+        + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool bSingleMmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (bSingleMmap) {
+        m_ulSqRingSize = m_ulSqRingSize > m_ulCqRingSize
+            ? m_ulSqRingSize : m_ulCqRingSize;
+        m_ulCqRingSize = m_ulSqRingSize;
+    }
+    m_pSqRing = mmap(NULL, m_ulSqRingSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_iFd, IORING_OFF_SQ_RING);
+    m_pCqRing = bSingleMmap ? m_pSqRing : mmap(NULL, m_ulCqRingSize,
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_iFd,
+            IORING_OFF_CQ_RING);
+    m_ulSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *pSqes = mmap(NULL, m_ulSqesSize, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_iFd, IORING_OFF_SQES);
+    if (MAP_FAILED == m_pSqRing || MAP_FAILED == m_pCqRing
+            || MAP_FAILED == pSqes) {
+        DMD_LOG_ERROR("CDmdUring::Init(), mmap failed, " << strerror(errno));
+        m_pSqes = MAP_FAILED == pSqes ? NULL
+            : static_cast<struct io_uring_sqe *>(pSqes);
+        Uninit();
+        return DMD_S_FAIL;
+    }
+    m_pSqes = static_cast<struct io_uring_sqe *>(pSqes);
+
+    uint8_t *pSq = static_cast<uint8_t *>(m_pSqRing);
+    m_piSqHead = reinterpret_cast<unsigned int *>(pSq + params.sq_off.head);
+    m_piSqTail = reinterpret_cast<unsigned int *>(pSq + params.sq_off.tail);
+    m_piSqArray = reinterpret_cast<unsigned int *>(pSq + params.sq_off.array);
+    m_iSqMask = *reinterpret_cast<unsigned int *>(pSq
+            + params.sq_off.ring_mask);
+    m_iSqEntries = params.sq_entries;
+    // the array maps slot to entry one to one, set once;
+    for (unsigned int i = 0; i < m_iSqEntries; i++) {
+        m_piSqArray[i] = i;
+    }
+    uint8_t *pCq = static_cast<uint8_t *>(m_pCqRing);
+    m_piCqHead = reinterpret_cast<unsigned int *>(pCq + params.cq_off.head);
+    m_piCqTail = reinterpret_cast<unsigned int *>(pCq + params.cq_off.tail);
+    m_iCqMask = *reinterpret_cast<unsigned int *>(pCq
+            + params.cq_off.ring_mask);
+    m_pCqes = reinterpret_cast<struct io_uring_cqe *>(pCq
+            + params.cq_off.cqes);
+    m_iSqPending = 0;
+    return DMD_S_OK;
+}
+
+void CDmdUring::unmapRings() {
+    if (m_pSqes) {
+        munmap(m_pSqes, m_ulSqesSize);
+        m_pSqes = NULL;
+    }
+    if (m_pCqRing && MAP_FAILED != m_pCqRing && m_pCqRing != m_pSqRing) {
+        munmap(m_pCqRing, m_ulCqRingSize);
+    }
+    if (m_pSqRing && MAP_FAILED != m_pSqRing) {
+        munmap(m_pSqRing, m_ulSqRingSize);
+    }
+    m_pSqRing = NULL;
+    m_pCqRing = NULL;
+}
+
+void CDmdUring::Uninit() {
+    unmapRings();
+    if (m_iFd >= 0) {
+        // closing the ring cancels what is in flight, buffers included;
+        close(m_iFd);
+        m_iFd = -1;
+    }
+    if (m_pBufRing) {
+        munmap(m_pBufRing, m_ulBufRingSize);
+        m_pBufRing = NULL;
+    }
+    free(m_pBuffers);
+    m_pBuffers = NULL;
+    m_iBufCount = 0;
+    m_iSqPending = 0;
+}
+
+struct io_uring_sqe *CDmdUring::GetSqe() {
+    unsigned int iHead = __atomic_load_n(m_piSqHead, __ATOMIC_ACQUIRE);
+    unsigned int iTail = *m_piSqTail + m_iSqPending;
+    if (iTail - iHead >= m_iSqEntries) {
+        return NULL;
+    }
+    struct io_uring_sqe *pSqe = &m_pSqes[iTail & m_iSqMask];
+    memset(pSqe, 0, sizeof(*pSqe));
+    m_iSqPending++;
+    return pSqe;
+}
+
+int CDmdUring::Enter(unsigned int iWaitCount, int64_t lTimeoutUs) {
+    unsigned int iSubmit = m_iSqPending;
+    if (iSubmit) {
+        __atomic_store_n(m_piSqTail, *m_piSqTail + iSubmit,
+                __ATOMIC_RELEASE);
+        m_iSqPending = 0;
+    }
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    unsigned int iFlags = iWaitCount ? IORING_ENTER_GETEVENTS : 0;
+    if (iWaitCount && lTimeoutUs >= 0) {
+        ts.tv_sec = lTimeoutUs / 1000000;
+        ts.tv_nsec = (lTimeoutUs % 1000000) * 1000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        iFlags |= IORING_ENTER_EXT_ARG;
+    }
+    int ret = 0;
+    do {
+        ret = uringEnter(m_iFd, iSubmit, iWaitCount, iFlags,
+                (iFlags & IORING_ENTER_EXT_ARG) ? &arg : NULL,
+                (iFlags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0);
+        if (ret >= 0) {
+            return ret;
+        }
+        ret = -errno;
+        // what was consumed before the interrupt stays submitted;
+        iSubmit = 0;
+    } while (-EINTR == ret);
+    return ret;
+}
+
+struct io_uring_cqe *CDmdUring::PeekCqe() {
+    unsigned int iHead = *m_piCqHead;
+    if (iHead == __atomic_load_n(m_piCqTail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &m_pCqes[iHead & m_iCqMask];
+}
+
+void CDmdUring::SeenCqe() {
+    __atomic_store_n(m_piCqHead, *m_piCqHead + 1, __ATOMIC_RELEASE);
+}
+
+DMD_RESULT CDmdUring::SetupBuffers(uint16_t iGroup, unsigned int iCount,
+        size_t ulSize) {
+    if (m_iFd < 0 || m_pBufRing || 0 == iCount || (iCount & (iCount - 1))
+            || iCount > 32768 || 0 == ulSize) {
+        DMD_LOG_ERROR("CDmdUring::SetupBuffers(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    m_ulBufRingSize = iCount * sizeof(struct io_uring_buf);
+    void *pRing = mmap(NULL, m_ulBufRingSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    long lPageSize = sysconf(_SC_PAGESIZE);
+    void *pBuffers = NULL;
+    if (MAP_FAILED == pRing
+            || 0 != posix_memalign(&pBuffers, lPageSize, iCount * ulSize)) {
+        DMD_LOG_ERROR("CDmdUring::SetupBuffers(), allocate failed");
+        if (MAP_FAILED != pRing) {
+            munmap(pRing, m_ulBufRingSize);
+        }
+        return DMD_S_FAIL;
+    }
+    m_pBufRing = static_cast<struct io_uring_buf_ring *>(pRing);
+    m_pBuffers = static_cast<uint8_t *>(pBuffers);
+    m_ulBufferSize = ulSize;
+    m_iBufCount = iCount;
+    m_iBufGroup = iGroup;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(m_pBufRing);
+    reg.ring_entries = iCount;
+    reg.bgid = iGroup;
+    if (0 != uringRegister(m_iFd, IORING_REGISTER_PBUF_RING, &reg, 1)) {
+        DMD_LOG_ERROR("CDmdUring::SetupBuffers(), register failed, "
+                << strerror(errno));
+        munmap(m_pBufRing, m_ulBufRingSize);
+        m_pBufRing = NULL;
+        free(m_pBuffers);
+        m_pBuffers = NULL;
+        m_iBufCount = 0;
+        return DMD_S_FAIL;
+    }
+    m_iBufTail = 0;
+    for (unsigned int i = 0; i < iCount; i++) {
+        RecycleBuffer(static_cast<uint16_t>(i));
+    }
+    CommitBuffers();
+    return DMD_S_OK;
+}
+
+void CDmdUring::RecycleBuffer(uint16_t iId) {
+    // not bufs[], its flexible array wrapper shifts it in c++;
+    struct io_uring_buf *pBuf = reinterpret_cast<struct io_uring_buf *>(
+            m_pBufRing) + (m_iBufTail & (m_iBufCount - 1));
+    pBuf->addr = reinterpret_cast<uint64_t>(GetBuffer(iId));
+    pBuf->len = static_cast<uint32_t>(m_ulBufferSize);
+    pBuf->bid = iId;
+    m_iBufTail++;
+}
+
+void CDmdUring::CommitBuffers() {
+    // the tail overlays the first entry's resv field;
+    __atomic_store_n(&m_pBufRing->tail, m_iBufTail, __ATOMIC_RELEASE);
+}
+
+}  // namespace opendmd
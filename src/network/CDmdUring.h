@@ -0,0 +1,133 @@
+/*
+ ============================================================================
+ * Name        : CDmdUring.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdUring.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_CDMDURING_H
+#define SRC_NETWORK_CDMDURING_H
+
+#include <linux/io_uring.h>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+typedef enum {
+    DmdUringNone = 0,     // no io_uring, or disabled by io_uring_disabled;
+    DmdUringBatch,        // sendmsg and recvmsg, timed waits, linux 5.11;
+    DmdUringMultishot,    // provided buffer rings, multishot recvmsg, 6.0;
+} DmdUringLevel;
+
+/*
+ * A bare io_uring over the raw syscalls, no liburing: the submission and
+ * completion rings mapped from the kernel, and optionally one ring of
+ * provided buffers the kernel picks receive buffers from. Single issuer,
+ * no locking.
+ */
+class CDmdUring {
+public:
+    CDmdUring();
+    ~CDmdUring();
+
+    // what the running kernel supports, probed once;
+    static DmdUringLevel ProbeLevel();
+
+    // iEntries submissions, a completion ring of iCqEntries, 0 for twice
+    // iEntries;
+    DMD_RESULT Init(unsigned int iEntries, unsigned int iCqEntries = 0);
+    void Uninit();
+
+    // a cleared entry, NULL when the submission ring is full;
+    struct io_uring_sqe *GetSqe();
+    // submits the entries got since, and waits for iWaitCount completions
+    // at most lTimeoutUs, -1 for no limit; the submitted count or -errno,
+    // -ETIME on timeout;
+    int Enter(unsigned int iWaitCount, int64_t lTimeoutUs);
+    unsigned int GetPendingSqes() const {return m_iSqPending;}
+    // the oldest completion, NULL if none, consumed by SeenCqe();
+    struct io_uring_cqe *PeekCqe();
+    void SeenCqe();
+
+    // iCount buffers of ulSize bytes for IOSQE_BUFFER_SELECT in iGroup,
+    // iCount a power of two;
+    DMD_RESULT SetupBuffers(uint16_t iGroup, unsigned int iCount,
+            size_t ulSize);
+    uint8_t *GetBuffer(uint16_t iId) const {
+        return m_pBuffers + static_cast<size_t>(iId) * m_ulBufferSize;
+    }
+    size_t GetBufferSize() const {return m_ulBufferSize;}
+    // back to the kernel, visible after CommitBuffers();
+    void RecycleBuffer(uint16_t iId);
+    void CommitBuffers();
+
+    int GetFd() const {return m_iFd;}
+
+private:
+    void unmapRings();
+
+private:
+    int                     m_iFd;
+    void                   *m_pSqRing;
+    size_t                  m_ulSqRingSize;
+    void                   *m_pCqRing;      // m_pSqRing if single mmap;
+    size_t                  m_ulCqRingSize;
+    struct io_uring_sqe    *m_pSqes;
+    size_t                  m_ulSqesSize;
+
+    unsigned int           *m_piSqHead;
+    unsigned int           *m_piSqTail;
+    unsigned int           *m_piSqArray;
+    unsigned int            m_iSqMask;
+    unsigned int            m_iSqEntries;
+    unsigned int            m_iSqPending;   // got, not yet submitted;
+    unsigned int           *m_piCqHead;
+    unsigned int           *m_piCqTail;
+    unsigned int            m_iCqMask;
+    struct io_uring_cqe    *m_pCqes;
+
+    struct io_uring_buf_ring *m_pBufRing;
+    size_t                  m_ulBufRingSize;
+    uint8_t                *m_pBuffers;
+    size_t                  m_ulBufferSize;
+    unsigned int            m_iBufCount;
+    uint16_t                m_iBufGroup;
+    uint16_t                m_iBufTail;     // recycled, not committed;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_CDMDURING_H
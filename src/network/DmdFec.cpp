@@ -0,0 +1,96 @@
+/*
+ ============================================================================
+ * Name        : DmdFec.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : xor parity helpers of the fec stages.
+ ============================================================================
+ */
+
+#include "DmdFec.h"
+
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace opendmd {
+
+void DmdFecXorC(uint8_t *pDst, const uint8_t *pSrc, size_t ulSize) {
+    size_t i = 0;
+    // a word at a time, memcpy keeps unaligned access defined;
+    for (; i + sizeof(uint64_t) <= ulSize; i += sizeof(uint64_t)) {
+        uint64_t ulDst;
+        uint64_t ulSrc;
+        memcpy(&ulDst, pDst + i, sizeof(ulDst));
+        memcpy(&ulSrc, pSrc + i, sizeof(ulSrc));
+        ulDst ^= ulSrc;
+        memcpy(pDst + i, &ulDst, sizeof(ulDst));
+    }
+    for (; i < ulSize; i++) {
+        pDst[i] ^= pSrc[i];
+    }
+}
+
+#if defined(__SSE2__)
+void DmdFecXor(uint8_t *pDst, const uint8_t *pSrc, size_t ulSize) {
+    size_t i = 0;
+    for (; i + 64 <= ulSize; i += 64) {
+        __m128i dst[4];
+        for (int j = 0; j < 4; j++) {
+            dst[j] = _mm_xor_si128(
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                            pDst + i + j * 16)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i *>(
+                            pSrc + i + j * 16)));
+        }
+        for (int j = 0; j < 4; j++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i + j * 16),
+                    dst[j]);
+        }
+    }
+    for (; i + 16 <= ulSize; i += 16) {
+        __m128i dst = _mm_xor_si128(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(pDst + i)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(pSrc + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pDst + i), dst);
+    }
+    DmdFecXorC(pDst + i, pSrc + i, ulSize - i);
+}
+#else
+void DmdFecXor(uint8_t *pDst, const uint8_t *pSrc, size_t ulSize) {
+    DmdFecXorC(pDst, pSrc, ulSize);
+}
+#endif
+
+}  // namespace opendmd
@@ -0,0 +1,60 @@
+/*
+ ============================================================================
+ * Name        : DmdFec.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdFec.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_DMDFEC_H
+#define SRC_NETWORK_DMDFEC_H
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+// fec rides its own ssrc, with this payload type;
+#define DMD_RTP_FEC_PAYLOAD_TYPE    117
+// rfc 5109 fec header, and a level 0 header with the 16 bit mask;
+#define DMD_FEC_HEADER_SIZE         10
+#define DMD_FEC_LEVEL_HEADER_SIZE   4
+#define DMD_FEC_MAX_GROUP_SIZE      16
+
+// pDst ^= pSrc, ulSize bytes; exposed for unittest and benchmark;
+extern void DmdFecXor(uint8_t *pDst, const uint8_t *pSrc, size_t ulSize);
+extern void DmdFecXorC(uint8_t *pDst, const uint8_t *pSrc, size_t ulSize);
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_DMDFEC_H
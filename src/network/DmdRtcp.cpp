@@ -0,0 +1,401 @@
+/*
+ ============================================================================
+ * Name        : DmdRtcp.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : rtcp helpers, rfc 3550 and rfc 4585.
+ ============================================================================
+ */
+
+#include "DmdRtcp.h"
+
+#include <string.h>
+
+namespace opendmd {
+
+static void writeUint16(uint8_t *pBuffer, uint16_t iValue) {
+    pBuffer[0] = static_cast<uint8_t>(iValue >> 8);
+    pBuffer[1] = static_cast<uint8_t>(iValue);
+}
+
+static void writeUint32(uint8_t *pBuffer, uint32_t iValue) {
+    pBuffer[0] = static_cast<uint8_t>(iValue >> 24);
+    pBuffer[1] = static_cast<uint8_t>(iValue >> 16);
+    pBuffer[2] = static_cast<uint8_t>(iValue >> 8);
+    pBuffer[3] = static_cast<uint8_t>(iValue);
+}
+
+static uint16_t readUint16(const uint8_t *pData) {
+    return static_cast<uint16_t>((pData[0] << 8) | pData[1]);
+}
+
+static uint32_t readUint32(const uint8_t *pData) {
+    return (static_cast<uint32_t>(pData[0]) << 24) | (pData[1] << 16)
+        | (pData[2] << 8) | pData[3];
+}
+
+static void writeBlock(const DmdRtcpReportBlock &reportBlock,
+        uint8_t *pBuffer) {
+    writeUint32(pBuffer, reportBlock.iSsrc);
+    // cumulative lost is 24 bit two's complement, clamped;
+    int32_t iLost = reportBlock.iCumulativeLost;
+    if (iLost > 0x7fffff) {
+        iLost = 0x7fffff;
+    } else if (iLost < -0x800000) {
+        iLost = -0x800000;
+    }
+    writeUint32(pBuffer + 4, (static_cast<uint32_t>(reportBlock.iFractionLost)
+                << 24) | (static_cast<uint32_t>(iLost) & 0xffffff));
+    writeUint32(pBuffer + 8, reportBlock.iExtHighestSeq);
+    writeUint32(pBuffer + 12, reportBlock.iJitter);
+    writeUint32(pBuffer + 16, reportBlock.iLastSr);
+    writeUint32(pBuffer + 20, reportBlock.iDelaySinceLastSr);
+}
+
+static void readBlock(const uint8_t *pData, DmdRtcpReportBlock *pBlock) {
+    pBlock->iSsrc = readUint32(pData);
+    uint32_t iLost = readUint32(pData + 4);
+    pBlock->iFractionLost = static_cast<uint8_t>(iLost >> 24);
+    // sign extend from 24 bits;
+    pBlock->iCumulativeLost = static_cast<int32_t>(iLost << 8) >> 8;
+    pBlock->iExtHighestSeq = readUint32(pData + 8);
+    pBlock->iJitter = readUint32(pData + 12);
+    pBlock->iLastSr = readUint32(pData + 16);
+    pBlock->iDelaySinceLastSr = readUint32(pData + 20);
+}
+
+DMD_RESULT DmdRtcpWriteReport(uint32_t iSsrc,
+        const DmdRtcpSenderInfo *pSenderInfo,
+        const DmdRtcpReportBlock *pBlocks, unsigned int iBlockCount,
+        uint8_t *pBuffer, size_t ulCapacity, size_t *pSize) {
+    if ((iBlockCount && NULL == pBlocks) || NULL == pBuffer || NULL == pSize
+            || iBlockCount > DMD_RTCP_MAX_REPORT_BLOCKS) {
+        return DMD_S_FAIL;
+    }
+    size_t ulSize = DMD_RTCP_HEADER_SIZE + 4
+        + (pSenderInfo ? DMD_RTCP_SENDER_INFO_SIZE : 0)
+        + iBlockCount * DMD_RTCP_REPORT_BLOCK_SIZE;
+    if (ulSize > ulCapacity) {
+        return DMD_S_FAIL;
+    }
+
+    pBuffer[0] = static_cast<uint8_t>((DMD_RTCP_VERSION << 6) | iBlockCount);
+    pBuffer[1] = pSenderInfo ? DMD_RTCP_PT_SR : DMD_RTCP_PT_RR;
+    writeUint16(pBuffer + 2, static_cast<uint16_t>(ulSize / 4 - 1));
+    writeUint32(pBuffer + 4, iSsrc);
+    uint8_t *pBlock = pBuffer + 8;
+    if (pSenderInfo) {
+        uint64_t ulNtpTime = pSenderInfo->ulNtpTime;
+        writeUint32(pBlock, static_cast<uint32_t>(ulNtpTime >> 32));
+        writeUint32(pBlock + 4, static_cast<uint32_t>(ulNtpTime));
+        writeUint32(pBlock + 8, pSenderInfo->iRtpTimestamp);
+        writeUint32(pBlock + 12, pSenderInfo->iPacketCount);
+        writeUint32(pBlock + 16, pSenderInfo->iOctetCount);
+        pBlock += DMD_RTCP_SENDER_INFO_SIZE;
+    }
+    for (unsigned int i = 0; i < iBlockCount; i++) {
+        writeBlock(pBlocks[i], pBlock);
+        pBlock += DMD_RTCP_REPORT_BLOCK_SIZE;
+    }
+    *pSize = ulSize;
+    return DMD_S_OK;
+}
+
+DMD_RESULT DmdRtcpParseReports(const uint8_t *pData, size_t ulSize,
+        std::vector<DmdRtcpReport> *pReports) {
+    if (NULL == pData || NULL == pReports) {
+        return DMD_S_FAIL;
+    }
+
+    size_t ulPos = 0;
+    while (ulPos + DMD_RTCP_HEADER_SIZE <= ulSize) {
+        const uint8_t *pPacket = pData + ulPos;
+        size_t ulLength = (readUint16(pPacket + 2) + 1) * 4;
+        if (DMD_RTCP_VERSION != (pPacket[0] >> 6)
+                || ulPos + ulLength > ulSize) {
+            return DMD_S_FAIL;
+        }
+        ulPos += ulLength;
+        if (DMD_RTCP_PT_SR != pPacket[1] && DMD_RTCP_PT_RR != pPacket[1]) {
+            continue;
+        }
+
+        DmdRtcpReport report;
+        memset(&report.senderInfo, 0, sizeof(report.senderInfo));
+        report.iPacketType = pPacket[1];
+        unsigned int iBlockCount = pPacket[0] & 0x1f;
+        size_t ulOffset = DMD_RTCP_HEADER_SIZE + 4;
+        if (DMD_RTCP_PT_SR == report.iPacketType) {
+            ulOffset += DMD_RTCP_SENDER_INFO_SIZE;
+        }
+        // blocks beyond the length are malformed, profile extensions after
+        // them are allowed;
+        if (ulOffset + iBlockCount * DMD_RTCP_REPORT_BLOCK_SIZE > ulLength) {
+            return DMD_S_FAIL;
+        }
+        report.iSsrc = readUint32(pPacket + 4);
+        if (DMD_RTCP_PT_SR == report.iPacketType) {
+            const uint8_t *pInfo = pPacket + 8;
+            report.senderInfo.ulNtpTime =
+                (static_cast<uint64_t>(readUint32(pInfo)) << 32)
+                | readUint32(pInfo + 4);
+            report.senderInfo.iRtpTimestamp = readUint32(pInfo + 8);
+            report.senderInfo.iPacketCount = readUint32(pInfo + 12);
+            report.senderInfo.iOctetCount = readUint32(pInfo + 16);
+        }
+        report.vecBlocks.resize(iBlockCount);
+        for (unsigned int i = 0; i < iBlockCount; i++) {
+            readBlock(pPacket + ulOffset + i * DMD_RTCP_REPORT_BLOCK_SIZE,
+                    &report.vecBlocks[i]);
+        }
+        pReports->push_back(report);
+    }
+
+    return ulPos == ulSize ? DMD_S_OK : DMD_S_FAIL;
+}
+
+uint64_t DmdNtpFromUs(uint64_t ulWallClockUs) {
+    uint64_t ulSeconds = ulWallClockUs / 1000000 + DMD_NTP_UNIX_OFFSET_S;
+    uint64_t ulFraction = ((ulWallClockUs % 1000000) << 32) / 1000000;
+    return (ulSeconds << 32) | ulFraction;
+}
+
+uint64_t DmdNtpToUs(uint64_t ulNtpTime) {
+    uint64_t ulSeconds = ulNtpTime >> 32;
+    if (ulSeconds < DMD_NTP_UNIX_OFFSET_S) {
+        return 0;
+    }
+    return (ulSeconds - DMD_NTP_UNIX_OFFSET_S) * 1000000
+        + (((ulNtpTime & 0xffffffffULL) * 1000000 + (1ULL << 31)) >> 32);
+}
+
+uint64_t DmdRtcpReportIntervalUs(size_t ulReportBytes,
+        uint64_t ulBandwidthBps, float fBandwidthFraction,
+        uint64_t ulMinIntervalUs) {
+    double fRtcpBps = ulBandwidthBps * static_cast<double>(fBandwidthFraction);
+    if (fRtcpBps < 1.0) {
+        return ulMinIntervalUs;
+    }
+    uint64_t ulIntervalUs = static_cast<uint64_t>(
+            ulReportBytes * 8 * 1000000.0 / fRtcpBps + 0.5);
+    return ulIntervalUs > ulMinIntervalUs ? ulIntervalUs : ulMinIntervalUs;
+}
+
+DMD_RESULT DmdRtcpWriteNack(uint32_t iSenderSsrc, uint32_t iMediaSsrc,
+        const uint16_t *pSequences, unsigned int iCount, uint8_t *pBuffer,
+        size_t ulCapacity, size_t *pSize) {
+    if (NULL == pSequences || 0 == iCount || NULL == pBuffer
+            || NULL == pSize) {
+        return DMD_S_FAIL;
+    }
+
+    size_t ulSize = DMD_RTCP_NACK_FIXED_SIZE;
+    unsigned int i = 0;
+    while (i < iCount) {
+        if (ulSize + DMD_RTCP_NACK_ITEM_SIZE > ulCapacity) {
+            return DMD_S_FAIL;
+        }
+        uint16_t iPid = pSequences[i++];
+        uint16_t iBlp = 0;
+        while (i < iCount) {
+            uint16_t iDistance = static_cast<uint16_t>(pSequences[i] - iPid);
+            if (0 == iDistance || iDistance > 16) {
+                break;
+            }
+            iBlp |= static_cast<uint16_t>(1 << (iDistance - 1));
+            i++;
+        }
+        writeUint16(pBuffer + ulSize, iPid);
+        writeUint16(pBuffer + ulSize + 2, iBlp);
+        ulSize += DMD_RTCP_NACK_ITEM_SIZE;
+    }
+
+    pBuffer[0] = (DMD_RTCP_VERSION << 6) | DMD_RTCP_FMT_NACK;
+    pBuffer[1] = DMD_RTCP_PT_RTPFB;
+    writeUint16(pBuffer + 2, static_cast<uint16_t>(ulSize / 4 - 1));
+    writeUint32(pBuffer + 4, iSenderSsrc);
+    writeUint32(pBuffer + 8, iMediaSsrc);
+    *pSize = ulSize;
+    return DMD_S_OK;
+}
+
+DMD_RESULT DmdRtcpParseNacks(const uint8_t *pData, size_t ulSize,
+        std::vector<DmdRtcpNack> *pNacks) {
+    if (NULL == pData || NULL == pNacks) {
+        return DMD_S_FAIL;
+    }
+
+    size_t ulPos = 0;
+    while (ulPos + DMD_RTCP_HEADER_SIZE <= ulSize) {
+        const uint8_t *pPacket = pData + ulPos;
+        size_t ulLength = (readUint16(pPacket + 2) + 1) * 4;
+        if (DMD_RTCP_VERSION != (pPacket[0] >> 6)
+                || ulPos + ulLength > ulSize) {
+            return DMD_S_FAIL;
+        }
+        ulPos += ulLength;
+        if (DMD_RTCP_PT_RTPFB != pPacket[1]
+                || DMD_RTCP_FMT_NACK != (pPacket[0] & 0x1f)
+                || ulLength < DMD_RTCP_NACK_FIXED_SIZE) {
+            continue;
+        }
+
+        DmdRtcpNack nack;
+        nack.iSenderSsrc = readUint32(pPacket + 4);
+        nack.iMediaSsrc = readUint32(pPacket + 8);
+        for (size_t ulItem = DMD_RTCP_NACK_FIXED_SIZE;
+                ulItem + DMD_RTCP_NACK_ITEM_SIZE <= ulLength;
+                ulItem += DMD_RTCP_NACK_ITEM_SIZE) {
+            uint16_t iPid = readUint16(pPacket + ulItem);
+            uint16_t iBlp = readUint16(pPacket + ulItem + 2);
+            nack.vecSequences.push_back(iPid);
+            for (int iBit = 0; iBit < 16; iBit++) {
+                if (iBlp & (1 << iBit)) {
+                    nack.vecSequences.push_back(
+                            static_cast<uint16_t>(iPid + iBit + 1));
+                }
+            }
+        }
+        pNacks->push_back(nack);
+    }
+
+    return ulPos == ulSize ? DMD_S_OK : DMD_S_FAIL;
+}
+
+DMD_RESULT DmdRtcpWriteCcfb(const DmdRtcpCcfb &ccfb, uint8_t *pBuffer,
+        size_t ulCapacity, size_t *pSize) {
+    if (NULL == pBuffer || NULL == pSize) {
+        return DMD_S_FAIL;
+    }
+
+    size_t ulSize = DMD_RTCP_HEADER_SIZE + 4;
+    for (size_t i = 0; i < ccfb.vecBlocks.size(); i++) {
+        const DmdRtcpCcfbBlock &block = ccfb.vecBlocks[i];
+        size_t ulCount = block.vecArrivalOffsets.size();
+        if (0 == ulCount || ulCount > DMD_RTCP_CCFB_MAX_REPORTS) {
+            return DMD_S_FAIL;
+        }
+        ulSize += DMD_RTCP_CCFB_BLOCK_SIZE + (ulCount * 2 + 3) / 4 * 4;
+    }
+    ulSize += 4;
+    if (ulSize > ulCapacity || ulSize / 4 - 1 > 0xffff) {
+        return DMD_S_FAIL;
+    }
+
+    pBuffer[0] = (DMD_RTCP_VERSION << 6) | DMD_RTCP_FMT_CCFB;
+    pBuffer[1] = DMD_RTCP_PT_RTPFB;
+    writeUint16(pBuffer + 2, static_cast<uint16_t>(ulSize / 4 - 1));
+    writeUint32(pBuffer + 4, ccfb.iSenderSsrc);
+    uint8_t *pBlock = pBuffer + 8;
+    for (size_t i = 0; i < ccfb.vecBlocks.size(); i++) {
+        const DmdRtcpCcfbBlock &block = ccfb.vecBlocks[i];
+        size_t ulCount = block.vecArrivalOffsets.size();
+        writeUint32(pBlock, block.iMediaSsrc);
+        writeUint16(pBlock + 4, block.iBeginSeq);
+        writeUint16(pBlock + 6, static_cast<uint16_t>(ulCount));
+        pBlock += DMD_RTCP_CCFB_BLOCK_SIZE;
+        for (size_t j = 0; j < ulCount; j++) {
+            // received bit, ecn 0, then the arrival time offset;
+            int16_t iOffset = block.vecArrivalOffsets[j];
+            uint16_t iMetric = 0;
+            if (iOffset >= 0) {
+                iMetric = static_cast<uint16_t>(0x8000
+                        | (iOffset < DMD_RTCP_CCFB_OVER_RANGE
+                            ? iOffset : DMD_RTCP_CCFB_OVER_RANGE));
+            }
+            writeUint16(pBlock, iMetric);
+            pBlock += 2;
+        }
+        if (ulCount & 1) {
+            writeUint16(pBlock, 0);
+            pBlock += 2;
+        }
+    }
+    writeUint32(pBlock, ccfb.iReportTimestamp);
+    *pSize = ulSize;
+    return DMD_S_OK;
+}
+
+DMD_RESULT DmdRtcpParseCcfbs(const uint8_t *pData, size_t ulSize,
+        std::vector<DmdRtcpCcfb> *pFeedbacks) {
+    if (NULL == pData || NULL == pFeedbacks) {
+        return DMD_S_FAIL;
+    }
+
+    size_t ulPos = 0;
+    while (ulPos + DMD_RTCP_HEADER_SIZE <= ulSize) {
+        const uint8_t *pPacket = pData + ulPos;
+        size_t ulLength = (readUint16(pPacket + 2) + 1) * 4;
+        if (DMD_RTCP_VERSION != (pPacket[0] >> 6)
+                || ulPos + ulLength > ulSize) {
+            return DMD_S_FAIL;
+        }
+        ulPos += ulLength;
+        if (DMD_RTCP_PT_RTPFB != pPacket[1]
+                || DMD_RTCP_FMT_CCFB != (pPacket[0] & 0x1f)) {
+            continue;
+        }
+        if (ulLength < DMD_RTCP_HEADER_SIZE + 8) {
+            return DMD_S_FAIL;
+        }
+
+        DmdRtcpCcfb ccfb;
+        ccfb.iSenderSsrc = readUint32(pPacket + 4);
+        ccfb.iReportTimestamp = readUint32(pPacket + ulLength - 4);
+        size_t ulOffset = DMD_RTCP_HEADER_SIZE + 4;
+        while (ulOffset + DMD_RTCP_CCFB_BLOCK_SIZE <= ulLength - 4) {
+            DmdRtcpCcfbBlock block;
+            block.iMediaSsrc = readUint32(pPacket + ulOffset);
+            block.iBeginSeq = readUint16(pPacket + ulOffset + 4);
+            size_t ulCount = readUint16(pPacket + ulOffset + 6);
+            ulOffset += DMD_RTCP_CCFB_BLOCK_SIZE;
+            if (ulOffset + ulCount * 2 > ulLength - 4) {
+                return DMD_S_FAIL;
+            }
+            block.vecArrivalOffsets.resize(ulCount);
+            for (size_t j = 0; j < ulCount; j++) {
+                uint16_t iMetric = readUint16(pPacket + ulOffset + j * 2);
+                block.vecArrivalOffsets[j] = (iMetric & 0x8000)
+                    ? static_cast<int16_t>(iMetric & 0x1fff)
+                    : DMD_RTCP_CCFB_NOT_RECEIVED;
+            }
+            ulOffset += (ulCount * 2 + 3) / 4 * 4;
+            ccfb.vecBlocks.push_back(block);
+        }
+        pFeedbacks->push_back(ccfb);
+    }
+
+    return ulPos == ulSize ? DMD_S_OK : DMD_S_FAIL;
+}
+
+}  // namespace opendmd
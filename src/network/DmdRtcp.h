@@ -0,0 +1,192 @@
+/*
+ ============================================================================
+ * Name        : DmdRtcp.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdRtcp.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_DMDRTCP_H
+#define SRC_NETWORK_DMDRTCP_H
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+#define DMD_RTCP_VERSION            2
+#define DMD_RTCP_HEADER_SIZE        4
+// rfc 3550 sender and receiver reports;
+#define DMD_RTCP_PT_SR              200
+#define DMD_RTCP_PT_RR              201
+#define DMD_RTCP_SENDER_INFO_SIZE   20
+#define DMD_RTCP_REPORT_BLOCK_SIZE  24
+#define DMD_RTCP_MAX_REPORT_BLOCKS  31
+// rfc 4585 transport layer feedback, generic nack;
+#define DMD_RTCP_PT_RTPFB           205
+#define DMD_RTCP_FMT_NACK           1
+// header, sender and media ssrc, then 4 bytes per pid and blp pair;
+#define DMD_RTCP_NACK_FIXED_SIZE    12
+#define DMD_RTCP_NACK_ITEM_SIZE     4
+// rfc 8888 congestion control feedback: header and sender ssrc, per ssrc
+// a block header and 2 bytes per packet, then the report timestamp;
+#define DMD_RTCP_FMT_CCFB           11
+#define DMD_RTCP_CCFB_BLOCK_SIZE    8
+#define DMD_RTCP_CCFB_MAX_REPORTS   16384
+// arrival time offsets are 13 bits of 1/1024 seconds;
+#define DMD_RTCP_CCFB_OVER_RANGE    0x1fff
+#define DMD_RTCP_CCFB_NOT_RECEIVED  -1
+
+// rtcp share of the session bandwidth, and the shortest report interval;
+#define DMD_RTCP_DEFAULT_BANDWIDTH_FRACTION  0.05f
+#define DMD_RTCP_DEFAULT_MIN_INTERVAL_US     500000
+// ipv4 and udp headers, counted against the rtcp bandwidth too;
+#define DMD_RTCP_WIRE_OVERHEAD               28
+
+// seconds from 1900, the ntp era, to 1970, the unix epoch;
+#define DMD_NTP_UNIX_OFFSET_S       2208988800ULL
+
+// what the sender sent, and the media time of an ntp instant;
+typedef struct {
+    uint64_t        ulNtpTime;           // 32.32 fixed point seconds;
+    uint32_t        iRtpTimestamp;       // same instant, media clock;
+    uint32_t        iPacketCount;
+    uint32_t        iOctetCount;         // payload only;
+} DmdRtcpSenderInfo;
+
+// how one ssrc is received, rfc 3550 section 6.4.1;
+typedef struct {
+    uint32_t        iSsrc;               // the source reported on;
+    uint8_t         iFractionLost;       // of 256, since the last report;
+    int32_t         iCumulativeLost;     // 24 bit signed;
+    uint32_t        iExtHighestSeq;      // cycles in the upper 16 bits;
+    uint32_t        iJitter;             // media clock units;
+    uint32_t        iLastSr;             // middle 32 bits of its ntp time;
+    uint32_t        iDelaySinceLastSr;   // 1/65536 seconds;
+} DmdRtcpReportBlock;
+
+// one parsed sender or receiver report;
+typedef struct {
+    uint8_t                          iPacketType;  // sr or rr;
+    uint32_t                         iSsrc;        // the reporter;
+    DmdRtcpSenderInfo                senderInfo;   // sr only;
+    std::vector<DmdRtcpReportBlock>  vecBlocks;
+} DmdRtcpReport;
+
+// one generic nack, the sequence numbers a receiver asks again;
+typedef struct {
+    uint32_t                iSenderSsrc;
+    uint32_t                iMediaSsrc;
+    std::vector<uint16_t>   vecSequences;
+} DmdRtcpNack;
+
+// arrival times of the packets of one ssrc, from iBeginSeq on, each an
+// offset before the report timestamp, DMD_RTCP_CCFB_OVER_RANGE if
+// earlier than that can tell, or DMD_RTCP_CCFB_NOT_RECEIVED;
+typedef struct {
+    uint32_t                iMediaSsrc;
+    uint16_t                iBeginSeq;
+    std::vector<int16_t>    vecArrivalOffsets;   // 1/1024 seconds;
+} DmdRtcpCcfbBlock;
+
+typedef struct {
+    uint32_t                        iSenderSsrc;
+    uint32_t                        iReportTimestamp;  // ntp compact;
+    std::vector<DmdRtcpCcfbBlock>   vecBlocks;
+} DmdRtcpCcfb;
+
+/*
+ * Writes a congestion control feedback packet, ecn not reported; each
+ * block holds at most DMD_RTCP_CCFB_MAX_REPORTS packets.
+ */
+extern DMD_RESULT DmdRtcpWriteCcfb(const DmdRtcpCcfb &ccfb, uint8_t *pBuffer,
+        size_t ulCapacity, size_t *pSize);
+// appends the congestion control feedback of a compound rtcp packet to
+// pFeedbacks, other packet types skipped;
+extern DMD_RESULT DmdRtcpParseCcfbs(const uint8_t *pData, size_t ulSize,
+        std::vector<DmdRtcpCcfb> *pFeedbacks);
+
+/*
+ * Writes a generic nack for iCount sequence numbers, in sending order;
+ * each is packed with up to 16 followers into one pid and blp pair.
+ * pSize receives the bytes written; fails if ulCapacity is too small.
+ */
+extern DMD_RESULT DmdRtcpWriteNack(uint32_t iSenderSsrc, uint32_t iMediaSsrc,
+        const uint16_t *pSequences, unsigned int iCount, uint8_t *pBuffer,
+        size_t ulCapacity, size_t *pSize);
+// appends the generic nacks of a compound rtcp packet to pNacks, other
+// packet types skipped;
+extern DMD_RESULT DmdRtcpParseNacks(const uint8_t *pData, size_t ulSize,
+        std::vector<DmdRtcpNack> *pNacks);
+
+/*
+ * Writes a sender report if pSenderInfo is given, a receiver report
+ * otherwise, with up to DMD_RTCP_MAX_REPORT_BLOCKS report blocks.
+ */
+extern DMD_RESULT DmdRtcpWriteReport(uint32_t iSsrc,
+        const DmdRtcpSenderInfo *pSenderInfo,
+        const DmdRtcpReportBlock *pBlocks, unsigned int iBlockCount,
+        uint8_t *pBuffer, size_t ulCapacity, size_t *pSize);
+// appends the sender and receiver reports of a compound rtcp packet to
+// pReports, other packet types skipped;
+extern DMD_RESULT DmdRtcpParseReports(const uint8_t *pData, size_t ulSize,
+        std::vector<DmdRtcpReport> *pReports);
+
+// ntp time of a wall clock time in microseconds since the unix epoch;
+extern uint64_t DmdNtpFromUs(uint64_t ulWallClockUs);
+extern uint64_t DmdNtpToUs(uint64_t ulNtpTime);
+// the compact form used for lsr and dlsr, 16.16 fixed point seconds;
+inline uint32_t DmdNtpCompact(uint64_t ulNtpTime) {
+    return static_cast<uint32_t>(ulNtpTime >> 16);
+}
+inline uint64_t DmdNtpCompactToUs(uint32_t iCompact) {
+    return (static_cast<uint64_t>(iCompact) * 1000000) >> 16;
+}
+inline uint32_t DmdNtpCompactFromUs(uint64_t ulTimeUs) {
+    return static_cast<uint32_t>((ulTimeUs << 16) / 1000000);
+}
+
+/*
+ * Rfc 3550 section 6.2: the interval at which reports of ulReportBytes
+ * keep rtcp within fBandwidthFraction of ulBandwidthBps, never shorter
+ * than ulMinIntervalUs; a link of unknown rate gets the minimum.
+ */
+extern uint64_t DmdRtcpReportIntervalUs(size_t ulReportBytes,
+        uint64_t ulBandwidthBps, float fBandwidthFraction,
+        uint64_t ulMinIntervalUs);
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_DMDRTCP_H
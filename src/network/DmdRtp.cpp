@@ -0,0 +1,165 @@
+/*
+ ============================================================================
+ * Name        : DmdRtp.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : rtp header helpers, rfc 3550.
+ ============================================================================
+ */
+
+#include "DmdRtp.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+void DmdRtpWriteHeader(const DmdRtpHeader &rtpHeader, uint8_t *pBuffer) {
+    pBuffer[0] = DMD_RTP_VERSION << 6;
+    pBuffer[1] = (rtpHeader.bMarker ? 0x80 : 0x00)
+        | (rtpHeader.iPayloadType & 0x7f);
+    pBuffer[2] = static_cast<uint8_t>(rtpHeader.iSequence >> 8);
+    pBuffer[3] = static_cast<uint8_t>(rtpHeader.iSequence);
+    pBuffer[4] = static_cast<uint8_t>(rtpHeader.iTimestamp >> 24);
+    pBuffer[5] = static_cast<uint8_t>(rtpHeader.iTimestamp >> 16);
+    pBuffer[6] = static_cast<uint8_t>(rtpHeader.iTimestamp >> 8);
+    pBuffer[7] = static_cast<uint8_t>(rtpHeader.iTimestamp);
+    pBuffer[8] = static_cast<uint8_t>(rtpHeader.iSsrc >> 24);
+    pBuffer[9] = static_cast<uint8_t>(rtpHeader.iSsrc >> 16);
+    pBuffer[10] = static_cast<uint8_t>(rtpHeader.iSsrc >> 8);
+    pBuffer[11] = static_cast<uint8_t>(rtpHeader.iSsrc);
+}
+
+DMD_RESULT DmdRtpParseHeader(const uint8_t *pData, size_t ulSize,
+        DmdRtpHeader *pRtpHeader, size_t *pHeaderSize) {
+    if (NULL == pData || NULL == pRtpHeader || ulSize < DMD_RTP_HEADER_SIZE
+            || DMD_RTP_VERSION != (pData[0] >> 6)) {
+        return DMD_S_FAIL;
+    }
+
+    size_t ulHeaderSize = DMD_RTP_HEADER_SIZE + (pData[0] & 0x0f) * 4;
+    if (pData[0] & 0x10) {
+        // extension, 4 byte header with its length in words;
+        if (ulSize < ulHeaderSize + 4) {
+            return DMD_S_FAIL;
+        }
+        ulHeaderSize += 4 + ((pData[ulHeaderSize + 2] << 8)
+                | pData[ulHeaderSize + 3]) * 4;
+    }
+    if (ulSize < ulHeaderSize) {
+        return DMD_S_FAIL;
+    }
+
+    pRtpHeader->bMarker = 0 != (pData[1] & 0x80);
+    pRtpHeader->iPayloadType = pData[1] & 0x7f;
+    pRtpHeader->iSequence = static_cast<uint16_t>((pData[2] << 8) | pData[3]);
+    pRtpHeader->iTimestamp = (static_cast<uint32_t>(pData[4]) << 24)
+        | (pData[5] << 16) | (pData[6] << 8) | pData[7];
+    pRtpHeader->iSsrc = (static_cast<uint32_t>(pData[8]) << 24)
+        | (pData[9] << 16) | (pData[10] << 8) | pData[11];
+    if (pHeaderSize) {
+        *pHeaderSize = ulHeaderSize;
+    }
+    return DMD_S_OK;
+}
+
+uint32_t DmdRtpTimestamp(uint64_t ulTimeUs, uint32_t iClockRate) {
+    // split, so that the product does not overflow for long uptimes;
+    uint64_t ulSeconds = ulTimeUs / 1000000;
+    uint64_t ulRemainUs = ulTimeUs % 1000000;
+    return static_cast<uint32_t>(ulSeconds * iClockRate
+            + ulRemainUs * iClockRate / 1000000);
+}
+
+// byte ulOffset of a packet's gather list, false past its end;
+static bool packetByte(const DmdRtpPacket &packet, size_t ulOffset,
+        uint8_t *pByte) {
+    for (unsigned int i = 0; i < packet.iIovCount; i++) {
+        if (ulOffset < packet.pIov[i].iov_len) {
+            *pByte = static_cast<const uint8_t *>(
+                    packet.pIov[i].iov_base)[ulOffset];
+            return true;
+        }
+        ulOffset -= packet.pIov[i].iov_len;
+    }
+    return false;
+}
+
+DMD_RESULT DmdRtpGetNalInfo(const DmdRtpPacket &packet,
+        DmdRtpNalInfo *pNalInfo) {
+    uint8_t iHeader = 0;
+    if (NULL == pNalInfo || NULL == packet.pIov
+            || !packetByte(packet, DMD_RTP_HEADER_SIZE, &iHeader)) {
+        return DMD_S_FAIL;
+    }
+    // stap-a and fu-a indicators carry the largest nri of their nals;
+    pNalInfo->iNri = iHeader & DMD_H264_NAL_NRI_MASK;
+    pNalInfo->iNalType = iHeader & DMD_H264_NAL_TYPE_MASK;
+    uint8_t iInner = 0;
+    if (DMD_H264_NAL_STAP_A == pNalInfo->iNalType) {
+        // after the indicator and the 16 bit size of the first nal;
+        if (!packetByte(packet, DMD_RTP_HEADER_SIZE + 3, &iInner)) {
+            return DMD_S_FAIL;
+        }
+        pNalInfo->iNalType = iInner & DMD_H264_NAL_TYPE_MASK;
+    } else if (DMD_H264_NAL_FU_A == pNalInfo->iNalType) {
+        if (!packetByte(packet, DMD_RTP_HEADER_SIZE + 1, &iInner)) {
+            return DMD_S_FAIL;
+        }
+        pNalInfo->iNalType = iInner & DMD_H264_NAL_TYPE_MASK;
+    }
+    return DMD_S_OK;
+}
+
+uint32_t DmdRtpRandom() {
+    uint32_t iValue = 0;
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd >= 0) {
+        ssize_t ret = read(fd, &iValue, sizeof(iValue));
+        close(fd);
+        if (sizeof(iValue) == ret) {
+            return iValue;
+        }
+    }
+    // not cryptographic, only has to differ between streams;
+    uint64_t ulSeed = DmdGetTickCountNs() ^ (static_cast<uint64_t>(getpid())
+            << 32);
+    ulSeed ^= ulSeed >> 33;
+    ulSeed *= 0xff51afd7ed558ccdULL;
+    ulSeed ^= ulSeed >> 33;
+    return static_cast<uint32_t>(ulSeed);
+}
+
+}  // namespace opendmd
@@ -0,0 +1,126 @@
+/*
+ ============================================================================
+ * Name        : DmdRtp.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdRtp.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_DMDRTP_H
+#define SRC_NETWORK_DMDRTP_H
+
+#include <sys/uio.h>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+#define DMD_RTP_VERSION             2
+#define DMD_RTP_HEADER_SIZE         12
+// largest rtp packet, header included; leaves room below an ethernet mtu
+// for ip, udp and a tunnel;
+#define DMD_RTP_DEFAULT_MTU         1200
+#define DMD_RTP_H264_PAYLOAD_TYPE   96
+#define DMD_RTP_H264_CLOCK_RATE     90000
+
+// rfc 6184 nal unit types beyond h.264 itself;
+#define DMD_H264_NAL_TYPE_MASK      0x1f
+#define DMD_H264_NAL_NRI_MASK       0x60
+#define DMD_H264_NAL_F_MASK         0x80
+#define DMD_H264_NAL_IDR            5
+#define DMD_H264_NAL_SPS            7
+#define DMD_H264_NAL_STAP_A         24
+#define DMD_H264_NAL_FU_A           28
+#define DMD_H264_FU_START           0x80
+#define DMD_H264_FU_END             0x40
+
+typedef struct {
+    bool            bMarker;
+    uint8_t         iPayloadType;
+    uint16_t        iSequence;
+    uint32_t        iTimestamp;
+    uint32_t        iSsrc;
+} DmdRtpHeader;
+
+/*
+ * One rtp packet as a gather list for sendmsg(): pIov[0] starts with the
+ * rtp header, the payload entries point into the encoder's bitstream
+ * buffer, pFrameBuffer, which a sender holds a reference on to keep the
+ * packet beyond the call that produced it.
+ */
+typedef struct {
+    const struct iovec  *pIov;
+    unsigned int         iIovCount;
+    size_t               ulSize;         // all iovecs, header included;
+    uint16_t             iSequence;
+    uint32_t             iTimestamp;
+    bool                 bMarker;        // last packet of the frame;
+    IDmdFrameBuffer     *pFrameBuffer;   // owns the payload, may be NULL;
+} DmdRtpPacket;
+
+// where packets leave the process, a socket or a test double;
+class IDmdRtpPacketSink {
+public:
+    IDmdRtpPacketSink() {}
+    virtual ~IDmdRtpPacketSink() {}
+    // piSentCount receives the packets taken, the rest are dropped;
+    virtual DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount) = 0;
+};
+
+// fixed 12 byte header, no csrc and no extension;
+extern void DmdRtpWriteHeader(const DmdRtpHeader &rtpHeader,
+        uint8_t *pBuffer);
+// pHeaderSize receives the offset of the payload, csrcs and extension
+// skipped;
+extern DMD_RESULT DmdRtpParseHeader(const uint8_t *pData, size_t ulSize,
+        DmdRtpHeader *pRtpHeader, size_t *pHeaderSize);
+// media clock of a capture time in microseconds, wraps at 32 bits;
+extern uint32_t DmdRtpTimestamp(uint64_t ulTimeUs, uint32_t iClockRate);
+// a random 32 bit value for ssrc, initial sequence and timestamp offset;
+extern uint32_t DmdRtpRandom();
+
+// of the nal unit an h.264 packet carries, or starts with: the first
+// aggregated one of a STAP-A, the fragmented one of a FU-A; fails on a
+// packet too short to tell;
+typedef struct {
+    uint8_t         iNri;                // 0 for a non-reference nal;
+    uint8_t         iNalType;
+} DmdRtpNalInfo;
+extern DMD_RESULT DmdRtpGetNalInfo(const DmdRtpPacket &packet,
+        DmdRtpNalInfo *pNalInfo);
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_DMDRTP_H
@@ -0,0 +1,320 @@
+/*
+ ============================================================================
+ * Name        : DmdSocketUtils.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : socket helpers of the network module.
+ ============================================================================
+ */
+
+#include "DmdSocketUtils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+DMD_RESULT DmdResolveAddress(const char *pHost, uint16_t iPort,
+        struct sockaddr_storage *pAddr, socklen_t *pAddrLen) {
+    if (NULL == pHost || NULL == pAddr || NULL == pAddrLen) {
+        DMD_LOG_ERROR("DmdResolveAddress(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    struct addrinfo *pResult = NULL;
+    int ret = getaddrinfo(pHost, NULL, &hints, &pResult);
+    if (0 != ret || NULL == pResult) {
+        DMD_LOG_ERROR("DmdResolveAddress(), resolve " << pHost
+                << " failed, " << gai_strerror(ret));
+        return DMD_S_FAIL;
+    }
+
+    memset(pAddr, 0, sizeof(*pAddr));
+    memcpy(pAddr, pResult->ai_addr, pResult->ai_addrlen);
+    *pAddrLen = pResult->ai_addrlen;
+    freeaddrinfo(pResult);
+    if (AF_INET == pAddr->ss_family) {
+        reinterpret_cast<struct sockaddr_in *>(pAddr)->sin_port =
+            htons(iPort);
+    } else {
+        reinterpret_cast<struct sockaddr_in6 *>(pAddr)->sin6_port =
+            htons(iPort);
+    }
+
+    return DMD_S_OK;
+}
+
+uint16_t DmdGetAddressPort(const struct sockaddr_storage &addr) {
+    if (AF_INET == addr.ss_family) {
+        return ntohs(reinterpret_cast<const struct sockaddr_in *>(
+                    &addr)->sin_port);
+    }
+    return ntohs(reinterpret_cast<const struct sockaddr_in6 *>(
+                &addr)->sin6_port);
+}
+
+DMD_RESULT DmdSetNonBlocking(int fd, bool bNonBlocking) {
+    int iFlags = fcntl(fd, F_GETFL, 0);
+    if (iFlags < 0) {
+        return DMD_S_FAIL;
+    }
+    iFlags = bNonBlocking ? (iFlags | O_NONBLOCK) : (iFlags & ~O_NONBLOCK);
+    return 0 == fcntl(fd, F_SETFL, iFlags) ? DMD_S_OK : DMD_S_FAIL;
+}
+
+int DmdOpenUdpSocket(const char *pHost, uint16_t iPort,
+        struct sockaddr_storage *pBoundAddr) {
+    struct sockaddr_storage addr;
+    socklen_t iAddrLen = 0;
+    if (DMD_S_OK != DmdResolveAddress(pHost, iPort, &addr, &iAddrLen)) {
+        return -1;
+    }
+
+    int fd = socket(addr.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        DMD_LOG_ERROR("DmdOpenUdpSocket(), socket failed, "
+                << strerror(errno));
+        return -1;
+    }
+    if (0 != bind(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                iAddrLen)) {
+        DMD_LOG_ERROR("DmdOpenUdpSocket(), bind " << pHost << ":" << iPort
+                << " failed, " << strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (pBoundAddr) {
+        socklen_t iBoundLen = sizeof(*pBoundAddr);
+        getsockname(fd, reinterpret_cast<struct sockaddr *>(pBoundAddr),
+                &iBoundLen);
+    }
+
+    return fd;
+}
+
+static bool isSameHost(const struct sockaddr_storage &addr,
+        const struct sockaddr *pOther) {
+    if (NULL == pOther || addr.ss_family != pOther->sa_family) {
+        return false;
+    }
+    if (AF_INET == addr.ss_family) {
+        return reinterpret_cast<const struct sockaddr_in *>(
+                &addr)->sin_addr.s_addr == reinterpret_cast<
+            const struct sockaddr_in *>(pOther)->sin_addr.s_addr;
+    }
+    return 0 == memcmp(&reinterpret_cast<const struct sockaddr_in6 *>(
+                &addr)->sin6_addr, &reinterpret_cast<
+            const struct sockaddr_in6 *>(pOther)->sin6_addr,
+            sizeof(struct in6_addr));
+}
+
+bool DmdIsLocalAddress(const struct sockaddr_storage &addr) {
+    if (AF_INET == addr.ss_family) {
+        uint32_t iAddr = ntohl(reinterpret_cast<const struct sockaddr_in *>(
+                    &addr)->sin_addr.s_addr);
+        if ((iAddr >> 24) == 127) {
+            return true;
+        }
+    } else if (AF_INET6 == addr.ss_family) {
+        if (IN6_IS_ADDR_LOOPBACK(
+                    &reinterpret_cast<const struct sockaddr_in6 *>(
+                        &addr)->sin6_addr)) {
+            return true;
+        }
+    } else {
+        return false;
+    }
+
+    struct ifaddrs *pIfAddrs = NULL;
+    if (0 != getifaddrs(&pIfAddrs)) {
+        DMD_LOG_WARNING("DmdIsLocalAddress(), getifaddrs failed, "
+                << strerror(errno));
+        return false;
+    }
+    bool bLocal = false;
+    for (struct ifaddrs *pIfAddr = pIfAddrs; pIfAddr && !bLocal;
+            pIfAddr = pIfAddr->ifa_next) {
+        bLocal = isSameHost(addr, pIfAddr->ifa_addr);
+    }
+    freeifaddrs(pIfAddrs);
+    return bLocal;
+}
+
+DMD_RESULT DmdSelectTransport(const char *pHost, DmdTransportType *pType) {
+    struct sockaddr_storage addr;
+    socklen_t iAddrLen = 0;
+    if (NULL == pType
+            || DMD_S_OK != DmdResolveAddress(pHost, 0, &addr, &iAddrLen)) {
+        return DMD_S_FAIL;
+    }
+    *pType = DmdIsLocalAddress(addr) ? DmdTransportShm : DmdTransportUdp;
+    DMD_LOG_INFO("DmdSelectTransport(), " << pHost << " is "
+            << (DmdTransportShm == *pType ? "local, shared memory"
+                : "remote, udp"));
+    return DMD_S_OK;
+}
+
+static DMD_RESULT makeUnixAddress(const char *pPath,
+        struct sockaddr_un *pAddr) {
+    if (NULL == pPath || strlen(pPath) >= sizeof(pAddr->sun_path)) {
+        DMD_LOG_ERROR("makeUnixAddress(), invalid path");
+        return DMD_S_FAIL;
+    }
+    memset(pAddr, 0, sizeof(*pAddr));
+    pAddr->sun_family = AF_UNIX;
+    strncpy(pAddr->sun_path, pPath, sizeof(pAddr->sun_path) - 1);
+    return DMD_S_OK;
+}
+
+int DmdListenUnixSocket(const char *pPath) {
+    struct sockaddr_un addr;
+    if (DMD_S_OK != makeUnixAddress(pPath, &addr)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        DMD_LOG_ERROR("DmdListenUnixSocket(), socket failed, "
+                << strerror(errno));
+        return -1;
+    }
+    // a stale socket file of a previous run;
+    unlink(pPath);
+    if (0 != bind(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr)) || 0 != listen(fd, 8)) {
+        DMD_LOG_ERROR("DmdListenUnixSocket(), listen on " << pPath
+                << " failed, " << strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int DmdConnectUnixSocket(const char *pPath) {
+    struct sockaddr_un addr;
+    if (DMD_S_OK != makeUnixAddress(pPath, &addr)) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        DMD_LOG_ERROR("DmdConnectUnixSocket(), socket failed, "
+                << strerror(errno));
+        return -1;
+    }
+    if (0 != connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                sizeof(addr))) {
+        DMD_LOG_ERROR("DmdConnectUnixSocket(), connect to " << pPath
+                << " failed, " << strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+DMD_RESULT DmdSendFds(int iSocket, const int *pFds, unsigned int iCount) {
+    if (NULL == pFds || 0 == iCount || iCount > DMD_MAX_PASSED_FDS) {
+        return DMD_S_FAIL;
+    }
+    char arrControl[CMSG_SPACE(sizeof(int) * DMD_MAX_PASSED_FDS)];
+    memset(arrControl, 0, sizeof(arrControl));
+    // at least one byte of data carries the descriptors;
+    uint8_t iByte = 0;
+    struct iovec iov = {&iByte, 1};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = arrControl;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * iCount);
+    struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg);
+    pCmsg->cmsg_level = SOL_SOCKET;
+    pCmsg->cmsg_type = SCM_RIGHTS;
+    pCmsg->cmsg_len = CMSG_LEN(sizeof(int) * iCount);
+    memcpy(CMSG_DATA(pCmsg), pFds, sizeof(int) * iCount);
+    if (sendmsg(iSocket, &msg, MSG_NOSIGNAL) < 0) {
+        DMD_LOG_ERROR("DmdSendFds(), sendmsg failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    return DMD_S_OK;
+}
+
+DMD_RESULT DmdRecvFds(int iSocket, int *pFds, unsigned int iCount) {
+    if (NULL == pFds || 0 == iCount || iCount > DMD_MAX_PASSED_FDS) {
+        return DMD_S_FAIL;
+    }
+    char arrControl[CMSG_SPACE(sizeof(int) * DMD_MAX_PASSED_FDS)];
+    uint8_t iByte = 0;
+    struct iovec iov = {&iByte, 1};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = arrControl;
+    msg.msg_controllen = sizeof(arrControl);
+    if (recvmsg(iSocket, &msg, MSG_CMSG_CLOEXEC) <= 0) {
+        DMD_LOG_ERROR("DmdRecvFds(), recvmsg failed, " << strerror(errno));
+        return DMD_S_FAIL;
+    }
+    struct cmsghdr *pCmsg = CMSG_FIRSTHDR(&msg);
+    if (NULL == pCmsg || SOL_SOCKET != pCmsg->cmsg_level
+            || SCM_RIGHTS != pCmsg->cmsg_type) {
+        DMD_LOG_ERROR("DmdRecvFds(), no descriptors received");
+        return DMD_S_FAIL;
+    }
+    unsigned int iReceived = (pCmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    int arrFds[DMD_MAX_PASSED_FDS];
+    memcpy(arrFds, CMSG_DATA(pCmsg), sizeof(int) * iReceived);
+    if (iReceived != iCount) {
+        DMD_LOG_ERROR("DmdRecvFds(), " << iReceived << " descriptors, "
+                << iCount << " expected");
+        for (unsigned int i = 0; i < iReceived; i++) {
+            close(arrFds[i]);
+        }
+        return DMD_S_FAIL;
+    }
+    memcpy(pFds, arrFds, sizeof(int) * iCount);
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
@@ -0,0 +1,77 @@
+/*
+ ============================================================================
+ * Name        : DmdSocketUtils.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdSocketUtils.h
+ ============================================================================
+ */
+
+#ifndef SRC_NETWORK_DMDSOCKETUTILS_H
+#define SRC_NETWORK_DMDSOCKETUTILS_H
+
+#include <sys/socket.h>
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+
+namespace opendmd {
+
+// numeric or named host, ipv4 or ipv6;
+extern DMD_RESULT DmdResolveAddress(const char *pHost, uint16_t iPort,
+        struct sockaddr_storage *pAddr, socklen_t *pAddrLen);
+extern uint16_t DmdGetAddressPort(const struct sockaddr_storage &addr);
+extern DMD_RESULT DmdSetNonBlocking(int fd, bool bNonBlocking);
+// a udp socket bound to pHost:iPort, iPort 0 for any port;
+extern int DmdOpenUdpSocket(const char *pHost, uint16_t iPort,
+        struct sockaddr_storage *pBoundAddr);
+
+// loopback, or an address of one of our interfaces;
+extern bool DmdIsLocalAddress(const struct sockaddr_storage &addr);
+// shared memory when pHost is this box, udp otherwise;
+extern DMD_RESULT DmdSelectTransport(const char *pHost,
+        DmdTransportType *pType);
+
+#define DMD_MAX_PASSED_FDS  4
+
+// seqpacket unix sockets, for handing descriptors between processes;
+extern int DmdListenUnixSocket(const char *pPath);
+extern int DmdConnectUnixSocket(const char *pPath);
+// iCount descriptors in one message, scm_rights;
+extern DMD_RESULT DmdSendFds(int iSocket, const int *pFds,
+        unsigned int iCount);
+extern DMD_RESULT DmdRecvFds(int iSocket, int *pFds, unsigned int iCount);
+
+}  // namespace opendmd
+
+#endif  // SRC_NETWORK_DMDSOCKETUTILS_H
@@ -0,0 +1,328 @@
+/*
+ ============================================================================
+ * Name        : CDmdColorConvert.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdColorConvert.cpp
+ ============================================================================
+ */
+
+#include "CDmdColorConvert.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+void DmdSetupI420Planes(DmdVideoRawData *pVideoRawData, uint8_t *pBuffer,
+        unsigned int iWidth, unsigned int iHeight) {
+    unsigned int iChromaWidth = (iWidth + 1) / 2;
+    unsigned int iChromaHeight = (iHeight + 1) / 2;
+
+    pVideoRawData->pSrcData = pBuffer;
+    pVideoRawData->pSrcDataPanel[0] = pBuffer;
+    pVideoRawData->pSrcDataPanel[1] = pBuffer + iWidth * iHeight;
+    pVideoRawData->pSrcDataPanel[2] = pVideoRawData->pSrcDataPanel[1]
+        + iChromaWidth * iChromaHeight;
+    pVideoRawData->ulSrcDataStride[0] = iWidth;
+    pVideoRawData->ulSrcDataStride[1] = iChromaWidth;
+    pVideoRawData->ulSrcDataStride[2] = iChromaWidth;
+    pVideoRawData->ulSrcDataLength[0] = iWidth * iHeight;
+    pVideoRawData->ulSrcDataLength[1] = iChromaWidth * iChromaHeight;
+    pVideoRawData->ulSrcDataLength[2] = iChromaWidth * iChromaHeight;
+    pVideoRawData->ulPlaneCount = 3;
+    pVideoRawData->ulDataLen = DmdI420FrameSize(iWidth, iHeight);
+    pVideoRawData->fmtVideoFormat.eVideoType = DmdI420;
+    pVideoRawData->fmtVideoFormat.iWidth = iWidth;
+    pVideoRawData->fmtVideoFormat.iHeight = iHeight;
+}
+
+size_t DmdI420FrameSize(unsigned int iWidth, unsigned int iHeight) {
+    size_t ulChroma = ((iWidth + 1) / 2) * ((iHeight + 1) / 2);
+    return iWidth * iHeight + 2 * ulChroma;
+}
+
+void DmdFixupRawDataPlanes(DmdVideoRawData *pVideoRawData) {
+    if (pVideoRawData->pSrcDataPanel[0] || !pVideoRawData->pSrcData) {
+        return;
+    }
+
+    unsigned int iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    uint8_t *pData = pVideoRawData->pSrcData;
+    switch (pVideoRawData->fmtVideoFormat.eVideoType) {
+        case DmdI420:
+            DmdSetupI420Planes(pVideoRawData, pData, iWidth, iHeight);
+            break;
+        case DmdNV12:
+        case DmdNV21:
+            pVideoRawData->pSrcDataPanel[0] = pData;
+            pVideoRawData->pSrcDataPanel[1] = pData + iWidth * iHeight;
+            pVideoRawData->ulSrcDataStride[0] = iWidth;
+            pVideoRawData->ulSrcDataStride[1] = (iWidth + 1) & ~1U;
+            pVideoRawData->ulPlaneCount = 2;
+            break;
+        case DmdYUYV:
+        case DmdUYVY:
+            pVideoRawData->pSrcDataPanel[0] = pData;
+            pVideoRawData->ulSrcDataStride[0] = iWidth * 2;
+            pVideoRawData->ulPlaneCount = 1;
+            break;
+        default:
+            break;
+    }
+}
+
+static inline void maskLumaRow(const CDmdPrivacyMask *pMask, uint8_t *pRow,
+        unsigned int iRow) {
+    if (pMask) {
+        size_t ulCount = 0;
+        const DmdMaskSpan *pSpans = pMask->GetLumaSpans(iRow, &ulCount);
+        DmdFillMaskSpans(pRow, pSpans, ulCount, DMD_PRIVACY_MASK_LUMA);
+    }
+}
+
+static inline void maskChromaRow(const CDmdPrivacyMask *pMask,
+        uint8_t *pRow, unsigned int iRow) {
+    if (pMask) {
+        size_t ulCount = 0;
+        const DmdMaskSpan *pSpans = pMask->GetChromaSpans(iRow, &ulCount);
+        DmdFillMaskSpans(pRow, pSpans, ulCount, DMD_PRIVACY_MASK_CHROMA);
+    }
+}
+
+// packed 4:2:2 to I420, chroma is taken from even lines only;
+// the lone last pixel of an odd width row is half a macropixel, with one
+// of its chroma samples; the other is taken from the pair before it;
+static uint8_t packedChroma(const uint8_t *pLine, size_t ulRowBytes,
+        size_t ulOffset) {
+    if (ulOffset < ulRowBytes) {
+        return pLine[ulOffset];
+    }
+    return ulOffset >= 4 ? pLine[ulOffset - 4] : 128;
+}
+
+static void convertPacked422ToI420(const DmdVideoRawData *pSrc,
+        DmdVideoRawData *pDst, const CDmdPrivacyMask *pMask,
+        int iYOffset, int iUOffset, int iVOffset) {
+    unsigned int iWidth = pSrc->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pSrc->fmtVideoFormat.iHeight;
+    unsigned int iChromaWidth = (iWidth + 1) / 2;
+    size_t ulSrcStride = pSrc->ulSrcDataStride[0];
+    size_t ulRowBytes = 2 * iWidth;
+
+    for (unsigned int y = 0; y < iHeight; y++) {
+        const uint8_t *pLine = pSrc->pSrcDataPanel[0] + y * ulSrcStride;
+        uint8_t *pY = pDst->pSrcDataPanel[0] + y * pDst->ulSrcDataStride[0];
+        for (unsigned int x = 0; x < iWidth; x++) {
+            pY[x] = pLine[2 * x + iYOffset];
+        }
+        maskLumaRow(pMask, pY, y);
+
+        if (y & 1) {
+            continue;
+        }
+        uint8_t *pU = pDst->pSrcDataPanel[1]
+            + (y / 2) * pDst->ulSrcDataStride[1];
+        uint8_t *pV = pDst->pSrcDataPanel[2]
+            + (y / 2) * pDst->ulSrcDataStride[2];
+        for (unsigned int x = 0; x < iChromaWidth; x++) {
+            pU[x] = packedChroma(pLine, ulRowBytes, 4 * x + iUOffset);
+            pV[x] = packedChroma(pLine, ulRowBytes, 4 * x + iVOffset);
+        }
+        maskChromaRow(pMask, pU, y / 2);
+        maskChromaRow(pMask, pV, y / 2);
+    }
+}
+
+static void convertSemiPlanarToI420(const DmdVideoRawData *pSrc,
+        DmdVideoRawData *pDst, const CDmdPrivacyMask *pMask, bool bSwapUV) {
+    unsigned int iWidth = pSrc->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pSrc->fmtVideoFormat.iHeight;
+    unsigned int iChromaWidth = (iWidth + 1) / 2;
+    unsigned int iChromaHeight = (iHeight + 1) / 2;
+
+    for (unsigned int y = 0; y < iHeight; y++) {
+        uint8_t *pY = pDst->pSrcDataPanel[0] + y * pDst->ulSrcDataStride[0];
+        memcpy(pY, pSrc->pSrcDataPanel[0] + y * pSrc->ulSrcDataStride[0],
+                iWidth);
+        maskLumaRow(pMask, pY, y);
+    }
+
+    uint8_t *pU = pDst->pSrcDataPanel[bSwapUV ? 2 : 1];
+    uint8_t *pV = pDst->pSrcDataPanel[bSwapUV ? 1 : 2];
+    for (unsigned int y = 0; y < iChromaHeight; y++) {
+        const uint8_t *pUV = pSrc->pSrcDataPanel[1]
+            + y * pSrc->ulSrcDataStride[1];
+        uint8_t *pULine = pU + y * pDst->ulSrcDataStride[1];
+        uint8_t *pVLine = pV + y * pDst->ulSrcDataStride[2];
+        for (unsigned int x = 0; x < iChromaWidth; x++) {
+            pULine[x] = pUV[2 * x];
+            pVLine[x] = pUV[2 * x + 1];
+        }
+        maskChromaRow(pMask, pULine, y);
+        maskChromaRow(pMask, pVLine, y);
+    }
+}
+
+static void copyI420(const DmdVideoRawData *pSrc, DmdVideoRawData *pDst,
+        const CDmdPrivacyMask *pMask) {
+    unsigned int iWidth = pSrc->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pSrc->fmtVideoFormat.iHeight;
+    unsigned int arrWidth[3] = {iWidth, (iWidth + 1) / 2, (iWidth + 1) / 2};
+    unsigned int arrHeight[3] = {iHeight, (iHeight + 1) / 2,
+        (iHeight + 1) / 2};
+
+    for (int i = 0; i < 3; i++) {
+        for (unsigned int y = 0; y < arrHeight[i]; y++) {
+            uint8_t *pRow = pDst->pSrcDataPanel[i]
+                + y * pDst->ulSrcDataStride[i];
+            memcpy(pRow,
+                    pSrc->pSrcDataPanel[i] + y * pSrc->ulSrcDataStride[i],
+                    arrWidth[i]);
+            if (0 == i) {
+                maskLumaRow(pMask, pRow, y);
+            } else {
+                maskChromaRow(pMask, pRow, y);
+            }
+        }
+    }
+}
+
+DMD_RESULT DmdConvertToI420(const DmdVideoRawData *pSrc,
+        DmdVideoRawData *pDst, const CDmdPrivacyMask *pMask) {
+    if (NULL == pSrc || NULL == pDst || NULL == pSrc->pSrcDataPanel[0]) {
+        DMD_LOG_ERROR("DmdConvertToI420(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    if (pSrc->fmtVideoFormat.iWidth != pDst->fmtVideoFormat.iWidth
+            || pSrc->fmtVideoFormat.iHeight != pDst->fmtVideoFormat.iHeight) {
+        DMD_LOG_ERROR("DmdConvertToI420(), resolution mismatch");
+        return DMD_S_FAIL;
+    }
+    if (pMask && (pMask->GetWidth() != pSrc->fmtVideoFormat.iWidth
+            || pMask->GetHeight() != pSrc->fmtVideoFormat.iHeight)) {
+        DMD_LOG_ERROR("DmdConvertToI420(), privacy mask is built for "
+                << pMask->GetWidth() << "x" << pMask->GetHeight());
+        return DMD_S_FAIL;
+    }
+
+    switch (pSrc->fmtVideoFormat.eVideoType) {
+        case DmdI420:
+            copyI420(pSrc, pDst, pMask);
+            break;
+        case DmdYUYV:
+            convertPacked422ToI420(pSrc, pDst, pMask, 0, 1, 3);
+            break;
+        case DmdUYVY:
+            convertPacked422ToI420(pSrc, pDst, pMask, 1, 0, 2);
+            break;
+        case DmdNV12:
+            convertSemiPlanarToI420(pSrc, pDst, pMask, false);
+            break;
+        case DmdNV21:
+            convertSemiPlanarToI420(pSrc, pDst, pMask, true);
+            break;
+        default:
+            DMD_LOG_ERROR("DmdConvertToI420(), unsupported video type "
+                    << pSrc->fmtVideoFormat.eVideoType);
+            return DMD_S_FAIL;
+    }
+
+    pDst->fmtVideoFormat.fFrameRate = pSrc->fmtVideoFormat.fFrameRate;
+    pDst->fmtVideoFormat.ulTimestamp = pSrc->fmtVideoFormat.ulTimestamp;
+    pDst->ulRotation = pSrc->ulRotation;
+
+    return DMD_S_OK;
+}
+
+unsigned int DmdDownscaledSize(unsigned int iSize, unsigned int iDivisor) {
+    return iDivisor ? (iSize / iDivisor) & ~1U : 0;
+}
+
+static void downscalePlane(const uint8_t *pSrc, size_t ulSrcStride,
+        uint8_t *pDst, size_t ulDstStride, unsigned int iDstWidth,
+        unsigned int iDstHeight, unsigned int iDivisor) {
+    unsigned int iArea = iDivisor * iDivisor;
+    for (unsigned int y = 0; y < iDstHeight; y++) {
+        const uint8_t *pBlockRow = pSrc + y * iDivisor * ulSrcStride;
+        uint8_t *pDstRow = pDst + y * ulDstStride;
+        for (unsigned int x = 0; x < iDstWidth; x++) {
+            const uint8_t *pBlock = pBlockRow + x * iDivisor;
+            unsigned int iSum = 0;
+            for (unsigned int j = 0; j < iDivisor; j++) {
+                for (unsigned int i = 0; i < iDivisor; i++) {
+                    iSum += pBlock[j * ulSrcStride + i];
+                }
+            }
+            pDstRow[x] = static_cast<uint8_t>((iSum + iArea / 2) / iArea);
+        }
+    }
+}
+
+DMD_RESULT DmdDownscaleI420(const DmdVideoRawData *pSrc,
+        DmdVideoRawData *pDst, unsigned int iDivisor) {
+    if (NULL == pSrc || NULL == pDst || 0 == iDivisor
+            || NULL == pSrc->pSrcDataPanel[0]
+            || DmdI420 != pSrc->fmtVideoFormat.eVideoType) {
+        DMD_LOG_ERROR("DmdDownscaleI420(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    unsigned int iWidth = DmdDownscaledSize(pSrc->fmtVideoFormat.iWidth,
+            iDivisor);
+    unsigned int iHeight = DmdDownscaledSize(pSrc->fmtVideoFormat.iHeight,
+            iDivisor);
+    if (0 == iWidth || 0 == iHeight
+            || iWidth != pDst->fmtVideoFormat.iWidth
+            || iHeight != pDst->fmtVideoFormat.iHeight) {
+        DMD_LOG_ERROR("DmdDownscaleI420(), resolution mismatch");
+        return DMD_S_FAIL;
+    }
+
+    unsigned int arrWidth[3] = {iWidth, iWidth / 2, iWidth / 2};
+    unsigned int arrHeight[3] = {iHeight, iHeight / 2, iHeight / 2};
+    for (int i = 0; i < 3; i++) {
+        downscalePlane(pSrc->pSrcDataPanel[i], pSrc->ulSrcDataStride[i],
+                pDst->pSrcDataPanel[i], pDst->ulSrcDataStride[i],
+                arrWidth[i], arrHeight[i], iDivisor);
+    }
+
+    pDst->fmtVideoFormat.fFrameRate = pSrc->fmtVideoFormat.fFrameRate;
+    pDst->fmtVideoFormat.ulTimestamp = pSrc->fmtVideoFormat.ulTimestamp;
+    pDst->ulRotation = pSrc->ulRotation;
+
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
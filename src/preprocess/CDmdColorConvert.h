@@ -0,0 +1,72 @@
+/*
+ ============================================================================
+ * Name        : CDmdColorConvert.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdColorConvert.h
+ ============================================================================
+ */
+
+#ifndef SRC_PREPROCESS_CDMDCOLORCONVERT_H
+#define SRC_PREPROCESS_CDMDCOLORCONVERT_H
+
+#include "IDmdDatatype.h"
+#include "CDmdPrivacyMask.h"
+
+namespace opendmd {
+
+// fill plane pointers and strides of a tightly packed I420 buffer;
+extern void DmdSetupI420Planes(DmdVideoRawData *pVideoRawData,
+        uint8_t *pBuffer, unsigned int iWidth, unsigned int iHeight);
+extern size_t DmdI420FrameSize(unsigned int iWidth, unsigned int iHeight);
+
+// fill plane pointers of a raw frame that only carries pSrcData;
+extern void DmdFixupRawDataPlanes(DmdVideoRawData *pVideoRawData);
+
+// the conversion pass, from any supported capture format to I420, privacy
+// mask spans are filled row by row as each output row is written;
+extern DMD_RESULT DmdConvertToI420(const DmdVideoRawData *pSrc,
+        DmdVideoRawData *pDst, const CDmdPrivacyMask *pMask = NULL);
+
+// box filter downscale of an I420 frame, each output pixel averages an
+// iDivisor x iDivisor block; pDst is set up for the reduced resolution,
+// see DmdDownscaledSize();
+extern DMD_RESULT DmdDownscaleI420(const DmdVideoRawData *pSrc,
+        DmdVideoRawData *pDst, unsigned int iDivisor);
+// reduced size, kept even for 4:2:0 chroma;
+extern unsigned int DmdDownscaledSize(unsigned int iSize,
+        unsigned int iDivisor);
+
+}  // namespace opendmd
+
+#endif  // SRC_PREPROCESS_CDMDCOLORCONVERT_H
@@ -0,0 +1,303 @@
+/*
+ ============================================================================
+ * Name        : CDmdMotionDetector.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdMotionDetector.cpp
+ ============================================================================
+ */
+
+#include "CDmdMotionDetector.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+uint32_t DmdBlockSadC(const uint8_t *pCur, size_t ulCurStride,
+        const uint8_t *pRef, size_t ulRefStride, unsigned int iWidth,
+        unsigned int iRows) {
+    uint32_t iSad = 0;
+    for (unsigned int y = 0; y < iRows; y++) {
+        for (unsigned int x = 0; x < iWidth; x++) {
+            iSad += abs(static_cast<int>(pCur[x]) - pRef[x]);
+        }
+        pCur += ulCurStride;
+        pRef += ulRefStride;
+    }
+
+    return iSad;
+}
+
+uint32_t DmdBlockSad(const uint8_t *pCur, size_t ulCurStride,
+        const uint8_t *pRef, size_t ulRefStride, unsigned int iWidth,
+        unsigned int iRows) {
+#if defined(__SSE2__)
+    unsigned int iSimdWidth = iWidth & ~15U;
+    __m128i sum = _mm_setzero_si128();
+    const uint8_t *pCurRow = pCur;
+    const uint8_t *pRefRow = pRef;
+    for (unsigned int y = 0; y < iRows; y++) {
+        for (unsigned int x = 0; x < iSimdWidth; x += 16) {
+            __m128i cur = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(pCurRow + x));
+            __m128i ref = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(pRefRow + x));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(cur, ref));
+        }
+        pCurRow += ulCurStride;
+        pRefRow += ulRefStride;
+    }
+    uint32_t iSad = _mm_cvtsi128_si32(sum)
+        + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+    if (iSimdWidth < iWidth) {
+        iSad += DmdBlockSadC(pCur + iSimdWidth, ulCurStride,
+                pRef + iSimdWidth, ulRefStride, iWidth - iSimdWidth, iRows);
+    }
+
+    return iSad;
+#else
+    return DmdBlockSadC(pCur, ulCurStride, pRef, ulRefStride, iWidth, iRows);
+#endif
+}
+
+CDmdMotionDetector::CDmdMotionDetector() : m_iWidth(0), m_iHeight(0),
+        m_pReference(NULL), m_bReferenceValid(false), m_pBackground(NULL),
+        m_bBackgroundValid(false), m_iStableCount(0) {
+    memset(&m_motionParam, 0, sizeof(m_motionParam));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdMotionDetector::~CDmdMotionDetector() {
+    releaseReference();
+}
+
+DMD_RESULT CDmdMotionDetector::Init(
+        const DmdMotionDetectParam &motionParam) {
+    DMD_LOG_INFO("CDmdMotionDetector::Init()"
+            << ", enable = " << motionParam.bEnable
+            << ", block size = " << motionParam.iBlockSize
+            << ", pixel threshold = " << motionParam.iPixelThreshold
+            << ", min changed permille = "
+            << motionParam.iMinChangedPermille);
+    if (motionParam.bEnable && motionParam.iBlockSize < 2) {
+        DMD_LOG_ERROR("CDmdMotionDetector::Init(), invalid block size "
+                << motionParam.iBlockSize);
+        return DMD_S_FAIL;
+    }
+
+    m_motionParam = motionParam;
+    memset(&m_stats, 0, sizeof(m_stats));
+    Reset();
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdMotionDetector::Uninit() {
+    releaseReference();
+
+    return DMD_S_OK;
+}
+
+void CDmdMotionDetector::Reset() {
+    m_bReferenceValid = false;
+    m_bBackgroundValid = false;
+    m_iStableCount = 0;
+}
+
+void CDmdMotionDetector::GetStats(DmdMotionStats *pStats) {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+DMD_RESULT CDmdMotionDetector::allocReference(unsigned int iWidth,
+        unsigned int iHeight) {
+    releaseReference();
+
+    size_t ulRowsSize = iWidth * ((iHeight + 1) / 2);
+    m_pReference = new uint8_t[ulRowsSize];
+    m_pBackground = new uint8_t[ulRowsSize];
+    if (NULL == m_pReference || NULL == m_pBackground) {
+        DMD_LOG_ERROR("CDmdMotionDetector::allocReference(), "
+                << "failed to allocate reference rows");
+        releaseReference();
+        return DMD_S_FAIL;
+    }
+    m_iWidth = iWidth;
+    m_iHeight = iHeight;
+
+    return DMD_S_OK;
+}
+
+void CDmdMotionDetector::releaseReference() {
+    if (m_pReference) {
+        delete [] m_pReference;
+        m_pReference = NULL;
+    }
+    if (m_pBackground) {
+        delete [] m_pBackground;
+        m_pBackground = NULL;
+    }
+    m_iWidth = 0;
+    m_iHeight = 0;
+    m_bReferenceValid = false;
+    m_bBackgroundValid = false;
+    m_iStableCount = 0;
+}
+
+bool CDmdMotionDetector::isBlockExcluded(const CDmdPrivacyMask *pMask,
+        unsigned int iX, unsigned int iY, unsigned int iBlockWidth,
+        unsigned int iBlockHeight) {
+    if (NULL == pMask) {
+        return false;
+    }
+
+    // mostly masked blocks only ever see the fill value;
+    return 2 * pMask->CountMaskedPixels(iX, iY, iBlockWidth, iBlockHeight)
+        > iBlockWidth * iBlockHeight;
+}
+
+unsigned int CDmdMotionDetector::compareRows(
+        const DmdVideoRawData *pVideoRawData, const uint8_t *pRows,
+        const CDmdPrivacyMask *pMask, unsigned int *pChangedBlocks,
+        unsigned int *pActiveBlocks) {
+    const uint8_t *pLuma = pVideoRawData->pSrcDataPanel[0];
+    size_t ulStride = pVideoRawData->ulSrcDataStride[0];
+    unsigned int iBlockSize = m_motionParam.iBlockSize;
+    unsigned int iChangedBlocks = 0;
+    unsigned int iActiveBlocks = 0;
+    for (unsigned int y = 0; y < m_iHeight; y += iBlockSize) {
+        unsigned int iBlockHeight = m_iHeight - y < iBlockSize
+            ? m_iHeight - y : iBlockSize;
+        unsigned int iRows = (iBlockHeight + 1) / 2;
+        for (unsigned int x = 0; x < m_iWidth; x += iBlockSize) {
+            unsigned int iBlockWidth = m_iWidth - x < iBlockSize
+                ? m_iWidth - x : iBlockSize;
+            if (isBlockExcluded(pMask, x, y, iBlockWidth, iBlockHeight)) {
+                continue;
+            }
+            iActiveBlocks++;
+            uint32_t iSad = DmdBlockSad(pLuma + y * ulStride + x,
+                    2 * ulStride, pRows + (y / 2) * m_iWidth + x,
+                    m_iWidth, iBlockWidth, iRows);
+            if (iSad > m_motionParam.iPixelThreshold * iBlockWidth * iRows) {
+                iChangedBlocks++;
+            }
+        }
+    }
+
+    *pChangedBlocks = iChangedBlocks;
+    *pActiveBlocks = iActiveBlocks;
+    return iActiveBlocks ? iChangedBlocks * 1000 / iActiveBlocks : 0;
+}
+
+void CDmdMotionDetector::copyRows(const DmdVideoRawData *pVideoRawData,
+        uint8_t *pRows) {
+    const uint8_t *pLuma = pVideoRawData->pSrcDataPanel[0];
+    size_t ulStride = pVideoRawData->ulSrcDataStride[0];
+    for (unsigned int y = 0; y < m_iHeight; y += 2) {
+        memcpy(pRows + (y / 2) * m_iWidth, pLuma + y * ulStride, m_iWidth);
+    }
+}
+
+DMD_RESULT CDmdMotionDetector::Process(const DmdVideoRawData *pVideoRawData,
+        const CDmdPrivacyMask *pMask, DmdMotionResult *pResult) {
+    if (NULL == pVideoRawData || NULL == pResult
+            || DmdI420 != pVideoRawData->fmtVideoFormat.eVideoType) {
+        return DMD_S_FAIL;
+    }
+
+    uint64_t ulStart = DmdGetTickCountUs();
+    memset(pResult, 0, sizeof(*pResult));
+    unsigned int iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    if (NULL == m_pReference || iWidth != m_iWidth || iHeight != m_iHeight) {
+        if (DMD_S_OK != allocReference(iWidth, iHeight)) {
+            return DMD_S_FAIL;
+        }
+    }
+
+    if (m_bReferenceValid) {
+        pResult->iChangedPermille = compareRows(pVideoRawData, m_pReference,
+                pMask, &pResult->iChangedBlocks, &pResult->iActiveBlocks);
+        pResult->bMotion = pResult->iChangedBlocks > 0
+            && pResult->iChangedPermille
+                >= m_motionParam.iMinChangedPermille;
+    } else {
+        // nothing to compare with, let the encoder start at full rate;
+        pResult->bMotion = true;
+    }
+
+    // only a frame in motion may return to the background;
+    if (pResult->bMotion && m_bBackgroundValid) {
+        unsigned int iChangedBlocks = 0;
+        unsigned int iActiveBlocks = 0;
+        unsigned int iPermille = compareRows(pVideoRawData, m_pBackground,
+                pMask, &iChangedBlocks, &iActiveBlocks);
+        pResult->bBackground = 0 == iChangedBlocks
+            || iPermille < m_motionParam.iMinChangedPermille;
+    }
+
+    copyRows(pVideoRawData, m_pReference);
+    m_bReferenceValid = true;
+    m_iStableCount = pResult->bMotion ? 0 : m_iStableCount + 1;
+    if (m_iStableCount
+            && (DMD_MOTION_BACKGROUND_STABLE_FRAMES == m_iStableCount
+                || 0 == m_iStableCount % DMD_MOTION_BACKGROUND_REFRESH)) {
+        copyRows(pVideoRawData, m_pBackground);
+        m_bBackgroundValid = true;
+    }
+
+    uint64_t ulCost = DmdGetTickCountUs() - ulStart;
+    m_stats.ulFrameCount++;
+    if (pResult->bMotion) {
+        m_stats.ulMotionFrameCount++;
+    }
+    if (pResult->bBackground) {
+        m_stats.ulBackgroundFrameCount++;
+    }
+    m_stats.ulLastCostUs = ulCost;
+    m_stats.ulTotalCostUs += ulCost;
+
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
@@ -0,0 +1,140 @@
+/*
+ ============================================================================
+ * Name        : CDmdMotionDetector.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdMotionDetector.h
+ ============================================================================
+ */
+
+#ifndef SRC_PREPROCESS_CDMDMOTIONDETECTOR_H
+#define SRC_PREPROCESS_CDMDMOTIONDETECTOR_H
+
+#include "IDmdDatatype.h"
+#include "CDmdPrivacyMask.h"
+
+namespace opendmd {
+
+#define DMD_MOTION_DEFAULT_BLOCK_SIZE       16
+#define DMD_MOTION_DEFAULT_PIXEL_THRESHOLD  8
+#define DMD_MOTION_DEFAULT_MIN_PERMILLE     4
+// stable frames before the scene is taken as background, and the refresh
+// period of the background while it stays stable;
+#define DMD_MOTION_BACKGROUND_STABLE_FRAMES 3
+#define DMD_MOTION_BACKGROUND_REFRESH       30
+
+typedef struct {
+    bool            bEnable;
+    unsigned int    iBlockSize;           // multiple of 16 for the simd path;
+    unsigned int    iPixelThreshold;      // mean abs diff of a changed block;
+    unsigned int    iMinChangedPermille;  // changed area regarded as motion;
+} DmdMotionDetectParam;
+
+typedef struct {
+    bool            bMotion;
+    unsigned int    iChangedBlocks;
+    unsigned int    iActiveBlocks;        // blocks outside privacy zones;
+    unsigned int    iChangedPermille;
+    bool            bBackground;          // motion back to the background;
+} DmdMotionResult;
+
+typedef struct {
+    uint64_t        ulFrameCount;
+    uint64_t        ulMotionFrameCount;
+    uint64_t        ulBackgroundFrameCount;
+    uint64_t        ulLastCostUs;
+    uint64_t        ulTotalCostUs;
+} DmdMotionStats;
+
+/*
+ * Lightweight change detector on the luma plane, meant to gate the
+ * encoder rather than to classify events. The frame is split into blocks,
+ * the mean absolute difference of each block against the previous frame
+ * is taken on every second row, and the scene is in motion when enough of
+ * the blocks outside privacy zones changed. Runs after temporal denoise,
+ * so sensor noise is mostly gone by then.
+ *
+ * The scene is also kept as background once it has been stable for a few
+ * frames. A frame in motion is compared with that background as well, and
+ * flagged when it matches, as when an object leaves; the encoder then
+ * predicts it from the long term reference of the same background.
+ */
+class CDmdMotionDetector {
+public:
+    CDmdMotionDetector();
+    ~CDmdMotionDetector();
+
+    DMD_RESULT Init(const DmdMotionDetectParam &motionParam);
+    DMD_RESULT Uninit();
+    // forget the reference frame, the next frame reports motion;
+    void Reset();
+
+    DMD_RESULT Process(const DmdVideoRawData *pVideoRawData,
+            const CDmdPrivacyMask *pMask, DmdMotionResult *pResult);
+    void GetStats(DmdMotionStats *pStats);
+
+private:
+    DMD_RESULT allocReference(unsigned int iWidth, unsigned int iHeight);
+    void releaseReference();
+    bool isBlockExcluded(const CDmdPrivacyMask *pMask, unsigned int iX,
+            unsigned int iY, unsigned int iBlockWidth,
+            unsigned int iBlockHeight);
+    // changed permille of the frame against rows of pRows;
+    unsigned int compareRows(const DmdVideoRawData *pVideoRawData,
+            const uint8_t *pRows, const CDmdPrivacyMask *pMask,
+            unsigned int *pChangedBlocks, unsigned int *pActiveBlocks);
+    void copyRows(const DmdVideoRawData *pVideoRawData, uint8_t *pRows);
+
+private:
+    DmdMotionDetectParam m_motionParam;
+    unsigned int    m_iWidth;
+    unsigned int    m_iHeight;
+    uint8_t        *m_pReference;  // every second luma row of last frame;
+    bool            m_bReferenceValid;
+    uint8_t        *m_pBackground; // same rows of the stable scene;
+    bool            m_bBackgroundValid;
+    unsigned int    m_iStableCount;
+    DmdMotionStats  m_stats;
+};
+
+// sad of iRows rows, exposed for unittest;
+extern uint32_t DmdBlockSad(const uint8_t *pCur, size_t ulCurStride,
+        const uint8_t *pRef, size_t ulRefStride, unsigned int iWidth,
+        unsigned int iRows);
+extern uint32_t DmdBlockSadC(const uint8_t *pCur, size_t ulCurStride,
+        const uint8_t *pRef, size_t ulRefStride, unsigned int iWidth,
+        unsigned int iRows);
+
+}  // namespace opendmd
+
+#endif  // SRC_PREPROCESS_CDMDMOTIONDETECTOR_H
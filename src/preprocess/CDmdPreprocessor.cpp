@@ -0,0 +1,288 @@
+/*
+ ============================================================================
+ * Name        : CDmdPreprocessor.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdPreprocessor.cpp
+ ============================================================================
+ */
+
+#include "CDmdPreprocessor.h"
+
+#include <string.h>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+#include "CDmdColorConvert.h"
+
+namespace opendmd {
+
+CDmdPreprocessor::CDmdPreprocessor() : m_pDataSink(NULL),
+        m_bMotionDetect(false), m_pFramePool(new DmdFramePool()),
+        m_iOutputWidth(0), m_iOutputHeight(0), m_ulMaskUpdateCount(0),
+        m_iFrameWidth(0), m_iFrameHeight(0) {
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdPreprocessor::~CDmdPreprocessor() {
+}
+
+DMD_RESULT CDmdPreprocessor::Init(const DmdPreprocessParam &preprocessParam) {
+    DMD_LOG_INFO("CDmdPreprocessor::Init()"
+            << ", denoise strength = "
+            << preprocessParam.denoiseParam.iStrength
+            << ", denoise threshold = "
+            << preprocessParam.denoiseParam.iThreshold);
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    if (DMD_S_OK != m_temporalDenoise.Init(preprocessParam.denoiseParam)) {
+        return DMD_S_FAIL;
+    }
+    m_bMotionDetect = preprocessParam.motionParam.bEnable;
+    m_pLastMotionMask.reset();
+
+    return m_motionDetector.Init(preprocessParam.motionParam);
+}
+
+DMD_RESULT CDmdPreprocessor::Uninit() {
+    m_temporalDenoise.Uninit();
+    m_motionDetector.Uninit();
+    m_iOutputWidth = 0;
+    m_iOutputHeight = 0;
+
+    return DMD_S_OK;
+}
+
+void CDmdPreprocessor::SetDataSink(IDmdCaptureEngineSink *pDataSink) {
+    m_pDataSink = pDataSink;
+}
+
+void CDmdPreprocessor::SetDenoiseStrength(unsigned int iStrength) {
+    m_temporalDenoise.SetStrength(iStrength);
+}
+
+DMD_RESULT CDmdPreprocessor::Warmup(unsigned int iWidth,
+        unsigned int iHeight, unsigned int iFrameCount) {
+    if (0 == iWidth || 0 == iHeight) {
+        DMD_LOG_ERROR("CDmdPreprocessor::Warmup(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+    return m_pFramePool->Reserve(DmdI420FrameSize(iWidth, iHeight),
+            iFrameCount);
+}
+
+DMD_RESULT CDmdPreprocessor::SetPrivacyMask(
+        const std::vector<DmdMaskRect> &vecRects,
+        const std::vector<DmdMaskPolygon> &vecPolygons) {
+    std::shared_ptr<CDmdPrivacyMask> pMask(new CDmdPrivacyMask());
+    if (NULL == pMask.get()) {
+        DMD_LOG_ERROR("CDmdPreprocessor::SetPrivacyMask(), "
+                << "failed to allocate privacy mask");
+        return DMD_S_FAIL;
+    }
+    // built at the last seen resolution, rebuilt on resolution change;
+    if (DMD_S_OK != pMask->Build(m_iFrameWidth, m_iFrameHeight,
+                vecRects, vecPolygons)) {
+        return DMD_S_FAIL;
+    }
+
+    std::shared_ptr<const CDmdPrivacyMask> pConstMask(pMask);
+    std::atomic_store(&m_pPrivacyMask, pConstMask);
+    m_ulMaskUpdateCount++;
+
+    return DMD_S_OK;
+}
+
+void CDmdPreprocessor::ClearPrivacyMask() {
+    std::atomic_store(&m_pPrivacyMask,
+            std::shared_ptr<const CDmdPrivacyMask>());
+    m_ulMaskUpdateCount++;
+}
+
+std::shared_ptr<const CDmdPrivacyMask>
+CDmdPreprocessor::GetPrivacyMask() const {
+    return std::atomic_load(&m_pPrivacyMask);
+}
+
+void CDmdPreprocessor::GetStats(DmdPreprocessStats *pStats) {
+    if (pStats) {
+        *pStats = m_stats;
+        pStats->ulMaskUpdateCount = m_ulMaskUpdateCount;
+        pStats->ulFrameAllocCount = m_pFramePool->GetAllocCount();
+    }
+}
+
+void CDmdPreprocessor::GetDenoiseStats(DmdDenoiseStats *pStats) {
+    m_temporalDenoise.GetStats(pStats);
+}
+
+void CDmdPreprocessor::GetMotionStats(DmdMotionStats *pStats) {
+    m_motionDetector.GetStats(pStats);
+}
+
+DmdPooledFrame *CDmdPreprocessor::acquireFrame(unsigned int iWidth,
+        unsigned int iHeight, DmdVideoRawData *pVideoFrame) {
+    DmdPooledFrame *pFrame =
+        m_pFramePool->Acquire(DmdI420FrameSize(iWidth, iHeight));
+    if (NULL == pFrame) {
+        return NULL;
+    }
+
+    memset(pVideoFrame, 0, sizeof(*pVideoFrame));
+    DmdSetupI420Planes(pVideoFrame, pFrame->GetData(), iWidth, iHeight);
+    pVideoFrame->pFrameBuffer = pFrame;
+    if (iWidth != m_iOutputWidth || iHeight != m_iOutputHeight) {
+        m_iOutputWidth = iWidth;
+        m_iOutputHeight = iHeight;
+        m_temporalDenoise.Reset();
+        m_motionDetector.Reset();
+    }
+
+    return pFrame;
+}
+
+std::shared_ptr<const CDmdPrivacyMask> CDmdPreprocessor::acquireMask(
+        unsigned int iWidth, unsigned int iHeight) {
+    std::shared_ptr<const CDmdPrivacyMask> pMask =
+        std::atomic_load(&m_pPrivacyMask);
+    for (;;) {
+        if (NULL == pMask.get() || !pMask->HasRegions()
+                || (pMask->GetWidth() == iWidth
+                    && pMask->GetHeight() == iHeight)) {
+            return pMask;
+        }
+
+        // resolution changed, rebuild from the same regions;
+        std::shared_ptr<CDmdPrivacyMask> pRebuilt(new CDmdPrivacyMask());
+        if (NULL == pRebuilt.get() || DMD_S_OK != pRebuilt->Build(iWidth,
+                    iHeight, pMask->GetRects(), pMask->GetPolygons())) {
+            return pMask;
+        }
+        std::shared_ptr<const CDmdPrivacyMask> pConstRebuilt(pRebuilt);
+        if (std::atomic_compare_exchange_strong(&m_pPrivacyMask, &pMask,
+                    pConstRebuilt)) {
+            return pConstRebuilt;
+        }
+        // replaced meanwhile, pMask now holds the newer one, which this
+        // frame uses, rebuilt if need be;
+    }
+}
+
+DMD_RESULT CDmdPreprocessor::DeliverVideoData(
+        DmdVideoRawData *pVideoRawData) {
+    if (NULL == pVideoRawData) {
+        return DMD_S_FAIL;
+    }
+
+    uint64_t ulStart = DmdGetTickCountUs();
+    DmdFixupRawDataPlanes(pVideoRawData);
+    unsigned int iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    DmdVideoRawData videoFrame;
+    DmdPooledFrame *pFrame = acquireFrame(iWidth, iHeight, &videoFrame);
+    if (NULL == pFrame) {
+        m_stats.ulDroppedCount++;
+        return DMD_S_FAIL;
+    }
+
+    m_iFrameWidth = iWidth;
+    m_iFrameHeight = iHeight;
+
+    // step 1, conversion pass with privacy mask fill;
+    std::shared_ptr<const CDmdPrivacyMask> pMask =
+        acquireMask(iWidth, iHeight);
+    const CDmdPrivacyMask *pActiveMask = NULL;
+    if (pMask.get() && pMask->HasRegions()) {
+        // a mismatched mask fails the conversion, never deliver unmasked;
+        pActiveMask = pMask.get();
+    }
+    if (DMD_S_OK != DmdConvertToI420(pVideoRawData, &videoFrame,
+                pActiveMask)) {
+        pFrame->Release();
+        m_stats.ulDroppedCount++;
+        return DMD_S_FAIL;
+    }
+    uint64_t ulConverted = DmdGetTickCountUs();
+
+    // step 2, temporal denoise on luma and chroma planes;
+    m_temporalDenoise.Process(&videoFrame);
+    uint64_t ulDenoised = DmdGetTickCountUs();
+
+    // step 3, motion detection on the denoised luma, privacy zones are
+    // left out; a changed mask changes pixels, so start over;
+    DmdMotionResult motionResult;
+    memset(&motionResult, 0, sizeof(motionResult));
+    if (m_bMotionDetect) {
+        if (pActiveMask != m_pLastMotionMask.get()) {
+            m_pLastMotionMask = pActiveMask
+                ? pMask : std::shared_ptr<const CDmdPrivacyMask>();
+            m_motionDetector.Reset();
+        }
+        if (DMD_S_OK == m_motionDetector.Process(&videoFrame, pActiveMask,
+                    &motionResult)) {
+            videoFrame.ulFrameFlags |= DMD_FRAME_FLAG_MOTION_ANALYSED;
+            if (motionResult.bMotion) {
+                videoFrame.ulFrameFlags |= DMD_FRAME_FLAG_MOTION;
+            }
+            if (motionResult.bBackground) {
+                videoFrame.ulFrameFlags |= DMD_FRAME_FLAG_BACKGROUND;
+            }
+        }
+    }
+    uint64_t ulDetected = DmdGetTickCountUs();
+
+    m_stats.ulFrameCount++;
+    m_stats.ulLastConvertCostUs = ulConverted - ulStart;
+    m_stats.ulLastDenoiseCostUs = ulDenoised - ulConverted;
+    m_stats.ulLastMotionCostUs = ulDetected - ulDenoised;
+    m_stats.ulTotalCostUs += ulDetected - ulStart;
+    DMD_LOG_INFO("CDmdPreprocessor::DeliverVideoData(), "
+            << "frame:" << m_stats.ulFrameCount
+            << ", convert cost:" << m_stats.ulLastConvertCostUs << "us"
+            << ", denoise cost:" << m_stats.ulLastDenoiseCostUs << "us"
+            << ", motion cost:" << m_stats.ulLastMotionCostUs << "us"
+            << ", changed:" << motionResult.iChangedPermille << "permille"
+            << ", denoise strength:" << m_temporalDenoise.GetStrength());
+
+    // step 4, deliver to encoder and detector, they add their own
+    // references to keep the frame;
+    DMD_RESULT ret = DMD_S_OK;
+    if (m_pDataSink) {
+        ret = m_pDataSink->DeliverVideoData(&videoFrame);
+    }
+    pFrame->Release();
+
+    return ret;
+}
+
+}  // namespace opendmd
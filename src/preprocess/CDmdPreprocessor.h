@@ -0,0 +1,136 @@
+/*
+ ============================================================================
+ * Name        : CDmdPreprocessor.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdPreprocessor.h
+ ============================================================================
+ */
+
+#ifndef SRC_PREPROCESS_CDMDPREPROCESSOR_H
+#define SRC_PREPROCESS_CDMDPREPROCESSOR_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "IDmdCaptureEngine.h"
+#include "DmdFramePool.h"
+
+#include "CDmdMotionDetector.h"
+#include "CDmdPrivacyMask.h"
+#include "CDmdTemporalDenoise.h"
+
+namespace opendmd {
+
+typedef struct {
+    DmdDenoiseParam denoiseParam;
+    DmdMotionDetectParam motionParam;
+} DmdPreprocessParam;
+
+typedef struct {
+    uint64_t        ulFrameCount;
+    uint64_t        ulDroppedCount;
+    uint64_t        ulLastConvertCostUs;
+    uint64_t        ulLastDenoiseCostUs;
+    uint64_t        ulLastMotionCostUs;
+    uint64_t        ulTotalCostUs;
+    uint64_t        ulMaskUpdateCount;
+    uint64_t        ulFrameAllocCount;    // output frames allocated;
+} DmdPreprocessStats;
+
+/*
+ * Per-camera preprocessing stage, sits between the capture engine and the
+ * encoder/detector: converts captured frame to I420 with privacy zones
+ * blacked out, then runs the temporal denoise filter and the motion
+ * detector, and delivers the result, tagged with DMD_FRAME_FLAG_*, to the
+ * downstream sink. Output frames come from a frame pool and
+ * carry pFrameBuffer, so consumers can keep them without copying.
+ */
+class CDmdPreprocessor : public IDmdCaptureEngineSink {
+public:
+    CDmdPreprocessor();
+    ~CDmdPreprocessor();
+
+    DMD_RESULT Init(const DmdPreprocessParam &preprocessParam);
+    DMD_RESULT Uninit();
+
+    void SetDataSink(IDmdCaptureEngineSink *pDataSink);
+    void SetDenoiseStrength(unsigned int iStrength);
+    // preallocates iFrameCount output frames of the expected capture size,
+    // safe while frames are delivered;
+    DMD_RESULT Warmup(unsigned int iWidth, unsigned int iHeight,
+            unsigned int iFrameCount);
+
+    // rasterize on the caller thread, then swap in without blocking capture;
+    DMD_RESULT SetPrivacyMask(const std::vector<DmdMaskRect> &vecRects,
+            const std::vector<DmdMaskPolygon> &vecPolygons);
+    void ClearPrivacyMask();
+    std::shared_ptr<const CDmdPrivacyMask> GetPrivacyMask() const;
+
+    void GetStats(DmdPreprocessStats *pStats);
+    void GetDenoiseStats(DmdDenoiseStats *pStats);
+    void GetMotionStats(DmdMotionStats *pStats);
+
+    // IDmdCaptureEngineSink interface;
+    DMD_RESULT DeliverVideoData(DmdVideoRawData *pVideoRawData);
+
+private:
+    DmdPooledFrame *acquireFrame(unsigned int iWidth, unsigned int iHeight,
+            DmdVideoRawData *pVideoFrame);
+    std::shared_ptr<const CDmdPrivacyMask> acquireMask(unsigned int iWidth,
+            unsigned int iHeight);
+
+private:
+    IDmdCaptureEngineSink *m_pDataSink;
+    CDmdTemporalDenoise    m_temporalDenoise;
+    CDmdMotionDetector     m_motionDetector;
+    bool                   m_bMotionDetect;
+    // held so that its address is not reused by a new mask;
+    std::shared_ptr<const CDmdPrivacyMask> m_pLastMotionMask;
+    std::shared_ptr<DmdFramePool> m_pFramePool;
+    unsigned int           m_iOutputWidth;
+    unsigned int           m_iOutputHeight;
+    DmdPreprocessStats     m_stats;
+
+    // accessed with std::atomic_load/atomic_store only;
+    std::shared_ptr<const CDmdPrivacyMask> m_pPrivacyMask;
+    std::atomic<uint64_t>  m_ulMaskUpdateCount;
+    std::atomic<unsigned int> m_iFrameWidth;
+    std::atomic<unsigned int> m_iFrameHeight;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_PREPROCESS_CDMDPREPROCESSOR_H
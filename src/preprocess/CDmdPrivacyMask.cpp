@@ -0,0 +1,260 @@
+/*
+ ============================================================================
+ * Name        : CDmdPrivacyMask.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdPrivacyMask.cpp
+ ============================================================================
+ */
+
+#include "CDmdPrivacyMask.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "DmdLog.h"
+
+using std::vector;
+
+namespace opendmd {
+
+static bool spanLess(const DmdMaskSpan &left, const DmdMaskSpan &right) {
+    return left.iStart < right.iStart;
+}
+
+CDmdPrivacyMask::CDmdPrivacyMask() : m_iWidth(0), m_iHeight(0),
+        m_ulMaskedPixels(0) {
+}
+
+CDmdPrivacyMask::~CDmdPrivacyMask() {
+}
+
+DMD_RESULT CDmdPrivacyMask::Build(unsigned int iWidth, unsigned int iHeight,
+        const vector<DmdMaskRect> &vecRects,
+        const vector<DmdMaskPolygon> &vecPolygons) {
+    m_iWidth = iWidth;
+    m_iHeight = iHeight;
+    m_vecRects = vecRects;
+    m_vecPolygons = vecPolygons;
+    m_ulMaskedPixels = 0;
+
+    vector<vector<DmdMaskSpan> > lumaRows(iHeight);
+    for (size_t i = 0; i < vecRects.size(); i++) {
+        rasterizeRect(vecRects[i], &lumaRows);
+    }
+    for (size_t i = 0; i < vecPolygons.size(); i++) {
+        if (vecPolygons[i].size() < 3) {
+            DMD_LOG_ERROR("CDmdPrivacyMask::Build(), polygon " << i
+                    << " has only " << vecPolygons[i].size() << " points");
+            return DMD_S_FAIL;
+        }
+        rasterizePolygon(vecPolygons[i], &lumaRows);
+    }
+
+    // a chroma sample is masked if any luma pixel it covers is masked;
+    unsigned int iChromaHeight = (iHeight + 1) / 2;
+    vector<vector<DmdMaskSpan> > chromaRows(iChromaHeight);
+    for (unsigned int y = 0; y < iHeight; y++) {
+        mergeSpans(&lumaRows[y]);
+        vector<DmdMaskSpan> &chromaRow = chromaRows[y / 2];
+        for (size_t i = 0; i < lumaRows[y].size(); i++) {
+            DmdMaskSpan span = lumaRows[y][i];
+            m_ulMaskedPixels += span.iEnd - span.iStart;
+            span.iStart = span.iStart / 2;
+            span.iEnd = (span.iEnd + 1) / 2;
+            chromaRow.push_back(span);
+        }
+    }
+    for (unsigned int y = 0; y < iChromaHeight; y++) {
+        mergeSpans(&chromaRows[y]);
+    }
+
+    flattenRows(lumaRows, &m_vecLumaSpans, &m_vecLumaIndex);
+    flattenRows(chromaRows, &m_vecChromaSpans, &m_vecChromaIndex);
+
+    DMD_LOG_INFO("CDmdPrivacyMask::Build(), " << iWidth << "x" << iHeight
+            << ", rects:" << vecRects.size()
+            << ", polygons:" << vecPolygons.size()
+            << ", spans:" << m_vecLumaSpans.size()
+            << ", masked pixels:" << m_ulMaskedPixels);
+
+    return DMD_S_OK;
+}
+
+void CDmdPrivacyMask::rasterizeRect(const DmdMaskRect &rect,
+        vector<vector<DmdMaskSpan> > *pRows) {
+    int64_t iLeft = std::max<int64_t>(rect.iX, 0);
+    int64_t iTop = std::max<int64_t>(rect.iY, 0);
+    int64_t iRight = std::min<int64_t>(
+            static_cast<int64_t>(rect.iX) + rect.iWidth, m_iWidth);
+    int64_t iBottom = std::min<int64_t>(
+            static_cast<int64_t>(rect.iY) + rect.iHeight, m_iHeight);
+    if (iLeft >= iRight || iTop >= iBottom) {
+        return;
+    }
+
+    DmdMaskSpan span;
+    span.iStart = static_cast<uint32_t>(iLeft);
+    span.iEnd = static_cast<uint32_t>(iRight);
+    for (int64_t y = iTop; y < iBottom; y++) {
+        (*pRows)[y].push_back(span);
+    }
+}
+
+void CDmdPrivacyMask::rasterizePolygon(const DmdMaskPolygon &polygon,
+        vector<vector<DmdMaskSpan> > *pRows) {
+    int iMinY = polygon[0].iY;
+    int iMaxY = polygon[0].iY;
+    for (size_t i = 1; i < polygon.size(); i++) {
+        iMinY = std::min(iMinY, polygon[i].iY);
+        iMaxY = std::max(iMaxY, polygon[i].iY);
+    }
+    iMinY = std::max(iMinY, 0);
+    iMaxY = std::min(iMaxY, static_cast<int>(m_iHeight));
+
+    vector<double> vecCross;
+    for (int y = iMinY; y < iMaxY; y++) {
+        // sample at pixel centers;
+        double fY = y + 0.5;
+        vecCross.clear();
+        for (size_t i = 0, j = polygon.size() - 1; i < polygon.size();
+                j = i++) {
+            const DmdMaskPoint &a = polygon[i];
+            const DmdMaskPoint &b = polygon[j];
+            if ((a.iY <= fY) == (b.iY <= fY)) {
+                continue;
+            }
+            vecCross.push_back(a.iX + (fY - a.iY) * (b.iX - a.iX)
+                    / static_cast<double>(b.iY - a.iY));
+        }
+        std::sort(vecCross.begin(), vecCross.end());
+
+        for (size_t i = 0; i + 1 < vecCross.size(); i += 2) {
+            double fStart = ceil(vecCross[i] - 0.5);
+            double fEnd = ceil(vecCross[i + 1] - 0.5);
+            fStart = std::max(fStart, 0.0);
+            fEnd = std::min(fEnd, static_cast<double>(m_iWidth));
+            if (fStart >= fEnd) {
+                continue;
+            }
+            DmdMaskSpan span;
+            span.iStart = static_cast<uint32_t>(fStart);
+            span.iEnd = static_cast<uint32_t>(fEnd);
+            (*pRows)[y].push_back(span);
+        }
+    }
+}
+
+void CDmdPrivacyMask::mergeSpans(vector<DmdMaskSpan> *pSpans) {
+    if (pSpans->size() < 2) {
+        return;
+    }
+
+    std::sort(pSpans->begin(), pSpans->end(), spanLess);
+    size_t iOut = 0;
+    for (size_t i = 1; i < pSpans->size(); i++) {
+        DmdMaskSpan &last = (*pSpans)[iOut];
+        const DmdMaskSpan &cur = (*pSpans)[i];
+        if (cur.iStart <= last.iEnd) {
+            last.iEnd = std::max(last.iEnd, cur.iEnd);
+        } else {
+            (*pSpans)[++iOut] = cur;
+        }
+    }
+    pSpans->resize(iOut + 1);
+}
+
+void CDmdPrivacyMask::flattenRows(const vector<vector<DmdMaskSpan> > &rows,
+        vector<DmdMaskSpan> *pSpans, vector<size_t> *pIndex) {
+    pSpans->clear();
+    pIndex->assign(1, 0);
+    for (size_t y = 0; y < rows.size(); y++) {
+        pSpans->insert(pSpans->end(), rows[y].begin(), rows[y].end());
+        pIndex->push_back(pSpans->size());
+    }
+}
+
+const DmdMaskSpan *CDmdPrivacyMask::GetLumaSpans(unsigned int iRow,
+        size_t *pCount) const {
+    if (iRow >= m_iHeight || m_vecLumaSpans.empty()) {
+        *pCount = 0;
+        return NULL;
+    }
+
+    *pCount = m_vecLumaIndex[iRow + 1] - m_vecLumaIndex[iRow];
+    return &m_vecLumaSpans[0] + m_vecLumaIndex[iRow];
+}
+
+const DmdMaskSpan *CDmdPrivacyMask::GetChromaSpans(unsigned int iRow,
+        size_t *pCount) const {
+    if (iRow >= (m_iHeight + 1) / 2 || m_vecChromaSpans.empty()) {
+        *pCount = 0;
+        return NULL;
+    }
+
+    *pCount = m_vecChromaIndex[iRow + 1] - m_vecChromaIndex[iRow];
+    return &m_vecChromaSpans[0] + m_vecChromaIndex[iRow];
+}
+
+bool CDmdPrivacyMask::IsMasked(unsigned int iX, unsigned int iY) const {
+    size_t ulCount = 0;
+    const DmdMaskSpan *pSpans = GetLumaSpans(iY, &ulCount);
+    for (size_t i = 0; i < ulCount; i++) {
+        if (iX >= pSpans[i].iStart && iX < pSpans[i].iEnd) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+unsigned int CDmdPrivacyMask::CountMaskedPixels(unsigned int iX,
+        unsigned int iY, unsigned int iWidth, unsigned int iHeight) const {
+    unsigned int iCount = 0;
+    for (unsigned int y = iY; y < iY + iHeight && y < m_iHeight; y++) {
+        size_t ulCount = 0;
+        const DmdMaskSpan *pSpans = GetLumaSpans(y, &ulCount);
+        for (size_t i = 0; i < ulCount; i++) {
+            uint32_t iStart = std::max(pSpans[i].iStart, iX);
+            uint32_t iEnd = std::min(pSpans[i].iEnd, iX + iWidth);
+            if (iStart < iEnd) {
+                iCount += iEnd - iStart;
+            }
+        }
+    }
+
+    return iCount;
+}
+
+}  // namespace opendmd
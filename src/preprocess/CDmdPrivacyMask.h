@@ -0,0 +1,145 @@
+/*
+ ============================================================================
+ * Name        : CDmdPrivacyMask.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdPrivacyMask.h
+ ============================================================================
+ */
+
+#ifndef SRC_PREPROCESS_CDMDPRIVACYMASK_H
+#define SRC_PREPROCESS_CDMDPRIVACYMASK_H
+
+#include <string.h>
+
+#include <vector>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+// fill value of masked pixels, black in limited range YUV;
+#define DMD_PRIVACY_MASK_LUMA   16
+#define DMD_PRIVACY_MASK_CHROMA 128
+
+typedef struct {
+    int             iX;
+    int             iY;
+} DmdMaskPoint;
+
+typedef struct {
+    int             iX;
+    int             iY;
+    unsigned int    iWidth;
+    unsigned int    iHeight;
+} DmdMaskRect;
+
+typedef std::vector<DmdMaskPoint> DmdMaskPolygon;
+
+// masked pixels of one row, [iStart, iEnd);
+typedef struct {
+    uint32_t        iStart;
+    uint32_t        iEnd;
+} DmdMaskSpan;
+
+/*
+ * Privacy zones of one camera, rasterized once into sorted, non-overlapping
+ * run-length spans per luma row and per 4:2:0 chroma row. A built mask is
+ * never modified, so the capture thread can keep using it while a new one
+ * is built and swapped in, see CDmdPreprocessor::SetPrivacyMask().
+ */
+class CDmdPrivacyMask {
+public:
+    CDmdPrivacyMask();
+    ~CDmdPrivacyMask();
+
+    // polygons use even-odd rule, sampled at pixel centers;
+    DMD_RESULT Build(unsigned int iWidth, unsigned int iHeight,
+            const std::vector<DmdMaskRect> &vecRects,
+            const std::vector<DmdMaskPolygon> &vecPolygons);
+
+    unsigned int GetWidth() const {return m_iWidth;}
+    unsigned int GetHeight() const {return m_iHeight;}
+    bool HasRegions() const {
+        return !m_vecRects.empty() || !m_vecPolygons.empty();
+    }
+    const std::vector<DmdMaskRect> &GetRects() const {return m_vecRects;}
+    const std::vector<DmdMaskPolygon> &GetPolygons() const {
+        return m_vecPolygons;
+    }
+
+    const DmdMaskSpan *GetLumaSpans(unsigned int iRow, size_t *pCount) const;
+    const DmdMaskSpan *GetChromaSpans(unsigned int iRow,
+            size_t *pCount) const;
+
+    bool IsMasked(unsigned int iX, unsigned int iY) const;
+    uint64_t GetMaskedPixels() const {return m_ulMaskedPixels;}
+    // masked luma pixels inside a rect, used to exclude detector blocks;
+    unsigned int CountMaskedPixels(unsigned int iX, unsigned int iY,
+            unsigned int iWidth, unsigned int iHeight) const;
+
+private:
+    void rasterizeRect(const DmdMaskRect &rect,
+            std::vector<std::vector<DmdMaskSpan> > *pRows);
+    void rasterizePolygon(const DmdMaskPolygon &polygon,
+            std::vector<std::vector<DmdMaskSpan> > *pRows);
+    static void mergeSpans(std::vector<DmdMaskSpan> *pSpans);
+    static void flattenRows(const std::vector<std::vector<DmdMaskSpan> > &rows,
+            std::vector<DmdMaskSpan> *pSpans, std::vector<size_t> *pIndex);
+
+private:
+    unsigned int                m_iWidth;
+    unsigned int                m_iHeight;
+    std::vector<DmdMaskRect>    m_vecRects;
+    std::vector<DmdMaskPolygon> m_vecPolygons;
+
+    // spans of row i are [index[i], index[i + 1]);
+    std::vector<DmdMaskSpan>    m_vecLumaSpans;
+    std::vector<size_t>         m_vecLumaIndex;
+    std::vector<DmdMaskSpan>    m_vecChromaSpans;
+    std::vector<size_t>         m_vecChromaIndex;
+    uint64_t                    m_ulMaskedPixels;
+};
+
+// span fill of one plane row, called from the conversion pass;
+inline void DmdFillMaskSpans(uint8_t *pRow, const DmdMaskSpan *pSpans,
+        size_t ulCount, uint8_t iValue) {
+    for (size_t i = 0; i < ulCount; i++) {
+        memset(pRow + pSpans[i].iStart, iValue,
+                pSpans[i].iEnd - pSpans[i].iStart);
+    }
+}
+
+}  // namespace opendmd
+
+#endif  // SRC_PREPROCESS_CDMDPRIVACYMASK_H
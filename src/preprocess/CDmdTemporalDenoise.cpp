@@ -0,0 +1,311 @@
+/*
+ ============================================================================
+ * Name        : CDmdTemporalDenoise.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of CDmdTemporalDenoise.cpp
+ ============================================================================
+ */
+
+#include "CDmdTemporalDenoise.h"
+
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+// weights are Q7 fixed-point, 128 means take current pixel as is;
+static const int kDenoiseWeightShift = 7;
+static const int kDenoiseWeightOne = 1 << kDenoiseWeightShift;
+// strongest filtering still keeps 1/8 of current pixel;
+static const int kDenoiseMinWeight = kDenoiseWeightOne / 8;
+
+static inline int denoisePixel(int cur, int prev, int iMinWeight, int iSlope,
+        int iThreshold) {
+    int diff = cur - prev;
+    int absDiff = diff < 0 ? -diff : diff;
+    if (absDiff > iThreshold) {
+        absDiff = iThreshold;
+    }
+    int weight = iMinWeight + ((absDiff * iSlope) >> kDenoiseWeightShift);
+    if (weight > kDenoiseWeightOne) {
+        weight = kDenoiseWeightOne;
+    }
+
+    return prev + ((diff * weight + (kDenoiseWeightOne >> 1))
+            >> kDenoiseWeightShift);
+}
+
+void DmdTemporalDenoisePlaneC(uint8_t *pPlane, size_t ulStride,
+        uint8_t *pHistory, size_t ulHistoryStride,
+        unsigned int iWidth, unsigned int iHeight,
+        int iMinWeight, int iSlope, int iThreshold) {
+    for (unsigned int y = 0; y < iHeight; y++) {
+        uint8_t *pCur = pPlane + y * ulStride;
+        uint8_t *pPrev = pHistory + y * ulHistoryStride;
+        for (unsigned int x = 0; x < iWidth; x++) {
+            uint8_t out = static_cast<uint8_t>(denoisePixel(pCur[x],
+                        pPrev[x], iMinWeight, iSlope, iThreshold));
+            pCur[x] = out;
+            pPrev[x] = out;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+void DmdTemporalDenoisePlane(uint8_t *pPlane, size_t ulStride,
+        uint8_t *pHistory, size_t ulHistoryStride,
+        unsigned int iWidth, unsigned int iHeight,
+        int iMinWeight, int iSlope, int iThreshold) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i minWeight = _mm_set1_epi16(static_cast<int16_t>(iMinWeight));
+    const __m128i maxWeight = _mm_set1_epi16(kDenoiseWeightOne);
+    const __m128i slope = _mm_set1_epi16(static_cast<int16_t>(iSlope));
+    const __m128i threshold = _mm_set1_epi16(static_cast<int16_t>(iThreshold));
+    const __m128i rounding = _mm_set1_epi16(kDenoiseWeightOne >> 1);
+    unsigned int iSimdWidth = iWidth & ~15U;
+
+    for (unsigned int y = 0; y < iHeight; y++) {
+        uint8_t *pCur = pPlane + y * ulStride;
+        uint8_t *pPrev = pHistory + y * ulHistoryStride;
+        for (unsigned int x = 0; x < iSimdWidth; x += 16) {
+            __m128i cur = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(pCur + x));
+            __m128i prev = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i *>(pPrev + x));
+            __m128i absDiff = _mm_or_si128(_mm_subs_epu8(cur, prev),
+                    _mm_subs_epu8(prev, cur));
+
+            __m128i halves[2];
+            for (int i = 0; i < 2; i++) {
+                __m128i cur16 = i == 0 ? _mm_unpacklo_epi8(cur, zero)
+                    : _mm_unpackhi_epi8(cur, zero);
+                __m128i prev16 = i == 0 ? _mm_unpacklo_epi8(prev, zero)
+                    : _mm_unpackhi_epi8(prev, zero);
+                __m128i abs16 = i == 0 ? _mm_unpacklo_epi8(absDiff, zero)
+                    : _mm_unpackhi_epi8(absDiff, zero);
+
+                abs16 = _mm_min_epi16(abs16, threshold);
+                __m128i weight = _mm_add_epi16(minWeight, _mm_srli_epi16(
+                            _mm_mullo_epi16(abs16, slope),
+                            kDenoiseWeightShift));
+                weight = _mm_min_epi16(weight, maxWeight);
+
+                __m128i delta = _mm_mullo_epi16(
+                        _mm_sub_epi16(cur16, prev16), weight);
+                delta = _mm_srai_epi16(_mm_add_epi16(delta, rounding),
+                        kDenoiseWeightShift);
+                halves[i] = _mm_add_epi16(prev16, delta);
+            }
+
+            __m128i out = _mm_packus_epi16(halves[0], halves[1]);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pCur + x), out);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pPrev + x), out);
+        }
+
+        for (unsigned int x = iSimdWidth; x < iWidth; x++) {
+            uint8_t out = static_cast<uint8_t>(denoisePixel(pCur[x],
+                        pPrev[x], iMinWeight, iSlope, iThreshold));
+            pCur[x] = out;
+            pPrev[x] = out;
+        }
+    }
+}
+#else
+void DmdTemporalDenoisePlane(uint8_t *pPlane, size_t ulStride,
+        uint8_t *pHistory, size_t ulHistoryStride,
+        unsigned int iWidth, unsigned int iHeight,
+        int iMinWeight, int iSlope, int iThreshold) {
+    DmdTemporalDenoisePlaneC(pPlane, ulStride, pHistory, ulHistoryStride,
+            iWidth, iHeight, iMinWeight, iSlope, iThreshold);
+}
+#endif
+
+CDmdTemporalDenoise::CDmdTemporalDenoise() : m_iStrength(0),
+        m_iThreshold(DMD_DENOISE_DEFAULT_THRESHOLD), m_iWidth(0),
+        m_iHeight(0), m_bHistoryValid(false) {
+    memset(m_pHistory, 0, sizeof(m_pHistory));
+    memset(m_ulHistoryStride, 0, sizeof(m_ulHistoryStride));
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+CDmdTemporalDenoise::~CDmdTemporalDenoise() {
+    releaseHistory();
+}
+
+DMD_RESULT CDmdTemporalDenoise::Init(const DmdDenoiseParam &denoiseParam) {
+    SetStrength(denoiseParam.iStrength);
+    m_iThreshold = denoiseParam.iThreshold;
+    if (m_iThreshold == 0 || m_iThreshold > 255) {
+        DMD_LOG_WARNING("CDmdTemporalDenoise::Init(), "
+                << "invalid threshold " << denoiseParam.iThreshold
+                << ", use default " << DMD_DENOISE_DEFAULT_THRESHOLD);
+        m_iThreshold = DMD_DENOISE_DEFAULT_THRESHOLD;
+    }
+    Reset();
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    return DMD_S_OK;
+}
+
+DMD_RESULT CDmdTemporalDenoise::Uninit() {
+    releaseHistory();
+    return DMD_S_OK;
+}
+
+void CDmdTemporalDenoise::SetStrength(unsigned int iStrength) {
+    m_iStrength = iStrength > 100 ? 100 : iStrength;
+}
+
+void CDmdTemporalDenoise::Reset() {
+    m_bHistoryValid = false;
+}
+
+void CDmdTemporalDenoise::GetStats(DmdDenoiseStats *pStats) {
+    if (pStats) {
+        *pStats = m_stats;
+    }
+}
+
+DMD_RESULT CDmdTemporalDenoise::allocHistory(unsigned int iWidth,
+        unsigned int iHeight) {
+    releaseHistory();
+
+    unsigned int iChromaWidth = (iWidth + 1) / 2;
+    unsigned int iChromaHeight = (iHeight + 1) / 2;
+    m_ulHistoryStride[0] = iWidth;
+    m_ulHistoryStride[1] = iChromaWidth;
+    m_ulHistoryStride[2] = iChromaWidth;
+    m_pHistory[0] = new uint8_t[iWidth * iHeight];
+    m_pHistory[1] = new uint8_t[iChromaWidth * iChromaHeight];
+    m_pHistory[2] = new uint8_t[iChromaWidth * iChromaHeight];
+    if (!m_pHistory[0] || !m_pHistory[1] || !m_pHistory[2]) {
+        DMD_LOG_ERROR("CDmdTemporalDenoise::allocHistory(), "
+                << "failed to allocate history planes");
+        releaseHistory();
+        return DMD_S_FAIL;
+    }
+
+    m_iWidth = iWidth;
+    m_iHeight = iHeight;
+    m_bHistoryValid = false;
+
+    return DMD_S_OK;
+}
+
+void CDmdTemporalDenoise::releaseHistory() {
+    for (int i = 0; i < MAX_PLANE_COUNT; i++) {
+        if (m_pHistory[i]) {
+            delete [] m_pHistory[i];
+            m_pHistory[i] = NULL;
+        }
+        m_ulHistoryStride[i] = 0;
+    }
+    m_iWidth = 0;
+    m_iHeight = 0;
+    m_bHistoryValid = false;
+}
+
+DMD_RESULT CDmdTemporalDenoise::Process(DmdVideoRawData *pVideoRawData) {
+    if (NULL == pVideoRawData
+            || pVideoRawData->fmtVideoFormat.eVideoType != DmdI420) {
+        DMD_LOG_ERROR("CDmdTemporalDenoise::Process(), "
+                << "only I420 frame is supported");
+        return DMD_S_FAIL;
+    }
+
+    unsigned int iStrength = m_iStrength;
+    if (0 == iStrength) {
+        m_bHistoryValid = false;
+        return DMD_S_OK;
+    }
+
+    uint64_t ulStart = DmdGetTickCountUs();
+    unsigned int iWidth = pVideoRawData->fmtVideoFormat.iWidth;
+    unsigned int iHeight = pVideoRawData->fmtVideoFormat.iHeight;
+    if (iWidth != m_iWidth || iHeight != m_iHeight) {
+        if (DMD_S_OK != allocHistory(iWidth, iHeight)) {
+            return DMD_S_FAIL;
+        }
+    }
+
+    unsigned int arrWidth[MAX_PLANE_COUNT] = {
+        iWidth, (iWidth + 1) / 2, (iWidth + 1) / 2,
+    };
+    unsigned int arrHeight[MAX_PLANE_COUNT] = {
+        iHeight, (iHeight + 1) / 2, (iHeight + 1) / 2,
+    };
+
+    if (!m_bHistoryValid) {
+        // first frame after reset, nothing to blend with;
+        for (int i = 0; i < MAX_PLANE_COUNT; i++) {
+            for (unsigned int y = 0; y < arrHeight[i]; y++) {
+                memcpy(m_pHistory[i] + y * m_ulHistoryStride[i],
+                        pVideoRawData->pSrcDataPanel[i]
+                        + y * pVideoRawData->ulSrcDataStride[i],
+                        arrWidth[i]);
+            }
+        }
+        m_bHistoryValid = true;
+    } else {
+        int iMinWeight = kDenoiseWeightOne
+            - (kDenoiseWeightOne - kDenoiseMinWeight) * iStrength / 100;
+        int iThreshold = m_iThreshold;
+        // round up, so that diff >= iThreshold always gets full weight;
+        int iSlope = (((kDenoiseWeightOne - iMinWeight) << kDenoiseWeightShift)
+                + iThreshold - 1) / iThreshold;
+        for (int i = 0; i < MAX_PLANE_COUNT; i++) {
+            DmdTemporalDenoisePlane(pVideoRawData->pSrcDataPanel[i],
+                    pVideoRawData->ulSrcDataStride[i], m_pHistory[i],
+                    m_ulHistoryStride[i], arrWidth[i], arrHeight[i],
+                    iMinWeight, iSlope, iThreshold);
+        }
+    }
+
+    uint64_t ulCost = DmdGetTickCountUs() - ulStart;
+    m_stats.ulFrameCount++;
+    m_stats.ulLastCostUs = ulCost;
+    m_stats.ulTotalCostUs += ulCost;
+    if (ulCost > m_stats.ulMaxCostUs) {
+        m_stats.ulMaxCostUs = ulCost;
+    }
+
+    return DMD_S_OK;
+}
+
+}  // namespace opendmd
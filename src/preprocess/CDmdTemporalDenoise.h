@@ -0,0 +1,118 @@
+/*
+ ============================================================================
+ * Name        : CDmdTemporalDenoise.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of CDmdTemporalDenoise.h
+ ============================================================================
+ */
+
+#ifndef SRC_PREPROCESS_CDMDTEMPORALDENOISE_H
+#define SRC_PREPROCESS_CDMDTEMPORALDENOISE_H
+
+#include <atomic>
+
+#include "IDmdDatatype.h"
+
+namespace opendmd {
+
+#define DMD_DENOISE_DEFAULT_STRENGTH 50
+#define DMD_DENOISE_DEFAULT_THRESHOLD 20
+
+typedef struct {
+    unsigned int    iStrength;   // 0 ~ 100, 0 means filter disabled;
+    unsigned int    iThreshold;  // pixel diff regarded as real motion;
+} DmdDenoiseParam;
+
+typedef struct {
+    uint64_t        ulFrameCount;
+    uint64_t        ulLastCostUs;
+    uint64_t        ulMaxCostUs;
+    uint64_t        ulTotalCostUs;
+} DmdDenoiseStats;
+
+/*
+ * Recursive temporal filter on I420 frames, processed in place:
+ *
+ *     out = prev + (cur - prev) * w
+ *
+ * prev is the previous filtered frame, w is a Q7 fixed-point weight that
+ * grows with |cur - prev|: small differences are regarded as sensor noise
+ * and heavily blended with history, differences above iThreshold are
+ * regarded as motion and pass through untouched, so moving objects do not
+ * leave ghost trails behind them.
+ */
+class CDmdTemporalDenoise {
+public:
+    CDmdTemporalDenoise();
+    ~CDmdTemporalDenoise();
+
+    DMD_RESULT Init(const DmdDenoiseParam &denoiseParam);
+    DMD_RESULT Uninit();
+
+    // could be called from any thread, takes effect at next frame;
+    void SetStrength(unsigned int iStrength);
+    unsigned int GetStrength() {return m_iStrength;}
+
+    DMD_RESULT Process(DmdVideoRawData *pVideoRawData);
+    void Reset();
+    void GetStats(DmdDenoiseStats *pStats);
+
+private:
+    DMD_RESULT allocHistory(unsigned int iWidth, unsigned int iHeight);
+    void releaseHistory();
+
+private:
+    std::atomic<unsigned int> m_iStrength;
+    unsigned int    m_iThreshold;
+    unsigned int    m_iWidth;
+    unsigned int    m_iHeight;
+    uint8_t        *m_pHistory[MAX_PLANE_COUNT];
+    size_t          m_ulHistoryStride[MAX_PLANE_COUNT];
+    bool            m_bHistoryValid;
+    DmdDenoiseStats m_stats;
+};
+
+// filter one plane, exposed for unittest and benchmark;
+extern void DmdTemporalDenoisePlane(uint8_t *pPlane, size_t ulStride,
+        uint8_t *pHistory, size_t ulHistoryStride,
+        unsigned int iWidth, unsigned int iHeight,
+        int iMinWeight, int iSlope, int iThreshold);
+extern void DmdTemporalDenoisePlaneC(uint8_t *pPlane, size_t ulStride,
+        uint8_t *pHistory, size_t ulHistoryStride,
+        unsigned int iWidth, unsigned int iHeight,
+        int iMinWeight, int iSlope, int iThreshold);
+
+}  // namespace opendmd
+
+#endif  // SRC_PREPROCESS_CDMDTEMPORALDENOISE_H
@@ -0,0 +1,161 @@
+/*
+ ============================================================================
+ * Name        : DmdFramePool.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : implementation file of DmdFramePool.cpp
+ ============================================================================
+ */
+
+#include "DmdFramePool.h"
+
+#include "DmdLog.h"
+
+namespace opendmd {
+
+DmdPooledFrame::DmdPooledFrame(size_t ulSize) : m_pData(NULL),
+        m_ulSize(ulSize), m_iRefCount(0) {
+    m_pData = new uint8_t[ulSize];
+}
+
+DmdPooledFrame::~DmdPooledFrame() {
+    if (m_pData) {
+        delete [] m_pData;
+        m_pData = NULL;
+    }
+}
+
+void DmdPooledFrame::AddRef() {
+    m_iRefCount.fetch_add(1);
+}
+
+void DmdPooledFrame::Release() {
+    if (1 != m_iRefCount.fetch_sub(1)) {
+        return;
+    }
+
+    // the pool may go away with this reference, together with this frame;
+    std::shared_ptr<DmdFramePool> pPool;
+    pPool.swap(m_pPool);
+    pPool->recycle(this);
+}
+
+DmdFramePool::DmdFramePool() : m_ulAllocCount(0) {
+}
+
+DmdFramePool::~DmdFramePool() {
+    for (size_t i = 0; i < m_vecFreeFrames.size(); i++) {
+        delete m_vecFreeFrames[i];
+    }
+    m_vecFreeFrames.clear();
+}
+
+DmdPooledFrame *DmdFramePool::Acquire(size_t ulSize) {
+    DmdPooledFrame *pFrame = NULL;
+
+    m_mtxPoolMutex.Lock();
+    while (!m_vecFreeFrames.empty()) {
+        pFrame = m_vecFreeFrames.back();
+        m_vecFreeFrames.pop_back();
+        if (pFrame->GetSize() >= ulSize) {
+            break;
+        }
+        // left over from a smaller resolution;
+        delete pFrame;
+        pFrame = NULL;
+    }
+    m_mtxPoolMutex.Unlock();
+
+    if (NULL == pFrame) {
+        pFrame = new DmdPooledFrame(ulSize);
+        if (NULL == pFrame || NULL == pFrame->GetData()) {
+            DMD_LOG_ERROR("DmdFramePool::Acquire(), "
+                    << "failed to allocate frame of " << ulSize << " bytes");
+            delete pFrame;
+            return NULL;
+        }
+        m_ulAllocCount++;
+    }
+
+    pFrame->m_pPool = shared_from_this();
+    pFrame->m_iRefCount = 1;
+
+    return pFrame;
+}
+
+DMD_RESULT DmdFramePool::Reserve(size_t ulSize, unsigned int iCount) {
+    std::vector<DmdPooledFrame *> vecFrames;
+    m_mtxPoolMutex.Lock();
+    for (size_t i = 0; i < m_vecFreeFrames.size(); i++) {
+        if (m_vecFreeFrames[i]->GetSize() >= ulSize && iCount > 0) {
+            iCount--;
+        }
+    }
+    m_mtxPoolMutex.Unlock();
+
+    // allocated outside the lock, Acquire() may run meanwhile;
+    for (unsigned int i = 0; i < iCount; i++) {
+        DmdPooledFrame *pFrame = new DmdPooledFrame(ulSize);
+        if (NULL == pFrame || NULL == pFrame->GetData()) {
+            DMD_LOG_ERROR("DmdFramePool::Reserve(), "
+                    << "failed to allocate frame of " << ulSize << " bytes");
+            delete pFrame;
+            break;
+        }
+        m_ulAllocCount++;
+        vecFrames.push_back(pFrame);
+    }
+
+    m_mtxPoolMutex.Lock();
+    m_vecFreeFrames.insert(m_vecFreeFrames.end(), vecFrames.begin(),
+            vecFrames.end());
+    m_mtxPoolMutex.Unlock();
+
+    return vecFrames.size() == iCount ? DMD_S_OK : DMD_S_FAIL;
+}
+
+size_t DmdFramePool::GetFreeCount() {
+    m_mtxPoolMutex.Lock();
+    size_t ulCount = m_vecFreeFrames.size();
+    m_mtxPoolMutex.Unlock();
+
+    return ulCount;
+}
+
+void DmdFramePool::recycle(DmdPooledFrame *pFrame) {
+    m_mtxPoolMutex.Lock();
+    m_vecFreeFrames.push_back(pFrame);
+    m_mtxPoolMutex.Unlock();
+}
+
+}  // namespace opendmd
@@ -0,0 +1,108 @@
+/*
+ ============================================================================
+ * Name        : DmdFramePool.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdFramePool.h
+ ============================================================================
+ */
+
+#ifndef SRC_UTIL_DMDFRAMEPOOL_H
+#define SRC_UTIL_DMDFRAMEPOOL_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "thread/DmdThreadMutex.h"
+
+namespace opendmd {
+
+class DmdFramePool;
+
+class DmdPooledFrame : public IDmdFrameBuffer {
+public:
+    void AddRef();
+    // the last reference returns the buffer to its pool;
+    void Release();
+
+    uint8_t *GetData() {return m_pData;}
+    size_t GetSize() {return m_ulSize;}
+
+private:
+    friend class DmdFramePool;
+    explicit DmdPooledFrame(size_t ulSize);
+    ~DmdPooledFrame();
+
+private:
+    uint8_t                      *m_pData;
+    size_t                        m_ulSize;
+    std::atomic<int>              m_iRefCount;
+    // keeps the pool alive while the frame is out;
+    std::shared_ptr<DmdFramePool> m_pPool;
+};
+
+/*
+ * Recycles frame sized buffers between a producer stage and consumers on
+ * other threads. Buffers are allocated on demand, so the pool settles at
+ * the number of frames actually in flight; GetAllocCount() stays flat in
+ * the steady state.
+ */
+class DmdFramePool : public std::enable_shared_from_this<DmdFramePool> {
+public:
+    DmdFramePool();
+    ~DmdFramePool();
+
+    // returned frame holds one reference;
+    DmdPooledFrame *Acquire(size_t ulSize);
+    // allocates ahead so that the first iCount frames come from the pool,
+    // for start up, before frames flow;
+    DMD_RESULT Reserve(size_t ulSize, unsigned int iCount);
+
+    uint64_t GetAllocCount() {return m_ulAllocCount;}
+    size_t GetFreeCount();
+
+private:
+    friend class DmdPooledFrame;
+    void recycle(DmdPooledFrame *pFrame);
+
+private:
+    DmdThreadMutex                m_mtxPoolMutex;
+    std::vector<DmdPooledFrame *> m_vecFreeFrames;
+    std::atomic<uint64_t>         m_ulAllocCount;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_UTIL_DMDFRAMEPOOL_H
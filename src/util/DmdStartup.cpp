@@ -0,0 +1,172 @@
+/*
+ ============================================================================
+ * Name        : DmdStartup.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : start up phase timing and parallel initialization.
+ ============================================================================
+ */
+
+#include "DmdStartup.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "DmdLog.h"
+#include "DmdTimeUtils.h"
+
+namespace opendmd {
+
+typedef struct {
+    const DmdStartupTask *pTask;
+    DmdStartup           *pStartup;
+    DMD_RESULT            eResult;
+} DmdStartupWorker;
+
+static void *startupWorkerRoutine(void *param) {
+    DmdStartupWorker *pWorker = reinterpret_cast<DmdStartupWorker *>(param);
+    uint64_t ulStart = DmdGetTickCountUs();
+    pWorker->eResult = pWorker->pTask->pRoutine(pWorker->pTask->pParam);
+    pWorker->pStartup->AddPhase(pWorker->pTask->pName, ulStart,
+            DmdGetTickCountUs(), DMD_S_OK == pWorker->eResult);
+    return NULL;
+}
+
+static bool comparePhaseStart(const DmdStartupPhase &a,
+        const DmdStartupPhase &b) {
+    return a.ulStartUs < b.ulStartUs;
+}
+
+DmdStartup::DmdStartup() : m_ulStartUs(DmdGetTickCountUs()) {
+}
+
+DmdStartup::~DmdStartup() {
+}
+
+void DmdStartup::Reset() {
+    m_mtxPhaseMutex.Lock();
+    m_ulStartUs = DmdGetTickCountUs();
+    m_vecPhases.clear();
+    m_mtxPhaseMutex.Unlock();
+}
+
+void DmdStartup::AddPhase(const char *pName, uint64_t ulStartUs,
+        uint64_t ulEndUs, bool bSucceeded) {
+    DmdStartupPhase phase;
+    phase.sName = pName ? pName : "";
+    m_mtxPhaseMutex.Lock();
+    phase.ulStartUs = ulStartUs > m_ulStartUs ? ulStartUs - m_ulStartUs : 0;
+    phase.ulCostUs = ulEndUs > ulStartUs ? ulEndUs - ulStartUs : 0;
+    phase.bSucceeded = bSucceeded;
+    m_vecPhases.push_back(phase);
+    m_mtxPhaseMutex.Unlock();
+}
+
+DMD_RESULT DmdStartup::RunParallel(const DmdStartupTask *pTasks,
+        unsigned int iTaskCount) {
+    if (NULL == pTasks && iTaskCount) {
+        DMD_LOG_ERROR("DmdStartup::RunParallel(), invalid parameter");
+        return DMD_S_FAIL;
+    }
+
+    std::vector<DmdStartupWorker> vecWorkers(iTaskCount);
+    std::vector<pthread_t> vecThreads(iTaskCount);
+    std::vector<bool> vecSpawned(iTaskCount, false);
+    for (unsigned int i = 0; i < iTaskCount; i++) {
+        vecWorkers[i].pTask = &pTasks[i];
+        vecWorkers[i].pStartup = this;
+        vecWorkers[i].eResult = DMD_S_FAIL;
+        // the last task runs on the calling thread;
+        if (i + 1 == iTaskCount) {
+            break;
+        }
+        int ret = pthread_create(&vecThreads[i], NULL, startupWorkerRoutine,
+                &vecWorkers[i]);
+        if (0 != ret) {
+            DMD_LOG_WARNING("DmdStartup::RunParallel(), "
+                    << "pthread_create failed, " << strerror(ret)
+                    << ", run " << pTasks[i].pName << " inline");
+            startupWorkerRoutine(&vecWorkers[i]);
+            continue;
+        }
+        vecSpawned[i] = true;
+    }
+    if (iTaskCount) {
+        startupWorkerRoutine(&vecWorkers[iTaskCount - 1]);
+    }
+
+    DMD_RESULT result = DMD_S_OK;
+    for (unsigned int i = 0; i < iTaskCount; i++) {
+        if (vecSpawned[i]) {
+            pthread_join(vecThreads[i], NULL);
+        }
+        if (DMD_S_OK != vecWorkers[i].eResult) {
+            DMD_LOG_ERROR("DmdStartup::RunParallel(), "
+                    << pTasks[i].pName << " failed");
+            result = DMD_S_FAIL;
+        }
+    }
+
+    return result;
+}
+
+void DmdStartup::GetPhases(std::vector<DmdStartupPhase> *pPhases) {
+    if (NULL == pPhases) {
+        return;
+    }
+    m_mtxPhaseMutex.Lock();
+    *pPhases = m_vecPhases;
+    m_mtxPhaseMutex.Unlock();
+    std::stable_sort(pPhases->begin(), pPhases->end(), comparePhaseStart);
+}
+
+void DmdStartup::Report() {
+    std::vector<DmdStartupPhase> vecPhases;
+    GetPhases(&vecPhases);
+
+    uint64_t ulEndUs = 0;
+    for (size_t i = 0; i < vecPhases.size(); i++) {
+        const DmdStartupPhase &phase = vecPhases[i];
+        DMD_LOG_INFO("DmdStartup::Report(), " << phase.sName
+                << ", at:" << phase.ulStartUs / 1000 << "ms"
+                << ", cost:" << phase.ulCostUs / 1000 << "ms"
+                << (phase.bSucceeded ? "" : ", failed"));
+        ulEndUs = std::max(ulEndUs, phase.ulStartUs + phase.ulCostUs);
+    }
+    DMD_LOG_INFO("DmdStartup::Report(), " << vecPhases.size()
+            << " phases, done at " << ulEndUs / 1000 << "ms");
+}
+
+}  // namespace opendmd
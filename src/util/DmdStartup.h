@@ -0,0 +1,100 @@
+/*
+ ============================================================================
+ * Name        : DmdStartup.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdStartup.h
+ ============================================================================
+ */
+
+#ifndef SRC_UTIL_DMDSTARTUP_H
+#define SRC_UTIL_DMDSTARTUP_H
+
+#include <string>
+#include <vector>
+
+#include "IDmdDatatype.h"
+#include "thread/DmdThreadMutex.h"
+
+namespace opendmd {
+
+typedef DMD_RESULT (*DmdStartupRoutine)(void *pParam);
+
+typedef struct {
+    const char        *pName;
+    DmdStartupRoutine  pRoutine;
+    void              *pParam;
+} DmdStartupTask;
+
+typedef struct {
+    std::string  sName;
+    uint64_t     ulStartUs;  // from the start of the profile;
+    uint64_t     ulCostUs;
+    bool         bSucceeded;
+} DmdStartupPhase;
+
+/*
+ * Times the start up phases of a process. Independent subsystems are
+ * initialized concurrently through RunParallel(), one thread per task;
+ * phases that run on threads of their own, as a camera being opened on
+ * its capture thread, are recorded with AddPhase(). Report() logs every
+ * phase with its offset from the start, so overlap is visible.
+ */
+class DmdStartup {
+public:
+    DmdStartup();
+    ~DmdStartup();
+
+    // restarts the profile, the start is now;
+    void Reset();
+    uint64_t GetStartUs() const {return m_ulStartUs;}
+
+    // safe from any thread, ticks of DmdGetTickCountUs();
+    void AddPhase(const char *pName, uint64_t ulStartUs, uint64_t ulEndUs,
+            bool bSucceeded = true);
+    // returns once every task is done, fails if any task failed;
+    DMD_RESULT RunParallel(const DmdStartupTask *pTasks,
+            unsigned int iTaskCount);
+
+    void GetPhases(std::vector<DmdStartupPhase> *pPhases);
+    void Report();
+
+private:
+    uint64_t                     m_ulStartUs;
+    DmdThreadMutex               m_mtxPhaseMutex;
+    std::vector<DmdStartupPhase> m_vecPhases;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_UTIL_DMDSTARTUP_H
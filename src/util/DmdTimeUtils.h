@@ -0,0 +1,63 @@
+/*
+ ============================================================================
+ * Name        : DmdTimeUtils.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : header file of DmdTimeUtils.h
+ ============================================================================
+ */
+
+#ifndef SRC_UTIL_DMDTIMEUTILS_H
+#define SRC_UTIL_DMDTIMEUTILS_H
+
+#include <stdint.h>
+
+namespace opendmd {
+
+// monotonic clock, for measuring elapsed time only;
+extern uint64_t DmdGetTickCountNs();
+extern uint64_t DmdGetTickCountUs();
+extern uint64_t DmdGetTickCountMs();
+
+// wall clock since the unix epoch, may step; for timestamps that leave
+// the process only, such as the ntp time of rtcp sender reports;
+extern uint64_t DmdGetWallClockUs();
+
+// cpu time consumed by the calling thread;
+extern uint64_t DmdGetThreadCpuTimeUs();
+// cpu time consumed by all threads of the process;
+extern uint64_t DmdGetProcessCpuTimeUs();
+
+}  // namespace opendmd
+
+#endif  // SRC_UTIL_DMDTIMEUTILS_H
@@ -0,0 +1,141 @@
+/*
+ ============================================================================
+ * Name        : DmdBoundedQueue.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : bounded blocking queue util header file.
+ ============================================================================
+ */
+
+#ifndef SRC_UTIL_THREAD_DMDBOUNDEDQUEUE_H
+#define SRC_UTIL_THREAD_DMDBOUNDEDQUEUE_H
+
+#include <errno.h>
+
+#include <deque>
+
+#include "thread/DmdThreadMutex.h"
+#include "thread/DmdThreadCondition.h"
+
+namespace opendmd {
+
+/*
+ * Fixed capacity FIFO between one producer and one consumer thread. The
+ * producer never blocks, TryPush() fails when full so the caller decides
+ * what to drop; the consumer may block in Pop() with a timeout, so that
+ * it can poll its running flag.
+ */
+template <typename T>
+class DmdBoundedQueue {
+public:
+    explicit DmdBoundedQueue(size_t ulCapacity) : m_ulCapacity(ulCapacity) {}
+    ~DmdBoundedQueue() {}
+
+    bool TryPush(const T &item) {
+        m_mtxQueueMutex.Lock();
+        if (m_queItems.size() >= m_ulCapacity) {
+            m_mtxQueueMutex.Unlock();
+            return false;
+        }
+        m_queItems.push_back(item);
+        m_condNotEmpty.Signal();
+        m_mtxQueueMutex.Unlock();
+
+        return true;
+    }
+
+    bool TryPop(T *pItem) {
+        m_mtxQueueMutex.Lock();
+        bool bRet = popLocked(pItem);
+        m_mtxQueueMutex.Unlock();
+
+        return bRet;
+    }
+
+    // copy of the oldest item, the producer may still drop it;
+    bool TryPeek(T *pItem) {
+        m_mtxQueueMutex.Lock();
+        bool bRet = !m_queItems.empty();
+        if (bRet) {
+            *pItem = m_queItems.front();
+        }
+        m_mtxQueueMutex.Unlock();
+
+        return bRet;
+    }
+
+    bool Pop(T *pItem, unsigned int iTimeoutMs) {
+        m_mtxQueueMutex.Lock();
+        while (m_queItems.empty()) {
+            if (ETIMEDOUT == m_condNotEmpty.TimedWait(&m_mtxQueueMutex,
+                        iTimeoutMs)) {
+                break;
+            }
+        }
+        bool bRet = popLocked(pItem);
+        m_mtxQueueMutex.Unlock();
+
+        return bRet;
+    }
+
+    size_t Size() {
+        m_mtxQueueMutex.Lock();
+        size_t ulSize = m_queItems.size();
+        m_mtxQueueMutex.Unlock();
+
+        return ulSize;
+    }
+
+    size_t Capacity() const {return m_ulCapacity;}
+
+private:
+    bool popLocked(T *pItem) {
+        if (m_queItems.empty()) {
+            return false;
+        }
+        *pItem = m_queItems.front();
+        m_queItems.pop_front();
+
+        return true;
+    }
+
+private:
+    size_t m_ulCapacity;
+    std::deque<T> m_queItems;
+    DmdThreadMutex m_mtxQueueMutex;
+    DmdThreadCondition m_condNotEmpty;
+};
+
+}  // namespace opendmd
+
+#endif  // SRC_UTIL_THREAD_DMDBOUNDEDQUEUE_H
@@ -42,12 +42,13 @@
 
 namespace opendmd {
 
-DmdThread::DmdThread() : m_eThreadType(DMD_THREAD_UNKNOWN),
+DmdThread::DmdThread() : m_eThreadType(DMD_THREAD_UNKNOWN), m_iThreadIndex(0),
     m_pThreadRoutine(NULL), m_ulThreadHandler(0), m_bThreadSpawned(false) {
 }
 
 DmdThread::DmdThread(DmdThreadType eType, DmdThreadRoutine pThreadRoutine,
-                     void *arg) : m_eThreadType(eType),
+                     void *arg, unsigned int iThreadIndex) :
+    m_eThreadType(eType), m_iThreadIndex(iThreadIndex),
     m_pThreadRoutine(pThreadRoutine), m_ulThreadHandler(0),
     m_pArg(arg), m_bThreadSpawned(false) {
 }
@@ -84,7 +85,7 @@ DMD_RESULT DmdThread::spawnThread() {
     m_bThreadSpawned = true;
     DMD_LOG_INFO("DmdThread::spawnThread(), "
                  << "thread with type " << dmdThreadType[m_eThreadType]
-                 << " spawned");
+                 << ", index " << m_iThreadIndex << " spawned");
     return ret;
 }
 
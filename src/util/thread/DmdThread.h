@@ -49,10 +49,11 @@ class DmdThread {
 public:
     DmdThread();
     DmdThread(DmdThreadType eType, DmdThreadRoutine pThreadRoutine,
-              void *arg);
+              void *arg, unsigned int iThreadIndex = 0);
     ~DmdThread();
 
     DmdThreadType getThreadType() {return m_eThreadType;}
+    unsigned int getThreadIndex() {return m_iThreadIndex;}
     DmdThreadHandler getThreadHandler() {return m_ulThreadHandler;}
     bool isThreadSpawned() {return m_bThreadSpawned;}
 
@@ -60,6 +61,7 @@ public:
 
 private:
     DmdThreadType m_eThreadType;
+    unsigned int m_iThreadIndex;  // among threads of the same type;
     DmdThreadRoutine m_pThreadRoutine;
     DmdThreadHandler m_ulThreadHandler;
     void *m_pArg;
@@ -0,0 +1,93 @@
+/*
+ ============================================================================
+ * Name        : DmdThreadCondition.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : thread condition variable util implementation file.
+ ============================================================================
+ */
+
+#include <time.h>
+
+#include "DmdThreadCondition.h"
+
+namespace opendmd {
+
+DmdThreadCondition::DmdThreadCondition() {
+#if defined(LINUX)
+    // timed wait on monotonic clock, immune to wall clock adjustment;
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&m_Cond, &attr);
+    pthread_condattr_destroy(&attr);
+#else
+    pthread_cond_init(&m_Cond, NULL);
+#endif
+}
+
+DmdThreadCondition::~DmdThreadCondition() {
+    pthread_cond_destroy(&m_Cond);
+}
+
+int DmdThreadCondition::Wait(DmdThreadMutex *pMutex) {
+    return pthread_cond_wait(&m_Cond, &pMutex->m_Mutex);
+}
+
+int DmdThreadCondition::TimedWait(DmdThreadMutex *pMutex,
+        unsigned int iTimeoutMs) {
+    struct timespec ts;
+#if defined(LINUX)
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+    clock_gettime(CLOCK_REALTIME, &ts);
+#endif
+    ts.tv_sec += iTimeoutMs / 1000;
+    ts.tv_nsec += (iTimeoutMs % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    return pthread_cond_timedwait(&m_Cond, &pMutex->m_Mutex, &ts);
+}
+
+int DmdThreadCondition::Signal() {
+    return pthread_cond_signal(&m_Cond);
+}
+
+int DmdThreadCondition::Broadcast() {
+    return pthread_cond_broadcast(&m_Cond);
+}
+
+}  // namespace opendmd
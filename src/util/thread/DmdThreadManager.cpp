@@ -60,19 +60,20 @@ DmdThreadManager::~DmdThreadManager() {
 }
 
 DMD_RESULT DmdThreadManager::addThread(DmdThreadType eType,
-        DmdThreadRoutine pRoutine, void *arg) {
+        DmdThreadRoutine pRoutine, void *arg, unsigned int iIndex) {
     DMD_RESULT ret = DMD_S_OK;
 
-    DmdThread *pThread = getThread(eType);
+    DmdThread *pThread = getThread(eType, iIndex);
     if (NULL != pThread) {
         DMD_LOG_ERROR("DmdThreadManager::addThread(), "
                 << "thread with type " << dmdThreadType[eType]
+                << ", index " << iIndex
                 << " already added to thread manager");
         ret = DMD_S_FAIL;
         return ret;
     }
 
-    pThread = new DmdThread(eType, pRoutine, arg);
+    pThread = new DmdThread(eType, pRoutine, arg, iIndex);
 
     m_mtxThreadManagerMutex.Lock();
     m_listThreadList.push_back(pThread);
@@ -81,11 +82,13 @@ DMD_RESULT DmdThreadManager::addThread(DmdThreadType eType,
     return ret;
 }
 
-DmdThread *DmdThreadManager::getThread(DmdThreadType eType) {
+DmdThread *DmdThreadManager::getThread(DmdThreadType eType,
+        unsigned int iIndex) {
     DmdThreadListIterator iter;
     for (iter = m_listThreadList.begin(); iter != m_listThreadList.end();
             iter++) {
-        if (eType == (*iter)->getThreadType()) {
+        if (eType == (*iter)->getThreadType()
+                && iIndex == (*iter)->getThreadIndex()) {
             return *iter;
         }
     }
@@ -93,9 +96,10 @@ DmdThread *DmdThreadManager::getThread(DmdThreadType eType) {
     return NULL;
 }
 
-DMD_RESULT DmdThreadManager::spawnThread(DmdThreadType eType) {
+DMD_RESULT DmdThreadManager::spawnThread(DmdThreadType eType,
+        unsigned int iIndex) {
     DMD_RESULT ret = DMD_S_OK;
-    DmdThread *pThread = getThread(eType);
+    DmdThread *pThread = getThread(eType, iIndex);
     if (NULL == pThread) {
         DMD_LOG_ERROR("DmdThreadManager::spawnThread(), "
                 << "thread with type " << dmdThreadType[eType]
@@ -140,9 +144,10 @@ DMD_RESULT DmdThreadManager::spawnAllThreads() {
     return ret;
 }
 
-DMD_RESULT DmdThreadManager::killThread(DmdThreadType eType) {
+DMD_RESULT DmdThreadManager::killThread(DmdThreadType eType,
+        unsigned int iIndex) {
     DMD_RESULT ret = DMD_S_OK;
-    DmdThread *pThread = getThread(eType);
+    DmdThread *pThread = getThread(eType, iIndex);
     if (NULL == pThread) {
         DMD_LOG_ERROR("DmdThreadManager::killThread(), "
                 << "thread with type " << dmdThreadType[eType]
@@ -226,11 +231,13 @@ DMD_RESULT DmdThreadManager::killAllThreads() {
     return ret;
 }
 
-void DmdThreadManager::cleanThread(DmdThreadType eType) {
+void DmdThreadManager::cleanThread(DmdThreadType eType,
+        unsigned int iIndex) {
     DmdThreadListIterator iter;
     for (iter = m_listThreadList.begin(); iter != m_listThreadList.end();
             iter++) {
-        if (eType == (*iter)->getThreadType()) {
+        if (eType == (*iter)->getThreadType()
+                && iIndex == (*iter)->getThreadIndex()) {
             delete *iter;
             m_listThreadList.erase(iter);
             break;
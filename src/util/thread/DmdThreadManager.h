@@ -58,16 +58,17 @@ public:
     DmdThreadManager();
     ~DmdThreadManager();
 
+    // iIndex tells apart the workers of a thread pool of the same type;
     DMD_RESULT addThread(DmdThreadType eType, DmdThreadRoutine pRoutine,
-                         void *arg);
-    DmdThread *getThread(DmdThreadType eType);
-    DMD_RESULT spawnThread(DmdThreadType eType);
+                         void *arg, unsigned int iIndex = 0);
+    DmdThread *getThread(DmdThreadType eType, unsigned int iIndex = 0);
+    DMD_RESULT spawnThread(DmdThreadType eType, unsigned int iIndex = 0);
     DMD_RESULT spawnAllThreads();
 
-    DMD_RESULT killThread(DmdThreadType eType);
+    DMD_RESULT killThread(DmdThreadType eType, unsigned int iIndex = 0);
     DMD_RESULT killAllThreads();
 
-    void cleanThread(DmdThreadType eType);
+    void cleanThread(DmdThreadType eType, unsigned int iIndex = 0);
     void cleanAllThreads();
 
     static DmdThreadManager *singleton();
@@ -42,6 +42,8 @@
 #include "thread/DmdThreadUtils.h"
 
 namespace opendmd {
+class DmdThreadCondition;
+
 class DmdThreadMutex {
 public:
     DmdThreadMutex();
@@ -51,6 +53,7 @@ public:
     int Unlock();
 
 private:
+    friend class DmdThreadCondition;
     DmdThreadMutex_t m_Mutex;
 };
 
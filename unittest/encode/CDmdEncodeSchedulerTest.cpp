@@ -0,0 +1,249 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeSchedulerTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : test class of CDmdEncodeScheduler.
+ ============================================================================
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "CDmdColorConvert.h"
+#include "CDmdEncodeScheduler.h"
+#include "CDmdEncodeStage.h"
+#include "CDmdEncodeThread.h"
+#include "DmdTimeUtils.h"
+#include "thread/DmdThreadManager.h"
+
+using namespace opendmd;
+using std::vector;
+
+// record which camera each access unit came from;
+class CDmdOrderCollector : public IDmdEncodeEngineSink {
+public:
+    CDmdOrderCollector(vector<int> *pOrder, int iCamera)
+        : m_pOrder(pOrder), m_iCamera(iCamera) {}
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) {
+        m_pOrder->push_back(m_iCamera);
+        return DMD_S_OK;
+    }
+
+private:
+    vector<int> *m_pOrder;
+    int m_iCamera;
+};
+
+class CDmdEncodeSchedulerTest : public testing::Test {
+public:
+    CDmdEncodeSchedulerTest() : iWidth(160), iHeight(96) {
+        buffer.resize(DmdI420FrameSize(iWidth, iHeight));
+        memset(&buffer[0], 128, buffer.size());
+        memset(&videoRawData, 0, sizeof(videoRawData));
+        DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+
+        memset(&encodeParam, 0, sizeof(encodeParam));
+        encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+        encodeParam.iTargetBitrate = 256 * 1024;
+        encodeParam.eRcMode = DmdRcBitrate;
+        encodeParam.eComplexity = DmdComplexityMedium;
+        encodeParam.iThreadCount = 1;
+        encodeParam.bEnableFrameSkip = false;
+    }
+
+    virtual ~CDmdEncodeSchedulerTest() {}
+
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    void deliver(CDmdEncodeStage *pStage, unsigned int iIndex) {
+        buffer[iIndex % (iWidth * iHeight)] = static_cast<uint8_t>(iIndex);
+        videoRawData.fmtVideoFormat.ulTimestamp = (iIndex + 1) * 33333;
+        EXPECT_EQ(DMD_S_OK, pStage->DeliverVideoData(&videoRawData));
+    }
+
+public:
+    unsigned int iWidth;
+    unsigned int iHeight;
+    vector<uint8_t> buffer;
+    DmdVideoRawData videoRawData;
+    DmdEncodeParam encodeParam;
+};
+
+TEST_F(CDmdEncodeSchedulerTest, EarliestDeadlineFirst) {
+    vector<int> order;
+    CDmdOrderCollector collector0(&order, 0);
+    CDmdOrderCollector collector1(&order, 1);
+    CDmdEncodeStage stage0;
+    CDmdEncodeStage stage1;
+    EXPECT_EQ(DMD_S_OK, stage0.Init(encodeParam, 4));
+    stage0.SetDataSink(&collector0);
+    // a camera running at half the rate has twice the time per frame;
+    encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE / 2;
+    EXPECT_EQ(DMD_S_OK, stage1.Init(encodeParam, 4));
+    stage1.SetDataSink(&collector1);
+
+    CDmdEncodeScheduler scheduler;
+    unsigned int iCamera0 = 0;
+    unsigned int iCamera1 = 0;
+    EXPECT_EQ(DMD_S_OK, scheduler.Init(1, DMD_ENCODE_SCHEDULER_WINDOW_MS));
+    EXPECT_EQ(DMD_S_OK, scheduler.AddCamera(&stage0, 1, &iCamera0));
+    EXPECT_EQ(DMD_S_OK, scheduler.AddCamera(&stage1, 1, &iCamera1));
+    EXPECT_EQ(1U, iCamera1);
+
+    // camera 1 delivers first but is due later;
+    deliver(&stage1, 0);
+    usleep(2000);
+    deliver(&stage0, 0);
+    usleep(2000);
+    deliver(&stage0, 1);
+    while (scheduler.ScheduleOnce(0)) {
+    }
+    ASSERT_EQ(3U, order.size());
+    EXPECT_EQ(0, order[0]);
+    EXPECT_EQ(0, order[1]);
+    EXPECT_EQ(1, order[2]);
+
+    DmdEncodeCameraStats stats;
+    EXPECT_EQ(DMD_S_OK, scheduler.GetCameraStats(iCamera0, &stats));
+    EXPECT_EQ(2U, stats.ulScheduledCount);
+    EXPECT_EQ(DMD_S_FAIL, scheduler.GetCameraStats(2, &stats));
+    EXPECT_EQ(DMD_S_OK, scheduler.Uninit());
+}
+
+TEST_F(CDmdEncodeSchedulerTest, DegradeLowPriorityFirst) {
+    CDmdEncodeStage highStage;
+    CDmdEncodeStage lowStage;
+    EXPECT_EQ(DMD_S_OK, highStage.Init(encodeParam, 4));
+    EXPECT_EQ(DMD_S_OK, lowStage.Init(encodeParam, 4));
+
+    CDmdEncodeScheduler scheduler;
+    unsigned int iHigh = 0;
+    unsigned int iLow = 0;
+    EXPECT_EQ(DMD_S_OK, scheduler.Init(1, 50));
+    EXPECT_EQ(DMD_S_OK, scheduler.AddCamera(&highStage, 10, &iHigh));
+    EXPECT_EQ(DMD_S_OK, scheduler.AddCamera(&lowStage, 1, &iLow));
+
+    // frames wait longer than a frame interval, as on a saturated box;
+    unsigned int iFrame = 0;
+    for (int i = 0; i < 3; i++, iFrame++) {
+        deliver(&highStage, iFrame);
+        deliver(&lowStage, iFrame);
+        usleep(60000);
+        while (scheduler.ScheduleOnce(0)) {
+        }
+    }
+
+    DmdEncodeCameraStats highStats;
+    DmdEncodeCameraStats lowStats;
+    scheduler.GetCameraStats(iHigh, &highStats);
+    scheduler.GetCameraStats(iLow, &lowStats);
+    EXPECT_EQ(3U, highStats.ulDeadlineMissCount);
+    EXPECT_GE(highStats.ulMaxLatenessUs, 20000U);
+    EXPECT_EQ(0U, highStats.iDegradeLevel);
+    EXPECT_EQ(2U, lowStats.iDegradeLevel);
+    EXPECT_EQ(2U, lowStats.ulDegradeCount);
+
+    // level 2 keeps one of every two frames of the low camera;
+    for (int i = 0; i < 4; i++, iFrame++) {
+        deliver(&lowStage, iFrame);
+        scheduler.ScheduleOnce(0);
+    }
+    DmdEncodeStats encodeStats;
+    lowStage.GetStats(&encodeStats);
+    EXPECT_EQ(2U, encodeStats.ulDecimatedCount);
+
+    // on time again with headroom, restored one level per window;
+    for (int i = 0; i < 40; i++, iFrame++) {
+        deliver(&highStage, iFrame);
+        deliver(&lowStage, iFrame);
+        while (scheduler.ScheduleOnce(0)) {
+        }
+        usleep(10000);
+    }
+    scheduler.GetCameraStats(iLow, &lowStats);
+    EXPECT_EQ(0U, lowStats.iDegradeLevel);
+    EXPECT_EQ(lowStats.ulDegradeCount, lowStats.ulRestoreCount);
+    scheduler.GetCameraStats(iHigh, &highStats);
+    EXPECT_EQ(0U, highStats.ulDegradeCount);
+    EXPECT_EQ(DMD_S_OK, scheduler.Uninit());
+}
+
+TEST_F(CDmdEncodeSchedulerTest, WorkersFromThreadManager) {
+    const int iCameraCount = 3;
+    CDmdEncodeStage stages[iCameraCount];
+    CDmdEncodeScheduler scheduler;
+    EXPECT_EQ(DMD_S_OK, scheduler.Init(2, DMD_ENCODE_SCHEDULER_WINDOW_MS));
+    for (int i = 0; i < iCameraCount; i++) {
+        EXPECT_EQ(DMD_S_OK, stages[i].Init(encodeParam, 4));
+        EXPECT_EQ(DMD_S_OK, scheduler.AddCamera(&stages[i], i, NULL));
+    }
+
+    DmdThreadManager threadManager;
+    g_bEncodeThreadRunning = true;
+    EXPECT_EQ(DMD_S_OK, scheduler.AddWorkerThreads(&threadManager));
+    EXPECT_TRUE(threadManager.getThread(DMD_THREAD_ENCODE, 1) != NULL);
+    EXPECT_TRUE(threadManager.getThread(DMD_THREAD_ENCODE, 2) == NULL);
+    EXPECT_EQ(DMD_S_OK, threadManager.spawnAllThreads());
+
+    for (unsigned int i = 0; i < 10; i++) {
+        for (int j = 0; j < iCameraCount; j++) {
+            deliver(&stages[j], i);
+        }
+        usleep(10000);
+    }
+
+    uint64_t ulScheduled = 0;
+    for (int i = 0; i < 200 && ulScheduled < 10U * iCameraCount; i++) {
+        usleep(10000);
+        ulScheduled = 0;
+        for (int j = 0; j < iCameraCount; j++) {
+            DmdEncodeCameraStats stats;
+            scheduler.GetCameraStats(j, &stats);
+            ulScheduled += stats.ulScheduledCount;
+        }
+    }
+    EXPECT_EQ(10U * iCameraCount, ulScheduled);
+
+    scheduler.StopWorkers();
+    EXPECT_EQ(DMD_S_OK, threadManager.killAllThreads());
+    threadManager.cleanAllThreads();
+    EXPECT_EQ(DMD_S_OK, scheduler.Uninit());
+}
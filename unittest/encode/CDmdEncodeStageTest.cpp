@@ -0,0 +1,736 @@
+/*
+ ============================================================================
+ * Name        : CDmdEncodeStageTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : test class of CDmdEncodeStage and h264 encode engine.
+ ============================================================================
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "CDmdColorConvert.h"
+#include "CDmdEncodeEngine.h"
+#include "CDmdEncodeEngineH264.h"
+#include "CDmdEncodeStage.h"
+#include "CDmdEncodeThread.h"
+#include "CDmdPreprocessor.h"
+#include "DmdStartup.h"
+#include "thread/DmdBoundedQueue.h"
+
+using namespace opendmd;
+using std::vector;
+
+// collect access units delivered by the encoder;
+class CDmdEncodedCollector : public IDmdEncodeEngineSink {
+public:
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) {
+        frames.push_back(*pEncodedFrame);
+        bitstreams.push_back(vector<uint8_t>(pEncodedFrame->pData,
+                    pEncodedFrame->pData + pEncodedFrame->ulDataLen));
+        return DMD_S_OK;
+    }
+
+    vector<DmdEncodedFrame> frames;
+    vector<vector<uint8_t> > bitstreams;
+};
+
+// keeps the last access units by reference, as a send queue would;
+class CDmdEncodedHolder : public IDmdEncodeEngineSink {
+public:
+    explicit CDmdEncodedHolder(size_t ulDepth) : ulHoldDepth(ulDepth) {}
+    ~CDmdEncodedHolder() {
+        while (!frames.empty()) {
+            releaseOldest();
+        }
+    }
+
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) {
+        if (NULL == pEncodedFrame->pFrameBuffer) {
+            return DMD_S_OK;
+        }
+        pEncodedFrame->pFrameBuffer->AddRef();
+        frames.push_back(*pEncodedFrame);
+        if (frames.size() > ulHoldDepth) {
+            releaseOldest();
+        }
+        return DMD_S_OK;
+    }
+
+    void releaseOldest() {
+        frames.front().pFrameBuffer->Release();
+        frames.erase(frames.begin());
+    }
+
+    size_t ulHoldDepth;
+    vector<DmdEncodedFrame> frames;
+};
+
+// frame handle that counts references, to observe zero-copy binding;
+class CDmdCountedFrameBuffer : public IDmdFrameBuffer {
+public:
+    CDmdCountedFrameBuffer() : iRefCount(1), iReleaseCount(0) {}
+    void AddRef() {iRefCount++;}
+    void Release() {iRefCount--; iReleaseCount++;}
+
+    int iRefCount;
+    int iReleaseCount;
+};
+
+class CDmdEncodeStageTest : public testing::Test {
+public:
+    CDmdEncodeStageTest() : iWidth(160), iHeight(96) {
+        buffer.resize(DmdI420FrameSize(iWidth, iHeight));
+        memset(&videoRawData, 0, sizeof(videoRawData));
+        DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+
+        memset(&encodeParam, 0, sizeof(encodeParam));
+        encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+        encodeParam.iTargetBitrate = 256 * 1024;
+        encodeParam.iGopSize = 0;
+        encodeParam.eRcMode = DmdRcBitrate;
+        encodeParam.eComplexity = DmdComplexityLow;
+        encodeParam.iThreadCount = 1;
+        encodeParam.bEnableFrameSkip = true;
+    }
+
+    virtual ~CDmdEncodeStageTest() {}
+
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    // a moving gradient, so that p frames are not empty;
+    void fillFrame(unsigned int iIndex) {
+        for (unsigned int y = 0; y < iHeight; y++) {
+            for (unsigned int x = 0; x < iWidth; x++) {
+                buffer[y * iWidth + x] =
+                    static_cast<uint8_t>(x * 2 + y + iIndex * 3);
+            }
+        }
+        memset(&buffer[iWidth * iHeight], 128,
+                buffer.size() - iWidth * iHeight);
+        videoRawData.fmtVideoFormat.ulTimestamp = iIndex * 33333;
+    }
+
+    static int nalType(const vector<uint8_t> &bitstream, size_t ulOffset) {
+        return bitstream[ulOffset] & 0x1f;
+    }
+
+    // nal unit types following each 4 byte start code;
+    static vector<int> nalTypes(const vector<uint8_t> &bitstream) {
+        vector<int> types;
+        for (size_t i = 0; i + 4 < bitstream.size(); i++) {
+            if (0 == bitstream[i] && 0 == bitstream[i + 1]
+                    && 0 == bitstream[i + 2] && 1 == bitstream[i + 3]) {
+                types.push_back(nalType(bitstream, i + 4));
+            }
+        }
+        return types;
+    }
+
+public:
+    unsigned int iWidth;
+    unsigned int iHeight;
+    vector<uint8_t> buffer;
+    DmdVideoRawData videoRawData;
+    DmdEncodeParam encodeParam;
+};
+
+TEST_F(CDmdEncodeStageTest, EngineProducesAnnexB) {
+    IDmdEncodeEngine *pEngine = NULL;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, CreateVideoEncodeEngine(&pEngine));
+    ASSERT_TRUE(pEngine != NULL);
+    pEngine->SetDataSink(&collector);
+    EXPECT_EQ(DMD_S_OK, pEngine->Init(encodeParam));
+
+    for (unsigned int i = 0; i < 3; i++) {
+        fillFrame(i);
+        EXPECT_EQ(DMD_S_OK, pEngine->EncodeFrame(&videoRawData));
+    }
+    ASSERT_EQ(3U, collector.frames.size());
+
+    // the first access unit carries sps, pps and an idr slice;
+    EXPECT_EQ(DmdFrameIDR, collector.frames[0].eFrameType);
+    EXPECT_EQ(iWidth, collector.frames[0].iWidth);
+    vector<int> types = nalTypes(collector.bitstreams[0]);
+    ASSERT_GE(types.size(), 3U);
+    EXPECT_EQ(7, types[0]);
+    EXPECT_EQ(8, types[1]);
+    EXPECT_EQ(5, types[2]);
+    EXPECT_EQ(collector.frames[0].iNalCount, types.size());
+    EXPECT_EQ(DmdFrameP, collector.frames[2].eFrameType);
+    EXPECT_EQ(2U * 33333, collector.frames[2].ulTimestamp);
+
+    // a forced idr at the next frame;
+    EXPECT_EQ(DMD_S_OK, pEngine->ForceIntraFrame());
+    fillFrame(3);
+    EXPECT_EQ(DMD_S_OK, pEngine->EncodeFrame(&videoRawData));
+    EXPECT_EQ(DmdFrameIDR, collector.frames.back().eFrameType);
+
+    // formats other than I420 are refused;
+    videoRawData.fmtVideoFormat.eVideoType = DmdYUYV;
+    EXPECT_EQ(DMD_S_FAIL, pEngine->EncodeFrame(&videoRawData));
+
+    EXPECT_EQ(DMD_S_OK, pEngine->Uninit());
+    EXPECT_EQ(DMD_S_OK, ReleaseVideoEncodeEngine(&pEngine));
+}
+
+// nal_ref_idc of the last nal unit of each access unit, a slice;
+static vector<int> sliceNris(const CDmdEncodedCollector &collector) {
+    vector<int> nris;
+    for (size_t f = 0; f < collector.bitstreams.size(); f++) {
+        const vector<uint8_t> &bitstream = collector.bitstreams[f];
+        int iNri = -1;
+        for (size_t i = 0; i + 3 < bitstream.size(); i++) {
+            if (0 == bitstream[i] && 0 == bitstream[i + 1]
+                    && 1 == bitstream[i + 2]) {
+                iNri = (bitstream[i + 3] >> 5) & 0x3;
+            }
+        }
+        nris.push_back(iNri);
+    }
+    return nris;
+}
+
+TEST_F(CDmdEncodeStageTest, NonReferenceFramesOnRequest) {
+    for (int i = 0; i < 2; i++) {
+        encodeParam.bNonReferenceFrames = 1 == i;
+        CDmdEncodeEngineH264 engine;
+        CDmdEncodedCollector collector;
+        engine.SetDataSink(&collector);
+        ASSERT_EQ(DMD_S_OK, engine.Init(encodeParam));
+        for (unsigned int j = 0; j < 6; j++) {
+            fillFrame(j);
+            ASSERT_EQ(DMD_S_OK, engine.EncodeFrame(&videoRawData));
+        }
+        EXPECT_EQ(DMD_S_OK, engine.Uninit());
+
+        // one temporal layer by default, every frame a reference;
+        vector<int> nris = sliceNris(collector);
+        ASSERT_EQ(6U, nris.size());
+        for (size_t j = 0; j < nris.size(); j++) {
+            EXPECT_EQ(0 == i || 0 == j % 2, 0 != nris[j]) << i << " " << j;
+        }
+    }
+}
+
+TEST_F(CDmdEncodeStageTest, EngineSharesPooledBitstream) {
+    CDmdEncodeEngineH264 engine;
+    CDmdEncodedHolder holder(2);
+    vector<uint8_t> heldBytes;
+    engine.SetDataSink(&holder);
+    EXPECT_EQ(DMD_S_OK, engine.Init(encodeParam));
+
+    for (unsigned int i = 0; i < 30; i++) {
+        fillFrame(i);
+        EXPECT_EQ(DMD_S_OK, engine.EncodeFrame(&videoRawData));
+
+        // nal iovecs tile the annex-b bytes, less the start codes;
+        const DmdEncodedFrame &frame = holder.frames.back();
+        ASSERT_TRUE(frame.pNalIov != NULL);
+        const uint8_t *pCursor = frame.pData;
+        for (unsigned int j = 0; j < frame.iNalCount; j++) {
+            const uint8_t *pNal =
+                static_cast<const uint8_t *>(frame.pNalIov[j].iov_base);
+            EXPECT_EQ(0, pCursor[0]);
+            EXPECT_EQ(0, pCursor[1]);
+            EXPECT_LE(pNal - pCursor, 4);
+            EXPECT_EQ(1, pNal[-1]);
+            pCursor = pNal + frame.pNalIov[j].iov_len;
+        }
+        EXPECT_EQ(frame.pData + frame.ulDataLen, pCursor);
+        if (28 == i) {
+            heldBytes.assign(frame.pData, frame.pData + frame.ulDataLen);
+        }
+    }
+
+    // held frames stay intact while later ones are encoded;
+    ASSERT_EQ(2U, holder.frames.size());
+    EXPECT_NE(holder.frames[0].pData, holder.frames[1].pData);
+    EXPECT_EQ(28U * 33333, holder.frames[0].ulTimestamp);
+    EXPECT_TRUE(vector<uint8_t>(holder.frames[0].pData,
+                holder.frames[0].pData + holder.frames[0].ulDataLen)
+            == heldBytes);
+
+    // buffers are recycled, only those in flight were ever allocated;
+    EXPECT_LE(engine.GetBitstreamAllocCount(), 3U);
+    EXPECT_EQ(DMD_S_OK, engine.Uninit());
+}
+
+TEST_F(CDmdEncodeStageTest, QueueDropsOldestWhenFull) {
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    encodeStage.SetDataSink(&collector);
+
+    // capture runs ahead of the encoder;
+    for (unsigned int i = 0; i < 5; i++) {
+        fillFrame(i);
+        EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+    }
+    EXPECT_EQ(DMD_S_OK, encodeStage.EncodeQueuedFrame(0));
+    EXPECT_EQ(DMD_S_OK, encodeStage.EncodeQueuedFrame(0));
+    EXPECT_EQ(DMD_S_OK, encodeStage.EncodeQueuedFrame(0));
+
+    ASSERT_EQ(2U, collector.frames.size());
+    EXPECT_EQ(3U * 33333, collector.frames[0].ulTimestamp);
+    EXPECT_EQ(4U * 33333, collector.frames[1].ulTimestamp);
+
+    DmdEncodeStats stats;
+    encodeStage.GetStats(&stats);
+    EXPECT_EQ(5U, stats.ulInputCount);
+    EXPECT_EQ(3U, stats.ulDroppedCount);
+    EXPECT_EQ(2U, stats.ulEncodedCount);
+    EXPECT_EQ(1U, stats.ulIdrCount);
+    EXPECT_EQ(collector.bitstreams[0].size() + collector.bitstreams[1].size(),
+            stats.ulTotalBytes);
+    EXPECT_GT(stats.ulMaxLatencyUs, 0U);
+    EXPECT_GE(stats.ulMaxLatencyUs, stats.ulMaxEncodeCostUs);
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+static void *encodeLoopRoutine(void *param) {
+    reinterpret_cast<CDmdEncodeStage *>(param)->RunEncodeLoop();
+    return NULL;
+}
+
+TEST_F(CDmdEncodeStageTest, EncodeOnDedicatedThread) {
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam,
+                DMD_ENCODE_DEFAULT_QUEUE_DEPTH));
+    encodeStage.SetDataSink(&collector);
+
+    g_bEncodeThreadRunning = true;
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, encodeLoopRoutine,
+                &encodeStage));
+
+    DmdEncodeStats stats;
+    memset(&stats, 0, sizeof(stats));
+    for (unsigned int i = 0; i < 10; i++) {
+        fillFrame(i);
+        encodeStage.DeliverVideoData(&videoRawData);
+        if (5 == i) {
+            encodeStage.ForceIntraFrame();
+        }
+        usleep(20000);
+    }
+    for (int i = 0; i < 100; i++) {
+        encodeStage.GetStats(&stats);
+        if (stats.ulEncodedCount + stats.ulDroppedCount
+                + stats.ulSkippedCount >= 10) {
+            break;
+        }
+        usleep(10000);
+    }
+
+    g_bEncodeThreadRunning = false;
+    EXPECT_EQ(0, pthread_join(thread, NULL));
+    EXPECT_EQ(10U, stats.ulInputCount);
+    EXPECT_EQ(10U, stats.ulEncodedCount + stats.ulDroppedCount
+            + stats.ulSkippedCount);
+    EXPECT_GE(stats.ulIdrCount, 2U);
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+TEST_F(CDmdEncodeStageTest, ZeroCopyFromPreprocessor) {
+    CDmdPreprocessor preprocessor;
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    DmdPreprocessParam preprocessParam = {{0, DMD_DENOISE_DEFAULT_THRESHOLD}};
+    EXPECT_EQ(DMD_S_OK, preprocessor.Init(preprocessParam));
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    preprocessor.SetDataSink(&encodeStage);
+    encodeStage.SetDataSink(&collector);
+
+    for (unsigned int i = 0; i < 20; i++) {
+        fillFrame(i);
+        EXPECT_EQ(DMD_S_OK, preprocessor.DeliverVideoData(&videoRawData));
+        if (i % 2) {
+            encodeStage.EncodeQueuedFrame(0);
+            encodeStage.EncodeQueuedFrame(0);
+        }
+    }
+
+    // the conversion pass is the only copy, frames are then recycled;
+    DmdEncodeStats encodeStats;
+    encodeStage.GetStats(&encodeStats);
+    EXPECT_EQ(20U, encodeStats.ulZeroCopyCount);
+    EXPECT_EQ(0U, encodeStats.ulCopyCount);
+    EXPECT_EQ(0U, encodeStats.ulChromaConvertCount);
+    EXPECT_EQ(20U, encodeStats.ulEncodedCount + encodeStats.ulSkippedCount);
+    DmdPreprocessStats preprocessStats;
+    preprocessor.GetStats(&preprocessStats);
+    EXPECT_LE(preprocessStats.ulFrameAllocCount, 3U);
+
+    // queued frames keep their buffers after the producer stops;
+    fillFrame(20);
+    EXPECT_EQ(DMD_S_OK, preprocessor.DeliverVideoData(&videoRawData));
+    EXPECT_EQ(DMD_S_OK, preprocessor.Uninit());
+    EXPECT_EQ(DMD_S_OK, encodeStage.EncodeQueuedFrame(0));
+    EXPECT_EQ(20U * 33333, collector.frames.back().ulTimestamp);
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+static DMD_RESULT warmupStageRoutine(void *param) {
+    return reinterpret_cast<CDmdEncodeStage *>(param)->Warmup(160, 96);
+}
+
+TEST_F(CDmdEncodeStageTest, WarmupAheadOfFirstFrame) {
+    // buffers come from the warmed up pools, none at the first frames;
+    CDmdEncodeEngineH264 engine;
+    CDmdEncodedHolder holder(1);
+    engine.SetDataSink(&holder);
+    EXPECT_EQ(DMD_S_OK, engine.Init(encodeParam));
+    EXPECT_EQ(DMD_S_OK, engine.Prepare(iWidth, iHeight));
+    EXPECT_EQ(2U, engine.GetBitstreamAllocCount());
+    for (unsigned int i = 0; i < 10; i++) {
+        fillFrame(i);
+        EXPECT_EQ(DMD_S_OK, engine.EncodeFrame(&videoRawData));
+    }
+    EXPECT_EQ(1U, holder.frames.size());
+    EXPECT_EQ(2U, engine.GetBitstreamAllocCount());
+    EXPECT_EQ(DMD_S_OK, engine.Uninit());
+
+    CDmdPreprocessor preprocessor;
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    DmdPreprocessParam preprocessParam = {{0, DMD_DENOISE_DEFAULT_THRESHOLD}};
+    EXPECT_EQ(DMD_S_OK, preprocessor.Init(preprocessParam));
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    DmdDetectLayerParam detectParam = {true, 2, 64 * 1024, 30.0f};
+    EXPECT_EQ(DMD_S_OK, encodeStage.SetDetectLayer(detectParam));
+    preprocessor.SetDataSink(&encodeStage);
+    encodeStage.SetDataSink(&collector);
+
+    // independent of each other, run concurrently;
+    DmdStartup startup;
+    DmdStartupTask arrTasks[] = {
+        {"encoder warmup", warmupStageRoutine, &encodeStage},
+    };
+    EXPECT_EQ(DMD_S_OK, startup.RunParallel(arrTasks, 1));
+    EXPECT_EQ(DMD_S_OK, preprocessor.Warmup(iWidth, iHeight, 4));
+    EXPECT_EQ(DMD_S_FAIL, encodeStage.Warmup(0, iHeight));
+    vector<DmdStartupPhase> vecPhases;
+    startup.GetPhases(&vecPhases);
+    ASSERT_EQ(1U, vecPhases.size());
+    EXPECT_EQ("encoder warmup", vecPhases[0].sName);
+    EXPECT_TRUE(vecPhases[0].bSucceeded);
+
+    DmdEncodeStats encodeStats;
+    encodeStage.GetStats(&encodeStats);
+    EXPECT_EQ(0U, encodeStats.ulFirstFrameUs);
+    for (unsigned int i = 0; i < 10; i++) {
+        fillFrame(i);
+        EXPECT_EQ(DMD_S_OK, preprocessor.DeliverVideoData(&videoRawData));
+        EXPECT_EQ(DMD_S_OK, encodeStage.EncodeQueuedFrame(0));
+    }
+    encodeStage.GetStats(&encodeStats);
+    EXPECT_GT(encodeStats.ulFirstFrameUs, startup.GetStartUs());
+    EXPECT_EQ(10U, encodeStats.ulEncodedCount + encodeStats.ulSkippedCount);
+    EXPECT_EQ(10U, encodeStats.ulDetectEncodedCount);
+    ASSERT_FALSE(collector.frames.empty());
+    EXPECT_EQ(DmdFrameIDR, collector.frames[0].eFrameType);
+    DmdPreprocessStats preprocessStats;
+    preprocessor.GetStats(&preprocessStats);
+    EXPECT_EQ(4U, preprocessStats.ulFrameAllocCount);
+
+    EXPECT_EQ(DMD_S_OK, preprocessor.Uninit());
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+TEST_F(CDmdEncodeStageTest, Nv12HandleConvertsChromaOnly) {
+    // the same picture as nv12 behind a handle, and as plain i420;
+    fillFrame(0);
+    vector<uint8_t> nv12(buffer.size());
+    size_t ulLumaSize = iWidth * iHeight;
+    size_t ulChromaSize = ulLumaSize / 4;
+    memcpy(&nv12[0], &buffer[0], ulLumaSize);
+    for (size_t i = 0; i < ulChromaSize; i++) {
+        buffer[ulLumaSize + i] = static_cast<uint8_t>(i);
+        buffer[ulLumaSize + ulChromaSize + i] = static_cast<uint8_t>(255 - i);
+        nv12[ulLumaSize + 2 * i] = buffer[ulLumaSize + i];
+        nv12[ulLumaSize + 2 * i + 1] = buffer[ulLumaSize + ulChromaSize + i];
+    }
+
+    CDmdCountedFrameBuffer frameBuffer;
+    DmdVideoRawData nv12Frame;
+    memset(&nv12Frame, 0, sizeof(nv12Frame));
+    nv12Frame.fmtVideoFormat = videoRawData.fmtVideoFormat;
+    nv12Frame.fmtVideoFormat.eVideoType = DmdNV12;
+    nv12Frame.pSrcData = &nv12[0];
+    nv12Frame.ulDataLen = nv12.size();
+    nv12Frame.pFrameBuffer = &frameBuffer;
+    DmdFixupRawDataPlanes(&nv12Frame);
+
+    CDmdEncodeStage nv12Stage;
+    CDmdEncodedCollector nv12Collector;
+    EXPECT_EQ(DMD_S_OK, nv12Stage.Init(encodeParam, 2));
+    nv12Stage.SetDataSink(&nv12Collector);
+    EXPECT_EQ(DMD_S_OK, nv12Stage.DeliverVideoData(&nv12Frame));
+    EXPECT_EQ(2, frameBuffer.iRefCount);
+    EXPECT_EQ(DMD_S_OK, nv12Stage.EncodeQueuedFrame(0));
+    EXPECT_EQ(1, frameBuffer.iRefCount);
+    EXPECT_EQ(1, frameBuffer.iReleaseCount);
+
+    CDmdEncodeStage i420Stage;
+    CDmdEncodedCollector i420Collector;
+    EXPECT_EQ(DMD_S_OK, i420Stage.Init(encodeParam, 2));
+    i420Stage.SetDataSink(&i420Collector);
+    EXPECT_EQ(DMD_S_OK, i420Stage.DeliverVideoData(&videoRawData));
+    EXPECT_EQ(DMD_S_OK, i420Stage.EncodeQueuedFrame(0));
+
+    ASSERT_EQ(1U, nv12Collector.bitstreams.size());
+    ASSERT_EQ(1U, i420Collector.bitstreams.size());
+    EXPECT_TRUE(nv12Collector.bitstreams[0] == i420Collector.bitstreams[0]);
+
+    DmdEncodeStats stats;
+    nv12Stage.GetStats(&stats);
+    EXPECT_EQ(1U, stats.ulZeroCopyCount);
+    EXPECT_EQ(0U, stats.ulCopyCount);
+    EXPECT_EQ(1U, stats.ulChromaConvertCount);
+    i420Stage.GetStats(&stats);
+    EXPECT_EQ(0U, stats.ulZeroCopyCount);
+    EXPECT_EQ(1U, stats.ulCopyCount);
+
+    // a dropped frame gives its reference back as well;
+    EXPECT_EQ(DMD_S_OK, nv12Stage.DeliverVideoData(&nv12Frame));
+    EXPECT_EQ(DMD_S_OK, nv12Stage.DeliverVideoData(&nv12Frame));
+    EXPECT_EQ(DMD_S_OK, nv12Stage.DeliverVideoData(&nv12Frame));
+    EXPECT_EQ(3, frameBuffer.iRefCount);
+    EXPECT_EQ(DMD_S_OK, nv12Stage.Uninit());
+    EXPECT_EQ(1, frameBuffer.iRefCount);
+    EXPECT_EQ(DMD_S_OK, i420Stage.Uninit());
+}
+
+TEST_F(CDmdEncodeStageTest, MotionGateIdrAtEventStart) {
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    encodeStage.SetDataSink(&collector);
+    DmdMotionGateParam gateParam = {true, 2.0f, 64 * 1024, 200, false, 0};
+    encodeStage.SetMotionGate(gateParam);
+
+    // 0.3s of motion, then 2s static, then motion again;
+    for (unsigned int i = 0; i < 70; i++) {
+        fillFrame(i < 10 || i >= 69 ? i : 9);
+        videoRawData.fmtVideoFormat.ulTimestamp = i * 33333;
+        videoRawData.ulFrameFlags = DMD_FRAME_FLAG_MOTION_ANALYSED
+            | (i < 10 || i >= 69 ? DMD_FRAME_FLAG_MOTION : 0);
+        EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+        encodeStage.EncodeQueuedFrame(0);
+    }
+
+    // hangover keeps frames 10..15, then one frame each 0.5s;
+    DmdEncodeStats stats;
+    encodeStage.GetStats(&stats);
+    EXPECT_EQ(70U, stats.ulInputCount);
+    EXPECT_EQ(53U, stats.ulIdleInputCount);
+    EXPECT_EQ(49U, stats.ulGatedCount);
+    EXPECT_EQ(1U, stats.ulMotionEventCount);
+    EXPECT_EQ(21U, stats.ulEncodedCount + stats.ulSkippedCount);
+    EXPECT_GT(stats.ulSavedBytes, 0U);
+    EXPECT_GE(stats.ulTotalEncodeCpuUs, stats.ulTotalEncodeCostUs / 100);
+
+    // the first frame with motion is an idr;
+    EXPECT_EQ(69U * 33333, collector.frames.back().ulTimestamp);
+    EXPECT_EQ(DmdFrameIDR, collector.frames.back().eFrameType);
+    EXPECT_EQ(2U, stats.ulIdrCount);
+    // frames of the idle gate are no motion content, those around are;
+    EXPECT_TRUE(collector.frames.front().bMotion);
+    EXPECT_FALSE(collector.frames[collector.frames.size() - 2].bMotion);
+    EXPECT_TRUE(collector.frames.back().bMotion);
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+TEST_F(CDmdEncodeStageTest, MotionGateHeartbeatOnly) {
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    encodeStage.SetDataSink(&collector);
+    DmdMotionGateParam gateParam = {true, 0, 0, 0, true, 300};
+    encodeStage.SetMotionGate(gateParam);
+
+    // a static scene from the start, only idr heartbeats are encoded;
+    fillFrame(0);
+    for (unsigned int i = 0; i < 30; i++) {
+        videoRawData.fmtVideoFormat.ulTimestamp = (i + 1) * 33333;
+        videoRawData.ulFrameFlags = DMD_FRAME_FLAG_MOTION_ANALYSED;
+        EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+        encodeStage.EncodeQueuedFrame(0);
+    }
+
+    ASSERT_EQ(3U, collector.frames.size());
+    for (size_t i = 0; i < collector.frames.size(); i++) {
+        EXPECT_EQ(DmdFrameIDR, collector.frames[i].eFrameType);
+    }
+    EXPECT_EQ(11U * 33333, collector.frames[1].ulTimestamp);
+
+    // frames without detector flags always pass the gate;
+    videoRawData.ulFrameFlags = 0;
+    EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+    encodeStage.EncodeQueuedFrame(0);
+    EXPECT_EQ(4U, collector.frames.size());
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+TEST_F(CDmdEncodeStageTest, DetectLayerStaysContinuous) {
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    encodeStage.SetDataSink(&collector);
+    DmdMotionGateParam gateParam = {true, 0, 0, 0, true, 300};
+    encodeStage.SetMotionGate(gateParam);
+    DmdDetectLayerParam detectParam = {true, 2, 64 * 1024, 10.0f};
+    EXPECT_EQ(DMD_S_OK, encodeStage.SetDetectLayer(detectParam));
+
+    // idle all along, record gets heartbeats, detect keeps 10 fps;
+    for (unsigned int i = 0; i < 30; i++) {
+        fillFrame(i);
+        videoRawData.fmtVideoFormat.ulTimestamp = (i + 1) * 33333;
+        videoRawData.ulFrameFlags = DMD_FRAME_FLAG_MOTION_ANALYSED;
+        EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+        encodeStage.EncodeQueuedFrame(0);
+    }
+
+    unsigned int iRecordCount = 0;
+    unsigned int iDetectCount = 0;
+    for (size_t i = 0; i < collector.frames.size(); i++) {
+        const DmdEncodedFrame &frame = collector.frames[i];
+        if (DmdLayerRecord == frame.eLayer) {
+            EXPECT_EQ(iWidth, frame.iWidth);
+            EXPECT_EQ(DmdFrameIDR, frame.eFrameType);
+            iRecordCount++;
+        } else {
+            EXPECT_EQ(DmdLayerDetect, frame.eLayer);
+            EXPECT_EQ(iWidth / 2, frame.iWidth);
+            EXPECT_EQ(iHeight / 2, frame.iHeight);
+            EXPECT_EQ(0U == iDetectCount ? DmdFrameIDR : DmdFrameP,
+                    frame.eFrameType);
+            iDetectCount++;
+        }
+    }
+    EXPECT_EQ(3U, iRecordCount);
+    EXPECT_EQ(10U, iDetectCount);
+
+    DmdEncodeStats stats;
+    encodeStage.GetStats(&stats);
+    EXPECT_EQ(3U, stats.ulEncodedCount);
+    EXPECT_EQ(10U, stats.ulDetectEncodedCount);
+    EXPECT_GT(stats.ulDetectBytes, 0U);
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+}
+
+// bytes of a textured scene crossed by an object, returning to background;
+static uint64_t encodeEventScene(const DmdEncodeParam &encodeParam,
+        DmdEncodeStats *pStats) {
+    unsigned int iWidth = 160, iHeight = 96;
+    vector<uint8_t> buffer(DmdI420FrameSize(iWidth, iHeight));
+    DmdVideoRawData videoRawData;
+    memset(&videoRawData, 0, sizeof(videoRawData));
+    DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+
+    CDmdEncodeStage encodeStage;
+    CDmdEncodedCollector collector;
+    EXPECT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+    encodeStage.SetDataSink(&collector);
+    for (unsigned int i = 0; i < 120; i++) {
+        bool bObject = i >= 40 && i < 70;
+        unsigned int iSeed = 1;
+        for (size_t j = 0; j < iWidth * iHeight; j++) {
+            iSeed = iSeed * 1103515245 + 12345;
+            buffer[j] = static_cast<uint8_t>(32 + (iSeed >> 16) % 192);
+        }
+        memset(&buffer[iWidth * iHeight], 128,
+                buffer.size() - iWidth * iHeight);
+        for (unsigned int y = 24; bObject && y < 72; y++) {
+            for (unsigned int x = 0; x < 48; x++) {
+                buffer[y * iWidth + (i - 40) * 3 + x] =
+                    static_cast<uint8_t>((x * 7) ^ (y * 5));
+            }
+        }
+        videoRawData.fmtVideoFormat.ulTimestamp = i * 33333;
+        videoRawData.ulFrameFlags = DMD_FRAME_FLAG_MOTION_ANALYSED
+            | (i >= 40 && i <= 70 ? DMD_FRAME_FLAG_MOTION : 0)
+            | (70 == i ? DMD_FRAME_FLAG_BACKGROUND : 0);
+        EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+        encodeStage.EncodeQueuedFrame(0);
+    }
+    encodeStage.GetStats(pStats);
+    EXPECT_EQ(DMD_S_OK, encodeStage.Uninit());
+
+    return pStats->ulTotalBytes;
+}
+
+TEST_F(CDmdEncodeStageTest, LtrProfileReferencesBackground) {
+    encodeParam.iTargetBitrate = 512 * 1024;
+    DmdEncodeStats defaultStats;
+    uint64_t ulDefaultBytes = encodeEventScene(encodeParam, &defaultStats);
+
+    encodeParam.bEnableLtr = true;
+    encodeParam.iLtrMarkPeriod = 10;
+    DmdEncodeStats ltrStats;
+    uint64_t ulLtrBytes = encodeEventScene(encodeParam, &ltrStats);
+
+    EXPECT_EQ(0U, defaultStats.ulLtrReferenceCount);
+    EXPECT_EQ(1U, ltrStats.ulLtrReferenceCount);
+    EXPECT_EQ(defaultStats.ulEncodedCount, ltrStats.ulEncodedCount);
+    // the background is not re-sent when the object leaves;
+    EXPECT_LT(ulLtrBytes * 100, ulDefaultBytes * 95);
+}
+
+TEST(DmdBoundedQueueTest, BoundedAndTimedPop) {
+    DmdBoundedQueue<int> queue(2);
+    EXPECT_TRUE(queue.TryPush(1));
+    EXPECT_TRUE(queue.TryPush(2));
+    EXPECT_FALSE(queue.TryPush(3));
+    EXPECT_EQ(2U, queue.Size());
+
+    int iItem = 0;
+    EXPECT_TRUE(queue.Pop(&iItem, 10));
+    EXPECT_EQ(1, iItem);
+    EXPECT_TRUE(queue.TryPop(&iItem));
+    EXPECT_EQ(2, iItem);
+    EXPECT_FALSE(queue.Pop(&iItem, 10));
+    EXPECT_FALSE(queue.TryPop(&iItem));
+}
@@ -0,0 +1,309 @@
+/*
+ ============================================================================
+ * Name        : CDmdRateControllerTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : test class of CDmdRateController.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+#include "CDmdColorConvert.h"
+#include "CDmdEncodeStage.h"
+#include "CDmdRateController.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdRateControllerTest : public testing::Test {
+public:
+    CDmdRateControllerTest() {
+        memset(&encodeParam, 0, sizeof(encodeParam));
+        encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+        encodeParam.iTargetBitrate = 2 * 1000 * 1000;
+        encodeParam.eRcMode = DmdRcBitrate;
+        encodeParam.eComplexity = DmdComplexityLow;
+        encodeParam.iThreadCount = 1;
+        encodeParam.bEnableFrameSkip = true;
+
+        memset(&rateParam, 0, sizeof(rateParam));
+        rateParam.iStartBitrate = 2 * 1000 * 1000;
+        rateParam.iMinBitrate = 100 * 1000;
+        rateParam.iMaxBitrate = 4 * 1000 * 1000;
+        rateParam.fMaxFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+        rateParam.fMinFrameRate = DMD_RATE_DEFAULT_MIN_FRAMERATE;
+        rateParam.iLowFrameRateBitrate = 1000 * 1000;
+        rateParam.iHighDelayMs = DMD_RATE_DEFAULT_HIGH_DELAY_MS;
+        rateParam.iLowDelayMs = DMD_RATE_DEFAULT_LOW_DELAY_MS;
+        rateParam.fHighLossRate = DMD_RATE_DEFAULT_HIGH_LOSS_RATE;
+        rateParam.fLowLossRate = DMD_RATE_DEFAULT_LOW_LOSS_RATE;
+        rateParam.iDecreaseHoldMs = DMD_RATE_DEFAULT_DECREASE_HOLD_MS;
+        rateParam.iIncreaseHoldMs = DMD_RATE_DEFAULT_INCREASE_HOLD_MS;
+    }
+
+    virtual ~CDmdRateControllerTest() {}
+
+    virtual void SetUp() {
+        ASSERT_EQ(DMD_S_OK, encodeStage.Init(encodeParam, 2));
+        ASSERT_EQ(DMD_S_OK, rateController.Init(rateParam, &encodeStage));
+    }
+    virtual void TearDown() {
+        rateController.Uninit();
+        encodeStage.Uninit();
+    }
+
+    void feedback(uint64_t ulTimeMs, uint64_t ulDelayMs, float fLossRate,
+            uint64_t ulSendRateBps) {
+        DmdTransportFeedback transportFeedback;
+        memset(&transportFeedback, 0, sizeof(transportFeedback));
+        transportFeedback.ulTimestampUs = (ulTimeMs + 1) * 1000;
+        transportFeedback.ulQueueDelayUs = ulDelayMs * 1000;
+        transportFeedback.fLossRate = fLossRate;
+        transportFeedback.ulSendRateBps = ulSendRateBps;
+        rateController.OnTransportFeedback(transportFeedback);
+    }
+
+    unsigned int bitrate() {
+        DmdRateControlStats stats;
+        rateController.GetStats(&stats);
+        return stats.iBitrate;
+    }
+
+public:
+    DmdEncodeParam encodeParam;
+    DmdRateControlParam rateParam;
+    CDmdEncodeStage encodeStage;
+    CDmdRateController rateController;
+};
+
+TEST_F(CDmdRateControllerTest, DecreaseOnCongestion) {
+    feedback(0, 10, 0, 0);
+    EXPECT_EQ(2000000U, bitrate());
+
+    // the first congested report cuts at once, then once per hold;
+    feedback(100, 300, 0, 0);
+    EXPECT_EQ(1700000U, bitrate());
+    feedback(200, 300, 0, 0);
+    EXPECT_EQ(1700000U, bitrate());
+    feedback(400, 300, 0, 0);
+    EXPECT_EQ(1445000U, bitrate());
+
+    // heavy loss cuts harder, and never above the delivered rate;
+    feedback(700, 10, 0.4f, 0);
+    EXPECT_EQ(1011500U, bitrate());
+    feedback(1000, 10, 0.15f, 500000);
+    EXPECT_EQ(450000U, bitrate());
+
+    vector<DmdRateDecision> decisions;
+    rateController.GetDecisions(&decisions);
+    ASSERT_EQ(4U, decisions.size());
+    EXPECT_EQ(DmdRateDecrease, decisions[0].eAction);
+    EXPECT_EQ(DmdRateReasonDelay, decisions[0].eReason);
+    EXPECT_EQ(300000U, decisions[0].ulQueueDelayUs);
+    EXPECT_EQ(DmdRateReasonLoss, decisions[3].eReason);
+    EXPECT_EQ(500000U, decisions[3].ulSendRateBps);
+
+    DmdRateControlStats stats;
+    rateController.GetStats(&stats);
+    EXPECT_EQ(6U, stats.ulFeedbackCount);
+    EXPECT_EQ(4U, stats.ulDecreaseCount);
+    EXPECT_EQ(2U, stats.ulHoldCount);
+    EXPECT_FLOAT_EQ(30.0f * 450000 / 1000000, stats.fFrameRate);
+
+    // never below the floor;
+    for (int i = 0; i < 20; i++) {
+        feedback(1300 + i * 300, 500, 0.5f, 0);
+    }
+    EXPECT_EQ(rateParam.iMinBitrate, bitrate());
+    rateController.GetStats(&stats);
+    EXPECT_FLOAT_EQ(rateParam.fMinFrameRate, stats.fFrameRate);
+}
+
+TEST_F(CDmdRateControllerTest, IncreaseWithHysteresis) {
+    feedback(0, 300, 0, 0);
+    EXPECT_EQ(1700000U, bitrate());
+
+    // clean reports must last a whole increase hold;
+    for (uint64_t t = 100; t < 1000; t += 100) {
+        feedback(t, 10, 0, 0);
+    }
+    EXPECT_EQ(1700000U, bitrate());
+    feedback(1000, 10, 0, 0);
+    EXPECT_EQ(1700000U * 108 / 100 + 16 * 1024, bitrate());
+    unsigned int iRaised = bitrate();
+
+    // the dead band between the marks holds the rate;
+    for (uint64_t t = 1100; t < 3000; t += 100) {
+        feedback(t, 100, 0.05f, 0);
+    }
+    EXPECT_EQ(iRaised, bitrate());
+
+    // bytes in the send queue count as delay too;
+    DmdTransportFeedback transportFeedback;
+    memset(&transportFeedback, 0, sizeof(transportFeedback));
+    transportFeedback.ulTimestampUs = 3100 * 1000;
+    transportFeedback.ulQueueBytes = iRaised / 8 / 4;
+    rateController.OnTransportFeedback(transportFeedback);
+    EXPECT_LT(bitrate(), iRaised);
+
+    DmdRateControlStats stats;
+    rateController.GetStats(&stats);
+    EXPECT_EQ(1U, stats.ulIncreaseCount);
+    EXPECT_EQ(2U, stats.ulDecreaseCount);
+}
+
+TEST_F(CDmdRateControllerTest, FrameRateReachesEncoder) {
+    vector<uint8_t> buffer(DmdI420FrameSize(160, 96), 128);
+    DmdVideoRawData videoRawData;
+    memset(&videoRawData, 0, sizeof(videoRawData));
+    DmdSetupI420Planes(&videoRawData, &buffer[0], 160, 96);
+
+    // half of iLowFrameRateBitrate leaves half the frame rate;
+    feedback(0, 10, 0.2f, 555556);
+    EXPECT_EQ(500000U, bitrate());
+
+    for (unsigned int i = 0; i < 10; i++) {
+        videoRawData.fmtVideoFormat.ulTimestamp = (i + 1) * 33333;
+        EXPECT_EQ(DMD_S_OK, encodeStage.DeliverVideoData(&videoRawData));
+        encodeStage.EncodeQueuedFrame(0);
+    }
+    DmdEncodeStats stats;
+    encodeStage.GetStats(&stats);
+    EXPECT_EQ(5U, stats.ulRateLimitedCount);
+    EXPECT_EQ(5U, stats.ulEncodedCount + stats.ulSkippedCount);
+}
+
+TEST_F(CDmdRateControllerTest, FollowsEstimate) {
+    DmdTransportFeedback transportFeedback;
+    memset(&transportFeedback, 0, sizeof(transportFeedback));
+    transportFeedback.ulTimestampUs = 1000;
+    transportFeedback.ulEstimatedBps = 900000;
+    rateController.OnTransportFeedback(transportFeedback);
+    EXPECT_EQ(900000U, bitrate());
+
+    // within the dead band, and back again at once, no hold;
+    transportFeedback.ulTimestampUs = 2000;
+    transportFeedback.ulEstimatedBps = 920000;
+    rateController.OnTransportFeedback(transportFeedback);
+    EXPECT_EQ(900000U, bitrate());
+    transportFeedback.ulTimestampUs = 3000;
+    transportFeedback.ulEstimatedBps = 1500000;
+    rateController.OnTransportFeedback(transportFeedback);
+    EXPECT_EQ(1500000U, bitrate());
+    transportFeedback.ulTimestampUs = 4000;
+    transportFeedback.ulEstimatedBps = 50000;
+    rateController.OnTransportFeedback(transportFeedback);
+    EXPECT_EQ(rateParam.iMinBitrate, bitrate());
+
+    // headroom from the send queue rises no higher than the estimate;
+    transportFeedback.ulTimestampUs = 5000;
+    transportFeedback.ulEstimatedBps = 110000;
+    rateController.OnTransportFeedback(transportFeedback);
+    EXPECT_EQ(110000U, bitrate());
+    for (uint64_t ulTimeMs = 1000; ulTimeMs < 5000; ulTimeMs += 100) {
+        feedback(ulTimeMs, 0, 0.0f, 0);
+    }
+    EXPECT_EQ(110000U, bitrate());
+
+    DmdRateControlStats stats;
+    rateController.GetStats(&stats);
+    EXPECT_EQ(110000U, stats.ulEstimatedBps);
+    vector<DmdRateDecision> vecDecisions;
+    rateController.GetDecisions(&vecDecisions);
+    ASSERT_EQ(4U, vecDecisions.size());
+    EXPECT_EQ(DmdRateReasonEstimate, vecDecisions.back().eReason);
+    EXPECT_EQ(DmdRateIncrease, vecDecisions.back().eAction);
+}
+
+TEST_F(CDmdRateControllerTest, SplitsByPriority) {
+    CDmdEncodeStage arrStages[3];
+    for (unsigned int i = 0; i < 3; i++) {
+        ASSERT_EQ(DMD_S_OK, arrStages[i].Init(encodeParam, 2));
+    }
+    rateParam.iStartBitrate = 3 * 1000 * 1000;
+    rateParam.iMaxBitrate = 8 * 1000 * 1000;
+    ASSERT_EQ(DMD_S_OK, rateController.Init(rateParam, NULL));
+    unsigned int arrIds[3];
+    ASSERT_EQ(DMD_S_OK, rateController.AddStream(&arrStages[0], 2, 0, 0,
+                &arrIds[0]));
+    ASSERT_EQ(DMD_S_OK, rateController.AddStream(&arrStages[1], 1, 0, 0,
+                &arrIds[1]));
+    // at most 500 kbps, its excess goes to the others;
+    ASSERT_EQ(DMD_S_OK, rateController.AddStream(&arrStages[2], 3,
+                200 * 1000, 500 * 1000, &arrIds[2]));
+    EXPECT_NE(DMD_S_OK, rateController.AddStream(&arrStages[2], 0, 0, 0,
+                NULL));
+
+    DmdRateStream arrStreams[3];
+    for (unsigned int i = 0; i < 3; i++) {
+        ASSERT_EQ(DMD_S_OK, rateController.GetStream(arrIds[i],
+                    &arrStreams[i]));
+    }
+    EXPECT_EQ(500000U, arrStreams[2].iBitrate);
+    EXPECT_EQ(1666666U, arrStreams[0].iBitrate);
+    EXPECT_EQ(833333U, arrStreams[1].iBitrate);
+    // below iLowFrameRateBitrate, the frame rate follows the share;
+    EXPECT_FLOAT_EQ(DMD_ENCODE_DEFAULT_FRAMERATE, arrStreams[0].fFrameRate);
+    EXPECT_LT(arrStreams[1].fFrameRate, DMD_ENCODE_DEFAULT_FRAMERATE);
+
+    // congestion cuts the aggregate, what is above the minimums is split
+    // 2:1:3;
+    feedback(0, 10, 0.2f, 400 * 1000);
+    EXPECT_EQ(360000U, bitrate());
+    for (unsigned int i = 0; i < 3; i++) {
+        ASSERT_EQ(DMD_S_OK, rateController.GetStream(arrIds[i],
+                    &arrStreams[i]));
+    }
+    EXPECT_EQ(280000U, arrStreams[2].iBitrate);
+    EXPECT_EQ(53333U, arrStreams[0].iBitrate);
+    EXPECT_EQ(26666U, arrStreams[1].iBitrate);
+
+    // a raised priority takes effect at once;
+    ASSERT_EQ(DMD_S_OK, rateController.SetStreamPriority(arrIds[1], 6));
+    ASSERT_EQ(DMD_S_OK, rateController.GetStream(arrIds[1],
+                &arrStreams[1]));
+    EXPECT_EQ(87272U, arrStreams[1].iBitrate);
+    EXPECT_NE(DMD_S_OK, rateController.SetStreamPriority(3, 1));
+
+    rateController.Uninit();
+    for (unsigned int i = 0; i < 3; i++) {
+        arrStages[i].Uninit();
+    }
+}
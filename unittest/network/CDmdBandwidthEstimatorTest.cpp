@@ -0,0 +1,231 @@
+/*
+ ============================================================================
+ * Name        : CDmdBandwidthEstimatorTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of delay based bandwidth estimation.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <deque>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+#include "CDmdBandwidthEstimator.h"
+#include "CDmdCcfbGenerator.h"
+#include "CDmdLinkEmulator.h"
+#include "DmdRtp.h"
+
+using namespace opendmd;
+using std::deque;
+using std::vector;
+
+#define BWE_TEST_PACKET_SIZE    1200
+#define BWE_TEST_TICK_US        1000
+
+/*
+ * A sender at the estimated rate, two streams, through an emulated
+ * bottleneck to a receiver whose feedback comes back after the same
+ * propagation delay; simulated time, a tick a millisecond.
+ */
+class CDmdBandwidthEstimatorTest : public testing::Test,
+        public IDmdRtpPacketSink, public IDmdTransportFeedbackSink {
+public:
+    CDmdBandwidthEstimatorTest() : ulNowUs(1000000), fBudgetBytes(0),
+            iFeedbackCount(0), iLastEstimate(0) {
+        memset(&linkParam, 0, sizeof(linkParam));
+        linkParam.ulRateBps = 1000000;
+        linkParam.ulDelayUs = 20000;
+        linkParam.iSeed = 7;
+        memset(arrSequences, 0, sizeof(arrSequences));
+    }
+    virtual ~CDmdBandwidthEstimatorTest() {}
+
+    virtual void SetUp() {
+        DmdBweParam bweParam;
+        bweParam.iStartBitrate = 2500000;
+        bweParam.iMinBitrate = 100000;
+        bweParam.iMaxBitrate = 10000000;
+        ASSERT_EQ(DMD_S_OK, estimator.Init(bweParam));
+        estimator.SetFeedbackSink(this);
+        estimator.SetRtt(2 * linkParam.ulDelayUs);
+        DmdCcfbGeneratorParam generatorParam;
+        generatorParam.iSsrc = 0x5555;
+        generatorParam.ulIntervalUs = DMD_CCFB_DEFAULT_INTERVAL_US;
+        ASSERT_EQ(DMD_S_OK, generator.Init(generatorParam));
+        ASSERT_EQ(DMD_S_OK, link.Init(linkParam, this));
+    }
+
+    // IDmdRtpPacketSink interface, the receiver end of the link;
+    DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount) {
+        for (unsigned int i = 0; i < iPacketCount; i++) {
+            DmdRtpHeader rtpHeader;
+            size_t ulHeaderSize = 0;
+            EXPECT_EQ(DMD_S_OK, DmdRtpParseHeader(static_cast<uint8_t *>(
+                            pPackets[i].pIov[0].iov_base),
+                        pPackets[i].ulSize, &rtpHeader, &ulHeaderSize));
+            generator.OnPacket(rtpHeader.iSsrc, rtpHeader.iSequence,
+                    ulNowUs);
+        }
+        *piSentCount = iPacketCount;
+        return DMD_S_OK;
+    }
+
+    // IDmdTransportFeedbackSink interface;
+    void OnTransportFeedback(const DmdTransportFeedback &transportFeedback) {
+        iFeedbackCount++;
+        iLastEstimate = transportFeedback.ulEstimatedBps;
+    }
+
+    void sendOne(int iStream) {
+        uint8_t arrPacket[BWE_TEST_PACKET_SIZE];
+        memset(arrPacket, 0, sizeof(arrPacket));
+        DmdRtpHeader rtpHeader;
+        memset(&rtpHeader, 0, sizeof(rtpHeader));
+        rtpHeader.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+        rtpHeader.iSequence = arrSequences[iStream]++;
+        rtpHeader.iSsrc = 0x1000 + iStream;
+        DmdRtpWriteHeader(rtpHeader, arrPacket);
+        struct iovec iov = {arrPacket, sizeof(arrPacket)};
+        DmdRtpPacket packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.pIov = &iov;
+        packet.iIovCount = 1;
+        packet.ulSize = sizeof(arrPacket);
+        packet.iSequence = rtpHeader.iSequence;
+        ASSERT_EQ(DMD_S_OK, link.SendPacketsAt(&packet, 1, ulNowUs));
+        estimator.OnPacketsSent(&packet, 1, ulNowUs);
+    }
+
+    // queue delay at the bottleneck, the worst seen over the run;
+    uint64_t run(uint64_t ulDurationUs) {
+        uint64_t ulMaxQueueDelayUs = 0;
+        uint64_t ulEndUs = ulNowUs + ulDurationUs;
+        for (; ulNowUs < ulEndUs; ulNowUs += BWE_TEST_TICK_US) {
+            fBudgetBytes += estimator.GetEstimate() / 8.0
+                * BWE_TEST_TICK_US / 1000000;
+            for (int i = 0; fBudgetBytes >= BWE_TEST_PACKET_SIZE; i++) {
+                sendOne(i & 1);
+                fBudgetBytes -= BWE_TEST_PACKET_SIZE;
+            }
+            link.Deliver(ulNowUs, NULL);
+            if (generator.IsFeedbackDue(ulNowUs)) {
+                vector<uint8_t> feedback(1500);
+                size_t ulSize = 0;
+                EXPECT_EQ(DMD_S_OK, generator.BuildFeedback(ulNowUs,
+                            &feedback[0], feedback.size(), &ulSize));
+                feedback.resize(ulSize);
+                queReturns.push_back(std::make_pair(
+                            ulNowUs + linkParam.ulDelayUs, feedback));
+            }
+            while (!queReturns.empty()
+                    && queReturns.front().first <= ulNowUs) {
+                const vector<uint8_t> &feedback = queReturns.front().second;
+                EXPECT_EQ(DMD_S_OK, estimator.OnRtcp(&feedback[0],
+                            feedback.size(), ulNowUs));
+                queReturns.pop_front();
+            }
+            uint64_t ulQueueDelayUs = queueDelayUs();
+            if (ulQueueDelayUs > ulMaxQueueDelayUs) {
+                ulMaxQueueDelayUs = ulQueueDelayUs;
+            }
+        }
+        return ulMaxQueueDelayUs;
+    }
+
+    uint64_t queueDelayUs() {
+        DmdLinkEmulatorStats linkStats;
+        link.GetStats(&linkStats);
+        return linkStats.ulQueueBytes * 8 * 1000000 / linkParam.ulRateBps;
+    }
+
+public:
+    DmdLinkEmulatorParam linkParam;
+    CDmdLinkEmulator link;
+    CDmdCcfbGenerator generator;
+    CDmdBandwidthEstimator estimator;
+    uint64_t ulNowUs;
+    double fBudgetBytes;
+    uint16_t arrSequences[2];
+    deque<std::pair<uint64_t, vector<uint8_t> > > queReturns;
+    unsigned int iFeedbackCount;
+    uint64_t iLastEstimate;
+};
+
+// an unbounded bottleneck queue: no loss ever, only delay tells;
+TEST_F(CDmdBandwidthEstimatorTest, BacksOffOnDelayBeforeLoss) {
+    uint64_t ulMaxQueueDelayUs = run(10000000);
+    DmdBweStats stats;
+    estimator.GetStats(&stats);
+    EXPECT_EQ(0U, stats.ulLostCount);
+    EXPECT_GT(stats.ulOveruseCount, 0U);
+    EXPECT_EQ(0U, stats.ulUnknownCount);
+    // a fraction of a second of queue, where loss based control would
+    // have let it grow for ever;
+    EXPECT_LT(ulMaxQueueDelayUs, 1000000U);
+    EXPECT_GT(estimator.GetEstimate(), 600000U);
+    EXPECT_LT(estimator.GetEstimate(), 1100000U);
+    EXPECT_EQ(estimator.GetEstimate(), iLastEstimate);
+    EXPECT_EQ(stats.ulFeedbackCount, iFeedbackCount);
+
+    // settled: the queue stays short;
+    EXPECT_LT(run(10000000), 300000U);
+    EXPECT_LT(queueDelayUs(), 200000U);
+    estimator.GetStats(&stats);
+    EXPECT_GT(stats.ulAckedRateBps, 700000U);
+
+    // the link grows, the estimate follows;
+    linkParam.ulRateBps = 3000000;
+    link.SetParam(linkParam);
+    run(20000000);
+    EXPECT_GT(estimator.GetEstimate(), 2000000U);
+}
+
+TEST_F(CDmdBandwidthEstimatorTest, BacksOffOnLoss) {
+    linkParam.ulRateBps = 20000000;
+    linkParam.fLossRate = 0.25f;
+    link.SetParam(linkParam);
+    run(3000000);
+    DmdBweStats stats;
+    estimator.GetStats(&stats);
+    EXPECT_GT(stats.ulLostCount, 0U);
+    EXPECT_GT(stats.fLossRate, DMD_BWE_HIGH_LOSS_RATE);
+    EXPECT_GT(stats.ulDecreaseCount, 0U);
+    EXPECT_LT(estimator.GetEstimate(), 2500000U);
+}
@@ -0,0 +1,160 @@
+/*
+ ============================================================================
+ * Name        : CDmdCcfbGeneratorTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of congestion control feedback.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdCcfbGenerator.h"
+#include "DmdRtcp.h"
+
+using namespace opendmd;
+using std::vector;
+
+TEST(CDmdCcfbGeneratorTest, WriteParse) {
+    DmdRtcpCcfb ccfb;
+    ccfb.iSenderSsrc = 0x11223344;
+    ccfb.iReportTimestamp = 0xdeadbeef;
+    ccfb.vecBlocks.resize(2);
+    ccfb.vecBlocks[0].iMediaSsrc = 0xaaaa;
+    ccfb.vecBlocks[0].iBeginSeq = 65535;
+    int16_t arrOffsets[] = {0, DMD_RTCP_CCFB_NOT_RECEIVED, 1023,
+        DMD_RTCP_CCFB_OVER_RANGE};
+    ccfb.vecBlocks[0].vecArrivalOffsets.assign(arrOffsets, arrOffsets + 4);
+    ccfb.vecBlocks[1].iMediaSsrc = 0xbbbb;
+    ccfb.vecBlocks[1].iBeginSeq = 7;
+    ccfb.vecBlocks[1].vecArrivalOffsets.assign(3, 5);
+
+    uint8_t arrBuffer[256];
+    size_t ulSize = 0;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteCcfb(ccfb, arrBuffer, sizeof(arrBuffer),
+                &ulSize));
+    // header, sender, two blocks of 8 and 8 bytes of reports each, time;
+    EXPECT_EQ(4U + 4 + 16 + 16 + 4, ulSize);
+    EXPECT_NE(DMD_S_OK, DmdRtcpWriteCcfb(ccfb, arrBuffer, ulSize - 4,
+                &ulSize));
+
+    vector<DmdRtcpCcfb> vecFeedbacks;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseCcfbs(arrBuffer, ulSize, &vecFeedbacks));
+    ASSERT_EQ(1U, vecFeedbacks.size());
+    const DmdRtcpCcfb &parsed = vecFeedbacks[0];
+    EXPECT_EQ(ccfb.iSenderSsrc, parsed.iSenderSsrc);
+    EXPECT_EQ(ccfb.iReportTimestamp, parsed.iReportTimestamp);
+    ASSERT_EQ(2U, parsed.vecBlocks.size());
+    for (size_t i = 0; i < 2; i++) {
+        EXPECT_EQ(ccfb.vecBlocks[i].iMediaSsrc,
+                parsed.vecBlocks[i].iMediaSsrc);
+        EXPECT_EQ(ccfb.vecBlocks[i].iBeginSeq, parsed.vecBlocks[i].iBeginSeq);
+        EXPECT_TRUE(ccfb.vecBlocks[i].vecArrivalOffsets
+                == parsed.vecBlocks[i].vecArrivalOffsets);
+    }
+
+    // not a feedback of another type, nor a nack;
+    vector<DmdRtcpNack> vecNacks;
+    EXPECT_EQ(DMD_S_OK, DmdRtcpParseNacks(arrBuffer, ulSize, &vecNacks));
+    EXPECT_TRUE(vecNacks.empty());
+}
+
+TEST(CDmdCcfbGeneratorTest, ReportsArrivals) {
+    DmdCcfbGeneratorParam param;
+    param.iSsrc = 0x5555;
+    param.ulIntervalUs = DMD_CCFB_DEFAULT_INTERVAL_US;
+    CDmdCcfbGenerator generator;
+    ASSERT_EQ(DMD_S_OK, generator.Init(param));
+
+    uint64_t ulNowUs = 10000000;
+    EXPECT_FALSE(generator.IsFeedbackDue(ulNowUs));
+    // 0 is lost, 2 comes after 3, across the wrap;
+    generator.OnPacket(0x1000, 65534, ulNowUs);
+    generator.OnPacket(0x1000, 65535, ulNowUs + 1000);
+    generator.OnPacket(0x1000, 1, ulNowUs + 2000);
+    generator.OnPacket(0x2000, 100, ulNowUs + 3000);
+    generator.OnPacket(0x1000, 3, ulNowUs + 4000);
+    generator.OnPacket(0x1000, 2, ulNowUs + 5000);
+    EXPECT_FALSE(generator.IsFeedbackDue(ulNowUs + 10000));
+    ulNowUs += DMD_CCFB_DEFAULT_INTERVAL_US;
+    EXPECT_TRUE(generator.IsFeedbackDue(ulNowUs));
+
+    uint8_t arrBuffer[256];
+    size_t ulSize = 0;
+    ASSERT_EQ(DMD_S_OK, generator.BuildFeedback(ulNowUs, arrBuffer,
+                sizeof(arrBuffer), &ulSize));
+    EXPECT_FALSE(generator.IsFeedbackDue(ulNowUs + 1000000));
+    vector<DmdRtcpCcfb> vecFeedbacks;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseCcfbs(arrBuffer, ulSize, &vecFeedbacks));
+    ASSERT_EQ(1U, vecFeedbacks.size());
+    EXPECT_EQ(0x5555U, vecFeedbacks[0].iSenderSsrc);
+    ASSERT_EQ(2U, vecFeedbacks[0].vecBlocks.size());
+    const DmdRtcpCcfbBlock &block = vecFeedbacks[0].vecBlocks[0];
+    EXPECT_EQ(0x1000U, block.iMediaSsrc);
+    EXPECT_EQ(65534, block.iBeginSeq);
+    ASSERT_EQ(6U, block.vecArrivalOffsets.size());
+    EXPECT_EQ(DMD_RTCP_CCFB_NOT_RECEIVED, block.vecArrivalOffsets[2]);
+    // 50ms, 49ms, 48ms, then 45ms and 46ms back, in 1/1024 seconds;
+    int arrExpected[] = {51, 50, -1, 49, 46, 47};
+    for (size_t i = 0; i < 6; i++) {
+        if (i != 2) {
+            EXPECT_NEAR(arrExpected[i], block.vecArrivalOffsets[i], 1);
+        }
+    }
+    EXPECT_EQ(1U, vecFeedbacks[0].vecBlocks[1].vecArrivalOffsets.size());
+
+    // reported once only, later arrivals of those are late;
+    generator.OnPacket(0x1000, 0, ulNowUs + 1000);
+    EXPECT_FALSE(generator.IsFeedbackDue(ulNowUs + 1000000));
+    generator.OnPacket(0x1000, 4, ulNowUs + 2000);
+    ulNowUs += DMD_CCFB_DEFAULT_INTERVAL_US;
+    ASSERT_EQ(DMD_S_OK, generator.BuildFeedback(ulNowUs, arrBuffer,
+                sizeof(arrBuffer), &ulSize));
+    vecFeedbacks.clear();
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseCcfbs(arrBuffer, ulSize, &vecFeedbacks));
+    ASSERT_EQ(1U, vecFeedbacks[0].vecBlocks.size());
+    EXPECT_EQ(4, vecFeedbacks[0].vecBlocks[0].iBeginSeq);
+    EXPECT_EQ(1U, vecFeedbacks[0].vecBlocks[0].vecArrivalOffsets.size());
+
+    DmdCcfbGeneratorStats stats;
+    generator.GetStats(&stats);
+    EXPECT_EQ(8U, stats.ulReceivedCount);
+    EXPECT_EQ(1U, stats.ulLateCount);
+    EXPECT_EQ(8U, stats.ulReportedCount);
+    EXPECT_EQ(2U, stats.ulFeedbackCount);
+}
@@ -0,0 +1,333 @@
+/*
+ ============================================================================
+ * Name        : CDmdDiskSpoolTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of disk spool.
+ ============================================================================
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "CDmdDiskSpool.h"
+
+using namespace opendmd;
+using std::string;
+using std::vector;
+
+// an access unit of two nal units, its bytes from the timestamp;
+class CDmdSpoolFrame {
+public:
+    CDmdSpoolFrame(uint64_t ulTimestamp, DmdEncodedFrameType eFrameType,
+            size_t ulSize, bool bMotion = true,
+            DmdEncodeLayer eLayer = DmdLayerRecord) {
+        vecData.resize(ulSize);
+        for (size_t i = 0; i < ulSize; i++) {
+            vecData[i] = static_cast<uint8_t>(ulTimestamp + i * 7);
+        }
+        const uint8_t aStartCode[4] = {0, 0, 0, 1};
+        memcpy(&vecData[0], aStartCode, 4);
+        memcpy(&vecData[ulSize / 2], aStartCode, 4);
+        aNalIov[0].iov_base = &vecData[4];
+        aNalIov[0].iov_len = ulSize / 2 - 4;
+        aNalIov[1].iov_base = &vecData[ulSize / 2 + 4];
+        aNalIov[1].iov_len = ulSize - ulSize / 2 - 4;
+
+        memset(&frame, 0, sizeof(frame));
+        frame.pData = &vecData[0];
+        frame.ulDataLen = ulSize;
+        frame.iNalCount = 2;
+        frame.pNalIov = aNalIov;
+        frame.eFrameType = eFrameType;
+        frame.iWidth = 1920;
+        frame.iHeight = 1080;
+        frame.ulTimestamp = ulTimestamp;
+        frame.eLayer = eLayer;
+        frame.bMotion = bMotion;
+    }
+
+    vector<uint8_t> vecData;
+    struct iovec aNalIov[2];
+    DmdEncodedFrame frame;
+};
+
+// keeps what was drained, checking each frame against its source;
+class CDmdSpoolCollector : public IDmdEncodeEngineSink {
+public:
+    CDmdSpoolCollector() : iMismatchCount(0) {}
+
+    DMD_RESULT DeliverEncodedData(DmdEncodedFrame *pEncodedFrame) {
+        CDmdSpoolFrame expected(pEncodedFrame->ulTimestamp,
+                pEncodedFrame->eFrameType, pEncodedFrame->ulDataLen,
+                pEncodedFrame->bMotion, pEncodedFrame->eLayer);
+        if (0 != memcmp(pEncodedFrame->pData, &expected.vecData[0],
+                    pEncodedFrame->ulDataLen)
+                || 2 != pEncodedFrame->iNalCount
+                || pEncodedFrame->pNalIov[1].iov_base
+                    != pEncodedFrame->pData + pEncodedFrame->ulDataLen / 2 + 4
+                || pEncodedFrame->pNalIov[1].iov_len
+                    != expected.aNalIov[1].iov_len
+                || 1080 != pEncodedFrame->iHeight) {
+            iMismatchCount++;
+        }
+        vecTimestamps.push_back(pEncodedFrame->ulTimestamp);
+        vecTypes.push_back(pEncodedFrame->eFrameType);
+        return DMD_S_OK;
+    }
+
+    unsigned int iMismatchCount;
+    vector<uint64_t> vecTimestamps;
+    vector<DmdEncodedFrameType> vecTypes;
+};
+
+class CDmdDiskSpoolTest : public testing::Test {
+protected:
+    void SetUp() {
+        char aTemplate[] = "/tmp/opendmd-spool-XXXXXX";
+        ASSERT_TRUE(NULL != mkdtemp(aTemplate));
+        m_sDirectory = aTemplate;
+        m_param.sDirectory = m_sDirectory;
+        m_param.ulMaxBytes = 0;
+        m_param.ulSegmentBytes = 0;
+        m_param.ulCheckpointUs = 0;
+        m_param.ePolicy = DmdSpoolRecordLayer;
+        m_param.ulDrainRateBps = 0;
+    }
+
+    void TearDown() {
+        DIR *pDir = opendir(m_sDirectory.c_str());
+        if (pDir) {
+            struct dirent *pEntry = NULL;
+            while (NULL != (pEntry = readdir(pDir))) {
+                if ('.' != pEntry->d_name[0]) {
+                    unlink((m_sDirectory + "/" + pEntry->d_name).c_str());
+                }
+            }
+            closedir(pDir);
+        }
+        rmdir(m_sDirectory.c_str());
+    }
+
+    string m_sDirectory;
+    DmdSpoolParam m_param;
+};
+
+TEST_F(CDmdDiskSpoolTest, FiltersAndWaitsForKey) {
+    m_param.ePolicy = DmdSpoolMotionOnly;
+    CDmdDiskSpool spool;
+    ASSERT_EQ(DMD_S_OK, spool.Open(m_param));
+    EXPECT_TRUE(spool.IsEmpty());
+
+    CDmdSpoolFrame detect(1, DmdFrameIDR, 500, false, DmdLayerDetect);
+    CDmdSpoolFrame midEvent(2, DmdFrameP, 500);
+    CDmdSpoolFrame eventStart(3, DmdFrameIDR, 500);
+    CDmdSpoolFrame inEvent(4, DmdFrameP, 500);
+    CDmdSpoolFrame noMotion(5, DmdFrameP, 500, false);
+    CDmdSpoolFrame afterGap(6, DmdFrameP, 500);
+    CDmdSpoolFrame nextEvent(7, DmdFrameIDR, 500);
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&detect.frame));
+    EXPECT_FALSE(spool.TakeKeyFrameRequest());
+    // the event began before the spool did;
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&midEvent.frame));
+    EXPECT_TRUE(spool.TakeKeyFrameRequest());
+    EXPECT_FALSE(spool.TakeKeyFrameRequest());
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&eventStart.frame));
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&inEvent.frame));
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&noMotion.frame));
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&afterGap.frame));
+    EXPECT_TRUE(spool.TakeKeyFrameRequest());
+    EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&nextEvent.frame));
+
+    DmdSpoolStats stats;
+    spool.GetStats(&stats);
+    EXPECT_EQ(3u, stats.ulWrittenCount);
+    EXPECT_EQ(2u, stats.ulFilteredCount);
+    EXPECT_EQ(2u, stats.ulWaitKeyCount);
+    EXPECT_EQ(3u, stats.ulFrameCount);
+    EXPECT_EQ(stats.ulWrittenBytes, stats.ulBytes);
+    EXPECT_FALSE(spool.IsEmpty());
+
+    CDmdSpoolCollector collector;
+    spool.SetDrainRate(1000 * 1000 * 1000);
+    spool.Drain(1000000, &collector);
+    spool.Drain(1100000, &collector);
+    ASSERT_EQ(3u, collector.vecTimestamps.size());
+    EXPECT_EQ(3u, collector.vecTimestamps[0]);
+    EXPECT_EQ(4u, collector.vecTimestamps[1]);
+    EXPECT_EQ(7u, collector.vecTimestamps[2]);
+    EXPECT_EQ(0u, collector.iMismatchCount);
+    EXPECT_TRUE(spool.IsEmpty());
+}
+
+TEST_F(CDmdDiskSpoolTest, DrainsAtRate) {
+    // 100 bytes a millisecond, a frame and its header every ten;
+    m_param.ulDrainRateBps = 800 * 1000;
+    CDmdDiskSpool spool;
+    ASSERT_EQ(DMD_S_OK, spool.Open(m_param));
+    for (uint64_t i = 0; i < 40; i++) {
+        CDmdSpoolFrame frame(1000 + i, 0 == i % 10 ? DmdFrameIDR : DmdFrameP,
+                950);
+        EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&frame.frame));
+    }
+
+    CDmdSpoolCollector collector;
+    uint64_t ulNowUs = 5000000;
+    for (int i = 0; i <= 100; i++, ulNowUs += 1000) {
+        spool.Drain(ulNowUs, &collector);
+    }
+    DmdSpoolStats stats;
+    spool.GetStats(&stats);
+    EXPECT_GE(stats.ulDrainedBytes, 10000u - 1000);
+    EXPECT_LE(stats.ulDrainedBytes, 10000u + 1000);
+    EXPECT_EQ(40u, stats.ulDrainedCount + stats.ulFrameCount);
+
+    // an idle second is not a burst;
+    ulNowUs += 1000000;
+    spool.Drain(ulNowUs, &collector);
+    EXPECT_LE(collector.vecTimestamps.size(), stats.ulDrainedCount + 12);
+
+    for (int i = 0; i < 100 && !spool.IsEmpty(); i++) {
+        ulNowUs += 100000;
+        spool.Drain(ulNowUs, &collector);
+    }
+    ASSERT_EQ(40u, collector.vecTimestamps.size());
+    for (uint64_t i = 0; i < 40; i++) {
+        EXPECT_EQ(1000 + i, collector.vecTimestamps[i]);
+    }
+    EXPECT_EQ(DmdFrameIDR, collector.vecTypes[30]);
+    EXPECT_EQ(0u, collector.iMismatchCount);
+}
+
+TEST_F(CDmdDiskSpoolTest, EvictsOldestWhenFull) {
+    m_param.ulMaxBytes = 64 * 1024;
+    CDmdDiskSpool spool;
+    ASSERT_EQ(DMD_S_OK, spool.Open(m_param));
+    for (uint64_t i = 0; i < 300; i++) {
+        CDmdSpoolFrame frame(i, 0 == i % 10 ? DmdFrameIDR : DmdFrameP, 1000);
+        EXPECT_EQ(DMD_S_OK, spool.DeliverEncodedData(&frame.frame));
+        EXPECT_LE(spool.GetFillLevel(), 1.0f);
+    }
+
+    DmdSpoolStats stats;
+    spool.GetStats(&stats);
+    EXPECT_EQ(300u, stats.ulWrittenCount);
+    EXPECT_LT(0u, stats.ulEvictedCount);
+    EXPECT_EQ(stats.ulWrittenBytes, stats.ulBytes + stats.ulEvictedBytes);
+    EXPECT_LE(stats.ulBytes, m_param.ulMaxBytes);
+    EXPECT_GT(stats.fFillLevel, 0.5f);
+    EXPECT_LE(stats.iSegmentCount, 5u);
+
+    // what is left starts at a key frame and runs to the newest;
+    CDmdSpoolCollector collector;
+    spool.SetDrainRate(1000 * 1000 * 1000);
+    spool.Drain(1000000, &collector);
+    spool.Drain(2000000, &collector);
+    ASSERT_EQ(stats.ulFrameCount, collector.vecTimestamps.size());
+    EXPECT_EQ(DmdFrameIDR, collector.vecTypes.front());
+    EXPECT_EQ(299u, collector.vecTimestamps.back());
+    EXPECT_EQ(0u, collector.iMismatchCount);
+    EXPECT_EQ(0.0f, spool.GetFillLevel());
+}
+
+TEST_F(CDmdDiskSpoolTest, RecoversAfterCrash) {
+    m_param.ulMaxBytes = 64 * 1024;
+    CDmdDiskSpool crashed;
+    ASSERT_EQ(DMD_S_OK, crashed.Open(m_param));
+    for (uint64_t i = 0; i < 30; i++) {
+        CDmdSpoolFrame frame(i, 0 == i % 10 ? DmdFrameIDR : DmdFrameP, 1000);
+        EXPECT_EQ(DMD_S_OK, crashed.DeliverEncodedData(&frame.frame));
+    }
+    CDmdSpoolCollector collector;
+    crashed.SetDrainRate(8 * 1000 * 1000);
+    crashed.Drain(1000000, &collector);
+    crashed.Drain(1003000, &collector);
+    EXPECT_EQ(DMD_S_OK, crashed.Checkpoint());
+    unsigned int iCheckpointed = collector.vecTimestamps.size();
+    EXPECT_LT(0u, iCheckpointed);
+    // drained after the checkpoint, drained again after the crash;
+    crashed.Drain(1004000, &collector);
+
+    // a frame torn in the middle of its write;
+    DIR *pDir = opendir(m_sDirectory.c_str());
+    string sLastSegment;
+    struct dirent *pEntry = NULL;
+    while (NULL != (pEntry = readdir(pDir))) {
+        string sName = pEntry->d_name;
+        if (0 == sName.find("spool-") && sName > sLastSegment) {
+            sLastSegment = sName;
+        }
+    }
+    closedir(pDir);
+    int iFd = open((m_sDirectory + "/" + sLastSegment).c_str(),
+            O_WRONLY | O_APPEND);
+    ASSERT_LE(0, iFd);
+    uint8_t aTorn[100];
+    memset(aTorn, 0x5a, sizeof(aTorn));
+    EXPECT_EQ(100, write(iFd, aTorn, sizeof(aTorn)));
+    close(iFd);
+
+    CDmdDiskSpool recovered;
+    ASSERT_EQ(DMD_S_OK, recovered.Open(m_param));
+    DmdSpoolStats recoveredStats;
+    recovered.GetStats(&recoveredStats);
+    EXPECT_EQ(100u, recoveredStats.ulTruncatedBytes);
+    EXPECT_EQ(30u - iCheckpointed, recoveredStats.ulFrameCount);
+
+    CDmdSpoolCollector recoveredCollector;
+    recovered.SetDrainRate(1000 * 1000 * 1000);
+    recovered.Drain(1000000, &recoveredCollector);
+    recovered.Drain(2000000, &recoveredCollector);
+    ASSERT_EQ(30u - iCheckpointed, recoveredCollector.vecTimestamps.size());
+    EXPECT_EQ(iCheckpointed, recoveredCollector.vecTimestamps.front());
+    EXPECT_EQ(29u, recoveredCollector.vecTimestamps.back());
+    EXPECT_EQ(0u, recoveredCollector.iMismatchCount);
+
+    // new frames go after the old, in a segment of their own;
+    CDmdSpoolFrame next(100, DmdFrameIDR, 1000);
+    EXPECT_EQ(DMD_S_OK, recovered.DeliverEncodedData(&next.frame));
+    recovered.Drain(3000000, &recoveredCollector);
+    EXPECT_EQ(100u, recoveredCollector.vecTimestamps.back());
+    EXPECT_TRUE(recovered.IsEmpty());
+}
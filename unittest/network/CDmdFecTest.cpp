@@ -0,0 +1,259 @@
+/*
+ ============================================================================
+ * Name        : CDmdFecTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of xor forward error correction.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdFecDecoder.h"
+#include "CDmdFecEncoder.h"
+#include "CDmdRtpPacketizer.h"
+#include "DmdFec.h"
+#include "DmdRtp.h"
+
+#include "CDmdSinkRecorder.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdFecTest : public testing::Test {
+public:
+    CDmdFecTest() : pPackets(NULL), iPacketCount(0) {
+        memset(&encoderParam, 0, sizeof(encoderParam));
+        encoderParam.iSsrc = 0xfec;
+        encoderParam.iFirstSequence = 100;
+        encoderParam.iDeltaPercent = DMD_FEC_DEFAULT_DELTA_PERCENT;
+        encoderParam.iKeyPercent = DMD_FEC_DEFAULT_KEY_PERCENT;
+    }
+    virtual ~CDmdFecTest() {}
+    virtual void SetUp() {
+        DmdRtpPacketizerParam packetizerParam;
+        memset(&packetizerParam, 0, sizeof(packetizerParam));
+        packetizerParam.iSsrc = 0xabcd;
+        packetizerParam.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+        packetizerParam.ulMtu = DMD_RTP_DEFAULT_MTU;
+        packetizerParam.iFirstSequence = 65520;  // runs cross the wrap;
+        packetizerParam.bAggregate = true;
+        ASSERT_EQ(DMD_S_OK, packetizer.Init(packetizerParam));
+    }
+    virtual void TearDown() {}
+
+    // sps, pps and a slice of ulSliceSize bytes;
+    void packetize(size_t ulSliceSize, bool bKeyFrame) {
+        size_t arrSizes[] = {12, 4, ulSliceSize};
+        nals.clear();
+        iovs.clear();
+        for (size_t i = 0; i < 3; i++) {
+            vector<uint8_t> nal(arrSizes[i]);
+            for (size_t j = 0; j < nal.size(); j++) {
+                nal[j] = static_cast<uint8_t>(j * 31 + i);
+            }
+            nal[0] = static_cast<uint8_t>(0x60 | (i ? 5 : 7));
+            nals.push_back(nal);
+        }
+        for (size_t i = 0; i < nals.size(); i++) {
+            struct iovec iov = {&nals[i][0], nals[i].size()};
+            iovs.push_back(iov);
+        }
+        memset(&frame, 0, sizeof(frame));
+        frame.eFrameType = bKeyFrame ? DmdFrameIDR : DmdFrameP;
+        frame.ulTimestamp = 1000000;
+        frame.iNalCount = static_cast<unsigned int>(iovs.size());
+        frame.pNalIov = &iovs[0];
+        ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&frame, &pPackets,
+                    &iPacketCount));
+    }
+
+public:
+    DmdFecEncoderParam encoderParam;
+    CDmdRtpPacketizer packetizer;
+    vector<vector<uint8_t> > nals;
+    vector<struct iovec> iovs;
+    DmdEncodedFrame frame;
+    const DmdRtpPacket *pPackets;
+    unsigned int iPacketCount;
+};
+
+TEST_F(CDmdFecTest, XorMatchesC) {
+    size_t arrSizes[] = {0, 1, 15, 16, 63, 64, 65, 1187};
+    for (size_t s = 0; s < sizeof(arrSizes) / sizeof(arrSizes[0]); s++) {
+        size_t ulSize = arrSizes[s];
+        vector<uint8_t> src(ulSize + 2);
+        vector<uint8_t> dst(ulSize + 2);
+        for (size_t i = 0; i < src.size(); i++) {
+            src[i] = static_cast<uint8_t>(i * 7 + 3);
+            dst[i] = static_cast<uint8_t>(i * 13 + 5);
+        }
+        vector<uint8_t> dstC(dst);
+        // unaligned, from the second byte;
+        DmdFecXor(&dst[1], &src[1], ulSize);
+        DmdFecXorC(&dstC[1], &src[1], ulSize);
+        EXPECT_TRUE(dst == dstC) << ulSize;
+        DmdFecXor(&dst[1], &src[1], ulSize);
+        EXPECT_EQ(static_cast<uint8_t>(1 * 13 + 5), dst[1]);
+        EXPECT_EQ(static_cast<uint8_t>((ulSize + 1) * 13 + 5), dst.back());
+    }
+}
+
+TEST_F(CDmdFecTest, KeyFramesGetMoreParity) {
+    CDmdFecEncoder encoder;
+    ASSERT_EQ(DMD_S_OK, encoder.Init(encoderParam));
+    const DmdRtpPacket *pFecPackets = NULL;
+    unsigned int iFecCount = 0;
+
+    packetize(30000, true);
+    ASSERT_EQ(DMD_S_OK, encoder.ProtectFrame(pPackets, iPacketCount, true,
+                &pFecPackets, &iFecCount));
+    EXPECT_EQ((iPacketCount * 30 + 50) / 100, iFecCount);
+    EXPECT_EQ(100, pFecPackets[0].iSequence);
+    DmdRtpHeader header;
+    vector<uint8_t> fec = flattenPacket(pFecPackets[0]);
+    ASSERT_EQ(DMD_S_OK, DmdRtpParseHeader(&fec[0], fec.size(), &header,
+                NULL));
+    EXPECT_EQ(0xfecU, header.iSsrc);
+    EXPECT_EQ(DMD_RTP_FEC_PAYLOAD_TYPE, header.iPayloadType);
+
+    // a small delta frame rounds down to no parity;
+    packetize(3000, false);
+    ASSERT_EQ(DMD_S_OK, encoder.ProtectFrame(pPackets, iPacketCount, false,
+                &pFecPackets, &iFecCount));
+    EXPECT_EQ(0U, iFecCount);
+    packetize(60000, false);
+    ASSERT_EQ(DMD_S_OK, encoder.ProtectFrame(pPackets, iPacketCount, false,
+                &pFecPackets, &iFecCount));
+    EXPECT_EQ((iPacketCount * 10 + 50) / 100, iFecCount);
+    // 16 packets at most per run, however low the rate;
+    encoder.SetProtection(1, 1);
+    ASSERT_EQ(DMD_S_OK, encoder.ProtectFrame(pPackets, iPacketCount, false,
+                &pFecPackets, &iFecCount));
+    EXPECT_EQ((iPacketCount + 15) / 16, iFecCount);
+
+    DmdFecEncoderStats stats;
+    encoder.GetStats(&stats);
+    EXPECT_EQ(4U, stats.ulFrameCount);
+    EXPECT_GT(stats.ulFecBytes, 0U);
+    EXPECT_LT(stats.ulFecBytes, stats.ulMediaBytes / 2);
+}
+
+TEST_F(CDmdFecTest, RecoversOneLossPerRun) {
+    CDmdFecEncoder encoder;
+    ASSERT_EQ(DMD_S_OK, encoder.Init(encoderParam));
+    CDmdSinkRecorder keeper;
+    CDmdFecDecoder decoder;
+    ASSERT_EQ(DMD_S_OK, decoder.Init(0xabcd, &keeper));
+
+    packetize(30000, true);
+    const DmdRtpPacket *pFecPackets = NULL;
+    unsigned int iFecCount = 0;
+    ASSERT_EQ(DMD_S_OK, encoder.ProtectFrame(pPackets, iPacketCount, true,
+                &pFecPackets, &iFecCount));
+    ASSERT_GE(iFecCount, 3U);
+
+    // the first packet of every run is lost, and the fec of the first run
+    // arrives before the rest of its media;
+    vector<vector<uint8_t> > fecs;
+    for (unsigned int i = 0; i < iFecCount; i++) {
+        fecs.push_back(flattenPacket(pFecPackets[i]));
+    }
+    EXPECT_EQ(DMD_S_OK, decoder.OnFecPacket(&fecs[0][0], fecs[0].size()));
+    vector<unsigned int> vecLost;
+    for (unsigned int i = 0; i < iFecCount; i++) {
+        vecLost.push_back(i * iPacketCount / iFecCount);
+    }
+    for (unsigned int i = 0, j = 0; i < iPacketCount; i++) {
+        if (j < vecLost.size() && vecLost[j] == i) {
+            j++;
+            continue;
+        }
+        vector<uint8_t> media = flattenPacket(pPackets[i]);
+        EXPECT_EQ(DMD_S_OK, decoder.OnMediaPacket(&media[0], media.size()));
+    }
+    EXPECT_EQ(1U, keeper.sequencePackets.size());
+    for (unsigned int i = 1; i < iFecCount; i++) {
+        EXPECT_EQ(DMD_S_OK, decoder.OnFecPacket(&fecs[i][0],
+                    fecs[i].size()));
+    }
+
+    ASSERT_EQ(vecLost.size(), keeper.sequencePackets.size());
+    for (size_t i = 0; i < vecLost.size(); i++) {
+        const DmdRtpPacket &lost = pPackets[vecLost[i]];
+        EXPECT_TRUE(flattenPacket(lost)
+                == keeper.sequencePackets[lost.iSequence]) << i;
+    }
+    DmdFecDecoderStats stats;
+    decoder.GetStats(&stats);
+    EXPECT_EQ(vecLost.size(), stats.ulRecoveredCount);
+    EXPECT_EQ(0U, stats.ulUnrecoverableCount);
+    EXPECT_EQ(iFecCount, stats.ulFecPacketCount);
+    EXPECT_EQ(iPacketCount - vecLost.size(), stats.ulMediaPacketCount);
+}
+
+TEST_F(CDmdFecTest, TwoLossesInRunWait) {
+    encoderParam.iKeyPercent = 1;  // one run of 16 at most;
+    CDmdFecEncoder encoder;
+    ASSERT_EQ(DMD_S_OK, encoder.Init(encoderParam));
+    CDmdSinkRecorder keeper;
+    CDmdFecDecoder decoder;
+    ASSERT_EQ(DMD_S_OK, decoder.Init(0xabcd, &keeper));
+
+    packetize(8000, true);
+    const DmdRtpPacket *pFecPackets = NULL;
+    unsigned int iFecCount = 0;
+    ASSERT_EQ(DMD_S_OK, encoder.ProtectFrame(pPackets, iPacketCount, true,
+                &pFecPackets, &iFecCount));
+    ASSERT_EQ(1U, iFecCount);
+    ASSERT_GT(iPacketCount, 3U);
+    vector<uint8_t> fec = flattenPacket(pFecPackets[0]);
+
+    for (unsigned int i = 2; i < iPacketCount; i++) {
+        vector<uint8_t> media = flattenPacket(pPackets[i]);
+        decoder.OnMediaPacket(&media[0], media.size());
+    }
+    EXPECT_EQ(DMD_S_OK, decoder.OnFecPacket(&fec[0], fec.size()));
+    EXPECT_TRUE(keeper.sequencePackets.empty());
+    // a late arrival, say a retransmission, leaves one to repair;
+    vector<uint8_t> media = flattenPacket(pPackets[1]);
+    decoder.OnMediaPacket(&media[0], media.size());
+    ASSERT_EQ(1U, keeper.sequencePackets.size());
+    EXPECT_TRUE(flattenPacket(pPackets[0])
+            == keeper.sequencePackets[pPackets[0].iSequence]);
+}
@@ -0,0 +1,356 @@
+/*
+ ============================================================================
+ * Name        : CDmdNackTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of nack based rtp retransmission.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <map>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdNackGenerator.h"
+#include "CDmdNackResponder.h"
+#include "CDmdPacer.h"
+#include "CDmdRtpHistory.h"
+#include "CDmdRtpPacketizer.h"
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+
+#include "CDmdSinkRecorder.h"
+
+using namespace opendmd;
+using std::map;
+using std::vector;
+
+class CDmdNackTest : public testing::Test {
+public:
+    CDmdNackTest() {
+        memset(&generatorParam, 0, sizeof(generatorParam));
+        generatorParam.ulJitterDelayUs = 200000;
+        generatorParam.ulRttUs = 50000;
+        generatorParam.ulReorderUs = 5000;
+        generatorParam.iMaxRetries = 3;
+    }
+    virtual ~CDmdNackTest() {}
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+public:
+    DmdNackGeneratorParam generatorParam;
+};
+
+TEST_F(CDmdNackTest, RtcpNackRoundTrip) {
+    uint16_t arrSequences[] = {65534, 65535, 0, 5, 40};
+    uint8_t buffer[64];
+    size_t ulSize = 0;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteNack(0x1111, 0x2222, arrSequences, 5,
+                buffer, sizeof(buffer), &ulSize));
+    // 65535, 0 and 5 fit in the blp of 65534;
+    EXPECT_EQ(20U, ulSize);
+    EXPECT_EQ(DMD_S_FAIL, DmdRtcpWriteNack(0x1111, 0x2222, arrSequences, 5,
+                buffer, 16, &ulSize));
+
+    // after another rtcp packet in the compound;
+    uint8_t compound[128];
+    uint8_t arrOther[8] = {0x80, 201, 0x00, 0x01, 1, 2, 3, 4};
+    memcpy(compound, arrOther, sizeof(arrOther));
+    memcpy(compound + sizeof(arrOther), buffer, 20);
+    vector<DmdRtcpNack> vecNacks;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseNacks(compound, sizeof(arrOther) + 20,
+                &vecNacks));
+    ASSERT_EQ(1U, vecNacks.size());
+    EXPECT_EQ(0x1111U, vecNacks[0].iSenderSsrc);
+    EXPECT_EQ(0x2222U, vecNacks[0].iMediaSsrc);
+    EXPECT_TRUE(vector<uint16_t>(arrSequences, arrSequences + 5)
+            == vecNacks[0].vecSequences);
+    EXPECT_EQ(DMD_S_FAIL, DmdRtcpParseNacks(compound, 19, &vecNacks));
+}
+
+TEST_F(CDmdNackTest, HistoryRingEvictsOldest) {
+    CDmdRtpHistory history;
+    EXPECT_EQ(DMD_S_FAIL, history.Init(1000, 100));
+    // 40 slots worth of memory rounds down to 32 slots;
+    ASSERT_EQ(DMD_S_OK, history.Init(40 * 100, 100));
+    EXPECT_EQ(32U, history.GetSlotCount());
+    EXPECT_EQ(3200U, history.GetCapacityBytes());
+
+    vector<uint8_t> payload(100);
+    struct iovec iov = {&payload[0], 100};
+    DmdRtpPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.pIov = &iov;
+    packet.iIovCount = 1;
+    packet.ulSize = 100;
+    for (unsigned int i = 0; i < 40; i++) {
+        payload[0] = static_cast<uint8_t>(i);
+        packet.iSequence = static_cast<uint16_t>(65530 + i);
+        history.Store(&packet, 1, 1000 + i);
+    }
+    EXPECT_TRUE(NULL == history.Find(65530));
+    EXPECT_TRUE(NULL == history.Find(1));
+    DmdRtpHistoryEntry *pEntry = history.Find(2);
+    ASSERT_TRUE(NULL != pEntry);
+    EXPECT_EQ(8, pEntry->pData[0]);
+    pEntry = history.Find(33);
+    ASSERT_TRUE(NULL != pEntry);
+    EXPECT_EQ(39, pEntry->pData[0]);
+    EXPECT_EQ(1039U, pEntry->ulSentUs);
+
+    // too large to keep, and hides what the slot held before;
+    packet.ulSize = 101;
+    iov.iov_len = 101;
+    payload.resize(101);
+    iov.iov_base = &payload[0];
+    packet.iSequence = 34;
+    history.Store(&packet, 1, 2000);
+    EXPECT_TRUE(NULL == history.Find(34));
+    EXPECT_TRUE(NULL == history.Find(2));  // the same slot;
+    DmdRtpHistoryStats stats;
+    history.GetStats(&stats);
+    EXPECT_EQ(40U, stats.ulStoredCount);
+    EXPECT_EQ(1U, stats.ulOversizeCount);
+}
+
+TEST_F(CDmdNackTest, GeneratorRespectsDeadline) {
+    CDmdNackGenerator generator;
+    ASSERT_EQ(DMD_S_OK, generator.Init(generatorParam));
+    uint64_t ulStartUs = 1000000;
+    vector<uint16_t> vecNack;
+
+    generator.OnPacket(65534, ulStartUs);
+    generator.OnPacket(1, ulStartUs);
+    EXPECT_EQ(2U, generator.GetMissingCount());
+    generator.GetNackList(ulStartUs + 1000, &vecNack);
+    EXPECT_TRUE(vecNack.empty());  // may be reordering;
+    generator.GetNackList(ulStartUs + 5000, &vecNack);
+    ASSERT_EQ(2U, vecNack.size());
+    EXPECT_EQ(65535, vecNack[0]);
+    EXPECT_EQ(0, vecNack[1]);
+    generator.GetNackList(ulStartUs + 20000, &vecNack);
+    EXPECT_TRUE(vecNack.empty());  // within a round trip;
+
+    generator.OnPacket(65535, ulStartUs + 30000);
+    generator.GetNackList(ulStartUs + 55000, &vecNack);
+    ASSERT_EQ(1U, vecNack.size());
+    EXPECT_EQ(0, vecNack[0]);
+    generator.GetNackList(ulStartUs + 105000, &vecNack);
+    EXPECT_EQ(1U, vecNack.size());
+    // a fourth request could not be answered before the deadline;
+    generator.GetNackList(ulStartUs + 155000, &vecNack);
+    EXPECT_TRUE(vecNack.empty());
+    EXPECT_FALSE(generator.TakeKeyFrameRequest());
+    generator.GetNackList(ulStartUs + 200000, &vecNack);
+    EXPECT_EQ(0U, generator.GetMissingCount());
+    EXPECT_TRUE(generator.TakeKeyFrameRequest());
+    EXPECT_FALSE(generator.TakeKeyFrameRequest());
+
+    DmdNackGeneratorStats stats;
+    generator.GetStats(&stats);
+    EXPECT_EQ(3U, stats.ulReceivedCount);
+    EXPECT_EQ(2U, stats.ulMissingCount);
+    EXPECT_EQ(4U, stats.ulNackedCount);
+    EXPECT_EQ(1U, stats.ulRecoveredCount);
+    EXPECT_EQ(1U, stats.ulLostCount);
+
+    // a gap too large to ask for;
+    generator.OnPacket(static_cast<uint16_t>(1 + DMD_NACK_MAX_MISSING + 2),
+            ulStartUs + 300000);
+    EXPECT_EQ(0U, generator.GetMissingCount());
+    EXPECT_TRUE(generator.TakeKeyFrameRequest());
+}
+
+// a key frame loses three packets on the way, nacks bring them back;
+TEST_F(CDmdNackTest, RecoversLostPackets) {
+    DmdRtpPacketizerParam packetizerParam;
+    memset(&packetizerParam, 0, sizeof(packetizerParam));
+    packetizerParam.iSsrc = 0xabcd;
+    packetizerParam.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+    packetizerParam.ulMtu = DMD_RTP_DEFAULT_MTU;
+    packetizerParam.iFirstSequence = 65530;
+    packetizerParam.bAggregate = true;
+    CDmdRtpPacketizer packetizer;
+    ASSERT_EQ(DMD_S_OK, packetizer.Init(packetizerParam));
+
+    size_t arrSizes[] = {12, 4, 30000};
+    vector<vector<uint8_t> > nals;
+    vector<struct iovec> iovs;
+    for (size_t i = 0; i < 3; i++) {
+        nals.push_back(vector<uint8_t>(arrSizes[i],
+                    static_cast<uint8_t>(i + 1)));
+        nals.back()[0] = static_cast<uint8_t>(0x60 | (i ? 5 : 7));
+    }
+    for (size_t i = 0; i < 3; i++) {
+        struct iovec iov = {&nals[i][0], nals[i].size()};
+        iovs.push_back(iov);
+    }
+    DmdEncodedFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.eFrameType = DmdFrameIDR;
+    frame.ulTimestamp = 1000000;
+    frame.iNalCount = 3;
+    frame.pNalIov = &iovs[0];
+    const DmdRtpPacket *pPackets = NULL;
+    unsigned int iPacketCount = 0;
+    ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&frame, &pPackets,
+                &iPacketCount));
+    ASSERT_GT(iPacketCount, 10U);
+
+    CDmdRtpHistory history;
+    ASSERT_EQ(DMD_S_OK, history.Init(DMD_RTP_HISTORY_DEFAULT_BYTES,
+                DMD_RTP_DEFAULT_MTU));
+    CDmdSinkRecorder wire;
+    CDmdNackResponder responder;
+    ASSERT_EQ(DMD_S_OK, responder.Init(&history, &wire, 0xabcd,
+                DMD_NACK_DEFAULT_RESEND_INTERVAL_US));
+    CDmdNackGenerator generator;
+    ASSERT_EQ(DMD_S_OK, generator.Init(generatorParam));
+
+    uint64_t ulNowUs = 1000000;
+    history.Store(pPackets, iPacketCount, ulNowUs);
+    map<uint16_t, vector<uint8_t> > received;
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        if (3 == i || 7 == i || 8 == i) {
+            continue;
+        }
+        received[pPackets[i].iSequence] = flattenPacket(pPackets[i]);
+        generator.OnPacket(pPackets[i].iSequence, ulNowUs);
+    }
+    EXPECT_EQ(3U, generator.GetMissingCount());
+
+    ulNowUs += generatorParam.ulReorderUs;
+    vector<uint16_t> vecNack;
+    generator.GetNackList(ulNowUs, &vecNack);
+    ASSERT_EQ(3U, vecNack.size());
+    uint8_t rtcp[64];
+    size_t ulRtcpSize = 0;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteNack(0x5678, 0xabcd, &vecNack[0],
+                static_cast<unsigned int>(vecNack.size()), rtcp, sizeof(rtcp),
+                &ulRtcpSize));
+    EXPECT_EQ(16U, ulRtcpSize);  // one pid and blp pair;
+    ASSERT_EQ(DMD_S_OK, responder.OnRtcp(rtcp, ulRtcpSize, ulNowUs));
+    // asked again at once, not resent twice;
+    ASSERT_EQ(DMD_S_OK, responder.OnRtcp(rtcp, ulRtcpSize, ulNowUs + 1000));
+
+    ASSERT_EQ(3U, wire.packets.size());
+    for (size_t i = 0; i < wire.packets.size(); i++) {
+        DmdRtpHeader header;
+        ASSERT_EQ(DMD_S_OK, DmdRtpParseHeader(&wire.packets[i][0],
+                    wire.packets[i].size(), &header, NULL));
+        EXPECT_EQ(0xabcdU, header.iSsrc);
+        received[header.iSequence] = wire.packets[i];
+        generator.OnPacket(header.iSequence, ulNowUs + 20000);
+    }
+    EXPECT_EQ(0U, generator.GetMissingCount());
+    EXPECT_FALSE(generator.TakeKeyFrameRequest());
+    ASSERT_EQ(iPacketCount, received.size());
+    for (unsigned int i = 0; i < iPacketCount; i++) {
+        EXPECT_TRUE(flattenPacket(pPackets[i])
+                == received[pPackets[i].iSequence]) << i;
+    }
+
+    // a few kilobytes, against 30KB for a new key frame;
+    DmdNackResponderStats stats;
+    responder.GetStats(&stats);
+    EXPECT_EQ(2U, stats.ulNackCount);
+    EXPECT_EQ(3U, stats.ulResentCount);
+    EXPECT_EQ(3U, stats.ulThrottledCount);
+    EXPECT_LE(stats.ulResentBytes, 3U * DMD_RTP_DEFAULT_MTU);
+    DmdNackGeneratorStats generatorStats;
+    generator.GetStats(&generatorStats);
+    EXPECT_EQ(3U, generatorStats.ulRecoveredCount);
+    EXPECT_EQ(0U, generatorStats.ulLostCount);
+}
+
+// retransmissions wait in the pacer, the pacer thread alone sends;
+TEST_F(CDmdNackTest, ResendsThroughPacer) {
+    vector<vector<uint8_t> > buffers(4, vector<uint8_t>(200, 0));
+    vector<struct iovec> iovs(4);
+    vector<DmdRtpPacket> packets(4);
+    for (unsigned int i = 0; i < 4; i++) {
+        DmdRtpHeader header;
+        memset(&header, 0, sizeof(header));
+        header.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+        header.iSequence = static_cast<uint16_t>(100 + i);
+        header.iSsrc = 0xabcd;
+        DmdRtpWriteHeader(header, &buffers[i][0]);
+        iovs[i].iov_base = &buffers[i][0];
+        iovs[i].iov_len = buffers[i].size();
+        memset(&packets[i], 0, sizeof(packets[i]));
+        packets[i].pIov = &iovs[i];
+        packets[i].iIovCount = 1;
+        packets[i].ulSize = buffers[i].size();
+        packets[i].iSequence = header.iSequence;
+    }
+    CDmdRtpHistory history;
+    ASSERT_EQ(DMD_S_OK, history.Init(DMD_RTP_HISTORY_DEFAULT_BYTES,
+                DMD_RTP_DEFAULT_MTU));
+    uint64_t ulNowUs = 1000000;
+    history.Store(&packets[0], 4, ulNowUs);
+
+    DmdPacerParam pacerParam;
+    memset(&pacerParam, 0, sizeof(pacerParam));
+    pacerParam.fFrameRate = 30.0f;
+    CDmdSinkRecorder wire;
+    CDmdPacer pacer;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(pacerParam, &wire));
+    CDmdNackResponder responder;
+    ASSERT_EQ(DMD_S_OK, responder.Init(&history, &pacer, 0xabcd,
+                DMD_NACK_DEFAULT_RESEND_INTERVAL_US));
+
+    uint16_t arrLost[] = {101, 103};
+    uint8_t rtcp[64];
+    size_t ulRtcpSize = 0;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteNack(0x5678, 0xabcd, arrLost, 2, rtcp,
+                sizeof(rtcp), &ulRtcpSize));
+    ASSERT_EQ(DMD_S_OK, responder.OnRtcp(rtcp, ulRtcpSize, ulNowUs));
+    EXPECT_EQ(0U, wire.packets.size());
+
+    EXPECT_EQ(2U, pacer.PaceOnce(ulNowUs, NULL));
+    ASSERT_EQ(2U, wire.packets.size());
+    EXPECT_TRUE(buffers[1] == wire.packets[0]);
+    EXPECT_TRUE(buffers[3] == wire.packets[1]);
+    DmdPacerStats pacerStats;
+    pacer.GetStats(&pacerStats, ulNowUs);
+    EXPECT_EQ(2U, pacerStats.ulBypassPacketCount);
+    DmdNackResponderStats stats;
+    responder.GetStats(&stats);
+    EXPECT_EQ(2U, stats.ulResentCount);
+    EXPECT_EQ(400U, stats.ulResentBytes);
+}
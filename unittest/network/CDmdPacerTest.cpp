@@ -0,0 +1,599 @@
+/*
+ ============================================================================
+ * Name        : CDmdPacerTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of token bucket packet pacer.
+ ============================================================================
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+#include "CDmdColorConvert.h"
+#include "CDmdEncodeEngine.h"
+#include "CDmdNackGenerator.h"
+#include "CDmdPacer.h"
+#include "CDmdRtpPacketizer.h"
+#include "DmdRtp.h"
+#include "DmdTimeUtils.h"
+
+#include "CDmdEncodedKeeper.h"
+#include "CDmdFeedbackRecorder.h"
+
+using namespace opendmd;
+using std::vector;
+
+// records what leaves the pacer, and when;
+class CDmdPacketRecorder : public IDmdRtpPacketSink {
+public:
+    CDmdPacketRecorder() : ulNowUs(0) {}
+    DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount) {
+        for (unsigned int i = 0; i < iPacketCount; i++) {
+            const uint8_t *pData =
+                static_cast<const uint8_t *>(pPackets[i].pIov[0].iov_base);
+            packets.push_back(vector<uint8_t>(pData,
+                        pData + pPackets[i].ulSize));
+            sendTimes.push_back(ulNowUs ? ulNowUs : DmdGetTickCountUs());
+        }
+        *piSentCount = iPacketCount;
+        return DMD_S_OK;
+    }
+
+    uint64_t ulNowUs;   // 0 for the clock;
+    vector<vector<uint8_t> > packets;
+    vector<uint64_t> sendTimes;
+};
+
+class CDmdPacerTest : public testing::Test {
+public:
+    CDmdPacerTest() {
+        memset(&param, 0, sizeof(param));
+        param.fFrameRate = 30.0f;
+        param.fSpreadRatio = 0.5f;
+    }
+    virtual ~CDmdPacerTest() {}
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    // iCount packets of ulSize bytes, the first byte numbering them;
+    void makePackets(unsigned int iCount, size_t ulSize, uint8_t iFirst) {
+        buffers.assign(iCount, vector<uint8_t>(ulSize, 0));
+        iovs.resize(iCount);
+        packets.resize(iCount);
+        for (unsigned int i = 0; i < iCount; i++) {
+            buffers[i][0] = static_cast<uint8_t>(iFirst + i);
+            iovs[i].iov_base = &buffers[i][0];
+            iovs[i].iov_len = ulSize;
+            memset(&packets[i], 0, sizeof(packets[i]));
+            packets[i].pIov = &iovs[i];
+            packets[i].iIovCount = 1;
+            packets[i].ulSize = ulSize;
+            packets[i].iSequence = static_cast<uint16_t>(i);
+        }
+        packets.back().bMarker = true;
+    }
+
+    // a frame of single nal packets, the first byte numbering the frame,
+    // iNalHeader telling its class;
+    void makeFrame(unsigned int iCount, uint8_t iNalHeader, uint8_t iFrame) {
+        makePackets(iCount, 1200, 0);
+        for (unsigned int i = 0; i < iCount; i++) {
+            buffers[i][0] = iFrame;
+            buffers[i][DMD_RTP_HEADER_SIZE] = iNalHeader;
+        }
+    }
+
+    void enqueueFrame(CDmdPacer *pPacer, unsigned int iCount,
+            uint8_t iNalHeader, uint8_t iFrame, uint64_t ulNowUs,
+            DMD_RESULT expected = DMD_S_OK) {
+        makeFrame(iCount, iNalHeader, iFrame);
+        EXPECT_EQ(expected, pPacer->EnqueuePackets(&packets[0], iCount,
+                    DmdPacerPriorityVideo, ulNowUs));
+    }
+
+    // as makeFrame, with the rtp headers of stream iSsrc from iSequence;
+    void makeStreamFrame(unsigned int iCount, uint8_t iNalHeader,
+            uint32_t iSsrc, uint16_t iSequence) {
+        makeFrame(iCount, iNalHeader, 0);
+        for (unsigned int i = 0; i < iCount; i++) {
+            DmdRtpHeader rtpHeader;
+            memset(&rtpHeader, 0, sizeof(rtpHeader));
+            rtpHeader.bMarker = i + 1 == iCount;
+            rtpHeader.iPayloadType = 96;
+            rtpHeader.iSequence = static_cast<uint16_t>(iSequence + i);
+            rtpHeader.iSsrc = iSsrc;
+            DmdRtpWriteHeader(rtpHeader, &buffers[i][0]);
+            packets[i].iSequence = rtpHeader.iSequence;
+        }
+    }
+
+    void enqueueStreamFrame(CDmdPacer *pPacer, unsigned int iCount,
+            uint8_t iNalHeader, uint32_t iSsrc, uint16_t iSequence,
+            uint64_t ulNowUs, DMD_RESULT expected = DMD_S_OK) {
+        makeStreamFrame(iCount, iNalHeader, iSsrc, iSequence);
+        EXPECT_EQ(expected, pPacer->EnqueuePackets(&packets[0], iCount,
+                    DmdPacerPriorityVideo, ulNowUs));
+    }
+
+    // the packets of stream iSsrc sent;
+    static size_t countStream(const CDmdPacketRecorder &recorder,
+            uint32_t iSsrc) {
+        size_t ulCount = 0;
+        for (size_t i = 0; i < recorder.packets.size(); i++) {
+            DmdRtpHeader rtpHeader;
+            if (DMD_S_OK == DmdRtpParseHeader(&recorder.packets[i][0],
+                        recorder.packets[i].size(), &rtpHeader, NULL)
+                    && rtpHeader.iSsrc == iSsrc) {
+                ulCount++;
+            }
+        }
+        return ulCount;
+    }
+
+    // steps the pacer the way Run() does, on a simulated clock;
+    static void drain(CDmdPacer *pPacer, CDmdPacketRecorder *pRecorder,
+            uint64_t ulStartUs) {
+        uint64_t ulNowUs = ulStartUs;
+        for (int i = 0; i < 10000; i++) {
+            uint64_t ulNextUs = 0;
+            pRecorder->ulNowUs = ulNowUs;
+            pPacer->PaceOnce(ulNowUs, &ulNextUs);
+            if (0 == ulNextUs) {
+                break;
+            }
+            EXPECT_GE(ulNextUs, ulNowUs);
+            ulNowUs = ulNextUs;
+        }
+    }
+
+public:
+    DmdPacerParam param;
+    vector<vector<uint8_t> > buffers;
+    vector<struct iovec> iovs;
+    vector<DmdRtpPacket> packets;
+};
+
+TEST_F(CDmdPacerTest, SpreadsKeyFrame) {
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    // a 120KB key frame, half of a 33ms frame interval to leave in;
+    uint64_t ulStartUs = 1000000;
+    makePackets(100, 1200, 0);
+    ASSERT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 100,
+                DmdPacerPriorityVideo, ulStartUs));
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, ulStartUs);
+    EXPECT_EQ(120000U, stats.ulQueueBytes);
+    EXPECT_NEAR(120000 * 8 * 30 * 2, stats.ulRateBps, 1000);
+
+    drain(&pacer, &recorder, ulStartUs);
+    ASSERT_EQ(100U, recorder.packets.size());
+    for (unsigned int i = 0; i < 100; i++) {
+        EXPECT_EQ(i, recorder.packets[i][0]);
+    }
+    // no more than the bucket goes at once, and the frame is out on time;
+    unsigned int iBurst = 0;
+    while (iBurst < 100 && recorder.sendTimes[iBurst] == ulStartUs) {
+        iBurst++;
+    }
+    EXPECT_EQ(DMD_PACER_DEFAULT_BURST_BYTES / 1200U, iBurst);
+    uint64_t ulSpreadUs = recorder.sendTimes.back() - ulStartUs;
+    EXPECT_GT(ulSpreadUs, 15000U);
+    EXPECT_LT(ulSpreadUs, 17000U);
+
+    pacer.GetStats(&stats, recorder.sendTimes.back());
+    EXPECT_EQ(1U, stats.ulFrameCount);
+    EXPECT_EQ(100U, stats.ulPacketCount);
+    EXPECT_EQ(120000U, stats.ulByteCount);
+    EXPECT_EQ(0U, stats.ulQueueBytes);
+    EXPECT_EQ(ulSpreadUs, stats.ulMaxQueueDelayUs);
+}
+
+TEST_F(CDmdPacerTest, AudioBypassesVideo) {
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    uint64_t ulStartUs = 1000000;
+    makePackets(50, 1200, 0);
+    ASSERT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 50,
+                DmdPacerPriorityVideo, ulStartUs));
+    uint64_t ulNextUs = 0;
+    recorder.ulNowUs = ulStartUs;
+    pacer.PaceOnce(ulStartUs, &ulNextUs);
+    size_t ulFirstBurst = recorder.packets.size();
+
+    // tokens are spent, audio still goes out at once, ahead of video;
+    makePackets(1, 160, 200);
+    ASSERT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 1,
+                DmdPacerPriorityAudio, ulStartUs + 10));
+    recorder.ulNowUs = ulStartUs + 10;
+    EXPECT_EQ(1U, pacer.PaceOnce(ulStartUs + 10, &ulNextUs));
+    ASSERT_EQ(ulFirstBurst + 1, recorder.packets.size());
+    EXPECT_EQ(200, recorder.packets.back()[0]);
+    EXPECT_GT(ulNextUs, ulStartUs + 10);
+
+    drain(&pacer, &recorder, ulNextUs);
+    EXPECT_EQ(51U, recorder.packets.size());
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, recorder.sendTimes.back());
+    EXPECT_EQ(1U, stats.ulBypassPacketCount);
+    EXPECT_EQ(51U, stats.ulPacketCount);
+}
+
+TEST_F(CDmdPacerTest, DropsFramesOverQueueLimit) {
+    param.ulMaxQueueBytes = 100000;
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    makePackets(60, 1200, 0);
+    EXPECT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 60,
+                DmdPacerPriorityVideo, 1000));
+    EXPECT_EQ(DMD_S_FAIL, pacer.EnqueuePackets(&packets[0], 60,
+                DmdPacerPriorityVideo, 2000));
+    // events are never held back by the video limit;
+    EXPECT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 60,
+                DmdPacerPriorityEvent, 2000));
+
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, 3000);
+    EXPECT_EQ(1U, stats.ulFrameCount);
+    EXPECT_EQ(1U, stats.ulDroppedFrameCount);
+    EXPECT_EQ(72000U, stats.ulQueueBytes);
+    EXPECT_EQ(2000U, stats.ulQueueDelayUs);
+}
+
+#define DMD_TEST_NAL_IDR      0x65
+#define DMD_TEST_NAL_REF      0x41
+#define DMD_TEST_NAL_NONREF   0x01
+
+TEST_F(CDmdPacerTest, DropsNonReferenceFirst) {
+    param.ulMinRateBps = 800 * 1000;
+    param.ulMaxRateBps = 800 * 1000;
+    param.ulDropDelayUs = 50000;
+    param.ulMaxQueueBytes = 32000;
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    enqueueFrame(&pacer, 10, DMD_TEST_NAL_IDR, 0, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 1, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_NONREF, 2, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 3, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_NONREF, 4, 1000);
+    // a reference frame is queued in place of a non-reference one;
+    enqueueFrame(&pacer, 10, DMD_TEST_NAL_REF, 5, 1000);
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, 1000);
+    EXPECT_EQ(1U, stats.arrDroppedFrames[DmdPacerFrameNonReference]);
+    EXPECT_EQ(31200U, stats.ulQueueBytes);
+    // and a non-reference frame finds no room;
+    enqueueFrame(&pacer, 5, DMD_TEST_NAL_NONREF, 6, 1000, DMD_S_FAIL);
+
+    recorder.ulNowUs = 1000;
+    pacer.PaceOnce(1000, NULL);
+    // the key frame is started, beyond the delay only non-reference
+    // frames go;
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_NONREF, 7, 40000);
+    drain(&pacer, &recorder, 60000);
+    pacer.GetStats(&stats, recorder.sendTimes.back());
+    EXPECT_EQ(4U, stats.arrDroppedFrames[DmdPacerFrameNonReference]);
+    EXPECT_EQ(0U, stats.arrDroppedFrames[DmdPacerFrameReference]);
+    EXPECT_EQ(0U, stats.arrDroppedFrames[DmdPacerFrameKey]);
+    EXPECT_EQ(4U, stats.ulDroppedFrameCount);
+    EXPECT_EQ(0U, stats.ulFlushCount);
+    ASSERT_EQ(24U, recorder.packets.size());
+    for (size_t i = 0; i < recorder.packets.size(); i++) {
+        EXPECT_NE(DMD_TEST_NAL_NONREF,
+                recorder.packets[i][DMD_RTP_HEADER_SIZE]);
+    }
+    EXPECT_EQ(5U, recorder.packets.back()[0]);
+    EXPECT_FALSE(pacer.TakeKeyFrameRequest());
+}
+
+TEST_F(CDmdPacerTest, FlushesToKeyFrame) {
+    param.ulMinRateBps = 800 * 1000;
+    param.ulMaxRateBps = 800 * 1000;
+    param.ulDropDelayUs = 50000;
+    param.ulFlushDelayUs = 200000;
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    enqueueFrame(&pacer, 20, DMD_TEST_NAL_IDR, 0, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 1, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 2, 1000);
+    enqueueFrame(&pacer, 5, DMD_TEST_NAL_IDR, 3, 1000);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 4, 1000);
+    recorder.ulNowUs = 1000;
+    pacer.PaceOnce(1000, NULL);
+
+    // the started key frame finishes, the frames before the next go;
+    recorder.ulNowUs = 251000;
+    pacer.PaceOnce(251000, NULL);
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, 251000);
+    EXPECT_EQ(2U, stats.arrDroppedFrames[DmdPacerFrameReference]);
+    EXPECT_EQ(0U, stats.arrDroppedFrames[DmdPacerFrameKey]);
+    EXPECT_EQ(1U, stats.ulFlushCount);
+    EXPECT_FALSE(pacer.TakeKeyFrameRequest());
+
+    // once the key frame is started, the frame after it is as late, and
+    // video waits for a new one;
+    drain(&pacer, &recorder, 252000);
+    ASSERT_EQ(25U, recorder.packets.size());
+    EXPECT_EQ(0U, recorder.packets[19][0]);
+    EXPECT_EQ(3U, recorder.packets[20][0]);
+    EXPECT_TRUE(pacer.TakeKeyFrameRequest());
+    EXPECT_FALSE(pacer.TakeKeyFrameRequest());
+
+    uint64_t ulNowUs = recorder.sendTimes.back() + 1000;
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 5, ulNowUs, DMD_S_FAIL);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_IDR, 6, ulNowUs);
+    enqueueFrame(&pacer, 2, DMD_TEST_NAL_REF, 7, ulNowUs);
+    drain(&pacer, &recorder, ulNowUs);
+    pacer.GetStats(&stats, recorder.sendTimes.back());
+    EXPECT_EQ(4U, stats.arrDroppedFrames[DmdPacerFrameReference]);
+    EXPECT_EQ(0U, stats.arrDroppedFrames[DmdPacerFrameKey]);
+    EXPECT_EQ(2U, stats.ulFlushCount);
+    ASSERT_EQ(29U, recorder.packets.size());
+    EXPECT_EQ(6U, recorder.packets[25][0]);
+    EXPECT_EQ(7U, recorder.packets.back()[0]);
+}
+
+TEST_F(CDmdPacerTest, DropsLeaveNoGap) {
+    param.ulMinRateBps = 800 * 1000;
+    param.ulMaxRateBps = 800 * 1000;
+    param.ulDropDelayUs = 50000;
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    enqueueStreamFrame(&pacer, 10, DMD_TEST_NAL_IDR, 7, 65530, 1000);
+    recorder.ulNowUs = 1000;
+    pacer.PaceOnce(1000, NULL);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_REF, 7, 4, 1000);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_NONREF, 7, 6, 1000);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_REF, 7, 8, 1000);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_NONREF, 7, 10, 1000);
+    drain(&pacer, &recorder, 1000);
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, recorder.sendTimes.back());
+    EXPECT_EQ(2U, stats.arrDroppedFrames[DmdPacerFrameNonReference]);
+    ASSERT_EQ(14U, recorder.packets.size());
+
+    // what is sent counts on from the first sequence number, through the
+    // wrap, and the receiver finds nothing to ask for;
+    DmdNackGeneratorParam generatorParam;
+    generatorParam.ulJitterDelayUs = 200000;
+    generatorParam.ulRttUs = 50000;
+    generatorParam.ulReorderUs = 5000;
+    generatorParam.iMaxRetries = 3;
+    CDmdNackGenerator generator;
+    ASSERT_EQ(DMD_S_OK, generator.Init(generatorParam));
+    for (size_t i = 0; i < recorder.packets.size(); i++) {
+        DmdRtpHeader rtpHeader;
+        ASSERT_EQ(DMD_S_OK, DmdRtpParseHeader(&recorder.packets[i][0],
+                    recorder.packets[i].size(), &rtpHeader, NULL));
+        EXPECT_EQ(static_cast<uint16_t>(65530 + i), rtpHeader.iSequence);
+        generator.OnPacket(rtpHeader.iSequence, recorder.sendTimes[i]);
+    }
+    vector<uint16_t> vecNack;
+    uint64_t ulNowUs = recorder.sendTimes.back();
+    for (uint64_t ulAfterUs = 1000; ulAfterUs <= 400000; ulAfterUs *= 2) {
+        generator.GetNackList(ulNowUs + ulAfterUs, &vecNack);
+        EXPECT_TRUE(vecNack.empty());
+    }
+    EXPECT_EQ(0U, generator.GetMissingCount());
+    EXPECT_FALSE(generator.TakeKeyFrameRequest());
+    EXPECT_FALSE(pacer.TakeKeyFrameRequest());
+}
+
+TEST_F(CDmdPacerTest, FlushesPerStream) {
+    param.ulMinRateBps = 8000 * 1000;
+    param.ulMaxRateBps = 8000 * 1000;
+    param.ulDropDelayUs = 50000;
+    param.ulFlushDelayUs = 200000;
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    enqueueStreamFrame(&pacer, 20, DMD_TEST_NAL_IDR, 1, 0, 1000);
+    recorder.ulNowUs = 1000;
+    pacer.PaceOnce(1000, NULL);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_REF, 1, 20, 1000);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_IDR, 2, 0, 200000);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_REF, 2, 2, 200000);
+
+    // the key frame of stream 2 is no reason to keep the late frame of 1,
+    // and 1 having none queued holds back none of 2;
+    recorder.ulNowUs = 251000;
+    pacer.PaceOnce(251000, NULL);
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, 251000);
+    EXPECT_EQ(1U, stats.arrDroppedFrames[DmdPacerFrameReference]);
+    EXPECT_EQ(1U, stats.ulFlushCount);
+    uint32_t iSsrc = 0;
+    EXPECT_TRUE(pacer.TakeKeyFrameRequest(&iSsrc));
+    EXPECT_EQ(1U, iSsrc);
+    EXPECT_FALSE(pacer.TakeKeyFrameRequest(&iSsrc));
+    drain(&pacer, &recorder, 251000);
+    EXPECT_EQ(20U, countStream(recorder, 1));
+    EXPECT_EQ(4U, countStream(recorder, 2));
+
+    uint64_t ulNowUs = recorder.sendTimes.back() + 1000;
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_REF, 1, 22, ulNowUs,
+            DMD_S_FAIL);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_REF, 2, 4, ulNowUs);
+    enqueueStreamFrame(&pacer, 2, DMD_TEST_NAL_IDR, 1, 24, ulNowUs);
+    drain(&pacer, &recorder, ulNowUs);
+    EXPECT_EQ(22U, countStream(recorder, 1));
+    EXPECT_EQ(6U, countStream(recorder, 2));
+    EXPECT_FALSE(pacer.TakeKeyFrameRequest());
+}
+
+TEST_F(CDmdPacerTest, ClassifiesEncodedFrames) {
+    unsigned int iWidth = 160;
+    unsigned int iHeight = 96;
+    vector<uint8_t> buffer(DmdI420FrameSize(iWidth, iHeight));
+    DmdVideoRawData videoRawData;
+    memset(&videoRawData, 0, sizeof(videoRawData));
+    DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+
+    DmdEncodeParam encodeParam;
+    memset(&encodeParam, 0, sizeof(encodeParam));
+    encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+    encodeParam.iTargetBitrate = 512 * 1024;
+    encodeParam.eRcMode = DmdRcBitrate;
+    encodeParam.eComplexity = DmdComplexityLow;
+    encodeParam.iThreadCount = 1;
+    encodeParam.bNonReferenceFrames = true;
+
+    IDmdEncodeEngine *pEngine = NULL;
+    CDmdEncodedKeeper keeper;
+    ASSERT_EQ(DMD_S_OK, CreateVideoEncodeEngine(&pEngine));
+    pEngine->SetDataSink(&keeper);
+    ASSERT_EQ(DMD_S_OK, pEngine->Init(encodeParam));
+    for (unsigned int i = 0; i < 8; i++) {
+        for (size_t j = 0; j < buffer.size(); j++) {
+            buffer[j] = static_cast<uint8_t>((j * 13 + i * 5) ^ (j >> 7));
+        }
+        videoRawData.fmtVideoFormat.ulTimestamp = i * 33333;
+        EXPECT_EQ(DMD_S_OK, pEngine->EncodeFrame(&videoRawData));
+    }
+    pEngine->Uninit();
+    ReleaseVideoEncodeEngine(&pEngine);
+    ASSERT_EQ(8U, keeper.frames.size());
+
+    DmdRtpPacketizerParam packetizerParam;
+    memset(&packetizerParam, 0, sizeof(packetizerParam));
+    packetizerParam.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+    packetizerParam.ulMtu = DMD_RTP_DEFAULT_MTU;
+    packetizerParam.bAggregate = true;
+    CDmdRtpPacketizer packetizer;
+    ASSERT_EQ(DMD_S_OK, packetizer.Init(packetizerParam));
+
+    param.ulMinRateBps = 800 * 1000;
+    param.ulMaxRateBps = 800 * 1000;
+    param.ulDropDelayUs = 50000;
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+
+    // the p frames of the second temporal layer come out with nri 0;
+    unsigned int iNonRefCount = 0;
+    size_t ulRefPackets = 0;
+    for (size_t f = 0; f < keeper.frames.size(); f++) {
+        const DmdRtpPacket *pPackets = NULL;
+        unsigned int iCount = 0;
+        ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&keeper.frames[f],
+                    &pPackets, &iCount));
+        ASSERT_GT(iCount, 0U);
+        DmdRtpNalInfo nalInfo;
+        ASSERT_EQ(DMD_S_OK, DmdRtpGetNalInfo(pPackets[iCount - 1],
+                    &nalInfo));
+        EXPECT_EQ(0 == f % 2, 0 != nalInfo.iNri);
+        if (0 == nalInfo.iNri) {
+            iNonRefCount++;
+        } else {
+            ulRefPackets += iCount;
+        }
+        ASSERT_EQ(DMD_S_OK, pacer.EnqueuePackets(pPackets, iCount,
+                    DmdPacerPriorityVideo, 1000));
+    }
+    EXPECT_EQ(4U, iNonRefCount);
+
+    // beyond the delay, the pacer drops just those;
+    drain(&pacer, &recorder, 60000);
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, recorder.sendTimes.back());
+    EXPECT_EQ(iNonRefCount,
+            stats.arrDroppedFrames[DmdPacerFrameNonReference]);
+    EXPECT_EQ(0U, stats.arrDroppedFrames[DmdPacerFrameReference]);
+    EXPECT_EQ(0U, stats.arrDroppedFrames[DmdPacerFrameKey]);
+    EXPECT_EQ(ulRefPackets, recorder.packets.size());
+}
+
+static void *pacerRoutine(void *param) {
+    reinterpret_cast<CDmdPacer *>(param)->Run();
+    return NULL;
+}
+
+TEST_F(CDmdPacerTest, PacesOnThread) {
+    CDmdPacer pacer;
+    CDmdPacketRecorder recorder;
+    CDmdFeedbackRecorder feedback;
+    ASSERT_EQ(DMD_S_OK, pacer.Init(param, &recorder));
+    pacer.SetFeedbackSink(&feedback);
+    pthread_t thread;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, pacerRoutine, &pacer));
+
+    // a key frame, then a few small frames one frame interval apart;
+    uint64_t ulStartUs = DmdGetTickCountUs();
+    makePackets(100, 1200, 0);
+    ASSERT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 100,
+                DmdPacerPriorityVideo, ulStartUs));
+    for (unsigned int i = 0; i < 5; i++) {
+        usleep(33000);
+        makePackets(2, 1000, 0);
+        ASSERT_EQ(DMD_S_OK, pacer.EnqueuePackets(&packets[0], 2,
+                    DmdPacerPriorityVideo, DmdGetTickCountUs()));
+    }
+    for (int i = 0; i < 100 && recorder.packets.size() < 110; i++) {
+        usleep(10000);
+    }
+    pacer.Stop();
+    EXPECT_EQ(0, pthread_join(thread, NULL));
+
+    ASSERT_EQ(110U, recorder.packets.size());
+    // the key frame took about half a frame interval, not a burst;
+    EXPECT_GT(recorder.sendTimes[99] - ulStartUs, 12000U);
+    DmdPacerStats stats;
+    pacer.GetStats(&stats, DmdGetTickCountUs());
+    EXPECT_EQ(6U, stats.ulFrameCount);
+    EXPECT_EQ(0U, stats.ulQueueBytes);
+    EXPECT_GT(stats.ulMaxQueueDelayUs, 12000U);
+    EXPECT_GE(feedback.feedbacks.size(), 1U);
+}
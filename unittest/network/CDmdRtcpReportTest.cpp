@@ -0,0 +1,334 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtcpReportTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of rtcp sender and receiver reports.
+ ============================================================================
+ */
+
+#include <string.h>
+#include <sys/uio.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdTransport.h"
+#include "CDmdRtcpReceiver.h"
+#include "CDmdRtcpSender.h"
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+
+#include "CDmdFeedbackRecorder.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdRtcpReportTest : public testing::Test {
+public:
+    CDmdRtcpReportTest() {
+        memset(&senderParam, 0, sizeof(senderParam));
+        senderParam.iSsrc = 0x1234;
+        senderParam.iClockRate = DMD_RTP_H264_CLOCK_RATE;
+        senderParam.iTimestampOffset = 0x9000;
+        senderParam.fBandwidthFraction = DMD_RTCP_DEFAULT_BANDWIDTH_FRACTION;
+        senderParam.ulMinIntervalUs = DMD_RTCP_DEFAULT_MIN_INTERVAL_US;
+
+        memset(&receiverParam, 0, sizeof(receiverParam));
+        receiverParam.iSsrc = 0x5678;
+        receiverParam.iMediaSsrc = senderParam.iSsrc;
+        receiverParam.iClockRate = DMD_RTP_H264_CLOCK_RATE;
+        receiverParam.fBandwidthFraction =
+            DMD_RTCP_DEFAULT_BANDWIDTH_FRACTION;
+        receiverParam.ulMinIntervalUs = DMD_RTCP_DEFAULT_MIN_INTERVAL_US;
+    }
+    virtual ~CDmdRtcpReportTest() {}
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    // rtp timestamp of a capture time, as the packetizer stamps it;
+    uint32_t timestampOf(uint64_t ulCaptureUs) {
+        return DmdRtpTimestamp(ulCaptureUs, senderParam.iClockRate)
+            + senderParam.iTimestampOffset;
+    }
+
+public:
+    DmdRtcpSenderParam senderParam;
+    DmdRtcpReceiverParam receiverParam;
+};
+
+TEST_F(CDmdRtcpReportTest, ReportRoundTrip) {
+    DmdRtcpSenderInfo senderInfo = {0x0123456789abcdefULL, 1000, 20, 3000};
+    DmdRtcpReportBlock arrBlocks[2] = {
+        {0x2222, 64, -3, 0x1fffe, 120, 0xabcd1234, 0x8000},
+        {0x3333, 0, 0x7fffff + 5, 17, 0, 0, 0},
+    };
+    uint8_t compound[256];
+    size_t ulSize = 0;
+    size_t ulTotal = 0;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteReport(0x1111, &senderInfo, arrBlocks, 1,
+                compound, sizeof(compound), &ulSize));
+    EXPECT_EQ(52U, ulSize);
+    ulTotal += ulSize;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteReport(0x4444, NULL, arrBlocks, 2,
+                compound + ulTotal, sizeof(compound) - ulTotal, &ulSize));
+    EXPECT_EQ(56U, ulSize);
+    ulTotal += ulSize;
+    // a nack in the same compound is skipped;
+    uint16_t iSequence = 7;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteNack(0x4444, 0x1111, &iSequence, 1,
+                compound + ulTotal, sizeof(compound) - ulTotal, &ulSize));
+    ulTotal += ulSize;
+    EXPECT_EQ(DMD_S_FAIL, DmdRtcpWriteReport(0x4444, NULL, arrBlocks, 2,
+                compound, 40, &ulSize));
+
+    vector<DmdRtcpReport> vecReports;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseReports(compound, ulTotal, &vecReports));
+    ASSERT_EQ(2U, vecReports.size());
+    EXPECT_EQ(DMD_RTCP_PT_SR, vecReports[0].iPacketType);
+    EXPECT_EQ(0x1111U, vecReports[0].iSsrc);
+    EXPECT_EQ(senderInfo.ulNtpTime, vecReports[0].senderInfo.ulNtpTime);
+    EXPECT_EQ(1000U, vecReports[0].senderInfo.iRtpTimestamp);
+    EXPECT_EQ(20U, vecReports[0].senderInfo.iPacketCount);
+    EXPECT_EQ(3000U, vecReports[0].senderInfo.iOctetCount);
+    ASSERT_EQ(1U, vecReports[0].vecBlocks.size());
+    const DmdRtcpReportBlock &block = vecReports[0].vecBlocks[0];
+    EXPECT_EQ(0x2222U, block.iSsrc);
+    EXPECT_EQ(64, block.iFractionLost);
+    EXPECT_EQ(-3, block.iCumulativeLost);
+    EXPECT_EQ(0x1fffeU, block.iExtHighestSeq);
+    EXPECT_EQ(120U, block.iJitter);
+    EXPECT_EQ(0xabcd1234U, block.iLastSr);
+    EXPECT_EQ(0x8000U, block.iDelaySinceLastSr);
+
+    EXPECT_EQ(DMD_RTCP_PT_RR, vecReports[1].iPacketType);
+    ASSERT_EQ(2U, vecReports[1].vecBlocks.size());
+    // clamped to 24 bits;
+    EXPECT_EQ(0x7fffff, vecReports[1].vecBlocks[1].iCumulativeLost);
+
+    // a truncated compound is rejected;
+    vecReports.clear();
+    EXPECT_EQ(DMD_S_FAIL, DmdRtcpParseReports(compound, 50, &vecReports));
+}
+
+TEST_F(CDmdRtcpReportTest, NtpTime) {
+    uint64_t ulWallClockUs = 1700000000ULL * 1000000 + 250000;
+    uint64_t ulNtpTime = DmdNtpFromUs(ulWallClockUs);
+    EXPECT_EQ(1700000000ULL + DMD_NTP_UNIX_OFFSET_S, ulNtpTime >> 32);
+    EXPECT_EQ(0x40000000U, static_cast<uint32_t>(ulNtpTime));
+    EXPECT_EQ(ulWallClockUs, DmdNtpToUs(ulNtpTime));
+    EXPECT_EQ(ulWallClockUs + 1, DmdNtpToUs(DmdNtpFromUs(ulWallClockUs + 1)));
+    EXPECT_EQ(0x8000U, DmdNtpCompactFromUs(500000));
+    EXPECT_EQ(500000U, DmdNtpCompactToUs(0x8000));
+}
+
+TEST_F(CDmdRtcpReportTest, ReceiverLossAndJitter) {
+    CDmdRtcpReceiver rtcpReceiver;
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.Init(receiverParam));
+
+    // 100 packets over the sequence wrap, one frame each 10ms, every
+    // tenth lost, and constant transit: no jitter;
+    uint64_t ulNowUs = 1000000;
+    for (int i = 0; i < 100; i++) {
+        if (i % 10 == 5) {
+            continue;
+        }
+        uint64_t ulCaptureUs = ulNowUs + i * 10000;
+        rtcpReceiver.OnPacket(static_cast<uint16_t>(65500 + i),
+                timestampOf(ulCaptureUs), 1000, ulCaptureUs + 30000);
+    }
+    ulNowUs += 100 * 10000 + 30000;
+
+    uint8_t buffer[64];
+    size_t ulSize = 0;
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.BuildReport(ulNowUs, buffer,
+                sizeof(buffer), &ulSize));
+    vector<DmdRtcpReport> vecReports;
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseReports(buffer, ulSize, &vecReports));
+    ASSERT_EQ(1U, vecReports.size());
+    EXPECT_EQ(DMD_RTCP_PT_RR, vecReports[0].iPacketType);
+    ASSERT_EQ(1U, vecReports[0].vecBlocks.size());
+    DmdRtcpReportBlock block = vecReports[0].vecBlocks[0];
+    EXPECT_EQ(senderParam.iSsrc, block.iSsrc);
+    EXPECT_EQ(10, block.iCumulativeLost);
+    EXPECT_EQ(256 * 10 / 100, block.iFractionLost);
+    EXPECT_EQ(0x10000U + (65500 + 99 - 65536), block.iExtHighestSeq);
+    EXPECT_EQ(0U, block.iJitter);
+    // no sender report yet;
+    EXPECT_EQ(0U, block.iLastSr);
+    EXPECT_EQ(0U, block.iDelaySinceLastSr);
+
+    // no loss, but arrivals alternate 4ms early and late;
+    for (int i = 100; i < 200; i++) {
+        uint64_t ulCaptureUs = 1000000 + i * 10000;
+        uint64_t ulArrivalUs = ulCaptureUs + 30000 + (i % 2 ? 4000 : 0);
+        rtcpReceiver.OnPacket(static_cast<uint16_t>(65500 + i),
+                timestampOf(ulCaptureUs), 1000, ulArrivalUs);
+    }
+    ulNowUs += 1000000;
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.BuildReport(ulNowUs, buffer,
+                sizeof(buffer), &ulSize));
+    vecReports.clear();
+    ASSERT_EQ(DMD_S_OK, DmdRtcpParseReports(buffer, ulSize, &vecReports));
+    block = vecReports[0].vecBlocks[0];
+    EXPECT_EQ(0, block.iFractionLost);
+    EXPECT_EQ(10, block.iCumulativeLost);
+    // converges on the 4ms, 360 ticks, swing;
+    EXPECT_NEAR(360, static_cast<int>(block.iJitter), 10);
+
+    DmdRtcpReceiverStats stats;
+    rtcpReceiver.GetStats(&stats);
+    EXPECT_EQ(190U, stats.ulReceivedCount);
+    EXPECT_EQ(10, stats.lLostCount);
+    EXPECT_NEAR(4000, static_cast<int>(stats.ulJitterUs), 120);
+    EXPECT_EQ(2U, stats.ulReportCount);
+}
+
+TEST_F(CDmdRtcpReportTest, RoundTripAndFeedback) {
+    CDmdRtcpSender rtcpSender;
+    CDmdRtcpReceiver rtcpReceiver;
+    CDmdFeedbackRecorder feedbackRecorder;
+    ASSERT_EQ(DMD_S_OK, rtcpSender.Init(senderParam));
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.Init(receiverParam));
+    rtcpSender.SetFeedbackSink(&feedbackRecorder);
+
+    // 20 packets, one in four lost on the way; one way delay 25ms;
+    uint8_t payload[1000 + DMD_RTP_HEADER_SIZE];
+    struct iovec iov = {payload, sizeof(payload)};
+    uint64_t ulNowUs = 5000000;
+    for (int i = 0; i < 20; i++) {
+        uint64_t ulCaptureUs = ulNowUs + i * 5000;
+        DmdRtpPacket packet;
+        memset(&packet, 0, sizeof(packet));
+        packet.pIov = &iov;
+        packet.iIovCount = 1;
+        packet.ulSize = sizeof(payload);
+        packet.iSequence = static_cast<uint16_t>(i);
+        packet.iTimestamp = timestampOf(ulCaptureUs);
+        rtcpSender.OnPacketsSent(&packet, 1);
+        if (i % 4 != 2) {
+            rtcpReceiver.OnPacket(packet.iSequence, packet.iTimestamp,
+                    packet.ulSize, ulCaptureUs + 25000);
+        }
+    }
+    ulNowUs += 100000;
+
+    uint8_t buffer[64];
+    size_t ulSize = 0;
+    ASSERT_TRUE(rtcpSender.IsReportDue(ulNowUs));
+    ASSERT_EQ(DMD_S_OK, rtcpSender.BuildReport(ulNowUs, buffer,
+                sizeof(buffer), &ulSize));
+    EXPECT_EQ(28U, ulSize);
+    EXPECT_FALSE(rtcpSender.IsReportDue(ulNowUs + 1000));
+    uint64_t ulReportNtpUs = DmdNtpToUs(rtcpSender.GetNtpTime(ulNowUs));
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.OnRtcp(buffer, ulSize, ulNowUs + 25000));
+
+    // the receiver maps rtp timestamps back to the sender's wall clock;
+    uint64_t ulCaptureWallUs = 0;
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.GetCaptureTimeUs(
+                timestampOf(ulNowUs - 40000), &ulCaptureWallUs));
+    EXPECT_NEAR(static_cast<double>(ulReportNtpUs - 40000),
+            static_cast<double>(ulCaptureWallUs), 20);
+
+    // held 40ms by the receiver, 25ms back: 50ms round trip;
+    ASSERT_EQ(DMD_S_OK, rtcpReceiver.BuildReport(ulNowUs + 65000, buffer,
+                sizeof(buffer), &ulSize));
+    ASSERT_EQ(DMD_S_OK, rtcpSender.OnRtcp(buffer, ulSize, ulNowUs + 90000));
+
+    DmdRtcpSenderStats stats;
+    rtcpSender.GetStats(&stats);
+    EXPECT_EQ(20U, stats.ulPacketCount);
+    EXPECT_EQ(20000U, stats.ulOctetCount);
+    EXPECT_EQ(1U, stats.ulReceiverReportCount);
+    EXPECT_NEAR(50000, static_cast<int>(stats.ulRttUs), 50);
+    EXPECT_EQ(5, stats.iCumulativeLost);
+    EXPECT_NEAR(0.25f, stats.fLossRate, 0.01f);
+
+    ASSERT_EQ(1U, feedbackRecorder.feedbacks.size());
+    const DmdTransportFeedback &transportFeedback =
+        feedbackRecorder.feedbacks[0];
+    EXPECT_EQ(ulNowUs + 90000, transportFeedback.ulTimestampUs);
+    EXPECT_EQ(stats.ulRttUs, transportFeedback.ulRttUs);
+    EXPECT_FLOAT_EQ(stats.fLossRate, transportFeedback.fLossRate);
+    EXPECT_EQ(0U, transportFeedback.ulQueueBytes);
+
+    // reports about other ssrcs are not ours;
+    DmdRtcpReportBlock otherBlock = {0x9999, 128, 1, 1, 1, 1, 1};
+    ASSERT_EQ(DMD_S_OK, DmdRtcpWriteReport(0x5678, NULL, &otherBlock, 1,
+                buffer, sizeof(buffer), &ulSize));
+    ASSERT_EQ(DMD_S_OK, rtcpSender.OnRtcp(buffer, ulSize, ulNowUs + 100000));
+    EXPECT_EQ(1U, feedbackRecorder.feedbacks.size());
+}
+
+TEST_F(CDmdRtcpReportTest, IntervalScalesWithBandwidth) {
+    // unknown rate, and fast links, get the minimum;
+    EXPECT_EQ(500000U, DmdRtcpReportIntervalUs(100, 0, 0.05f, 500000));
+    EXPECT_EQ(500000U, DmdRtcpReportIntervalUs(100, 10000000, 0.05f,
+                500000));
+    // 800 bits at 5% of 16kbps take a second;
+    EXPECT_EQ(1000000U, DmdRtcpReportIntervalUs(100, 16000, 0.05f, 500000));
+    EXPECT_EQ(2000000U, DmdRtcpReportIntervalUs(100, 8000, 0.05f, 500000));
+
+    // a sender at 8kbps, 20 byte payloads every 20ms, stays under 5% for
+    // its 56 byte sender reports on the wire;
+    CDmdRtcpSender rtcpSender;
+    ASSERT_EQ(DMD_S_OK, rtcpSender.Init(senderParam));
+    uint8_t payload[20];
+    struct iovec iov = {payload, sizeof(payload)};
+    DmdRtpPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.pIov = &iov;
+    packet.iIovCount = 1;
+    packet.ulSize = sizeof(payload);
+
+    uint8_t buffer[64];
+    size_t ulSize = 0;
+    uint64_t ulRtcpBytes = 0;
+    uint64_t ulMediaBytes = 0;
+    for (uint64_t ulNowUs = 1000000; ulNowUs < 61000000; ulNowUs += 20000) {
+        rtcpSender.OnPacketsSent(&packet, 1);
+        ulMediaBytes += packet.ulSize;
+        if (rtcpSender.IsReportDue(ulNowUs)) {
+            ASSERT_EQ(DMD_S_OK, rtcpSender.BuildReport(ulNowUs, buffer,
+                        sizeof(buffer), &ulSize));
+            ulRtcpBytes += ulSize + DMD_RTCP_WIRE_OVERHEAD;
+        }
+    }
+    DmdRtcpSenderStats stats;
+    rtcpSender.GetStats(&stats);
+    EXPECT_EQ(8000U, stats.ulSendRateBps);
+    EXPECT_LT(ulRtcpBytes * 100, ulMediaBytes * 6);
+    EXPECT_GT(stats.ulReportCount, 20U);
+}
@@ -0,0 +1,325 @@
+/*
+ ============================================================================
+ * Name        : CDmdRtpPacketizerTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of rtp h.264 packetizer.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "CDmdColorConvert.h"
+#include "CDmdEncodeEngine.h"
+#include "CDmdRtpPacketizer.h"
+#include "DmdRtp.h"
+
+#include "CDmdEncodedKeeper.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdRtpPacketizerTest : public testing::Test {
+public:
+    CDmdRtpPacketizerTest() {
+        memset(&param, 0, sizeof(param));
+        param.iSsrc = 0x12345678;
+        param.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+        param.ulMtu = DMD_RTP_DEFAULT_MTU;
+        param.iFirstSequence = 65534;  // wraps within the test;
+        param.iTimestampOffset = 1000;
+        param.bAggregate = true;
+        memset(&frame, 0, sizeof(frame));
+        frame.eFrameType = DmdFrameIDR;
+        frame.ulTimestamp = 1000000;
+    }
+
+    virtual ~CDmdRtpPacketizerTest() {}
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    // nal units of the given sizes, each starting with its nal header;
+    void makeFrame(const vector<size_t> &vecSizes) {
+        nals.clear();
+        for (size_t i = 0; i < vecSizes.size(); i++) {
+            vector<uint8_t> nal(vecSizes[i]);
+            for (size_t j = 0; j < nal.size(); j++) {
+                nal[j] = static_cast<uint8_t>(j * 7 + i);
+            }
+            nal[0] = static_cast<uint8_t>(0x60 | (i ? 5 : 7));
+            nals.push_back(nal);
+        }
+        iovs.resize(nals.size());
+        for (size_t i = 0; i < nals.size(); i++) {
+            iovs[i].iov_base = &nals[i][0];
+            iovs[i].iov_len = nals[i].size();
+        }
+        frame.iNalCount = static_cast<unsigned int>(nals.size());
+        frame.pNalIov = &iovs[0];
+    }
+
+    static vector<uint8_t> flatten(const DmdRtpPacket &packet) {
+        vector<uint8_t> bytes;
+        for (unsigned int i = 0; i < packet.iIovCount; i++) {
+            const uint8_t *pData =
+                static_cast<const uint8_t *>(packet.pIov[i].iov_base);
+            bytes.insert(bytes.end(), pData, pData + packet.pIov[i].iov_len);
+        }
+        return bytes;
+    }
+
+    // rfc 6184 receiver side, back to whole nal units;
+    static vector<vector<uint8_t> > depacketize(const DmdRtpPacket *pPackets,
+            unsigned int iCount) {
+        vector<vector<uint8_t> > result;
+        for (unsigned int i = 0; i < iCount; i++) {
+            vector<uint8_t> bytes = flatten(pPackets[i]);
+            DmdRtpHeader header;
+            size_t ulHeaderSize = 0;
+            EXPECT_EQ(DMD_S_OK, DmdRtpParseHeader(&bytes[0], bytes.size(),
+                        &header, &ulHeaderSize));
+            const uint8_t *pPayload = &bytes[ulHeaderSize];
+            size_t ulSize = bytes.size() - ulHeaderSize;
+            int iType = pPayload[0] & DMD_H264_NAL_TYPE_MASK;
+            if (DMD_H264_NAL_STAP_A == iType) {
+                size_t ulPos = 1;
+                while (ulPos + 2 <= ulSize) {
+                    size_t ulLen = (pPayload[ulPos] << 8) | pPayload[ulPos + 1];
+                    ulPos += 2;
+                    result.push_back(vector<uint8_t>(pPayload + ulPos,
+                                pPayload + ulPos + ulLen));
+                    ulPos += ulLen;
+                }
+                EXPECT_EQ(ulSize, ulPos);
+            } else if (DMD_H264_NAL_FU_A == iType) {
+                if (pPayload[1] & DMD_H264_FU_START) {
+                    result.push_back(vector<uint8_t>(1,
+                                (pPayload[0] & 0xe0) | (pPayload[1] & 0x1f)));
+                }
+                result.back().insert(result.back().end(), pPayload + 2,
+                        pPayload + ulSize);
+            } else {
+                result.push_back(vector<uint8_t>(pPayload, pPayload + ulSize));
+            }
+        }
+        return result;
+    }
+
+public:
+    DmdRtpPacketizerParam param;
+    DmdEncodedFrame frame;
+    vector<vector<uint8_t> > nals;
+    vector<struct iovec> iovs;
+};
+
+TEST_F(CDmdRtpPacketizerTest, HeaderRoundTrip) {
+    DmdRtpHeader header = {true, 96, 0xfffe, 0x89abcdef, 0x01020304};
+    uint8_t buffer[DMD_RTP_HEADER_SIZE];
+    DmdRtpWriteHeader(header, buffer);
+    EXPECT_EQ(0x80, buffer[0]);
+    EXPECT_EQ(0x80 | 96, buffer[1]);
+
+    DmdRtpHeader parsed;
+    size_t ulHeaderSize = 0;
+    EXPECT_EQ(DMD_S_OK, DmdRtpParseHeader(buffer, sizeof(buffer), &parsed,
+                &ulHeaderSize));
+    EXPECT_EQ(12U, ulHeaderSize);
+    EXPECT_TRUE(parsed.bMarker);
+    EXPECT_EQ(96, parsed.iPayloadType);
+    EXPECT_EQ(0xfffe, parsed.iSequence);
+    EXPECT_EQ(0x89abcdefU, parsed.iTimestamp);
+    EXPECT_EQ(0x01020304U, parsed.iSsrc);
+    EXPECT_EQ(DMD_S_FAIL, DmdRtpParseHeader(buffer, 11, &parsed, NULL));
+    EXPECT_EQ(90000U, DmdRtpTimestamp(1000000, DMD_RTP_H264_CLOCK_RATE));
+}
+
+TEST_F(CDmdRtpPacketizerTest, SingleNalWithoutCopy) {
+    param.bAggregate = false;
+    CDmdRtpPacketizer packetizer;
+    ASSERT_EQ(DMD_S_OK, packetizer.Init(param));
+    vector<size_t> vecSizes;
+    vecSizes.push_back(12);
+    vecSizes.push_back(4);
+    vecSizes.push_back(900);
+    makeFrame(vecSizes);
+
+    const DmdRtpPacket *pPackets = NULL;
+    unsigned int iCount = 0;
+    ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&frame, &pPackets, &iCount));
+    ASSERT_EQ(3U, iCount);
+    for (unsigned int i = 0; i < iCount; i++) {
+        // the payload is the nal itself, referenced;
+        ASSERT_EQ(2U, pPackets[i].iIovCount);
+        EXPECT_EQ(iovs[i].iov_base, pPackets[i].pIov[1].iov_base);
+        EXPECT_EQ(12U + nals[i].size(), pPackets[i].ulSize);
+        EXPECT_EQ(static_cast<uint16_t>(65534 + i), pPackets[i].iSequence);
+        EXPECT_EQ(90000U + 1000U, pPackets[i].iTimestamp);
+        EXPECT_EQ(2 == i, pPackets[i].bMarker);
+
+        vector<uint8_t> bytes = flatten(pPackets[i]);
+        DmdRtpHeader header;
+        EXPECT_EQ(DMD_S_OK, DmdRtpParseHeader(&bytes[0], bytes.size(),
+                    &header, NULL));
+        EXPECT_EQ(2 == i, header.bMarker);
+        EXPECT_EQ(param.iSsrc, header.iSsrc);
+    }
+    EXPECT_EQ(1, packetizer.GetNextSequence());
+    EXPECT_TRUE(depacketize(pPackets, iCount) == nals);
+
+    // a skipped frame has nothing to send;
+    DmdEncodedFrame skipped;
+    memset(&skipped, 0, sizeof(skipped));
+    skipped.eFrameType = DmdFrameSkip;
+    ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&skipped, &pPackets, &iCount));
+    EXPECT_EQ(0U, iCount);
+    EXPECT_EQ(1, packetizer.GetNextSequence());
+}
+
+TEST_F(CDmdRtpPacketizerTest, StapAThenFuA) {
+    CDmdRtpPacketizer packetizer;
+    ASSERT_EQ(DMD_S_OK, packetizer.Init(param));
+    // sps, pps, and a slice too large for one packet;
+    vector<size_t> vecSizes;
+    vecSizes.push_back(14);
+    vecSizes.push_back(4);
+    vecSizes.push_back(5000);
+    makeFrame(vecSizes);
+
+    const DmdRtpPacket *pPackets = NULL;
+    unsigned int iCount = 0;
+    ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&frame, &pPackets, &iCount));
+    ASSERT_EQ(6U, iCount);
+    vector<uint8_t> first = flatten(pPackets[0]);
+    EXPECT_EQ(0x60 | DMD_H264_NAL_STAP_A, first[12]);
+    EXPECT_EQ(12U + 1 + 2 + 14 + 2 + 4, first.size());
+
+    size_t ulMin = param.ulMtu;
+    size_t ulMax = 0;
+    for (unsigned int i = 1; i < iCount; i++) {
+        vector<uint8_t> bytes = flatten(pPackets[i]);
+        EXPECT_LE(bytes.size(), param.ulMtu);
+        EXPECT_EQ(DMD_H264_NAL_FU_A, bytes[12] & DMD_H264_NAL_TYPE_MASK);
+        EXPECT_EQ(1 == i, 0 != (bytes[13] & DMD_H264_FU_START));
+        EXPECT_EQ(iCount - 1 == i, 0 != (bytes[13] & DMD_H264_FU_END));
+        ulMin = std::min(ulMin, bytes.size());
+        ulMax = std::max(ulMax, bytes.size());
+    }
+    // fragments are even, no runt at the end;
+    EXPECT_LE(ulMax - ulMin, 1U);
+    EXPECT_TRUE(depacketize(pPackets, iCount) == nals);
+
+    DmdRtpPacketizerStats stats;
+    packetizer.GetStats(&stats);
+    EXPECT_EQ(1U, stats.ulStapACount);
+    EXPECT_EQ(5U, stats.ulFuACount);
+    EXPECT_EQ(6U, stats.ulPacketCount);
+}
+
+TEST_F(CDmdRtpPacketizerTest, EncodedStreamRoundTrip) {
+    unsigned int iWidth = 320;
+    unsigned int iHeight = 192;
+    vector<uint8_t> buffer(DmdI420FrameSize(iWidth, iHeight));
+    DmdVideoRawData videoRawData;
+    memset(&videoRawData, 0, sizeof(videoRawData));
+    DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+
+    DmdEncodeParam encodeParam;
+    memset(&encodeParam, 0, sizeof(encodeParam));
+    encodeParam.fFrameRate = DMD_ENCODE_DEFAULT_FRAMERATE;
+    encodeParam.iTargetBitrate = 2 * 1024 * 1024;
+    encodeParam.eRcMode = DmdRcBitrate;
+    encodeParam.eComplexity = DmdComplexityLow;
+    encodeParam.iThreadCount = 1;
+    encodeParam.iSliceCount = 2;
+
+    IDmdEncodeEngine *pEngine = NULL;
+    CDmdEncodedKeeper keeper;
+    ASSERT_EQ(DMD_S_OK, CreateVideoEncodeEngine(&pEngine));
+    pEngine->SetDataSink(&keeper);
+    ASSERT_EQ(DMD_S_OK, pEngine->Init(encodeParam));
+    for (unsigned int i = 0; i < 5; i++) {
+        for (size_t j = 0; j < buffer.size(); j++) {
+            buffer[j] = static_cast<uint8_t>((j * 13 + i * 5) ^ (j >> 7));
+        }
+        videoRawData.fmtVideoFormat.ulTimestamp = i * 33333;
+        EXPECT_EQ(DMD_S_OK, pEngine->EncodeFrame(&videoRawData));
+    }
+    pEngine->Uninit();
+    ReleaseVideoEncodeEngine(&pEngine);
+    ASSERT_FALSE(keeper.frames.empty());
+
+    CDmdRtpPacketizer packetizer;
+    ASSERT_EQ(DMD_S_OK, packetizer.Init(param));
+    for (size_t f = 0; f < keeper.frames.size(); f++) {
+        const DmdEncodedFrame &encoded = keeper.frames[f];
+        const DmdRtpPacket *pPackets = NULL;
+        unsigned int iCount = 0;
+        ASSERT_EQ(DMD_S_OK, packetizer.Packetize(&encoded, &pPackets,
+                    &iCount));
+        ASSERT_GT(iCount, 0U);
+
+        vector<vector<uint8_t> > expected;
+        for (unsigned int i = 0; i < encoded.iNalCount; i++) {
+            const uint8_t *pNal =
+                static_cast<const uint8_t *>(encoded.pNalIov[i].iov_base);
+            expected.push_back(vector<uint8_t>(pNal,
+                        pNal + encoded.pNalIov[i].iov_len));
+        }
+        EXPECT_TRUE(depacketize(pPackets, iCount) == expected);
+
+        // payload iovecs point into the encoder's buffer;
+        const uint8_t *pBegin = encoded.pData;
+        const uint8_t *pEnd = encoded.pData + encoded.ulDataLen;
+        for (unsigned int i = 0; i < iCount; i++) {
+            EXPECT_LE(pPackets[i].ulSize, param.ulMtu);
+            EXPECT_EQ(encoded.pFrameBuffer, pPackets[i].pFrameBuffer);
+            const struct iovec &payload =
+                pPackets[i].pIov[pPackets[i].iIovCount - 1];
+            const uint8_t *pPayload =
+                static_cast<const uint8_t *>(payload.iov_base);
+            EXPECT_TRUE(pPayload >= pBegin && pPayload + payload.iov_len
+                    <= pEnd);
+        }
+    }
+    DmdRtpPacketizerStats stats;
+    packetizer.GetStats(&stats);
+    EXPECT_GT(stats.ulFuACount, 0U);
+    EXPECT_GT(stats.ulStapACount, 0U);
+}
@@ -0,0 +1,312 @@
+/*
+ ============================================================================
+ * Name        : CDmdShmRingTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of the shared memory loopback transport.
+ ============================================================================
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "IDmdEncodeEngine.h"
+#include "CDmdShmFrameSender.h"
+#include "CDmdShmRing.h"
+#include "DmdSocketUtils.h"
+
+using namespace opendmd;
+using std::vector;
+
+static void fillPattern(vector<uint8_t> *pBytes, unsigned int iSeed) {
+    for (size_t i = 0; i < pBytes->size(); i++) {
+        (*pBytes)[i] = static_cast<uint8_t>(i * 7 + iSeed);
+    }
+}
+
+static bool checkPattern(const uint8_t *pData, size_t ulSize,
+        unsigned int iSeed) {
+    for (size_t i = 0; i < ulSize; i++) {
+        if (pData[i] != static_cast<uint8_t>(i * 7 + iSeed)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class CDmdShmRingTest : public testing::Test {
+public:
+    CDmdShmRingTest() {
+        arrSockets[0] = -1;
+        arrSockets[1] = -1;
+    }
+    virtual ~CDmdShmRingTest() {}
+    virtual void SetUp() {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_SEQPACKET, 0, arrSockets));
+    }
+    virtual void TearDown() {
+        close(arrSockets[0]);
+        close(arrSockets[1]);
+    }
+
+    // iSeed picks the pattern, the frame type and the timestamp;
+    DmdEncodedFrame makeFrame(vector<uint8_t> *pBytes, unsigned int iSeed) {
+        fillPattern(pBytes, iSeed);
+        DmdEncodedFrame encodedFrame;
+        memset(&encodedFrame, 0, sizeof(encodedFrame));
+        encodedFrame.pData = pBytes->data();
+        encodedFrame.ulDataLen = pBytes->size();
+        encodedFrame.eFrameType = iSeed % 10 ? DmdFrameP : DmdFrameIDR;
+        encodedFrame.iWidth = 640;
+        encodedFrame.iHeight = 360;
+        encodedFrame.ulTimestamp = 1000 + iSeed * 33333ULL;
+        encodedFrame.eLayer = DmdLayerDetect;
+        return encodedFrame;
+    }
+
+public:
+    int arrSockets[2];
+};
+
+TEST_F(CDmdShmRingTest, WrapsAndDropsWhenFull) {
+    CDmdShmRing producer;
+    CDmdShmRing consumer;
+    ASSERT_EQ(DMD_S_OK, producer.Create(4000));
+    EXPECT_EQ(4096U, producer.GetCapacity());
+    // the same pages mapped a second time, as the server would;
+    ASSERT_EQ(DMD_S_OK, producer.Offer(arrSockets[0]));
+    ASSERT_EQ(DMD_S_OK, consumer.Accept(arrSockets[1]));
+    EXPECT_EQ(4096U, consumer.GetCapacity());
+    EXPECT_TRUE(consumer.IsEmpty());
+
+    CDmdShmFrameSender frameSender;
+    ASSERT_EQ(DMD_S_OK, frameSender.Init(&producer));
+    // sizes that leave odd tails, so that records wrap many times;
+    unsigned int iRead = 0;
+    for (unsigned int i = 0; i < 200; i++) {
+        vector<uint8_t> bytes(100 + (i * 97) % 1700);
+        DmdEncodedFrame encodedFrame = makeFrame(&bytes, i);
+        ASSERT_EQ(DMD_S_OK, frameSender.DeliverEncodedData(&encodedFrame));
+
+        const DmdShmRecord *pRecord = NULL;
+        const uint8_t *pData = NULL;
+        ASSERT_EQ(DMD_S_OK, consumer.Peek(&pRecord, &pData));
+        EXPECT_EQ(DmdShmRecordEncoded, pRecord->iType);
+        ASSERT_EQ(bytes.size(), pRecord->iSize);
+        EXPECT_TRUE(checkPattern(pData, pRecord->iSize, i));
+        EXPECT_EQ(encodedFrame.ulTimestamp, pRecord->ulTimestamp);
+        EXPECT_EQ(static_cast<uint32_t>(encodedFrame.eFrameType),
+                pRecord->iFormat);
+        EXPECT_EQ(static_cast<uint32_t>(DmdLayerDetect), pRecord->iLayer);
+        EXPECT_EQ(640U, pRecord->iWidth);
+        consumer.Release();
+        iRead++;
+    }
+    EXPECT_EQ(200U, iRead);
+    EXPECT_TRUE(consumer.IsEmpty());
+
+    // nobody reads: the ring fills up and frames are dropped, not blocked;
+    vector<uint8_t> bytes(1000);
+    unsigned int iWritten = 0;
+    for (unsigned int i = 0; i < 10; i++) {
+        DmdEncodedFrame encodedFrame = makeFrame(&bytes, i);
+        if (DMD_S_OK == frameSender.DeliverEncodedData(&encodedFrame)) {
+            iWritten++;
+        }
+    }
+    EXPECT_EQ(3U, iWritten);
+    DmdShmFrameSenderStats senderStats;
+    frameSender.GetStats(&senderStats);
+    EXPECT_EQ(7U, senderStats.ulDroppedCount);
+    // larger than half the ring never fits;
+    uint8_t *pData = NULL;
+    EXPECT_EQ(DMD_S_FAIL, producer.Reserve(3000, &pData));
+
+    for (unsigned int i = 0; i < iWritten; i++) {
+        const DmdShmRecord *pRecord = NULL;
+        const uint8_t *pRecordData = NULL;
+        ASSERT_EQ(DMD_S_OK, consumer.Peek(&pRecord, &pRecordData));
+        EXPECT_TRUE(checkPattern(pRecordData, pRecord->iSize, i));
+        consumer.Release();
+    }
+    EXPECT_TRUE(consumer.IsEmpty());
+
+    // a record larger than its reservation would run over the next one;
+    DmdShmRecord record;
+    memset(&record, 0, sizeof(record));
+    record.iType = DmdShmRecordEncoded;
+    record.iSize = 200;
+    ASSERT_EQ(DMD_S_OK, producer.Reserve(100, &pData));
+    EXPECT_EQ(DMD_S_FAIL, producer.Commit(record));
+    EXPECT_TRUE(consumer.IsEmpty());
+    record.iSize = 100;
+    ASSERT_EQ(DMD_S_OK, producer.Reserve(100, &pData));
+    EXPECT_EQ(DMD_S_OK, producer.Commit(record));
+    EXPECT_FALSE(consumer.IsEmpty());
+    // the reader never slept, so the writer never signalled;
+    DmdShmRingStats ringStats;
+    producer.GetStats(&ringStats);
+    EXPECT_EQ(0U, ringStats.ulSignalCount);
+}
+
+TEST_F(CDmdShmRingTest, RawFrame) {
+    CDmdShmRing producer;
+    CDmdShmRing consumer;
+    ASSERT_EQ(DMD_S_OK, producer.Create(64 * 1024));
+    ASSERT_EQ(DMD_S_OK, producer.Offer(arrSockets[0]));
+    ASSERT_EQ(DMD_S_OK, consumer.Accept(arrSockets[1]));
+    CDmdShmFrameSender frameSender;
+    ASSERT_EQ(DMD_S_OK, frameSender.Init(&producer));
+
+    // a 64x32 nv12 frame, strides wider than the rows;
+    vector<uint8_t> luma(80 * 32);
+    vector<uint8_t> chroma(80 * 16);
+    fillPattern(&luma, 1);
+    fillPattern(&chroma, 2);
+    DmdVideoRawData rawData;
+    memset(&rawData, 0, sizeof(rawData));
+    rawData.pSrcDataPanel[0] = luma.data();
+    rawData.pSrcDataPanel[1] = chroma.data();
+    rawData.ulSrcDataStride[0] = 80;
+    rawData.ulSrcDataStride[1] = 80;
+    rawData.ulSrcDataLength[0] = luma.size();
+    rawData.ulSrcDataLength[1] = chroma.size();
+    rawData.ulPlaneCount = 2;
+    rawData.fmtVideoFormat.eVideoType = DmdNV12;
+    rawData.fmtVideoFormat.iWidth = 64;
+    rawData.fmtVideoFormat.iHeight = 32;
+    rawData.fmtVideoFormat.ulTimestamp = 12345;
+    rawData.ulFrameFlags = DMD_FRAME_FLAG_MOTION;
+    ASSERT_EQ(DMD_S_OK, frameSender.DeliverVideoData(&rawData));
+
+    const DmdShmRecord *pRecord = NULL;
+    const uint8_t *pData = NULL;
+    ASSERT_EQ(DMD_S_OK, consumer.Wait(0));
+    ASSERT_EQ(DMD_S_OK, consumer.Peek(&pRecord, &pData));
+    EXPECT_EQ(DmdShmRecordRaw, pRecord->iType);
+    EXPECT_EQ(static_cast<uint32_t>(DmdNV12), pRecord->iFormat);
+    EXPECT_EQ(12345U, pRecord->ulTimestamp);
+    EXPECT_EQ(static_cast<uint32_t>(DMD_FRAME_FLAG_MOTION),
+            pRecord->iFlags);
+    ASSERT_EQ(2U, pRecord->iPlaneCount);
+    EXPECT_EQ(80U, pRecord->arrStride[1]);
+    ASSERT_EQ(luma.size(), pRecord->arrPlaneSize[0]);
+    EXPECT_TRUE(checkPattern(pData, pRecord->arrPlaneSize[0], 1));
+    EXPECT_TRUE(checkPattern(pData + pRecord->arrPlaneSize[0],
+                pRecord->arrPlaneSize[1], 2));
+    consumer.Release();
+    EXPECT_EQ(DMD_S_FAIL, consumer.Wait(0));
+}
+
+// client and server in two processes, the server asleep on the eventfd;
+TEST_F(CDmdShmRingTest, AcrossProcesses) {
+    const unsigned int iFrameCount = 300;
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (0 == pid) {
+        CDmdShmRing consumer;
+        if (DMD_S_OK != consumer.Accept(arrSockets[1])) {
+            _exit(2);
+        }
+        unsigned int iNext = 0;
+        while (iNext < iFrameCount) {
+            if (DMD_S_OK != consumer.Wait(5000)) {
+                _exit(3);
+            }
+            const DmdShmRecord *pRecord = NULL;
+            const uint8_t *pData = NULL;
+            while (DMD_S_OK == consumer.Peek(&pRecord, &pData)) {
+                // frames in order, none lost, none torn;
+                if (pRecord->ulTimestamp != 1000 + iNext * 33333ULL
+                        || !checkPattern(pData, pRecord->iSize, iNext)) {
+                    _exit(4);
+                }
+                consumer.Release();
+                iNext++;
+            }
+        }
+        _exit(0);
+    }
+
+    CDmdShmRing producer;
+    ASSERT_EQ(DMD_S_OK, producer.Create(1024 * 1024));
+    ASSERT_EQ(DMD_S_OK, producer.Offer(arrSockets[0]));
+    CDmdShmFrameSender frameSender;
+    ASSERT_EQ(DMD_S_OK, frameSender.Init(&producer));
+    for (unsigned int i = 0; i < iFrameCount; i++) {
+        vector<uint8_t> bytes(500 + (i * 1231) % 20000);
+        DmdEncodedFrame encodedFrame = makeFrame(&bytes, i);
+        // the ring holds many frames, the server keeps up;
+        while (DMD_S_OK != frameSender.DeliverEncodedData(&encodedFrame)) {
+            usleep(100);
+        }
+        if (i % 50 == 0) {
+            usleep(2000);
+        }
+    }
+
+    int iStatus = -1;
+    ASSERT_EQ(pid, waitpid(pid, &iStatus, 0));
+    ASSERT_TRUE(WIFEXITED(iStatus));
+    EXPECT_EQ(0, WEXITSTATUS(iStatus));
+    // it slept at least once, and was woken;
+    DmdShmRingStats ringStats;
+    producer.GetStats(&ringStats);
+    EXPECT_GT(ringStats.ulSignalCount, 0U);
+}
+
+TEST_F(CDmdShmRingTest, SelectsTransport) {
+    DmdTransportType eType = DmdTransportUdp;
+    ASSERT_EQ(DMD_S_OK, DmdSelectTransport("127.0.0.1", &eType));
+    EXPECT_EQ(DmdTransportShm, eType);
+
+    struct sockaddr_storage addr;
+    socklen_t iAddrLen = 0;
+    ASSERT_EQ(DMD_S_OK, DmdResolveAddress("::1", 0, &addr, &iAddrLen));
+    EXPECT_TRUE(DmdIsLocalAddress(addr));
+    // documentation range, never one of ours;
+    ASSERT_EQ(DMD_S_OK, DmdResolveAddress("192.0.2.1", 0, &addr,
+                &iAddrLen));
+    EXPECT_FALSE(DmdIsLocalAddress(addr));
+    ASSERT_EQ(DMD_S_OK, DmdSelectTransport("192.0.2.1", &eType));
+    EXPECT_EQ(DmdTransportUdp, eType);
+}
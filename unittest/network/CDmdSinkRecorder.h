@@ -0,0 +1,79 @@
+/*
+ ============================================================================
+ * Name        : CDmdSinkRecorder.h
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : rtp packet sink recorder shared by network unittests.
+ ============================================================================
+ */
+
+#ifndef UNITTEST_NETWORK_CDMDSINKRECORDER_H
+#define UNITTEST_NETWORK_CDMDSINKRECORDER_H
+
+#include <map>
+#include <vector>
+
+#include "DmdRtp.h"
+
+namespace opendmd {
+
+// the bytes of a packet, its iovecs joined;
+inline std::vector<uint8_t> flattenPacket(const DmdRtpPacket &packet) {
+    std::vector<uint8_t> bytes;
+    for (unsigned int i = 0; i < packet.iIovCount; i++) {
+        const uint8_t *pData =
+            static_cast<const uint8_t *>(packet.pIov[i].iov_base);
+        bytes.insert(bytes.end(), pData, pData + packet.pIov[i].iov_len);
+    }
+    return bytes;
+}
+
+// what a packet sink is given, in order and by sequence number;
+class CDmdSinkRecorder : public IDmdRtpPacketSink {
+public:
+    DMD_RESULT SendPackets(const DmdRtpPacket *pPackets,
+            unsigned int iPacketCount, unsigned int *piSentCount) {
+        for (unsigned int i = 0; i < iPacketCount; i++) {
+            packets.push_back(flattenPacket(pPackets[i]));
+            sequencePackets[pPackets[i].iSequence] = packets.back();
+        }
+        *piSentCount = iPacketCount;
+        return DMD_S_OK;
+    }
+    std::vector<std::vector<uint8_t> > packets;
+    std::map<uint16_t, std::vector<uint8_t> > sequencePackets;
+};
+
+}  // namespace opendmd
+
+#endif  // UNITTEST_NETWORK_CDMDSINKRECORDER_H
@@ -0,0 +1,259 @@
+/*
+ ============================================================================
+ * Name        : CDmdSsrcDemuxerTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of ssrc demultiplexer.
+ ============================================================================
+ */
+
+#include <netinet/in.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdRtpPacketizer.h"
+#include "CDmdSsrcDemuxer.h"
+#include "CDmdUdpReceiver.h"
+#include "CDmdUdpSender.h"
+#include "DmdRtcp.h"
+#include "DmdRtp.h"
+#include "DmdSocketUtils.h"
+
+using namespace opendmd;
+using std::vector;
+
+// keeps the ssrc of every datagram, and the runs it was given;
+class CDmdSsrcCollector : public IDmdDatagramSink {
+public:
+    CDmdSsrcCollector() : iCallCount(0) {}
+
+    void OnDatagrams(const DmdDatagram *pDatagrams, unsigned int iCount) {
+        iCallCount++;
+        for (unsigned int i = 0; i < iCount; i++) {
+            uint32_t iSsrc = 0;
+            bool bRtcp = false;
+            if (DMD_S_OK == CDmdSsrcDemuxer::GetStreamSsrc(
+                        pDatagrams[i].pData, pDatagrams[i].ulSize,
+                        &iSsrc, &bRtcp)) {
+                vecSsrcs.push_back(iSsrc);
+                vecRtcp.push_back(bRtcp);
+            }
+        }
+    }
+
+    unsigned int iCallCount;
+    vector<uint32_t> vecSsrcs;
+    vector<bool> vecRtcp;
+};
+
+static vector<uint8_t> rtpPacket(uint32_t iSsrc) {
+    vector<uint8_t> data(DMD_RTP_HEADER_SIZE + 20, 0);
+    data[0] = DMD_RTP_VERSION << 6;
+    data[1] = DMD_RTP_H264_PAYLOAD_TYPE;
+    for (int i = 0; i < 4; i++) {
+        data[8 + i] = static_cast<uint8_t>(iSsrc >> (24 - 8 * i));
+    }
+    return data;
+}
+
+// sender ssrc at 4, the block or media source ssrc at 8;
+static vector<uint8_t> rtcpPacket(uint8_t iType, uint8_t iCount,
+        uint32_t iSender, uint32_t iMedia) {
+    vector<uint8_t> data(32, 0);
+    data[0] = static_cast<uint8_t>(DMD_RTP_VERSION << 6 | iCount);
+    data[1] = iType;
+    for (int i = 0; i < 4; i++) {
+        data[4 + i] = static_cast<uint8_t>(iSender >> (24 - 8 * i));
+        data[8 + i] = static_cast<uint8_t>(iMedia >> (24 - 8 * i));
+    }
+    return data;
+}
+
+static void demux(CDmdSsrcDemuxer *pDemuxer,
+        const vector<vector<uint8_t> > &packets) {
+    vector<DmdDatagram> datagrams(packets.size());
+    for (size_t i = 0; i < packets.size(); i++) {
+        memset(&datagrams[i], 0, sizeof(DmdDatagram));
+        datagrams[i].pData = &packets[i][0];
+        datagrams[i].ulSize = packets[i].size();
+    }
+    pDemuxer->OnDatagrams(&datagrams[0], datagrams.size());
+}
+
+TEST(CDmdSsrcDemuxerTest, RoutesByRunsOfStreams) {
+    CDmdSsrcCollector unknown;
+    vector<CDmdSsrcCollector> vecStreams(100);
+    CDmdSsrcDemuxer demuxer;
+    ASSERT_EQ(DMD_S_OK, demuxer.Init(&unknown));
+    // consecutive ssrcs, as a careless peer would pick them;
+    for (size_t i = 0; i < vecStreams.size(); i++) {
+        ASSERT_EQ(DMD_S_OK, demuxer.AddStream(0x1000 + i, &vecStreams[i]));
+    }
+    EXPECT_NE(DMD_S_OK, demuxer.AddStream(0x1000, &unknown));
+    EXPECT_NE(DMD_S_OK, demuxer.AddStream(0x2000, NULL));
+    EXPECT_EQ(100U, demuxer.GetStreamCount());
+
+    vector<vector<uint8_t> > packets;
+    for (int i = 0; i < 3; i++) {
+        packets.push_back(rtpPacket(0x1000));
+    }
+    packets.push_back(rtpPacket(0x1063));
+    packets.push_back(rtpPacket(0x1063));
+    packets.push_back(rtpPacket(0x1000));
+    packets.push_back(rtpPacket(0xdead));
+    // too short, then rtp version 1;
+    packets.push_back(vector<uint8_t>(6, 0x80));
+    packets.push_back(rtpPacket(0x1000));
+    packets.back()[0] = 0x40;
+    packets.push_back(rtcpPacket(DMD_RTCP_PT_SR, 1, 0x1001, 0x5555));
+    packets.push_back(rtcpPacket(DMD_RTCP_PT_RR, 1, 0x5555, 0x1002));
+    packets.push_back(rtcpPacket(DMD_RTCP_PT_RR, 0, 0x1003, 0));
+    packets.push_back(rtcpPacket(DMD_RTCP_PT_RTPFB, DMD_RTCP_FMT_NACK,
+                0x5555, 0x1004));
+    demux(&demuxer, packets);
+
+    EXPECT_EQ(4U, vecStreams[0].vecSsrcs.size());
+    EXPECT_EQ(2U, vecStreams[0].iCallCount);
+    EXPECT_EQ(2U, vecStreams[99].vecSsrcs.size());
+    EXPECT_EQ(1U, vecStreams[99].iCallCount);
+    for (size_t i = 1; i <= 4; i++) {
+        ASSERT_EQ(1U, vecStreams[i].vecSsrcs.size());
+        EXPECT_TRUE(vecStreams[i].vecRtcp[0]);
+    }
+    ASSERT_EQ(1U, unknown.vecSsrcs.size());
+    EXPECT_EQ(0xdeadU, unknown.vecSsrcs[0]);
+
+    DmdSsrcDemuxerStats stats;
+    demuxer.GetStats(&stats);
+    EXPECT_EQ(7U, stats.ulRtpCount);
+    EXPECT_EQ(4U, stats.ulRtcpCount);
+    EXPECT_EQ(1U, stats.ulUnknownCount);
+    EXPECT_EQ(2U, stats.ulMalformedCount);
+    EXPECT_EQ(8U, stats.ulDeliverCount);
+    // a run of one stream is looked up once;
+    EXPECT_EQ(8U, stats.ulLookupCount);
+
+    // a stream removed is unknown, the others stay found;
+    ASSERT_EQ(DMD_S_OK, demuxer.RemoveStream(0x1000));
+    EXPECT_NE(DMD_S_OK, demuxer.RemoveStream(0x1000));
+    packets.clear();
+    for (size_t i = 0; i < vecStreams.size(); i++) {
+        packets.push_back(rtpPacket(0x1000 + i));
+    }
+    demux(&demuxer, packets);
+    EXPECT_EQ(4U, vecStreams[0].vecSsrcs.size());
+    EXPECT_EQ(2U, unknown.vecSsrcs.size());
+    for (size_t i = 5; i < vecStreams.size() - 1; i++) {
+        EXPECT_EQ(1U, vecStreams[i].vecSsrcs.size());
+    }
+}
+
+// the packets of several cameras through one socket, split again;
+TEST(CDmdSsrcDemuxerTest, SharesOneSocket) {
+    struct sockaddr_storage receiverAddr;
+    int iReceiver = DmdOpenUdpSocket("127.0.0.1", 0, &receiverAddr);
+    ASSERT_GE(iReceiver, 0);
+    int iBuffer = 4 * 1024 * 1024;
+    setsockopt(iReceiver, SOL_SOCKET, SO_RCVBUF, &iBuffer, sizeof(iBuffer));
+
+    DmdUdpSenderParam senderParam;
+    memset(&senderParam, 0, sizeof(senderParam));
+    senderParam.remoteAddr = receiverAddr;
+    senderParam.iRemoteAddrLen = sizeof(struct sockaddr_in);
+    senderParam.eMode = DmdUdpSendBatch;
+    CDmdUdpSender sender;
+    ASSERT_EQ(DMD_S_OK, sender.Init(senderParam));
+
+    CDmdSsrcDemuxer demuxer;
+    ASSERT_EQ(DMD_S_OK, demuxer.Init(NULL));
+    DmdUdpReceiverParam receiverParam;
+    memset(&receiverParam, 0, sizeof(receiverParam));
+    receiverParam.eBackend = DmdUdpRecvEpoll;
+    CDmdUdpReceiver receiver;
+    ASSERT_EQ(DMD_S_OK, receiver.Init(receiverParam, &demuxer));
+    ASSERT_EQ(DMD_S_OK, receiver.AddSocket(iReceiver, 0));
+
+    const int iCameraCount = 4;
+    CDmdRtpPacketizer arrPacketizers[iCameraCount];
+    CDmdSsrcCollector arrCameras[iCameraCount];
+    vector<uint8_t> slice(5000);
+    slice[0] = 0x65;
+    struct iovec iov = {&slice[0], slice.size()};
+    DmdEncodedFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.eFrameType = DmdFrameIDR;
+    frame.iNalCount = 1;
+    frame.pNalIov = &iov;
+    size_t ulSent = 0;
+    for (int i = 0; i < iCameraCount; i++) {
+        DmdRtpPacketizerParam param;
+        memset(&param, 0, sizeof(param));
+        param.iSsrc = 0x10000 * (i + 1);
+        param.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+        param.ulMtu = DMD_RTP_DEFAULT_MTU;
+        ASSERT_EQ(DMD_S_OK, arrPacketizers[i].Init(param));
+        ASSERT_EQ(DMD_S_OK,
+                demuxer.AddStream(param.iSsrc, &arrCameras[i]));
+        const DmdRtpPacket *pPackets = NULL;
+        unsigned int iPacketCount = 0;
+        ASSERT_EQ(DMD_S_OK, arrPacketizers[i].Packetize(&frame, &pPackets,
+                    &iPacketCount));
+        ASSERT_EQ(DMD_S_OK, sender.SendPackets(pPackets, iPacketCount));
+        ulSent += iPacketCount;
+    }
+
+    DmdSsrcDemuxerStats stats;
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < 50 && stats.ulRtpCount < ulSent; i++) {
+        ASSERT_EQ(DMD_S_OK, receiver.Poll(20));
+        demuxer.GetStats(&stats);
+    }
+    EXPECT_EQ(ulSent, stats.ulRtpCount);
+    EXPECT_EQ(0U, stats.ulUnknownCount);
+    // each camera's packets came in a row, one lookup a camera;
+    EXPECT_LE(stats.ulLookupCount, static_cast<uint64_t>(
+                2 * iCameraCount));
+    for (int i = 0; i < iCameraCount; i++) {
+        EXPECT_EQ(ulSent / iCameraCount, arrCameras[i].vecSsrcs.size());
+        for (size_t j = 0; j < arrCameras[i].vecSsrcs.size(); j++) {
+            EXPECT_EQ(0x10000U * (i + 1), arrCameras[i].vecSsrcs[j]);
+        }
+    }
+    receiver.Uninit();
+    close(iReceiver);
+}
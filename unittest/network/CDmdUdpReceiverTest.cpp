@@ -0,0 +1,211 @@
+/*
+ ============================================================================
+ * Name        : CDmdUdpReceiverTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of udp receive engine.
+ ============================================================================
+ */
+
+#include <netinet/in.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdUdpReceiver.h"
+#include "CDmdUring.h"
+#include "DmdSocketUtils.h"
+
+using namespace opendmd;
+using std::vector;
+
+// keeps every datagram, per stream;
+class CDmdDatagramCollector : public IDmdDatagramSink {
+public:
+    explicit CDmdDatagramCollector(size_t ulStreamCount)
+        : vecStreams(ulStreamCount), iTruncatedCount(0) {}
+
+    void OnDatagrams(const DmdDatagram *pDatagrams, unsigned int iCount) {
+        for (unsigned int i = 0; i < iCount; i++) {
+            const DmdDatagram &datagram = pDatagrams[i];
+            EXPECT_EQ(AF_INET, datagram.pSrcAddr->sa_family);
+            vecStreams[datagram.iStreamId].push_back(vector<uint8_t>(
+                        datagram.pData, datagram.pData + datagram.ulSize));
+            iTruncatedCount += datagram.bTruncated;
+        }
+    }
+
+    vector<vector<vector<uint8_t> > > vecStreams;
+    unsigned int iTruncatedCount;
+};
+
+class CDmdUdpReceiverTest : public testing::Test {
+public:
+    CDmdUdpReceiverTest() : iSender(-1) {}
+    virtual ~CDmdUdpReceiverTest() {}
+
+    virtual void SetUp() {
+        struct sockaddr_storage senderAddr;
+        iSender = DmdOpenUdpSocket("127.0.0.1", 0, &senderAddr);
+        ASSERT_GE(iSender, 0);
+        for (int i = 0; i < 4; i++) {
+            struct sockaddr_storage addr;
+            int iSocket = DmdOpenUdpSocket("127.0.0.1", 0, &addr);
+            ASSERT_GE(iSocket, 0);
+            vecSockets.push_back(iSocket);
+            vecAddrs.push_back(addr);
+        }
+    }
+
+    virtual void TearDown() {
+        for (size_t i = 0; i < vecSockets.size(); i++) {
+            close(vecSockets[i]);
+        }
+        if (iSender >= 0) {
+            close(iSender);
+        }
+    }
+
+    static vector<uint8_t> datagram(int iStream, int iIndex, size_t ulSize) {
+        vector<uint8_t> data(ulSize);
+        for (size_t i = 0; i < ulSize; i++) {
+            data[i] = static_cast<uint8_t>(iStream * 31 + iIndex + i);
+        }
+        return data;
+    }
+
+    void sendTo(int iStream, int iFirst, int iCount, size_t ulSize) {
+        for (int i = iFirst; i < iFirst + iCount; i++) {
+            vector<uint8_t> data = datagram(iStream, i, ulSize);
+            ASSERT_EQ(static_cast<ssize_t>(ulSize), sendto(iSender, &data[0],
+                        ulSize, 0, reinterpret_cast<const struct sockaddr *>(
+                            &vecAddrs[iStream]),
+                        sizeof(struct sockaddr_in)));
+        }
+    }
+
+    // every stream, in order, within a bounded number of polls;
+    void receiveAll(CDmdUdpReceiver *pReceiver,
+            CDmdDatagramCollector *pCollector, size_t ulPerStream) {
+        for (int i = 0; i < 100; i++) {
+            bool bDone = true;
+            for (size_t s = 0; s < pCollector->vecStreams.size(); s++) {
+                bDone = bDone
+                    && pCollector->vecStreams[s].size() >= ulPerStream;
+            }
+            if (bDone) {
+                break;
+            }
+            ASSERT_EQ(DMD_S_OK, pReceiver->Poll(20));
+        }
+        for (size_t s = 0; s < pCollector->vecStreams.size(); s++) {
+            const vector<vector<uint8_t> > &stream =
+                pCollector->vecStreams[s];
+            ASSERT_EQ(ulPerStream, stream.size());
+            for (size_t i = 0; i < stream.size(); i++) {
+                EXPECT_TRUE(datagram(s, i, stream[i].size()) == stream[i]);
+            }
+        }
+    }
+
+    void runBackend(DmdUdpRecvBackend eBackend, unsigned int iBufferCount) {
+        DmdUdpReceiverParam param;
+        memset(&param, 0, sizeof(param));
+        param.eBackend = eBackend;
+        param.iBufferCount = iBufferCount;
+        CDmdDatagramCollector collector(vecSockets.size());
+        CDmdUdpReceiver receiver;
+        ASSERT_EQ(DMD_S_OK, receiver.Init(param, &collector));
+        for (size_t i = 0; i < vecSockets.size(); i++) {
+            ASSERT_EQ(DMD_S_OK, receiver.AddSocket(vecSockets[i], i));
+        }
+        // nothing yet, the poll times out;
+        ASSERT_EQ(DMD_S_OK, receiver.Poll(10));
+
+        // in rounds the socket buffers hold;
+        for (int r = 0; r < 5; r++) {
+            for (size_t i = 0; i < vecSockets.size(); i++) {
+                sendTo(i, r * 20, 20, 1200);
+            }
+            receiveAll(&receiver, &collector, (r + 1) * 20);
+        }
+        DmdUdpReceiverStats stats;
+        receiver.GetStats(&stats);
+        EXPECT_EQ(400U, stats.ulDatagramCount);
+        EXPECT_EQ(400U * 1200, stats.ulByteCount);
+        EXPECT_EQ(0U, stats.ulErrorCount);
+        // batched, far fewer syscalls than datagrams;
+        EXPECT_LT(stats.ulSyscallCount, 100U);
+        if (DmdUdpRecvUring == receiver.GetBackend()) {
+            // the ring of 64 runs dry, multishot ends and is rearmed;
+            EXPECT_GT(stats.ulNoBufferCount, 0U);
+        }
+
+        // longer than a buffer;
+        sendTo(0, 100, 1, 4000);
+        for (int i = 0; i < 10 && 0 == collector.iTruncatedCount; i++) {
+            ASSERT_EQ(DMD_S_OK, receiver.Poll(20));
+        }
+        EXPECT_EQ(1U, collector.iTruncatedCount);
+    }
+
+    int iSender;
+    vector<int> vecSockets;
+    vector<struct sockaddr_storage> vecAddrs;
+};
+
+TEST_F(CDmdUdpReceiverTest, Epoll) {
+    runBackend(DmdUdpRecvEpoll, 0);
+}
+
+// without multishot io_uring, the receiver falls back to epoll;
+TEST_F(CDmdUdpReceiverTest, Uring) {
+    runBackend(DmdUdpRecvUring, 64);
+}
+
+TEST_F(CDmdUdpReceiverTest, SelectsBackend) {
+    CDmdDatagramCollector collector(1);
+    DmdUdpReceiverParam param;
+    memset(&param, 0, sizeof(param));
+    CDmdUdpReceiver receiver;
+    ASSERT_EQ(DMD_S_OK, receiver.Init(param, &collector));
+    EXPECT_EQ(DmdUringMultishot == CDmdUring::ProbeLevel()
+            ? DmdUdpRecvUring : DmdUdpRecvEpoll, receiver.GetBackend());
+    param.iBufferCount = 100;
+    EXPECT_NE(DMD_S_OK, receiver.Init(param, &collector));
+    EXPECT_NE(DMD_S_OK, receiver.Init(param, NULL));
+}
@@ -0,0 +1,224 @@
+/*
+ ============================================================================
+ * Name        : CDmdUdpSenderTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : unittest of batched udp sender.
+ ============================================================================
+ */
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdRtpPacketizer.h"
+#include "CDmdUdpSender.h"
+#include "DmdRtp.h"
+#include "DmdSocketUtils.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdUdpSenderTest : public testing::Test {
+public:
+    CDmdUdpSenderTest() : iReceiver(-1), pPackets(NULL), iPacketCount(0) {}
+    virtual ~CDmdUdpSenderTest() {}
+
+    virtual void SetUp() {
+        iReceiver = DmdOpenUdpSocket("127.0.0.1", 0, &receiverAddr);
+        ASSERT_GE(iReceiver, 0);
+        int iBuffer = 4 * 1024 * 1024;
+        setsockopt(iReceiver, SOL_SOCKET, SO_RCVBUF, &iBuffer,
+                sizeof(iBuffer));
+
+        // sps, pps and a slice of a key frame: a stap-a, then fu-a;
+        DmdRtpPacketizerParam param;
+        memset(&param, 0, sizeof(param));
+        param.iSsrc = 0x1234;
+        param.iPayloadType = DMD_RTP_H264_PAYLOAD_TYPE;
+        param.ulMtu = DMD_RTP_DEFAULT_MTU;
+        param.bAggregate = true;
+        ASSERT_EQ(DMD_S_OK, packetizer.Init(param));
+        size_t arrSizes[] = {12, 4, 20000};
+        for (size_t i = 0; i < 3; i++) {
+            vector<uint8_t> nal(arrSizes[i]);
+            for (size_t j = 0; j < nal.size(); j++) {
+                nal[j] = static_cast<uint8_t>(j * 13 + i);
+            }
+            nal[0] = static_cast<uint8_t>(0x60 | (i ? 5 : 7));
+            nals.push_back(nal);
+        }
+        for (size_t i = 0; i < nals.size(); i++) {
+            struct iovec iov = {&nals[i][0], nals[i].size()};
+            iovs.push_back(iov);
+        }
+        memset(&frame, 0, sizeof(frame));
+        frame.eFrameType = DmdFrameIDR;
+        frame.ulTimestamp = 1000000;
+        frame.iNalCount = static_cast<unsigned int>(iovs.size());
+        frame.pNalIov = &iovs[0];
+        ASSERT_EQ(DMD_S_OK,
+                packetizer.Packetize(&frame, &pPackets, &iPacketCount));
+        ASSERT_GT(iPacketCount, 2U);
+    }
+
+    virtual void TearDown() {
+        if (iReceiver >= 0) {
+            close(iReceiver);
+        }
+    }
+
+    DMD_RESULT initSender(CDmdUdpSender *pSender, DmdUdpSendMode eMode) {
+        DmdUdpSenderParam senderParam;
+        memset(&senderParam, 0, sizeof(senderParam));
+        senderParam.remoteAddr = receiverAddr;
+        senderParam.iRemoteAddrLen = sizeof(struct sockaddr_in);
+        senderParam.eMode = eMode;
+        return pSender->Init(senderParam);
+    }
+
+    // every datagram that arrives within the timeout;
+    vector<vector<uint8_t> > receiveAll() {
+        vector<vector<uint8_t> > result;
+        vector<uint8_t> buffer(65536);
+        struct pollfd pfd = {iReceiver, POLLIN, 0};
+        while (poll(&pfd, 1, 200) > 0) {
+            ssize_t iSize = recv(iReceiver, &buffer[0], buffer.size(), 0);
+            if (iSize < 0) {
+                break;
+            }
+            result.push_back(vector<uint8_t>(buffer.begin(),
+                        buffer.begin() + iSize));
+        }
+        return result;
+    }
+
+    static vector<uint8_t> flatten(const DmdRtpPacket &packet) {
+        vector<uint8_t> bytes;
+        for (unsigned int i = 0; i < packet.iIovCount; i++) {
+            const uint8_t *pData =
+                static_cast<const uint8_t *>(packet.pIov[i].iov_base);
+            bytes.insert(bytes.end(), pData, pData + packet.pIov[i].iov_len);
+        }
+        return bytes;
+    }
+
+    void expectReceived() {
+        vector<vector<uint8_t> > datagrams = receiveAll();
+        ASSERT_EQ(iPacketCount, datagrams.size());
+        for (unsigned int i = 0; i < iPacketCount; i++) {
+            EXPECT_TRUE(flatten(pPackets[i]) == datagrams[i]) << i;
+        }
+    }
+
+public:
+    int iReceiver;
+    struct sockaddr_storage receiverAddr;
+    CDmdRtpPacketizer packetizer;
+    vector<vector<uint8_t> > nals;
+    vector<struct iovec> iovs;
+    DmdEncodedFrame frame;
+    const DmdRtpPacket *pPackets;
+    unsigned int iPacketCount;
+};
+
+TEST_F(CDmdUdpSenderTest, SendEach) {
+    CDmdUdpSender sender;
+    ASSERT_EQ(DMD_S_OK, initSender(&sender, DmdUdpSendEach));
+    unsigned int iSent = 0;
+    EXPECT_EQ(DMD_S_OK, sender.SendPackets(pPackets, iPacketCount, &iSent));
+    EXPECT_EQ(iPacketCount, iSent);
+    expectReceived();
+
+    DmdUdpSenderStats stats;
+    sender.GetStats(&stats);
+    EXPECT_EQ(1U, stats.ulCallCount);
+    EXPECT_EQ(iPacketCount, stats.ulSyscallCount);
+    EXPECT_EQ(iPacketCount, stats.ulPacketCount);
+}
+
+TEST_F(CDmdUdpSenderTest, SendBatched) {
+    CDmdUdpSender sender;
+    ASSERT_EQ(DMD_S_OK, initSender(&sender, DmdUdpSendBatch));
+    EXPECT_FALSE(sender.IsGsoEnabled());
+    unsigned int iSent = 0;
+    EXPECT_EQ(DMD_S_OK, sender.SendPackets(pPackets, iPacketCount, &iSent));
+    EXPECT_EQ(iPacketCount, iSent);
+    expectReceived();
+
+    DmdUdpSenderStats stats;
+    sender.GetStats(&stats);
+    EXPECT_EQ(1U, stats.ulSyscallCount);
+    EXPECT_EQ(0U, stats.ulGsoMessageCount);
+}
+
+// without kernel support, the sender batches as DmdUdpSendBatch does;
+TEST_F(CDmdUdpSenderTest, SendGso) {
+    CDmdUdpSender sender;
+    ASSERT_EQ(DMD_S_OK, initSender(&sender, DmdUdpSendGso));
+    unsigned int iSent = 0;
+    EXPECT_EQ(DMD_S_OK, sender.SendPackets(pPackets, iPacketCount, &iSent));
+    EXPECT_EQ(iPacketCount, iSent);
+    expectReceived();
+
+    DmdUdpSenderStats stats;
+    sender.GetStats(&stats);
+    EXPECT_LE(stats.ulSyscallCount, 2U);
+    EXPECT_EQ(iPacketCount, stats.ulPacketCount);
+    if (sender.IsGsoEnabled()) {
+        EXPECT_GE(stats.ulGsoMessageCount, 1U);
+    }
+}
+
+// without io_uring, the sender batches with sendmmsg();
+TEST_F(CDmdUdpSenderTest, SendUring) {
+    CDmdUdpSender sender;
+    ASSERT_EQ(DMD_S_OK, initSender(&sender, DmdUdpSendUring));
+    EXPECT_EQ(DmdUringNone != CDmdUring::ProbeLevel(),
+            sender.IsUringEnabled());
+    unsigned int iSent = 0;
+    EXPECT_EQ(DMD_S_OK, sender.SendPackets(pPackets, iPacketCount, &iSent));
+    EXPECT_EQ(iPacketCount, iSent);
+    expectReceived();
+
+    DmdUdpSenderStats stats;
+    sender.GetStats(&stats);
+    EXPECT_LE(stats.ulSyscallCount, 2U);
+    EXPECT_EQ(iPacketCount, stats.ulPacketCount);
+}
@@ -0,0 +1,208 @@
+/*
+ ============================================================================
+ * Name        : CDmdMotionDetectorTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : test class of CDmdMotionDetector.
+ ============================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdColorConvert.h"
+#include "CDmdMotionDetector.h"
+#include "CDmdPrivacyMask.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdMotionDetectorTest : public testing::Test {
+public:
+    CDmdMotionDetectorTest() : iWidth(128), iHeight(96) {
+        buffer.resize(DmdI420FrameSize(iWidth, iHeight));
+        memset(&videoRawData, 0, sizeof(videoRawData));
+        DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+
+        motionParam.bEnable = true;
+        motionParam.iBlockSize = DMD_MOTION_DEFAULT_BLOCK_SIZE;
+        motionParam.iPixelThreshold = DMD_MOTION_DEFAULT_PIXEL_THRESHOLD;
+        motionParam.iMinChangedPermille = DMD_MOTION_DEFAULT_MIN_PERMILLE;
+    }
+
+    virtual ~CDmdMotionDetectorTest() {}
+
+    virtual void SetUp() {
+        srand(17);
+        for (size_t i = 0; i < buffer.size(); i++) {
+            buffer[i] = static_cast<uint8_t>(rand());
+        }
+    }
+    virtual void TearDown() {}
+
+    void paintLuma(unsigned int iX, unsigned int iY, unsigned int iW,
+            unsigned int iH, uint8_t value) {
+        for (unsigned int y = iY; y < iY + iH; y++) {
+            memset(&buffer[y * iWidth + iX], value, iW);
+        }
+    }
+
+public:
+    unsigned int iWidth;
+    unsigned int iHeight;
+    vector<uint8_t> buffer;
+    DmdVideoRawData videoRawData;
+    DmdMotionDetectParam motionParam;
+};
+
+TEST_F(CDmdMotionDetectorTest, SadMatchesC) {
+    vector<uint8_t> other(buffer.size());
+    for (size_t i = 0; i < other.size(); i++) {
+        other[i] = static_cast<uint8_t>(rand());
+    }
+
+    unsigned int widths[] = {16, 21, 32, 7};
+    for (size_t i = 0; i < sizeof(widths) / sizeof(widths[0]); i++) {
+        EXPECT_EQ(DmdBlockSadC(&buffer[3], iWidth * 2, &other[5], iWidth,
+                    widths[i], 8),
+                DmdBlockSad(&buffer[3], iWidth * 2, &other[5], iWidth,
+                    widths[i], 8));
+    }
+    EXPECT_EQ(0U, DmdBlockSad(&buffer[0], iWidth, &buffer[0], iWidth, 16, 8));
+}
+
+TEST_F(CDmdMotionDetectorTest, StaticSceneHasNoMotion) {
+    CDmdMotionDetector detector;
+    DmdMotionResult result;
+    EXPECT_EQ(DMD_S_OK, detector.Init(motionParam));
+
+    // no reference yet, reported as motion;
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_TRUE(result.bMotion);
+
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_FALSE(result.bMotion);
+    EXPECT_EQ(0U, result.iChangedBlocks);
+    EXPECT_EQ((iWidth / 16) * (iHeight / 16), result.iActiveBlocks);
+
+    // a 32x32 object aligned to the block grid;
+    paintLuma(32, 16, 32, 32, 0);
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_TRUE(result.bMotion);
+    EXPECT_EQ(4U, result.iChangedBlocks);
+    EXPECT_EQ(4U * 1000 / result.iActiveBlocks, result.iChangedPermille);
+
+    // a small flicker below the pixel threshold;
+    for (unsigned int x = 0; x < iWidth; x++) {
+        buffer[x] ^= 1;
+    }
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_FALSE(result.bMotion);
+
+    DmdMotionStats stats;
+    detector.GetStats(&stats);
+    EXPECT_EQ(4U, stats.ulFrameCount);
+    EXPECT_EQ(2U, stats.ulMotionFrameCount);
+
+    detector.Reset();
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_TRUE(result.bMotion);
+    EXPECT_EQ(DMD_S_OK, detector.Uninit());
+}
+
+TEST_F(CDmdMotionDetectorTest, ObjectLeavesToBackground) {
+    CDmdMotionDetector detector;
+    DmdMotionResult result;
+    EXPECT_EQ(DMD_S_OK, detector.Init(motionParam));
+    vector<uint8_t> background(buffer);
+
+    // learned once stable for a few frames;
+    for (unsigned int i = 0; i <= DMD_MOTION_BACKGROUND_STABLE_FRAMES; i++) {
+        EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+        EXPECT_FALSE(result.bBackground);
+    }
+
+    // an object walks in and moves, never the background;
+    for (unsigned int i = 0; i < 3; i++) {
+        buffer = background;
+        paintLuma(16 + i * 16, 16, 32, 32, 0);
+        EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+        EXPECT_TRUE(result.bMotion);
+        EXPECT_FALSE(result.bBackground);
+    }
+
+    // and leaves;
+    buffer = background;
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_TRUE(result.bMotion);
+    EXPECT_TRUE(result.bBackground);
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, NULL, &result));
+    EXPECT_FALSE(result.bMotion);
+    EXPECT_FALSE(result.bBackground);
+
+    DmdMotionStats stats;
+    detector.GetStats(&stats);
+    EXPECT_EQ(1U, stats.ulBackgroundFrameCount);
+    EXPECT_EQ(DMD_S_OK, detector.Uninit());
+}
+
+TEST_F(CDmdMotionDetectorTest, PrivacyZonesIgnored) {
+    vector<DmdMaskRect> rects;
+    DmdMaskRect rect = {0, 0, 48, 48};
+    rects.push_back(rect);
+    CDmdPrivacyMask mask;
+    EXPECT_EQ(DMD_S_OK, mask.Build(iWidth, iHeight, rects,
+                vector<DmdMaskPolygon>()));
+
+    CDmdMotionDetector detector;
+    DmdMotionResult result;
+    EXPECT_EQ(DMD_S_OK, detector.Init(motionParam));
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, &mask, &result));
+
+    // changes behind the mask are not motion;
+    paintLuma(0, 0, 40, 40, 255);
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, &mask, &result));
+    EXPECT_FALSE(result.bMotion);
+    EXPECT_EQ((iWidth / 16) * (iHeight / 16) - 9, result.iActiveBlocks);
+
+    paintLuma(96, 64, 16, 16, 255);
+    EXPECT_EQ(DMD_S_OK, detector.Process(&videoRawData, &mask, &result));
+    EXPECT_TRUE(result.bMotion);
+    EXPECT_EQ(1U, result.iChangedBlocks);
+    EXPECT_EQ(DMD_S_OK, detector.Uninit());
+}
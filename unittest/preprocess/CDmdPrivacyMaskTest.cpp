@@ -0,0 +1,241 @@
+/*
+ ============================================================================
+ * Name        : CDmdPrivacyMaskTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : test class of CDmdPrivacyMask and masked conversion.
+ ============================================================================
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdColorConvert.h"
+#include "CDmdPreprocessor.h"
+#include "CDmdPrivacyMask.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdPrivacyMaskTest : public testing::Test {
+public:
+    CDmdPrivacyMaskTest() {}
+    virtual ~CDmdPrivacyMaskTest() {}
+
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    static DmdMaskRect makeRect(int x, int y, unsigned int w,
+            unsigned int h) {
+        DmdMaskRect rect = {x, y, w, h};
+        return rect;
+    }
+
+    static DmdMaskPoint makePoint(int x, int y) {
+        DmdMaskPoint point = {x, y};
+        return point;
+    }
+};
+
+// collect frames delivered by the preprocessor;
+class CDmdFrameCollector : public IDmdCaptureEngineSink {
+public:
+    CDmdFrameCollector() : iFrameCount(0) {}
+    DMD_RESULT DeliverVideoData(DmdVideoRawData *pVideoRawData) {
+        iFrameCount++;
+        lastFrame.assign(pVideoRawData->pSrcData,
+                pVideoRawData->pSrcData + pVideoRawData->ulDataLen);
+        return DMD_S_OK;
+    }
+
+    int iFrameCount;
+    vector<uint8_t> lastFrame;
+};
+
+TEST_F(CDmdPrivacyMaskTest, RectsMergeIntoSpans) {
+    vector<DmdMaskRect> rects;
+    rects.push_back(makeRect(2, 1, 4, 2));
+    rects.push_back(makeRect(5, 2, 3, 2));    // overlaps the first one;
+    rects.push_back(makeRect(14, -3, 10, 4));  // clipped to the frame;
+    CDmdPrivacyMask mask;
+    EXPECT_EQ(DMD_S_OK, mask.Build(16, 8, rects, vector<DmdMaskPolygon>()));
+
+    size_t ulCount = 0;
+    const DmdMaskSpan *pSpans = mask.GetLumaSpans(2, &ulCount);
+    ASSERT_EQ(1U, ulCount);
+    EXPECT_EQ(2U, pSpans[0].iStart);
+    EXPECT_EQ(8U, pSpans[0].iEnd);
+    pSpans = mask.GetLumaSpans(0, &ulCount);
+    ASSERT_EQ(1U, ulCount);
+    EXPECT_EQ(14U, pSpans[0].iStart);
+    EXPECT_EQ(16U, pSpans[0].iEnd);
+    mask.GetLumaSpans(4, &ulCount);
+    EXPECT_EQ(0U, ulCount);
+
+    // luma rows 2 and 3 fold into chroma row 1: [1, 4);
+    pSpans = mask.GetChromaSpans(1, &ulCount);
+    ASSERT_EQ(1U, ulCount);
+    EXPECT_EQ(1U, pSpans[0].iStart);
+    EXPECT_EQ(4U, pSpans[0].iEnd);
+
+    EXPECT_EQ(4U + 6U + 3U + 2U, mask.GetMaskedPixels());
+    EXPECT_EQ(mask.GetMaskedPixels(), mask.CountMaskedPixels(0, 0, 16, 8));
+    EXPECT_EQ(2U, mask.CountMaskedPixels(4, 1, 2, 1));
+}
+
+TEST_F(CDmdPrivacyMaskTest, PolygonMatchesRect) {
+    DmdMaskPolygon square;
+    square.push_back(makePoint(3, 2));
+    square.push_back(makePoint(9, 2));
+    square.push_back(makePoint(9, 6));
+    square.push_back(makePoint(3, 6));
+    vector<DmdMaskPolygon> polygons(1, square);
+    CDmdPrivacyMask polygonMask;
+    EXPECT_EQ(DMD_S_OK, polygonMask.Build(16, 8, vector<DmdMaskRect>(),
+                polygons));
+
+    vector<DmdMaskRect> rects(1, makeRect(3, 2, 6, 4));
+    CDmdPrivacyMask rectMask;
+    EXPECT_EQ(DMD_S_OK, rectMask.Build(16, 8, rects,
+                vector<DmdMaskPolygon>()));
+    for (unsigned int y = 0; y < 8; y++) {
+        for (unsigned int x = 0; x < 16; x++) {
+            EXPECT_EQ(rectMask.IsMasked(x, y), polygonMask.IsMasked(x, y));
+        }
+    }
+
+    // a triangle narrows towards its apex;
+    DmdMaskPolygon triangle;
+    triangle.push_back(makePoint(0, 0));
+    triangle.push_back(makePoint(8, 8));
+    triangle.push_back(makePoint(0, 8));
+    polygons.assign(1, triangle);
+    CDmdPrivacyMask triangleMask;
+    EXPECT_EQ(DMD_S_OK, triangleMask.Build(16, 8, vector<DmdMaskRect>(),
+                polygons));
+    EXPECT_TRUE(triangleMask.IsMasked(0, 7));
+    EXPECT_TRUE(triangleMask.IsMasked(6, 7));
+    EXPECT_FALSE(triangleMask.IsMasked(8, 7));
+    EXPECT_FALSE(triangleMask.IsMasked(1, 0));
+    EXPECT_EQ(28U, triangleMask.GetMaskedPixels());
+}
+
+TEST_F(CDmdPrivacyMaskTest, FilledDuringConversion) {
+    unsigned int w = 8, h = 4;
+    vector<uint8_t> nv12(w * h * 3 / 2, 200);
+    DmdVideoRawData src;
+    memset(&src, 0, sizeof(src));
+    src.fmtVideoFormat.eVideoType = DmdNV12;
+    src.fmtVideoFormat.iWidth = w;
+    src.fmtVideoFormat.iHeight = h;
+    src.pSrcData = &nv12[0];
+    src.ulDataLen = nv12.size();
+    DmdFixupRawDataPlanes(&src);
+
+    vector<uint8_t> dstBuffer(DmdI420FrameSize(w, h));
+    DmdVideoRawData dst;
+    memset(&dst, 0, sizeof(dst));
+    DmdSetupI420Planes(&dst, &dstBuffer[0], w, h);
+
+    vector<DmdMaskRect> rects(1, makeRect(0, 0, 2, 2));
+    CDmdPrivacyMask mask;
+    EXPECT_EQ(DMD_S_OK, mask.Build(w, h, rects, vector<DmdMaskPolygon>()));
+    EXPECT_EQ(DMD_S_OK, DmdConvertToI420(&src, &dst, &mask));
+
+    EXPECT_EQ(DMD_PRIVACY_MASK_LUMA, dstBuffer[0]);
+    EXPECT_EQ(DMD_PRIVACY_MASK_LUMA, dstBuffer[w + 1]);
+    EXPECT_EQ(200, dstBuffer[2]);
+    EXPECT_EQ(200, dstBuffer[2 * w]);
+    uint8_t *pU = dst.pSrcDataPanel[1];
+    uint8_t *pV = dst.pSrcDataPanel[2];
+    EXPECT_EQ(DMD_PRIVACY_MASK_CHROMA, pU[0]);
+    EXPECT_EQ(DMD_PRIVACY_MASK_CHROMA, pV[0]);
+    EXPECT_EQ(200, pU[1]);
+    EXPECT_EQ(200, pV[dst.ulSrcDataStride[2]]);
+
+    // a mask built for another resolution is refused;
+    CDmdPrivacyMask wrongMask;
+    EXPECT_EQ(DMD_S_OK, wrongMask.Build(w * 2, h, rects,
+                vector<DmdMaskPolygon>()));
+    EXPECT_EQ(DMD_S_FAIL, DmdConvertToI420(&src, &dst, &wrongMask));
+}
+
+TEST_F(CDmdPrivacyMaskTest, PreprocessorSwapsMask) {
+    unsigned int w = 16, h = 8;
+    vector<uint8_t> frameBuffer(DmdI420FrameSize(w, h), 150);
+    DmdVideoRawData frame;
+    memset(&frame, 0, sizeof(frame));
+    DmdSetupI420Planes(&frame, &frameBuffer[0], w, h);
+
+    CDmdPreprocessor preprocessor;
+    CDmdFrameCollector collector;
+    DmdPreprocessParam param = {{0, DMD_DENOISE_DEFAULT_THRESHOLD}};
+    EXPECT_EQ(DMD_S_OK, preprocessor.Init(param));
+    preprocessor.SetDataSink(&collector);
+
+    // set before the first frame, rebuilt once resolution is known;
+    vector<DmdMaskRect> rects(1, makeRect(0, 0, 4, 4));
+    EXPECT_EQ(DMD_S_OK, preprocessor.SetPrivacyMask(rects,
+                vector<DmdMaskPolygon>()));
+    EXPECT_EQ(DMD_S_OK, preprocessor.DeliverVideoData(&frame));
+    ASSERT_EQ(1, collector.iFrameCount);
+    EXPECT_EQ(DMD_PRIVACY_MASK_LUMA, collector.lastFrame[3 * w + 3]);
+    EXPECT_EQ(150, collector.lastFrame[4 * w + 4]);
+    std::shared_ptr<const CDmdPrivacyMask> pMask =
+        preprocessor.GetPrivacyMask();
+    ASSERT_TRUE(pMask.get() != NULL);
+    EXPECT_EQ(w, pMask->GetWidth());
+
+    // the capture side keeps its reference while a new mask is swapped in;
+    rects.assign(1, makeRect(8, 4, 8, 4));
+    EXPECT_EQ(DMD_S_OK, preprocessor.SetPrivacyMask(rects,
+                vector<DmdMaskPolygon>()));
+    EXPECT_TRUE(pMask->IsMasked(0, 0));
+    EXPECT_EQ(DMD_S_OK, preprocessor.DeliverVideoData(&frame));
+    EXPECT_EQ(150, collector.lastFrame[0]);
+    EXPECT_EQ(DMD_PRIVACY_MASK_LUMA, collector.lastFrame[7 * w + 15]);
+
+    preprocessor.ClearPrivacyMask();
+    EXPECT_EQ(DMD_S_OK, preprocessor.DeliverVideoData(&frame));
+    EXPECT_EQ(150, collector.lastFrame[7 * w + 15]);
+
+    DmdPreprocessStats stats;
+    preprocessor.GetStats(&stats);
+    EXPECT_EQ(3U, stats.ulMaskUpdateCount);
+    EXPECT_EQ(3U, stats.ulFrameCount);
+    EXPECT_EQ(DMD_S_OK, preprocessor.Uninit());
+}
@@ -0,0 +1,245 @@
+/*
+ ============================================================================
+ * Name        : CDmdTemporalDenoiseTest.cpp
+ * Author      : weizhenwei, <weizhenwei1988@gmail.com>
+ * Date        : 2026.10.19
+ *
+ * Copyright   :
+ * Copyright (c) 2016, weizhenwei
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ *
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ *
+ * * Neither the name of the {organization} nor the names of its
+ *   contributors may be used to endorse or promote products derived from
+ *   this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Description : test class of CDmdTemporalDenoise and color convert.
+ ============================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "IDmdDatatype.h"
+#include "CDmdColorConvert.h"
+#include "CDmdTemporalDenoise.h"
+
+using namespace opendmd;
+using std::vector;
+
+class CDmdTemporalDenoiseTest : public testing::Test {
+public:
+    CDmdTemporalDenoiseTest() : iWidth(100), iHeight(36) {
+        buffer.resize(DmdI420FrameSize(iWidth, iHeight));
+        memset(&videoRawData, 0, sizeof(videoRawData));
+        DmdSetupI420Planes(&videoRawData, &buffer[0], iWidth, iHeight);
+        srand(1);
+    }
+
+    virtual ~CDmdTemporalDenoiseTest() {}
+
+    virtual void SetUp() {}
+    virtual void TearDown() {}
+
+    // a flat grey scene with +-4 sensor noise;
+    void fillNoisyFrame(int iBase) {
+        for (size_t i = 0; i < buffer.size(); i++) {
+            buffer[i] = static_cast<uint8_t>(iBase + (rand() % 9) - 4);
+        }
+    }
+
+    double lumaVariance(int iBase) {
+        double sum = 0;
+        for (unsigned int i = 0; i < iWidth * iHeight; i++) {
+            double diff = buffer[i] - iBase;
+            sum += diff * diff;
+        }
+        return sum / (iWidth * iHeight);
+    }
+
+public:
+    unsigned int iWidth;
+    unsigned int iHeight;
+    vector<uint8_t> buffer;
+    DmdVideoRawData videoRawData;
+};
+
+TEST_F(CDmdTemporalDenoiseTest, ReduceStaticNoise) {
+    CDmdTemporalDenoise denoise;
+    DmdDenoiseParam param = {80, DMD_DENOISE_DEFAULT_THRESHOLD};
+    EXPECT_EQ(DMD_S_OK, denoise.Init(param));
+
+    fillNoisyFrame(128);
+    double originVariance = lumaVariance(128);
+    for (int i = 0; i < 30; i++) {
+        fillNoisyFrame(128);
+        EXPECT_EQ(DMD_S_OK, denoise.Process(&videoRawData));
+    }
+    EXPECT_LT(lumaVariance(128), originVariance / 2);
+
+    DmdDenoiseStats stats;
+    denoise.GetStats(&stats);
+    EXPECT_EQ(30U, stats.ulFrameCount);
+    EXPECT_EQ(DMD_S_OK, denoise.Uninit());
+}
+
+TEST_F(CDmdTemporalDenoiseTest, MotionPassThrough) {
+    CDmdTemporalDenoise denoise;
+    DmdDenoiseParam param = {100, DMD_DENOISE_DEFAULT_THRESHOLD};
+    EXPECT_EQ(DMD_S_OK, denoise.Init(param));
+
+    memset(&buffer[0], 30, buffer.size());
+    EXPECT_EQ(DMD_S_OK, denoise.Process(&videoRawData));
+    // an object appears, difference far above threshold;
+    memset(&buffer[0], 200, buffer.size());
+    EXPECT_EQ(DMD_S_OK, denoise.Process(&videoRawData));
+    for (size_t i = 0; i < buffer.size(); i++) {
+        ASSERT_EQ(200, buffer[i]);
+    }
+}
+
+TEST_F(CDmdTemporalDenoiseTest, StrengthZeroIsNoop) {
+    CDmdTemporalDenoise denoise;
+    DmdDenoiseParam param = {0, DMD_DENOISE_DEFAULT_THRESHOLD};
+    EXPECT_EQ(DMD_S_OK, denoise.Init(param));
+
+    fillNoisyFrame(128);
+    vector<uint8_t> origin = buffer;
+    EXPECT_EQ(DMD_S_OK, denoise.Process(&videoRawData));
+    EXPECT_TRUE(origin == buffer);
+}
+
+TEST_F(CDmdTemporalDenoiseTest, SimdMatchesC) {
+    unsigned int iPlaneWidth = 77;  // exercise the scalar tail;
+    unsigned int iPlaneHeight = 5;
+    vector<uint8_t> cur(iPlaneWidth * iPlaneHeight);
+    vector<uint8_t> prev(iPlaneWidth * iPlaneHeight);
+    for (size_t i = 0; i < cur.size(); i++) {
+        cur[i] = static_cast<uint8_t>(rand() & 0xff);
+        prev[i] = static_cast<uint8_t>(rand() & 0xff);
+    }
+    vector<uint8_t> curC = cur, prevC = prev;
+
+    int iMinWeight = 16, iThreshold = 20;
+    int iSlope = ((128 - iMinWeight) << 7) / iThreshold;
+    DmdTemporalDenoisePlane(&cur[0], iPlaneWidth, &prev[0], iPlaneWidth,
+            iPlaneWidth, iPlaneHeight, iMinWeight, iSlope, iThreshold);
+    DmdTemporalDenoisePlaneC(&curC[0], iPlaneWidth, &prevC[0], iPlaneWidth,
+            iPlaneWidth, iPlaneHeight, iMinWeight, iSlope, iThreshold);
+    EXPECT_TRUE(cur == curC);
+    EXPECT_TRUE(prev == prevC);
+}
+
+TEST_F(CDmdTemporalDenoiseTest, ConvertYUYVToI420) {
+    unsigned int w = 4, h = 2;
+    uint8_t yuyv[16] = {
+        10, 100, 11, 200, 12, 101, 13, 201,
+        20, 102, 21, 202, 22, 103, 23, 203,
+    };
+    DmdVideoRawData src;
+    memset(&src, 0, sizeof(src));
+    src.fmtVideoFormat.eVideoType = DmdYUYV;
+    src.fmtVideoFormat.iWidth = w;
+    src.fmtVideoFormat.iHeight = h;
+    src.pSrcData = yuyv;
+    src.ulDataLen = sizeof(yuyv);
+    DmdFixupRawDataPlanes(&src);
+
+    vector<uint8_t> dstBuffer(DmdI420FrameSize(w, h));
+    DmdVideoRawData dst;
+    memset(&dst, 0, sizeof(dst));
+    DmdSetupI420Planes(&dst, &dstBuffer[0], w, h);
+    EXPECT_EQ(DMD_S_OK, DmdConvertToI420(&src, &dst));
+
+    uint8_t expected[12] = {10, 11, 12, 13, 20, 21, 22, 23,
+        100, 101, 200, 201};
+    for (int i = 0; i < 12; i++) {
+        EXPECT_EQ(expected[i], dstBuffer[i]);
+    }
+}
+
+TEST_F(CDmdTemporalDenoiseTest, ConvertOddWidthToI420) {
+    // the last pixel of a row is half a macropixel, y and u for YUYV, u
+    // and y for UYVY;
+    unsigned int w = 3, h = 1;
+    uint8_t yuyv[6] = {10, 100, 11, 200, 12, 101};
+    uint8_t uyvy[6] = {100, 10, 200, 11, 101, 12};
+    uint8_t *arrSrc[2] = {yuyv, uyvy};
+    DmdVideoType arrType[2] = {DmdYUYV, DmdUYVY};
+    for (int i = 0; i < 2; i++) {
+        DmdVideoRawData src;
+        memset(&src, 0, sizeof(src));
+        src.fmtVideoFormat.eVideoType = arrType[i];
+        src.fmtVideoFormat.iWidth = w;
+        src.fmtVideoFormat.iHeight = h;
+        src.pSrcData = arrSrc[i];
+        src.ulDataLen = sizeof(yuyv);
+        DmdFixupRawDataPlanes(&src);
+
+        // filled beforehand, to catch a chroma column left unwritten;
+        vector<uint8_t> dstBuffer(DmdI420FrameSize(w, h), 0xee);
+        DmdVideoRawData dst;
+        memset(&dst, 0, sizeof(dst));
+        DmdSetupI420Planes(&dst, &dstBuffer[0], w, h);
+        EXPECT_EQ(DMD_S_OK, DmdConvertToI420(&src, &dst));
+
+        uint8_t expected[7] = {10, 11, 12, 100, 101, 200, 200};
+        ASSERT_EQ(sizeof(expected), dstBuffer.size());
+        for (size_t j = 0; j < sizeof(expected); j++) {
+            EXPECT_EQ(expected[j], dstBuffer[j]);
+        }
+    }
+}
+
+TEST_F(CDmdTemporalDenoiseTest, DownscaleI420AveragesBlocks) {
+    unsigned int w = 8, h = 4;
+    vector<uint8_t> srcBuffer(DmdI420FrameSize(w, h));
+    DmdVideoRawData src;
+    memset(&src, 0, sizeof(src));
+    DmdSetupI420Planes(&src, &srcBuffer[0], w, h);
+    for (size_t i = 0; i < srcBuffer.size(); i++) {
+        srcBuffer[i] = static_cast<uint8_t>(i * 4);
+    }
+
+    unsigned int dw = DmdDownscaledSize(w, 2);
+    unsigned int dh = DmdDownscaledSize(h, 2);
+    ASSERT_EQ(4U, dw);
+    ASSERT_EQ(2U, dh);
+    vector<uint8_t> dstBuffer(DmdI420FrameSize(dw, dh));
+    DmdVideoRawData dst;
+    memset(&dst, 0, sizeof(dst));
+    DmdSetupI420Planes(&dst, &dstBuffer[0], dw, dh);
+    EXPECT_EQ(DMD_S_OK, DmdDownscaleI420(&src, &dst, 2));
+
+    // mean of (x, y), (x + 1, y), (x, y + 1), (x + 1, y + 1);
+    uint8_t expected[12] = {18, 26, 34, 42, 82, 90, 98, 106,
+        138, 146, 170, 178};
+    for (int i = 0; i < 12; i++) {
+        EXPECT_EQ(expected[i], dstBuffer[i]);
+    }
+    EXPECT_EQ(DMD_S_FAIL, DmdDownscaleI420(&src, &dst, 4));
+}